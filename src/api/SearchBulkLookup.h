@@ -0,0 +1,308 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include "SearchSqlText.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cwctype>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace wsearch
+{
+
+/* IBulkLookupSource - runs the lookup statements of a BulkPropertyLookup
+ *
+ * ExecuteLookup runs one SELECT built by details::AppendItemUrlLookupSql and calls 'emit' with
+ * the System.ItemUrl and decoded properties of each row. It is called from several worker
+ * threads at once.
+ */
+template <typename Row>
+class IBulkLookupSource
+{
+public:
+    using EmitRow = std::function<void(std::wstring_view itemUrl, Row&& row)>;
+
+    virtual ~IBulkLookupSource() = default;
+
+    virtual void ExecuteLookup(const std::wstring& sql, const EmitRow& emit) = 0;
+
+    // Called on each worker thread before its first lookup and after its last one
+    // (e.g. to join and leave a COM apartment)
+    virtual void OnWorkerThreadStarted() {}
+    virtual void OnWorkerThreadStopping() {}
+};
+
+struct BulkLookupOptions
+{
+    size_t maxPathsPerQuery = 128;         // predicates per statement; see SearchBulkLookupBenchmark
+    size_t maxSqlLength = 16 * 1024;       // characters per statement
+    size_t maxConcurrentQueries = 4;       // statements in flight at once
+    std::optional<uint64_t> reuseWhereId;  // restrict to a primed scope (REUSEWHERE) instead of the whole index
+};
+
+// One input path: 'found' is false when the index has no item for it
+template <typename Row>
+struct BulkLookupEntry
+{
+    std::wstring path;
+    bool found = false;
+    Row row{};
+};
+
+template <typename Row>
+struct BulkLookupResult
+{
+    std::vector<BulkLookupEntry<Row>> entries; // in input order
+    size_t queries = 0;
+    size_t found = 0;
+    size_t missing = 0;
+};
+
+namespace details
+{
+    // How the indexer's System.ItemUrl and an input path are matched: as a URL, case-insensitively
+    inline std::wstring ItemUrlLookupKey(std::wstring_view path)
+    {
+        std::wstring key;
+        key.reserve(path.size() + 5);
+        AppendScopeUrl(key, path);
+        for (auto& ch : key)
+        {
+            ch = static_cast<wchar_t>(std::towlower(ch));
+        }
+        return key;
+    }
+} // namespace details
+
+/* BulkPropertyLookup - indexed properties for a list of known paths in a few statements
+ *
+ * Replaces one query per path. Distinct paths are split into the fewest even chunks of at most
+ * maxPathsPerQuery paths (and maxSqlLength characters), each looked up with a single
+ * "System.ItemUrl = ... OR ..." statement; up to maxConcurrentQueries chunks run at once.
+ * Statements have a fixed round trip cost and long OR chains get slower per predicate, so the
+ * default chunk size sits between the two.
+ * Returned rows are matched back to the inputs, so entries come back in input order, duplicates
+ * included, with 'found' false for paths the index doesn't have. With reuseWhereId set the
+ * statements run against an already primed scope (see SearchSessionBase::GetPrimingReuseWhereId).
+ *
+ * If a statement fails, the remaining chunks are skipped and the first exception is rethrown
+ * once the workers have stopped.
+ *
+ * Example:
+ *   wsearch::BulkPropertyLookup<FileInfo> lookup(source, { L"System.Size", L"System.Kind" });
+ *   auto result = lookup.Lookup(paths);
+ *   for (const auto& entry : result.entries)
+ *   {
+ *       if (!entry.found) { MarkMissing(entry.path); }
+ *   }
+ */
+template <typename Row>
+class BulkPropertyLookup
+{
+public:
+    BulkPropertyLookup(std::shared_ptr<IBulkLookupSource<Row>> source, std::vector<std::wstring> properties,
+        BulkLookupOptions options = {})
+        : m_source(std::move(source))
+        , m_properties(std::move(properties))
+        , m_options(std::move(options))
+    {
+        m_options.maxPathsPerQuery = std::max<size_t>(m_options.maxPathsPerQuery, 1);
+        m_options.maxConcurrentQueries = std::max<size_t>(m_options.maxConcurrentQueries, 1);
+    }
+
+    BulkLookupResult<Row> Lookup(const std::vector<std::wstring>& paths) const
+    {
+        BulkLookupResult<Row> result;
+        result.entries.resize(paths.size());
+
+        // Distinct paths in first-seen order; every input index is filled from its key
+        std::unordered_map<std::wstring, std::vector<size_t>> indicesByKey;
+        std::vector<const std::wstring*> distinctPaths;
+        for (size_t i = 0; i < paths.size(); ++i)
+        {
+            result.entries[i].path = paths[i];
+            auto& indices = indicesByKey[details::ItemUrlLookupKey(paths[i])];
+            if (indices.empty())
+            {
+                distinctPaths.push_back(&paths[i]);
+            }
+            indices.push_back(i);
+        }
+
+        auto chunks = SplitIntoChunks(distinctPaths);
+        result.queries = chunks.size();
+
+        std::mutex resultMutex;
+        auto runChunk = [&](size_t chunk) {
+            std::wstring sql;
+            const uint64_t* whereId = m_options.reuseWhereId ? &*m_options.reuseWhereId : nullptr;
+            details::AppendItemUrlLookupSql(sql, m_properties, PathIterator{ distinctPaths.data() + chunks[chunk].first },
+                PathIterator{ distinctPaths.data() + chunks[chunk].second }, whereId);
+
+            m_source->ExecuteLookup(sql, [&](std::wstring_view itemUrl, Row&& row) {
+                auto match = indicesByKey.find(details::ItemUrlLookupKey(itemUrl));
+                if (match == indicesByKey.end())
+                {
+                    return;
+                }
+
+                std::lock_guard<std::mutex> lock(resultMutex);
+                for (size_t index : match->second)
+                {
+                    auto& entry = result.entries[index];
+                    if (!entry.found)
+                    {
+                        entry.found = true;
+                        entry.row = row;
+                    }
+                }
+            });
+        };
+
+        size_t workerCount = std::min(m_options.maxConcurrentQueries, chunks.size());
+        if (workerCount <= 1)
+        {
+            // A single statement, or one at a time: run on the caller's thread
+            for (size_t chunk = 0; chunk < chunks.size(); ++chunk)
+            {
+                runChunk(chunk);
+            }
+        }
+        else
+        {
+            RunOnWorkers(workerCount, chunks.size(), runChunk);
+        }
+
+        for (const auto& entry : result.entries)
+        {
+            (entry.found ? result.found : result.missing) += 1;
+        }
+        return result;
+    }
+
+    const BulkLookupOptions& GetOptions() const
+    {
+        return m_options;
+    }
+
+private:
+    // Walks the distinct paths of a chunk as std::wstring_view
+    struct PathIterator
+    {
+        const std::wstring* const* current;
+
+        std::wstring_view operator*() const
+        {
+            return **current;
+        }
+
+        PathIterator& operator++()
+        {
+            ++current;
+            return *this;
+        }
+
+        bool operator!=(const PathIterator& other) const
+        {
+            return current != other.current;
+        }
+    };
+
+    // [first, second) ranges of 'paths', each within the per-statement limits
+    std::vector<std::pair<size_t, size_t>> SplitIntoChunks(const std::vector<const std::wstring*>& paths) const
+    {
+        // "SELECT System.ItemUrl, <props> FROM SystemIndex WHERE REUSEWHERE(n) AND (...)"
+        size_t baseLength = 80;
+        for (const auto& prop : m_properties)
+        {
+            baseLength += prop.size() + 2;
+        }
+
+        // Even chunks, so there is no small statement at the end paying a full round trip
+        size_t chunkCount = (paths.size() + m_options.maxPathsPerQuery - 1) / m_options.maxPathsPerQuery;
+        size_t pathsPerChunk = chunkCount == 0 ? 1 : (paths.size() + chunkCount - 1) / chunkCount;
+
+        std::vector<std::pair<size_t, size_t>> chunks;
+        size_t first = 0;
+        size_t length = baseLength;
+        for (size_t i = 0; i < paths.size(); ++i)
+        {
+            // " OR System.ItemUrl = 'file:<path>'" with room for escaped quotes
+            size_t predicateLength = paths[i]->size() + 32;
+            bool full = (i - first) >= pathsPerChunk || length + predicateLength > m_options.maxSqlLength;
+            if (i > first && full)
+            {
+                chunks.emplace_back(first, i);
+                first = i;
+                length = baseLength;
+            }
+            length += predicateLength;
+        }
+        if (first < paths.size())
+        {
+            chunks.emplace_back(first, paths.size());
+        }
+        return chunks;
+    }
+
+    template <typename RunChunk>
+    void RunOnWorkers(size_t workerCount, size_t chunkCount, RunChunk& runChunk) const
+    {
+        std::atomic<size_t> nextChunk{ 0 };
+        std::atomic<bool> failed{ false };
+        std::exception_ptr firstError;
+        std::mutex errorMutex;
+
+        std::vector<std::thread> workers;
+        workers.reserve(workerCount);
+        for (size_t w = 0; w < workerCount; ++w)
+        {
+            workers.emplace_back([&]() {
+                try
+                {
+                    m_source->OnWorkerThreadStarted();
+                    for (size_t chunk = nextChunk++; chunk < chunkCount && !failed; chunk = nextChunk++)
+                    {
+                        runChunk(chunk);
+                    }
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if (!firstError)
+                    {
+                        firstError = std::current_exception();
+                    }
+                    failed = true;
+                }
+                m_source->OnWorkerThreadStopping();
+            });
+        }
+
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+
+        if (firstError)
+        {
+            std::rethrow_exception(firstError);
+        }
+    }
+
+    std::shared_ptr<IBulkLookupSource<Row>> m_source;
+    std::vector<std::wstring> m_properties;
+    BulkLookupOptions m_options;
+};
+
+} // namespace wsearch
@@ -0,0 +1,330 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace wsearch
+{
+
+namespace details
+{
+    // A locked mutex of any type, so the one virtual ISearchClock wait serves them all;
+    // condition_variable_any waits on it as it would on the mutex itself
+    class ClockLock
+    {
+    public:
+        template <typename Mutex>
+        explicit ClockLock(Mutex& mutex)
+            : m_mutex(&mutex)
+            , m_lock([](void* m) { static_cast<Mutex*>(m)->lock(); })
+            , m_unlock([](void* m) { static_cast<Mutex*>(m)->unlock(); })
+        {
+        }
+
+        void lock()
+        {
+            m_lock(m_mutex);
+        }
+
+        void unlock()
+        {
+            m_unlock(m_mutex);
+        }
+
+    private:
+        void* m_mutex;
+        void (*m_lock)(void*);
+        void (*m_unlock)(void*);
+    };
+} // namespace details
+
+/* ISearchClock - the time and the timers of sessions and background services
+ *
+ * Code that debounces, schedules or times queries reads the time and waits through a clock
+ * instead of steady_clock and condition_variable::wait_for, so tests and simulators can give it
+ * a VirtualSearchClock and run in virtual time. Time points are steady_clock's whichever clock
+ * produced them.
+ *
+ * Example:
+ *   std::unique_lock<std::mutex> lock(m_mutex);
+ *   m_clock->WaitUntil(m_cv, lock, m_clock->Now() + interval, [this] { return m_shouldStop; });
+ */
+class ISearchClock
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    virtual ~ISearchClock() = default;
+
+    virtual Clock::time_point Now() const = 0;
+
+    // Releases 'lock' and blocks until 'cv' is notified or the clock reaches 'deadline'
+    // (Clock::time_point::max() waits for a notification only). May return spuriously.
+    template <typename Mutex>
+    void WaitUntil(std::condition_variable_any& cv, std::unique_lock<Mutex>& lock, Clock::time_point deadline)
+    {
+        details::ClockLock erased(*lock.mutex());
+        Wait(cv, erased, deadline);
+    }
+
+    // Waits as above until 'predicate' holds; returns false if the deadline came first
+    template <typename Mutex, typename Predicate>
+    bool WaitUntil(std::condition_variable_any& cv, std::unique_lock<Mutex>& lock, Clock::time_point deadline, Predicate predicate)
+    {
+        while (!predicate())
+        {
+            if (Now() >= deadline)
+            {
+                return false;
+            }
+            WaitUntil(cv, lock, deadline);
+        }
+        return true;
+    }
+
+    void SleepUntil(Clock::time_point deadline)
+    {
+        std::mutex mutex;
+        std::condition_variable_any cv;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (Now() < deadline)
+        {
+            WaitUntil(cv, lock, deadline);
+        }
+    }
+
+    void SleepFor(Clock::duration duration)
+    {
+        SleepUntil(Now() + duration);
+    }
+
+protected:
+    virtual void Wait(std::condition_variable_any& cv, details::ClockLock& lock, Clock::time_point deadline) = 0;
+};
+
+// Real time: steady_clock and the condition variable's own timed waits
+class SteadySearchClock : public ISearchClock
+{
+public:
+    Clock::time_point Now() const override
+    {
+        return Clock::now();
+    }
+
+protected:
+    void Wait(std::condition_variable_any& cv, details::ClockLock& lock, Clock::time_point deadline) override
+    {
+        if (deadline == Clock::time_point::max())
+        {
+            cv.wait(lock);
+        }
+        else
+        {
+            cv.wait_until(lock, deadline);
+        }
+    }
+};
+
+namespace details
+{
+    // The clock sessions and services use unless they are given one
+    inline std::shared_ptr<ISearchClock> GetSteadySearchClock()
+    {
+        static const std::shared_ptr<ISearchClock> clock = std::make_shared<SteadySearchClock>();
+        return clock;
+    }
+} // namespace details
+
+/* VirtualSearchClock - time that moves only when it is told to
+ *
+ * Now() starts at 'start' and changes only with AdvanceTo / AdvanceBy, which wake every thread
+ * whose wait has reached its deadline. Nothing sleeps for real, so a test steps a debounce
+ * delay or a five minute refresh interval in microseconds, and the outcome depends only on the
+ * virtual times things happened at. WaitForWaiters and WaitForDeadline let the advancing
+ * thread wait until background threads are parked on the clock before it moves time.
+ *
+ * Do not advance the clock while holding a mutex that a waiting thread waits with: waking a
+ * waiter takes its mutex, so a wakeup cannot slip in between its check and its wait.
+ *
+ * Example:
+ *   auto clock = std::make_shared<wsearch::VirtualSearchClock>();
+ *   wsearch::SearchAsYouTypeSession search(scopes, {}, {}, std::chrono::milliseconds(50), clock);
+ *   search.SetSearchText(L"report");
+ *   clock->AdvanceBy(std::chrono::milliseconds(50));  // the debounced query starts now
+ *   auto results = search.GetCachedResults();
+ */
+class VirtualSearchClock : public ISearchClock
+{
+public:
+    explicit VirtualSearchClock(Clock::time_point start = Clock::time_point{})
+        : m_now(start.time_since_epoch().count())
+    {
+    }
+
+    // Non-copyable
+    VirtualSearchClock(const VirtualSearchClock&) = delete;
+    VirtualSearchClock& operator=(const VirtualSearchClock&) = delete;
+
+    Clock::time_point Now() const override
+    {
+        return Clock::time_point(Clock::duration(m_now.load(std::memory_order_acquire)));
+    }
+
+    // Moves time forward to 'time' (never back) and wakes the waits that are due; returns how
+    // many it woke
+    size_t AdvanceTo(Clock::time_point time)
+    {
+        std::vector<Waiter*> due;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (time > Now())
+            {
+                m_now.store(time.time_since_epoch().count(), std::memory_order_release);
+            }
+            auto now = Now();
+            auto waiting = std::partition(m_waiters.begin(), m_waiters.end(), [&](const Waiter* waiter) { return waiter->deadline > now; });
+            for (auto it = waiting; it != m_waiters.end(); ++it)
+            {
+                (*it)->notifying = true;
+                due.push_back(*it);
+            }
+            m_waiters.erase(waiting, m_waiters.end());
+        }
+        if (due.empty())
+        {
+            return 0;
+        }
+
+        for (Waiter* waiter : due)
+        {
+            // Taking the waiter's lock orders this with a waiter between its check and its wait
+            waiter->lock->lock();
+            waiter->lock->unlock();
+            waiter->cv->notify_all();
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (Waiter* waiter : due)
+            {
+                waiter->notifying = false;
+            }
+        }
+        m_changed.notify_all();
+        return due.size();
+    }
+
+    size_t AdvanceBy(Clock::duration duration)
+    {
+        return AdvanceTo(Now() + duration);
+    }
+
+    // Advances to the earliest deadline anyone waits for; false if nobody waits with one
+    bool AdvanceToNextDeadline()
+    {
+        auto next = GetNextDeadline();
+        if (next == Clock::time_point::max())
+        {
+            return false;
+        }
+        AdvanceTo(next);
+        return true;
+    }
+
+    // The earliest deadline of the current waits, Clock::time_point::max() if none
+    Clock::time_point GetNextDeadline() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto next = Clock::time_point::max();
+        for (const Waiter* waiter : m_waiters)
+        {
+            next = (std::min)(next, waiter->deadline);
+        }
+        return next;
+    }
+
+    // Threads waiting on the clock, with or without a deadline. A thread woken by its own
+    // condition variable still counts until it runs again.
+    size_t GetWaiterCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_waiters.size();
+    }
+
+    // Blocks (in real time) until at least 'count' threads wait on the clock
+    void WaitForWaiters(size_t count) const
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_changed.wait(lock, [&] { return m_waiters.size() >= count; });
+    }
+
+    // Blocks (in real time) until a thread waits on the clock for exactly 'deadline'; the way a
+    // test knows a background thread has armed the timer it expects before advancing to it
+    void WaitForDeadline(Clock::time_point deadline) const
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_changed.wait(lock, [&] {
+            return std::any_of(m_waiters.begin(), m_waiters.end(), [&](const Waiter* waiter) { return waiter->deadline == deadline; });
+        });
+    }
+
+protected:
+    void Wait(std::condition_variable_any& cv, details::ClockLock& lock, Clock::time_point deadline) override
+    {
+        Waiter waiter{ &cv, &lock, deadline };
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            if (Now() >= deadline)
+            {
+                return;
+            }
+            m_waiters.push_back(&waiter);
+        }
+        m_changed.notify_all();
+
+        cv.wait(lock);
+
+        std::unique_lock<std::mutex> guard(m_mutex);
+        auto found = std::find(m_waiters.begin(), m_waiters.end(), &waiter);
+        if (found != m_waiters.end())
+        {
+            // Woken by someone else, or spuriously
+            m_waiters.erase(found);
+            return;
+        }
+        if (waiter.notifying)
+        {
+            // AdvanceTo is still using 'cv' and needs our lock to get done with it
+            guard.unlock();
+            lock.unlock();
+            guard.lock();
+            m_changed.wait(guard, [&] { return !waiter.notifying; });
+            guard.unlock();
+            lock.lock();
+        }
+    }
+
+private:
+    struct Waiter
+    {
+        std::condition_variable_any* cv;
+        details::ClockLock* lock;
+        Clock::time_point deadline;
+        bool notifying = false; // guarded by m_mutex
+    };
+
+    std::atomic<Clock::rep> m_now;
+
+    mutable std::mutex m_mutex;
+    mutable std::condition_variable m_changed; // waiters arrived or were notified
+    std::vector<Waiter*> m_waiters;
+};
+
+} // namespace wsearch
@@ -0,0 +1,68 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include "SearchPlatCore.h"
+#include "SearchCrawlScopeRules.h"
+
+namespace wsearch
+{
+
+/* SystemIndexCrawlScopeRuleSource - ICrawlScopeRuleSource over the SystemIndex crawl scope manager
+ *
+ * Rules are read with ISearchCrawlScopeManager::EnumerateScopeRules. The version is the
+ * counter ISearchCrawlScopeManager2::GetVersion maps into this process, which the indexer bumps
+ * whenever the rules change, so reading it is a memory load.
+ *
+ * Example:
+ *   wsearch::CrawlScopeRuleEvaluator evaluator(std::make_shared<wsearch::SystemIndexCrawlScopeRuleSource>());
+ *   bool indexed = evaluator.IsIncluded(L"C:\\Users\\me\\Documents\\report.docx");
+ */
+class SystemIndexCrawlScopeRuleSource : public ICrawlScopeRuleSource
+{
+public:
+    SystemIndexCrawlScopeRuleSource()
+        : m_crawlScopeManager(details::GetSystemIndexCrawlScopeManager())
+    {
+        auto versioned = m_crawlScopeManager.as<ISearchCrawlScopeManager2>();
+        long* version = nullptr;
+        HANDLE mapping = nullptr;
+        THROW_IF_FAILED(versioned->GetVersion(&version, &mapping));
+        m_versionView.reset(version);
+        m_versionMapping.reset(mapping);
+    }
+
+    std::vector<CrawlScopeRule> ReadRules() override
+    {
+        wsearch::TelemetryProvider::LogInfo(L"Reading crawl scope rules");
+        winrt::com_ptr<IEnumSearchScopeRules> rules;
+        THROW_IF_FAILED(m_crawlScopeManager->EnumerateScopeRules(rules.put()));
+
+        std::vector<CrawlScopeRule> result;
+        winrt::com_ptr<ISearchScopeRule> rule;
+        while (rules->Next(1, rule.put(), nullptr) == S_OK)
+        {
+            wil::unique_cotaskmem_string pattern;
+            BOOL isIncluded = FALSE;
+            BOOL isDefault = FALSE;
+            THROW_IF_FAILED(rule->get_PatternOrURL(&pattern));
+            THROW_IF_FAILED(rule->get_IsIncluded(&isIncluded));
+            THROW_IF_FAILED(rule->get_IsDefault(&isDefault));
+            result.push_back({ pattern.get(), isIncluded != FALSE, isDefault != FALSE });
+        }
+
+        wsearch::TelemetryProvider::LogInfo(L"Read %zu crawl scope rules", result.size());
+        return result;
+    }
+
+    uint64_t GetRulesVersion() override
+    {
+        return static_cast<uint64_t>(*static_cast<volatile long*>(m_versionView.get()));
+    }
+
+private:
+    winrt::com_ptr<ISearchCrawlScopeManager> m_crawlScopeManager;
+    wil::unique_mapview_ptr<long> m_versionView;
+    wil::unique_handle m_versionMapping;
+};
+
+} // namespace wsearch
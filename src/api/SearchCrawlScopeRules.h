@@ -0,0 +1,462 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include "SearchSynchronization.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cwctype>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace wsearch
+{
+
+// One crawl scope rule as ISearchScopeRule reports it, e.g. "file:///C:\Users\*\AppData\*"
+struct CrawlScopeRule
+{
+    std::wstring pattern;
+    bool isIncluded = true;
+    bool isDefault = false; // default rules yield to user rules on the same scope
+};
+
+/* ICrawlScopeRuleSource - where CrawlScopeRuleEvaluator reads the rules from
+ *
+ * GetRulesVersion() changes whenever the rules change. It is read on every check, so it must
+ * be cheap (the system index exposes it in shared memory).
+ */
+class ICrawlScopeRuleSource
+{
+public:
+    virtual ~ICrawlScopeRuleSource() = default;
+
+    virtual std::vector<CrawlScopeRule> ReadRules() = 0;
+    virtual uint64_t GetRulesVersion() = 0;
+};
+
+namespace details
+{
+    inline wchar_t FoldPathChar(wchar_t ch)
+    {
+        if (ch < 0x80)
+        {
+            return (ch >= L'A' && ch <= L'Z') ? static_cast<wchar_t>(ch + (L'a' - L'A')) : ch;
+        }
+        return static_cast<wchar_t>(std::towlower(ch));
+    }
+
+    // Case-insensitive three-way compare of a path segment with a folded key
+    inline int CompareFoldedSegment(std::wstring_view segment, std::wstring_view foldedKey)
+    {
+        size_t count = (std::min)(segment.size(), foldedKey.size());
+        for (size_t i = 0; i < count; ++i)
+        {
+            wchar_t ch = FoldPathChar(segment[i]);
+            if (ch != foldedKey[i])
+            {
+                return ch < foldedKey[i] ? -1 : 1;
+            }
+        }
+        return segment.size() == foldedKey.size() ? 0 : (segment.size() < foldedKey.size() ? -1 : 1);
+    }
+
+    // '*' matches any run of characters within one segment; both are folded
+    inline bool MatchFoldedGlob(std::wstring_view segment, std::wstring_view pattern)
+    {
+        size_t s = 0, p = 0, starP = std::wstring_view::npos, starS = 0;
+        while (s < segment.size())
+        {
+            if (p < pattern.size() && pattern[p] == L'*')
+            {
+                starP = p++;
+                starS = s;
+            }
+            else if (p < pattern.size() && pattern[p] == segment[s])
+            {
+                ++p;
+                ++s;
+            }
+            else if (starP != std::wstring_view::npos)
+            {
+                p = starP + 1;
+                s = ++starS;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        while (p < pattern.size() && pattern[p] == L'*')
+        {
+            ++p;
+        }
+        return p == pattern.size();
+    }
+
+    // Order of folded segments in a CrawlScopeRuleSet edge table: by length, then by text, so
+    // most mismatches are decided by the length alone
+    inline bool IsFoldedSegmentBefore(std::wstring_view left, std::wstring_view right)
+    {
+        return left.size() != right.size() ? left.size() < right.size() : left < right;
+    }
+
+    // Calls visitor(segment) for each segment of a path or file URL: "file:" and leading
+    // slashes are dropped and both '\' and '/' separate ("file:///C:\a\b" -> "C:", "a", "b")
+    template <typename Visitor>
+    void ForEachPathSegment(std::wstring_view path, Visitor&& visitor)
+    {
+        static constexpr std::wstring_view protocol = L"file:";
+        if (path.size() >= protocol.size() && CompareFoldedSegment(path.substr(0, protocol.size()), protocol) == 0)
+        {
+            path.remove_prefix(protocol.size());
+        }
+
+        size_t start = 0;
+        while (start < path.size())
+        {
+            size_t end = start;
+            while (end < path.size() && path[end] != L'\\' && path[end] != L'/')
+            {
+                ++end;
+            }
+            if (end > start)
+            {
+                visitor(path.substr(start, end - start));
+            }
+            start = end + 1;
+        }
+    }
+} // namespace details
+
+/* CrawlScopeRuleSet - immutable snapshot of crawl scope rules in a path trie
+ *
+ * Answers "would the indexer crawl this path" in memory, without allocating below 520 characters:
+ * - A rule covers its scope and everything below it ("C:\Users\" and "C:\Users\*" are the same).
+ * - A "*" segment matches any one folder, and a segment with '*' in it is a glob
+ *   ("C:\Users\*\AppData\*", "C:\*.tmp").
+ * - The rule on the deepest matching scope decides; at equal depth an exact segment beats a
+ *   wildcard, and a user rule beats a default rule. A path no rule covers is not indexed.
+ * Paths and rules compare case-insensitively and may be plain paths or file: URLs. Rules are
+ * folded when the snapshot is built, into one flat table of sorted segments per trie node; a
+ * check folds the path once and then compares plain characters.
+ *
+ * This mirrors ISearchCrawlScopeManager::IncludedInCrawlScopeEx for the rule shapes above;
+ * use details::AreFilePathsIncludedInIndex where the indexer's own answer is required.
+ *
+ * Example:
+ *   wsearch::CrawlScopeRuleSet rules({ { L"file:///C:\\Users\\", true }, { L"file:///C:\\Users\\*\\AppData\\", false } });
+ *   rules.IsIncluded(L"C:\\Users\\me\\Documents\\a.txt");      // true
+ *   rules.IsIncluded(L"C:\\Users\\me\\AppData\\Local\\x.db");  // false
+ */
+class CrawlScopeRuleSet
+{
+public:
+    explicit CrawlScopeRuleSet(std::vector<CrawlScopeRule> rules, uint64_t version = 0)
+        : m_rules(std::move(rules))
+        , m_version(version)
+    {
+        std::vector<BuildNode> nodes(1);
+        for (size_t i = 0; i < m_rules.size(); ++i)
+        {
+            AddRule(nodes, static_cast<uint32_t>(i));
+        }
+        Compile(nodes);
+    }
+
+    bool IsIncluded(std::wstring_view path) const
+    {
+        const CrawlScopeRule* rule = FindDecidingRule(path);
+        return rule && rule->isIncluded;
+    }
+
+    // The rule that decides 'path', or nullptr when no rule covers it
+    const CrawlScopeRule* FindDecidingRule(std::wstring_view path) const
+    {
+        // The path is folded once, on the stack unless it is a long path
+        wchar_t buffer[c_foldBufferLength];
+        std::wstring longPath;
+        wchar_t* folded = buffer;
+        if (path.size() > c_foldBufferLength)
+        {
+            longPath.resize(path.size());
+            folded = &longPath[0];
+        }
+        for (size_t i = 0; i < path.size(); ++i)
+        {
+            folded[i] = details::FoldPathChar(path[i]);
+        }
+
+        // Segments are views into 'folded'; deeper paths than this are decided by their first
+        // c_maxDepth segments
+        std::wstring_view segments[c_maxDepth];
+        size_t depth = 0;
+        details::ForEachPathSegment(std::wstring_view(folded, path.size()), [&](std::wstring_view segment) {
+            if (depth < c_maxDepth)
+            {
+                segments[depth++] = segment;
+            }
+        });
+
+        Match best;
+        Search(0, segments, depth, 0, 0, best);
+        return best.rule == c_none ? nullptr : &m_rules[best.rule];
+    }
+
+    const std::vector<CrawlScopeRule>& GetRules() const
+    {
+        return m_rules;
+    }
+
+    uint64_t GetVersion() const
+    {
+        return m_version;
+    }
+
+private:
+    static constexpr uint32_t c_none = UINT32_MAX;
+    static constexpr size_t c_maxDepth = 128;
+    static constexpr size_t c_foldBufferLength = 520;
+
+    // The trie while rules are added; Compile flattens it
+    struct BuildNode
+    {
+        std::vector<std::pair<std::wstring, uint32_t>> children; // folded segment -> node
+        std::vector<std::pair<std::wstring, uint32_t>> globs;    // folded glob segment -> node
+        uint32_t anyChild = c_none;                             // "*"
+        uint32_t userRule = c_none;
+        uint32_t defaultRule = c_none;
+    };
+
+    // A folded segment in m_text and the node it leads to
+    struct Edge
+    {
+        uint32_t offset;
+        uint32_t length;
+        uint32_t node;
+    };
+
+    // Exact and glob edges are runs of m_edges; exact ones in IsFoldedSegmentBefore order
+    struct Node
+    {
+        uint32_t firstChild = 0;
+        uint32_t childCount = 0;
+        uint32_t firstGlob = 0;
+        uint32_t globCount = 0;
+        uint32_t anyChild = c_none;
+        uint32_t rule = c_none; // the user rule, else the default rule
+    };
+
+    struct Match
+    {
+        uint32_t rule = c_none;
+        size_t depth = 0;
+        size_t exactSegments = 0;
+    };
+
+    void AddRule(std::vector<BuildNode>& nodes, uint32_t ruleIndex)
+    {
+        std::vector<std::wstring> segments;
+        details::ForEachPathSegment(m_rules[ruleIndex].pattern, [&](std::wstring_view segment) {
+            std::wstring folded(segment);
+            for (auto& ch : folded)
+            {
+                ch = details::FoldPathChar(ch);
+            }
+            segments.push_back(std::move(folded));
+        });
+
+        // A trailing "*" means everything below the scope, which every rule already covers
+        if (!segments.empty() && segments.back() == L"*")
+        {
+            segments.pop_back();
+        }
+        if (segments.empty() || segments.size() > c_maxDepth)
+        {
+            return;
+        }
+
+        uint32_t node = 0;
+        for (const auto& segment : segments)
+        {
+            uint32_t child = static_cast<uint32_t>(nodes.size());
+            if (segment == L"*")
+            {
+                if (nodes[node].anyChild == c_none)
+                {
+                    nodes[node].anyChild = child;
+                    nodes.emplace_back();
+                }
+                node = nodes[node].anyChild;
+                continue;
+            }
+
+            bool isGlob = segment.find(L'*') != std::wstring::npos;
+            auto& edges = isGlob ? nodes[node].globs : nodes[node].children;
+            auto edge = std::lower_bound(edges.begin(), edges.end(), segment,
+                [](const auto& entry, const std::wstring& key) { return details::IsFoldedSegmentBefore(entry.first, key); });
+            if (edge != edges.end() && edge->first == segment)
+            {
+                node = edge->second;
+                continue;
+            }
+
+            edges.emplace(edge, segment, child);
+            nodes.emplace_back(); // invalidates 'edges'
+            node = child;
+        }
+
+        // Later rules for the same scope replace earlier ones
+        (m_rules[ruleIndex].isDefault ? nodes[node].defaultRule : nodes[node].userRule) = ruleIndex;
+    }
+
+    // Flattens the trie into m_nodes, with every edge's text in one buffer
+    void Compile(const std::vector<BuildNode>& nodes)
+    {
+        m_nodes.resize(nodes.size());
+        for (size_t i = 0; i < nodes.size(); ++i)
+        {
+            const BuildNode& built = nodes[i];
+            Node& node = m_nodes[i];
+            node.anyChild = built.anyChild;
+            node.rule = built.userRule != c_none ? built.userRule : built.defaultRule;
+            node.firstChild = static_cast<uint32_t>(m_edges.size());
+            node.childCount = static_cast<uint32_t>(built.children.size());
+            AddEdges(built.children);
+            node.firstGlob = static_cast<uint32_t>(m_edges.size());
+            node.globCount = static_cast<uint32_t>(built.globs.size());
+            AddEdges(built.globs);
+        }
+    }
+
+    void AddEdges(const std::vector<std::pair<std::wstring, uint32_t>>& edges)
+    {
+        for (const auto& edge : edges)
+        {
+            m_edges.push_back({ static_cast<uint32_t>(m_text.size()), static_cast<uint32_t>(edge.first.size()), edge.second });
+            m_text += edge.first;
+        }
+    }
+
+    std::wstring_view GetText(const Edge& edge) const
+    {
+        return std::wstring_view(m_text.data() + edge.offset, edge.length);
+    }
+
+    // 'segments' are folded
+    void Search(uint32_t nodeIndex, const std::wstring_view* segments, size_t count, size_t depth, size_t exactSegments,
+        Match& best) const
+    {
+        const Node& node = m_nodes[nodeIndex];
+        if (node.rule != c_none && (depth > best.depth || (depth == best.depth && exactSegments > best.exactSegments)))
+        {
+            best = { node.rule, depth, exactSegments };
+        }
+        if (depth == count)
+        {
+            return;
+        }
+
+        std::wstring_view segment = segments[depth];
+        const Edge* children = m_edges.data() + node.firstChild;
+        const Edge* childrenEnd = children + node.childCount;
+        const Edge* child = std::lower_bound(children, childrenEnd, segment,
+            [this](const Edge& edge, std::wstring_view key) { return details::IsFoldedSegmentBefore(GetText(edge), key); });
+        if (child != childrenEnd && GetText(*child) == segment)
+        {
+            Search(child->node, segments, count, depth + 1, exactSegments + 1, best);
+        }
+
+        if (node.anyChild != c_none)
+        {
+            Search(node.anyChild, segments, count, depth + 1, exactSegments, best);
+        }
+
+        const Edge* globs = m_edges.data() + node.firstGlob;
+        for (const Edge* glob = globs; glob != globs + node.globCount; ++glob)
+        {
+            if (details::MatchFoldedGlob(segment, GetText(*glob)))
+            {
+                Search(glob->node, segments, count, depth + 1, exactSegments, best);
+            }
+        }
+    }
+
+    std::vector<CrawlScopeRule> m_rules;
+    std::vector<Node> m_nodes;
+    std::vector<Edge> m_edges;
+    std::wstring m_text; // folded segment text of every edge
+    uint64_t m_version;
+};
+
+/* CrawlScopeRuleEvaluator - in-memory crawl scope checks that follow rule changes
+ *
+ * Keeps a CrawlScopeRuleSet snapshot of the source's rules and rebuilds it when the source's
+ * version changes, checked on each call. For a burst of checks, AreIncluded (or a snapshot
+ * from GetSnapshot) checks the version once.
+ *
+ * Example:
+ *   wsearch::CrawlScopeRuleEvaluator evaluator(std::make_shared<wsearch::SystemIndexCrawlScopeRuleSource>());
+ *   auto badges = evaluator.AreIncluded(folderContents);
+ */
+class CrawlScopeRuleEvaluator
+{
+public:
+    explicit CrawlScopeRuleEvaluator(std::shared_ptr<ICrawlScopeRuleSource> source)
+        : m_source(std::move(source))
+    {
+    }
+
+    bool IsIncluded(std::wstring_view path)
+    {
+        return GetSnapshot()->IsIncluded(path);
+    }
+
+    std::vector<bool> AreIncluded(const std::vector<std::wstring>& paths)
+    {
+        auto snapshot = GetSnapshot();
+        std::vector<bool> included(paths.size());
+        for (size_t i = 0; i < paths.size(); ++i)
+        {
+            included[i] = snapshot->IsIncluded(paths[i]);
+        }
+        return included;
+    }
+
+    // The current rules, re-read first if they changed since the last snapshot
+    std::shared_ptr<const CrawlScopeRuleSet> GetSnapshot()
+    {
+        uint64_t version = m_source->GetRulesVersion();
+        auto snapshot = m_snapshot.Load();
+        if (snapshot && snapshot->GetVersion() == version)
+        {
+            return snapshot;
+        }
+
+        std::lock_guard<std::mutex> lock(m_refreshMutex);
+        snapshot = m_snapshot.Load();
+        if (!snapshot || snapshot->GetVersion() != version)
+        {
+            snapshot = std::make_shared<const CrawlScopeRuleSet>(m_source->ReadRules(), version);
+            m_snapshot.Store(snapshot);
+            ++m_refreshCount;
+        }
+        return snapshot;
+    }
+
+    // Number of times the rules were read from the source
+    size_t GetRefreshCount() const
+    {
+        return m_refreshCount;
+    }
+
+private:
+    std::shared_ptr<ICrawlScopeRuleSource> m_source;
+    details::AtomicSharedPtr<const CrawlScopeRuleSet> m_snapshot;
+    std::mutex m_refreshMutex;
+    std::atomic<size_t> m_refreshCount{ 0 };
+};
+
+} // namespace wsearch
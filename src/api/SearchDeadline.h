@@ -0,0 +1,332 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include "SearchClock.h"
+#include "SearchExpected.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace wsearch
+{
+
+/* SearchDeadline - when a caller stops waiting for a query, on a given clock
+ *
+ * A default constructed deadline never expires. Deadlines read the time through an
+ * ISearchClock (steady_clock unless given one), so a test can expire them with a
+ * VirtualSearchClock.
+ *
+ * Example:
+ *   auto deadline = wsearch::SearchDeadline::After(std::chrono::milliseconds(30));
+ *   auto results = query.Wait(deadline);
+ */
+class SearchDeadline
+{
+public:
+    using Clock = ISearchClock::Clock;
+
+    SearchDeadline() = default;
+
+    static SearchDeadline At(Clock::time_point time, std::shared_ptr<ISearchClock> clock = nullptr)
+    {
+        SearchDeadline deadline;
+        deadline.m_clock = std::move(clock);
+        deadline.m_time = time;
+        return deadline;
+    }
+
+    static SearchDeadline After(Clock::duration budget, std::shared_ptr<ISearchClock> clock = nullptr)
+    {
+        auto now = clock ? clock->Now() : Clock::now();
+        return At(now + budget, std::move(clock));
+    }
+
+    Clock::time_point GetTime() const
+    {
+        return m_time;
+    }
+
+    // False for the default "wait until done" deadline
+    bool IsBounded() const
+    {
+        return m_time != Clock::time_point::max();
+    }
+
+    bool IsExpired() const
+    {
+        return IsBounded() && GetClock().Now() >= m_time;
+    }
+
+    // Zero once expired; Clock::duration::max() when unbounded
+    Clock::duration GetRemaining() const
+    {
+        if (!IsBounded())
+        {
+            return Clock::duration::max();
+        }
+        auto now = GetClock().Now();
+        return now >= m_time ? Clock::duration::zero() : m_time - now;
+    }
+
+    ISearchClock& GetClock() const
+    {
+        return m_clock ? *m_clock : *details::GetSteadySearchClock();
+    }
+
+private:
+    std::shared_ptr<ISearchClock> m_clock;
+    Clock::time_point m_time = Clock::time_point::max();
+};
+
+// How far a query had got: results taken before Complete are partial
+enum class QueryStage : uint8_t
+{
+    Execute, // the indexer is running the SQL; no rows yet
+    Fetch,   // fetching a batch of rows from the rowset
+    Decode,  // decoding the properties of fetched rows
+    Complete,
+};
+
+// The rows of a query decoded by the time it was waited for
+template <typename Row>
+struct PartialResults
+{
+    std::vector<Row> rows;                    // in result order
+    bool partial = false;                     // the query had not finished (or was cancelled first)
+    QueryStage stage = QueryStage::Execute;   // where the query was at the time
+    size_t rowsFetched = 0;                   // rowset rows fetched; the decoder may have dropped some
+    ISearchClock::Clock::duration elapsed{};  // since the query started
+};
+
+struct DeadlineQueryOptions
+{
+    // Once a Wait's deadline passes, keep fetching and decoding so a later Wait or
+    // WaitForCompletion gets the full results; otherwise stop at the next row and keep those
+    bool continueInBackground = true;
+    std::shared_ptr<ISearchClock> clock; // times the query; null is steady_clock
+};
+
+/* DeadlineQuery - a query that answers by a deadline with the rows it has so far
+ *
+ * The producer (SQL execution, row fetching and decoding) runs on a thread of its own and
+ * appends rows as it decodes them, so a caller waiting with a deadline is never held up by an
+ * Execute or a fetch that is slow today: when the deadline passes it gets a copy of the rows
+ * decoded until then, flagged as partial, with the stage the query had reached. The query then
+ * either keeps going in the background (continueInBackground), so a later Wait refines the
+ * results, or stops at its next cancellation check.
+ *
+ * The producer reports through Progress and returns indexer failures as SearchErrors; Wait
+ * returns those and rethrows anything it throws. Destroying the query cancels it without
+ * waiting for the step in flight; the worker keeps the producer alive and exits on its own.
+ *
+ * Example:
+ *   wsearch::DeadlineQuery<Item> query([](wsearch::DeadlineQuery<Item>::Progress& progress) {
+ *       return ReadItems(progress);   // SetStage / Append / IsCancelled
+ *   });
+ *   auto first = query.Wait(wsearch::SearchDeadline::After(std::chrono::milliseconds(30)));
+ *   Paint(first->rows);
+ *   if (first->partial) { Paint(query.WaitForCompletion()->rows); }
+ */
+template <typename Row>
+class DeadlineQuery
+{
+    struct State;
+
+public:
+    using Clock = ISearchClock::Clock;
+
+    // Handed to the producer on the query's thread
+    class Progress
+    {
+    public:
+        explicit Progress(State& state)
+            : m_state(state)
+        {
+        }
+
+        void SetStage(QueryStage stage)
+        {
+            std::lock_guard<std::mutex> lock(m_state.mutex);
+            m_state.stage = stage;
+        }
+
+        void AddFetched(size_t rows)
+        {
+            std::lock_guard<std::mutex> lock(m_state.mutex);
+            m_state.rowsFetched += rows;
+        }
+
+        // A decoded row; visible to Wait as soon as this returns
+        void Append(Row row)
+        {
+            std::lock_guard<std::mutex> lock(m_state.mutex);
+            m_state.rows.push_back(std::move(row));
+        }
+
+        // True once the caller gave up on the query; the producer should return (any status) soon
+        bool IsCancelled() const
+        {
+            return m_state.cancelled.load(std::memory_order_relaxed);
+        }
+
+    private:
+        State& m_state;
+    };
+
+    using Producer = std::function<SearchExpected<void>(Progress&)>;
+
+    explicit DeadlineQuery(Producer producer, DeadlineQueryOptions options = {})
+        : m_state(std::make_shared<State>())
+    {
+        m_state->clock = options.clock ? std::move(options.clock) : details::GetSteadySearchClock();
+        m_state->continueInBackground = options.continueInBackground;
+        m_state->start = m_state->clock->Now();
+        m_workerThread = std::thread([state = m_state, producer = std::move(producer)]() mutable {
+            Run(*state, producer);
+        });
+    }
+
+    // Non-copyable
+    DeadlineQuery(const DeadlineQuery&) = delete;
+    DeadlineQuery& operator=(const DeadlineQuery&) = delete;
+
+    ~DeadlineQuery()
+    {
+        Cancel();
+        if (IsFinished())
+        {
+            m_workerThread.join();
+        }
+        else
+        {
+            m_workerThread.detach();
+        }
+    }
+
+    // The results when the query finishes or 'deadline' passes, whichever comes first; partial
+    // in the second case. Indexer failures before the deadline are returned.
+    SearchExpected<PartialResults<Row>> Wait(const SearchDeadline& deadline)
+    {
+        std::unique_lock<std::mutex> lock(m_state->mutex);
+        bool finished = deadline.GetClock().WaitUntil(m_state->changed, lock, deadline.GetTime(), [&] { return m_state->finished; });
+        if (!finished && !m_state->continueInBackground)
+        {
+            m_state->cancelled = true;
+        }
+        return TakeResults();
+    }
+
+    SearchExpected<PartialResults<Row>> WaitForCompletion()
+    {
+        return Wait(SearchDeadline::At(Clock::time_point::max(), m_state->clock));
+    }
+
+    // Stops the producer at its next check; results taken after that are partial
+    void Cancel()
+    {
+        m_state->cancelled = true;
+    }
+
+    bool IsFinished() const
+    {
+        return m_state->finishedFlag.load(std::memory_order_acquire);
+    }
+
+    bool IsCancelled() const
+    {
+        return m_state->cancelled.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct State
+    {
+        std::mutex mutex;
+        std::condition_variable_any changed; // notified when the query finishes
+
+        // Guarded by mutex
+        std::vector<Row> rows;
+        QueryStage stage = QueryStage::Execute;
+        size_t rowsFetched = 0;
+        bool finished = false;
+        bool failed = false;
+        SearchError error{};
+        std::exception_ptr exception;
+        Clock::time_point finishedAt{};
+
+        std::atomic<bool> finishedFlag{ false };
+        std::atomic<bool> cancelled{ false };
+        std::shared_ptr<ISearchClock> clock;
+        bool continueInBackground = true;
+        Clock::time_point start{};
+    };
+
+    static void Run(State& state, Producer& producer)
+    {
+        Progress progress(state);
+        SearchExpected<void> result;
+        std::exception_ptr exception;
+        try
+        {
+            result = producer(progress);
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
+        auto finishedAt = state.clock->Now();
+
+        {
+            std::lock_guard<std::mutex> lock(state.mutex);
+            state.finished = true;
+            state.failed = !result;
+            if (state.failed)
+            {
+                state.error = result.Error();
+            }
+            state.exception = exception;
+            if (!state.failed && !exception && !state.cancelled)
+            {
+                state.stage = QueryStage::Complete;
+            }
+            state.finishedAt = finishedAt;
+            state.finishedFlag.store(true, std::memory_order_release);
+        }
+        state.changed.notify_all();
+    }
+
+    // Called with m_state->mutex held
+    SearchExpected<PartialResults<Row>> TakeResults() const
+    {
+        const State& state = *m_state;
+        if (state.exception)
+        {
+            std::rethrow_exception(state.exception);
+        }
+        if (state.failed)
+        {
+            return state.error;
+        }
+
+        PartialResults<Row> results;
+        results.rows = state.rows;
+        results.stage = state.stage;
+        results.partial = state.stage != QueryStage::Complete;
+        results.rowsFetched = state.rowsFetched;
+        results.elapsed = (state.finished ? state.finishedAt : state.clock->Now()) - state.start;
+        return results;
+    }
+
+    std::shared_ptr<State> m_state;
+    std::thread m_workerThread;
+};
+
+} // namespace wsearch
@@ -0,0 +1,298 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include "SearchClock.h"
+#include "SearchDebouncer.h"
+#include "SearchExpected.h"
+#include "SearchQueryParser.h"
+#include "SearchResultPublisher.h"
+#include "SearchSqlEscape.h"
+#include "SearchSynchronization.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+namespace wsearch
+{
+
+/* DebouncedQueryRunner - the typing, debouncing and publishing half of search-as-you-type
+ *
+ * Owns the search text, the Debouncer that decides when its query runs, the debounce thread
+ * and the ResultPublisher the results go out through; the query itself is a callback. So
+ * SearchAsYouTypeSession runs the indexer through it, and the load generator and tests run
+ * the very same code against a simulated provider, stepped with a VirtualSearchClock.
+ *
+ * The query runs on the debounce thread (or the caller's, for ExecuteNow) without the lock
+ * held. Text with nothing to search for ("-", a lone quote; see ParsedSearchText::HasQuery)
+ * runs no query and publishes cleared results. The callback returns failures as SearchErrors;
+ * if it throws, a failed snapshot is still published so waiters are released.
+ *
+ * Example:
+ *   wsearch::DebouncedQueryRunner<size_t> typing(
+ *       [&](const std::wstring& text) -> wsearch::SearchExpected<size_t> { return provider.Query(text); },
+ *       std::chrono::milliseconds(50), clock);
+ *   typing.AppendCharacters(L"rep");
+ *   size_t rows = typing.WaitForResults()->result;
+ */
+template <typename Result>
+class DebouncedQueryRunner
+{
+public:
+    using Snapshot = ResultSnapshot<Result>;
+    using Query = std::function<SearchExpected<Result>(const std::wstring& searchText)>;
+
+    DebouncedQueryRunner(Query query, std::chrono::milliseconds debounceDelay, std::shared_ptr<ISearchClock> clock = nullptr)
+        : m_query(std::move(query))
+        , m_clock(clock ? std::move(clock) : details::GetSteadySearchClock())
+        , m_debounce(debounceDelay)
+    {
+        m_debounceThread = std::thread(&DebouncedQueryRunner::DebounceThreadProc, this);
+    }
+
+    ~DebouncedQueryRunner()
+    {
+        {
+            std::lock_guard<details::ContentionTrackingMutex> lock(m_mutex);
+            m_shouldStop = true;
+        }
+        m_cv.notify_one();
+
+        if (m_debounceThread.joinable())
+        {
+            m_debounceThread.join();
+        }
+    }
+
+    // Non-copyable
+    DebouncedQueryRunner(const DebouncedQueryRunner&) = delete;
+    DebouncedQueryRunner& operator=(const DebouncedQueryRunner&) = delete;
+
+    void AppendCharacters(std::wstring_view characters)
+    {
+        std::lock_guard<details::ContentionTrackingMutex> lock(m_mutex);
+        m_searchText += characters;
+        m_debounce.OnChanged(m_clock->Now());
+        m_cv.notify_one();
+    }
+
+    void SetSearchText(std::wstring_view searchText)
+    {
+        std::lock_guard<details::ContentionTrackingMutex> lock(m_mutex);
+        m_searchText = searchText;
+        m_debounce.OnChanged(m_clock->Now());
+        m_cv.notify_one();
+    }
+
+    // Clears the text, cancels any pending query and publishes empty results
+    void Clear()
+    {
+        uint64_t request;
+        {
+            std::lock_guard<details::ContentionTrackingMutex> lock(m_mutex);
+            m_searchText.clear();
+            m_debounce.OnChanged(m_clock->Now());
+            request = m_debounce.Dispatch();
+        }
+        PublishCleared(request, {});
+    }
+
+    // Runs the query for the current text now, cancelling the pending one, and publishes it
+    SearchExpected<Result> ExecuteNow()
+    {
+        std::wstring searchText;
+        uint64_t request;
+        {
+            std::lock_guard<details::ContentionTrackingMutex> lock(m_mutex);
+            searchText = m_searchText;
+            request = m_debounce.Dispatch();
+        }
+        return RunQuery(searchText, request);
+    }
+
+    // The text must be searched again at once (the scopes changed); nothing happens for no text
+    void RequeryNow()
+    {
+        std::lock_guard<details::ContentionTrackingMutex> lock(m_mutex);
+        if (!m_searchText.empty())
+        {
+            m_debounce.OnChangedDueNow(m_clock->Now());
+            m_cv.notify_one();
+        }
+    }
+
+    // Blocks until results for the current text are published; waits on the results, not the lock
+    std::shared_ptr<const Snapshot> WaitForResults()
+    {
+        return m_results.WaitForRequest(m_debounce.GetRevision());
+    }
+
+    // The text has no results published yet (debouncing or running)
+    bool IsQueryPending() const
+    {
+        return m_results.GetSnapshot()->request < m_debounce.GetRevision();
+    }
+
+    std::shared_ptr<const Snapshot> GetSnapshot() const
+    {
+        return m_results.GetSnapshot();
+    }
+
+    uint64_t GetGeneration() const
+    {
+        return m_results.GetGeneration();
+    }
+
+    ResultSubscription Subscribe(typename ResultPublisher<Result>::Callback callback)
+    {
+        return m_results.Subscribe(std::move(callback));
+    }
+
+    std::wstring GetSearchText() const
+    {
+        std::lock_guard<details::ContentionTrackingMutex> lock(m_mutex);
+        return m_searchText;
+    }
+
+    // Also moves the deadline of a pending query
+    void SetDebounceDelay(std::chrono::milliseconds delay)
+    {
+        std::lock_guard<details::ContentionTrackingMutex> lock(m_mutex);
+        m_debounce.SetDelay(delay);
+    }
+
+    // Queries actually run (debounced and ExecuteNow); text without a query does not count
+    size_t GetExecutedQueryCount() const
+    {
+        return m_executedQueryCount.load(std::memory_order_relaxed);
+    }
+
+    // Total time callers (including the debounce thread) spent waiting on the lock
+    std::chrono::nanoseconds GetLockWaitTime() const
+    {
+        return m_mutex.GetWaitTime();
+    }
+
+    ISearchClock& GetClock() const
+    {
+        return *m_clock;
+    }
+
+private:
+    void DebounceThreadProc()
+    {
+        std::unique_lock<details::ContentionTrackingMutex> lock(m_mutex);
+        while (true)
+        {
+            m_clock->WaitUntil(m_cv, lock, ISearchClock::Clock::time_point::max(),
+                [this] { return m_debounce.IsPending() || m_shouldStop; });
+            if (m_shouldStop)
+            {
+                break;
+            }
+
+            uint64_t request = m_debounce.TryDispatch(m_clock->Now());
+            if (request == 0)
+            {
+                // Not due yet; wait out the rest of the delay
+                m_clock->WaitUntil(m_cv, lock, m_debounce.GetDeadline());
+                continue;
+            }
+
+            std::wstring searchText = m_searchText;
+            lock.unlock();
+            try
+            {
+                RunQuery(searchText, request);
+            }
+            catch (...)
+            {
+                // Already published as a failure; the thread keeps serving the session
+            }
+            lock.lock();
+        }
+    }
+
+    // Runs the query for text revision 'request' and publishes its results (or failure) with
+    // their timing; results for a revision older than the published one are dropped
+    SearchExpected<Result> RunQuery(const std::wstring& searchText, uint64_t request)
+    {
+        if (!ParseSearchText(details::LimitSearchText(searchText)).HasQuery())
+        {
+            // Half-typed text with no word in it yet; there is nothing to run
+            PublishCleared(request, searchText);
+            return Result{};
+        }
+
+        m_executedQueryCount.fetch_add(1, std::memory_order_relaxed);
+        auto start = m_clock->Now();
+        Snapshot snapshot(request, searchText);
+        snapshot.startTicks = start.time_since_epoch().count();
+
+        SearchExpected<Result> result = Result{};
+        try
+        {
+            result = m_query(searchText);
+        }
+        catch (...)
+        {
+            // Waiters for this revision must still be released
+            snapshot.failed = true;
+            snapshot.error = SearchError{ c_unexpectedError, L"DebouncedQueryRunner query" };
+            m_results.Publish(std::move(snapshot));
+            throw;
+        }
+
+        snapshot.durationMs = std::chrono::duration<double, std::milli>(m_clock->Now() - start).count();
+        if (result)
+        {
+            snapshot.result = *result;
+        }
+        else
+        {
+            snapshot.failed = true;
+            snapshot.error = result.Error();
+        }
+        m_results.Publish(std::move(snapshot));
+        return result;
+    }
+
+    // Empty results for 'request', keeping the last query's timing
+    void PublishCleared(uint64_t request, const std::wstring& searchText)
+    {
+        auto previous = m_results.GetSnapshot();
+        Snapshot cleared(request, searchText);
+        cleared.startTicks = previous->startTicks;
+        cleared.durationMs = previous->durationMs;
+        m_results.Publish(std::move(cleared));
+    }
+
+    static constexpr int32_t c_unexpectedError = static_cast<int32_t>(0x8000FFFF); // E_UNEXPECTED
+
+    Query m_query;
+    std::shared_ptr<ISearchClock> m_clock;
+
+    mutable details::ContentionTrackingMutex m_mutex;
+    std::condition_variable_any m_cv;
+    std::wstring m_searchText;
+    bool m_shouldStop = false;
+
+    // Revisions of m_searchText and when the next query is due (guarded by m_mutex; the
+    // revision is also read without it)
+    Debouncer m_debounce;
+
+    // Results and query timing, published together for lock-free readers
+    ResultPublisher<Result> m_results;
+    std::atomic<size_t> m_executedQueryCount{ 0 };
+
+    std::thread m_debounceThread;
+};
+
+} // namespace wsearch
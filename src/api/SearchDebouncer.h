@@ -0,0 +1,102 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace wsearch
+{
+
+/* Debouncer - decides when a search-as-you-type query runs
+ *
+ * Numbers every change of the search text (its revision) and says when the query for the
+ * latest revision is due: 'delay' after the last change, unless a query for it already
+ * started. It never reads a clock; the caller passes its clock's time, so a session and a
+ * virtual-time simulator run the very same policy. Not thread-safe: sessions call it under
+ * their mutex, except GetRevision, which may be called from any thread.
+ *
+ * Example:
+ *   wsearch::Debouncer debounce(std::chrono::milliseconds(50));
+ *   debounce.OnChanged(start);                                   // revision 1
+ *   debounce.TryDispatch(start + std::chrono::milliseconds(20)); // 0: not due yet
+ *   debounce.OnChanged(start + std::chrono::milliseconds(20));   // revision 2, due at +70ms
+ *   debounce.TryDispatch(start + std::chrono::milliseconds(70)); // 2: run the query for it
+ */
+class Debouncer
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit Debouncer(Clock::duration delay)
+        : m_delay(delay)
+    {
+    }
+
+    Clock::duration GetDelay() const
+    {
+        return m_delay;
+    }
+
+    // Also moves the deadline of a pending revision
+    void SetDelay(Clock::duration delay)
+    {
+        m_delay = delay;
+    }
+
+    // The text changed at 'now'; returns its revision
+    uint64_t OnChanged(Clock::time_point now)
+    {
+        m_lastChange = now;
+        return m_revision.fetch_add(1) + 1;
+    }
+
+    // The text must be searched again without waiting out the delay (the scopes changed)
+    uint64_t OnChangedDueNow(Clock::time_point now)
+    {
+        return OnChanged(now - m_delay);
+    }
+
+    // A query for the latest revision started without waiting (ExecuteQueryNow), or none is
+    // wanted (Clear); returns that revision
+    uint64_t Dispatch()
+    {
+        m_dispatched = m_revision.load();
+        return m_dispatched;
+    }
+
+    // The revision whose query should start at 'now', marked as started, or 0 if none is due
+    uint64_t TryDispatch(Clock::time_point now)
+    {
+        if (!IsPending() || now < GetDeadline())
+        {
+            return 0;
+        }
+        return Dispatch();
+    }
+
+    // Whether the latest revision still waits for its query to start
+    bool IsPending() const
+    {
+        return m_revision.load() > m_dispatched;
+    }
+
+    // When the pending revision's query is due
+    Clock::time_point GetDeadline() const
+    {
+        return m_lastChange + m_delay;
+    }
+
+    uint64_t GetRevision() const
+    {
+        return m_revision.load();
+    }
+
+private:
+    Clock::duration m_delay;
+    Clock::time_point m_lastChange{};
+    std::atomic<uint64_t> m_revision{ 0 };
+    uint64_t m_dispatched = 0;
+};
+
+} // namespace wsearch
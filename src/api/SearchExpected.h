@@ -0,0 +1,150 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace wsearch
+{
+
+/* SearchError - why a Try* call failed
+ *
+ * 'code' is the failing HRESULT. 'operation' names the step that returned it (e.g.
+ * L"ICommandText::Execute") and always points to a string literal, so errors are cheap to
+ * create and copy on paths where failures are routine.
+ */
+struct SearchError
+{
+    int32_t code = 0;
+    const wchar_t* operation = L"";
+};
+
+/* SearchExpected - a value or the SearchError that prevented it (std::expected for C++20)
+ *
+ * The Try* functions return these instead of throwing, so search-as-you-type can drop a
+ * cancelled or failed query without unwinding. The throwing API wraps the Try* functions and
+ * throws the carried HRESULT.
+ *
+ * Example:
+ *   auto rowset = wsearch::details::TryExecuteQuery(sql);
+ *   if (!rowset)
+ *   {
+ *       LogError(L"%ls failed (0x%08X)", rowset.Error().operation, rowset.Error().code);
+ *       return;
+ *   }
+ *   Use(*rowset);
+ */
+template <typename T>
+class SearchExpected
+{
+public:
+    SearchExpected(T value)
+        : m_storage(std::in_place_index<0>, std::move(value))
+    {
+    }
+
+    SearchExpected(SearchError error)
+        : m_storage(std::in_place_index<1>, error)
+    {
+    }
+
+    bool HasValue() const noexcept
+    {
+        return m_storage.index() == 0;
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return HasValue();
+    }
+
+    // Only valid when HasValue()
+    T& operator*() & noexcept
+    {
+        return *std::get_if<0>(&m_storage);
+    }
+
+    const T& operator*() const& noexcept
+    {
+        return *std::get_if<0>(&m_storage);
+    }
+
+    T&& operator*() && noexcept
+    {
+        return std::move(*std::get_if<0>(&m_storage));
+    }
+
+    T* operator->() noexcept
+    {
+        return std::get_if<0>(&m_storage);
+    }
+
+    const T* operator->() const noexcept
+    {
+        return std::get_if<0>(&m_storage);
+    }
+
+    // Only valid when !HasValue()
+    const SearchError& Error() const noexcept
+    {
+        return *std::get_if<1>(&m_storage);
+    }
+
+    template <typename U>
+    T ValueOr(U&& fallback) const&
+    {
+        return HasValue() ? **this : static_cast<T>(std::forward<U>(fallback));
+    }
+
+private:
+    std::variant<T, SearchError> m_storage;
+};
+
+template <>
+class SearchExpected<void>
+{
+public:
+    SearchExpected() = default;
+
+    SearchExpected(SearchError error)
+        : m_error(error)
+        , m_failed(true)
+    {
+    }
+
+    bool HasValue() const noexcept
+    {
+        return !m_failed;
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return HasValue();
+    }
+
+    const SearchError& Error() const noexcept
+    {
+        return m_error;
+    }
+
+private:
+    SearchError m_error;
+    bool m_failed = false;
+};
+
+namespace details
+{
+    // HRESULT -> SearchExpected<void>, for chaining COM calls without throwing
+    inline SearchExpected<void> CheckHResult(int32_t hr, const wchar_t* operation) noexcept
+    {
+        if (hr < 0)
+        {
+            return SearchError{ hr, operation };
+        }
+        return {};
+    }
+} // namespace details
+
+} // namespace wsearch
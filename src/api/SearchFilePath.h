@@ -0,0 +1,274 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define WSEARCH_FILE_URL_SSE2 1
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+/* File URL decoding
+ *
+ * The indexer reports System.ItemUrl as a file URL ("file:C:/Users/Me/a%20b.txt"). These
+ * helpers turn one into a filesystem path in a single pass: the "file:" prefix is dropped,
+ * slashes become backslashes and %XX escapes are decoded, with runs of escaped UTF-8 bytes
+ * reassembled into the characters they encode. Escape-free runs are copied eight characters
+ * at a time with SSE2 where it is available.
+ *
+ * Prefixes: "file:///C:/x" and "file://C:/x" and "file:C:/x" give "C:\x";
+ * "file://server/share/x" gives "\\server\share\x". Text without the prefix is converted as is.
+ * Escapes that are not valid UTF-8 decode one byte to one character (U+0000-U+00FF), as the
+ * old decoders did; '%' not followed by two hex digits is kept literally.
+ * The path is never longer than the URL.
+ */
+namespace wsearch
+{
+
+namespace details
+{
+    inline int HexDigitValue(wchar_t ch)
+    {
+        if (ch >= L'0' && ch <= L'9') return ch - L'0';
+        if (ch >= L'a' && ch <= L'f') return ch - L'a' + 10;
+        if (ch >= L'A' && ch <= L'F') return ch - L'A' + 10;
+        return -1;
+    }
+
+    // The byte of the "%XX" escape at url[index], or -1
+    inline int EscapedByteAt(std::wstring_view url, size_t index)
+    {
+        if (index + 2 >= url.size() || url[index] != L'%')
+        {
+            return -1;
+        }
+        int high = HexDigitValue(url[index + 1]);
+        int low = HexDigitValue(url[index + 2]);
+        return (high < 0 || low < 0) ? -1 : ((high << 4) | low);
+    }
+
+    // Writes a code point as one wchar_t, or as a surrogate pair where wchar_t is UTF-16
+    inline wchar_t* PutCodePoint(wchar_t* out, uint32_t codePoint)
+    {
+        if constexpr (sizeof(wchar_t) == 2)
+        {
+            if (codePoint >= 0x10000)
+            {
+                codePoint -= 0x10000;
+                *out++ = static_cast<wchar_t>(0xD800 + (codePoint >> 10));
+                *out++ = static_cast<wchar_t>(0xDC00 + (codePoint & 0x3FF));
+                return out;
+            }
+        }
+        *out++ = static_cast<wchar_t>(codePoint);
+        return out;
+    }
+
+    // Decodes the escape at url[index] and any continuation escapes of the UTF-8 sequence it
+    // starts; returns the number of URL characters consumed (0 if url[index] is not an escape)
+    inline size_t DecodeEscapeAt(std::wstring_view url, size_t index, wchar_t*& out)
+    {
+        int lead = EscapedByteAt(url, index);
+        if (lead < 0)
+        {
+            return 0;
+        }
+
+        // Sequence length and the valid range of the second byte, which rules out overlong
+        // forms, surrogates and code points past U+10FFFF
+        size_t length = 1;
+        int secondMin = 0x80;
+        int secondMax = 0xBF;
+        uint32_t codePoint = static_cast<uint32_t>(lead);
+        if (lead >= 0xC2 && lead <= 0xDF)
+        {
+            length = 2;
+            codePoint = lead & 0x1F;
+        }
+        else if (lead >= 0xE0 && lead <= 0xEF)
+        {
+            length = 3;
+            codePoint = lead & 0x0F;
+            secondMin = (lead == 0xE0) ? 0xA0 : 0x80;
+            secondMax = (lead == 0xED) ? 0x9F : 0xBF;
+        }
+        else if (lead >= 0xF0 && lead <= 0xF4)
+        {
+            length = 4;
+            codePoint = lead & 0x07;
+            secondMin = (lead == 0xF0) ? 0x90 : 0x80;
+            secondMax = (lead == 0xF4) ? 0x8F : 0xBF;
+        }
+
+        for (size_t i = 1; i < length; ++i)
+        {
+            int next = EscapedByteAt(url, index + i * 3);
+            int min = (i == 1) ? secondMin : 0x80;
+            int max = (i == 1) ? secondMax : 0xBF;
+            if (next < min || next > max)
+            {
+                // Not UTF-8: the lead byte on its own
+                out = PutCodePoint(out, static_cast<uint32_t>(lead));
+                return 3;
+            }
+            codePoint = (codePoint << 6) | static_cast<uint32_t>(next & 0x3F);
+        }
+
+        out = PutCodePoint(out, codePoint);
+        return length * 3;
+    }
+
+    // Length of the prefix to drop; for "file://server/..." only "file:" goes, leaving a UNC path
+    inline size_t FileUrlPrefixLength(std::wstring_view url)
+    {
+        static constexpr std::wstring_view protocol = L"file:";
+        if (url.size() < protocol.size())
+        {
+            return 0;
+        }
+        for (size_t i = 0; i < protocol.size(); ++i)
+        {
+            wchar_t ch = url[i];
+            if (((ch >= L'A' && ch <= L'Z') ? static_cast<wchar_t>(ch + (L'a' - L'A')) : ch) != protocol[i])
+            {
+                return 0;
+            }
+        }
+
+        // Plain comparisons: this runs for every result row
+        auto at = [url](size_t index) { return (index < url.size()) ? url[index] : L'\0'; };
+        if (at(5) == L'/' && at(6) == L'/')
+        {
+            if (at(7) == L'/')
+            {
+                return protocol.size() + 3;
+            }
+
+            // "file://C:/x" is a local path; anything else names a server
+            wchar_t drive = at(7);
+            bool isDrive = ((drive >= L'A' && drive <= L'Z') || (drive >= L'a' && drive <= L'z')) && (at(8) == L':' || at(8) == L'|');
+            return protocol.size() + (isDrive ? 2 : 0);
+        }
+        return protocol.size();
+    }
+
+#if defined(WSEARCH_FILE_URL_SSE2)
+    inline unsigned CountTrailingZeros(unsigned mask)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return index;
+#else
+        return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+    }
+
+    // Copies url[index...] to 'out' with slashes converted until the next '%', 16 bytes at a
+    // time; returns how many characters were copied. The block holding the '%' is stored too,
+    // which stays inside the output because the output never runs ahead of the input.
+    inline size_t CopyUntilEscapeSse2(const wchar_t* in, size_t count, wchar_t* out)
+    {
+        constexpr size_t unitsPerBlock = 16 / sizeof(wchar_t);
+        size_t copied = 0;
+        while (copied + unitsPerBlock <= count)
+        {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + copied));
+            __m128i percent;
+            __m128i slash;
+            if constexpr (sizeof(wchar_t) == 2)
+            {
+                percent = _mm_cmpeq_epi16(block, _mm_set1_epi16(L'%'));
+                slash = _mm_cmpeq_epi16(block, _mm_set1_epi16(L'/'));
+                block = _mm_or_si128(_mm_andnot_si128(slash, block), _mm_and_si128(slash, _mm_set1_epi16(L'\\')));
+            }
+            else
+            {
+                percent = _mm_cmpeq_epi32(block, _mm_set1_epi32(L'%'));
+                slash = _mm_cmpeq_epi32(block, _mm_set1_epi32(L'/'));
+                block = _mm_or_si128(_mm_andnot_si128(slash, block), _mm_and_si128(slash, _mm_set1_epi32(L'\\')));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + copied), block);
+
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(percent));
+            if (mask != 0)
+            {
+                return copied + CountTrailingZeros(mask) / sizeof(wchar_t);
+            }
+            copied += unitsPerBlock;
+        }
+        return copied;
+    }
+#endif
+} // namespace details
+
+/* DecodeFileUrl - converts a file URL to a path in a caller buffer
+ *
+ * 'path' must have room for url.size() characters; returns the length of the path written
+ * (not null-terminated).
+ *
+ * Example:
+ *   std::vector<wchar_t> buffer(url.size());
+ *   std::wstring_view path(buffer.data(), wsearch::DecodeFileUrl(url, buffer.data()));
+ */
+inline size_t DecodeFileUrl(std::wstring_view url, wchar_t* path)
+{
+    size_t prefix = details::FileUrlPrefixLength(url);
+    const wchar_t* in = url.data();
+    wchar_t* out = path;
+    size_t index = prefix;
+    while (index < url.size())
+    {
+#if defined(WSEARCH_FILE_URL_SSE2)
+        size_t copied = details::CopyUntilEscapeSse2(in + index, url.size() - index, out);
+        index += copied;
+        out += copied;
+#endif
+        while (index < url.size() && in[index] != L'%')
+        {
+            wchar_t ch = in[index++];
+            *out++ = (ch == L'/') ? L'\\' : ch;
+        }
+        if (index < url.size())
+        {
+            size_t consumed = details::DecodeEscapeAt(url, index, out);
+            if (consumed == 0)
+            {
+                *out++ = L'%';
+                consumed = 1;
+            }
+            index += consumed;
+        }
+    }
+    return static_cast<size_t>(out - path);
+}
+
+/* AppendFilePathFromUrl - appends the path of a file URL to a string of any allocator
+ *
+ * Example:
+ *   std::pmr::wstring path(arena.Resource());
+ *   wsearch::AppendFilePathFromUrl(path, result.GetPath());
+ */
+template <typename String>
+void AppendFilePathFromUrl(String& out, std::wstring_view url)
+{
+    size_t start = out.size();
+    out.resize(start + url.size());
+    out.resize(start + DecodeFileUrl(url, out.data() + start));
+}
+
+// The path of a file URL, e.g. L"file:C:/Users/Me/a%20b.txt" -> L"C:\\Users\\Me\\a b.txt"
+inline std::wstring FileUrlToPath(std::wstring_view url)
+{
+    std::wstring path;
+    AppendFilePathFromUrl(path, url);
+    return path;
+}
+
+} // namespace wsearch
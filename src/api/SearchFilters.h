@@ -0,0 +1,1085 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include "SearchResultColumns.h"
+#include "SearchResultOrdering.h"
+#include "SearchSqlEscape.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cwchar>
+#include <cwctype>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/* Structured filters
+ *
+ * Search text such as "kind:image ext:png size:>10MB modified:lastweek report" is split by
+ * ParseSearchFilters into typed predicates and the remaining free text. FilterPlanner decides per
+ * predicate whether it goes into the SQL WHERE clause (SearchQueryBuilder::WithFilters) or is
+ * evaluated client-side over decoded columns (EvaluateFilters over a ResultBatch):
+ *   - selective predicates are pushed, so the indexer does not transfer rows that are dropped;
+ *   - predicates that keep most rows stay client-side, so toggling them does not change the
+ *     query, as long as TOP N would not have to grow by more than the policy allows to cover them;
+ *   - when the unfiltered rows are already cached, everything is evaluated over the cache.
+ */
+namespace wsearch
+{
+
+enum class FilterField : uint8_t
+{
+    Kind,         // kind:picture,video                System.Kind
+    Extension,    // ext:png                           System.FileExtension
+    Size,         // size:>10MB, size:1MB..5MB, size:large   System.Size
+    DateModified, // modified:lastweek, modified:>2024-01-31 System.DateModified
+    DateCreated,  // created:2024-01-01..2024-01-31    System.DateCreated
+};
+
+struct FilterPredicate
+{
+    FilterField field = FilterField::Kind;
+    bool negated = false;             // -ext:tmp
+    std::vector<std::wstring> values; // Kind and Extension: lowercase alternatives, extensions with their dot
+    // Size and dates: low <= value < high, in bytes or FILETIME ticks (UTC)
+    int64_t low = (std::numeric_limits<int64_t>::min)();
+    int64_t high = (std::numeric_limits<int64_t>::max)();
+    std::wstring text;                // the filter as typed
+
+    PropertyId GetProperty() const
+    {
+        switch (field)
+        {
+        case FilterField::Kind: return propid::Kind;
+        case FilterField::Extension: return propid::FileExtension;
+        case FilterField::Size: return propid::Size;
+        case FilterField::DateModified: return propid::DateModified;
+        default: return propid::DateCreated;
+        }
+    }
+
+    bool IsRange() const
+    {
+        return field != FilterField::Kind && field != FilterField::Extension;
+    }
+};
+
+struct FilterParseOptions
+{
+    uint64_t nowTicks = 0;        // FILETIME "now" for today, lastweek, ...; 0 reads the system clock
+    int32_t utcOffsetMinutes = 0; // local time zone, so that "today" starts at local midnight
+};
+
+struct ParsedFilters
+{
+    std::vector<FilterPredicate> predicates;
+    std::wstring searchText;           // the text without its filters, for WithSearchText
+    std::vector<std::wstring> invalid; // filters whose value did not parse, dropped (e.g. "size:>abc", "kind:")
+};
+
+namespace details
+{
+    constexpr int64_t c_ticksPerMinute = 600000000;
+
+    inline std::wstring FoldFilterText(std::wstring_view text)
+    {
+        std::wstring folded(text);
+        for (auto& ch : folded)
+        {
+            ch = static_cast<wchar_t>(std::towlower(ch));
+        }
+        return folded;
+    }
+
+    inline bool FilterTextEquals(std::wstring_view left, std::wstring_view right)
+    {
+        if (left.size() != right.size())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < left.size(); ++i)
+        {
+            if (left[i] != right[i] && std::towlower(left[i]) != std::towlower(right[i]))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    inline bool ParseFilterName(std::wstring_view name, FilterField& field)
+    {
+        static constexpr struct
+        {
+            std::wstring_view name;
+            FilterField field;
+        } names[] = {
+            { L"kind", FilterField::Kind },
+            { L"ext", FilterField::Extension },
+            { L"extension", FilterField::Extension },
+            { L"size", FilterField::Size },
+            { L"modified", FilterField::DateModified },
+            { L"datemodified", FilterField::DateModified },
+            { L"date", FilterField::DateModified },
+            { L"created", FilterField::DateCreated },
+            { L"datecreated", FilterField::DateCreated },
+        };
+        for (const auto& entry : names)
+        {
+            if (FilterTextEquals(name, entry.name))
+            {
+                field = entry.field;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // The System.Kind values, with the share of a typical index each one makes up
+    struct KindShare
+    {
+        std::wstring_view kind;
+        double share;
+    };
+
+    inline constexpr KindShare c_kindShares[] = {
+        { L"calendar", 0.002 }, { L"communication", 0.005 }, { L"contact", 0.005 }, { L"document", 0.35 },
+        { L"email", 0.05 }, { L"feed", 0.001 }, { L"folder", 0.12 }, { L"game", 0.001 },
+        { L"instantmessage", 0.001 }, { L"journal", 0.001 }, { L"link", 0.02 }, { L"movie", 0.005 },
+        { L"music", 0.06 }, { L"note", 0.005 }, { L"picture", 0.18 }, { L"playlist", 0.002 },
+        { L"program", 0.04 }, { L"recordedtv", 0.001 }, { L"searchfolder", 0.001 }, { L"task", 0.002 },
+        { L"video", 0.03 }, { L"webhistory", 0.01 },
+    };
+
+    // Canonical System.Kind value for what users type, or empty
+    inline std::wstring_view CanonicalKind(std::wstring_view value)
+    {
+        static constexpr std::wstring_view aliases[][2] = {
+            { L"image", L"picture" }, { L"photo", L"picture" }, { L"pic", L"picture" }, { L"doc", L"document" },
+            { L"audio", L"music" }, { L"song", L"music" }, { L"app", L"program" }, { L"application", L"program" },
+            { L"mail", L"email" }, { L"dir", L"folder" }, { L"directory", L"folder" }, { L"shortcut", L"link" },
+        };
+
+        // Plurals: kind:pictures, kind:images
+        for (std::wstring_view candidate : { value, value.substr(0, value.empty() ? 0 : value.size() - 1) })
+        {
+            if (candidate.empty() || (candidate.size() != value.size() && value.back() != L's'))
+            {
+                continue;
+            }
+            for (const auto& entry : c_kindShares)
+            {
+                if (FilterTextEquals(candidate, entry.kind))
+                {
+                    return entry.kind;
+                }
+            }
+            for (const auto& alias : aliases)
+            {
+                if (FilterTextEquals(candidate, alias[0]))
+                {
+                    return alias[1];
+                }
+            }
+        }
+        return {};
+    }
+
+    inline bool IsExtensionChar(wchar_t ch)
+    {
+        return (ch >= L'a' && ch <= L'z') || (ch >= L'A' && ch <= L'Z') || (ch >= L'0' && ch <= L'9') ||
+            ch == L'_' || ch == L'-' || ch == L'+' || ch == L'~' || ch == L'$' || ch == L'#' || ch == L'!' || ch > 0x7F;
+    }
+
+    // Calls visitor(std::wstring_view item) for each comma-separated item; false if one is empty
+    template <typename Visitor>
+    bool ForEachFilterItem(std::wstring_view value, Visitor&& visitor)
+    {
+        while (true)
+        {
+            size_t comma = value.find(L',');
+            std::wstring_view item = value.substr(0, comma);
+            if (item.empty() || !visitor(item))
+            {
+                return false;
+            }
+            if (comma == std::wstring_view::npos)
+            {
+                return true;
+            }
+            value.remove_prefix(comma + 1);
+        }
+    }
+
+    inline bool ParseKindValue(std::wstring_view value, FilterPredicate& predicate)
+    {
+        return ForEachFilterItem(value, [&](std::wstring_view item) {
+            std::wstring_view kind = CanonicalKind(item);
+            if (!kind.empty())
+            {
+                predicate.values.emplace_back(kind);
+            }
+            return !kind.empty();
+        });
+    }
+
+    inline bool ParseExtensionValue(std::wstring_view value, FilterPredicate& predicate)
+    {
+        return ForEachFilterItem(value, [&](std::wstring_view item) {
+            if (item.front() == L'.')
+            {
+                item.remove_prefix(1);
+            }
+            if (item.empty() || !std::all_of(item.begin(), item.end(), IsExtensionChar))
+            {
+                return false;
+            }
+            predicate.values.push_back(L"." + FoldFilterText(item));
+            return true;
+        });
+    }
+
+    // "10MB", "1.5gb", "512" (bytes); binary units, as Explorer shows sizes
+    inline bool ParseByteCount(std::wstring_view text, int64_t& bytes)
+    {
+        size_t index = 0;
+        double number = 0.0;
+        bool digits = false;
+        for (; index < text.size() && text[index] >= L'0' && text[index] <= L'9'; ++index)
+        {
+            number = number * 10.0 + (text[index] - L'0');
+            digits = true;
+        }
+        if (index < text.size() && text[index] == L'.')
+        {
+            double scale = 0.1;
+            for (++index; index < text.size() && text[index] >= L'0' && text[index] <= L'9'; ++index)
+            {
+                number += (text[index] - L'0') * scale;
+                scale /= 10.0;
+                digits = true;
+            }
+        }
+        if (!digits)
+        {
+            return false;
+        }
+
+        static constexpr struct
+        {
+            std::wstring_view unit;
+            double multiplier;
+        } units[] = {
+            { L"", 1.0 }, { L"b", 1.0 }, { L"k", 1024.0 }, { L"kb", 1024.0 }, { L"m", 1048576.0 }, { L"mb", 1048576.0 },
+            { L"g", 1073741824.0 }, { L"gb", 1073741824.0 }, { L"t", 1099511627776.0 }, { L"tb", 1099511627776.0 },
+        };
+        for (const auto& entry : units)
+        {
+            if (FilterTextEquals(text.substr(index), entry.unit))
+            {
+                double value = number * entry.multiplier;
+                if (value >= 4.0e18)
+                {
+                    return false;
+                }
+                bytes = static_cast<int64_t>(value);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Days since 1970-01-01 of a proleptic Gregorian date
+    inline int64_t DaysFromCivil(int64_t year, unsigned month, unsigned day)
+    {
+        year -= month <= 2 ? 1 : 0;
+        int64_t era = (year >= 0 ? year : year - 399) / 400;
+        unsigned yearOfEra = static_cast<unsigned>(year - era * 400);
+        unsigned dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+        unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+        return era * 146097 + static_cast<int64_t>(dayOfEra) - 719468;
+    }
+
+    inline void CivilFromDays(int64_t days, int64_t& year, unsigned& month, unsigned& day)
+    {
+        days += 719468;
+        int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+        unsigned dayOfEra = static_cast<unsigned>(days - era * 146097);
+        unsigned yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+        unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+        unsigned shiftedMonth = (5 * dayOfYear + 2) / 153;
+        day = dayOfYear - (153 * shiftedMonth + 2) / 5 + 1;
+        month = shiftedMonth < 10 ? shiftedMonth + 3 : shiftedMonth - 9;
+        year = static_cast<int64_t>(yearOfEra) + era * 400 + (month <= 2 ? 1 : 0);
+    }
+
+    // Local day numbers (days since 1970-01-01 in the caller's time zone) and FILETIME ticks
+    inline int64_t LocalDayFromTicks(uint64_t ticks, int32_t utcOffsetMinutes)
+    {
+        int64_t local = static_cast<int64_t>(ticks - c_unixEpochTicks) + utcOffsetMinutes * c_ticksPerMinute;
+        int64_t day = local / static_cast<int64_t>(c_ticksPerDay);
+        return (local < 0 && local % static_cast<int64_t>(c_ticksPerDay) != 0) ? day - 1 : day;
+    }
+
+    inline int64_t TicksFromLocalDay(int64_t day, int32_t utcOffsetMinutes)
+    {
+        return static_cast<int64_t>(c_unixEpochTicks) + day * static_cast<int64_t>(c_ticksPerDay) - utcOffsetMinutes * c_ticksPerMinute;
+    }
+
+    // "2024-01-31" or "2024/01/31"
+    inline bool ParseFilterDate(std::wstring_view text, int64_t& day)
+    {
+        if (text.size() != 10 || (text[4] != L'-' && text[4] != L'/') || text[7] != text[4])
+        {
+            return false;
+        }
+        unsigned parts[3] = {};
+        size_t ranges[3][2] = { { 0, 4 }, { 5, 7 }, { 8, 10 } };
+        for (size_t part = 0; part < 3; ++part)
+        {
+            for (size_t i = ranges[part][0]; i < ranges[part][1]; ++i)
+            {
+                if (text[i] < L'0' || text[i] > L'9')
+                {
+                    return false;
+                }
+                parts[part] = parts[part] * 10 + (text[i] - L'0');
+            }
+        }
+        static constexpr unsigned monthDays[] = { 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+        if (parts[0] < 1601 || parts[1] < 1 || parts[1] > 12 || parts[2] < 1 || parts[2] > monthDays[parts[1] - 1])
+        {
+            return false;
+        }
+        day = DaysFromCivil(parts[0], parts[1], parts[2]);
+        // 29 February of a non-leap year
+        int64_t year = 0;
+        unsigned month = 0;
+        unsigned dayOfMonth = 0;
+        CivilFromDays(day, year, month, dayOfMonth);
+        return month == parts[1];
+    }
+
+    // Named periods relative to today, as [first day, day after the last)
+    inline bool ParseRelativeDays(std::wstring_view text, int64_t today, int64_t& first, int64_t& end)
+    {
+        int64_t year = 0;
+        unsigned month = 0;
+        unsigned day = 0;
+        CivilFromDays(today, year, month, day);
+        int64_t monday = today - ((today + 3) % 7 + 7) % 7; // 1970-01-01 was a Thursday
+
+        if (FilterTextEquals(text, L"today")) { first = today; end = today + 1; }
+        else if (FilterTextEquals(text, L"yesterday")) { first = today - 1; end = today; }
+        else if (FilterTextEquals(text, L"thisweek")) { first = monday; end = monday + 7; }
+        else if (FilterTextEquals(text, L"lastweek")) { first = monday - 7; end = monday; }
+        else if (FilterTextEquals(text, L"thismonth")) { first = DaysFromCivil(year, month, 1); end = DaysFromCivil(month == 12 ? year + 1 : year, month % 12 + 1, 1); }
+        else if (FilterTextEquals(text, L"lastmonth")) { first = DaysFromCivil(month == 1 ? year - 1 : year, month == 1 ? 12 : month - 1, 1); end = DaysFromCivil(year, month, 1); }
+        else if (FilterTextEquals(text, L"thisyear")) { first = DaysFromCivil(year, 1, 1); end = DaysFromCivil(year + 1, 1, 1); }
+        else if (FilterTextEquals(text, L"lastyear")) { first = DaysFromCivil(year - 1, 1, 1); end = DaysFromCivil(year, 1, 1); }
+        else { return false; }
+        return true;
+    }
+
+    // Splits ">=x", ">x", "<=x", "<x", "=x", "a..b" or "x" into bounds given how to read one
+    // value as [first, end); true if the value parsed
+    template <typename ParseOne>
+    bool ParseRangeValue(std::wstring_view value, ParseOne&& parseOne, int64_t& low, int64_t& high)
+    {
+        int64_t first = 0;
+        int64_t end = 0;
+        size_t dots = value.find(L"..");
+        if (dots != std::wstring_view::npos)
+        {
+            int64_t lastFirst = 0;
+            if (!parseOne(value.substr(0, dots), first, end) || !parseOne(value.substr(dots + 2), lastFirst, end))
+            {
+                return false;
+            }
+            low = first;
+            high = end;
+            return low < high;
+        }
+
+        std::wstring_view op;
+        for (std::wstring_view candidate : { L">=", L"<=", L">", L"<", L"=" })
+        {
+            if (value.substr(0, candidate.size()) == candidate)
+            {
+                op = candidate;
+                break;
+            }
+        }
+        if (!parseOne(value.substr(op.size()), first, end))
+        {
+            return false;
+        }
+        if (op == L">=") { low = first; }
+        else if (op == L">") { low = end; }
+        else if (op == L"<=") { high = end; }
+        else if (op == L"<") { high = first; }
+        else { low = first; high = end; }
+        return true;
+    }
+
+    inline bool ParseSizeValue(std::wstring_view value, FilterPredicate& predicate)
+    {
+        // Explorer's size groups
+        static constexpr struct
+        {
+            std::wstring_view name;
+            int64_t low;
+            int64_t high;
+        } presets[] = {
+            { L"empty", 0, 1 },
+            { L"tiny", 1, 16ll << 10 },
+            { L"small", 16ll << 10, 1ll << 20 },
+            { L"medium", 1ll << 20, 128ll << 20 },
+            { L"large", 128ll << 20, 1ll << 30 },
+            { L"huge", 1ll << 30, 4ll << 30 },
+            { L"gigantic", 4ll << 30, (std::numeric_limits<int64_t>::max)() },
+        };
+        for (const auto& preset : presets)
+        {
+            if (FilterTextEquals(value, preset.name))
+            {
+                predicate.low = preset.low;
+                predicate.high = preset.high;
+                return true;
+            }
+        }
+
+        return ParseRangeValue(value, [](std::wstring_view text, int64_t& first, int64_t& end) {
+            if (!ParseByteCount(text, first))
+            {
+                return false;
+            }
+            end = first + 1;
+            return true;
+        }, predicate.low, predicate.high);
+    }
+
+    inline bool ParseDateValue(std::wstring_view value, const FilterParseOptions& options, FilterPredicate& predicate)
+    {
+        uint64_t now = options.nowTicks ? options.nowTicks : CurrentFileTimeTicks();
+        int64_t today = LocalDayFromTicks(now, options.utcOffsetMinutes);
+        int64_t firstDay = 0;
+        int64_t endDay = 0;
+        bool parsed = ParseRelativeDays(value, today, firstDay, endDay) ||
+            ParseRangeValue(value, [](std::wstring_view text, int64_t& first, int64_t& end) {
+                if (!ParseFilterDate(text, first))
+                {
+                    return false;
+                }
+                end = first + 1;
+                return true;
+            }, firstDay, endDay);
+        if (!parsed)
+        {
+            return false;
+        }
+
+        // Unbounded sides came back as the int64 limits; only real days become ticks
+        bool hasLow = value.find(L"..") != std::wstring_view::npos || value.front() != L'<';
+        bool hasHigh = value.find(L"..") != std::wstring_view::npos || value.front() != L'>';
+        if (hasLow)
+        {
+            predicate.low = TicksFromLocalDay(firstDay, options.utcOffsetMinutes);
+        }
+        if (hasHigh)
+        {
+            predicate.high = TicksFromLocalDay(endDay, options.utcOffsetMinutes);
+        }
+        return true;
+    }
+
+    inline bool ParseFilterValue(std::wstring_view value, const FilterParseOptions& options, FilterPredicate& predicate)
+    {
+        if (value.size() >= 2 && value.front() == L'"' && value.back() == L'"')
+        {
+            value = value.substr(1, value.size() - 2);
+        }
+        if (value.empty())
+        {
+            return false;
+        }
+        switch (predicate.field)
+        {
+        case FilterField::Kind: return ParseKindValue(value, predicate);
+        case FilterField::Extension: return ParseExtensionValue(value, predicate);
+        case FilterField::Size: return ParseSizeValue(value, predicate);
+        default: return ParseDateValue(value, options, predicate);
+        }
+    }
+
+    // 'YYYY/MM/DD hh:mm:ss', the UTC date literal form Windows Search SQL compares FILETIMEs with
+    template <typename String>
+    void AppendFilterDate(String& out, int64_t ticks)
+    {
+        int64_t sinceEpoch = ticks - static_cast<int64_t>(c_unixEpochTicks);
+        int64_t days = sinceEpoch / static_cast<int64_t>(c_ticksPerDay);
+        int64_t rest = sinceEpoch % static_cast<int64_t>(c_ticksPerDay);
+        if (rest < 0)
+        {
+            --days;
+            rest += static_cast<int64_t>(c_ticksPerDay);
+        }
+        int64_t year = 0;
+        unsigned month = 0;
+        unsigned day = 0;
+        CivilFromDays(days, year, month, day);
+        int64_t seconds = rest / 10000000;
+
+        wchar_t literal[32];
+        int length = swprintf(literal, 32, L"'%04lld/%02u/%02u %02lld:%02lld:%02lld'", static_cast<long long>(year), month, day,
+            static_cast<long long>(seconds / 3600), static_cast<long long>(seconds / 60 % 60), static_cast<long long>(seconds % 60));
+        out.append(literal, static_cast<size_t>(length));
+    }
+
+    template <typename String>
+    void AppendFilterBound(String& out, const FilterPredicate& predicate, const wchar_t* op, int64_t bound)
+    {
+        AppendPropertyName(out, c_wellKnownProperties[predicate.GetProperty()].name);
+        out.append(op);
+        if (predicate.field == FilterField::Size)
+        {
+            std::wstring number = std::to_wstring(bound);
+            out.append(number.data(), number.size());
+        }
+        else
+        {
+            AppendFilterDate(out, bound);
+        }
+    }
+
+    // One predicate as a parenthesized SQL condition
+    template <typename String>
+    void AppendFilterCondition(String& out, const FilterPredicate& predicate)
+    {
+        out.append(predicate.negated ? L"NOT (" : L"(");
+        if (predicate.IsRange())
+        {
+            bool hasLow = predicate.low != (std::numeric_limits<int64_t>::min)();
+            bool hasHigh = predicate.high != (std::numeric_limits<int64_t>::max)();
+            if (hasLow)
+            {
+                AppendFilterBound(out, predicate, L" >= ", predicate.low);
+            }
+            if (hasHigh)
+            {
+                out.append(hasLow ? L" AND " : L"");
+                AppendFilterBound(out, predicate, L" < ", predicate.high);
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < predicate.values.size(); ++i)
+            {
+                out.append(i == 0 ? L"" : L" OR ");
+                AppendPropertyName(out, c_wellKnownProperties[predicate.GetProperty()].name);
+                out.append(L" = '");
+                AppendEscapedSqlText(out, predicate.values[i]);
+                out.push_back(L'\'');
+            }
+        }
+        out.push_back(L')');
+    }
+
+    // Missing values never match, negated or not, as with SQL NULLs
+    inline bool FilterMatchesNumber(const FilterPredicate& predicate, int64_t value)
+    {
+        if (value == c_missingNumber)
+        {
+            return false;
+        }
+        return (predicate.low <= value && value < predicate.high) != predicate.negated;
+    }
+
+    inline bool FilterMatchesText(const FilterPredicate& predicate, std::wstring_view value)
+    {
+        if (value.empty())
+        {
+            return false;
+        }
+        bool matched = std::any_of(predicate.values.begin(), predicate.values.end(),
+            [value](const std::wstring& alternative) { return FilterTextEquals(alternative, value); });
+        return matched != predicate.negated;
+    }
+
+    // Share of files at most 'bytes' large, from a log-scale size distribution
+    inline double SizeCumulativeShare(int64_t bytes)
+    {
+        static constexpr double points[][2] = {
+            { 0.0, 0.02 }, { 1024.0, 0.15 }, { 16384.0, 0.45 }, { 131072.0, 0.65 }, { 1048576.0, 0.82 },
+            { 16777216.0, 0.96 }, { 134217728.0, 0.99 }, { 1073741824.0, 0.998 }, { 4294967296.0, 1.0 },
+        };
+        if (bytes <= 0)
+        {
+            return bytes < 0 ? 0.0 : points[0][1];
+        }
+        double value = static_cast<double>(bytes);
+        for (size_t i = 1; i < std::size(points); ++i)
+        {
+            if (value <= points[i][0])
+            {
+                double lower = (std::max)(points[i - 1][0], 1.0);
+                double position = std::log(value / lower) / std::log(points[i][0] / lower);
+                return points[i - 1][1] + (points[i][1] - points[i - 1][1]) * (std::max)(position, 0.0);
+            }
+        }
+        return 1.0;
+    }
+
+    // Share of files whose date is at most 'days' old
+    inline double AgeCumulativeShare(double days)
+    {
+        static constexpr double points[][2] = {
+            { 0.0, 0.0 }, { 1.0, 0.01 }, { 7.0, 0.03 }, { 30.0, 0.08 }, { 365.0, 0.35 }, { 1825.0, 0.75 }, { 3650.0, 0.95 }, { 36500.0, 1.0 },
+        };
+        if (days <= 0.0)
+        {
+            return 0.0;
+        }
+        for (size_t i = 1; i < std::size(points); ++i)
+        {
+            if (days <= points[i][0])
+            {
+                double position = (days - points[i - 1][0]) / (points[i][0] - points[i - 1][0]);
+                return points[i - 1][1] + (points[i][1] - points[i - 1][1]) * position;
+            }
+        }
+        return 1.0;
+    }
+} // namespace details
+
+/* ParseSearchFilters - splits filters off search text
+ *
+ * Whitespace-separated tokens of the form name:value (or -name:value to exclude) with a known
+ * name become predicates; everything else, quoted phrases included, is kept as search text.
+ *   kind:image,video    System.Kind; aliases (image, photo, doc, app, ...) and plurals accepted
+ *   ext:png  ext:.PNG   System.FileExtension, compared case-insensitively
+ *   size:>10MB  size:<=512k  size:1MB..4MB  size:large   (Explorer's groups: empty ... gigantic)
+ *   modified:lastweek  modified:>=2024-01-01  created:2024-01-01..2024-01-31  date: = modified:
+ *     today, yesterday, thisweek, lastweek (weeks start on Monday), thismonth, lastmonth,
+ *     thisyear, lastyear; days are local days per FilterParseOptions::utcOffsetMinutes
+ * A known name with a value that does not parse, such as a half-typed "size:>", is dropped and
+ * listed in 'invalid'.
+ *
+ * Example:
+ *   auto parsed = wsearch::ParseSearchFilters(L"kind:image ext:png size:>10MB modified:lastweek report");
+ *   // parsed.searchText == L"report", parsed.predicates.size() == 4
+ */
+inline ParsedFilters ParseSearchFilters(std::wstring_view text, const FilterParseOptions& options = {})
+{
+    ParsedFilters parsed;
+    size_t index = 0;
+    while (index < text.size())
+    {
+        while (index < text.size() && std::iswspace(text[index]))
+        {
+            ++index;
+        }
+        size_t start = index;
+        bool quoted = false;
+        while (index < text.size() && (quoted || !std::iswspace(text[index])))
+        {
+            quoted = (text[index] == L'"') ? !quoted : quoted;
+            ++index;
+        }
+        std::wstring_view token = text.substr(start, index - start);
+        if (token.empty())
+        {
+            break;
+        }
+
+        FilterPredicate predicate;
+        std::wstring_view body = token;
+        predicate.negated = body.size() > 1 && body.front() == L'-';
+        if (predicate.negated)
+        {
+            body.remove_prefix(1);
+        }
+        size_t colon = body.find(L':');
+        if (colon == std::wstring_view::npos || body.front() == L'"' || !details::ParseFilterName(body.substr(0, colon), predicate.field))
+        {
+            if (!parsed.searchText.empty())
+            {
+                parsed.searchText.push_back(L' ');
+            }
+            parsed.searchText.append(token.data(), token.size());
+            continue;
+        }
+
+        predicate.text.assign(token.data(), token.size());
+        if (details::ParseFilterValue(body.substr(colon + 1), options, predicate))
+        {
+            parsed.predicates.push_back(std::move(predicate));
+        }
+        else
+        {
+            parsed.invalid.push_back(std::move(predicate.text));
+        }
+    }
+    return parsed;
+}
+
+/* EvaluateFilters - rows of a batch that pass every predicate, in batch order
+ *
+ * Kind and extension predicates are resolved once against each column's dictionary, so the
+ * per-row work is a table lookup; sizes and dates compare int64 columns. The batch must hold
+ * the predicates' columns (ResultBatch::FromPage with propid::Kind, FileExtension, Size,
+ * DateModified, DateCreated as needed); std::invalid_argument otherwise. The batch keeps the
+ * first value of System.Kind, so kind predicates test an item's primary kind, where SQL tests
+ * every kind it has.
+ */
+inline std::vector<uint32_t> EvaluateFilters(const ResultBatch& batch, const std::vector<FilterPredicate>& predicates)
+{
+    std::vector<uint32_t> rows(batch.GetRowCount());
+    for (uint32_t row = 0; row < rows.size(); ++row)
+    {
+        rows[row] = row;
+    }
+
+    for (const auto& predicate : predicates)
+    {
+        size_t kept = 0;
+        if (predicate.IsRange())
+        {
+            const auto* numbers = batch.GetNumberColumn(predicate.GetProperty());
+            if (!numbers)
+            {
+                throw std::invalid_argument("ResultBatch has no column for a size or date filter");
+            }
+            for (uint32_t row : rows)
+            {
+                rows[kept] = row;
+                kept += details::FilterMatchesNumber(predicate, (*numbers)[row]) ? 1 : 0;
+            }
+        }
+        else
+        {
+            const auto* category = batch.GetCategoryColumn(predicate.GetProperty());
+            if (!category)
+            {
+                throw std::invalid_argument("ResultBatch has no column for a kind or extension filter");
+            }
+            std::vector<uint8_t> matches(category->GetCardinality());
+            for (uint32_t code = 0; code < matches.size(); ++code)
+            {
+                matches[code] = details::FilterMatchesText(predicate, category->GetValue(code)) ? 1 : 0;
+            }
+            const auto& codes = category->GetCodes();
+            for (uint32_t row : rows)
+            {
+                rows[kept] = row;
+                kept += matches[codes[row]];
+            }
+        }
+        rows.resize(kept);
+    }
+    return rows;
+}
+
+// Rows kept to estimate selectivity, and how many are needed before they replace the priors
+constexpr size_t c_filterSampleCapacity = 4096;
+constexpr size_t c_filterMinSamples = 256;
+
+/* FilterSelectivity - estimated share of rows a predicate keeps
+ *
+ * Starts from priors for a typical index (kind shares, a log-scale size distribution, file
+ * ages) and switches to a uniform reservoir sample of observed result rows once it holds
+ * c_filterMinSamples. Observe only rows fetched without pushed filters, or the sample learns
+ * that every row passes them.
+ */
+class FilterSelectivity
+{
+public:
+    // 'nowTicks' dates the age priors; 0 reads the system clock
+    explicit FilterSelectivity(uint64_t nowTicks = 0)
+        : m_nowTicks(nowTicks)
+        , m_random(0x5EED)
+    {
+    }
+
+    double Estimate(const FilterPredicate& predicate) const
+    {
+        double share = 0.0;
+        if (m_samples.size() >= c_filterMinSamples)
+        {
+            size_t matched = 0;
+            for (const auto& sample : m_samples)
+            {
+                matched += Matches(predicate, sample) ? 1 : 0;
+            }
+            share = (static_cast<double>(matched) + 0.5) / (static_cast<double>(m_samples.size()) + 1.0);
+        }
+        else
+        {
+            share = Prior(predicate);
+            share = predicate.negated ? 1.0 - share : share;
+        }
+        return (std::min)((std::max)(share, 0.0001), 1.0);
+    }
+
+    void Observe(const ResultBatch& batch)
+    {
+        const auto* kinds = batch.GetCategoryColumn(propid::Kind);
+        const auto* extensions = batch.GetCategoryColumn(propid::FileExtension);
+        const auto* sizes = batch.GetNumberColumn(propid::Size);
+        const auto* modified = batch.GetNumberColumn(propid::DateModified);
+        const auto* created = batch.GetNumberColumn(propid::DateCreated);
+        for (size_t row = 0; row < batch.GetRowCount(); ++row)
+        {
+            ++m_observed;
+            size_t slot = m_samples.size();
+            if (m_samples.size() >= c_filterSampleCapacity)
+            {
+                slot = static_cast<size_t>(m_random() % m_observed);
+                if (slot >= c_filterSampleCapacity)
+                {
+                    continue;
+                }
+            }
+            else
+            {
+                m_samples.emplace_back();
+            }
+
+            Sample& sample = m_samples[slot];
+            sample.kind = kinds ? kinds->GetValue(kinds->GetCodes()[row]) : std::wstring_view();
+            sample.extension = extensions ? extensions->GetValue(extensions->GetCodes()[row]) : std::wstring_view();
+            sample.size = sizes ? (*sizes)[row] : c_missingNumber;
+            sample.modified = modified ? (*modified)[row] : c_missingNumber;
+            sample.created = created ? (*created)[row] : c_missingNumber;
+        }
+    }
+
+    size_t GetSampleCount() const
+    {
+        return m_samples.size();
+    }
+
+private:
+    struct Sample
+    {
+        std::wstring kind;
+        std::wstring extension;
+        int64_t size = c_missingNumber;
+        int64_t modified = c_missingNumber;
+        int64_t created = c_missingNumber;
+    };
+
+    static bool Matches(const FilterPredicate& predicate, const Sample& sample)
+    {
+        switch (predicate.field)
+        {
+        case FilterField::Kind: return details::FilterMatchesText(predicate, sample.kind);
+        case FilterField::Extension: return details::FilterMatchesText(predicate, sample.extension);
+        case FilterField::Size: return details::FilterMatchesNumber(predicate, sample.size);
+        case FilterField::DateModified: return details::FilterMatchesNumber(predicate, sample.modified);
+        default: return details::FilterMatchesNumber(predicate, sample.created);
+        }
+    }
+
+    // Share of a typical index matching the predicate, ignoring negation
+    double Prior(const FilterPredicate& predicate) const
+    {
+        double share = 0.0;
+        switch (predicate.field)
+        {
+        case FilterField::Kind:
+            for (const auto& value : predicate.values)
+            {
+                for (const auto& entry : details::c_kindShares)
+                {
+                    share += (entry.kind == value) ? entry.share : 0.0;
+                }
+            }
+            break;
+        case FilterField::Extension:
+            share = 0.02 * static_cast<double>(predicate.values.size());
+            break;
+        case FilterField::Size:
+            share = details::SizeCumulativeShare(predicate.high == (std::numeric_limits<int64_t>::max)() ? predicate.high : predicate.high - 1) -
+                (predicate.low <= 0 ? 0.0 : details::SizeCumulativeShare(predicate.low - 1));
+            break;
+        default:
+        {
+            double now = static_cast<double>(m_nowTicks ? m_nowTicks : details::CurrentFileTimeTicks());
+            auto ageDays = [now](int64_t ticks) { return (now - static_cast<double>(ticks)) / static_cast<double>(details::c_ticksPerDay); };
+            double newest = (predicate.high == (std::numeric_limits<int64_t>::max)()) ? 0.0 : ageDays(predicate.high);
+            double oldest = (predicate.low == (std::numeric_limits<int64_t>::min)()) ? 1.0e9 : ageDays(predicate.low);
+            share = details::AgeCumulativeShare(oldest) - details::AgeCumulativeShare(newest);
+            break;
+        }
+        }
+        return (std::min)((std::max)(share, 0.0), 1.0);
+    }
+
+    std::vector<Sample> m_samples;
+    uint64_t m_observed = 0;
+    uint64_t m_nowTicks;
+    std::mt19937 m_random;
+};
+
+struct FilterPlannerPolicy
+{
+    // Predicates estimated to keep at most this share of rows go into the WHERE clause
+    double pushBelowSelectivity = 0.25;
+    // Client-side predicates may grow TOP N by at most this factor to still return N rows
+    double maxOverfetch = 4.0;
+};
+
+// The unfiltered query's rows (same search text and scopes) already held client-side
+struct CachedResultState
+{
+    size_t rowCount = 0;
+    bool complete = false; // every match is cached; the fetch was not cut off by TOP N
+};
+
+// What the planner decided for one set of predicates
+struct FilterPlan
+{
+    std::vector<FilterPredicate> pushed;     // for SearchQueryBuilder::WithFilters
+    std::vector<FilterPredicate> clientSide; // for EvaluateFilters over the fetched (or cached) rows
+    // Evaluate clientSide over the cached rows instead of querying. Unless the cache is complete,
+    // fewer than TOP N passing rows means rows may be missing: plan again without the cache.
+    bool fromCache = false;
+    size_t fetchLimit = 0;                   // TOP for the query, grown to cover clientSide; 0 = unlimited
+    double selectivity = 1.0;                // estimated share of the unfiltered rows that pass everything
+    double pushedSelectivity = 1.0;          // ... that pass the pushed predicates (the rows transferred)
+
+    // One line for tracing, e.g. "push kind:image (0.18); client size:>0 (0.98); TOP 50 -> 52"
+    std::wstring Describe() const
+    {
+        std::wstring text;
+        auto appendList = [&text](const wchar_t* label, const std::vector<FilterPredicate>& predicates) {
+            if (predicates.empty())
+            {
+                return;
+            }
+            text += text.empty() ? label : std::wstring(L"; ") + label;
+            for (size_t i = 0; i < predicates.size(); ++i)
+            {
+                text += (i == 0 ? L" " : L", ") + predicates[i].text;
+            }
+        };
+        appendList(L"push", pushed);
+        appendList(fromCache ? L"cached" : L"client", clientSide);
+        wchar_t numbers[64];
+        swprintf(numbers, 64, L"; selectivity %.3f", selectivity);
+        text += (text.empty() ? L"no filters" : L"") + std::wstring(numbers);
+        if (fetchLimit > 0)
+        {
+            text += L"; TOP " + std::to_wstring(fetchLimit);
+        }
+        return text;
+    }
+};
+
+/* FilterPlanner - decides where each filter predicate runs
+ *
+ * With the unfiltered rows cached and either complete or numerous enough that TOP N of them are
+ * expected to pass, nothing is queried. Otherwise predicates estimated to keep at most
+ * pushBelowSelectivity of the rows are pushed: they cut the rows transferred the most. The rest
+ * stay client-side, which keeps the SQL (and any cache keyed by it) the same while they are
+ * toggled; under TOP N the fetch grows by 1 / their combined selectivity, and when that exceeds
+ * maxOverfetch the most selective of them are pushed after all. Predicates are assumed
+ * independent.
+ *
+ * Example:
+ *   auto filters = wsearch::ParseSearchFilters(text);
+ *   auto plan = planner.Plan(filters.predicates, 50, cache.StateFor(filters.searchText));
+ *   builder.WithSearchText(filters.searchText).WithFilters(plan.pushed).WithTopN(plan.fetchLimit);
+ *   // ... fetch into a page; batch = ResultBatch::FromPage(page, columns) ...
+ *   auto rows = wsearch::EvaluateFilters(batch, plan.clientSide);
+ */
+class FilterPlanner
+{
+public:
+    explicit FilterPlanner(FilterPlannerPolicy policy = {}, uint64_t nowTicks = 0)
+        : m_policy(policy)
+        , m_selectivity(nowTicks)
+    {
+    }
+
+    const FilterPlannerPolicy& GetPolicy() const
+    {
+        return m_policy;
+    }
+
+    // Feed rows fetched without pushed predicates here to sharpen the estimates
+    FilterSelectivity& GetSelectivity()
+    {
+        return m_selectivity;
+    }
+
+    FilterPlan Plan(const std::vector<FilterPredicate>& predicates, size_t topN, const CachedResultState& cache = {}) const
+    {
+        struct Estimated
+        {
+            const FilterPredicate* predicate;
+            double selectivity;
+        };
+        std::vector<Estimated> estimates;
+        FilterPlan plan;
+        for (const auto& predicate : predicates)
+        {
+            estimates.push_back({ &predicate, m_selectivity.Estimate(predicate) });
+            plan.selectivity *= estimates.back().selectivity;
+        }
+        std::stable_sort(estimates.begin(), estimates.end(),
+            [](const Estimated& left, const Estimated& right) { return left.selectivity < right.selectivity; });
+
+        if (cache.rowCount > 0 && (cache.complete || (topN > 0 && static_cast<double>(cache.rowCount) * plan.selectivity >= static_cast<double>(topN))))
+        {
+            plan.fromCache = true;
+            for (const auto& estimate : estimates)
+            {
+                plan.clientSide.push_back(*estimate.predicate);
+            }
+            return plan;
+        }
+
+        double clientSelectivity = 1.0;
+        size_t firstClient = 0;
+        for (; firstClient < estimates.size() && estimates[firstClient].selectivity <= m_policy.pushBelowSelectivity; ++firstClient)
+        {
+        }
+        for (size_t i = firstClient; i < estimates.size(); ++i)
+        {
+            clientSelectivity *= estimates[i].selectivity;
+        }
+        // Under TOP N, growing the fetch to cover client-side predicates has a limit
+        while (topN > 0 && firstClient < estimates.size() && clientSelectivity * m_policy.maxOverfetch < 1.0)
+        {
+            clientSelectivity /= estimates[firstClient].selectivity;
+            ++firstClient;
+        }
+
+        for (size_t i = 0; i < estimates.size(); ++i)
+        {
+            if (i < firstClient)
+            {
+                plan.pushed.push_back(*estimates[i].predicate);
+                plan.pushedSelectivity *= estimates[i].selectivity;
+            }
+            else
+            {
+                plan.clientSide.push_back(*estimates[i].predicate);
+            }
+        }
+        plan.fetchLimit = (topN == 0) ? 0 : static_cast<size_t>(std::ceil(static_cast<double>(topN) / clientSelectivity));
+        return plan;
+    }
+
+private:
+    FilterPlannerPolicy m_policy;
+    FilterSelectivity m_selectivity;
+};
+
+} // namespace wsearch
@@ -0,0 +1,292 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include "SearchClock.h"
+#include "SearchExpected.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace wsearch
+{
+
+/* IIndexCountSource - counts the indexed items under a scope
+ *
+ * CountItems may be slow (a full scope query); it returns the error that stopped the count, and
+ * anything it throws is recorded as E_FAIL. It is only called from the IndexCountService
+ * worker thread.
+ */
+class IIndexCountSource
+{
+public:
+    virtual ~IIndexCountSource() = default;
+
+    virtual SearchExpected<size_t> CountItems(std::wstring_view scope) = 0;
+
+    // Called on the worker thread before its first count and after its last one
+    // (e.g. to join and leave a COM apartment)
+    virtual void OnWorkerThreadStarted() {}
+    virtual void OnWorkerThreadStopping() {}
+};
+
+struct IndexCountOptions
+{
+    // How often every scope that has been asked for is counted again; zero counts only on demand
+    std::chrono::milliseconds refreshInterval{ std::chrono::minutes(5) };
+
+    // Time source for counts' ages and the refresh schedule; null uses the steady clock
+    std::shared_ptr<ISearchClock> clock = nullptr;
+};
+
+// The last known count of a scope
+struct IndexCount
+{
+    size_t count = 0;
+    bool known = false;              // false until the first count completes
+    bool lastRefreshFailed = false;  // the most recent count failed; 'count' is from an earlier one
+    SearchError lastError;           // why, while lastRefreshFailed
+    std::chrono::steady_clock::duration age{}; // time since 'count' was taken
+};
+
+/* IndexCountService - cached item counts per scope, refreshed in the background
+ *
+ * GetCount returns the last known count of a scope immediately, with its age; the first call
+ * for a scope schedules its first count. Every scope asked for is counted again each
+ * refreshInterval on one worker thread, or on demand with RequestRefresh / RefreshNow.
+ * Refresh requests that arrive while a count of the scope is queued or running share it, so
+ * any number of callers cost one scope query. Ages and the schedule follow options.clock, so a
+ * VirtualSearchClock steps through refresh intervals without waiting them out.
+ *
+ * Shutdown() stops the worker; the destructor calls it. Owners that outlive static destruction
+ * or sit in a DLL call it themselves before unloading (see ShutdownSharedIndexCountService).
+ *
+ * Example:
+ *   auto counts = wsearch::details::GetSharedIndexCountService();
+ *   auto status = counts->GetCount(L"file:");
+ *   if (status.known) { ShowStatus(status.count); }
+ */
+class IndexCountService
+{
+public:
+    explicit IndexCountService(std::shared_ptr<IIndexCountSource> source, IndexCountOptions options = {})
+        : m_source(std::move(source))
+        , m_options(std::move(options))
+        , m_clock(m_options.clock ? m_options.clock : details::GetSteadySearchClock())
+    {
+    }
+
+    ~IndexCountService()
+    {
+        Shutdown();
+    }
+
+    // Non-copyable
+    IndexCountService(const IndexCountService&) = delete;
+    IndexCountService& operator=(const IndexCountService&) = delete;
+
+    // Never blocks on the source
+    IndexCount GetCount(std::wstring_view scope = L"file:")
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto& state = GetScopeLocked(scope);
+        return ToCount(state, m_clock->Now());
+    }
+
+    // Schedules a count of the scope unless one is already queued or running
+    void RequestRefresh(std::wstring_view scope = L"file:")
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto& state = GetScopeLocked(scope);
+            state.requested = state.requested || !state.refreshing;
+        }
+        m_cv.notify_all();
+    }
+
+    // Waits for a count of the scope: the one queued or running, or a new one
+    IndexCount RefreshNow(std::wstring_view scope = L"file:")
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto& state = GetScopeLocked(scope);
+        if (!state.refreshing)
+        {
+            state.requested = true;
+            m_cv.notify_all();
+        }
+
+        // The next count to complete: the running one, or the one just requested
+        uint64_t target = state.completedRefreshes + 1;
+
+        m_cv.wait(lock, [&] { return state.completedRefreshes >= target || m_shouldStop; });
+        return ToCount(state, m_clock->Now());
+    }
+
+    // The cached count if it is younger than 'maxAge', otherwise a fresh one (shared as above)
+    IndexCount GetCountNoOlderThan(std::wstring_view scope, std::chrono::steady_clock::duration maxAge)
+    {
+        auto cached = GetCount(scope);
+        if (cached.known && !cached.lastRefreshFailed && cached.age <= maxAge)
+        {
+            return cached;
+        }
+        return RefreshNow(scope);
+    }
+
+    // Stops the worker, waiting for a count in progress. Cached counts stay readable, nothing is
+    // counted afterwards and RefreshNow returns at once. Safe to call more than once.
+    void Shutdown()
+    {
+        std::thread worker;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_shouldStop = true;
+            worker = std::move(m_workerThread);
+        }
+        m_cv.notify_all();
+
+        if (worker.joinable())
+        {
+            worker.join();
+        }
+    }
+
+    // Number of times the source was asked to count, across all scopes
+    size_t GetSourceQueryCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_sourceQueries;
+    }
+
+private:
+    struct ScopeState
+    {
+        size_t count = 0;
+        bool known = false;
+        bool lastRefreshFailed = false;
+        SearchError lastError;
+        bool requested = true; // a new scope is counted right away
+        bool refreshing = false;
+        uint64_t completedRefreshes = 0;
+        std::chrono::steady_clock::time_point countedAt{};
+        std::chrono::steady_clock::time_point nextRefresh{};
+    };
+
+    static IndexCount ToCount(const ScopeState& state, std::chrono::steady_clock::time_point now)
+    {
+        IndexCount count;
+        count.count = state.count;
+        count.known = state.known;
+        count.lastRefreshFailed = state.lastRefreshFailed;
+        count.lastError = state.lastError;
+        count.age = state.known ? now - state.countedAt : std::chrono::steady_clock::duration{};
+        return count;
+    }
+
+    ScopeState& GetScopeLocked(std::wstring_view scope)
+    {
+        auto it = m_scopes.find(scope);
+        if (it == m_scopes.end())
+        {
+            it = m_scopes.emplace(std::wstring(scope), ScopeState{}).first;
+            if (!m_workerThread.joinable() && !m_shouldStop)
+            {
+                m_workerThread = std::thread([this]() { WorkerThread(); });
+            }
+        }
+        return it->second;
+    }
+
+    void WorkerThread()
+    {
+        m_source->OnWorkerThreadStarted();
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_shouldStop)
+        {
+            auto now = m_clock->Now();
+            auto nextWake = std::chrono::steady_clock::time_point::max();
+            auto due = m_scopes.end();
+            for (auto it = m_scopes.begin(); it != m_scopes.end(); ++it)
+            {
+                const auto& state = it->second;
+                bool periodic = m_options.refreshInterval.count() > 0 && state.completedRefreshes > 0;
+                if (state.requested || (periodic && state.nextRefresh <= now))
+                {
+                    due = it;
+                    break;
+                }
+                if (periodic)
+                {
+                    nextWake = (std::min)(nextWake, state.nextRefresh);
+                }
+            }
+
+            if (due == m_scopes.end())
+            {
+                m_clock->WaitUntil(m_cv, lock, nextWake);
+                continue;
+            }
+
+            // Requests that arrive from here on are satisfied by this count
+            auto& state = due->second;
+            std::wstring scope = due->first;
+            state.requested = false;
+            state.refreshing = true;
+            ++m_sourceQueries;
+            lock.unlock();
+
+            SearchExpected<size_t> count = SearchError{ c_countThrew, L"IIndexCountSource::CountItems" };
+            try
+            {
+                count = m_source->CountItems(scope);
+            }
+            catch (...)
+            {
+            }
+
+            lock.lock();
+            now = m_clock->Now();
+            state.refreshing = false;
+            state.lastRefreshFailed = !count;
+            if (count)
+            {
+                state.count = *count;
+                state.known = true;
+                state.countedAt = now;
+            }
+            else
+            {
+                state.lastError = count.Error();
+            }
+            state.nextRefresh = now + m_options.refreshInterval;
+            ++state.completedRefreshes;
+            m_cv.notify_all();
+        }
+
+        lock.unlock();
+        m_source->OnWorkerThreadStopping();
+    }
+
+    static constexpr int32_t c_countThrew = static_cast<int32_t>(0x80004005); // E_FAIL
+
+    std::shared_ptr<IIndexCountSource> m_source;
+    IndexCountOptions m_options;
+    std::shared_ptr<ISearchClock> m_clock;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable_any m_cv;
+    std::map<std::wstring, ScopeState, std::less<>> m_scopes;
+    size_t m_sourceQueries = 0;
+    bool m_shouldStop = false;
+    std::thread m_workerThread;
+};
+
+} // namespace wsearch
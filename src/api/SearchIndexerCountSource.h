@@ -0,0 +1,71 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include "SearchPlatCore.h"
+#include "SearchIndexCount.h"
+
+namespace wsearch
+{
+
+/* IndexerCountSource - IIndexCountSource that counts a scope of the system index
+ *
+ * Runs SELECT System.ItemUrl FROM SystemIndex WHERE SCOPE='<scope>' and reads
+ * MSIDXSPROP_RESULTS_FOUND, on the count service's worker thread in the MTA.
+ */
+class IndexerCountSource : public IIndexCountSource
+{
+public:
+    SearchExpected<size_t> CountItems(std::wstring_view scope) override
+    {
+        std::wstring sql(L"SELECT System.ItemUrl FROM SystemIndex WHERE SCOPE='");
+        details::AppendScopeUrl(sql, scope, true);
+        sql.push_back(L'\'');
+
+        auto rowset = details::TryExecuteQuery(sql);
+        if (!rowset)
+        {
+            return rowset.Error();
+        }
+
+        try
+        {
+            return details::GetTotalRowsForRowset(*rowset);
+        }
+        catch (...)
+        {
+            return SearchError{ wil::ResultFromCaughtException(), L"IRowsetInfo::GetProperties(MSIDXSPROP_RESULTS_FOUND)" };
+        }
+    }
+
+    void OnWorkerThreadStarted() override
+    {
+        winrt::init_apartment(winrt::apartment_type::multi_threaded);
+    }
+
+    void OnWorkerThreadStopping() override
+    {
+        winrt::uninit_apartment();
+    }
+};
+
+namespace details
+{
+    // The process-wide count service over the system index, created on first use. Static
+    // destruction never runs its destructor: joining the worker there can deadlock on the
+    // loader lock when this code is in a DLL. Call ShutdownSharedIndexCountService instead.
+    inline std::shared_ptr<IndexCountService> GetSharedIndexCountService()
+    {
+        static auto* service = new std::shared_ptr<IndexCountService>(
+            std::make_shared<IndexCountService>(std::make_shared<IndexerCountSource>()));
+        return *service;
+    }
+
+    // Stops the shared service's worker, e.g. before the process exits or the DLL is unloaded;
+    // cached counts stay readable and nothing is counted again
+    inline void ShutdownSharedIndexCountService()
+    {
+        GetSharedIndexCountService()->Shutdown();
+    }
+} // namespace details
+
+} // namespace wsearch
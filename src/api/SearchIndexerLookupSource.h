@@ -0,0 +1,67 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include "SearchPlatCore.h"
+#include "SearchBulkLookup.h"
+#include <functional>
+
+namespace wsearch
+{
+
+/* IndexerLookupSource - IBulkLookupSource that runs lookups against the system indexer
+ *
+ * Each statement is executed on its own rowset and decoded through IPropertyStore with the
+ * caller's decoder, which may drop rows (return false). Worker threads join the MTA.
+ *
+ * Example:
+ *   auto source = std::make_shared<wsearch::IndexerLookupSource<FileInfo>>(
+ *       [](IPropertyStore* store, FileInfo& info) { info.size = GetSize(store); return true; });
+ *   wsearch::BulkLookupOptions options;
+ *   options.reuseWhereId = session.GetPrimingReuseWhereId();
+ *   wsearch::BulkPropertyLookup<FileInfo> lookup(source, { L"System.Size" }, options);
+ */
+template <typename Row>
+class IndexerLookupSource : public IBulkLookupSource<Row>
+{
+public:
+    using Decoder = std::function<bool(IPropertyStore*, Row&)>;
+    using EmitRow = typename IBulkLookupSource<Row>::EmitRow;
+
+    explicit IndexerLookupSource(Decoder decoder)
+        : m_decoder(std::move(decoder))
+    {
+    }
+
+    void ExecuteLookup(const std::wstring& sql, const EmitRow& emit) override
+    {
+        auto rowset = details::ExecuteQuery(sql);
+        details::EnumerateRowsWithCallback(rowset.get(), [&](IPropertyStore* store) {
+            wil::unique_prop_variant itemUrl;
+            if (FAILED(store->GetValue(PKEY_ItemUrl, &itemUrl)) || itemUrl.vt != VT_LPWSTR)
+            {
+                return;
+            }
+
+            Row row;
+            if (m_decoder(store, row))
+            {
+                emit(itemUrl.pwszVal, std::move(row));
+            }
+        });
+    }
+
+    void OnWorkerThreadStarted() override
+    {
+        winrt::init_apartment(winrt::apartment_type::multi_threaded);
+    }
+
+    void OnWorkerThreadStopping() override
+    {
+        winrt::uninit_apartment();
+    }
+
+private:
+    Decoder m_decoder;
+};
+
+} // namespace wsearch
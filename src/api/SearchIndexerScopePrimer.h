@@ -0,0 +1,48 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include "SearchPlatCore.h"
+#include "SearchPrimedScopeCache.h"
+
+namespace wsearch
+{
+
+using SessionScope = PrimedScope<winrt::com_ptr<IRowset>>;
+using SessionScopeCache = PrimedScopeCache<winrt::com_ptr<IRowset>>;
+
+/* IndexerScopePrimer - IScopePrimer that primes a scope set in the system index
+ *
+ * Runs the priming query, reads its MSIDXSPROP_WHEREID for REUSEWHERE and asks the indexer
+ * to give the scopes foreground priority, on the calling thread.
+ */
+class IndexerScopePrimer : public IScopePrimer<winrt::com_ptr<IRowset>>
+{
+public:
+    SearchExpected<void> Prime(SessionScope& scope) override
+    {
+        TelemetryProvider::LogInfo(L"[QUERY] %ls", scope.sql.c_str());
+        auto rowset = details::TryExecuteQuery(scope.sql);
+        if (!rowset)
+        {
+            return rowset.Error();
+        }
+        auto whereId = details::TryGetReuseWhereIDFromRowset(*rowset);
+        if (!whereId)
+        {
+            return whereId.Error();
+        }
+
+        // Prioritization only speeds up indexing of the scopes; searches work without it
+        auto prioritization = rowset->try_as<IRowsetPrioritization>();
+        if (prioritization)
+        {
+            prioritization->SetScopePriority(PRIORITY_LEVEL_FOREGROUND, 100);
+        }
+
+        scope.rowset = std::move(*rowset);
+        scope.whereId = *whereId;
+        return {};
+    }
+};
+
+} // namespace wsearch
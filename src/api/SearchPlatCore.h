@@ -12,7 +12,9 @@
 * The goal is to abstract the complicated pieces into segements and functions a developer of a search
 * application would most likely use
 *
-* This API set throws exceptions on failure.
+* This API set throws exceptions on failure. The query path (ExecuteQuery, GetReuseWhereIDFromRowset,
+* EnumerateRowsWithCallback) also has Try* forms that return a SearchExpected instead; the throwing
+* forms are thin wrappers over them.
 * It is inlined, and only this header should be needed on Windows SDK builds starting with 17763.
 *
 * This header requires the Windows Implementation Library for resource and result macros, and other various shell helpers and property handlers
@@ -36,8 +38,14 @@
 #include <intsafe.h>
 #include <iostream>
 #include <sstream>
+#include <memory_resource>
+#include <vector>
 
 #include "WSearchLogging.h"
+#include "SearchDeadline.h"
+#include "SearchExpected.h"
+#include "SearchQueryArena.h"
+#include "SearchSqlText.h"
 
 /* Common Helpers
 *
@@ -59,69 +67,52 @@ namespace details
         const std::vector<std::wstring>& additionalProperties)
     {
         wsearch::TelemetryProvider::LogInfo(L"Building priming SQL query");
-        std::wstring queryStr(L"SELECT System.ItemUrl");
+        std::wstring queryStr;
+        AppendPrimingSql(queryStr, includedScopes, excludedScopes, additionalProperties);
 
-        // Add additional properties to SELECT clause
-        for (const auto& prop : additionalProperties)
-        {
-            queryStr.append(L", ").append(prop);
-        }
-
-        queryStr += L" FROM SystemIndex WHERE";
-
-        // build the included, and excluded scope lists
-        for (size_t i = 0; i < includedScopes.size(); ++i)
-        {
-            std::wstring scope(includedScopes[i]);
-            std::replace(scope.begin(), scope.end(), L'\\', L'/');
-            if (i == 0)
-            {
-                queryStr += L" (";
-            }
+        wsearch::TelemetryProvider::LogInfo(L"[QUERY] %ls", queryStr.c_str());
+        return queryStr;
+    }
 
-            queryStr += L" SCOPE='";
+    // Same as above, allocated from 'resource' (typically a QueryArena)
+    inline std::pmr::wstring BuildPrimingSqlFromScopes(
+        const std::vector<std::wstring>& includedScopes,
+        const std::vector<std::wstring>& excludedScopes,
+        const std::vector<std::wstring>& additionalProperties,
+        std::pmr::memory_resource* resource)
+    {
+        wsearch::TelemetryProvider::LogInfo(L"Building priming SQL query");
+        std::pmr::wstring queryStr(resource);
+        AppendPrimingSql(queryStr, includedScopes, excludedScopes, additionalProperties);
 
-            // Does the scope start with a protocol?
-            if (scope.find(L"file:") != 0)
-            {
-                queryStr += L"file:" + scope;
-            }
-            else
-            {
-                queryStr += scope;
-            }
+        wsearch::TelemetryProvider::LogInfo(L"[QUERY] %ls", queryStr.c_str());
+        return queryStr;
+    }
 
-            if (i < (includedScopes.size() - 1))
-            {
-                queryStr += L"' OR";
-            }
-            else
-            {
-                queryStr += L"')";
-            }
+    // Returns the value of a successful Try* call, or logs its error and throws its HRESULT
+    template <typename T>
+    T ThrowIfSearchError(SearchExpected<T>&& result)
+    {
+        if (!result)
+        {
+            wsearch::TelemetryProvider::LogError(L"[ERROR] %ls failed (0x%08X)", result.Error().operation, result.Error().code);
+            THROW_HR(result.Error().code);
         }
-
-        for (size_t i = 0; i < excludedScopes.size(); ++i)
+        if constexpr (!std::is_void_v<T>)
         {
-            std::wstring scope(excludedScopes[i]);
-            std::replace(scope.begin(), scope.end(), L'\\', L'/');
-            queryStr += L" SCOPE <> 'file:";
-            queryStr += excludedScopes[i] + L'\'';
-            if (i < (excludedScopes.size() - 1))
-            {
-                queryStr += L" AND";
-            }
+            return std::move(*result);
         }
-
-        wsearch::TelemetryProvider::LogInfo(L"[QUERY] %ls", queryStr.c_str());
-        return queryStr;
     }
 
-    inline DWORD GetReuseWhereIDFromRowset(const winrt::com_ptr<IRowset>& rowset)
+    inline SearchExpected<DWORD> TryGetReuseWhereIDFromRowset(const winrt::com_ptr<IRowset>& rowset)
     {
         wsearch::TelemetryProvider::LogInfo(L"Getting REUSEWHERE ID from rowset");
         winrt::com_ptr<IRowsetInfo> rowsetInfo;
-        THROW_IF_FAILED(rowset->QueryInterface(IID_PPV_ARGS(rowsetInfo.put())));
+        HRESULT hr = rowset->QueryInterface(IID_PPV_ARGS(rowsetInfo.put()));
+        if (FAILED(hr))
+        {
+            return SearchError{ hr, L"IRowset::QueryInterface(IRowsetInfo)" };
+        }
 
         DBPROPIDSET propset;
         DBPROPSET* prgPropSets;
@@ -132,7 +123,11 @@ namespace details
         propset.guidPropertySet = DBPROPSET_MSIDXS_ROWSETEXT;
         ULONG cPropertySets;
 
-        THROW_IF_FAILED(rowsetInfo->GetProperties(1, &propset, &cPropertySets, &prgPropSets));
+        hr = rowsetInfo->GetProperties(1, &propset, &cPropertySets, &prgPropSets);
+        if (FAILED(hr))
+        {
+            return SearchError{ hr, L"IRowsetInfo::GetProperties(MSIDXSPROP_WHEREID)" };
+        }
 
         wil::unique_cotaskmem_ptr<DBPROP> sprgProps(prgPropSets->rgProperties);
         wil::unique_cotaskmem_ptr<DBPROPSET> sprgPropSets(prgPropSets);
@@ -142,91 +137,30 @@ namespace details
         return whereId;
     }
 
+    inline DWORD GetReuseWhereIDFromRowset(const winrt::com_ptr<IRowset>& rowset)
+    {
+        return ThrowIfSearchError(TryGetReuseWhereIDFromRowset(rowset));
+    }
+
     inline std::wstring BuildSearchWhereClause(std::wstring_view const& searchText)
     {
-        wsearch::TelemetryProvider::LogInfo(L"Building search WHERE clause for: %ls", searchText.data());
-        
-        // Handle empty search text
-        if (searchText.empty())
-        {
-            wsearch::TelemetryProvider::LogInfo(L"Empty search text, returning empty WHERE clause");
-            return L""; // No additional WHERE clause for empty searches
-        }
-        
-        // Escape any single quotes in the search text
-        std::wstring escapedText{searchText};
-        size_t pos = 0;
-        while ((pos = escapedText.find(L"'", pos)) != std::wstring::npos)
-        {
-            escapedText.replace(pos, 1, L"''");
-            pos += 2;
-        }
+        wsearch::TelemetryProvider::LogInfo(L"Building search WHERE clause for: %.*ls", static_cast<int>(searchText.size()), searchText.data());
 
-        // Check if user already included quotes (exact phrase search)
-        bool userQuoted = (escapedText.length() >= 2 && 
-                          escapedText.front() == L'"' && 
-                          escapedText.back() == L'"');
-        
-        // Check if search text contains spaces (multi-word phrase)
-        bool hasSpaces = escapedText.find(L' ') != std::wstring::npos;
-        
         std::wstring whereClause;
-        if (userQuoted)
-        {
-            // User wants exact phrase search - use their quoted text as-is
-            // Just do a single CONTAINS with their exact query
-            whereClause = L" AND CONTAINS(*, '" + escapedText + L"')";
-            wsearch::TelemetryProvider::LogInfo(L"User-quoted phrase: using exact match only");
-        }
-        else if (hasSpaces)
-        {
-            // For multi-word phrases:
-            // 1. Exact phrase match with highest rank (999)
-            // 2. Multi-word prefix match with rank 998
-            // 3. Prefix matches on individual words (AND logic)
-            
-            // Split into individual words for prefix matching
-            std::vector<std::wstring> wordList;
-            std::wstring words = escapedText;
-            size_t start = 0;
-            size_t end = words.find(L' ');
-            
-            while (end != std::wstring::npos)
-            {
-                wordList.push_back(words.substr(start, end - start));
-                start = end + 1;
-                end = words.find(L' ', start);
-            }
-            wordList.push_back(words.substr(start));
-            
-            // Build WHERE clause:
-            // CONTAINS(*, '"exact phrase"') RANK BY COERCION(ABSOLUTE, 999)
-            // OR CONTAINS(*, 'multi word*') RANK BY COERCION(ABSOLUTE, 998)
-            // OR (CONTAINS(*, 'word1*') AND CONTAINS(*, 'word2*'))
-            whereClause = L" AND (CONTAINS(*, '\"" + escapedText + L"\"') RANK BY COERCION(ABSOLUTE, 999) OR CONTAINS(*, '" + escapedText + L"*') RANK BY COERCION(ABSOLUTE, 998) OR (";
-            
-            for (size_t i = 0; i < wordList.size(); ++i)
-            {
-                if (i > 0) whereClause += L" AND ";
-                whereClause += L"CONTAINS(*, '" + wordList[i] + L"*')";
-            }
-            
-            whereClause += L"))";
-            
-            wsearch::TelemetryProvider::LogInfo(L"Multi-word phrase: exact (999) OR multi-word prefix (998) OR individual word prefixes");
-        }
-        else
-        {
-            // For single words:
-            // 1. Exact match on filename with highest rank (999)
-            // 2. Prefix match on all content
-            whereClause = L" AND (CONTAINS(System.ItemNameDisplay, '" + escapedText + 
-                L"', 1033) RANK BY COERCION(ABSOLUTE, 999) OR CONTAINS(*, '" + escapedText + L"*'))";
-        }
-        
-        
-        
-        
+        AppendSearchWhereClause(whereClause, searchText);
+
+        wsearch::TelemetryProvider::LogInfo(L"Generated WHERE clause: %ls", whereClause.c_str());
+        return whereClause;
+    }
+
+    // Same as above, allocated from 'resource' (typically a QueryArena)
+    inline std::pmr::wstring BuildSearchWhereClause(std::wstring_view const& searchText, std::pmr::memory_resource* resource)
+    {
+        wsearch::TelemetryProvider::LogInfo(L"Building search WHERE clause for: %.*ls", static_cast<int>(searchText.size()), searchText.data());
+
+        std::pmr::wstring whereClause(resource);
+        AppendSearchWhereClause(whereClause, searchText);
+
         wsearch::TelemetryProvider::LogInfo(L"Generated WHERE clause: %ls", whereClause.c_str());
         return whereClause;
     }
@@ -260,18 +194,44 @@ namespace details
         return crawlScopeManager;
     }
 
+    // Checks one path against an existing crawl scope manager; reuse the manager for many paths
+    inline bool IsFilePathIncludedInIndex(ISearchCrawlScopeManager* crawlScopeManager, PCWSTR path)
+    {
+        BOOL included{ FALSE };
+        CLUSION_REASON reason{}; // unused
+        THROW_IF_FAILED(crawlScopeManager->IncludedInCrawlScopeEx(path, &included, &reason));
+        return included;
+    }
+
     inline bool IsFilePathIncludedInIndex(PCWSTR path)
     {
         wsearch::TelemetryProvider::LogInfo(L"Checking if path is indexed: %ls", path);
         winrt::com_ptr<ISearchCrawlScopeManager> crawlScopeManager = GetSystemIndexCrawlScopeManager();
 
-        BOOL included{ FALSE };
-        CLUSION_REASON reason{}; // unused
-        THROW_IF_FAILED(crawlScopeManager->IncludedInCrawlScopeEx(path, &included, &reason));
+        bool included = IsFilePathIncludedInIndex(crawlScopeManager.get(), path);
         wsearch::TelemetryProvider::LogInfo(L"Path indexed: %ls", included ? L"YES" : L"NO");
         return included;
     }
 
+    // Batch form of IsFilePathIncludedInIndex: the search, catalog and crawl scope managers are
+    // created once for all paths. For in-memory checks that follow rule changes, see
+    // CrawlScopeRuleEvaluator (SearchCrawlScopeRules.h).
+    inline std::vector<bool> AreFilePathsIncludedInIndex(const std::vector<std::wstring>& paths)
+    {
+        wsearch::TelemetryProvider::LogInfo(L"Checking if %zu paths are indexed", paths.size());
+        winrt::com_ptr<ISearchCrawlScopeManager> crawlScopeManager = GetSystemIndexCrawlScopeManager();
+
+        std::vector<bool> included(paths.size());
+        size_t includedCount = 0;
+        for (size_t i = 0; i < paths.size(); ++i)
+        {
+            included[i] = IsFilePathIncludedInIndex(crawlScopeManager.get(), paths[i].c_str());
+            includedCount += included[i] ? 1 : 0;
+        }
+        wsearch::TelemetryProvider::LogInfo(L"Paths indexed: %zu of %zu", includedCount, paths.size());
+        return included;
+    }
+
     /* INDEX QUERY OPERATIONS
     *
     *  These methods help developers with the complex nature of performance around indexer queries.
@@ -321,92 +281,116 @@ namespace details
         return totalRows;
     }
 
-    // Simple helper to execute a query against the indexer
+    // Simple helper to execute a query against the indexer, without throwing
     // NOTE: Does not have be the SystemIndex
-    inline winrt::com_ptr<IRowset> ExecuteQuery(std::wstring_view const& sql)
+    inline SearchExpected<winrt::com_ptr<IRowset>> TryExecuteQuery(std::wstring_view const& sql)
     {
         wsearch::TelemetryProvider::LogInfo(L"=== EXECUTING QUERY ===");
         wsearch::TelemetryProvider::LogInfo(L"[QUERY] %ls", sql.data());
-        
-        try
+
+        winrt::com_ptr<IDBInitialize> dataSource;
+        HRESULT hr = CoCreateInstance(CLSID_CollatorDataSource, 0, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(dataSource.put()));
+        if (FAILED(hr))
         {
-            winrt::com_ptr<IDBInitialize> dataSource;
-            HRESULT hr = CoCreateInstance(CLSID_CollatorDataSource, 0, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(dataSource.put()));
-            if (FAILED(hr))
-            {
-                wsearch::TelemetryProvider::LogError(L"[ERROR] Failed to create CollatorDataSource (0x%08X)", hr);
-                THROW_IF_FAILED(hr);
-            }
+            wsearch::TelemetryProvider::LogError(L"[ERROR] Failed to create CollatorDataSource (0x%08X)", hr);
+            return SearchError{ hr, L"CoCreateInstance(CollatorDataSource)" };
+        }
 
-            hr = dataSource->Initialize();
-            if (FAILED(hr))
-            {
-                wsearch::TelemetryProvider::LogError(L"[ERROR] Failed to initialize data source (0x%08X)", hr);
-                THROW_IF_FAILED(hr);
-            }
+        hr = dataSource->Initialize();
+        if (FAILED(hr))
+        {
+            wsearch::TelemetryProvider::LogError(L"[ERROR] Failed to initialize data source (0x%08X)", hr);
+            return SearchError{ hr, L"IDBInitialize::Initialize" };
+        }
 
-            winrt::com_ptr<IDBCreateSession> session = dataSource.as<IDBCreateSession>();
-            winrt::com_ptr<::IUnknown> unkSessionPtr;
-            hr = session->CreateSession(0, IID_IDBCreateCommand, unkSessionPtr.put());
-            if (FAILED(hr))
-            {
-                wsearch::TelemetryProvider::LogError(L"[ERROR] Failed to create session (0x%08X)", hr);
-                THROW_IF_FAILED(hr);
-            }
+        winrt::com_ptr<IDBCreateSession> session;
+        hr = dataSource->QueryInterface(IID_PPV_ARGS(session.put()));
+        if (FAILED(hr))
+        {
+            return SearchError{ hr, L"IDBInitialize::QueryInterface(IDBCreateSession)" };
+        }
 
-            winrt::com_ptr<IDBCreateCommand> createCommand = unkSessionPtr.as<IDBCreateCommand>();
-            winrt::com_ptr<::IUnknown> unkCmdPtr;
-            hr = createCommand->CreateCommand(0, IID_ICommandText, unkCmdPtr.put());
-            if (FAILED(hr))
-            {
-                wsearch::TelemetryProvider::LogError(L"[ERROR] Failed to create command (0x%08X)", hr);
-                THROW_IF_FAILED(hr);
-            }
+        winrt::com_ptr<::IUnknown> unkSessionPtr;
+        hr = session->CreateSession(0, IID_IDBCreateCommand, unkSessionPtr.put());
+        if (FAILED(hr))
+        {
+            wsearch::TelemetryProvider::LogError(L"[ERROR] Failed to create session (0x%08X)", hr);
+            return SearchError{ hr, L"IDBCreateSession::CreateSession" };
+        }
 
-            winrt::com_ptr<ICommandText> cmdTxt = unkCmdPtr.as<ICommandText>();
-            hr = cmdTxt->SetCommandText(DBGUID_DEFAULT, sql.data());
-            if (FAILED(hr))
-            {
-                wsearch::TelemetryProvider::LogError(L"[ERROR] Failed to set command text. Query may be malformed. (0x%08X)", hr);
-                wsearch::TelemetryProvider::LogError(L"[QUERY] %ls", sql.data());
-                THROW_IF_FAILED(hr);
-            }
+        winrt::com_ptr<IDBCreateCommand> createCommand;
+        hr = unkSessionPtr->QueryInterface(IID_PPV_ARGS(createCommand.put()));
+        if (FAILED(hr))
+        {
+            return SearchError{ hr, L"IUnknown::QueryInterface(IDBCreateCommand)" };
+        }
 
-            DBROWCOUNT rowCount = 0;
-            winrt::com_ptr<::IUnknown> unkRowsetPtr;
-            hr = cmdTxt->Execute(nullptr, IID_IRowset, nullptr, &rowCount, unkRowsetPtr.put());
-            if (FAILED(hr))
-            {
-                wsearch::TelemetryProvider::LogError(L"[ERROR] Failed to execute query. Check query syntax. (0x%08X)", hr);
-                wsearch::TelemetryProvider::LogError(L"[QUERY] %ls", sql.data());
-                THROW_IF_FAILED(hr);
-            }
+        winrt::com_ptr<::IUnknown> unkCmdPtr;
+        hr = createCommand->CreateCommand(0, IID_ICommandText, unkCmdPtr.put());
+        if (FAILED(hr))
+        {
+            wsearch::TelemetryProvider::LogError(L"[ERROR] Failed to create command (0x%08X)", hr);
+            return SearchError{ hr, L"IDBCreateCommand::CreateCommand" };
+        }
 
-            wsearch::TelemetryProvider::LogInfo(L"Query executed successfully. Row count: %lld", rowCount);
-            return unkRowsetPtr.as<IRowset>();
+        winrt::com_ptr<ICommandText> cmdTxt;
+        hr = unkCmdPtr->QueryInterface(IID_PPV_ARGS(cmdTxt.put()));
+        if (FAILED(hr))
+        {
+            return SearchError{ hr, L"IUnknown::QueryInterface(ICommandText)" };
+        }
+
+        hr = cmdTxt->SetCommandText(DBGUID_DEFAULT, sql.data());
+        if (FAILED(hr))
+        {
+            wsearch::TelemetryProvider::LogError(L"[ERROR] Failed to set command text. Query may be malformed. (0x%08X)", hr);
+            wsearch::TelemetryProvider::LogError(L"[QUERY] %ls", sql.data());
+            return SearchError{ hr, L"ICommandText::SetCommandText" };
         }
-        catch (const std::exception&)
+
+        DBROWCOUNT rowCount = 0;
+        winrt::com_ptr<::IUnknown> unkRowsetPtr;
+        hr = cmdTxt->Execute(nullptr, IID_IRowset, nullptr, &rowCount, unkRowsetPtr.put());
+        if (FAILED(hr))
         {
-            wsearch::TelemetryProvider::LogError(L"Exception during query execution");
-            throw;
+            wsearch::TelemetryProvider::LogError(L"[ERROR] Failed to execute query. Check query syntax. (0x%08X)", hr);
+            wsearch::TelemetryProvider::LogError(L"[QUERY] %ls", sql.data());
+            return SearchError{ hr, L"ICommandText::Execute" };
         }
-        catch (...)
+
+        winrt::com_ptr<IRowset> rowset;
+        hr = unkRowsetPtr->QueryInterface(IID_PPV_ARGS(rowset.put()));
+        if (FAILED(hr))
         {
-            wsearch::TelemetryProvider::LogError(L"Unknown exception during query execution");
-            throw;
+            return SearchError{ hr, L"IUnknown::QueryInterface(IRowset)" };
         }
+
+        wsearch::TelemetryProvider::LogInfo(L"Query executed successfully. Row count: %lld", rowCount);
+        return rowset;
     }
 
+    // Simple helper to execute a query against the indexer
+    // NOTE: Does not have be the SystemIndex
+    inline winrt::com_ptr<IRowset> ExecuteQuery(std::wstring_view const& sql)
+    {
+        return ThrowIfSearchError(TryExecuteQuery(sql));
+    }
+
+    // Calls 'callback' with each row's IPropertyStore. Failures are returned; anything the
+    // callback throws propagates after the current batch of rows is released.
     template <typename Func>
-    void EnumerateRowsWithCallback(
+    SearchExpected<void> TryEnumerateRowsWithCallback(
         _In_ IRowset* rowset,
         Func callback)
     {
         wsearch::TelemetryProvider::LogInfo(L"Enumerating rows with callback");
         winrt::com_ptr<IGetRow> getRow;
-        THROW_IF_FAILED(rowset->QueryInterface(IID_PPV_ARGS(getRow.put())));
+        HRESULT hr = rowset->QueryInterface(IID_PPV_ARGS(getRow.put()));
+        if (FAILED(hr))
+        {
+            return SearchError{ hr, L"IRowset::QueryInterface(IGetRow)" };
+        }
 
-        bool continueFetch = true;
         DBCOUNTITEM rowCountReturned;
 
         do
@@ -414,26 +398,126 @@ namespace details
             HROW rowBuffer[1000]; // Request enough large batch to increase efficiency
             HROW* rowReturned = rowBuffer;
 
-            THROW_IF_FAILED(
-                rowset->GetNextRows(DB_NULL_HCHAPTER, 0, ARRAYSIZE(rowBuffer), &rowCountReturned, &rowReturned));
+            hr = rowset->GetNextRows(DB_NULL_HCHAPTER, 0, ARRAYSIZE(rowBuffer), &rowCountReturned, &rowReturned);
+            if (FAILED(hr))
+            {
+                return SearchError{ hr, L"IRowset::GetNextRows" };
+            }
 
             wsearch::TelemetryProvider::LogInfo(L"Fetched %llu rows", static_cast<unsigned long long>(rowCountReturned));
 
-            for (unsigned int i = 0; continueFetch && (i < rowCountReturned); i++)
+            bool released = false;
+            auto releaseRows = wil::scope_exit([&]() {
+                if (!released)
+                {
+                    rowset->ReleaseRows(rowCountReturned, rowReturned, nullptr, nullptr, nullptr);
+                }
+            });
+
+            for (DBCOUNTITEM i = 0; i < rowCountReturned; i++)
             {
-                winrt::com_ptr<IPropertyStore> propStore;
                 winrt::com_ptr<IUnknown> unknown;
+                hr = getRow->GetRowFromHROW(nullptr, rowBuffer[i], __uuidof(IPropertyStore), unknown.put());
+                if (FAILED(hr))
+                {
+                    return SearchError{ hr, L"IGetRow::GetRowFromHROW" };
+                }
 
-                THROW_IF_FAILED(getRow->GetRowFromHROW(nullptr, rowBuffer[i], __uuidof(IPropertyStore), unknown.put()));
-                propStore = unknown.as<IPropertyStore>();
+                winrt::com_ptr<IPropertyStore> propStore;
+                hr = unknown->QueryInterface(IID_PPV_ARGS(propStore.put()));
+                if (FAILED(hr))
+                {
+                    return SearchError{ hr, L"IUnknown::QueryInterface(IPropertyStore)" };
+                }
 
                 callback(propStore.get());
             }
 
-            THROW_IF_FAILED(rowset->ReleaseRows(rowCountReturned, rowReturned, nullptr, nullptr, nullptr));
-        } while (continueFetch && (rowCountReturned > 0));
+            released = true;
+            hr = rowset->ReleaseRows(rowCountReturned, rowReturned, nullptr, nullptr, nullptr);
+            if (FAILED(hr))
+            {
+                return SearchError{ hr, L"IRowset::ReleaseRows" };
+            }
+        } while (rowCountReturned > 0);
 
         wsearch::TelemetryProvider::LogInfo(L"Finished enumerating rows");
+        return {};
+    }
+
+    // Fetches the rows of 'rowset' and decodes each with 'decode' (false drops the row) into a
+    // DeadlineQuery's progress, reporting the stage as it goes. Batches start small and double,
+    // so the first rows are decoded soon after Execute; cancellation is checked between rows.
+    template <typename Row, typename Decode>
+    SearchExpected<void> TryDecodeRowsInto(
+        _In_ IRowset* rowset,
+        Decode& decode,
+        typename DeadlineQuery<Row>::Progress& progress)
+    {
+        winrt::com_ptr<IGetRow> getRow;
+        HRESULT hr = rowset->QueryInterface(IID_PPV_ARGS(getRow.put()));
+        if (FAILED(hr))
+        {
+            return SearchError{ hr, L"IRowset::QueryInterface(IGetRow)" };
+        }
+
+        HROW rowBuffer[256];
+        DBCOUNTITEM batchSize = 8;
+        while (!progress.IsCancelled())
+        {
+            progress.SetStage(QueryStage::Fetch);
+            HROW* rowReturned = rowBuffer;
+            DBCOUNTITEM rowCountReturned = 0;
+            HRESULT fetched = rowset->GetNextRows(DB_NULL_HCHAPTER, 0, static_cast<DBROWCOUNT>(batchSize), &rowCountReturned, &rowReturned);
+            if (FAILED(fetched))
+            {
+                return SearchError{ fetched, L"IRowset::GetNextRows" };
+            }
+
+            auto releaseRows = wil::scope_exit([&]() {
+                rowset->ReleaseRows(rowCountReturned, rowReturned, nullptr, nullptr, nullptr);
+            });
+            progress.AddFetched(static_cast<size_t>(rowCountReturned));
+
+            progress.SetStage(QueryStage::Decode);
+            for (DBCOUNTITEM i = 0; i < rowCountReturned && !progress.IsCancelled(); i++)
+            {
+                winrt::com_ptr<IUnknown> unknown;
+                hr = getRow->GetRowFromHROW(nullptr, rowBuffer[i], __uuidof(IPropertyStore), unknown.put());
+                if (FAILED(hr))
+                {
+                    return SearchError{ hr, L"IGetRow::GetRowFromHROW" };
+                }
+
+                winrt::com_ptr<IPropertyStore> propStore;
+                hr = unknown->QueryInterface(IID_PPV_ARGS(propStore.put()));
+                if (FAILED(hr))
+                {
+                    return SearchError{ hr, L"IUnknown::QueryInterface(IPropertyStore)" };
+                }
+
+                Row row;
+                if (decode(propStore.get(), row))
+                {
+                    progress.Append(std::move(row));
+                }
+            }
+
+            if (fetched == DB_S_ENDOFROWSET || rowCountReturned < batchSize)
+            {
+                break;
+            }
+            batchSize = (std::min)(batchSize * 2, static_cast<DBCOUNTITEM>(ARRAYSIZE(rowBuffer)));
+        }
+        return {};
+    }
+
+    template <typename Func>
+    void EnumerateRowsWithCallback(
+        _In_ IRowset* rowset,
+        Func callback)
+    {
+        ThrowIfSearchError(TryEnumerateRowsWithCallback(rowset, std::move(callback)));
     }
 } // namespace details
 } // namespace wsearch
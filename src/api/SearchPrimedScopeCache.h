@@ -0,0 +1,296 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include "SearchExpected.h"
+#include "SearchSqlText.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cwctype>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace wsearch
+{
+
+/* PrimedScope - a scope set with its priming query already run
+ *
+ * Immutable once published: sessions hold it through a shared_ptr and read the scopes, SQL and
+ * WHEREID of one consistent scope set, even while SetScopes switches to another. 'rowset' is
+ * empty until the scope set has been primed.
+ */
+template <typename Rowset>
+struct PrimedScope
+{
+    std::wstring key; // normalized scope set and properties (see details::PrimedScopeKey)
+    std::vector<std::wstring> includedScopes;
+    std::vector<std::wstring> excludedScopes;
+    std::wstring sql; // the priming query; searches append their conditions to it
+    Rowset rowset{};
+    uint64_t whereId = 0; // REUSEWHERE id of 'rowset'
+
+    // Client-side bytes; the indexer's state for the open rowset is not visible from here
+    size_t GetMemoryBytes() const
+    {
+        size_t bytes = sizeof(*this) + (key.capacity() + sql.capacity()) * sizeof(wchar_t);
+        for (const auto* scopes : { &includedScopes, &excludedScopes })
+        {
+            bytes += scopes->capacity() * sizeof(std::wstring);
+            for (const auto& scope : *scopes)
+            {
+                bytes += scope.capacity() * sizeof(wchar_t);
+            }
+        }
+        return bytes;
+    }
+};
+
+/* IScopePrimer - runs a priming query
+ *
+ * Prime receives a PrimedScope with its SQL set and fills in the rowset and WHEREID, or
+ * returns the error that stopped it. Called on the thread that asked for the scope set.
+ */
+template <typename Rowset>
+class IScopePrimer
+{
+public:
+    virtual ~IScopePrimer() = default;
+
+    virtual SearchExpected<void> Prime(PrimedScope<Rowset>& scope) = 0;
+};
+
+struct PrimedScopeCacheOptions
+{
+    size_t capacity = 4; // scope sets kept primed; the least recently used is released first
+    std::chrono::steady_clock::duration idleExpiry = std::chrono::minutes(10); // zero keeps entries until evicted
+};
+
+struct PrimedScopeCacheStatistics
+{
+    uint64_t lookups = 0;
+    uint64_t hits = 0;
+    uint64_t primes = 0;        // priming queries run (misses)
+    uint64_t primeFailures = 0;
+    uint64_t evictions = 0;     // released to make room
+    uint64_t expirations = 0;   // released after idleExpiry without use
+    size_t entries = 0;         // primed rowsets held open
+    size_t memoryBytes = 0;     // client-side bytes of the cached entries
+
+    double GetHitRate() const
+    {
+        return lookups == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(lookups);
+    }
+};
+
+namespace details
+{
+    // Scopes as URLs ("file:" added, '\' as '/'), case-folded and without trailing slashes,
+    // sorted and deduplicated; then the excluded scopes the same way, then the properties
+    inline std::wstring PrimedScopeKey(const std::vector<std::wstring>& includedScopes,
+        const std::vector<std::wstring>& excludedScopes, const std::vector<std::wstring>& properties)
+    {
+        std::wstring key;
+        for (const auto* scopes : { &includedScopes, &excludedScopes })
+        {
+            std::vector<std::wstring> folded;
+            folded.reserve(scopes->size());
+            for (const auto& scope : *scopes)
+            {
+                std::wstring url;
+                AppendScopeUrl(url, scope);
+                for (wchar_t& ch : url)
+                {
+                    ch = static_cast<wchar_t>(std::towlower(ch));
+                }
+                while (url.size() > 5 && url.back() == L'/')
+                {
+                    url.pop_back();
+                }
+                folded.push_back(std::move(url));
+            }
+            std::sort(folded.begin(), folded.end());
+            folded.erase(std::unique(folded.begin(), folded.end()), folded.end());
+            for (const auto& url : folded)
+            {
+                key += url;
+                key.push_back(L'\n');
+            }
+            key.push_back(L'\x1');
+        }
+        for (const auto& property : properties)
+        {
+            key += property;
+            key.push_back(L'\n');
+        }
+        return key;
+    }
+} // namespace details
+
+/* PrimedScopeCache - recently primed scope sets, least recently used released first
+ *
+ * TryAcquire returns the primed entry for a scope set: from the cache when it is there (no
+ * indexer call at all), else after running the priming query on the calling thread. Scope sets
+ * are matched after normalization, so { L"C:\\Users\\" } and { L"file:c:/users" } share an
+ * entry. Entries unused for idleExpiry are released on the next call (an entry some caller
+ * still holds is in use), and when more than 'capacity' are cached the least recently used
+ * goes. A released entry stays alive for any session still searching through it.
+ *
+ * Two threads missing on the same scope set at once both prime it; the first to finish is
+ * cached and the other's rowset is released.
+ *
+ * Example:
+ *   wsearch::PrimedScopeCache<winrt::com_ptr<IRowset>> cache(std::make_shared<wsearch::IndexerScopePrimer>());
+ *   auto documents = cache.TryAcquire({ documentsFolder }, {}, properties);  // primes
+ *   auto pictures = cache.TryAcquire({ picturesFolder }, {}, properties);    // primes
+ *   documents = cache.TryAcquire({ documentsFolder }, {}, properties);       // cached
+ *   double hitRate = cache.GetStatistics().GetHitRate();                      // 1/3
+ */
+template <typename Rowset>
+class PrimedScopeCache
+{
+public:
+    using Scope = PrimedScope<Rowset>;
+    using Clock = std::chrono::steady_clock;
+
+    explicit PrimedScopeCache(std::shared_ptr<IScopePrimer<Rowset>> primer, PrimedScopeCacheOptions options = {})
+        : m_primer(std::move(primer))
+        , m_options(options)
+    {
+        m_options.capacity = (std::max)(m_options.capacity, static_cast<size_t>(1));
+    }
+
+    // Non-copyable
+    PrimedScopeCache(const PrimedScopeCache&) = delete;
+    PrimedScopeCache& operator=(const PrimedScopeCache&) = delete;
+
+    // The key and priming SQL of a scope set, not primed; throws std::invalid_argument for a
+    // scope that cannot be used in SQL
+    static std::shared_ptr<Scope> Describe(const std::vector<std::wstring>& includedScopes,
+        const std::vector<std::wstring>& excludedScopes, const std::vector<std::wstring>& properties)
+    {
+        auto scope = std::make_shared<Scope>();
+        scope->key = details::PrimedScopeKey(includedScopes, excludedScopes, properties);
+        scope->includedScopes = includedScopes;
+        scope->excludedScopes = excludedScopes;
+        details::AppendPrimingSql(scope->sql, includedScopes, excludedScopes, properties);
+        return scope;
+    }
+
+    SearchExpected<std::shared_ptr<const Scope>> TryAcquire(const std::vector<std::wstring>& includedScopes,
+        const std::vector<std::wstring>& excludedScopes, const std::vector<std::wstring>& properties, Clock::time_point now = Clock::now())
+    {
+        auto key = details::PrimedScopeKey(includedScopes, excludedScopes, properties);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ExpireIdleLocked(now);
+            ++m_statistics.lookups;
+            auto found = Find(key);
+            if (found != m_entries.end())
+            {
+                ++m_statistics.hits;
+                found->lastUsed = now;
+                return std::shared_ptr<const Scope>(found->scope);
+            }
+        }
+
+        // Priming runs outside the lock so hits on other scope sets are never held up by it
+        auto scope = Describe(includedScopes, excludedScopes, properties);
+        auto primed = m_primer->Prime(*scope);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_statistics.primes;
+        if (!primed)
+        {
+            ++m_statistics.primeFailures;
+            return primed.Error();
+        }
+        auto found = Find(key);
+        if (found != m_entries.end())
+        {
+            found->lastUsed = now;
+            return std::shared_ptr<const Scope>(found->scope);
+        }
+        if (m_entries.size() >= m_options.capacity)
+        {
+            auto oldest = std::min_element(m_entries.begin(), m_entries.end(),
+                [](const Entry& a, const Entry& b) { return a.lastUsed < b.lastUsed; });
+            m_entries.erase(oldest);
+            ++m_statistics.evictions;
+        }
+        m_entries.push_back({ scope, now });
+        return std::shared_ptr<const Scope>(std::move(scope));
+    }
+
+    // Releases entries unused for idleExpiry; TryAcquire does this too. Returns how many.
+    size_t ExpireIdle(Clock::time_point now = Clock::now())
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return ExpireIdleLocked(now);
+    }
+
+    void Clear()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_entries.clear();
+    }
+
+    PrimedScopeCacheStatistics GetStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        PrimedScopeCacheStatistics statistics = m_statistics;
+        statistics.entries = m_entries.size();
+        for (const auto& entry : m_entries)
+        {
+            statistics.memoryBytes += entry.scope->GetMemoryBytes();
+        }
+        return statistics;
+    }
+
+private:
+    struct Entry
+    {
+        std::shared_ptr<const Scope> scope;
+        Clock::time_point lastUsed;
+    };
+
+    // A launcher has a handful of scope sets, so a linear scan beats any index
+    typename std::vector<Entry>::iterator Find(const std::wstring& key)
+    {
+        return std::find_if(m_entries.begin(), m_entries.end(), [&key](const Entry& entry) { return entry.scope->key == key; });
+    }
+
+    size_t ExpireIdleLocked(Clock::time_point now)
+    {
+        if (m_options.idleExpiry <= Clock::duration::zero())
+        {
+            return 0;
+        }
+        // Scopes a session still searches through are not idle; their idle time starts at the
+        // first sweep after the last session lets go
+        for (auto& entry : m_entries)
+        {
+            if (entry.scope.use_count() > 1)
+            {
+                entry.lastUsed = (std::max)(entry.lastUsed, now);
+            }
+        }
+        size_t before = m_entries.size();
+        m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(),
+            [&](const Entry& entry) { return now - entry.lastUsed >= m_options.idleExpiry; }), m_entries.end());
+        size_t expired = before - m_entries.size();
+        m_statistics.expirations += expired;
+        return expired;
+    }
+
+    std::shared_ptr<IScopePrimer<Rowset>> m_primer;
+    PrimedScopeCacheOptions m_options;
+
+    mutable std::mutex m_mutex;
+    std::vector<Entry> m_entries;
+    PrimedScopeCacheStatistics m_statistics;
+};
+
+} // namespace wsearch
@@ -0,0 +1,345 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include "SearchPlatCore.h"
+#include "SearchPropertyRegistry.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace wsearch
+{
+
+namespace details
+{
+    // Fixed-capacity wide string usable in constant expressions
+    template <size_t N>
+    struct FixedWString
+    {
+        wchar_t chars[N + 1] = {};
+
+        constexpr size_t size() const
+        {
+            return N;
+        }
+
+        constexpr std::wstring_view View() const
+        {
+            return std::wstring_view(chars, N);
+        }
+    };
+
+    constexpr size_t ConstexprLength(const wchar_t* text)
+    {
+        size_t length = 0;
+        while (text[length] != L'\0')
+        {
+            ++length;
+        }
+        return length;
+    }
+
+    constexpr void ConstexprAppend(wchar_t* out, size_t& position, const wchar_t* text)
+    {
+        for (size_t i = 0; text[i] != L'\0'; ++i)
+        {
+            out[position++] = text[i];
+        }
+    }
+
+    // "A, B, C" built from each property's canonical name, at compile time
+    template <typename... Properties>
+    constexpr auto JoinPropertyNames()
+    {
+        constexpr size_t length = (ConstexprLength(Properties::Name) + ...) + 2 * (sizeof...(Properties) - 1);
+        FixedWString<length> result{};
+        size_t position = 0;
+        size_t index = 0;
+        ((ConstexprAppend(result.chars, position, (index++ == 0) ? L"" : L", "),
+          ConstexprAppend(result.chars, position, Properties::Name)), ...);
+        return result;
+    }
+
+    // How a C++ field type is bound in an OLE DB accessor and decoded from the row buffer
+    template <typename T>
+    struct ProjectionValueTraits;
+
+    template <>
+    struct ProjectionValueTraits<std::wstring>
+    {
+        // Provider allocates the string with CoTaskMemAlloc and hands ownership to us
+        static constexpr DBTYPE DbType = DBTYPE_WSTR | DBTYPE_BYREF;
+
+        static void Decode(const void* value, DBLENGTH length, std::wstring& field)
+        {
+            auto text = *static_cast<wchar_t* const*>(value);
+            if (text)
+            {
+                field.assign(text, static_cast<size_t>(length / sizeof(wchar_t)));
+                CoTaskMemFree(text);
+            }
+        }
+    };
+
+    template <typename T, DBTYPE Type>
+    struct ScalarProjectionValueTraits
+    {
+        static constexpr DBTYPE DbType = Type;
+
+        static void Decode(const void* value, DBLENGTH, T& field)
+        {
+            field = *static_cast<const T*>(value);
+        }
+    };
+
+    template <> struct ProjectionValueTraits<int32_t> : ScalarProjectionValueTraits<int32_t, DBTYPE_I4> {};
+    template <> struct ProjectionValueTraits<uint32_t> : ScalarProjectionValueTraits<uint32_t, DBTYPE_UI4> {};
+    template <> struct ProjectionValueTraits<int64_t> : ScalarProjectionValueTraits<int64_t, DBTYPE_I8> {};
+    template <> struct ProjectionValueTraits<uint64_t> : ScalarProjectionValueTraits<uint64_t, DBTYPE_UI8> {};
+    template <> struct ProjectionValueTraits<double> : ScalarProjectionValueTraits<double, DBTYPE_R8> {};
+    template <> struct ProjectionValueTraits<FILETIME> : ScalarProjectionValueTraits<FILETIME, DBTYPE_FILETIME> {};
+
+    template <>
+    struct ProjectionValueTraits<bool>
+    {
+        static constexpr DBTYPE DbType = DBTYPE_BOOL;
+
+        static void Decode(const void* value, DBLENGTH, bool& field)
+        {
+            field = (*static_cast<const VARIANT_BOOL*>(value) != VARIANT_FALSE);
+        }
+    };
+
+    // One bound column in the accessor buffer. Every supported value fits in 8 bytes.
+    struct ProjectionColumnSlot
+    {
+        DBSTATUS status;
+        DBLENGTH length;
+        alignas(8) unsigned char value[8];
+    };
+
+    class UniqueAccessor
+    {
+    public:
+        UniqueAccessor(winrt::com_ptr<IAccessor> accessor, HACCESSOR handle)
+            : m_accessor(std::move(accessor))
+            , m_handle(handle)
+        {
+        }
+
+        ~UniqueAccessor()
+        {
+            m_accessor->ReleaseAccessor(m_handle, nullptr);
+        }
+
+        UniqueAccessor(const UniqueAccessor&) = delete;
+        UniqueAccessor& operator=(const UniqueAccessor&) = delete;
+
+        HACCESSOR Get() const
+        {
+            return m_handle;
+        }
+
+    private:
+        winrt::com_ptr<IAccessor> m_accessor;
+        HACCESSOR m_handle;
+    };
+} // namespace details
+
+/* WSEARCH_PROJECTION_PROPERTY - declares a property usable in Projection<...>
+ *
+ * TypeName is the tag type, CanonicalName the property's canonical name, FieldName the member
+ * the row struct gets and FieldType its C++ type (std::wstring, int32_t, uint32_t, int64_t,
+ * uint64_t, double, bool or FILETIME). Id is the property's well-known registry id, or
+ * InvalidPropertyId for properties outside WSEARCH_WELL_KNOWN_PROPERTIES.
+ *
+ * Example:
+ *   namespace myprops { WSEARCH_PROJECTION_PROPERTY(Rating, L"System.Rating", rating, uint32_t) }
+ */
+#define WSEARCH_PROJECTION_PROPERTY(TypeName, CanonicalName, FieldName, FieldType) \
+    struct TypeName \
+    { \
+        using ValueType = FieldType; \
+        static constexpr const wchar_t* Name = CanonicalName; \
+        static constexpr ::wsearch::PropertyId Id = ::wsearch::PropertyRegistry::FindWellKnown(CanonicalName); \
+        struct Field \
+        { \
+            ValueType FieldName{}; \
+            ValueType& FieldValue() { return FieldName; } \
+            const ValueType& FieldValue() const { return FieldName; } \
+        }; \
+    };
+
+// Common properties for projections. Multi-valued properties (System.Kind, System.Author)
+// are not bindable as a single column and are left out.
+namespace props
+{
+    WSEARCH_PROJECTION_PROPERTY(ItemUrl, L"System.ItemUrl", itemUrl, std::wstring)
+    WSEARCH_PROJECTION_PROPERTY(ItemNameDisplay, L"System.ItemNameDisplay", itemNameDisplay, std::wstring)
+    WSEARCH_PROJECTION_PROPERTY(ItemPathDisplay, L"System.ItemPathDisplay", itemPathDisplay, std::wstring)
+    WSEARCH_PROJECTION_PROPERTY(FileExtension, L"System.FileExtension", fileExtension, std::wstring)
+    WSEARCH_PROJECTION_PROPERTY(Title, L"System.Title", title, std::wstring)
+    WSEARCH_PROJECTION_PROPERTY(Size, L"System.Size", size, uint64_t)
+    WSEARCH_PROJECTION_PROPERTY(DateModified, L"System.DateModified", dateModified, FILETIME)
+    WSEARCH_PROJECTION_PROPERTY(DateCreated, L"System.DateCreated", dateCreated, FILETIME)
+    WSEARCH_PROJECTION_PROPERTY(DateAccessed, L"System.DateAccessed", dateAccessed, FILETIME)
+    WSEARCH_PROJECTION_PROPERTY(GatherTime, L"System.Search.GatherTime", gatherTime, FILETIME)
+    WSEARCH_PROJECTION_PROPERTY(SearchRank, L"System.Search.Rank", rank, int32_t)
+    WSEARCH_PROJECTION_PROPERTY(ClickCount, L"System.Document.LineCount", clickCount, int32_t)
+} // namespace props
+
+// Plain struct with one member per projected property, e.g. row.itemUrl, row.size
+template <typename... Properties>
+struct ProjectionRow : Properties::Field...
+{
+};
+
+// Typed access by property tag: Get<props::Size>(row)
+template <typename Property, typename Row>
+typename Property::ValueType& Get(Row& row)
+{
+    return static_cast<typename Property::Field&>(row).FieldValue();
+}
+
+template <typename Property, typename Row>
+const typename Property::ValueType& Get(const Row& row)
+{
+    return static_cast<const typename Property::Field&>(row).FieldValue();
+}
+
+/* Projection - compile-time SELECT list and row decoder for a fixed set of properties
+ *
+ * The column list is generated at compile time from the property tags, and rows are read with
+ * one IAccessor::GetData per row into fixed offsets, then copied into a ProjectionRow in column
+ * order. There is no IPropertyStore, PROPERTYKEY lookup or PROPVARIANT in the row path, and the
+ * SELECT list and decoder cannot drift apart because both come from the same type.
+ *
+ * Example:
+ *   using Files = wsearch::Projection<wsearch::props::ItemUrl, wsearch::props::Size, wsearch::props::DateModified>;
+ *   auto sql = wsearch::SearchQueryBuilder().WithProjection<Files>().WithSearchText(L"report").Build();
+ *   auto rowset = wsearch::details::ExecuteQuery(sql);
+ *   for (const auto& row : Files::FetchRows(rowset.get(), 50))
+ *   {
+ *       std::wcout << row.itemUrl << L" " << row.size << std::endl;
+ *   }
+ */
+template <typename... Properties>
+struct Projection
+{
+    static_assert(sizeof...(Properties) > 0, "A projection needs at least one property");
+
+    using Row = ProjectionRow<Properties...>;
+
+    static constexpr size_t ColumnCount = sizeof...(Properties);
+    static constexpr auto SelectListStorage = details::JoinPropertyNames<Properties...>();
+    static constexpr std::wstring_view SelectList = SelectListStorage.View();
+
+    // Calls callback(Row&&) for each row until the rowset is exhausted or maxRows (0 = all) are read
+    template <typename Func>
+    static size_t EnumerateRows(_In_ IRowset* rowset, Func&& callback, size_t maxRows = 0)
+    {
+        details::UniqueAccessor accessor = CreateAccessor(rowset);
+        std::array<details::ProjectionColumnSlot, ColumnCount> buffer;
+
+        size_t rowsRead = 0;
+        DBCOUNTITEM rowCountReturned = 0;
+        do
+        {
+            HROW rowBuffer[256];
+            HROW* rowReturned = rowBuffer;
+            DBROWCOUNT request = ARRAYSIZE(rowBuffer);
+            if (maxRows != 0)
+            {
+                request = static_cast<DBROWCOUNT>((std::min)(static_cast<size_t>(request), maxRows - rowsRead));
+            }
+
+            HRESULT hr = rowset->GetNextRows(DB_NULL_HCHAPTER, 0, request, &rowCountReturned, &rowReturned);
+            if (hr == DB_S_ENDOFROWSET && rowCountReturned == 0)
+            {
+                break;
+            }
+            THROW_IF_FAILED(hr);
+
+            // Release the HROWs even if decoding or the callback throws
+            auto releaseRows = wil::scope_exit([&]() {
+                rowset->ReleaseRows(rowCountReturned, rowReturned, nullptr, nullptr, nullptr);
+            });
+
+            for (DBCOUNTITEM i = 0; i < rowCountReturned; ++i)
+            {
+                THROW_IF_FAILED(rowset->GetData(rowBuffer[i], accessor.Get(), buffer.data()));
+
+                Row row;
+                DecodeRow(buffer, row, std::index_sequence_for<Properties...>{});
+                callback(std::move(row));
+            }
+
+            rowsRead += static_cast<size_t>(rowCountReturned);
+        } while (rowCountReturned > 0 && (maxRows == 0 || rowsRead < maxRows));
+
+        return rowsRead;
+    }
+
+    static std::vector<Row> FetchRows(_In_ IRowset* rowset, size_t maxRows = 0)
+    {
+        std::vector<Row> rows;
+        if (maxRows != 0)
+        {
+            rows.reserve(maxRows);
+        }
+        EnumerateRows(rowset, [&rows](Row&& row) { rows.push_back(std::move(row)); }, maxRows);
+        return rows;
+    }
+
+private:
+    static details::UniqueAccessor CreateAccessor(IRowset* rowset)
+    {
+        static constexpr DBTYPE types[] = { details::ProjectionValueTraits<typename Properties::ValueType>::DbType... };
+
+        DBBINDING bindings[ColumnCount] = {};
+        for (size_t i = 0; i < ColumnCount; ++i)
+        {
+            size_t slotOffset = i * sizeof(details::ProjectionColumnSlot);
+            bindings[i].iOrdinal = static_cast<DBORDINAL>(i + 1); // ordinal 0 is the bookmark
+            bindings[i].obStatus = slotOffset + offsetof(details::ProjectionColumnSlot, status);
+            bindings[i].obLength = slotOffset + offsetof(details::ProjectionColumnSlot, length);
+            bindings[i].obValue = slotOffset + offsetof(details::ProjectionColumnSlot, value);
+            bindings[i].dwPart = DBPART_VALUE | DBPART_LENGTH | DBPART_STATUS;
+            bindings[i].dwMemOwner = DBMEMOWNER_CLIENTOWNED;
+            bindings[i].eParamIO = DBPARAMIO_NOTPARAM;
+            bindings[i].cbMaxLen = sizeof(details::ProjectionColumnSlot::value);
+            bindings[i].wType = types[i];
+        }
+
+        winrt::com_ptr<IAccessor> accessor;
+        THROW_IF_FAILED(rowset->QueryInterface(IID_PPV_ARGS(accessor.put())));
+
+        HACCESSOR handle = nullptr;
+        DBBINDSTATUS bindStatus[ColumnCount] = {};
+        THROW_IF_FAILED(accessor->CreateAccessor(DBACCESSOR_ROWDATA, ColumnCount, bindings,
+                                                 sizeof(details::ProjectionColumnSlot) * ColumnCount, &handle, bindStatus));
+        return details::UniqueAccessor(std::move(accessor), handle);
+    }
+
+    template <size_t... Index>
+    static void DecodeRow(const std::array<details::ProjectionColumnSlot, ColumnCount>& buffer, Row& row, std::index_sequence<Index...>)
+    {
+        (DecodeColumn<Properties>(buffer[Index], row), ...);
+    }
+
+    template <typename Property>
+    static void DecodeColumn(const details::ProjectionColumnSlot& slot, Row& row)
+    {
+        // DBSTATUS_S_ISNULL and conversion failures leave the field value-initialized
+        if (slot.status == DBSTATUS_S_OK)
+        {
+            details::ProjectionValueTraits<typename Property::ValueType>::Decode(slot.value, slot.length, Get<Property>(row));
+        }
+    }
+};
+
+} // namespace wsearch
@@ -0,0 +1,450 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include "SearchSqlEscape.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace wsearch
+{
+
+// Small integer standing for a property everywhere below the public string APIs
+using PropertyId = uint16_t;
+constexpr PropertyId InvalidPropertyId = 0xFFFF;
+
+// The value type a property is expected to have (its VARTYPE in the property schema)
+enum class PropertyValueType : uint8_t
+{
+    Unknown,
+    String,
+    StringVector,
+    Int32,
+    UInt32,
+    Int64,
+    UInt64,
+    Double,
+    Bool,
+    FileTime,
+};
+
+// A PROPERTYKEY without the Windows headers (see details::ToPropertyKey in SearchPropertySchemaSource.h)
+struct PropertyKeyValue
+{
+    uint32_t data1;
+    uint16_t data2;
+    uint16_t data3;
+    uint8_t data4[8];
+    uint32_t pid;
+};
+
+struct PropertyInfo
+{
+    PropertyId id = InvalidPropertyId;
+    std::wstring_view name;     // canonical name; lives as long as the registry
+    PropertyKeyValue key{};
+    bool hasKey = false;        // false for interned names the schema could not describe
+    PropertyValueType type = PropertyValueType::Unknown;
+};
+
+/* WSEARCH_WELL_KNOWN_PROPERTIES - the properties the library itself selects, sorts or reads
+ *
+ * X(Id, CanonicalName, ValueType, fmtid..., pid). Their ids are the positions in this list,
+ * so appending is fine but reordering changes ids.
+ */
+#define WSEARCH_WELL_KNOWN_PROPERTIES(X) \
+    X(ItemUrl,               L"System.ItemUrl",               String,       0x49691C90, 0x7E17, 0x101A, 0xA9, 0x1C, 0x08, 0x00, 0x2B, 0x2E, 0xCD, 0xA9, 9) \
+    X(SearchRank,            L"System.Search.Rank",           Int32,        0x49691C90, 0x7E17, 0x101A, 0xA9, 0x1C, 0x08, 0x00, 0x2B, 0x2E, 0xCD, 0xA9, 3) \
+    X(DocumentLineCount,     L"System.Document.LineCount",    Int32,        0xD5CDD502, 0x2E9C, 0x101B, 0x93, 0x97, 0x08, 0x00, 0x2B, 0x2C, 0xF9, 0xAE, 5) \
+    X(DateAccessed,          L"System.DateAccessed",          FileTime,     0xB725F130, 0x47EF, 0x101A, 0xA5, 0xF1, 0x02, 0x60, 0x8C, 0x9E, 0xEB, 0xAC, 16) \
+    X(ItemNameDisplay,       L"System.ItemNameDisplay",       String,       0xB725F130, 0x47EF, 0x101A, 0xA5, 0xF1, 0x02, 0x60, 0x8C, 0x9E, 0xEB, 0xAC, 10) \
+    X(Kind,                  L"System.Kind",                  StringVector, 0x1E3EE840, 0xBC2B, 0x476C, 0x82, 0x37, 0x2A, 0xCD, 0x1A, 0x83, 0x9B, 0x22, 3) \
+    X(FileExtension,         L"System.FileExtension",         String,       0xE4F10A3C, 0x49E6, 0x405D, 0x82, 0x88, 0xA2, 0x3B, 0xD4, 0xEE, 0xAA, 0x6C, 100) \
+    X(Size,                  L"System.Size",                  UInt64,       0xB725F130, 0x47EF, 0x101A, 0xA5, 0xF1, 0x02, 0x60, 0x8C, 0x9E, 0xEB, 0xAC, 12) \
+    X(DateCreated,           L"System.DateCreated",           FileTime,     0xB725F130, 0x47EF, 0x101A, 0xA5, 0xF1, 0x02, 0x60, 0x8C, 0x9E, 0xEB, 0xAC, 15) \
+    X(DateModified,          L"System.DateModified",          FileTime,     0xB725F130, 0x47EF, 0x101A, 0xA5, 0xF1, 0x02, 0x60, 0x8C, 0x9E, 0xEB, 0xAC, 14) \
+    X(SearchGatherTime,      L"System.Search.GatherTime",     FileTime,     0x0B63E350, 0x9CCC, 0x11D0, 0xBC, 0xDB, 0x00, 0x80, 0x5F, 0xCC, 0xCE, 0x04, 8) \
+    X(FileAttributes,        L"System.FileAttributes",        UInt32,       0xB725F130, 0x47EF, 0x101A, 0xA5, 0xF1, 0x02, 0x60, 0x8C, 0x9E, 0xEB, 0xAC, 13) \
+    X(FileName,              L"System.FileName",              String,       0x41CF5AE0, 0xF75A, 0x4806, 0xBD, 0x87, 0x59, 0xC7, 0xD9, 0x24, 0x8E, 0xB9, 100) \
+    X(ItemPathDisplay,       L"System.ItemPathDisplay",       String,       0xE3E0584C, 0xB788, 0x4A5A, 0xBB, 0x20, 0x7F, 0x5A, 0x44, 0xC9, 0xAC, 0xDD, 7) \
+    X(ItemFolderPathDisplay, L"System.ItemFolderPathDisplay", String,       0xE3E0584C, 0xB788, 0x4A5A, 0xBB, 0x20, 0x7F, 0x5A, 0x44, 0xC9, 0xAC, 0xDD, 6) \
+    X(ItemType,              L"System.ItemType",              String,       0x28636AA6, 0x953D, 0x11D2, 0xB5, 0xD6, 0x00, 0xC0, 0x4F, 0xD9, 0x18, 0xD0, 11) \
+    X(PerceivedType,         L"System.PerceivedType",         Int32,        0x28636AA6, 0x953D, 0x11D2, 0xB5, 0xD6, 0x00, 0xC0, 0x4F, 0xD9, 0x18, 0xD0, 9) \
+    X(ItemDate,              L"System.ItemDate",              FileTime,     0xF7DB74B4, 0x4287, 0x4103, 0xAF, 0xBA, 0xF1, 0xB1, 0x3D, 0xCD, 0x75, 0xCF, 100) \
+    X(Title,                 L"System.Title",                 String,       0xF29F85E0, 0x4FF9, 0x1068, 0xAB, 0x91, 0x08, 0x00, 0x2B, 0x27, 0xB3, 0xD9, 2) \
+    X(Author,                L"System.Author",                StringVector, 0xF29F85E0, 0x4FF9, 0x1068, 0xAB, 0x91, 0x08, 0x00, 0x2B, 0x27, 0xB3, 0xD9, 4) \
+    X(Keywords,              L"System.Keywords",              StringVector, 0xF29F85E0, 0x4FF9, 0x1068, 0xAB, 0x91, 0x08, 0x00, 0x2B, 0x27, 0xB3, 0xD9, 5) \
+    X(Comment,               L"System.Comment",               String,       0xF29F85E0, 0x4FF9, 0x1068, 0xAB, 0x91, 0x08, 0x00, 0x2B, 0x27, 0xB3, 0xD9, 6) \
+    X(MIMEType,              L"System.MIMEType",              String,       0x0B63E350, 0x9CCC, 0x11D0, 0xBC, 0xDB, 0x00, 0x80, 0x5F, 0xCC, 0xCE, 0x04, 5) \
+    X(SearchAutoSummary,     L"System.Search.AutoSummary",    String,       0x560C36C0, 0x503A, 0x11CF, 0xBA, 0xA1, 0x00, 0x00, 0x4C, 0x75, 0x2A, 0x9A, 2)
+
+// Ids of the well-known properties: propid::ItemUrl, propid::Size, ...
+namespace propid
+{
+#define WSEARCH_PROPERTY_ID(Id, Name, Type, d1, d2, d3, b0, b1, b2, b3, b4, b5, b6, b7, pid) Id,
+    enum : PropertyId
+    {
+        WSEARCH_WELL_KNOWN_PROPERTIES(WSEARCH_PROPERTY_ID)
+        WellKnownCount
+    };
+#undef WSEARCH_PROPERTY_ID
+} // namespace propid
+
+namespace details
+{
+#define WSEARCH_PROPERTY_INFO(Id, Name, Type, d1, d2, d3, b0, b1, b2, b3, b4, b5, b6, b7, pid) \
+    PropertyInfo{ propid::Id, Name, { d1, d2, d3, { b0, b1, b2, b3, b4, b5, b6, b7 }, pid }, true, PropertyValueType::Type },
+    inline constexpr PropertyInfo c_wellKnownProperties[] = { WSEARCH_WELL_KNOWN_PROPERTIES(WSEARCH_PROPERTY_INFO) };
+#undef WSEARCH_PROPERTY_INFO
+
+    // Property names compare case-insensitively and are ASCII in practice
+    constexpr wchar_t FoldPropertyNameChar(wchar_t ch)
+    {
+        return (ch >= L'A' && ch <= L'Z') ? static_cast<wchar_t>(ch + (L'a' - L'A')) : ch;
+    }
+
+    constexpr bool PropertyNamesEqual(std::wstring_view left, std::wstring_view right)
+    {
+        if (left.size() != right.size())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < left.size(); ++i)
+        {
+            if (FoldPropertyNameChar(left[i]) != FoldPropertyNameChar(right[i]))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Case-folded FNV-1a of the whole name
+    constexpr uint32_t HashPropertyName(std::wstring_view name)
+    {
+        uint32_t hash = 2166136261u;
+        for (wchar_t ch : name)
+        {
+            hash ^= static_cast<uint32_t>(FoldPropertyNameChar(ch));
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+    // Constant-time hash for the perfect hash: the length and four folded characters (past the
+    // shared "System." prefix and at the end) tell the well-known names apart, and the seed
+    // spreads them into distinct slots. The final compare rejects every other name.
+    constexpr uint32_t HashWellKnownPropertyName(std::wstring_view name, uint32_t seed)
+    {
+        uint32_t hash = (2166136261u ^ seed) + static_cast<uint32_t>(name.size()) * 0x9E3779B1u;
+        if (!name.empty())
+        {
+            size_t last = name.size() - 1;
+            for (size_t position : { (std::min)(size_t(7), last), (std::min)(size_t(8), last), last / 2 + 4 <= last ? last / 2 + 4 : last, last })
+            {
+                hash ^= static_cast<uint32_t>(FoldPropertyNameChar(name[position]));
+                hash *= 16777619u;
+            }
+        }
+        hash ^= hash >> 15;
+        hash *= 0x2C1B3C6Du;
+        hash ^= hash >> 12;
+        return hash;
+    }
+
+    constexpr size_t c_wellKnownPropertySlots = 128;
+    static_assert(propid::WellKnownCount * 3 <= c_wellKnownPropertySlots, "Grow the well-known property hash table");
+
+    // Perfect hash of the well-known names: slot -> id, or InvalidPropertyId for an empty slot
+    struct WellKnownPropertyHash
+    {
+        uint32_t seed = 0;
+        PropertyId slots[c_wellKnownPropertySlots] = {};
+    };
+
+    // Tries seeds until every well-known name lands in its own slot
+    constexpr WellKnownPropertyHash BuildWellKnownPropertyHash()
+    {
+        WellKnownPropertyHash table{};
+        for (uint32_t seed = 1; seed < 10000; ++seed)
+        {
+            for (auto& slot : table.slots)
+            {
+                slot = InvalidPropertyId;
+            }
+
+            bool collided = false;
+            for (const auto& property : c_wellKnownProperties)
+            {
+                auto& slot = table.slots[HashWellKnownPropertyName(property.name, seed) % c_wellKnownPropertySlots];
+                if (slot != InvalidPropertyId)
+                {
+                    collided = true;
+                    break;
+                }
+                slot = property.id;
+            }
+
+            if (!collided)
+            {
+                table.seed = seed;
+                return table;
+            }
+        }
+        return table;
+    }
+
+    inline constexpr WellKnownPropertyHash c_wellKnownPropertyHash = BuildWellKnownPropertyHash();
+    static_assert(c_wellKnownPropertyHash.seed != 0, "No perfect hash seed for the well-known properties");
+} // namespace details
+
+/* IPropertySchemaSource - describes property names the registry does not know
+ *
+ * Called once per new name, under the registry's lock. Returns false for names the schema
+ * does not have; they are interned anyway, without a key.
+ */
+class IPropertySchemaSource
+{
+public:
+    virtual ~IPropertySchemaSource() = default;
+
+    virtual bool Describe(std::wstring_view name, std::wstring& canonicalName, PropertyKeyValue& key, PropertyValueType& type) = 0;
+};
+
+/* PropertyIdSet - set of property ids, one bit each
+ *
+ * Ids below 64 (all the well-known ones) live in the object itself, so a set of well-known
+ * properties never allocates.
+ *
+ * Example:
+ *   PropertyIdSet selected;
+ *   if (selected.Insert(id)) { AppendColumn(id); }
+ */
+class PropertyIdSet
+{
+public:
+    // Returns false if the id was already in the set
+    bool Insert(PropertyId id)
+    {
+        uint64_t& word = GetWord(id);
+        uint64_t bit = uint64_t(1) << (id % 64);
+        bool inserted = (word & bit) == 0;
+        word |= bit;
+        return inserted;
+    }
+
+    bool Contains(PropertyId id) const
+    {
+        size_t index = id / 64;
+        uint64_t word = (index == 0) ? m_first : (index - 1 < m_rest.size() ? m_rest[index - 1] : 0);
+        return (word & (uint64_t(1) << (id % 64))) != 0;
+    }
+
+private:
+    uint64_t& GetWord(PropertyId id)
+    {
+        size_t index = id / 64;
+        if (index == 0)
+        {
+            return m_first;
+        }
+        if (index > m_rest.size())
+        {
+            m_rest.resize(index);
+        }
+        return m_rest[index - 1];
+    }
+
+    uint64_t m_first = 0;
+    std::vector<uint64_t> m_rest;
+};
+
+/* PropertyRegistry - maps property names to small ids, canonical names, keys and value types
+ *
+ * The well-known properties (WSEARCH_WELL_KNOWN_PROPERTIES) resolve through a perfect hash
+ * built at compile time: one hash, one folded compare, no lock. Other names are interned on
+ * first use, described by the optional schema source, and get ids from propid::WellKnownCount
+ * up. Names compare case-insensitively, so "system.size" and "System.Size" are one id.
+ *
+ * Example:
+ *   auto& registry = wsearch::details::GetSharedPropertyRegistry(); // SearchPropertySchemaSource.h
+ *   PropertyId rating = registry.Intern(L"System.Rating");
+ *   std::wstring_view name = registry.GetName(rating);
+ *   static_assert(wsearch::PropertyRegistry::FindWellKnown(L"System.Size") == wsearch::propid::Size);
+ */
+class PropertyRegistry
+{
+public:
+    explicit PropertyRegistry(std::shared_ptr<IPropertySchemaSource> schema = nullptr)
+        : m_schema(std::move(schema))
+    {
+    }
+
+    // Non-copyable
+    PropertyRegistry(const PropertyRegistry&) = delete;
+    PropertyRegistry& operator=(const PropertyRegistry&) = delete;
+
+    // Id of a well-known property name, or InvalidPropertyId; usable in constant expressions
+    static constexpr PropertyId FindWellKnown(std::wstring_view name)
+    {
+        PropertyId id = details::c_wellKnownPropertyHash.slots[
+            details::HashWellKnownPropertyName(name, details::c_wellKnownPropertyHash.seed) % details::c_wellKnownPropertySlots];
+        if (id == InvalidPropertyId)
+        {
+            return InvalidPropertyId;
+        }
+
+        // Canonical spelling is the common case and compares with wmemcmp; then fold case
+        std::wstring_view known = details::c_wellKnownProperties[id].name;
+        if (known == name || details::PropertyNamesEqual(known, name))
+        {
+            return id;
+        }
+        return InvalidPropertyId;
+    }
+
+    // Id of a well-known or already interned name, or InvalidPropertyId
+    PropertyId Find(std::wstring_view name) const
+    {
+        PropertyId id = FindWellKnown(name);
+        if (id != InvalidPropertyId)
+        {
+            return id;
+        }
+
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        auto it = m_idsByName.find(name);
+        return (it != m_idsByName.end()) ? it->second : InvalidPropertyId;
+    }
+
+    // Id of the name, interning it if it is new
+    PropertyId Intern(std::wstring_view name)
+    {
+        PropertyId id = FindWellKnown(name);
+        if (id != InvalidPropertyId)
+        {
+            return id;
+        }
+
+        {
+            std::shared_lock<std::shared_mutex> lock(m_mutex);
+            auto it = m_idsByName.find(name);
+            if (it != m_idsByName.end())
+            {
+                return it->second;
+            }
+        }
+
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        auto it = m_idsByName.find(name);
+        if (it != m_idsByName.end())
+        {
+            return it->second;
+        }
+        if (propid::WellKnownCount + m_interned.size() >= InvalidPropertyId)
+        {
+            throw std::length_error("Too many distinct property names");
+        }
+
+        PropertyInfo info;
+        info.id = static_cast<PropertyId>(propid::WellKnownCount + m_interned.size());
+        std::wstring canonicalName;
+        if (m_schema && m_schema->Describe(name, canonicalName, info.key, info.type))
+        {
+            info.hasKey = true;
+        }
+        else
+        {
+            canonicalName.assign(name);
+        }
+        m_names.push_back(std::move(canonicalName));
+        info.name = m_names.back();
+        m_idsByName.emplace(info.name, info.id);
+
+        // The schema may know the name under another spelling; both find the id
+        if (!details::PropertyNamesEqual(info.name, name))
+        {
+            m_names.emplace_back(name);
+            m_idsByName.emplace(m_names.back(), info.id);
+        }
+
+        m_interned.push_back(info);
+        return info.id;
+    }
+
+    // Throws std::out_of_range for ids this registry did not hand out
+    PropertyInfo GetInfo(PropertyId id) const
+    {
+        if (id < propid::WellKnownCount)
+        {
+            return details::c_wellKnownProperties[id];
+        }
+
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_interned.at(id - propid::WellKnownCount);
+    }
+
+    std::wstring_view GetName(PropertyId id) const
+    {
+        return GetInfo(id).name;
+    }
+
+    // Number of names interned beyond the well-known ones
+    size_t GetInternedCount() const
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_interned.size();
+    }
+
+private:
+    struct NameHash
+    {
+        size_t operator()(std::wstring_view name) const
+        {
+            return details::HashPropertyName(name);
+        }
+    };
+
+    struct NameEqual
+    {
+        bool operator()(std::wstring_view left, std::wstring_view right) const
+        {
+            return details::PropertyNamesEqual(left, right);
+        }
+    };
+
+    std::shared_ptr<IPropertySchemaSource> m_schema;
+
+    mutable std::shared_mutex m_mutex;
+    std::deque<std::wstring> m_names; // stable storage for the map keys and PropertyInfo::name
+    std::unordered_map<std::wstring_view, PropertyId, NameHash, NameEqual> m_idsByName;
+    std::vector<PropertyInfo> m_interned;
+};
+
+namespace details
+{
+    // "A, B, C" from the properties' canonical names (checked, see CheckPropertyName)
+    template <typename String>
+    void AppendPropertySelectList(String& out, const std::vector<PropertyId>& properties, const PropertyRegistry& registry)
+    {
+        for (size_t i = 0; i < properties.size(); ++i)
+        {
+            if (i > 0)
+            {
+                out.append(L", ");
+            }
+            AppendPropertyName(out, registry.GetName(properties[i]));
+        }
+    }
+} // namespace details
+
+} // namespace wsearch
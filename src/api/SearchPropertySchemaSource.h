@@ -0,0 +1,104 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include <propsys.h>
+#include <winrt/base.h>
+#include <wil/resource.h>
+#include "SearchPropertyRegistry.h"
+
+namespace wsearch
+{
+
+namespace details
+{
+    inline PROPERTYKEY ToPropertyKey(const PropertyKeyValue& key)
+    {
+        PROPERTYKEY result{};
+        result.fmtid.Data1 = key.data1;
+        result.fmtid.Data2 = key.data2;
+        result.fmtid.Data3 = key.data3;
+        for (size_t i = 0; i < 8; ++i)
+        {
+            result.fmtid.Data4[i] = key.data4[i];
+        }
+        result.pid = key.pid;
+        return result;
+    }
+
+    inline PropertyKeyValue FromPropertyKey(const PROPERTYKEY& key)
+    {
+        PropertyKeyValue result{};
+        result.data1 = key.fmtid.Data1;
+        result.data2 = key.fmtid.Data2;
+        result.data3 = key.fmtid.Data3;
+        for (size_t i = 0; i < 8; ++i)
+        {
+            result.data4[i] = key.fmtid.Data4[i];
+        }
+        result.pid = key.pid;
+        return result;
+    }
+
+    inline PropertyValueType ToPropertyValueType(VARTYPE type)
+    {
+        switch (type)
+        {
+        case VT_LPWSTR: case VT_BSTR: return PropertyValueType::String;
+        case VT_VECTOR | VT_LPWSTR: return PropertyValueType::StringVector;
+        case VT_I4: case VT_INT: return PropertyValueType::Int32;
+        case VT_UI4: case VT_UINT: return PropertyValueType::UInt32;
+        case VT_I8: return PropertyValueType::Int64;
+        case VT_UI8: return PropertyValueType::UInt64;
+        case VT_R8: return PropertyValueType::Double;
+        case VT_BOOL: return PropertyValueType::Bool;
+        case VT_FILETIME: return PropertyValueType::FileTime;
+        default: return PropertyValueType::Unknown;
+        }
+    }
+} // namespace details
+
+/* PropertySystemSchemaSource - IPropertySchemaSource backed by the Windows property system
+ *
+ * Looks names up with PSGetPropertyDescriptionByName, which takes canonical names only, and
+ * reports the registered canonical spelling, key and value type.
+ */
+class PropertySystemSchemaSource : public IPropertySchemaSource
+{
+public:
+    bool Describe(std::wstring_view name, std::wstring& canonicalName, PropertyKeyValue& key, PropertyValueType& type) override
+    {
+        std::wstring terminated(name);
+        winrt::com_ptr<IPropertyDescription> description;
+        if (FAILED(PSGetPropertyDescriptionByName(terminated.c_str(), IID_PPV_ARGS(description.put()))))
+        {
+            return false;
+        }
+
+        PROPERTYKEY propertyKey{};
+        wil::unique_cotaskmem_string registeredName;
+        VARTYPE valueType = VT_EMPTY;
+        if (FAILED(description->GetPropertyKey(&propertyKey)) ||
+            FAILED(description->GetCanonicalName(&registeredName)) ||
+            FAILED(description->GetPropertyType(&valueType)))
+        {
+            return false;
+        }
+
+        canonicalName = registeredName.get();
+        key = details::FromPropertyKey(propertyKey);
+        type = details::ToPropertyValueType(valueType);
+        return true;
+    }
+};
+
+namespace details
+{
+    // The process-wide registry; names it interns are described by the property system
+    inline PropertyRegistry& GetSharedPropertyRegistry()
+    {
+        static PropertyRegistry registry(std::make_shared<PropertySystemSchemaSource>());
+        return registry;
+    }
+} // namespace details
+
+} // namespace wsearch
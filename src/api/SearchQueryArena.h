@@ -0,0 +1,240 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+namespace wsearch
+{
+
+// Parts of the per-query pipeline that allocations are charged to
+enum class QueryAllocationStage : uint8_t
+{
+    Other = 0,
+    Scopes,   // priming SQL for the scope set
+    Tokenize, // the cost model's tokens (QueryPlan)
+    Sql,      // the search query itself
+    Logging,  // strings built only to be logged, e.g. QueryPlan::AppendDescription
+    Results,  // decoded result rows
+};
+
+constexpr size_t QueryAllocationStageCount = 6;
+
+inline const wchar_t* QueryAllocationStageName(QueryAllocationStage stage)
+{
+    switch (stage)
+    {
+    case QueryAllocationStage::Scopes: return L"Scopes";
+    case QueryAllocationStage::Tokenize: return L"Tokenize";
+    case QueryAllocationStage::Sql: return L"Sql";
+    case QueryAllocationStage::Logging: return L"Logging";
+    case QueryAllocationStage::Results: return L"Results";
+    default: return L"Other";
+    }
+}
+
+/* AllocationCountingResource - memory_resource that counts what passes through it
+ *
+ * Forwards to an upstream resource and charges every allocation to the current stage.
+ * Not thread-safe: use one per query (or per thread), which is how the pipeline uses it.
+ *
+ * Example:
+ *   wsearch::AllocationCountingResource counter;
+ *   {
+ *       wsearch::AllocationStageScope stage(&counter, wsearch::QueryAllocationStage::Sql);
+ *       std::pmr::wstring sql(L"SELECT System.ItemUrl FROM SystemIndex", &counter);
+ *   }
+ *   auto sqlAllocations = counter.GetCounters(wsearch::QueryAllocationStage::Sql).allocations;
+ */
+class AllocationCountingResource : public std::pmr::memory_resource
+{
+public:
+    struct Counters
+    {
+        size_t allocations = 0;
+        size_t deallocations = 0;
+        size_t bytes = 0;
+    };
+
+    explicit AllocationCountingResource(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : m_upstream(upstream)
+    {
+    }
+
+    QueryAllocationStage GetStage() const
+    {
+        return m_stage;
+    }
+
+    void SetStage(QueryAllocationStage stage)
+    {
+        m_stage = stage;
+    }
+
+    const Counters& GetCounters(QueryAllocationStage stage) const
+    {
+        return m_counters[static_cast<size_t>(stage)];
+    }
+
+    Counters GetTotal() const
+    {
+        Counters total;
+        for (const auto& counters : m_counters)
+        {
+            total.allocations += counters.allocations;
+            total.deallocations += counters.deallocations;
+            total.bytes += counters.bytes;
+        }
+        return total;
+    }
+
+    void Reset()
+    {
+        m_counters = {};
+    }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        auto& counters = m_counters[static_cast<size_t>(m_stage)];
+        ++counters.allocations;
+        counters.bytes += bytes;
+        return m_upstream->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override
+    {
+        ++m_counters[static_cast<size_t>(m_stage)].deallocations;
+        m_upstream->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+    {
+        return this == &other;
+    }
+
+private:
+    std::pmr::memory_resource* m_upstream;
+    QueryAllocationStage m_stage = QueryAllocationStage::Other;
+    std::array<Counters, QueryAllocationStageCount> m_counters{};
+};
+
+class QueryArena;
+
+// Charges allocations in the enclosing block to 'stage'. A null resource (or one that is
+// not an AllocationCountingResource) makes this a no-op. On a QueryArena the stage is set on
+// the arena's own counters and on its upstream, if that counts too.
+class AllocationStageScope
+{
+public:
+    AllocationStageScope(std::pmr::memory_resource* resource, QueryAllocationStage stage)
+    {
+        Enter(0, dynamic_cast<AllocationCountingResource*>(resource), stage);
+    }
+
+    AllocationStageScope(QueryArena& arena, QueryAllocationStage stage);
+
+    ~AllocationStageScope()
+    {
+        for (size_t i = 0; i < m_counters.size(); ++i)
+        {
+            if (m_counters[i])
+            {
+                m_counters[i]->SetStage(m_previous[i]);
+            }
+        }
+    }
+
+    AllocationStageScope(const AllocationStageScope&) = delete;
+    AllocationStageScope& operator=(const AllocationStageScope&) = delete;
+
+private:
+    void Enter(size_t slot, AllocationCountingResource* counter, QueryAllocationStage stage)
+    {
+        m_counters[slot] = counter;
+        if (counter)
+        {
+            m_previous[slot] = counter->GetStage();
+            counter->SetStage(stage);
+        }
+    }
+
+    std::array<AllocationCountingResource*, 2> m_counters{};
+    std::array<QueryAllocationStage, 2> m_previous{};
+};
+
+/* QueryArena - monotonic arena for everything one query allocates
+ *
+ * The first InlineBytes come from a buffer inside the arena object, which is enough for the SQL
+ * of a typical query including string growth; beyond that the arena grabs geometrically growing
+ * blocks from the upstream resource. Deallocation is a no-op and
+ * the whole arena is returned in one shot when it is destroyed, so strings and vectors built
+ * for one query cost a pointer bump each. Keep the arena alive (e.g. in a shared_ptr next to
+ * the results) for as long as anything allocated from it is in use.
+ *
+ * Every allocation the arena serves is charged to the current stage (see AllocationStageScope),
+ * so GetCounters shows what each stage allocates even when none of it reaches the heap. An
+ * AllocationCountingResource as the upstream counts the heap blocks behind them.
+ *
+ * Example:
+ *   wsearch::QueryArena arena;
+ *   wsearch::AllocationStageScope stage(arena, wsearch::QueryAllocationStage::Sql);
+ *   std::pmr::wstring sql = wsearch::details::BuildSearchWhereClause(L"report", arena.Resource());
+ *   size_t sqlAllocations = arena.GetCounters(wsearch::QueryAllocationStage::Sql).allocations;
+ */
+class QueryArena
+{
+public:
+    static constexpr size_t InlineBytes = 8192;
+
+    explicit QueryArena(std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : m_upstream(upstream)
+        , m_resource(m_inlineBuffer.data(), m_inlineBuffer.size(), upstream)
+        , m_counter(&m_resource)
+    {
+    }
+
+    QueryArena(const QueryArena&) = delete;
+    QueryArena& operator=(const QueryArena&) = delete;
+
+    std::pmr::memory_resource* Resource()
+    {
+        return &m_counter;
+    }
+
+    // Allocations the arena served while 'stage' was current
+    const AllocationCountingResource::Counters& GetCounters(QueryAllocationStage stage) const
+    {
+        return m_counter.GetCounters(stage);
+    }
+
+    // Resource the arena draws blocks from when the inline buffer runs out
+    std::pmr::memory_resource* Upstream() const
+    {
+        return m_upstream;
+    }
+
+    // Return everything to the upstream resource; only valid once nothing from the arena is in use
+    void Release()
+    {
+        m_resource.release();
+    }
+
+private:
+    friend class AllocationStageScope;
+
+    std::array<std::byte, InlineBytes> m_inlineBuffer;
+    std::pmr::memory_resource* m_upstream;
+    std::pmr::monotonic_buffer_resource m_resource;
+    AllocationCountingResource m_counter;
+};
+
+inline AllocationStageScope::AllocationStageScope(QueryArena& arena, QueryAllocationStage stage)
+{
+    Enter(0, &arena.m_counter, stage);
+    Enter(1, dynamic_cast<AllocationCountingResource*>(arena.m_upstream), stage);
+}
+
+} // namespace wsearch
@@ -2,7 +2,13 @@
 #pragma once
 
 #include "WSearchLogging.h"
+#include "SearchQueryCost.h"
+#include "SearchFilters.h"
+#include "SearchPropertySchemaSource.h"
+#include "SearchResultOrdering.h"
+#include "SearchSqlText.h"
 #include "SearchTokenizer.h"
+#include <optional>
 #include <string>
 #include <vector>
 #include <sstream>
@@ -17,6 +23,9 @@ namespace wsearch
  * - Scope filtering
  * - Additional property selection
  * - Multi-word tokenization support
+ * - Optional cost-based rewriting of expensive search text (see SearchQueryCost.h)
+ * - Optional client-side tie-breaking, so the indexer only sorts by rank (see SearchResultOrdering.h)
+ * - Kind, extension, size and date filters in the WHERE clause (see SearchFilters.h)
  * 
  * Example:
  *   SearchQueryBuilder builder;
@@ -50,17 +59,46 @@ public:
         return *this;
     }
 
-    // Set additional properties to retrieve
+    // Set additional properties to retrieve; names are resolved through the shared property registry
     SearchQueryBuilder& WithProperties(const std::vector<std::wstring>& properties)
+    {
+        auto& registry = details::GetSharedPropertyRegistry();
+        m_additionalProperties.clear();
+        for (const auto& property : properties)
+        {
+            m_additionalProperties.push_back(registry.Intern(property));
+        }
+        return *this;
+    }
+
+    // Set additional properties to retrieve by id (propid::Size, or an id from PropertyRegistry::Intern)
+    SearchQueryBuilder& WithPropertyIds(const std::vector<PropertyId>& properties)
     {
         m_additionalProperties = properties;
         return *this;
     }
 
+    // Select exactly the columns of a Projection, in its order, instead of the default column set
+    // so rows can be decoded with Projection::FetchRows (see SearchProjection.h)
+    template <typename ProjectionType>
+    SearchQueryBuilder& WithProjection()
+    {
+        m_projectionColumns = ProjectionType::SelectList;
+        return *this;
+    }
+
     // Set the search text
     SearchQueryBuilder& WithSearchText(std::wstring_view searchText)
     {
-        m_searchText = searchText;
+        m_searchText = details::LimitSearchText(searchText);
+        return *this;
+    }
+
+    // Add filter predicates to the WHERE clause, normally FilterPlan::pushed from a FilterPlanner;
+    // predicates it leaves client-side need their columns selected (the core columns cover them)
+    SearchQueryBuilder& WithFilters(const std::vector<FilterPredicate>& filters)
+    {
+        m_filters = filters;
         return *this;
     }
 
@@ -78,10 +116,43 @@ public:
         return *this;
     }
 
+    // Let a QueryCostModel rewrite expensive search text: short prefixes match file names only,
+    // stop-words and long AND chains are trimmed, and a TOP N is added when none was set
+    SearchQueryBuilder& WithCostPolicy(const QueryCostPolicy& policy)
+    {
+        m_costPolicy = policy;
+        return *this;
+    }
+
+    // Have the indexer sort by System.Search.Rank only and fetch 'headroom' rows past TOP N;
+    // launch count, DateAccessed and GatherTime ties are then broken client-side with
+    // BuildResultOrderKeys and OrderTopResults, which is much cheaper than an indexer sort on
+    // four keys over every match when only the first page is shown
+    SearchQueryBuilder& WithClientSideOrdering(size_t headroom = c_defaultOrderingHeadroom)
+    {
+        m_clientSideOrdering = true;
+        m_orderingHeadroom = headroom;
+        return *this;
+    }
+
+    // The TOP of the last Build(), including client-side ordering headroom; 0 when unlimited
+    size_t GetFetchLimit() const
+    {
+        size_t topN = GetEffectiveTopN();
+        return (m_clientSideOrdering && topN > 0) ? topN + m_orderingHeadroom : topN;
+    }
+
+    // What the cost model decided during the last Build(); empty without a cost policy
+    const std::optional<QueryPlan>& GetLastQueryPlan() const
+    {
+        return m_lastPlan;
+    }
+
     // Build the complete query string
     std::wstring Build()
     {
         TelemetryProvider::LogInfo(L"Building search query");
+        PlanSearchText();
         
         std::wostringstream query;
         
@@ -126,45 +197,80 @@ public:
     }
 
 private:
+    // Tokenizes the search text and runs it through the cost model, if there is one
+    void PlanSearchText()
+    {
+        m_lastPlan.reset();
+        if (!m_costPolicy || m_searchText.empty())
+        {
+            return;
+        }
+
+        SearchTokenizer tokenizer(m_searchText);
+        if (tokenizer.IsEmpty())
+        {
+            return;
+        }
+
+        QueryCostModel model(*m_costPolicy);
+        m_lastPlan = model.Plan(tokenizer.GetTokens(), tokenizer.IsQuoted(), m_includedScopes, m_topN);
+        TelemetryProvider::LogInfo(L"Query cost plan for '%ls': %ls", m_searchText.c_str(), m_lastPlan->Describe().c_str());
+    }
+
+    size_t GetEffectiveTopN() const
+    {
+        return m_lastPlan ? m_lastPlan->topN : m_topN;
+    }
+
+    // Column a token's content match runs against: everything, or only the file name when the
+    // plan restricts that token
+    const wchar_t* GetContentColumn(size_t token) const
+    {
+        return (m_lastPlan && m_lastPlan->IsFilenameOnly(token)) ? L"System.FileName" : L"*";
+    }
+
     std::wstring BuildSelectClause()
     {
         std::wostringstream select;
         
-        if (m_topN > 0)
+        if (GetFetchLimit() > 0)
         {
-            select << L"SELECT TOP " << m_topN << L" ";
+            select << L"SELECT TOP " << GetFetchLimit() << L" ";
         }
         else
         {
             select << L"SELECT ";
         }
+
+        // A projection fixes the column list and order; nothing else may be added
+        if (!m_projectionColumns.empty())
+        {
+            select << m_projectionColumns;
+            return select.str();
+        }
         
-        // Always include core properties
-        select << L"System.ItemUrl, System.Search.Rank";
-        
-        // Add System.Document.LineCount for click tracking
-        select << L", System.Document.LineCount";
-        
-        // Add System.DateAccessed for recently accessed files
-        select << L", System.DateAccessed";
-        
-        // Add common useful properties
-        select << L", System.ItemNameDisplay";
-        select << L", System.Kind";
-        select << L", System.FileExtension";
-        select << L", System.Size";
-        select << L", System.DateCreated";
-        select << L", System.DateModified";
-        select << L", System.Search.GatherTime";
-        
-        // Add user-specified additional properties
-        for (const auto& prop : m_additionalProperties)
+        // Core properties first: URL and rank, the click count (System.Document.LineCount) and
+        // System.DateAccessed for ordering, then common display properties
+        static constexpr PropertyId coreProperties[] = {
+            propid::ItemUrl, propid::SearchRank, propid::DocumentLineCount, propid::DateAccessed,
+            propid::ItemNameDisplay, propid::Kind, propid::FileExtension, propid::Size,
+            propid::DateCreated, propid::DateModified, propid::SearchGatherTime,
+        };
+
+        // User-specified additional properties follow; each property is selected once
+        auto& registry = details::GetSharedPropertyRegistry();
+        PropertyIdSet selected;
+        for (PropertyId id : coreProperties)
+        {
+            selected.Insert(id);
+            select << (id == coreProperties[0] ? L"" : L", ") << registry.GetName(id);
+        }
+        for (PropertyId id : m_additionalProperties)
         {
-            // Check if not already added
-            std::wstring selectStr = select.str();
-            if (selectStr.find(prop) == std::wstring::npos)
+            if (selected.Insert(id))
             {
-                select << L", " << prop;
+                details::CheckPropertyName(registry.GetName(id));
+                select << L", " << registry.GetName(id);
             }
         }
         
@@ -187,14 +293,8 @@ private:
         {
             if (i > 0) where << L" OR ";
             
-            std::wstring scope = m_includedScopes[i];
-            std::replace(scope.begin(), scope.end(), L'\\', L'/');
-            
-            if (scope.find(L"file:") != 0)
-            {
-                scope = L"file:" + scope;
-            }
-            
+            std::wstring scope;
+            details::AppendScopeUrl(scope, m_includedScopes[i], true);
             where << L"SCOPE='" << scope << L"'";
         }
         where << L")";
@@ -202,14 +302,8 @@ private:
         // Build excluded scopes
         for (size_t i = 0; i < m_excludedScopes.size(); ++i)
         {
-            std::wstring scope = m_excludedScopes[i];
-            std::replace(scope.begin(), scope.end(), L'\\', L'/');
-            
-            if (scope.find(L"file:") != 0)
-            {
-                scope = L"file:" + scope;
-            }
-            
+            std::wstring scope;
+            details::AppendScopeUrl(scope, m_excludedScopes[i], true);
             where << L" AND SCOPE<>'" << scope << L"'";
         }
         
@@ -218,31 +312,27 @@ private:
 
     std::wstring BuildWhereClause()
     {
-        std::wostringstream where;
-        
-        // Start with scope filtering
-        std::wstring scopeWhere = BuildScopeOnlyWhereClause();
-        if (!scopeWhere.empty())
-        {
-            where << scopeWhere;
-        }
-        else
-        {
-            where << L" WHERE ";
-        }
-        
-        // Add search text filtering if provided
-        if (!m_searchText.empty())
+        // Scopes, then filters, then the search text; each part is optional
+        std::wstring where = BuildScopeOnlyWhereClause();
+        auto appendCondition = [&where](const std::wstring& condition)
         {
-            if (!scopeWhere.empty())
+            if (!condition.empty())
             {
-                where << L" AND ";
+                where += where.empty() ? L" WHERE " : L" AND ";
+                where += condition;
             }
-            
-            where << BuildSearchCondition();
+        };
+
+        for (const auto& filter : m_filters)
+        {
+            std::wstring condition;
+            details::AppendFilterCondition(condition, filter);
+            appendCondition(condition);
         }
-        
-        return where.str();
+
+        // Text with nothing searchable in it (e.g. a lone quote while typing) adds no condition
+        appendCondition(m_searchText.empty() ? std::wstring() : BuildSearchCondition());
+        return where;
     }
 
     std::wstring BuildSearchCondition()
@@ -267,15 +357,24 @@ private:
             // User explicitly quoted the search - use exact phrase only
             condition << BuildQuotedSearchCondition(tokenizer);
         }
-        else if (tokenizer.IsSingleToken())
-        {
-            // Single word search - use simplified ranking
-            condition << BuildSingleWordCondition(tokenizer.GetTokens()[0]);
-        }
         else
         {
-            // Multiple words - use complex multi-word matching
-            condition << BuildMultiWordCondition(tokenizer.GetTokens());
+            // The cost model may have dropped stop-words or capped the AND chain
+            std::vector<std::wstring> tokens = tokenizer.GetTokens();
+            if (m_lastPlan)
+            {
+                tokens.assign(m_lastPlan->tokens.begin(), m_lastPlan->tokens.end());
+            }
+            if (tokens.size() == 1)
+            {
+                // Single word search - use simplified ranking
+                condition << BuildSingleWordCondition(tokens[0]);
+            }
+            else
+            {
+                // Multiple words - use complex multi-word matching
+                condition << BuildMultiWordCondition(tokens);
+            }
         }
         
         return condition.str();
@@ -289,7 +388,15 @@ private:
         
         // Exact phrase match only
         condition << L"(CONTAINS(#MRProps, '\"" << EscapeForContains(phrase) << L"\"', " << m_locale << L") ";
-        condition << L"RANK BY COERCION(ABSOLUTE, 999))";
+        condition << L"RANK BY COERCION(ABSOLUTE, 999)";
+
+        // Closing quote not typed yet: phrases that start with it rank next
+        if (tokenizer.IsPhrasePrefix())
+        {
+            condition << L" OR CONTAINS(#MRProps, '\"" << EscapeForContains(phrase) << L"*\"', " << m_locale << L") ";
+            condition << L"RANK BY COERCION(MINMAX, 900, 980)";
+        }
+        condition << L")";
         
         return condition.str();
     }
@@ -310,7 +417,7 @@ private:
         condition << L"RANK BY COERCION(MINMAX, 900, 980))";
         
         // 3. Content match anywhere - MINMAX for natural ranking
-        condition << L" OR (CONTAINS(*, '\"" << escaped << L"\"', " << m_locale << L") ";
+        condition << L" OR (CONTAINS(" << GetContentColumn(0) << L", '\"" << escaped << L"\"', " << m_locale << L") ";
         condition << L"RANK BY COERCION(MINMAX, 0, 899))";
         
         condition << L")";
@@ -347,7 +454,7 @@ private:
         {
             if (i > 0) condition << L" AND ";
             std::wstring escaped = EscapeForContains(tokens[i]);
-            condition << L"CONTAINS(*, '\"" << escaped << L"*\"', " << m_locale << L")";
+            condition << L"CONTAINS(" << GetContentColumn(i) << L", '\"" << escaped << L"*\"', " << m_locale << L")";
         }
         condition << L" RANK BY COERCION(MINMAX, 0, 899))";
         
@@ -358,6 +465,12 @@ private:
 
     std::wstring BuildOrderByClause()
     {
+        if (m_clientSideOrdering)
+        {
+            // Tie-breaks happen client-side (see WithClientSideOrdering)
+            return L" ORDER BY System.Search.Rank DESC";
+        }
+
         // Order by:
         // 1. Search.Rank (primary - includes our COERCION ranking)
         // 2. Document.LineCount (click count - secondary)
@@ -369,32 +482,23 @@ private:
     std::wstring EscapeForContains(const std::wstring& text)
     {
         std::wstring escaped;
-        for (wchar_t ch : text)
-        {
-            // Escape single quotes for SQL
-            if (ch == L'\'')
-            {
-                escaped += L"''";
-            }
-            // Escape double quotes for CONTAINS
-            else if (ch == L'"')
-            {
-                escaped += L"\"\"";
-            }
-            else
-            {
-                escaped += ch;
-            }
-        }
+        escaped.reserve(text.size());
+        details::AppendEscapedContainsText(escaped, text);
         return escaped;
     }
 
     std::vector<std::wstring> m_includedScopes;
     std::vector<std::wstring> m_excludedScopes;
-    std::vector<std::wstring> m_additionalProperties;
+    std::vector<PropertyId> m_additionalProperties;
+    std::wstring_view m_projectionColumns; // compile-time storage owned by the Projection type
     std::wstring m_searchText;
+    std::vector<FilterPredicate> m_filters;
     size_t m_topN;
     DWORD m_locale;
+    std::optional<QueryCostPolicy> m_costPolicy;
+    std::optional<QueryPlan> m_lastPlan;
+    bool m_clientSideOrdering = false;
+    size_t m_orderingHeadroom = c_defaultOrderingHeadroom;
 };
 
 } // namespace wsearch
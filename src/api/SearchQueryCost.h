@@ -0,0 +1,437 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include "SearchQueryParser.h"
+#include <algorithm>
+#include <cstdint>
+#include <cwchar>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace wsearch
+{
+
+/* QueryCostPolicy - when and how expensive queries get rewritten
+ *
+ * Costs are in units of "one filename prefix match of 6+ characters over the whole index".
+ */
+struct QueryCostPolicy
+{
+    size_t filenameOnlyBelowLength = 3; // tokens shorter than this only match file names; the others still match content
+    size_t autoTopN = 200;              // TOP N added to expensive queries that don't set one
+    double autoTopNCost = 16.0;         // estimated cost at which autoTopN kicks in
+    size_t maxAndTerms = 4;             // longest AND chain emitted for multi-word text
+    bool dropStopWords = true;          // drop stop-words from multi-word text (never the last token)
+};
+
+struct QueryCostEstimate
+{
+    double cost = 0.0;
+    double scopeBreadth = 1.0; // 1.0 = whole index
+    size_t tokenCount = 0;
+    size_t shortestToken = 0;
+    size_t stopWords = 0;
+};
+
+// What the cost model decided for one search text. Its containers use the resource it is
+// planned on (see QueryCostModel::Plan), e.g. the query's arena.
+struct QueryPlan
+{
+    using Tokens = std::pmr::vector<std::pmr::wstring>;
+
+    explicit QueryPlan(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : tokens(resource)
+        , filenameOnly(resource)
+        , droppedStopWords(resource)
+        , droppedForAndCap(resource)
+    {
+    }
+
+    Tokens tokens;                       // tokens to search for, after rewriting
+    std::pmr::vector<bool> filenameOnly; // per token: match System.FileName instead of all properties
+    bool quoted = false;
+    bool openQuote = false;              // quoted, but the closing quote is not typed yet
+    size_t topN = 0;                     // 0 = no limit
+    bool autoTopN = false;               // topN was added by the policy
+    Tokens droppedStopWords;
+    Tokens droppedForAndCap;
+    QueryCostEstimate before;
+    QueryCostEstimate after;
+
+    bool IsFilenameOnly(size_t token) const
+    {
+        return token < filenameOnly.size() && filenameOnly[token];
+    }
+
+    bool HasFilenameOnlyTokens() const
+    {
+        return std::find(filenameOnly.begin(), filenameOnly.end(), true) != filenameOnly.end();
+    }
+
+    bool IsRewritten() const
+    {
+        return HasFilenameOnlyTokens() || autoTopN || !droppedStopWords.empty() || !droppedForAndCap.empty();
+    }
+
+    // Appends the tokens separated by single spaces, the form the session SQL builders take. With
+    // 'contentOnly' the filename-only tokens are left out; they go to FilenameOnlyTokens().
+    template <typename String>
+    void AppendTokens(String& out, bool contentOnly = false) const
+    {
+        if (quoted)
+        {
+            out.push_back(L'"');
+        }
+        bool first = true;
+        for (size_t i = 0; i < tokens.size(); ++i)
+        {
+            if (contentOnly && IsFilenameOnly(i))
+            {
+                continue;
+            }
+            if (!first)
+            {
+                out.push_back(L' ');
+            }
+            out.append(tokens[i].data(), tokens[i].size());
+            first = false;
+        }
+        if (quoted && !openQuote)
+        {
+            out.push_back(L'"');
+        }
+    }
+
+    std::wstring JoinTokens(bool contentOnly = false) const
+    {
+        std::wstring text;
+        AppendTokens(text, contentOnly);
+        return text;
+    }
+
+    std::pmr::vector<std::wstring_view> FilenameOnlyTokens() const
+    {
+        std::pmr::vector<std::wstring_view> words(tokens.get_allocator().resource());
+        for (size_t i = 0; i < tokens.size(); ++i)
+        {
+            if (IsFilenameOnly(i))
+            {
+                words.push_back(tokens[i]);
+            }
+        }
+        return words;
+    }
+
+    // One line for tracing, e.g. "cost 128.0 -> 32.0; filename-only: a; TOP 200"
+    template <typename String>
+    void AppendDescription(String& out) const
+    {
+        wchar_t number[64];
+        swprintf(number, 64, L"cost %.1f -> %.1f", before.cost, after.cost);
+        out.append(number);
+        if (!IsRewritten())
+        {
+            out.append(L"; unchanged");
+            return;
+        }
+
+        auto appendList = [&out](const wchar_t* label, const auto& words)
+        {
+            if (words.empty())
+            {
+                return;
+            }
+            out.append(label);
+            for (size_t i = 0; i < words.size(); ++i)
+            {
+                out.append(i == 0 ? L" " : L", ");
+                out.append(words[i].data(), words[i].size());
+            }
+        };
+        appendList(L"; filename-only:", FilenameOnlyTokens());
+        if (autoTopN)
+        {
+            swprintf(number, 64, L"; TOP %zu", topN);
+            out.append(number);
+        }
+        appendList(L"; dropped stop-words:", droppedStopWords);
+        appendList(L"; AND chain capped, dropped:", droppedForAndCap);
+    }
+
+    std::wstring Describe() const
+    {
+        std::wstring text;
+        AppendDescription(text);
+        return text;
+    }
+};
+
+namespace details
+{
+    inline bool IsQueryStopWord(std::wstring_view token)
+    {
+        static constexpr std::wstring_view stopWords[] = {
+            L"a", L"an", L"and", L"are", L"as", L"at", L"be", L"by", L"for", L"from", L"in", L"is",
+            L"it", L"of", L"on", L"or", L"that", L"the", L"this", L"to", L"was", L"with",
+        };
+
+        if (token.size() > 4)
+        {
+            return false;
+        }
+        // ASCII folding like the parser's keywords: the stop-words are ASCII, and towlower
+        // depends on the C locale
+        wchar_t lower[4];
+        for (size_t i = 0; i < token.size(); ++i)
+        {
+            wchar_t ch = token[i];
+            lower[i] = (ch >= L'A' && ch <= L'Z') ? static_cast<wchar_t>(ch + (L'a' - L'A')) : ch;
+        }
+        std::wstring_view folded(lower, token.size());
+        return std::find(std::begin(stopWords), std::end(stopWords), folded) != std::end(stopWords);
+    }
+
+    // Share of the index a scope covers: "file:" is everything, a drive half, and each
+    // folder level below that halves it again
+    inline double ScopeBreadth(std::wstring_view scope)
+    {
+        if (scope.size() >= 5 && scope.substr(0, 5) == L"file:")
+        {
+            scope.remove_prefix(5);
+        }
+
+        size_t depth = 0;
+        bool inSegment = false;
+        for (wchar_t ch : scope)
+        {
+            bool separator = (ch == L'/' || ch == L'\\');
+            if (!separator && !inSegment)
+            {
+                ++depth;
+            }
+            inSegment = !separator;
+        }
+
+        double breadth = 1.0;
+        for (size_t i = 0; i < depth; ++i)
+        {
+            breadth /= 2.0;
+        }
+        return breadth;
+    }
+
+    inline double ScopesBreadth(const std::vector<std::wstring>& scopes)
+    {
+        if (scopes.empty())
+        {
+            return 1.0;
+        }
+
+        double breadth = 0.0;
+        for (const auto& scope : scopes)
+        {
+            breadth += ScopeBreadth(scope);
+        }
+        return (std::min)(breadth, 1.0);
+    }
+
+    // A prefix of n characters expands to roughly twice as many terms as one of n + 1, down
+    // to 6 characters; stop-words match nearly every document whatever their length
+    inline double TokenFanout(std::wstring_view token)
+    {
+        size_t effectiveLength = IsQueryStopWord(token) ? 1 : token.size();
+        double fanout = 1.0;
+        for (size_t length = effectiveLength; length < 6; ++length)
+        {
+            fanout *= 2.0;
+        }
+        return fanout;
+    }
+} // namespace details
+
+/* QueryCostModel - estimates what a search text will cost the indexer and rewrites it
+ *
+ * Cost grows with scope breadth, with every CONTAINS term (each is evaluated, even in an AND
+ * chain), with shorter prefixes (more terms to expand) and with searching all properties
+ * instead of the file name. Plan() applies the policy's rewrites in order: drop stop-words,
+ * cap the AND chain (keeping the longest tokens and the one being typed), restrict each short
+ * prefix to file names (longer tokens still match content), then add TOP N if what's left is
+ * still expensive.
+ *
+ * Example:
+ *   wsearch::QueryCostModel model;
+ *   auto plan = model.Plan({ L"a" }, false, { L"file:" }, 0);
+ *   // plan.IsFilenameOnly(0) == true, plan.topN == 200, plan.Describe() == L"cost 128.0 -> 32.0; filename-only: a; TOP 200"
+ */
+class QueryCostModel
+{
+public:
+    // Content matches look at every property instead of one
+    static constexpr double ContentFactor = 4.0;
+
+    explicit QueryCostModel(QueryCostPolicy policy = {})
+        : m_policy(policy)
+    {
+    }
+
+    const QueryCostPolicy& GetPolicy() const
+    {
+        return m_policy;
+    }
+
+    // 'Tokens' is any vector of strings, e.g. QueryPlan::Tokens
+    template <typename Tokens = std::vector<std::wstring>>
+    QueryCostEstimate Estimate(const Tokens& tokens, bool filenameOnly, const std::vector<std::wstring>& scopes) const
+    {
+        return EstimateTokens(tokens, [filenameOnly](size_t) { return filenameOnly; }, scopes);
+    }
+
+    // Parses the text the way the session SQL builders do (see ParseSearchText); a phrase is one
+    // token. The plan's tokens and lists are allocated from 'resource'.
+    QueryPlan Plan(std::wstring_view searchText, const std::vector<std::wstring>& scopes, size_t requestedTopN,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const
+    {
+        auto parsed = ParseSearchText(searchText);
+        QueryPlan::Tokens tokens(resource);
+        if (parsed.IsPhrase())
+        {
+            std::pmr::wstring phrase(resource);
+            parsed.AppendWords(phrase);
+            tokens.push_back(std::move(phrase));
+        }
+        else
+        {
+            parsed.ForEachWord([&tokens](std::wstring_view word) { tokens.emplace_back(word); });
+        }
+
+        auto plan = PlanTokens(std::move(tokens), parsed.IsPhrase(), scopes, requestedTopN);
+        plan.openQuote = parsed.shape == SearchTextShape::PhrasePrefix;
+        return plan;
+    }
+
+    QueryPlan Plan(const std::vector<std::wstring>& tokens, bool quoted, const std::vector<std::wstring>& scopes,
+        size_t requestedTopN, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) const
+    {
+        QueryPlan::Tokens planTokens(resource);
+        planTokens.reserve(tokens.size());
+        for (const auto& token : tokens)
+        {
+            planTokens.emplace_back(token);
+        }
+        return PlanTokens(std::move(planTokens), quoted, scopes, requestedTopN);
+    }
+
+private:
+    // Cost of 'tokens' where token i matches only file names if isFilenameOnly(i)
+    template <typename Tokens, typename IsFilenameOnly>
+    QueryCostEstimate EstimateTokens(const Tokens& tokens, IsFilenameOnly&& isFilenameOnly, const std::vector<std::wstring>& scopes) const
+    {
+        QueryCostEstimate estimate;
+        estimate.scopeBreadth = details::ScopesBreadth(scopes);
+        estimate.tokenCount = tokens.size();
+        estimate.shortestToken = tokens.empty() ? 0 : SIZE_MAX;
+
+        double termCost = 0.0;
+        for (size_t i = 0; i < tokens.size(); ++i)
+        {
+            std::wstring_view token(tokens[i]);
+            estimate.shortestToken = (std::min)(estimate.shortestToken, token.size());
+            estimate.stopWords += details::IsQueryStopWord(token) ? 1 : 0;
+            termCost += details::TokenFanout(token) * (isFilenameOnly(i) ? 1.0 : ContentFactor);
+        }
+
+        estimate.cost = estimate.scopeBreadth * termCost;
+        return estimate;
+    }
+
+    // The plan allocates from the tokens' resource
+    QueryPlan PlanTokens(QueryPlan::Tokens tokens, bool quoted, const std::vector<std::wstring>& scopes, size_t requestedTopN) const
+    {
+        QueryPlan plan(tokens.get_allocator().resource());
+        plan.quoted = quoted;
+        plan.topN = requestedTopN;
+        plan.before = Estimate(tokens, false, scopes);
+
+        // An exact phrase is what the user asked for; only the result count may be limited
+        if (!quoted && tokens.size() > 1)
+        {
+            if (m_policy.dropStopWords)
+            {
+                DropStopWords(tokens, plan.droppedStopWords);
+            }
+            if (m_policy.maxAndTerms > 0 && tokens.size() > m_policy.maxAndTerms)
+            {
+                CapAndChain(tokens, plan.droppedForAndCap);
+            }
+        }
+
+        // Only the short prefixes are restricted; "my quarterly report" still finds the
+        // documents that contain "quarterly" and "report"
+        plan.filenameOnly.assign(tokens.size(), false);
+        for (size_t i = 0; !quoted && i < tokens.size(); ++i)
+        {
+            plan.filenameOnly[i] = tokens[i].size() < m_policy.filenameOnlyBelowLength;
+        }
+
+        plan.after = EstimateTokens(tokens, [&plan](size_t i) { return plan.IsFilenameOnly(i); }, scopes);
+        if (requestedTopN == 0 && m_policy.autoTopN > 0 && plan.after.cost >= m_policy.autoTopNCost)
+        {
+            plan.topN = m_policy.autoTopN;
+            plan.autoTopN = true;
+        }
+
+        plan.tokens = std::move(tokens);
+        return plan;
+    }
+
+    // The last token is the one being typed, so it is always kept
+    static void DropStopWords(QueryPlan::Tokens& tokens, QueryPlan::Tokens& dropped)
+    {
+        QueryPlan::Tokens kept(tokens.get_allocator());
+        kept.reserve(tokens.size());
+        for (size_t i = 0; i < tokens.size(); ++i)
+        {
+            if (i + 1 < tokens.size() && details::IsQueryStopWord(tokens[i]))
+            {
+                dropped.push_back(std::move(tokens[i]));
+            }
+            else
+            {
+                kept.push_back(std::move(tokens[i]));
+            }
+        }
+        tokens = std::move(kept);
+    }
+
+    // Keeps the last token plus the longest (most selective) others, in their original order
+    void CapAndChain(QueryPlan::Tokens& tokens, QueryPlan::Tokens& dropped) const
+    {
+        std::pmr::vector<size_t> order(tokens.size() - 1, tokens.get_allocator());
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(),
+            [&tokens](size_t left, size_t right) { return tokens[left].size() > tokens[right].size(); });
+
+        std::pmr::vector<bool> keep(tokens.size(), false, tokens.get_allocator());
+        keep.back() = true;
+        for (size_t i = 0; i + 1 < m_policy.maxAndTerms && i < order.size(); ++i)
+        {
+            keep[order[i]] = true;
+        }
+
+        QueryPlan::Tokens kept(tokens.get_allocator());
+        for (size_t i = 0; i < tokens.size(); ++i)
+        {
+            (keep[i] ? kept : dropped).push_back(std::move(tokens[i]));
+        }
+        tokens = std::move(kept);
+    }
+
+    QueryCostPolicy m_policy;
+};
+
+} // namespace wsearch
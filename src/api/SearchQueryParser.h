@@ -0,0 +1,281 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace wsearch
+{
+
+// How the words of a parsed search text are to be matched
+enum class SearchTextShape
+{
+    Empty,        // no text at all; no full-text condition, the whole scope is listed
+    NoQuery,      // text with nothing searchable in it ("-", "or", "$$"); there is no query to run
+    Words,        // independent words, the last one a prefix
+    Phrase,       // "exact phrase"
+    PhrasePrefix, // "exact phra  (the closing quote is not typed yet)
+};
+
+/* ParsedSearchText - search text reduced to what the full-text condition can safely hold
+ *
+ * Views into the text passed to ParseSearchText, which must outlive it. Words are visited with
+ * ForEachWord and never contain quotes, grouping or boolean operator characters, so they can be
+ * placed inside CONTAINS('...') as they are (after SQL quote escaping).
+ */
+struct ParsedSearchText
+{
+    SearchTextShape shape = SearchTextShape::Empty;
+    std::wstring_view body;  // the words' source: the inside of a phrase, or the whole text
+    size_t wordCount = 0;
+    bool repaired = false;   // something was dropped or reinterpreted to make the text well-formed
+
+    bool IsEmpty() const
+    {
+        return shape == SearchTextShape::Empty;
+    }
+
+    // False for text that was typed but holds no word to search for; callers keep or clear
+    // their previous results instead of running a query without a full-text condition
+    bool HasQuery() const
+    {
+        return shape != SearchTextShape::NoQuery;
+    }
+
+    bool IsPhrase() const
+    {
+        return shape == SearchTextShape::Phrase || shape == SearchTextShape::PhrasePrefix;
+    }
+
+    // Calls visitor(std::wstring_view word) for each word, in order
+    template <typename Visitor>
+    void ForEachWord(Visitor&& visitor) const;
+
+    // Appends the words separated by single spaces
+    template <typename String>
+    void AppendWords(String& out) const
+    {
+        bool first = true;
+        ForEachWord([&](std::wstring_view word) {
+            if (!first)
+            {
+                out.push_back(L' ');
+            }
+            out.append(word.data(), word.size());
+            first = false;
+        });
+    }
+};
+
+namespace details
+{
+    // ASCII and Unicode white space, the same in every locale
+    inline bool IsSearchTextSpace(wchar_t ch)
+    {
+        switch (ch)
+        {
+        case L' ': case L'\t': case L'\n': case L'\v': case L'\f': case L'\r':
+        case 0x0085: case 0x00A0: case 0x1680: case 0x2028: case 0x2029: case 0x202F: case 0x205F: case 0x3000:
+            return true;
+        default:
+            return ch >= 0x2000 && ch <= 0x200A;
+        }
+    }
+
+    // ASCII letters and digits, and anything outside ASCII that is not white space ("café",
+    // CJK, surrogate halves), independent of the C locale; ASCII punctuation never is
+    inline bool IsSearchTextWordCharacter(wchar_t ch)
+    {
+        if (ch < 0x80)
+        {
+            return (ch >= L'a' && ch <= L'z') || (ch >= L'A' && ch <= L'Z') || (ch >= L'0' && ch <= L'9');
+        }
+        return !IsSearchTextSpace(ch);
+    }
+
+    // Characters the full-text syntax reads as quoting, grouping, wildcards or boolean operators.
+    // Words are split on them; the builders add their own quotes and prefix wildcards.
+    inline bool IsSearchTextSeparator(wchar_t ch)
+    {
+        switch (ch)
+        {
+        case L'"': case L'(': case L')': case L'&': case L'|': case L'!': case L'~': case L'*':
+            return true;
+        default:
+            return IsSearchTextSpace(ch);
+        }
+    }
+
+    // Leading '-' and '+' are exclusion/inclusion operators; trailing '-' and quotes are
+    // half-typed ones. Internal ones ("o'brien", "x-ray", "c++") are part of the word.
+    inline bool IsSearchTextLeadingOperator(wchar_t ch)
+    {
+        return ch == L'-' || ch == L'+' || ch == L'\'';
+    }
+
+    inline bool IsSearchTextTrailingOperator(wchar_t ch)
+    {
+        return ch == L'-' || ch == L'\'';
+    }
+
+    // AND, OR, NOT and NEAR are operators inside CONTAINS in any case
+    inline bool IsSearchTextKeyword(std::wstring_view word)
+    {
+        static constexpr std::wstring_view keywords[] = { L"and", L"or", L"not", L"near" };
+        for (auto keyword : keywords)
+        {
+            if (word.size() != keyword.size())
+            {
+                continue;
+            }
+
+            bool match = true;
+            for (size_t i = 0; match && i < word.size(); ++i)
+            {
+                wchar_t ch = word[i];
+                match = ((ch >= L'A' && ch <= L'Z') ? static_cast<wchar_t>(ch + (L'a' - L'A')) : ch) == keyword[i];
+            }
+            if (match)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Visits the cleaned words of 'body'; returns true if anything was trimmed or dropped
+    template <typename Visitor>
+    bool VisitSearchTextWords(std::wstring_view body, bool dropKeywords, Visitor&& visitor)
+    {
+        bool repaired = false;
+        size_t start = 0;
+        while (start < body.size())
+        {
+            size_t end = start;
+            while (end < body.size() && !IsSearchTextSeparator(body[end]))
+            {
+                ++end;
+            }
+
+            std::wstring_view word = body.substr(start, end - start);
+            if (end < body.size() && !IsSearchTextSpace(body[end]))
+            {
+                repaired = true;
+            }
+            start = end + 1;
+
+            size_t length = word.size();
+            while (!word.empty() && IsSearchTextLeadingOperator(word.front()))
+            {
+                word.remove_prefix(1);
+            }
+            while (!word.empty() && IsSearchTextTrailingOperator(word.back()))
+            {
+                word.remove_suffix(1);
+            }
+            repaired = repaired || word.size() != length;
+
+            bool hasWordCharacter = false;
+            for (wchar_t ch : word)
+            {
+                hasWordCharacter = hasWordCharacter || IsSearchTextWordCharacter(ch);
+            }
+
+            if (!hasWordCharacter || (dropKeywords && IsSearchTextKeyword(word)))
+            {
+                repaired = repaired || length > 0;
+                continue;
+            }
+            visitor(word);
+        }
+        return repaired;
+    }
+} // namespace details
+
+template <typename Visitor>
+void ParsedSearchText::ForEachWord(Visitor&& visitor) const
+{
+    if (shape != SearchTextShape::Empty && shape != SearchTextShape::NoQuery)
+    {
+        // Inside a phrase AND/OR/NOT/NEAR are ordinary words
+        details::VisitSearchTextWords(body, !IsPhrase(), visitor);
+    }
+}
+
+/* ParseSearchText - tolerant parser for search text as it is being typed
+ *
+ * Maps any input, including every prefix of a valid query, to the closest well-formed one, so
+ * transient syntax errors never reach the indexer:
+ *   "annual rep      -> phrase prefix: annual rep (exact phrase or phrase prefix)
+ *   "annual report"  -> exact phrase
+ *   annual -         -> annual (dangling operator dropped)
+ *   rep'             -> rep
+ *   a "b c" d        -> a b c d (only a whole-text phrase is kept as one)
+ *   salt and pepper  -> salt pepper (every word is required anyway)
+ *   -  or  "         -> no query (HasQuery() is false)
+ *   (blank)          -> empty
+ *
+ * Words are split on white space and ASCII punctuation only, the same in every locale, so
+ * "café" and CJK text are words. Allocation-free; the result views 'text'. Given a visitor, it
+ * is also called with each word as the parse finds it, so a caller that needs the words anyway
+ * reads the text once instead of again through ForEachWord.
+ *
+ * Example:
+ *   auto parsed = wsearch::ParseSearchText(L"\"annual rep");
+ *   // parsed.shape == SearchTextShape::PhrasePrefix, parsed.wordCount == 2
+ */
+template <typename Visitor>
+ParsedSearchText ParseSearchText(std::wstring_view text, Visitor&& visitor)
+{
+    while (!text.empty() && details::IsSearchTextSpace(text.front()))
+    {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && details::IsSearchTextSpace(text.back()))
+    {
+        text.remove_suffix(1);
+    }
+
+    size_t quotes = 0;
+    for (wchar_t ch : text)
+    {
+        quotes += (ch == L'"') ? 1 : 0;
+    }
+
+    ParsedSearchText parsed;
+    parsed.body = text;
+    parsed.shape = SearchTextShape::Words;
+    if (quotes > 0)
+    {
+        if (text.front() == L'"' && quotes == 1)
+        {
+            parsed.shape = SearchTextShape::PhrasePrefix;
+            parsed.body = text.substr(1);
+        }
+        else if (text.front() == L'"' && quotes == 2 && text.back() == L'"')
+        {
+            parsed.shape = SearchTextShape::Phrase;
+            parsed.body = text.substr(1, text.size() - 2);
+        }
+    }
+
+    parsed.repaired = details::VisitSearchTextWords(parsed.body, !parsed.IsPhrase(),
+        [&](std::wstring_view word) {
+            ++parsed.wordCount;
+            visitor(word);
+        });
+
+    if (parsed.wordCount == 0)
+    {
+        parsed.repaired = parsed.repaired || !text.empty();
+        parsed.shape = text.empty() ? SearchTextShape::Empty : SearchTextShape::NoQuery;
+    }
+    return parsed;
+}
+
+inline ParsedSearchText ParseSearchText(std::wstring_view text)
+{
+    return ParseSearchText(text, [](std::wstring_view) {});
+}
+
+} // namespace wsearch
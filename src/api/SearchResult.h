@@ -4,8 +4,12 @@
 #include <propkey.h>
 #include <propsys.h>
 #include <winrt/base.h>
+#include "SearchPropertySchemaSource.h"
+#include "SearchFilePath.h"
+#include "SearchValueRowset.h"
 #include <string>
 #include <optional>
+#include <memory_resource>
 
 namespace wsearch
 {
@@ -48,6 +52,37 @@ public:
         return m_propStore->GetValue(key, &value);
     }
 
+    // Property by registry id (propid::Size, or an id from the shared registry's Intern);
+    // E_INVALIDARG for interned names the property system could not describe
+    HRESULT GetProperty(PropertyId id, PROPVARIANT& value) const
+    {
+        PropVariantInit(&value);
+        PropertyInfo info = details::GetSharedPropertyRegistry().GetInfo(id);
+        if (!info.hasKey)
+        {
+            return E_INVALIDARG;
+        }
+        return GetProperty(details::ToPropertyKey(info.key), value);
+    }
+
+    std::wstring GetStringProperty(PropertyId id) const
+    {
+        PropertyInfo info = details::GetSharedPropertyRegistry().GetInfo(id);
+        return info.hasKey ? GetStringProperty(details::ToPropertyKey(info.key)) : std::wstring();
+    }
+
+    // Appends this result's values for the page's columns as one row; reading the row
+    // afterwards involves no COM calls or PROPVARIANTs
+    void ReadValues(SearchValuePage& page) const
+    {
+        if (!m_propStore)
+        {
+            page.AddRow();
+            return;
+        }
+        details::ReadPropertyStoreRow(m_propStore.get(), page);
+    }
+
     // Common string properties
     std::wstring GetPath() const
     {
@@ -190,43 +225,10 @@ public:
     }
 
     // Get file path suitable for TrackResultClick
-    // Converts file:/// URL to filesystem path
+    // Converts the file URL to a filesystem path (see FileUrlToPath)
     std::wstring GetFilePathForTracking() const
     {
-        std::wstring url = GetPath();
-        
-        // Remove file:/// prefix if present
-        if (url.find(L"file:///") == 0)
-        {
-            url = url.substr(8); // Remove "file:///"
-        }
-        else if (url.find(L"file://") == 0)
-        {
-            url = url.substr(7); // Remove "file://"
-        }
-        
-        // Convert forward slashes to backslashes
-        std::replace(url.begin(), url.end(), L'/', L'\\');
-        
-        // URL decode any encoded characters
-        std::wstring decoded;
-        for (size_t i = 0; i < url.length(); ++i)
-        {
-            if (url[i] == L'%' && i + 2 < url.length())
-            {
-                // Decode %XX hex encoding
-                std::wstring hex = url.substr(i + 1, 2);
-                wchar_t ch = static_cast<wchar_t>(std::wcstol(hex.c_str(), nullptr, 16));
-                decoded += ch;
-                i += 2;
-            }
-            else
-            {
-                decoded += url[i];
-            }
-        }
-        
-        return decoded;
+        return FileUrlToPath(GetPath());
     }
 
     // Get the underlying property store for advanced usage
@@ -235,6 +237,25 @@ public:
         return m_propStore;
     }
 
+    // String property allocated from 'resource', e.g. a QueryArena shared by every row of a
+    // result page so the strings are freed together when the page is dropped
+    std::pmr::wstring GetStringProperty(const PROPERTYKEY& key, std::pmr::memory_resource* resource) const
+    {
+        std::pmr::wstring result(resource);
+
+        PROPVARIANT pv;
+        if (SUCCEEDED(GetProperty(key, pv)))
+        {
+            if (pv.vt == VT_LPWSTR && pv.pwszVal)
+            {
+                result = pv.pwszVal;
+            }
+            PropVariantClear(&pv);
+        }
+
+        return result;
+    }
+
     // Check if result is valid
     bool IsValid() const
     {
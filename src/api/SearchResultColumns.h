@@ -0,0 +1,772 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include "SearchValue.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define WSEARCH_RESULT_COLUMNS_SSE2 1
+#include <emmintrin.h>
+#endif
+
+/* Columnar result operators
+ *
+ * A ResultBatch holds materialized results column by column: numbers and FILETIMEs as int64,
+ * strings such as System.Kind and System.FileExtension as ids into a per-column dictionary.
+ * Re-sorting and facet counts then run over flat arrays instead of a new indexer query:
+ *   - SortRows: stable multi-key sort of row indexes; keys are rebased on their minimum (so
+ *     FILETIMEs from the same few years need no passes for their high bits) and packed with the
+ *     row index into one uint64 per row, which a single MSD radix sort orders;
+ *   - CountFacet: histogram of a category column (SSE2 compare-and-count for small
+ *     dictionaries, interleaved scalar counters otherwise);
+ *   - CountGroups: counts per pair of category values, e.g. kind x extension.
+ */
+namespace wsearch
+{
+
+// Missing numbers; sort below every real value
+constexpr int64_t c_missingNumber = (std::numeric_limits<int64_t>::min)();
+
+enum class ColumnSortOrder
+{
+    Ascending,
+    Descending,
+};
+
+struct ColumnSortKey
+{
+    PropertyId column;
+    ColumnSortOrder order = ColumnSortOrder::Ascending;
+};
+
+struct FacetCount
+{
+    std::wstring_view value; // empty for rows without a value
+    uint32_t count;
+};
+
+struct GroupCount
+{
+    std::wstring_view first;
+    std::wstring_view second;
+    uint32_t count;
+};
+
+/* CategoryColumn - dictionary-encoded strings
+ *
+ * Code 0 is the missing value; other codes are handed out in order of first appearance.
+ * Values compare case-sensitively, as the indexer returns kinds and extensions normalized.
+ */
+class CategoryColumn
+{
+public:
+    CategoryColumn()
+    {
+        m_values.emplace_back();
+        m_valueViews.emplace_back();
+    }
+
+    CategoryColumn(const CategoryColumn&) = delete;
+    CategoryColumn& operator=(const CategoryColumn&) = delete;
+    CategoryColumn(CategoryColumn&&) = default;
+    CategoryColumn& operator=(CategoryColumn&&) = default;
+
+    uint32_t Intern(std::wstring_view value)
+    {
+        if (value.empty())
+        {
+            return 0;
+        }
+        size_t mask = m_slots.size() - 1;
+        for (size_t slot = Hash(value) & mask;; slot = (slot + 1) & mask)
+        {
+            uint32_t code = m_slots[slot];
+            if (code == 0)
+            {
+                return Add(value, slot);
+            }
+            if (m_valueViews[code] == value)
+            {
+                return code;
+            }
+        }
+    }
+
+    void Append(std::wstring_view value)
+    {
+        m_rowCodes.push_back(Intern(value));
+    }
+
+    const std::vector<uint32_t>& GetCodes() const
+    {
+        return m_rowCodes;
+    }
+
+    std::wstring_view GetValue(uint32_t code) const
+    {
+        return m_valueViews.at(code);
+    }
+
+    // Distinct values including the missing value
+    size_t GetCardinality() const
+    {
+        return m_valueViews.size();
+    }
+
+private:
+    // Short values (kinds, extensions) hash their length and first, middle and last characters,
+    // a fixed cost with no data-dependent loop; longer ones such as URLs share too much of that,
+    // so they take FNV-1a over every character
+    static size_t Hash(std::wstring_view value)
+    {
+        uint64_t hash = value.size();
+        if (value.size() <= 16)
+        {
+            hash = hash * 0x9E3779B97F4A7C15ull + static_cast<uint32_t>(value.front());
+            hash = hash * 0x9E3779B97F4A7C15ull + static_cast<uint32_t>(value[value.size() / 2]);
+            hash = hash * 0x9E3779B97F4A7C15ull + static_cast<uint32_t>(value.back());
+        }
+        else
+        {
+            hash = 14695981039346656037ull;
+            for (wchar_t ch : value)
+            {
+                hash = (hash ^ static_cast<uint32_t>(ch)) * 1099511628211ull;
+            }
+        }
+        return static_cast<size_t>(hash ^ (hash >> 29));
+    }
+
+    uint32_t Add(std::wstring_view value, size_t slot)
+    {
+        uint32_t code = static_cast<uint32_t>(m_valueViews.size());
+        m_values.emplace_back(value);
+        m_valueViews.push_back(m_values.back());
+        m_slots[slot] = code;
+
+        // Keep the table at most half full
+        if (m_valueViews.size() * 2 > m_slots.size())
+        {
+            std::vector<uint32_t> slots(m_slots.size() * 2, 0);
+            size_t mask = slots.size() - 1;
+            for (uint32_t existing = 1; existing < m_valueViews.size(); ++existing)
+            {
+                size_t target = Hash(m_valueViews[existing]) & mask;
+                while (slots[target] != 0)
+                {
+                    target = (target + 1) & mask;
+                }
+                slots[target] = existing;
+            }
+            m_slots.swap(slots);
+        }
+        return code;
+    }
+
+    std::deque<std::wstring> m_values; // stable storage for the views
+    std::vector<std::wstring_view> m_valueViews;
+    std::vector<uint32_t> m_slots = std::vector<uint32_t>(16, 0); // open addressing, 0 is empty
+    std::vector<uint32_t> m_rowCodes;
+};
+
+namespace details
+{
+    // Order-preserving unsigned key of a signed number
+    inline uint64_t ToRadixKey(int64_t value, bool descending)
+    {
+        uint64_t key = static_cast<uint64_t>(value) ^ 0x8000000000000000ull;
+        return descending ? ~key : key;
+    }
+
+    // Bits needed to hold 'value'
+    inline unsigned BitWidth(uint64_t value)
+    {
+        unsigned bits = 0;
+        for (; value != 0; value >>= 1)
+        {
+            ++bits;
+        }
+        return bits;
+    }
+
+    constexpr unsigned c_radixMaxDigitBits = 11;
+    // Buckets this small are finished with an insertion sort
+    constexpr size_t c_radixInsertionRows = 16;
+
+    /* Stable MSD radix sort of values[0, count) by their bits [low, low + bits); rows, when not
+     * null, is permuted along. Each level scatters by the top digit, at most 11 bits and no
+     * wider than the bucket needs (10k rows: 2048 buckets of about five), through the buffers,
+     * then sorts each bucket by the bits below it. With keys rebased on their minimum a sort
+     * takes about two passes over the rows however wide the keys are. */
+    inline void RadixSortBits(uint64_t* values, uint32_t* rows, size_t count, unsigned low, unsigned bits,
+        uint64_t* valueBuffer, uint32_t* rowBuffer)
+    {
+        if (bits == 0 || count < 2)
+        {
+            return;
+        }
+
+        uint64_t keyMask = bits >= 64 ? ~0ull : (1ull << bits) - 1;
+        if (count <= c_radixInsertionRows)
+        {
+            for (size_t i = 1; i < count; ++i)
+            {
+                uint64_t value = values[i];
+                uint32_t row = rows ? rows[i] : 0;
+                uint64_t key = (value >> low) & keyMask;
+                size_t j = i;
+                for (; j > 0 && ((values[j - 1] >> low) & keyMask) > key; --j)
+                {
+                    values[j] = values[j - 1];
+                    if (rows)
+                    {
+                        rows[j] = rows[j - 1];
+                    }
+                }
+                values[j] = value;
+                if (rows)
+                {
+                    rows[j] = row;
+                }
+            }
+            return;
+        }
+
+        unsigned digitBits = (std::min)({ bits, c_radixMaxDigitBits, BitWidth(count) });
+        unsigned shift = low + bits - digitBits;
+        size_t buckets = size_t(1) << digitBits;
+        uint64_t digitMask = buckets - 1;
+
+        // Small buckets recurse with small digits; their offsets need no allocation
+        constexpr size_t maxLocalBuckets = 64;
+        uint32_t localOffsets[maxLocalBuckets + 1];
+        std::vector<uint32_t> heapOffsets(buckets > maxLocalBuckets ? buckets + 1 : 0);
+        uint32_t* offsets = buckets > maxLocalBuckets ? heapOffsets.data() : localOffsets;
+        std::fill(offsets, offsets + buckets + 1, 0u);
+        for (size_t i = 0; i < count; ++i)
+        {
+            ++offsets[((values[i] >> shift) & digitMask) + 1];
+        }
+        for (size_t bucket = 1; bucket <= buckets; ++bucket)
+        {
+            offsets[bucket] += offsets[bucket - 1];
+        }
+
+        // offsets[bucket] walks from the bucket's start to the next one's
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint32_t target = offsets[(values[i] >> shift) & digitMask]++;
+            valueBuffer[target] = values[i];
+            if (rows)
+            {
+                rowBuffer[target] = rows[i];
+            }
+        }
+        std::copy(valueBuffer, valueBuffer + count, values);
+        if (rows)
+        {
+            std::copy(rowBuffer, rowBuffer + count, rows);
+        }
+
+        unsigned remainingBits = bits - digitBits;
+        if (remainingBits == 0)
+        {
+            return;
+        }
+        uint32_t begin = 0;
+        for (size_t bucket = 0; bucket < buckets; ++bucket)
+        {
+            uint32_t end = offsets[bucket];
+            RadixSortBits(values + begin, rows ? rows + begin : nullptr, end - begin, low, remainingBits,
+                valueBuffer, rowBuffer);
+            begin = end;
+        }
+    }
+
+    inline void RadixSortBits(std::vector<uint64_t>& values, std::vector<uint32_t>* rows, unsigned low, unsigned bits)
+    {
+        std::vector<uint64_t> valueBuffer(values.size());
+        std::vector<uint32_t> rowBuffer(rows ? rows->size() : 0);
+        RadixSortBits(values.data(), rows ? rows->data() : nullptr, values.size(), low, bits, valueBuffer.data(),
+            rows ? rowBuffer.data() : nullptr);
+    }
+    // counts[code] += occurrences of each code; counts must hold 'cardinality' zeroed entries
+    inline void CountCodes(const uint32_t* codes, size_t count, uint32_t* counts, size_t cardinality)
+    {
+        size_t index = 0;
+#if defined(WSEARCH_RESULT_COLUMNS_SSE2)
+        // Small dictionaries (kinds): compare four codes against every value at once and
+        // subtract the all-ones masks, which counts without any scattered stores
+        constexpr size_t maxVectorCardinality = 8;
+        if (cardinality <= maxVectorCardinality)
+        {
+            __m128i values[maxVectorCardinality];
+            __m128i totals[maxVectorCardinality];
+            for (size_t value = 0; value < cardinality; ++value)
+            {
+                values[value] = _mm_set1_epi32(static_cast<int>(value));
+                totals[value] = _mm_setzero_si128();
+            }
+            for (; index + 4 <= count; index += 4)
+            {
+                __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(codes + index));
+                for (size_t value = 0; value < cardinality; ++value)
+                {
+                    totals[value] = _mm_sub_epi32(totals[value], _mm_cmpeq_epi32(block, values[value]));
+                }
+            }
+            for (size_t value = 0; value < cardinality; ++value)
+            {
+                alignas(16) uint32_t lanes[4];
+                _mm_store_si128(reinterpret_cast<__m128i*>(lanes), totals[value]);
+                counts[value] += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+            }
+        }
+#endif
+        // Larger dictionaries (extensions): four interleaved tables so runs of the same code do
+        // not serialize on one counter
+        if (index + 4 <= count && cardinality > 1)
+        {
+            std::vector<uint32_t> lanes(cardinality * 3, 0);
+            uint32_t* second = lanes.data();
+            uint32_t* third = second + cardinality;
+            uint32_t* fourth = third + cardinality;
+            for (; index + 4 <= count; index += 4)
+            {
+                ++counts[codes[index]];
+                ++second[codes[index + 1]];
+                ++third[codes[index + 2]];
+                ++fourth[codes[index + 3]];
+            }
+            for (size_t value = 0; value < cardinality; ++value)
+            {
+                counts[value] += second[value] + third[value] + fourth[value];
+            }
+        }
+        for (; index < count; ++index)
+        {
+            ++counts[codes[index]];
+        }
+    }
+} // namespace details
+
+/* ResultBatch - materialized results stored column by column
+ *
+ * FromPage converts a SearchValuePage: integer, FILETIME, bool and double properties become
+ * number columns (doubles truncated, missing values c_missingNumber), strings become category
+ * columns, and vector properties (System.Kind) are categorized by their first element.
+ *
+ * Example:
+ *   auto batch = wsearch::ResultBatch::FromPage(page, { wsearch::propid::Size, wsearch::propid::Kind });
+ *   auto order = batch.SortRows({ { wsearch::propid::Size, wsearch::ColumnSortOrder::Descending } });
+ *   auto kinds = batch.CountFacet(wsearch::propid::Kind);
+ */
+class ResultBatch
+{
+public:
+    explicit ResultBatch(size_t rowCount)
+        : m_rowCount(rowCount)
+    {
+    }
+
+    // 'columns' limits the conversion to the columns the view sorts or facets by; empty converts
+    // every column of the page (interning unique strings such as ItemUrl costs more than it saves)
+    static ResultBatch FromPage(const SearchValuePage& page, const std::vector<PropertyId>& columns = {})
+    {
+        ResultBatch batch(page.GetRowCount());
+        const auto& pageColumns = page.GetColumns();
+        for (size_t column = 0; column < pageColumns.size(); ++column)
+        {
+            if (!columns.empty() && std::find(columns.begin(), columns.end(), pageColumns[column]) == columns.end())
+            {
+                continue;
+            }
+
+            // The first value present decides the column's kind
+            SearchValueType type = SearchValueType::Empty;
+            for (size_t row = 0; row < page.GetRowCount() && type == SearchValueType::Empty; ++row)
+            {
+                type = page.GetRow(row)[column].Type();
+            }
+
+            // No value at all (no rows, or every folder lacks an extension): a well-known
+            // property still gets its column from the schema type, all missing
+            if (type == SearchValueType::Empty && pageColumns[column] < propid::WellKnownCount)
+            {
+                PropertyValueType schemaType = details::c_wellKnownProperties[pageColumns[column]].type;
+                type = (schemaType == PropertyValueType::String || schemaType == PropertyValueType::StringVector) ?
+                    SearchValueType::String : SearchValueType::Int64;
+            }
+
+            if (type == SearchValueType::String || type == SearchValueType::Vector)
+            {
+                CategoryColumn& category = batch.AddCategoryColumn(pageColumns[column]);
+                for (size_t row = 0; row < page.GetRowCount(); ++row)
+                {
+                    const SearchValue& value = page.GetRow(row)[column];
+                    auto items = value.GetVector();
+                    category.Append(items.empty() ? value.GetString() : items[0].GetString());
+                }
+            }
+            else if (type != SearchValueType::Empty)
+            {
+                std::vector<int64_t> numbers(page.GetRowCount());
+                for (size_t row = 0; row < numbers.size(); ++row)
+                {
+                    numbers[row] = ToNumber(page.GetRow(row)[column]);
+                }
+                batch.AddNumberColumn(pageColumns[column], std::move(numbers));
+            }
+        }
+        return batch;
+    }
+
+    size_t GetRowCount() const
+    {
+        return m_rowCount;
+    }
+
+    void AddNumberColumn(PropertyId id, std::vector<int64_t> values)
+    {
+        if (values.size() != m_rowCount)
+        {
+            throw std::invalid_argument("ResultBatch column length does not match the row count");
+        }
+        m_numbers.push_back({ id, std::move(values) });
+    }
+
+    // Call Append once per row on the returned column
+    CategoryColumn& AddCategoryColumn(PropertyId id)
+    {
+        m_categories.push_back({ id, CategoryColumn() });
+        return m_categories.back().values;
+    }
+
+    // nullptr when the batch has no such number column
+    const std::vector<int64_t>* GetNumberColumn(PropertyId id) const
+    {
+        for (const auto& column : m_numbers)
+        {
+            if (column.id == id)
+            {
+                return &column.values;
+            }
+        }
+        return nullptr;
+    }
+
+    // nullptr when the batch has no such category column
+    const CategoryColumn* GetCategoryColumn(PropertyId id) const
+    {
+        for (const auto& column : m_categories)
+        {
+            if (column.id == id)
+            {
+                return &column.values;
+            }
+        }
+        return nullptr;
+    }
+
+    // Row indexes ordered by the keys, first key most significant; ties keep the batch order.
+    // Category columns sort by value, missing values first. Throws std::invalid_argument for a
+    // column the batch does not have.
+    std::vector<uint32_t> SortRows(const std::vector<ColumnSortKey>& keys) const
+    {
+        std::vector<SortColumn> columns;
+        unsigned keyBits = 0;
+        for (const auto& key : keys)
+        {
+            columns.push_back(GetSortColumn(key));
+            keyBits += columns.back().bits;
+        }
+
+        std::vector<uint32_t> order(m_rowCount);
+        for (uint32_t row = 0; row < order.size(); ++row)
+        {
+            order[row] = row;
+        }
+
+        unsigned rowBits = details::BitWidth(m_rowCount);
+        if (keyBits + rowBits <= 64)
+        {
+            // Every key and the row fit one word: (key1 | key2 | ... | row), a single sort of a
+            // single array, and equal keys stay in row order
+            std::vector<uint64_t> packed(m_rowCount, 0);
+            for (const SortColumn& column : columns)
+            {
+                AppendSortKeys(column, packed);
+            }
+            for (size_t row = 0; row < m_rowCount; ++row)
+            {
+                packed[row] = (packed[row] << rowBits) | row;
+            }
+            details::RadixSortBits(packed, nullptr, rowBits, keyBits);
+            uint64_t rowMask = (1ull << rowBits) - 1;
+            for (size_t i = 0; i < m_rowCount; ++i)
+            {
+                order[i] = static_cast<uint32_t>(packed[i] & rowMask);
+            }
+        }
+        else if (keyBits <= 64)
+        {
+            // The keys fit one word (kind then FILETIME); the rows move alongside
+            std::vector<uint64_t> combined(m_rowCount, 0);
+            for (const SortColumn& column : columns)
+            {
+                AppendSortKeys(column, combined);
+            }
+            details::RadixSortBits(combined, &order, 0, keyBits);
+        }
+        else
+        {
+            // One stable sort per key, least significant first
+            std::vector<uint64_t> sortKeys(m_rowCount);
+            for (auto column = columns.rbegin(); column != columns.rend(); ++column)
+            {
+                for (size_t i = 0; i < m_rowCount; ++i)
+                {
+                    sortKeys[i] = GetSortKey(*column, order[i]) - column->lowest;
+                }
+                details::RadixSortBits(sortKeys, &order, 0, column->bits);
+            }
+        }
+        return order;
+    }
+
+    // Rows per value of a category column, most frequent first (ties by first appearance)
+    std::vector<FacetCount> CountFacet(PropertyId column) const
+    {
+        const CategoryColumn& category = GetCategory(column);
+        std::vector<uint32_t> counts(category.GetCardinality(), 0);
+        details::CountCodes(category.GetCodes().data(), category.GetCodes().size(), counts.data(), counts.size());
+
+        std::vector<FacetCount> facets;
+        for (uint32_t code = 0; code < counts.size(); ++code)
+        {
+            if (counts[code] != 0)
+            {
+                facets.push_back({ category.GetValue(code), counts[code] });
+            }
+        }
+        std::stable_sort(facets.begin(), facets.end(), [](const FacetCount& left, const FacetCount& right) {
+            return left.count > right.count;
+        });
+        return facets;
+    }
+
+    // Rows per pair of values of two category columns, most frequent first
+    std::vector<GroupCount> CountGroups(PropertyId firstColumn, PropertyId secondColumn) const
+    {
+        const CategoryColumn& first = GetCategory(firstColumn);
+        const CategoryColumn& second = GetCategory(secondColumn);
+        size_t secondCardinality = second.GetCardinality();
+        size_t groups = first.GetCardinality() * secondCardinality;
+
+        std::vector<GroupCount> result;
+        auto addGroup = [&](uint64_t group, uint32_t count) {
+            result.push_back({ first.GetValue(static_cast<uint32_t>(group / secondCardinality)),
+                second.GetValue(static_cast<uint32_t>(group % secondCardinality)), count });
+        };
+
+        const auto& firstCodes = first.GetCodes();
+        const auto& secondCodes = second.GetCodes();
+        constexpr size_t maxDenseGroups = 1 << 16;
+        if (groups <= maxDenseGroups)
+        {
+            std::vector<uint32_t> combined(m_rowCount);
+            for (size_t row = 0; row < m_rowCount; ++row)
+            {
+                combined[row] = static_cast<uint32_t>(firstCodes[row] * secondCardinality + secondCodes[row]);
+            }
+            std::vector<uint32_t> counts(groups, 0);
+            details::CountCodes(combined.data(), combined.size(), counts.data(), counts.size());
+            for (size_t group = 0; group < groups; ++group)
+            {
+                if (counts[group] != 0)
+                {
+                    addGroup(group, counts[group]);
+                }
+            }
+        }
+        else
+        {
+            std::unordered_map<uint64_t, uint32_t> counts;
+            for (size_t row = 0; row < m_rowCount; ++row)
+            {
+                ++counts[static_cast<uint64_t>(firstCodes[row]) * secondCardinality + secondCodes[row]];
+            }
+            for (const auto& entry : counts)
+            {
+                addGroup(entry.first, entry.second);
+            }
+        }
+
+        std::stable_sort(result.begin(), result.end(), [](const GroupCount& left, const GroupCount& right) {
+            return left.count > right.count;
+        });
+        return result;
+    }
+
+private:
+    // A sort key resolved to its typed column: order-preserving unsigned keys are rebased on
+    // the lowest, so 'bits' is what the key needs for this batch
+    struct SortColumn
+    {
+        const std::vector<int64_t>* numbers = nullptr;
+        const std::vector<uint32_t>* codes = nullptr;
+        std::vector<uint32_t> positions; // of each code when the values are sorted
+        bool descending = false;
+        uint64_t lowest = 0;
+        unsigned bits = 0;
+    };
+
+    SortColumn GetSortColumn(const ColumnSortKey& key) const
+    {
+        SortColumn column;
+        column.descending = key.order == ColumnSortOrder::Descending;
+        if ((column.numbers = GetNumberColumn(key.column)) == nullptr)
+        {
+            const CategoryColumn* category = GetCategoryColumn(key.column);
+            if (!category)
+            {
+                throw std::invalid_argument("ResultBatch has no column to sort by");
+            }
+            column.codes = &category->GetCodes();
+            column.positions = GetSortedPositions(*category);
+        }
+
+        uint64_t lowest = ~0ull;
+        uint64_t highest = 0;
+        for (size_t row = 0; row < m_rowCount; ++row)
+        {
+            uint64_t sortKey = GetSortKey(column, row);
+            lowest = (std::min)(lowest, sortKey);
+            highest = (std::max)(highest, sortKey);
+        }
+        if (m_rowCount != 0)
+        {
+            column.lowest = lowest;
+            column.bits = details::BitWidth(highest - lowest);
+        }
+        return column;
+    }
+
+    static uint64_t GetSortKey(const SortColumn& column, size_t row)
+    {
+        if (column.numbers)
+        {
+            return details::ToRadixKey((*column.numbers)[row], column.descending);
+        }
+        return details::ToRadixKey(column.positions[(*column.codes)[row]], column.descending);
+    }
+
+    // keys[row] = (keys[row] << bits) | rebased key of the row; shifted twice, as a 64-bit key
+    // shifts by 64
+    void AppendSortKeys(const SortColumn& column, std::vector<uint64_t>& keys) const
+    {
+        if (column.bits == 0)
+        {
+            return;
+        }
+        if (column.numbers)
+        {
+            const int64_t* numbers = column.numbers->data();
+            for (size_t row = 0; row < m_rowCount; ++row)
+            {
+                keys[row] = (keys[row] << (column.bits - 1) << 1) | (details::ToRadixKey(numbers[row], column.descending) - column.lowest);
+            }
+        }
+        else
+        {
+            const uint32_t* codes = column.codes->data();
+            for (size_t row = 0; row < m_rowCount; ++row)
+            {
+                keys[row] = (keys[row] << (column.bits - 1) << 1) |
+                    (details::ToRadixKey(column.positions[codes[row]], column.descending) - column.lowest);
+            }
+        }
+    }
+
+    static int64_t ToNumber(const SearchValue& value)
+    {
+        switch (value.Type())
+        {
+        case SearchValueType::UInt32:
+        case SearchValueType::UInt64:
+            return static_cast<int64_t>((std::min)(value.GetUInt64(), static_cast<uint64_t>((std::numeric_limits<int64_t>::max)())));
+        case SearchValueType::Int32:
+        case SearchValueType::Int64:
+            return value.GetInt64();
+        case SearchValueType::FileTime:
+            return static_cast<int64_t>(*value.GetFileTime());
+        case SearchValueType::Bool:
+            return value.GetBool() ? 1 : 0;
+        case SearchValueType::Double:
+        {
+            double number = value.GetDouble();
+            // NaN and out-of-range doubles have no int64 value
+            return (number > -9.2e18 && number < 9.2e18) ? static_cast<int64_t>(number) : c_missingNumber;
+        }
+        default:
+            return c_missingNumber;
+        }
+    }
+
+    // Position of each code when the column's values are sorted
+    static std::vector<uint32_t> GetSortedPositions(const CategoryColumn& category)
+    {
+        std::vector<uint32_t> codes(category.GetCardinality());
+        for (uint32_t code = 0; code < codes.size(); ++code)
+        {
+            codes[code] = code;
+        }
+        std::sort(codes.begin(), codes.end(), [&](uint32_t left, uint32_t right) {
+            return category.GetValue(left) < category.GetValue(right);
+        });
+        std::vector<uint32_t> positions(codes.size());
+        for (uint32_t position = 0; position < codes.size(); ++position)
+        {
+            positions[codes[position]] = position;
+        }
+        return positions;
+    }
+
+    const CategoryColumn& GetCategory(PropertyId id) const
+    {
+        const CategoryColumn* category = GetCategoryColumn(id);
+        if (!category)
+        {
+            throw std::invalid_argument("ResultBatch has no such category column");
+        }
+        return *category;
+    }
+
+    struct NumberColumn
+    {
+        PropertyId id;
+        std::vector<int64_t> values;
+    };
+
+    struct NamedCategoryColumn
+    {
+        PropertyId id;
+        CategoryColumn values;
+    };
+
+    size_t m_rowCount;
+    std::vector<NumberColumn> m_numbers;
+    std::deque<NamedCategoryColumn> m_categories; // stable for AddCategoryColumn's reference
+};
+
+} // namespace wsearch
@@ -0,0 +1,342 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace wsearch
+{
+
+/* IResultPageSource - reads decoded rows from an open result set
+ *
+ * 'start' is a row index as the user sees it. The cursor only asks for a start that is 0 or the
+ * end of a range it has already read, so a forward-only source can track its position.
+ * Returning fewer rows than 'count' marks the end of the results. Only ever called from one
+ * thread at a time.
+ */
+template <typename Row>
+class IResultPageSource
+{
+public:
+    virtual ~IResultPageSource() = default;
+
+    virtual size_t ReadRows(size_t start, size_t count, std::vector<Row>& rows) = 0;
+
+    // Called on the cursor's worker thread before its first read and after its last one
+    // (e.g. to join and leave a COM apartment); the source is not read again after stopping
+    virtual void OnWorkerThreadStarted() {}
+    virtual void OnWorkerThreadStopping() {}
+};
+
+struct ResultCursorOptions
+{
+    size_t pageSize = 64;         // rows decoded per read
+    size_t prefetchPages = 2;     // pages read ahead of the last visible row
+    size_t maxResidentPages = 8;  // decoded pages kept; the ones farthest from the viewport go first
+};
+
+struct ResultCursorStatistics
+{
+    size_t pageReads = 0;
+    size_t pageEvictions = 0;
+    size_t misses = 0; // VisitRow calls for a row that was not decoded yet
+    size_t residentPages = 0;
+};
+
+/* ResultCursor - windowed, on-demand view over a result set for virtualized lists
+ *
+ * Keeps the source open and decodes rows a page at a time on a background thread as the list
+ * asks for them, reading a couple of pages ahead of the viewport and dropping decoded pages that
+ * are far from it. Memory stays at maxResidentPages pages however far the user scrolls.
+ * The row count is discovered as pages are read: GetKnownRowCount() grows until IsComplete().
+ *
+ * VisitRow() never blocks on the source. If the row is not decoded it returns false and queues
+ * the page; 'onChanged' fires from the worker once it arrives (and whenever the known count
+ * grows), so the owner can invalidate its list.
+ *
+ * Example:
+ *   auto cursor = std::make_unique<wsearch::ResultCursor<Item>>(std::move(source), options,
+ *       [hwnd]() { PostMessageW(hwnd, WM_RESULTS_CHANGED, 0, 0); });
+ *   cursor->ReadFirstPage();
+ *   // LVN_ODCACHEHINT:  cursor->SetViewport(hint->iFrom, hint->iTo);
+ *   // LVN_GETDISPINFO:  cursor->VisitRow(index, [&](const Item& item) { ... });
+ */
+template <typename Row>
+class ResultCursor
+{
+public:
+    using ChangedCallback = std::function<void()>;
+
+    ResultCursor(std::unique_ptr<IResultPageSource<Row>> source, ResultCursorOptions options = {},
+        ChangedCallback onChanged = nullptr)
+        : m_source(std::move(source))
+        , m_options(options)
+        , m_onChanged(std::move(onChanged))
+    {
+        m_options.pageSize = std::max<size_t>(m_options.pageSize, 1);
+        m_options.maxResidentPages = std::max<size_t>(m_options.maxResidentPages, m_options.prefetchPages + 1);
+    }
+
+    ~ResultCursor()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_shouldStop = true;
+        }
+        m_cv.notify_one();
+
+        if (m_workerThread.joinable())
+        {
+            m_workerThread.join();
+        }
+    }
+
+    // Non-copyable
+    ResultCursor(const ResultCursor&) = delete;
+    ResultCursor& operator=(const ResultCursor&) = delete;
+
+    // Read page 0 on the calling thread so results can be shown with rows already decoded.
+    // Call before handing the cursor to the UI; returns the number of rows in the first page.
+    size_t ReadFirstPage()
+    {
+        LoadPage(0);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_pages.find(0);
+        return it == m_pages.end() ? 0 : it->second.size();
+    }
+
+    // Calls 'visitor' with the row under the cursor's lock and returns true if it is decoded;
+    // otherwise schedules its page and returns false. Copy anything that must outlive the call.
+    template <typename Visitor>
+    bool VisitRow(size_t index, Visitor&& visitor)
+    {
+        size_t page = index / m_options.pageSize;
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        auto it = m_pages.find(page);
+        if (it != m_pages.end() && (index % m_options.pageSize) < it->second.size())
+        {
+            visitor(it->second[index % m_options.pageSize]);
+            return true;
+        }
+
+        ++m_statistics.misses;
+        RequestPagesLocked(page, page);
+        lock.unlock();
+        m_cv.notify_one();
+        return false;
+    }
+
+    // Rows [first, last] are on screen: read them and the pages after them, and let the pages
+    // farthest from here be evicted first. Feed this from LVN_ODCACHEHINT.
+    void SetViewport(size_t first, size_t last)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            RequestPagesLocked(first / m_options.pageSize, std::max(first, last) / m_options.pageSize);
+        }
+        m_cv.notify_one();
+    }
+
+    // Rows discovered so far; final once IsComplete()
+    size_t GetKnownRowCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_knownRows;
+    }
+
+    bool IsComplete() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_complete;
+    }
+
+    ResultCursorStatistics GetStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto statistics = m_statistics;
+        statistics.residentPages = m_pages.size();
+        return statistics;
+    }
+
+    // Block until every requested page has been read (tests and benchmarks)
+    void WaitForIdle()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idleCv.wait(lock, [this]() { return m_wanted.empty() && !m_reading; });
+    }
+
+private:
+    // The hot window is the viewport plus the prefetch after it, capped at what may stay resident.
+    // Pages past the first unread one can't be located yet; they are requested again by the
+    // prefetch that follows each read.
+    void RequestPagesLocked(size_t firstPage, size_t lastPage)
+    {
+        m_viewportFirst = firstPage;
+        m_viewportLast = lastPage;
+        m_hotFirst = firstPage;
+        m_hotLast = std::min(lastPage + m_options.prefetchPages, firstPage + m_options.maxResidentPages - 1);
+
+        size_t readable = m_complete ? (m_knownRows + m_options.pageSize - 1) / m_options.pageSize : m_knownPages + 1;
+        size_t end = std::min(m_hotLast + 1, readable);
+        for (size_t page = firstPage; page < end; ++page)
+        {
+            if (m_pages.find(page) == m_pages.end() && m_loading.find(page) == m_loading.end())
+            {
+                m_wanted.insert(page);
+            }
+        }
+
+        // Anything outside the hot window would only push out a page that is needed
+        for (auto it = m_wanted.begin(); it != m_wanted.end();)
+        {
+            it = (DistanceToHotWindow(*it) > 0) ? m_wanted.erase(it) : std::next(it);
+        }
+
+        if (!m_wanted.empty() && !m_workerThread.joinable())
+        {
+            m_workerThread = std::thread(&ResultCursor::WorkerThreadProc, this);
+        }
+    }
+
+    size_t DistanceToHotWindow(size_t page) const
+    {
+        if (page < m_hotFirst)
+        {
+            return m_hotFirst - page;
+        }
+        return page > m_hotLast ? page - m_hotLast : 0;
+    }
+
+    void LoadPage(size_t page)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_loading.insert(page);
+        }
+
+        std::vector<Row> rows;
+        rows.reserve(m_options.pageSize);
+
+        size_t read = 0;
+        try
+        {
+            read = m_source->ReadRows(page * m_options.pageSize, m_options.pageSize, rows);
+        }
+        catch (...)
+        {
+            // A failing source ends the results where it failed
+            read = 0;
+            rows.clear();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_statistics.pageReads;
+            m_loading.erase(page);
+
+            if (page >= m_knownPages)
+            {
+                m_knownPages = page + 1;
+                m_knownRows = page * m_options.pageSize + read;
+                m_complete = read < m_options.pageSize;
+            }
+            if (!rows.empty())
+            {
+                m_pages[page] = std::move(rows);
+            }
+
+            while (m_pages.size() > m_options.maxResidentPages)
+            {
+                auto farthest = m_pages.begin();
+                for (auto it = m_pages.begin(); it != m_pages.end(); ++it)
+                {
+                    if (DistanceToHotWindow(it->first) > DistanceToHotWindow(farthest->first))
+                    {
+                        farthest = it;
+                    }
+                }
+                m_pages.erase(farthest);
+                ++m_statistics.pageEvictions;
+            }
+
+            // Keep reading ahead of the viewport now that the next page can be located
+            RequestPagesLocked(m_viewportFirst, m_viewportLast);
+        }
+    }
+
+    void WorkerThreadProc()
+    {
+        m_source->OnWorkerThreadStarted();
+        for (;;)
+        {
+            size_t page = 0;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_reading = false;
+                if (m_wanted.empty())
+                {
+                    m_idleCv.notify_all();
+                }
+                m_cv.wait(lock, [this]() { return m_shouldStop || !m_wanted.empty(); });
+                if (m_shouldStop)
+                {
+                    break;
+                }
+
+                // Visible pages first, then the nearest prefetch
+                auto next = m_wanted.begin();
+                for (auto it = m_wanted.begin(); it != m_wanted.end(); ++it)
+                {
+                    if (DistanceToHotWindow(*it) < DistanceToHotWindow(*next))
+                    {
+                        next = it;
+                    }
+                }
+                page = *next;
+                m_wanted.erase(next);
+                m_reading = true;
+            }
+
+            LoadPage(page);
+            if (m_onChanged)
+            {
+                m_onChanged();
+            }
+        }
+        m_source->OnWorkerThreadStopping();
+    }
+
+    std::unique_ptr<IResultPageSource<Row>> m_source;
+    ResultCursorOptions m_options;
+    ChangedCallback m_onChanged;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::condition_variable m_idleCv;
+    std::map<size_t, std::vector<Row>> m_pages;
+    std::set<size_t> m_wanted;
+    std::set<size_t> m_loading;
+    size_t m_viewportFirst = 0;
+    size_t m_viewportLast = 0;
+    size_t m_hotFirst = 0;
+    size_t m_hotLast = 0;
+    size_t m_knownPages = 0;
+    size_t m_knownRows = 0;
+    bool m_complete = false;
+    bool m_reading = false;
+    bool m_shouldStop = false;
+    ResultCursorStatistics m_statistics;
+
+    std::thread m_workerThread;
+};
+
+} // namespace wsearch
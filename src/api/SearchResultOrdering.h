@@ -0,0 +1,173 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include "SearchValue.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace wsearch
+{
+
+// Extra rows fetched past TOP N when the indexer orders by rank only, so rank ties at the cut
+// can still be broken client-side
+constexpr size_t c_defaultOrderingHeadroom = 64;
+
+struct ResultOrderOptions
+{
+    // Break rank ties by frecency (launch count decayed by time since last access) instead of
+    // the raw launch count
+    bool useFrecency = false;
+    double frecencyHalfLifeDays = 14.0;
+    // Current time in FILETIME ticks for frecency; 0 reads the system clock
+    uint64_t nowTicks = 0;
+};
+
+/* ResultOrderKey - compact sort key of one result row
+ *
+ * Rank and the launch count (or frecency) share one word, so most comparisons are decided by
+ * a single integer compare; DateAccessed and GatherTime break the remaining ties. Larger is
+ * better for every field. 'row' is the row's index in the page it was built from.
+ */
+struct ResultOrderKey
+{
+    uint64_t rankAndUsage;
+    uint64_t accessed;
+    uint64_t gathered;
+    uint32_t row;
+};
+
+// Rows in display order plus whether that order is certain
+struct OrderedRows
+{
+    std::vector<uint32_t> rows; // page row indexes, best first
+    // False when the rows fetched ended inside the rank tie at the cut, so a row the indexer
+    // did not return could have won a tie-break (fetch more headroom to be sure)
+    bool exact = true;
+};
+
+namespace details
+{
+    constexpr uint64_t c_ticksPerDay = 864000000000ull;
+    // FILETIME ticks at the Unix epoch
+    constexpr uint64_t c_unixEpochTicks = 116444736000000000ull;
+
+    inline uint64_t CurrentFileTimeTicks()
+    {
+        auto sinceEpoch = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch());
+        return c_unixEpochTicks + static_cast<uint64_t>(sinceEpoch.count() / 100);
+    }
+
+    // (launches + 1) halved every 'halfLifeDays' since the last access, in 1/65536 units
+    inline uint32_t FrecencyScore(uint32_t launches, uint64_t accessedTicks, uint64_t nowTicks, double halfLifeDays)
+    {
+        double ageDays = 0.0;
+        if (accessedTicks == 0)
+        {
+            // Never opened: as stale as the decay can express
+            ageDays = halfLifeDays * 16;
+        }
+        else if (accessedTicks < nowTicks)
+        {
+            ageDays = static_cast<double>(nowTicks - accessedTicks) / static_cast<double>(c_ticksPerDay);
+        }
+        double score = (static_cast<double>(launches) + 1.0) * std::exp2(-ageDays / halfLifeDays) * 65536.0;
+        return (score >= 4294967295.0) ? 0xFFFFFFFFu : static_cast<uint32_t>(score);
+    }
+
+    inline bool IsBetterResult(const ResultOrderKey& left, const ResultOrderKey& right)
+    {
+        if (left.rankAndUsage != right.rankAndUsage) return left.rankAndUsage > right.rankAndUsage;
+        if (left.accessed != right.accessed) return left.accessed > right.accessed;
+        if (left.gathered != right.gathered) return left.gathered > right.gathered;
+        return left.row < right.row; // keep the indexer's order
+    }
+
+    inline uint32_t RankOf(const ResultOrderKey& key)
+    {
+        return static_cast<uint32_t>(key.rankAndUsage >> 32);
+    }
+} // namespace details
+
+// One key per row of a page holding propid::SearchRank, DocumentLineCount, DateAccessed and
+// SearchGatherTime columns (missing columns count as zero)
+inline std::vector<ResultOrderKey> BuildResultOrderKeys(const SearchValuePage& page, const ResultOrderOptions& options = {})
+{
+    size_t rankColumn = page.GetColumnIndex(propid::SearchRank);
+    size_t launchColumn = page.GetColumnIndex(propid::DocumentLineCount);
+    size_t accessedColumn = page.GetColumnIndex(propid::DateAccessed);
+    size_t gatheredColumn = page.GetColumnIndex(propid::SearchGatherTime);
+    uint64_t now = (options.useFrecency && options.nowTicks == 0) ? details::CurrentFileTimeTicks() : options.nowTicks;
+
+    static const SearchValue empty;
+    auto column = [&](const SearchValueRow& values, size_t index) -> const SearchValue& {
+        return (index == SearchValuePage::npos) ? empty : values[index];
+    };
+
+    std::vector<ResultOrderKey> keys(page.GetRowCount());
+    for (size_t row = 0; row < keys.size(); ++row)
+    {
+        auto values = page.GetRow(row);
+        // Rank is 0-1000; bias it so negative values still order below zero
+        uint32_t rank = static_cast<uint32_t>(column(values, rankColumn).GetInt32()) ^ 0x80000000u;
+        uint32_t launches = column(values, launchColumn).GetUInt32();
+        uint64_t accessed = column(values, accessedColumn).GetFileTime().value_or(0);
+        uint32_t usage = options.useFrecency ? details::FrecencyScore(launches, accessed, now, options.frecencyHalfLifeDays) : launches;
+
+        ResultOrderKey& key = keys[row];
+        key.rankAndUsage = (static_cast<uint64_t>(rank) << 32) | usage;
+        key.accessed = accessed;
+        key.gathered = column(values, gatheredColumn).GetFileTime().value_or(0);
+        key.row = static_cast<uint32_t>(row);
+    }
+    return keys;
+}
+
+/* OrderTopResults - the best 'count' rows by rank, then launch count (or frecency), DateAccessed
+ * and GatherTime
+ *
+ * Selects with nth_element and sorts only the winners, so ordering N of M rows is O(M + N log N).
+ * 'fetchLimit' is the TOP the rows were fetched with (0 when unlimited); it decides whether the
+ * order is exact.
+ *
+ * Example:
+ *   auto keys = wsearch::BuildResultOrderKeys(page);
+ *   auto ordered = wsearch::OrderTopResults(keys, 50, builder.GetFetchLimit());
+ *   for (uint32_t row : ordered.rows) { Show(page.GetRow(row)); }
+ */
+inline OrderedRows OrderTopResults(std::vector<ResultOrderKey>& keys, size_t count, size_t fetchLimit)
+{
+    OrderedRows result;
+    count = (std::min)(count, keys.size());
+    if (count == 0)
+    {
+        return result;
+    }
+
+    // The indexer returned rows by rank, so the lowest fetched rank bounds what was cut off
+    uint32_t lowestFetchedRank = details::RankOf(keys[0]);
+    for (const auto& key : keys)
+    {
+        lowestFetchedRank = (std::min)(lowestFetchedRank, details::RankOf(key));
+    }
+
+    if (count < keys.size())
+    {
+        std::nth_element(keys.begin(), keys.begin() + (count - 1), keys.end(), details::IsBetterResult);
+    }
+    std::sort(keys.begin(), keys.begin() + count, details::IsBetterResult);
+
+    result.rows.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        result.rows.push_back(keys[i].row);
+    }
+    bool truncated = fetchLimit != 0 && keys.size() >= fetchLimit;
+    result.exact = !truncated || details::RankOf(keys[count - 1]) > lowestFetchedRank;
+    return result;
+}
+
+} // namespace wsearch
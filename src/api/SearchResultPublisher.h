@@ -0,0 +1,297 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include "SearchExpected.h"
+#include "SearchSynchronization.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace wsearch
+{
+
+/* ResultSnapshot - one published set of results, immutable once published
+ *
+ * 'request' is the revision of the search text the results answer: sessions number every
+ * text change, so a snapshot whose request is older than the session's latest is out of date
+ * (the query for the newer text is still pending). Build one with the constructor, or default
+ * construct it and assign the members, so every field is initialized.
+ */
+template <typename Result>
+struct ResultSnapshot
+{
+    ResultSnapshot() = default;
+
+    ResultSnapshot(uint64_t revision, std::wstring text, Result value = {})
+        : request(revision)
+        , searchText(std::move(text))
+        , result(std::move(value))
+    {
+    }
+
+    uint64_t generation = 0;  // 0 until something is published; one more with every publication
+    uint64_t request = 0;
+    std::wstring searchText;
+    Result result{};
+    SearchError error{};      // why 'result' is empty, if 'failed'
+    bool failed = false;
+    int64_t startTicks = 0;   // when the query started, in the publisher's clock units (0 if none ran)
+    double durationMs = 0.0;
+};
+
+namespace details
+{
+    struct ResultSubscriptionState
+    {
+        std::mutex deliveryMutex;
+        std::atomic<std::thread::id> deliveringThread{};
+        bool active = true;          // guarded by deliveryMutex
+        uint64_t lastGeneration = 0; // guarded by deliveryMutex
+    };
+} // namespace details
+
+/* ResultSubscription - keeps a ResultPublisher callback subscribed while it lives
+ *
+ * Destroying or resetting it unsubscribes. Once that returns the callback is not running and
+ * will not run again, unless it is reset from inside its own callback, where it returns at
+ * once. Two callbacks must not reset each other's subscriptions, or both would wait forever.
+ */
+class ResultSubscription
+{
+public:
+    ResultSubscription() = default;
+
+    explicit ResultSubscription(std::shared_ptr<details::ResultSubscriptionState> state)
+        : m_state(std::move(state))
+    {
+    }
+
+    ResultSubscription(ResultSubscription&& other) noexcept = default;
+
+    ResultSubscription& operator=(ResultSubscription&& other) noexcept
+    {
+        if (this != &other)
+        {
+            Reset();
+            m_state = std::move(other.m_state);
+        }
+        return *this;
+    }
+
+    ~ResultSubscription()
+    {
+        Reset();
+    }
+
+    void Reset()
+    {
+        auto state = std::move(m_state);
+        if (!state)
+        {
+            return;
+        }
+        if (state->deliveringThread.load() == std::this_thread::get_id())
+        {
+            // Inside our own callback: the delivering thread (this one) holds deliveryMutex
+            state->active = false;
+            return;
+        }
+        std::lock_guard<std::mutex> lock(state->deliveryMutex);
+        state->active = false;
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return m_state != nullptr;
+    }
+
+private:
+    std::shared_ptr<details::ResultSubscriptionState> m_state;
+};
+
+/* ResultPublisher - hands results from the query thread to any number of readers without locks
+ *
+ * Every Publish swaps in a new immutable snapshot. Readers get the latest with GetSnapshot and
+ * keep it as long as they like; publishing never waits for them and they never wait for the
+ * session's mutex. A UI polling each frame calls Refresh, which costs one atomic load of the
+ * generation unless something new landed. Subscribers are called on the publishing thread with
+ * each newer generation, never with an older one after a newer one. Callbacks must be quick,
+ * must not throw and must not publish.
+ *
+ * Results for an older request than the published ones are stale (a slow query for "rep"
+ * finishing after the one for "report") and are dropped.
+ *
+ * Example:
+ *   wsearch::ResultPublisher<size_t> results;
+ *   auto subscription = results.Subscribe([](const auto& snapshot) { Repaint(snapshot->result); });
+ *   results.Publish({ 1, L"rep", 120 });                     // generation 1
+ *
+ *   std::shared_ptr<const wsearch::ResultSnapshot<size_t>> shown;
+ *   if (results.Refresh(shown)) { Draw(shown->result); }     // from another thread
+ */
+template <typename Result>
+class ResultPublisher
+{
+public:
+    using Snapshot = ResultSnapshot<Result>;
+    using Callback = std::function<void(const std::shared_ptr<const Snapshot>&)>;
+
+    ResultPublisher()
+        : m_snapshot(std::make_shared<const Snapshot>())
+        , m_subscribers(std::make_shared<const std::vector<Subscriber>>())
+    {
+    }
+
+    // Non-copyable
+    ResultPublisher(const ResultPublisher&) = delete;
+    ResultPublisher& operator=(const ResultPublisher&) = delete;
+
+    std::shared_ptr<const Snapshot> GetSnapshot() const
+    {
+        return m_snapshot.Load();
+    }
+
+    uint64_t GetGeneration() const noexcept
+    {
+        return m_generation.load(std::memory_order_acquire);
+    }
+
+    // Replaces 'snapshot' (which may be null) with the latest one if that is newer; returns
+    // whether it did
+    bool Refresh(std::shared_ptr<const Snapshot>& snapshot) const
+    {
+        if (snapshot && snapshot->generation == GetGeneration())
+        {
+            return false;
+        }
+        snapshot = GetSnapshot();
+        return true;
+    }
+
+    // Publishes 'snapshot' as the next generation (its 'generation' is assigned here) and calls
+    // the subscribers on this thread. Returns what was published, or null if it was stale.
+    std::shared_ptr<const Snapshot> Publish(Snapshot snapshot)
+    {
+        auto next = std::make_shared<Snapshot>(std::move(snapshot));
+        auto current = GetSnapshot();
+        do
+        {
+            if (current->request > next->request)
+            {
+                return nullptr;
+            }
+            next->generation = current->generation + 1;
+        } while (!m_snapshot.CompareExchange(current, next));
+
+        // Concurrent publishers may finish out of order; the generation only moves forward
+        uint64_t generation = m_generation.load();
+        while (generation < next->generation && !m_generation.compare_exchange_weak(generation, next->generation))
+        {
+        }
+
+        if (m_waiters.load() > 0)
+        {
+            // Taking the lock orders this with a waiter between its check and its wait
+            {
+                std::lock_guard<std::mutex> lock(m_waitMutex);
+            }
+            m_waitCv.notify_all();
+        }
+
+        std::shared_ptr<const Snapshot> published = std::move(next);
+        auto subscribers = m_subscribers.Load();
+        for (const auto& subscriber : *subscribers)
+        {
+            Deliver(subscriber, published);
+        }
+        return published;
+    }
+
+    // Blocks until results for 'request' or a later one are published, and returns them
+    std::shared_ptr<const Snapshot> WaitForRequest(uint64_t request)
+    {
+        auto snapshot = GetSnapshot();
+        if (snapshot->request >= request)
+        {
+            return snapshot;
+        }
+
+        std::unique_lock<std::mutex> lock(m_waitMutex);
+        ++m_waiters;
+        m_waitCv.wait(lock, [&] {
+            snapshot = GetSnapshot();
+            return snapshot->request >= request;
+        });
+        --m_waiters;
+        return snapshot;
+    }
+
+    // Calls 'callback' with every generation published from now on, while the returned
+    // subscription lives
+    ResultSubscription Subscribe(Callback callback)
+    {
+        auto state = std::make_shared<details::ResultSubscriptionState>();
+        {
+            std::lock_guard<std::mutex> lock(m_subscribeMutex);
+            auto subscribers = std::make_shared<std::vector<Subscriber>>();
+            for (const auto& subscriber : *m_subscribers.Load())
+            {
+                // Drop the ones whose ResultSubscription is gone
+                if (subscriber.state.use_count() > 1)
+                {
+                    subscribers->push_back(subscriber);
+                }
+            }
+            subscribers->push_back({ state, std::move(callback) });
+            m_subscribers.Store(std::move(subscribers));
+        }
+        return ResultSubscription(std::move(state));
+    }
+
+private:
+    struct Subscriber
+    {
+        std::shared_ptr<details::ResultSubscriptionState> state;
+        Callback callback;
+    };
+
+    static void Deliver(const Subscriber& subscriber, const std::shared_ptr<const Snapshot>& snapshot)
+    {
+        auto& state = *subscriber.state;
+        std::lock_guard<std::mutex> lock(state.deliveryMutex);
+        if (!state.active || state.lastGeneration >= snapshot->generation)
+        {
+            return;
+        }
+        state.lastGeneration = snapshot->generation;
+        state.deliveringThread = std::this_thread::get_id();
+        try
+        {
+            subscriber.callback(snapshot);
+        }
+        catch (...)
+        {
+            // A failing subscriber must not keep the others from their results
+        }
+        state.deliveringThread = std::thread::id();
+    }
+
+    details::AtomicSharedPtr<const Snapshot> m_snapshot;
+    std::atomic<uint64_t> m_generation{ 0 };
+
+    std::mutex m_subscribeMutex; // serializes Subscribe's copy-on-write of m_subscribers
+    details::AtomicSharedPtr<const std::vector<Subscriber>> m_subscribers;
+
+    std::mutex m_waitMutex;
+    std::condition_variable m_waitCv;
+    std::atomic<size_t> m_waiters{ 0 };
+};
+
+} // namespace wsearch
@@ -0,0 +1,149 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include "SearchPlatCore.h"
+#include "SearchResultCursor.h"
+#include <functional>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+namespace wsearch
+{
+
+/* RowsetPageSource - IResultPageSource over an open indexer rowset
+ *
+ * Decodes rows through IPropertyStore with the caller's decoder, which may drop rows (return
+ * false), so user-visible indices are mapped to rowset positions as ranges are read. Uses
+ * IRowsetLocate to jump straight to a position when the rowset supports it; otherwise it reads
+ * forward and restarts the rowset to go back to a page that was evicted.
+ *
+ * Example:
+ *   auto source = std::make_unique<wsearch::RowsetPageSource<Item>>(rowset,
+ *       [](IPropertyStore* store, Item& item) { item.name = GetName(store); return !item.name.empty(); });
+ *   wsearch::ResultCursor<Item> cursor(std::move(source));
+ */
+template <typename Row>
+class RowsetPageSource : public IResultPageSource<Row>
+{
+public:
+    using Decoder = std::function<bool(IPropertyStore*, Row&)>;
+
+    RowsetPageSource(winrt::com_ptr<IRowset> rowset, Decoder decoder)
+        : m_rowset(std::move(rowset))
+        , m_decoder(std::move(decoder))
+    {
+        m_getRow = m_rowset.as<IGetRow>();
+        m_locate = m_rowset.try_as<IRowsetLocate>();
+        m_positions[0] = 0;
+    }
+
+    size_t ReadRows(size_t start, size_t count, std::vector<Row>& rows) override
+    {
+        auto known = m_positions.find(start);
+        if (known == m_positions.end())
+        {
+            throw std::invalid_argument("Row range does not start where a previous read ended");
+        }
+
+        size_t position = known->second;
+        size_t produced = 0;
+        while (produced < count)
+        {
+            HROW rowBuffer[64];
+            HROW* rowReturned = rowBuffer;
+            DBCOUNTITEM rowCountReturned = 0;
+
+            // Each row yields at most one result, so this never reads past the end of the range
+            DBROWCOUNT request = static_cast<DBROWCOUNT>((std::min)(ARRAYSIZE(rowBuffer), count - produced));
+            HRESULT hr = FetchRowsAt(position, request, &rowCountReturned, &rowReturned);
+            if (hr == DB_S_ENDOFROWSET && rowCountReturned == 0)
+            {
+                break;
+            }
+            THROW_IF_FAILED(hr);
+
+            auto releaseRows = wil::scope_exit([&]() {
+                m_rowset->ReleaseRows(rowCountReturned, rowReturned, nullptr, nullptr, nullptr);
+            });
+
+            for (DBCOUNTITEM i = 0; i < rowCountReturned; ++i)
+            {
+                winrt::com_ptr<IUnknown> unknown;
+                THROW_IF_FAILED(m_getRow->GetRowFromHROW(nullptr, rowBuffer[i], __uuidof(IPropertyStore), unknown.put()));
+
+                Row row;
+                if (m_decoder(unknown.as<IPropertyStore>().get(), row))
+                {
+                    rows.push_back(std::move(row));
+                    ++produced;
+                }
+            }
+
+            position += static_cast<size_t>(rowCountReturned);
+            if (rowCountReturned < static_cast<DBCOUNTITEM>(request))
+            {
+                break;
+            }
+        }
+
+        m_positions[start + produced] = position;
+        return produced;
+    }
+
+    // The cursor's worker reads from the MTA; the rowset is released there too
+    void OnWorkerThreadStarted() override
+    {
+        winrt::init_apartment(winrt::apartment_type::multi_threaded);
+    }
+
+    void OnWorkerThreadStopping() override
+    {
+        m_locate = nullptr;
+        m_getRow = nullptr;
+        m_rowset = nullptr;
+        winrt::uninit_apartment();
+    }
+
+    // True when pages are located directly rather than by re-reading from the start
+    bool SupportsRandomAccess() const
+    {
+        return m_locate != nullptr;
+    }
+
+private:
+    HRESULT FetchRowsAt(size_t position, DBROWCOUNT request, DBCOUNTITEM* rowCountReturned, HROW** rowReturned)
+    {
+        if (m_locate)
+        {
+            BYTE first = DBBMK_FIRST;
+            return m_locate->GetRowsAt(0, DB_NULL_HCHAPTER, sizeof(first), &first,
+                static_cast<DBROWOFFSET>(position), request, rowCountReturned, rowReturned);
+        }
+
+        if (position < m_nextFetch)
+        {
+            THROW_IF_FAILED(m_rowset->RestartPosition(DB_NULL_HCHAPTER));
+            m_nextFetch = 0;
+        }
+
+        HRESULT hr = m_rowset->GetNextRows(DB_NULL_HCHAPTER, static_cast<DBROWOFFSET>(position - m_nextFetch),
+            request, rowCountReturned, rowReturned);
+        if (SUCCEEDED(hr))
+        {
+            m_nextFetch = position + static_cast<size_t>(*rowCountReturned);
+        }
+        return hr;
+    }
+
+    winrt::com_ptr<IRowset> m_rowset;
+    winrt::com_ptr<IGetRow> m_getRow;
+    winrt::com_ptr<IRowsetLocate> m_locate;
+    Decoder m_decoder;
+
+    // User-visible row index -> rowset position, recorded at the end of every read
+    std::map<size_t, size_t> m_positions;
+    size_t m_nextFetch = 0;
+};
+
+} // namespace wsearch
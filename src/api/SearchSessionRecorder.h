@@ -0,0 +1,482 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace wsearch
+{
+
+// Operations a search-as-you-type session can receive, in trace order
+enum class SessionOperation : uint8_t
+{
+    AppendCharacters = 0,
+    SetSearchText = 1,
+    Clear = 2,
+    ExecuteQueryNow = 3,
+    GetCachedResults = 4,
+    TrackResultClick = 5,
+};
+
+constexpr size_t SessionOperationCount = 6;
+
+inline const wchar_t* SessionOperationName(SessionOperation operation)
+{
+    switch (operation)
+    {
+    case SessionOperation::AppendCharacters: return L"AppendCharacters";
+    case SessionOperation::SetSearchText: return L"SetSearchText";
+    case SessionOperation::Clear: return L"Clear";
+    case SessionOperation::ExecuteQueryNow: return L"ExecuteQueryNow";
+    case SessionOperation::GetCachedResults: return L"GetCachedResults";
+    case SessionOperation::TrackResultClick: return L"TrackResultClick";
+    }
+    return L"Unknown";
+}
+
+// One recorded operation. Timestamps are relative to the start of the recording.
+struct SessionTraceEvent
+{
+    std::chrono::microseconds timestamp{ 0 };
+    SessionOperation operation = SessionOperation::SetSearchText;
+    std::wstring text;
+};
+
+struct SessionRecorderOptions
+{
+    // Replace recorded text with a keyed hash that keeps length, whitespace, punctuation
+    // and prefix structure ("rep" and "report" still share their first three characters)
+    bool hashText = false;
+
+    // Unset draws a random key for each recorder. The key is never written to the trace; set it
+    // only to compare hashed traces from several recorders, and keep it secret like the text.
+    std::optional<uint64_t> hashKey;
+};
+
+/* SearchSessionRecorder - Opt-in keystroke trace recorder for search sessions
+ *
+ * Captures (timestamp, operation, text) for every session call into a compact binary trace
+ * that SearchSessionReplayer can drive against any session implementation. Recording is
+ * thread-safe and costs one lock and one small copy per operation.
+ *
+ * When hashing is enabled only per-prefix hash state is retained, never the typed text. The
+ * hash key stays in the recorder, so a trace alone cannot be matched against guessed prefixes.
+ *
+ * Example:
+ *   auto recorder = std::make_shared<wsearch::SearchSessionRecorder>();
+ *   session.SetRecorder(recorder);
+ *   ... user types ...
+ *   recorder->SaveToFile(L"typing.wstrace");
+ */
+class SearchSessionRecorder
+{
+public:
+    explicit SearchSessionRecorder(SessionRecorderOptions options = {})
+        : m_options(options)
+        , m_hashKey(options.hashKey ? *options.hashKey : DrawHashKey())
+        , m_startTime(std::chrono::steady_clock::now())
+    {
+    }
+
+    // Non-copyable
+    SearchSessionRecorder(const SearchSessionRecorder&) = delete;
+    SearchSessionRecorder& operator=(const SearchSessionRecorder&) = delete;
+
+    void Record(SessionOperation operation, std::wstring_view text = {})
+    {
+        auto timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - m_startTime);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        SessionTraceEvent event;
+        event.timestamp = timestamp;
+        event.operation = operation;
+        event.text = m_options.hashText ? HashText(operation, text) : std::wstring(text);
+        m_events.push_back(std::move(event));
+    }
+
+    std::vector<SessionTraceEvent> GetEvents() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_events;
+    }
+
+    size_t GetEventCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_events.size();
+    }
+
+    bool IsHashingText() const
+    {
+        return m_options.hashText;
+    }
+
+    /* Binary trace layout (all integers are LEB128 varints unless noted)
+     *   "WSTR" magic (4 bytes), version (1 byte), flags (1 byte, bit 0 = hashed text)
+     *   event count
+     *   per event: timestamp delta in microseconds, operation (1 byte), text length, code units
+     * ASCII-heavy traces cost roughly 3 bytes plus one byte per typed character per event.
+     */
+    std::vector<uint8_t> Serialize() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return SerializeEvents(m_events, m_options.hashText);
+    }
+
+    void SaveToFile(const std::wstring& path) const
+    {
+        auto bytes = Serialize();
+        std::ofstream file(std::filesystem::path(path), std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Failed to open session trace for writing");
+        }
+        file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    static std::vector<uint8_t> SerializeEvents(const std::vector<SessionTraceEvent>& events, bool hashed)
+    {
+        std::vector<uint8_t> bytes = { 'W', 'S', 'T', 'R', TraceVersion, static_cast<uint8_t>(hashed ? 1 : 0) };
+        WriteVarint(bytes, events.size());
+
+        int64_t previous = 0;
+        for (const auto& event : events)
+        {
+            int64_t current = event.timestamp.count();
+            WriteVarint(bytes, static_cast<uint64_t>((std::max)(current - previous, static_cast<int64_t>(0))));
+            previous = (std::max)(current, previous);
+
+            bytes.push_back(static_cast<uint8_t>(event.operation));
+            WriteVarint(bytes, event.text.size());
+            for (wchar_t ch : event.text)
+            {
+                WriteVarint(bytes, static_cast<uint64_t>(static_cast<std::make_unsigned_t<wchar_t>>(ch)));
+            }
+        }
+        return bytes;
+    }
+
+    static std::vector<SessionTraceEvent> Deserialize(const std::vector<uint8_t>& bytes)
+    {
+        if (bytes.size() < 6 || bytes[0] != 'W' || bytes[1] != 'S' || bytes[2] != 'T' || bytes[3] != 'R')
+        {
+            throw std::invalid_argument("Not a session trace");
+        }
+        if (bytes[4] != TraceVersion)
+        {
+            throw std::invalid_argument("Unsupported session trace version");
+        }
+
+        size_t offset = 6;
+        uint64_t count = ReadVarint(bytes, offset);
+
+        std::vector<SessionTraceEvent> events;
+        events.reserve(static_cast<size_t>((std::min)(count, static_cast<uint64_t>(bytes.size()))));
+
+        int64_t timestamp = 0;
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            SessionTraceEvent event;
+            timestamp += static_cast<int64_t>(ReadVarint(bytes, offset));
+            event.timestamp = std::chrono::microseconds(timestamp);
+
+            if (offset >= bytes.size() || bytes[offset] >= SessionOperationCount)
+            {
+                throw std::invalid_argument("Corrupt session trace operation");
+            }
+            event.operation = static_cast<SessionOperation>(bytes[offset++]);
+
+            uint64_t length = ReadVarint(bytes, offset);
+            if (length > bytes.size() - offset)
+            {
+                throw std::invalid_argument("Corrupt session trace text length");
+            }
+            event.text.reserve(static_cast<size_t>(length));
+            for (uint64_t c = 0; c < length; ++c)
+            {
+                event.text.push_back(static_cast<wchar_t>(ReadVarint(bytes, offset)));
+            }
+
+            events.push_back(std::move(event));
+        }
+        return events;
+    }
+
+    static std::vector<SessionTraceEvent> LoadFromFile(const std::wstring& path)
+    {
+        std::ifstream file(std::filesystem::path(path), std::ios::binary);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Failed to open session trace for reading");
+        }
+        std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        return Deserialize(bytes);
+    }
+
+private:
+    static constexpr uint8_t TraceVersion = 1;
+
+    static void WriteVarint(std::vector<uint8_t>& bytes, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            bytes.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        bytes.push_back(static_cast<uint8_t>(value));
+    }
+
+    static uint64_t ReadVarint(const std::vector<uint8_t>& bytes, size_t& offset)
+    {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            if (offset >= bytes.size())
+            {
+                throw std::invalid_argument("Truncated session trace");
+            }
+            uint8_t byte = bytes[offset++];
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return value;
+            }
+        }
+        throw std::invalid_argument("Corrupt session trace varint");
+    }
+
+    static uint64_t DrawHashKey()
+    {
+        std::random_device device;
+        return (static_cast<uint64_t>(device()) << 32) ^ static_cast<uint64_t>(device());
+    }
+
+    static uint64_t MixHash(uint64_t state, wchar_t ch)
+    {
+        uint64_t z = state ^ (static_cast<uint64_t>(ch) * 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // Letters map to letters and digits to digits, keyed on the whole prefix up to and
+    // including the character. Separators pass through so token and quote structure survive.
+    static wchar_t HashCharacter(uint64_t prefixHash, wchar_t ch)
+    {
+        if (ch < 0x80 && !((ch >= L'a' && ch <= L'z') || (ch >= L'A' && ch <= L'Z') || (ch >= L'0' && ch <= L'9')))
+        {
+            return ch;
+        }
+        if (ch >= L'0' && ch <= L'9')
+        {
+            return static_cast<wchar_t>(L'0' + (prefixHash % 10));
+        }
+        return static_cast<wchar_t>(L'a' + (prefixHash % 26));
+    }
+
+    // Caller holds m_mutex
+    std::wstring HashText(SessionOperation operation, std::wstring_view text)
+    {
+        std::wstring hashed;
+        hashed.reserve(text.size());
+
+        switch (operation)
+        {
+        case SessionOperation::SetSearchText:
+            m_prefixHashes.clear();
+            [[fallthrough]];
+        case SessionOperation::AppendCharacters:
+            for (wchar_t ch : text)
+            {
+                uint64_t state = m_prefixHashes.empty() ? m_hashKey : m_prefixHashes.back();
+                m_prefixHashes.push_back(MixHash(state, ch));
+                hashed += HashCharacter(m_prefixHashes.back(), ch);
+            }
+            break;
+
+        case SessionOperation::Clear:
+            m_prefixHashes.clear();
+            break;
+
+        default:
+        {
+            // Standalone text (clicked paths) hashes from its own start
+            uint64_t state = m_hashKey ^ 0xC11C4ull;
+            for (wchar_t ch : text)
+            {
+                state = MixHash(state, ch);
+                hashed += HashCharacter(state, ch);
+            }
+            break;
+        }
+        }
+
+        return hashed;
+    }
+
+    SessionRecorderOptions m_options;
+    uint64_t m_hashKey;
+    std::chrono::steady_clock::time_point m_startTime;
+
+    mutable std::mutex m_mutex;
+    std::vector<SessionTraceEvent> m_events;
+    std::vector<uint64_t> m_prefixHashes;
+};
+
+struct SessionReplayOptions
+{
+    // 1.0 replays at recorded speed, 10.0 ten times faster, 0 replays back to back
+    double speed = 1.0;
+};
+
+// Latency samples for one operation type
+struct SessionReplayOperationStats
+{
+    size_t count = 0;
+    double totalMs = 0.0;
+    double maxMs = 0.0;
+    std::vector<double> samplesMs;
+
+    double AverageMs() const
+    {
+        return count ? totalMs / static_cast<double>(count) : 0.0;
+    }
+
+    // p in [0, 1]
+    double PercentileMs(double p) const
+    {
+        if (samplesMs.empty())
+        {
+            return 0.0;
+        }
+        std::vector<double> sorted(samplesMs);
+        size_t rank = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+        std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+        return sorted[rank];
+    }
+};
+
+struct SessionReplayStatistics
+{
+    SessionReplayOperationStats operations[SessionOperationCount];
+    size_t eventsReplayed = 0;
+    size_t queriesExecuted = 0;  // only when the session exposes GetExecutedQueryCount()
+    double wallClockMs = 0.0;
+
+    const SessionReplayOperationStats& For(SessionOperation operation) const
+    {
+        return operations[static_cast<size_t>(operation)];
+    }
+};
+
+namespace details
+{
+    template <typename T, typename = void>
+    struct HasExecutedQueryCount : std::false_type {};
+
+    template <typename T>
+    struct HasExecutedQueryCount<T, std::void_t<decltype(std::declval<T&>().GetExecutedQueryCount())>> : std::true_type {};
+}
+
+/* SearchSessionReplayer - Drives a recorded trace against a session
+ *
+ * Works with any type exposing the search-as-you-type surface (AppendCharacters, SetSearchText,
+ * Clear, ExecuteQueryNow, GetCachedResults, TrackResultClick), including SearchAsYouTypeSession
+ * and test fakes. Each call is timed; if the session exposes GetExecutedQueryCount() the number
+ * of queries that actually reached the indexer is reported as well.
+ *
+ * Example:
+ *   auto trace = wsearch::SearchSessionRecorder::LoadFromFile(L"typing.wstrace");
+ *   auto stats = wsearch::SearchSessionReplayer::Replay(session, trace, { 4.0 });
+ *   auto p95 = stats.For(wsearch::SessionOperation::GetCachedResults).PercentileMs(0.95);
+ */
+struct SearchSessionReplayer
+{
+    template <typename Session>
+    static SessionReplayStatistics Replay(
+        Session& session,
+        const std::vector<SessionTraceEvent>& events,
+        SessionReplayOptions options = {})
+    {
+        SessionReplayStatistics stats;
+
+        size_t queriesBefore = 0;
+        if constexpr (details::HasExecutedQueryCount<Session>::value)
+        {
+            queriesBefore = static_cast<size_t>(session.GetExecutedQueryCount());
+        }
+
+        auto replayStart = std::chrono::steady_clock::now();
+        for (const auto& event : events)
+        {
+            if (options.speed > 0.0)
+            {
+                auto due = replayStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double, std::micro>(static_cast<double>(event.timestamp.count()) / options.speed));
+                std::this_thread::sleep_until(due);
+            }
+
+            auto callStart = std::chrono::steady_clock::now();
+            Dispatch(session, event);
+            double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - callStart).count();
+
+            auto& operationStats = stats.operations[static_cast<size_t>(event.operation)];
+            ++operationStats.count;
+            operationStats.totalMs += elapsedMs;
+            operationStats.maxMs = (std::max)(operationStats.maxMs, elapsedMs);
+            operationStats.samplesMs.push_back(elapsedMs);
+            ++stats.eventsReplayed;
+        }
+
+        stats.wallClockMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - replayStart).count();
+
+        if constexpr (details::HasExecutedQueryCount<Session>::value)
+        {
+            stats.queriesExecuted = static_cast<size_t>(session.GetExecutedQueryCount()) - queriesBefore;
+        }
+
+        return stats;
+    }
+
+private:
+    template <typename Session>
+    static void Dispatch(Session& session, const SessionTraceEvent& event)
+    {
+        switch (event.operation)
+        {
+        case SessionOperation::AppendCharacters:
+            session.AppendCharacters(event.text);
+            break;
+        case SessionOperation::SetSearchText:
+            session.SetSearchText(event.text);
+            break;
+        case SessionOperation::Clear:
+            session.Clear();
+            break;
+        case SessionOperation::ExecuteQueryNow:
+            session.ExecuteQueryNow();
+            break;
+        case SessionOperation::GetCachedResults:
+            session.GetCachedResults();
+            break;
+        case SessionOperation::TrackResultClick:
+            session.TrackResultClick(event.text);
+            break;
+        }
+    }
+};
+
+} // namespace wsearch
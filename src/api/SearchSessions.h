@@ -2,12 +2,27 @@
 #pragma once
 
 #include "SearchPlatCore.h"
+#include "SearchClock.h"
+#include "SearchDeadline.h"
+#include "SearchDebouncedQueryRunner.h"
+#include "SearchIndexerCountSource.h"
+#include "SearchIndexerScopePrimer.h"
+#include "SearchPropertySchemaSource.h"
+#include "SearchQueryCost.h"
+#include "SearchResultPublisher.h"
 #include "SearchSessionPropertyHelpers.h"
+#include "SearchSessionRecorder.h"
+#include "SearchTermStatistics.h"
+#include "SearchSynchronization.h"
 #include <thread>
 #include <mutex>
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <functional>
+#include <optional>
+#include <memory_resource>
+#include <stdexcept>
 
 namespace wsearch
 {
@@ -19,34 +34,91 @@ namespace wsearch
 class SearchSessionBase : public TelemetryProvider
 {
 protected:
-    std::vector<std::wstring> m_includedScopes;
-    std::vector<std::wstring> m_excludedScopes;
     std::vector<std::wstring> m_additionalProperties;
-    
-    // Cached priming rowset for query optimization
-    mutable winrt::com_ptr<IRowset> m_prefetchRowset;
-    mutable std::wstring m_prefetchSql;
+
+    // Registry ids of m_additionalProperties, in the same order
+    std::vector<PropertyId> m_additionalPropertyIds;
+
+    // The scopes searched, with their priming SQL and (once primed) rowset and REUSEWHERE id;
+    // replaced whole by SetScopes, so always read it once with Load
+    mutable details::AtomicSharedPtr<const SessionScope> m_scope;
+
+    // Primed scope sets, so switching back to one costs no priming query (private to the
+    // session unless SetScopeCache was called)
+    details::AtomicSharedPtr<SessionScopeCache> m_scopeCache;
 
     // Result click tracking for property updates
     std::shared_ptr<SearchResultPropertyUpdater> m_propertyUpdater;
 
+    // Optional keystroke trace recorder (null unless SetRecorder was called)
+    details::AtomicSharedPtr<SearchSessionRecorder> m_recorder;
+
+    // Upstream of the per-query arenas (the heap unless SetQueryMemoryResource was called)
+    std::atomic<std::pmr::memory_resource*> m_queryMemoryResource{ std::pmr::new_delete_resource() };
+
+    // Optional rewriting of expensive search text (null unless SetQueryCostPolicy was called)
+    details::AtomicSharedPtr<const QueryCostModel> m_costModel;
+
+    // Optional result count and latency statistics (null unless SetTermStatistics was called)
+    details::AtomicSharedPtr<SearchTermStatistics> m_termStatistics;
+
     SearchSessionBase(
         std::vector<std::wstring> includedScopes,
         std::vector<std::wstring> excludedScopes,
         std::vector<std::wstring> additionalProperties)
-        : m_includedScopes(std::move(includedScopes))
-        , m_excludedScopes(std::move(excludedScopes))
-        , m_additionalProperties(std::move(additionalProperties))
+        : m_additionalProperties(std::move(additionalProperties))
+        , m_scopeCache(std::make_shared<SessionScopeCache>(std::make_shared<IndexerScopePrimer>()))
         , m_propertyUpdater(std::make_shared<SearchResultPropertyUpdater>())
     {
+        ResolveAdditionalProperties();
+        m_scope.Store(SessionScopeCache::Describe(includedScopes, excludedScopes, m_additionalProperties));
     }
 
     virtual ~SearchSessionBase() = default;
 
+    // Rewrites the additional properties as canonical names and records their registry ids, so
+    // additional property i stays column 1 + i. A duplicate or System.ItemUrl (which every
+    // session query selects first) throws std::invalid_argument.
+    void ResolveAdditionalProperties()
+    {
+        auto& registry = details::GetSharedPropertyRegistry();
+        PropertyIdSet selected;
+        selected.Insert(propid::ItemUrl);
+
+        std::vector<std::wstring> canonical;
+        for (const auto& property : m_additionalProperties)
+        {
+            PropertyId id = registry.Intern(property);
+            if (!selected.Insert(id))
+            {
+                throw std::invalid_argument(id == propid::ItemUrl
+                    ? "System.ItemUrl is always selected and cannot be an additional property"
+                    : "Additional property is selected twice");
+            }
+            canonical.emplace_back(registry.GetName(id));
+            m_additionalPropertyIds.push_back(id);
+        }
+        m_additionalProperties = std::move(canonical);
+    }
+
+    void RecordOperation(SessionOperation operation, std::wstring_view text = {}) const
+    {
+        auto recorder = m_recorder.Load();
+        if (recorder)
+        {
+            recorder->Record(operation, text);
+        }
+    }
+
     // Build priming SQL from scopes
     std::wstring BuildPrimingSql() const
     {
-        return details::BuildPrimingSqlFromScopes(m_includedScopes, m_excludedScopes, m_additionalProperties);
+        return m_scope.Load()->sql;
+    }
+
+    // Called after SetScopes has switched scopes
+    virtual void OnScopesChanged()
+    {
     }
 
     /* Prepare for search initializes the provider with a starting rowset, minimizing
@@ -58,68 +130,363 @@ protected:
      * The query contains basic information about the scope of the data you want to search over.
      * When executing queries, the priming rowset is reused to avoid index decoding per query instance.
      * This is the optimal way to issue queries using OLEDB/SQL.
+     * The rowset comes through the scope cache, so scopes this session (or one sharing its
+     * cache) primed before are not primed again.
      */
     void PrepareForSearch()
     {
         TelemetryProvider::LogInfo(L"Preparing for search");
-        m_prefetchSql = BuildPrimingSql();
-        m_prefetchRowset = details::ExecuteQuery(m_prefetchSql);
+        details::ThrowIfSearchError(TryPrimeScope());
+        TelemetryProvider::LogInfo(L"Search preparation complete");
+    }
 
-        // After we get the rowset, prioritize the scopes
-        winrt::com_ptr<IRowsetPrioritization> rowsetPrioritization = m_prefetchRowset.as<IRowsetPrioritization>();
-        rowsetPrioritization->SetScopePriority(PRIORITY_LEVEL_FOREGROUND, 100);
+    // The current scopes, primed first if they are not yet
+    SearchExpected<std::shared_ptr<const SessionScope>> TryPrimeScope() const
+    {
+        auto scope = m_scope.Load();
+        if (scope->rowset)
+        {
+            return scope;
+        }
 
-        TelemetryProvider::LogInfo(L"Search preparation complete");
+        auto primed = m_scopeCache.Load()->TryAcquire(scope->includedScopes, scope->excludedScopes, m_additionalProperties);
+        if (!primed)
+        {
+            return primed.Error();
+        }
+
+        // Publish it, unless SetScopes switched scopes meanwhile
+        std::shared_ptr<const SessionScope> primedScope = std::move(*primed);
+        m_scope.CompareExchange(scope, primedScope);
+        return primedScope;
     }
 
     // Execute a search query with priming optimization using cached rowset
     winrt::com_ptr<IRowset> ExecuteSearchWithPriming(const std::wstring& searchText) const
     {
-        // Use cached priming rowset if available
-        DWORD whereId;
-        if (m_prefetchRowset)
+        return details::ThrowIfSearchError(TryExecuteSearchWithPriming(searchText));
+    }
+
+    // ExecuteSearchWithPriming that returns indexer failures instead of throwing
+    SearchExpected<winrt::com_ptr<IRowset>> TryExecuteSearchWithPriming(const std::wstring& searchText) const
+    {
+        // Build the final query on a per-query arena; it is released in one shot on return
+        QueryArena arena(m_queryMemoryResource.load());
+        std::pmr::wstring finalSql(arena.Resource());
+        auto scope = TryAppendReuseWhereSearchSql(finalSql, searchText, arena);
+        if (!scope)
+        {
+            return scope.Error();
+        }
+
+        // Execute and return the search query
+        return TryExecuteSearchQuery(finalSql, searchText, (*scope)->includedScopes);
+    }
+
+    // Text typed with no word in it ("-", "or", "$$") has no query; run without a full-text
+    // condition it would list the whole scope, so it fails with E_INVALIDARG instead
+    static SearchExpected<void> TryCheckSearchText(std::wstring_view searchText)
+    {
+        if (!ParseSearchText(details::LimitSearchText(searchText)).HasQuery())
+        {
+            return SearchError{ E_INVALIDARG, L"ParseSearchText" };
+        }
+        return {};
+    }
+
+    // Runs 'searchText' through the cost model on the query's arena and logs the plan; the
+    // tokens are charged to the Tokenize stage and the logged description to Logging
+    static QueryPlan PlanOnArena(const QueryCostModel& costModel, std::wstring_view searchText, const SessionScope& scope,
+        QueryArena& arena)
+    {
+        auto plan = [&]() {
+            AllocationStageScope stage(arena, QueryAllocationStage::Tokenize);
+            return costModel.Plan(searchText, scope.includedScopes, 0, arena.Resource());
+        }();
+
+        AllocationStageScope stage(arena, QueryAllocationStage::Logging);
+        std::pmr::wstring description(arena.Resource());
+        plan.AppendDescription(description);
+        TelemetryProvider::LogInfo(L"Query cost plan for '%.*ls': %ls", static_cast<int>(searchText.size()), searchText.data(), description.c_str());
+        return plan;
+    }
+
+    // Appends the query over the primed scope's REUSEWHERE id for 'searchText' to 'sql' (built on
+    // 'arena'); returns the scope it searches
+    SearchExpected<std::shared_ptr<const SessionScope>> TryAppendReuseWhereSearchSql(
+        std::pmr::wstring& finalSql, std::wstring_view searchText, QueryArena& arena) const
+    {
+        auto checked = TryCheckSearchText(searchText);
+        if (!checked)
         {
-            whereId = details::GetReuseWhereIDFromRowset(m_prefetchRowset);
+            return checked.Error();
+        }
+
+        // Primed scopes keep their REUSEWHERE id, so this costs no indexer call once primed
+        auto primed = TryPrimeScope();
+        if (!primed)
+        {
+            return primed.Error();
+        }
+        const SessionScope& scope = **primed;
+
+        auto costModel = m_costModel.Load();
+        if (costModel)
+        {
+            auto plan = PlanOnArena(*costModel, searchText, scope, arena);
+
+            AllocationStageScope stage(arena, QueryAllocationStage::Sql);
+            std::pmr::wstring contentText(arena.Resource());
+            plan.AppendTokens(contentText, true);
+            details::AppendReuseWhereSearchSql(finalSql, m_additionalProperties, scope.whereId, contentText, plan.topN,
+                plan.FilenameOnlyTokens());
         }
         else
         {
-            // Fallback: create priming rowset on-the-fly
-            std::wstring primingSql = BuildPrimingSql();
-            auto primingRowset = details::ExecuteQuery(primingSql);
-            whereId = details::GetReuseWhereIDFromRowset(primingRowset);
+            AllocationStageScope stage(arena, QueryAllocationStage::Sql);
+            details::AppendReuseWhereSearchSql(finalSql, m_additionalProperties, scope.whereId, searchText);
         }
+        return primed;
+    }
 
-        // Build the search WHERE clause
-        std::wstring whereClause = details::BuildSearchWhereClause(searchText);
+    // The SQL this session runs for 'searchText' (see TryStartSearch); the REUSEWHERE form
+    // unless the session searches another way
+    virtual SearchExpected<std::shared_ptr<const SessionScope>> TryAppendSearchSql(
+        std::pmr::wstring& sql, std::wstring_view searchText, QueryArena& arena) const
+    {
+        return TryAppendReuseWhereSearchSql(sql, searchText, arena);
+    }
+
+    // Executes a search query; with SetTermStatistics, also records its MSIDXSPROP_RESULTS_FOUND
+    // count and how long the indexer took to return the rowset
+    SearchExpected<winrt::com_ptr<IRowset>> TryExecuteSearchQuery(std::wstring_view sql, std::wstring_view searchText,
+        const std::vector<std::wstring>& scopes) const
+    {
+        return TryExecuteRecordedQuery(m_termStatistics.Load(), sql, searchText, scopes);
+    }
 
-        // Build the final query
-        std::wstring finalSql = L"SELECT System.ItemUrl";
-        for (const auto& prop : m_additionalProperties)
+    // TryExecuteSearchQuery without the session, for queries that outlive the call
+    static SearchExpected<winrt::com_ptr<IRowset>> TryExecuteRecordedQuery(const std::shared_ptr<SearchTermStatistics>& statistics,
+        std::wstring_view sql, std::wstring_view searchText, const std::vector<std::wstring>& scopes)
+    {
+        if (!statistics)
         {
-            finalSql += L", " + prop;
+            return details::TryExecuteQuery(sql);
         }
-        finalSql += L" FROM SystemIndex WHERE REUSEWHERE(" + std::to_wstring(whereId) + L")";
-        finalSql += whereClause;
-        finalSql += L" ORDER BY System.Search.Rank DESC";
 
-        // Execute and return the search query
-        return details::ExecuteQuery(finalSql);
+        auto start = std::chrono::steady_clock::now();
+        auto rowset = details::TryExecuteQuery(sql);
+        if (rowset)
+        {
+            auto latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+            try
+            {
+                statistics->Record(searchText, scopes, details::GetTotalRowsForRowset(*rowset), latency);
+            }
+            catch (...)
+            {
+                // Statistics are advisory; the query itself succeeded
+                TelemetryProvider::LogInfo(L"Could not record term statistics");
+            }
+        }
+        return rowset;
     }
 
 public:
-    // Get total files in the index
-    size_t GetTotalFilesInIndex() const
+    /* TryStartSearch - runs this session's query for 'searchText' on a thread of its own
+     *
+     * Priming and building the SQL happen on the calling thread; Execute, fetching and decoding
+     * each row with 'decode' (false drops the row) happen on the query's, so a Wait with a
+     * deadline returns on time with the rows decoded so far however long the indexer takes.
+     * Cancellation is checked after Execute and between rows. Rows are decoded in the MTA.
+     *
+     * Example:
+     *   auto query = session.TryStartSearch<Item>(L"report", [](IPropertyStore* store, Item& item) {
+     *       item.name = GetName(store);
+     *       return !item.name.empty();
+     *   });
+     *   auto results = (*query)->Wait(wsearch::SearchDeadline::After(std::chrono::milliseconds(30)));
+     *   Paint(results->rows);
+     *   if (results->partial) { Paint((*query)->WaitForCompletion()->rows); }
+     */
+    template <typename Row>
+    SearchExpected<std::unique_ptr<DeadlineQuery<Row>>> TryStartSearch(std::wstring_view searchText,
+        std::function<bool(IPropertyStore*, Row&)> decode, DeadlineQueryOptions options = {}) const
+    {
+        std::wstring sql;
+        std::vector<std::wstring> scopes;
+        {
+            QueryArena arena(m_queryMemoryResource.load());
+            std::pmr::wstring querySql(arena.Resource());
+            auto scope = TryAppendSearchSql(querySql, searchText, arena);
+            if (!scope)
+            {
+                return scope.Error();
+            }
+            sql.assign(querySql.data(), querySql.size());
+            scopes = (*scope)->includedScopes;
+        }
+
+        // The query may outlive this session, so it takes copies of everything it needs
+        auto producer = [sql = std::move(sql), text = std::wstring(searchText), scopes = std::move(scopes),
+                         statistics = m_termStatistics.Load(),
+                         decode = std::move(decode)](typename DeadlineQuery<Row>::Progress& progress) -> SearchExpected<void> {
+            winrt::init_apartment(winrt::apartment_type::multi_threaded);
+            auto leaveApartment = wil::scope_exit([]() { winrt::uninit_apartment(); });
+
+            auto rowset = TryExecuteRecordedQuery(statistics, sql, text, scopes);
+            if (!rowset)
+            {
+                return rowset.Error();
+            }
+            if (progress.IsCancelled())
+            {
+                return {};
+            }
+            return details::TryDecodeRowsInto<Row>(rowset->get(), decode, progress);
+        };
+        return std::make_unique<DeadlineQuery<Row>>(std::move(producer), std::move(options));
+    }
+
+    // Runs the query and returns the rows decoded by 'deadline', flagged partial if the deadline
+    // came first (the rest of the query is then abandoned)
+    template <typename Row>
+    SearchExpected<PartialResults<Row>> TrySearchWithin(std::wstring_view searchText, const SearchDeadline& deadline,
+        std::function<bool(IPropertyStore*, Row&)> decode) const
+    {
+        DeadlineQueryOptions options;
+        options.continueInBackground = false;
+        auto query = TryStartSearch<Row>(searchText, std::move(decode), std::move(options));
+        if (!query)
+        {
+            return query.Error();
+        }
+        return (*query)->Wait(deadline);
+    }
+
+    // Get total files in the index. Counts come from the process-wide IndexCountService: one
+    // taken within 'maxAge' is returned as is, otherwise this waits for a fresh count that
+    // concurrent callers share. Throws the HRESULT of a failed count.
+    size_t GetTotalFilesInIndex(std::chrono::steady_clock::duration maxAge = std::chrono::seconds(30)) const
+    {
+        return details::ThrowIfSearchError(TryGetTotalFilesInIndex(maxAge));
+    }
+
+    SearchExpected<size_t> TryGetTotalFilesInIndex(std::chrono::steady_clock::duration maxAge = std::chrono::seconds(30)) const
     {
         TelemetryProvider::LogInfo(L"Getting total files in index");
-        std::wstring sql(L"SELECT System.ItemUrl FROM SystemIndex WHERE SCOPE='file:'");
-        auto rowset = details::ExecuteQuery(sql);
-        return details::GetTotalRowsForRowset(rowset);
+        auto count = details::GetSharedIndexCountService()->GetCountNoOlderThan(L"file:", maxAge);
+        if (count.lastRefreshFailed)
+        {
+            return count.lastError;
+        }
+        if (!count.known || count.age > maxAge)
+        {
+            // The service was shut down before a fresh enough count
+            return SearchError{ E_ABORT, L"IndexCountService::RefreshNow" };
+        }
+        return count.count;
+    }
+
+    // The last known number of files in the index and its age, without waiting; for status
+    // displays that refresh themselves (the count is refreshed in the background)
+    IndexCount GetCachedTotalFilesInIndex() const
+    {
+        return details::GetSharedIndexCountService()->GetCount(L"file:");
+    }
+
+    // Ids of the additional properties; in the SELECT list of session queries property i is
+    // column 1 + i (column 0 is System.ItemUrl)
+    const std::vector<PropertyId>& GetAdditionalPropertyIds() const
+    {
+        return m_additionalPropertyIds;
+    }
+
+    // REUSEWHERE ID of the session's primed scopes, for queries that should run against them
+    // (e.g. BulkLookupOptions::reuseWhereId); nullopt until the session has been primed
+    std::optional<uint64_t> GetPrimingReuseWhereId() const
+    {
+        auto scope = m_scope.Load();
+        if (!scope->rowset)
+        {
+            return std::nullopt;
+        }
+        return scope->whereId;
+    }
+
+    std::vector<std::wstring> GetIncludedScopes() const
+    {
+        return m_scope.Load()->includedScopes;
+    }
+
+    std::vector<std::wstring> GetExcludedScopes() const
+    {
+        return m_scope.Load()->excludedScopes;
+    }
+
+    /* Search other scopes from now on (e.g. a launcher's "Documents" / "Pictures" / "All" toggle)
+     *
+     * The new scopes are primed here, on the calling thread, unless the scope cache already
+     * holds them: switching back to recently used scopes costs no indexer call. Scope sets
+     * match after normalization (case, '\' or '/', trailing slashes, order). Searches already
+     * running finish against the old scopes. An invalid scope throws std::invalid_argument.
+     */
+    void SetScopes(const std::vector<std::wstring>& includedScopes, const std::vector<std::wstring>& excludedScopes = {})
+    {
+        details::ThrowIfSearchError(TrySetScopes(includedScopes, excludedScopes));
+    }
+
+    // SetScopes that returns indexer failures instead of throwing; on failure the session keeps
+    // its current scopes
+    SearchExpected<void> TrySetScopes(const std::vector<std::wstring>& includedScopes, const std::vector<std::wstring>& excludedScopes = {})
+    {
+        std::shared_ptr<const SessionScope> scope;
+        if (includedScopes.empty())
+        {
+            // Like a session constructed without scopes: nothing to prime
+            scope = SessionScopeCache::Describe(includedScopes, excludedScopes, m_additionalProperties);
+        }
+        else
+        {
+            auto primed = m_scopeCache.Load()->TryAcquire(includedScopes, excludedScopes, m_additionalProperties);
+            if (!primed)
+            {
+                return primed.Error();
+            }
+            scope = std::move(*primed);
+        }
+
+        TelemetryProvider::LogInfo(L"Scopes set: %zu included, %zu excluded", includedScopes.size(), excludedScopes.size());
+        m_scope.Store(std::move(scope));
+        OnScopesChanged();
+        return {};
+    }
+
+    /* Keep primed scopes in 'cache' (nullptr gives the session a private cache again)
+     *
+     * Sessions over the same index may share one cache so a scope set primed by one is reused
+     * by all; the cache's statistics then cover them all.
+     */
+    void SetScopeCache(std::shared_ptr<SessionScopeCache> cache)
+    {
+        if (!cache)
+        {
+            cache = std::make_shared<SessionScopeCache>(std::make_shared<IndexerScopePrimer>());
+        }
+        m_scopeCache.Store(std::move(cache));
+    }
+
+    // Hit rate, priming queries, evictions and memory of the session's scope cache
+    PrimedScopeCacheStatistics GetScopeCacheStatistics() const
+    {
+        return m_scopeCache.Load()->GetStatistics();
     }
 
     // Call this method when a user clicks on a search result
     // to track usage and update file properties (System.DateAccessed and System.Document.LineCount)
     void TrackResultClick(const std::wstring& filePath)
     {
+        RecordOperation(SessionOperation::TrackResultClick, filePath);
         if (m_propertyUpdater)
         {
             m_propertyUpdater->OnResultClicked(filePath);
@@ -135,6 +502,48 @@ public:
         }
         return 0;
     }
+
+    /* Set the resource each query's arena draws its blocks from
+     *
+     * Pass an AllocationCountingResource to see how many heap allocations each pipeline stage
+     * still makes; it must outlive the session and is not thread-safe, so only share one with a
+     * session that runs a single query at a time. nullptr restores the global heap.
+     */
+    void SetQueryMemoryResource(std::pmr::memory_resource* resource)
+    {
+        m_queryMemoryResource = resource ? resource : std::pmr::new_delete_resource();
+    }
+
+    /* Rewrite expensive search text before it is sent (see QueryCostModel)
+     *
+     * Each decision is logged with the estimated cost before and after. Pass nullopt to send
+     * search text as typed again.
+     */
+    void SetQueryCostPolicy(std::optional<QueryCostPolicy> policy)
+    {
+        std::shared_ptr<const QueryCostModel> model;
+        if (policy)
+        {
+            model = std::make_shared<const QueryCostModel>(*policy);
+        }
+        m_costModel.Store(std::move(model));
+    }
+
+    /* Record every query's result count and latency into 'statistics' (nullptr stops)
+     *
+     * Sessions may share one SearchTermStatistics; planners read it with Estimate. Recording
+     * costs one MSIDXSPROP_RESULTS_FOUND read per query.
+     */
+    void SetTermStatistics(std::shared_ptr<SearchTermStatistics> statistics)
+    {
+        m_termStatistics.Store(std::move(statistics));
+    }
+
+    // Start (or with nullptr, stop) recording session operations into a keystroke trace
+    void SetRecorder(std::shared_ptr<SearchSessionRecorder> recorder)
+    {
+        m_recorder.Store(std::move(recorder));
+    }
 };
 
 /* Simple synchronous search session for file searches
@@ -150,12 +559,12 @@ struct SearchSession : public SearchSessionBase
         : SearchSessionBase(std::move(includedScopes), std::move(excludedScopes), std::move(additionalProperties))
     {
         TraceLoggingInfo(L"Creating SearchSession");
-        TraceLoggingInfo(L"  Included scopes: %zu", m_includedScopes.size());
-        TraceLoggingInfo(L"  Excluded scopes: %zu", m_excludedScopes.size());
+        TraceLoggingInfo(L"  Included scopes: %zu", m_scope.Load()->includedScopes.size());
+        TraceLoggingInfo(L"  Excluded scopes: %zu", m_scope.Load()->excludedScopes.size());
         TraceLoggingInfo(L"  Additional properties: %zu", m_additionalProperties.size());
         
         // Prepare for search immediately if we have scopes
-        if (!m_includedScopes.empty())
+        if (!m_scope.Load()->includedScopes.empty())
         {
             PrepareForSearch();
         }
@@ -174,6 +583,13 @@ winrt::com_ptr<IRowset> Search(std::wstring_view const& searchText)
         return ExecuteQueryUsingPrimingQuery(searchText);
     }
 
+    // Search that returns indexer failures (with the failing call) instead of throwing
+    SearchExpected<winrt::com_ptr<IRowset>> TrySearch(std::wstring_view const& searchText)
+    {
+        TraceLoggingInfo(L"TrySearch called with text: %ls", searchText.data());
+        return TryExecuteQueryUsingPrimingQuery(searchText);
+    }
+
     /* Executes searching the entire system index with a string using the priming query as the base IRowset
      *
      *  The initial priming query if not run prior will be run during this method call.
@@ -183,51 +599,103 @@ winrt::com_ptr<IRowset> Search(std::wstring_view const& searchText)
      *
      */
     winrt::com_ptr<IRowset> ExecuteQueryUsingPrimingQuery(std::wstring_view const& searchText)
+    {
+        return details::ThrowIfSearchError(TryExecuteQueryUsingPrimingQuery(searchText));
+    }
+
+    SearchExpected<winrt::com_ptr<IRowset>> TryExecuteQueryUsingPrimingQuery(std::wstring_view const& searchText)
     {
         TraceLoggingInfo(L"ExecuteQueryUsingPrimingQuery called");
 
-        auto reuseWhereId = details::GetReuseWhereIDFromRowset(m_prefetchRowset);
+        // Build enhanced search query on a per-query arena
+        QueryArena arena(m_queryMemoryResource.load());
+        std::pmr::wstring querySql(arena.Resource());
+        auto scope = TryAppendSearchSql(querySql, searchText, arena);
+        if (!scope)
+        {
+            return scope.Error();
+        }
 
-        // Build enhanced search query
-        std::wstring querySql = m_prefetchSql;
+        TraceLoggingInfo(L"Executing search query with REUSEWHERE and ORDER BY rank");
+        return TryExecuteSearchQuery(querySql, searchText, (*scope)->includedScopes);
+    }
 
-        // Add search WHERE clause if search text is provided
-        std::wstring whereClause = details::BuildSearchWhereClause(searchText);
-        if (!whereClause.empty())
+protected:
+    // The priming query narrowed by the search text, over the primed REUSEWHERE id, by rank
+    SearchExpected<std::shared_ptr<const SessionScope>> TryAppendSearchSql(
+        std::pmr::wstring& querySql, std::wstring_view searchText, QueryArena& arena) const override
+    {
+        auto checked = TryCheckSearchText(searchText);
+        if (!checked)
         {
-            querySql += whereClause;
+            return checked.Error();
         }
 
-        // Add REUSEWHERE clause
-        querySql += L" AND REUSEWHERE(" + std::to_wstring(reuseWhereId) + L")";
+        auto primed = TryPrimeScope();
+        if (!primed)
+        {
+            return primed.Error();
+        }
+        const SessionScope& scope = **primed;
 
-        // Add ORDER BY clause to rank results by relevance
-        querySql += L" ORDER BY System.Search.Rank DESC";
+        auto costModel = m_costModel.Load();
+        std::optional<QueryPlan> plan;
+        if (costModel && !searchText.empty())
+        {
+            plan.emplace(PlanOnArena(*costModel, searchText, scope, arena));
+        }
 
-        TraceLoggingInfo(L"Executing search query with REUSEWHERE and ORDER BY rank");
-        return details::ExecuteQuery(querySql);
-    }
+        AllocationStageScope stage(arena, QueryAllocationStage::Sql);
+        size_t select = querySql.size();
+        querySql.append(scope.sql.data(), scope.sql.size());
 
-    inline size_t GetTotalFilesInIndex()
-    {
-        TraceLoggingInfo(L"Getting total files in index");
-        std::wstring sql(L"SELECT System.ItemUrl FROM SystemIndex WHERE SCOPE='file:'");
-        auto rowset = details::ExecuteQuery(sql);
+        // Add search WHERE clause if search text is provided, rewritten if it is expensive
+        if (plan)
+        {
+            if (plan->topN > 0)
+            {
+                // The priming SQL starts with "SELECT "
+                std::pmr::wstring top(L"TOP ", arena.Resource());
+                details::AppendUnsigned(top, plan->topN);
+                top.push_back(L' ');
+                querySql.insert(select + 7, top);
+            }
+            std::pmr::wstring contentText(arena.Resource());
+            plan->AppendTokens(contentText, true);
+            details::AppendSearchWhereClause(querySql, contentText);
+            details::AppendFileNamePrefixConditions(querySql, plan->FilenameOnlyTokens());
+        }
+        else
+        {
+            details::AppendSearchWhereClause(querySql, searchText);
+        }
 
-        return details::GetTotalRowsForRowset(rowset);
+        // Add REUSEWHERE clause
+        querySql += L" AND REUSEWHERE(";
+        details::AppendUnsigned(querySql, scope.whereId);
+        querySql += L")";
+
+        // Add ORDER BY clause to rank results by relevance
+        querySql += L" ORDER BY System.Search.Rank DESC";
+        return primed;
     }
 
 private:
 };
 
+// Results of one search-as-you-type query (see SearchAsYouTypeSession::GetResultsSnapshot)
+using SearchResultsSnapshot = ResultSnapshot<winrt::com_ptr<IRowset>>;
+
 /* Search-as-you-type session with debouncing functionality
  * Enables efficient search-as-you-type with automatic debouncing
  * to minimize unnecessary queries to the Windows Search Index.
  *
  * Features:
  * - Automatic debouncing with configurable delay (default 50ms)
+ * - Debouncing and query timing follow an injectable clock (see VirtualSearchClock)
  * - Background thread for query execution
  * - Cached rowset results for quick retrieval
+ * - Results published as immutable snapshots: readers and subscribers never take the session lock
  * - Thread-safe operations
  * - Click tracking to update file properties when results are clicked
  *
@@ -247,46 +715,31 @@ public:
     // excludedScopes: List of file paths to exclude from search
     // additionalProperties: Additional properties to include in SELECT clause (e.g., System.ItemNameDisplay)
     // debounceDelay: Time to wait after last text change before executing query (default 50ms)
+    // clock: Time source for debouncing and query timing (default: the steady clock)
     SearchAsYouTypeSession(
         std::vector<std::wstring> includedScopes,
         std::vector<std::wstring> excludedScopes = {},
         std::vector<std::wstring> additionalProperties = {},
-        std::chrono::milliseconds debounceDelay = std::chrono::milliseconds(50))
+        std::chrono::milliseconds debounceDelay = std::chrono::milliseconds(50),
+        std::shared_ptr<ISearchClock> clock = nullptr)
         : SearchSessionBase(std::move(includedScopes), std::move(excludedScopes), std::move(additionalProperties))
-        , m_debounceDelay(debounceDelay)
-        , m_shouldStop(false)
-        , m_queryPending(false)
+        , m_typing([this](const std::wstring& searchText) { return ExecuteSearchQuery(searchText); }, debounceDelay, std::move(clock))
     {
         TelemetryProvider::LogInfo(L"Initializing SearchAsYouTypeSession with debounce delay: %lld ms", debounceDelay.count());
         
-        m_lastQueryExecutionTime.QuadPart = 0;
-        m_lastQueryDurationMs = 0.0;
-        
         // Get the performance counter frequency for timing conversions
         QueryPerformanceFrequency(&m_performanceFrequency);
         
         // Prepare for search immediately if we have scopes
-        if (!m_includedScopes.empty())
+        if (!m_scope.Load()->includedScopes.empty())
         {
             PrepareForSearch();
         }
-        
-        m_debounceThread = std::thread(&SearchAsYouTypeSession::DebounceThreadProc, this);
     }
 
     ~SearchAsYouTypeSession()
     {
         TelemetryProvider::LogInfo(L"Shutting down SearchAsYouTypeSession");
-        {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            m_shouldStop = true;
-        }
-        m_cv.notify_one();
-        
-        if (m_debounceThread.joinable())
-        {
-            m_debounceThread.join();
-        }
     }
 
     // Non-copyable
@@ -296,35 +749,24 @@ public:
     // Append characters to the current search text and trigger debouncing
     void AppendCharacters(std::wstring_view characters)
     {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        m_searchText += characters;
-        m_lastUpdateTime = std::chrono::steady_clock::now();
-        m_queryPending = true;
-        
-        TelemetryProvider::LogInfo(L"Search text updated: %ls", m_searchText.c_str());
-        m_cv.notify_one();
+        RecordOperation(SessionOperation::AppendCharacters, characters);
+        m_typing.AppendCharacters(characters);
+        TelemetryProvider::LogInfo(L"Search text appended: %.*ls", static_cast<int>(characters.size()), characters.data());
     }
 
     // Set the complete search text (replaces existing text) and trigger debouncing
     void SetSearchText(std::wstring_view searchText)
     {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        m_searchText = searchText;
-        m_lastUpdateTime = std::chrono::steady_clock::now();
-        m_queryPending = true;
-        
-        TelemetryProvider::LogInfo(L"Search text set to: %ls", m_searchText.c_str());
-        m_cv.notify_one();
+        RecordOperation(SessionOperation::SetSearchText, searchText);
+        m_typing.SetSearchText(searchText);
+        TelemetryProvider::LogInfo(L"Search text set to: %.*ls", static_cast<int>(searchText.size()), searchText.data());
     }
 
     // Clear the search text and cached results
     void Clear()
     {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        m_searchText.clear();
-        m_cachedRowset = nullptr;
-        m_queryPending = false;
-        
+        RecordOperation(SessionOperation::Clear);
+        m_typing.Clear(); // Cancels any pending debounced query
         TelemetryProvider::LogInfo(L"Search text and cache cleared");
     }
 
@@ -332,189 +774,162 @@ public:
     // This method blocks and waits for the debouncing delay to complete if a query is pending
     winrt::com_ptr<IRowset> GetCachedResults()
     {
-        std::unique_lock<std::mutex> lock(m_mutex);
+        RecordOperation(SessionOperation::GetCachedResults);
         
-        // Wait for any pending query to complete
-        if (m_queryPending)
+        // Wait for any pending query to complete; this waits on the results, not the session lock
+        if (m_typing.IsQueryPending())
         {
             TelemetryProvider::LogInfo(L"GetCachedResults: waiting for pending query to complete");
-            m_queryCompletedCv.wait(lock, [this] { return !m_queryPending; });
         }
-        
-        return m_cachedRowset;
+        return m_typing.WaitForResults()->result;
+    }
+
+    /* The latest published results, without waiting or locking
+     *
+     * The snapshot holds the rowset, the search text it answers, the query's failure (if any)
+     * and timing, all from the same query. It is out of date while IsQueryPending(); poll with
+     * GetResultsGeneration (one atomic load) and fetch a snapshot only when it changes.
+     */
+    std::shared_ptr<const SearchResultsSnapshot> GetResultsSnapshot() const
+    {
+        return m_typing.GetSnapshot();
+    }
+
+    // Increases with every published snapshot (query results, failures and Clear)
+    uint64_t GetResultsGeneration() const
+    {
+        return m_typing.GetGeneration();
+    }
+
+    /* Call 'callback' with every newer snapshot while the returned subscription lives
+     *
+     * Callbacks run on the thread that ran the query (the debounce thread, or the caller of
+     * ExecuteQueryNow); marshal to the UI thread from there. They must be quick and must not
+     * call Clear or ExecuteQueryNow.
+     *
+     * Example:
+     *   auto subscription = search.SubscribeResults([window](const auto& snapshot) {
+     *       PostMessage(window, WM_APP_RESULTS, 0, static_cast<LPARAM>(snapshot->generation));
+     *   });
+     */
+    ResultSubscription SubscribeResults(ResultPublisher<winrt::com_ptr<IRowset>>::Callback callback)
+    {
+        return m_typing.Subscribe(std::move(callback));
     }
 
     // Force immediate query execution and wait for results
     // This bypasses the debounce delay and returns the fresh results
     winrt::com_ptr<IRowset> ExecuteQueryNow()
     {
-        std::wstring searchText;
-        {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            searchText = m_searchText;
-            m_queryPending = false; // Cancel any pending debounced query
-        }
-
-        TelemetryProvider::LogInfo(L"Executing immediate query for: %ls", searchText.c_str());
-        auto rowset = ExecuteTimedSearchQuery(searchText);
-        
-        {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            m_cachedRowset = rowset;
-        }
+        return details::ThrowIfSearchError(TryExecuteQueryNow());
+    }
 
-        return rowset;
+    // ExecuteQueryNow that returns indexer failures instead of throwing; the cached results are
+    // cleared on failure, as they are when a debounced query fails. Text with nothing to search
+    // for ("-", a lone quote) runs no query: the results are cleared and the rowset is null.
+    SearchExpected<winrt::com_ptr<IRowset>> TryExecuteQueryNow()
+    {
+        RecordOperation(SessionOperation::ExecuteQueryNow);
+        TelemetryProvider::LogInfo(L"Executing immediate query");
+        return m_typing.ExecuteNow(); // Cancels any pending debounced query
     }
 
-    // Check if a query is currently pending (waiting for debounce delay)
+    // Check if the current search text has no results published yet (debouncing or running)
     bool IsQueryPending() const
     {
-        return m_queryPending;
+        return m_typing.IsQueryPending();
+    }
+
+    // Number of queries actually sent to the indexer (debounced queries and ExecuteQueryNow)
+    size_t GetExecutedQueryCount() const
+    {
+        return m_typing.GetExecutedQueryCount();
+    }
+
+    // Total time callers (including the debounce thread) spent waiting on the session lock
+    std::chrono::nanoseconds GetLockWaitTime() const
+    {
+        return m_typing.GetLockWaitTime();
     }
 
     // Get the current search text
     std::wstring GetSearchText() const
     {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        return m_searchText;
+        return m_typing.GetSearchText();
     }
 
     // Get the timestamp (in performance counter ticks) of the last query execution
     // Returns 0 if no query has been executed yet
     LARGE_INTEGER GetLastQueryExecutionTime() const
     {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        return m_lastQueryExecutionTime;
+        LARGE_INTEGER startTime;
+        startTime.QuadPart = ToPerformanceCounterTicks(m_typing.GetSnapshot()->startTicks);
+        return startTime;
     }
 
     // Get the duration (in milliseconds) of the last query execution
     // Returns 0.0 if no query has been executed yet
     double GetLastQueryDurationMs() const
     {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        return m_lastQueryDurationMs;
+        return m_typing.GetSnapshot()->durationMs;
     }
 
     // Set a new debounce delay
     void SetDebounceDelay(std::chrono::milliseconds delay)
     {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        m_debounceDelay = delay;
+        m_typing.SetDebounceDelay(delay);
         TelemetryProvider::LogInfo(L"Debounce delay set to: %lld ms", delay.count());
     }
 
 private:
-    void DebounceThreadProc()
+    // The query the debounce thread (or ExecuteQueryNow) runs; the runner times and publishes it
+    SearchExpected<winrt::com_ptr<IRowset>> ExecuteSearchQuery(const std::wstring& searchText)
     {
-        TelemetryProvider::LogInfo(L"Debounce thread started");
+        TelemetryProvider::LogInfo(L"Executing query for: %ls", searchText.c_str());
+        auto startTime = m_typing.GetClock().Now();
+        TelemetryProvider::LogInfo(L"[TIMING] Query execution started at: %lld", ToPerformanceCounterTicks(startTime.time_since_epoch().count()));
 
-        while (true)
-        {
-            std::unique_lock<std::mutex> lock(m_mutex);
-            
-            // Wait for a signal or until we should stop
-            m_cv.wait(lock, [this] { return m_queryPending || m_shouldStop; });
-
-            if (m_shouldStop)
-            {
-                TelemetryProvider::LogInfo(L"Debounce thread stopping");
-                break;
-            }
+        auto result = TryExecuteSearchWithPriming(searchText);
 
-            if (m_queryPending)
-            {
-                auto timeSinceLastUpdate = std::chrono::steady_clock::now() - m_lastUpdateTime;
-                
-                if (timeSinceLastUpdate >= m_debounceDelay)
-                {
-                    // Enough time has passed, execute the query
-                    std::wstring searchText = m_searchText;
-                    lock.unlock(); // Unlock before executing query
-
-                    TelemetryProvider::LogInfo(L"Debounce period elapsed, executing query for: %ls", searchText.c_str());
-                    
-                    try
-                    {
-                        auto rowset = ExecuteTimedSearchQuery(searchText);
-                        
-                        lock.lock();
-                        m_cachedRowset = rowset;
-                        m_queryPending = false;
-                        TelemetryProvider::LogInfo(L"Query executed successfully, results cached");
-                        
-                        // Notify any threads waiting in GetCachedResults()
-                        m_queryCompletedCv.notify_all();
-                    }
-                    catch (...)
-                    {
-                        TelemetryProvider::LogInfo(L"Query execution failed");
-                        lock.lock();
-                        m_cachedRowset = nullptr;
-                        m_queryPending = false;
-                        
-                        // Notify even on failure
-                        m_queryCompletedCv.notify_all();
-                    }
-                }
-                else
-                {
-                    // Not enough time has passed, wait for the remaining time
-                    auto remainingTime = m_debounceDelay - timeSinceLastUpdate;
-                    m_cv.wait_for(lock, remainingTime);
-                }
-            }
+        auto endTime = m_typing.GetClock().Now();
+        TelemetryProvider::LogInfo(L"[TIMING] Query execution completed at: %lld (duration: %.3f ms)",
+                                ToPerformanceCounterTicks(endTime.time_since_epoch().count()),
+                                std::chrono::duration<double, std::milli>(endTime - startTime).count());
+        if (result)
+        {
+            TelemetryProvider::LogInfo(L"Query executed successfully, results cached");
+        }
+        else
+        {
+            TelemetryProvider::LogInfo(L"Query execution failed: %ls (0x%08X)", result.Error().operation, result.Error().code);
         }
+        return result;
+    }
 
-        TelemetryProvider::LogInfo(L"Debounce thread exited");
+    // Re-runs the current search text against the new scopes right away, without debouncing
+    void OnScopesChanged() override
+    {
+        m_typing.RequeryNow();
     }
 
-    winrt::com_ptr<IRowset> ExecuteTimedSearchQuery(const std::wstring& searchText)
+    // Snapshot start times are in clock ticks (steady_clock's); on Windows steady_clock counts
+    // the performance counter in nanoseconds, and rounding up recovers the counter exactly
+    int64_t ToPerformanceCounterTicks(int64_t clockTicks) const
     {
-        LARGE_INTEGER startTime, endTime;
-        QueryPerformanceCounter(&startTime);
-        
-        TelemetryProvider::LogInfo(L"[TIMING] Query execution started at: %lld", startTime.QuadPart);
-        
-        // Use base class method to execute search with priming
-        auto result = ExecuteSearchWithPriming(searchText);
-        
-        QueryPerformanceCounter(&endTime);
-        
-        // Calculate duration in milliseconds
-        double durationMs = (static_cast<double>(endTime.QuadPart - startTime.QuadPart) * 1000.0) / 
-                            static_cast<double>(m_performanceFrequency.QuadPart);
-        
-        // Store timing information
-        {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            m_lastQueryExecutionTime = startTime;
-            m_lastQueryDurationMs = durationMs;
-        }
-        
-        TelemetryProvider::LogInfo(L"[TIMING] Query execution completed at: %lld (duration: %.3f ms)", 
-                                endTime.QuadPart, durationMs);
-        
-        return result;
+        using Period = ISearchClock::Clock::period;
+        static_assert(Period::num == 1, "clock ticks are a fraction of a second");
+        const int64_t frequency = m_performanceFrequency.QuadPart;
+        const int64_t whole = clockTicks / Period::den;
+        const int64_t part = clockTicks % Period::den;
+        return whole * frequency + (part * frequency + Period::den - 1) / Period::den;
     }
 
-    std::chrono::milliseconds m_debounceDelay;
-
-    mutable std::mutex m_mutex;
-    std::condition_variable m_cv;
-    std::condition_variable m_queryCompletedCv;
-    std::thread m_debounceThread;
-    
-    std::wstring m_searchText;
-    std::chrono::steady_clock::time_point m_lastUpdateTime;
-    std::atomic<bool> m_shouldStop;
-    std::atomic<bool> m_queryPending;
-    
-    winrt::com_ptr<IRowset> m_cachedRowset;
-    
     // Timing information
     LARGE_INTEGER m_performanceFrequency;
-    LARGE_INTEGER m_lastQueryExecutionTime;
-    double m_lastQueryDurationMs;
+
+    // Search text, debouncing, the debounce thread and the published results; last, so its
+    // thread stops before anything the query uses is destroyed
+    DebouncedQueryRunner<winrt::com_ptr<IRowset>> m_typing;
 };
 
 } // namespace wsearch
@@ -0,0 +1,350 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define WSEARCH_SQL_ESCAPE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+/* SQL escaping and sanitization
+ *
+ * Every piece of caller text that reaches the indexer's SQL goes through this stage:
+ *   - search terms: single quotes doubled (and double quotes doubled inside a CONTAINS phrase),
+ *     control characters turned into spaces, text past c_maxSearchTextLength dropped;
+ *   - scopes: written as escaped SQL literals; control characters or more than
+ *     c_maxScopeLength characters throw std::invalid_argument;
+ *   - property names: only letters, digits, '.' and '_' (at most c_maxPropertyNameLength),
+ *     anything else throws std::invalid_argument, since names are not quoted.
+ * Clean text is scanned once and appended in one call: SSE2 (where available) tests eight
+ * characters per block (sixteen where wchar_t is four bytes) and four blocks per branch. From the first special character on, the doubled
+ * characters are counted, the output is grown once to its exact size and written in place:
+ * runs without special characters are copied whole and only blocks holding a special
+ * character are escaped character by character.
+ */
+namespace wsearch
+{
+
+namespace details
+{
+    // The indexer rejects longer CONTAINS arguments, and nobody types more than this
+    constexpr size_t c_maxSearchTextLength = 1024;
+    // Longest path the file system accepts (UNICODE_STRING_MAX_CHARS)
+    constexpr size_t c_maxScopeLength = 32767;
+    constexpr size_t c_maxPropertyNameLength = 256;
+
+    inline bool IsSqlControlChar(wchar_t ch)
+    {
+        return static_cast<unsigned>(ch) < 0x20 || ch == 0x7F;
+    }
+
+#if defined(WSEARCH_SQL_ESCAPE_SSE2)
+    // Characters tested per block: a 2-byte wchar_t is tested in 16-bit lanes, a 4-byte one is
+    // packed down to bytes first. The packing saturates: a character above 0xFF reads as 0xFF,
+    // which is no special character, and an (invalid) negative one as 0, which sends its block
+    // to the character-by-character path.
+    constexpr size_t c_sqlEscapeBlockUnits = sizeof(wchar_t) == 2 ? 8 : 16;
+
+    inline __m128i LoadSqlEscapeBlock(const wchar_t* text)
+    {
+        const __m128i* source = reinterpret_cast<const __m128i*>(text);
+        if constexpr (sizeof(wchar_t) == 2)
+        {
+            return _mm_loadu_si128(source);
+        }
+        else
+        {
+            return _mm_packus_epi16(_mm_packs_epi32(_mm_loadu_si128(source), _mm_loadu_si128(source + 1)),
+                _mm_packs_epi32(_mm_loadu_si128(source + 2), _mm_loadu_si128(source + 3)));
+        }
+    }
+
+    // 'value' in every lane of a block
+    inline __m128i FillSqlEscapeLanes(int value)
+    {
+        if constexpr (sizeof(wchar_t) == 2)
+        {
+            return _mm_set1_epi16(static_cast<short>(value));
+        }
+        else
+        {
+            return _mm_set1_epi8(static_cast<char>(value));
+        }
+    }
+
+    inline __m128i CompareSqlEscapeLanes(__m128i block, __m128i values)
+    {
+        if constexpr (sizeof(wchar_t) == 2)
+        {
+            return _mm_cmpeq_epi16(block, values);
+        }
+        else
+        {
+            return _mm_cmpeq_epi8(block, values);
+        }
+    }
+
+    // Lanes holding a quote (and a double quote when 'doubleQuotes')
+    inline __m128i SqlDoubledCharLanes(__m128i block, bool doubleQuotes)
+    {
+        __m128i doubled = CompareSqlEscapeLanes(block, FillSqlEscapeLanes(L'\''));
+        if (doubleQuotes)
+        {
+            doubled = _mm_or_si128(doubled, CompareSqlEscapeLanes(block, FillSqlEscapeLanes(L'"')));
+        }
+        return doubled;
+    }
+
+    // Lanes holding a doubled or a control character
+    inline __m128i SqlSpecialCharLanes(__m128i block, bool doubleQuotes)
+    {
+        // A character below 0x20 has no bits outside 0x1F; 0x7F is matched on its own
+        __m128i control = CompareSqlEscapeLanes(_mm_and_si128(block, FillSqlEscapeLanes(~0x1F)), _mm_setzero_si128());
+        control = _mm_or_si128(control, CompareSqlEscapeLanes(block, FillSqlEscapeLanes(0x7F)));
+        return _mm_or_si128(control, SqlDoubledCharLanes(block, doubleQuotes));
+    }
+
+    inline bool HasSqlSpecialChar(const wchar_t* text, bool doubleQuotes)
+    {
+        return _mm_movemask_epi8(SqlSpecialCharLanes(LoadSqlEscapeBlock(text), doubleQuotes)) != 0;
+    }
+
+    // Index of the first whole c_sqlEscapeBlockUnits block from 'index' on that holds a special
+    // character; where the whole blocks end when none does
+    inline size_t SkipCleanSqlBlocks(std::wstring_view text, size_t index, bool doubleQuotes)
+    {
+        const wchar_t* source = text.data();
+        // Clean text skips ahead four blocks per test
+        while (index + 4 * c_sqlEscapeBlockUnits <= text.size())
+        {
+            __m128i special = _mm_or_si128(
+                _mm_or_si128(SqlSpecialCharLanes(LoadSqlEscapeBlock(source + index), doubleQuotes),
+                    SqlSpecialCharLanes(LoadSqlEscapeBlock(source + index + c_sqlEscapeBlockUnits), doubleQuotes)),
+                _mm_or_si128(SqlSpecialCharLanes(LoadSqlEscapeBlock(source + index + 2 * c_sqlEscapeBlockUnits), doubleQuotes),
+                    SqlSpecialCharLanes(LoadSqlEscapeBlock(source + index + 3 * c_sqlEscapeBlockUnits), doubleQuotes)));
+            if (_mm_movemask_epi8(special) != 0)
+            {
+                break;
+            }
+            index += 4 * c_sqlEscapeBlockUnits;
+        }
+        while (index + c_sqlEscapeBlockUnits <= text.size() && !HasSqlSpecialChar(source + index, doubleQuotes))
+        {
+            index += c_sqlEscapeBlockUnits;
+        }
+        return index;
+    }
+#endif
+
+    inline bool IsSqlDoubledChar(wchar_t ch, bool doubleQuotes)
+    {
+        return ch == L'\'' || (doubleQuotes && ch == L'"');
+    }
+
+    inline bool IsSqlSpecialChar(wchar_t ch, bool doubleQuotes)
+    {
+        return IsSqlDoubledChar(ch, doubleQuotes) || IsSqlControlChar(ch);
+    }
+
+    // Number of characters in text[index...] that escaping doubles
+    inline size_t CountSqlDoubledChars(std::wstring_view text, size_t index, bool doubleQuotes)
+    {
+        const wchar_t* source = text.data();
+        size_t count = 0;
+#if defined(WSEARCH_SQL_ESCAPE_SSE2)
+        // Each lane counts down once per match; lanes are summed before they can overflow
+        constexpr size_t c_blocksPerSum = sizeof(wchar_t) == 2 ? 0x4000 : 0xFF;
+        while (index + c_sqlEscapeBlockUnits <= text.size())
+        {
+            __m128i lanes = _mm_setzero_si128();
+            for (size_t blocks = 0; blocks < c_blocksPerSum && index + c_sqlEscapeBlockUnits <= text.size(); ++blocks)
+            {
+                __m128i doubled = SqlDoubledCharLanes(LoadSqlEscapeBlock(source + index), doubleQuotes);
+                if constexpr (sizeof(wchar_t) == 2)
+                {
+                    lanes = _mm_sub_epi16(lanes, doubled);
+                }
+                else
+                {
+                    lanes = _mm_sub_epi8(lanes, doubled);
+                }
+                index += c_sqlEscapeBlockUnits;
+            }
+            if constexpr (sizeof(wchar_t) == 2)
+            {
+                alignas(16) int32_t sums[4];
+                _mm_store_si128(reinterpret_cast<__m128i*>(sums), _mm_madd_epi16(lanes, _mm_set1_epi16(1)));
+                count += static_cast<size_t>(sums[0]) + sums[1] + sums[2] + sums[3];
+            }
+            else
+            {
+                __m128i sums = _mm_sad_epu8(lanes, _mm_setzero_si128());
+                count += static_cast<size_t>(_mm_cvtsi128_si32(sums)) + _mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+            }
+        }
+#endif
+        for (; index < text.size(); ++index)
+        {
+            count += IsSqlDoubledChar(source[index], doubleQuotes) ? 1 : 0;
+        }
+        return count;
+    }
+
+    // Writes the escaped character at 'out'; returns the end of what it wrote
+    inline wchar_t* WriteEscapedChar(wchar_t* out, wchar_t ch, bool doubleQuotes)
+    {
+        if (IsSqlControlChar(ch))
+        {
+            *out++ = L' ';
+            return out;
+        }
+        *out++ = ch;
+        if (IsSqlDoubledChar(ch, doubleQuotes))
+        {
+            *out++ = ch;
+        }
+        return out;
+    }
+
+    // Escapes text[index...] (where a special character is first seen) in place: the doubled
+    // characters are counted so the output grows once, to its exact size; runs between special
+    // characters are copied whole and the blocks holding them escaped character by character
+    template <typename String>
+    void AppendEscapedTextFrom(String& out, std::wstring_view text, size_t index, bool doubleQuotes)
+    {
+        const wchar_t* source = text.data();
+        size_t base = out.size();
+        out.resize(base + (text.size() - index) + CountSqlDoubledChars(text, index, doubleQuotes));
+        wchar_t* write = &out[0] + base;
+        size_t start = index;
+#if defined(WSEARCH_SQL_ESCAPE_SSE2)
+        while (index + c_sqlEscapeBlockUnits <= text.size())
+        {
+            // The block at 'index' holds a special character
+            write = std::copy(source + start, source + index, write);
+            for (size_t i = index; i < index + c_sqlEscapeBlockUnits; ++i)
+            {
+                write = WriteEscapedChar(write, source[i], doubleQuotes);
+            }
+            index += c_sqlEscapeBlockUnits;
+            start = index;
+            index = SkipCleanSqlBlocks(text, index, doubleQuotes);
+        }
+#endif
+        for (; index < text.size(); ++index)
+        {
+            if (IsSqlSpecialChar(source[index], doubleQuotes))
+            {
+                write = std::copy(source + start, source + index, write);
+                write = WriteEscapedChar(write, source[index], doubleQuotes);
+                start = index + 1;
+            }
+        }
+        std::copy(source + start, source + text.size(), write);
+    }
+
+    // Clean text (most of it) is scanned once and appended in one call
+    template <typename String>
+    void AppendEscapedText(String& out, std::wstring_view text, bool doubleQuotes)
+    {
+        size_t index = 0;
+#if defined(WSEARCH_SQL_ESCAPE_SSE2)
+        index = SkipCleanSqlBlocks(text, index, doubleQuotes);
+        if (index + c_sqlEscapeBlockUnits <= text.size())
+        {
+            out.append(text.data(), index);
+            AppendEscapedTextFrom(out, text, index, doubleQuotes);
+            return;
+        }
+#endif
+        for (; index < text.size(); ++index)
+        {
+            if (IsSqlSpecialChar(text[index], doubleQuotes))
+            {
+                out.append(text.data(), index);
+                AppendEscapedTextFrom(out, text, index, doubleQuotes);
+                return;
+            }
+        }
+        out.append(text.data(), text.size());
+    }
+
+    // Appends text for use inside a SQL string literal: single quotes doubled, control
+    // characters replaced by spaces
+    template <typename String>
+    void AppendEscapedSqlText(String& out, std::wstring_view text)
+    {
+        AppendEscapedText(out, text, false);
+    }
+
+    // Appends text for use inside a double-quoted CONTAINS phrase within a SQL string literal:
+    // single and double quotes doubled, control characters replaced by spaces
+    template <typename String>
+    void AppendEscapedContainsText(String& out, std::wstring_view text)
+    {
+        AppendEscapedText(out, text, true);
+    }
+
+    // The part of the search text that is used; never splits a surrogate pair
+    inline std::wstring_view LimitSearchText(std::wstring_view text)
+    {
+        if (text.size() <= c_maxSearchTextLength)
+        {
+            return text;
+        }
+        size_t length = c_maxSearchTextLength;
+        wchar_t last = text[length - 1];
+        if (sizeof(wchar_t) == 2 && last >= 0xD800 && last <= 0xDBFF)
+        {
+            --length;
+        }
+        return text.substr(0, length);
+    }
+
+    // Throws std::invalid_argument unless the scope can be written into a query
+    inline void CheckScope(std::wstring_view scope)
+    {
+        if (scope.size() > c_maxScopeLength)
+        {
+            throw std::invalid_argument("Search scope is longer than the longest path");
+        }
+        for (wchar_t ch : scope)
+        {
+            if (IsSqlControlChar(ch))
+            {
+                throw std::invalid_argument("Search scope contains a control character");
+            }
+        }
+    }
+
+    // Throws std::invalid_argument unless the name can be written into a query unquoted
+    inline void CheckPropertyName(std::wstring_view name)
+    {
+        if (name.empty() || name.size() > c_maxPropertyNameLength)
+        {
+            throw std::invalid_argument("Property name is empty or too long");
+        }
+        for (wchar_t ch : name)
+        {
+            bool valid = (ch >= L'A' && ch <= L'Z') || (ch >= L'a' && ch <= L'z') || (ch >= L'0' && ch <= L'9') || ch == L'.' || ch == L'_';
+            if (!valid)
+            {
+                throw std::invalid_argument("Property name contains a character other than letters, digits, '.' and '_'");
+            }
+        }
+    }
+
+    template <typename String>
+    void AppendPropertyName(String& out, std::wstring_view name)
+    {
+        CheckPropertyName(name);
+        out.append(name.data(), name.size());
+    }
+} // namespace details
+
+} // namespace wsearch
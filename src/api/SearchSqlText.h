@@ -0,0 +1,301 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include "SearchQueryParser.h"
+#include "SearchSqlEscape.h"
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/* SQL text builders
+ *
+ * Allocation-free building blocks for the SQL the sessions send to the indexer. Each function
+ * appends to a caller-provided string of any allocator, so the same code produces a
+ * std::wstring for the classic API and a std::pmr::wstring on a per-query arena.
+ * Output is identical to the historical string-concatenation builders for well-formed search
+ * text; half-typed text is repaired by ParseSearchText first. Caller text is escaped and
+ * checked by the stage in SearchSqlEscape.h.
+ */
+namespace wsearch
+{
+
+namespace details
+{
+    template <typename String>
+    void AppendUnsigned(String& out, uint64_t value)
+    {
+        wchar_t digits[20];
+        size_t count = 0;
+        do
+        {
+            digits[count++] = static_cast<wchar_t>(L'0' + (value % 10));
+            value /= 10;
+        } while (value != 0);
+
+        while (count > 0)
+        {
+            out.push_back(digits[--count]);
+        }
+    }
+
+    // Appends a scope as a URL: backslashes become slashes and "file:" is added when missing.
+    // With 'escapeQuotes' the scope is checked (see CheckScope) and single quotes are doubled
+    // for use inside a SQL string literal.
+    template <typename String>
+    void AppendScopeUrl(String& out, std::wstring_view scope, bool escapeQuotes = false)
+    {
+        static constexpr std::wstring_view protocol = L"file:";
+        if (escapeQuotes)
+        {
+            CheckScope(scope);
+        }
+
+        bool hasProtocol = scope.size() >= protocol.size();
+        for (size_t i = 0; hasProtocol && i < protocol.size(); ++i)
+        {
+            hasProtocol = ((scope[i] == L'\\') ? L'/' : scope[i]) == protocol[i];
+        }
+        if (!hasProtocol)
+        {
+            out.append(protocol.data(), protocol.size());
+        }
+
+        for (wchar_t ch : scope)
+        {
+            out.push_back(ch == L'\\' ? L'/' : ch);
+            if (escapeQuotes && ch == L'\'')
+            {
+                out.push_back(L'\'');
+            }
+        }
+    }
+
+    template <typename String, typename Scopes, typename Properties>
+    void AppendPrimingSql(
+        String& out,
+        const Scopes& includedScopes,
+        const Scopes& excludedScopes,
+        const Properties& additionalProperties)
+    {
+        out.append(L"SELECT System.ItemUrl");
+
+        // Add additional properties to SELECT clause
+        for (const auto& prop : additionalProperties)
+        {
+            out.append(L", ");
+            AppendPropertyName(out, prop);
+        }
+
+        out.append(L" FROM SystemIndex WHERE");
+
+        // build the included, and excluded scope lists
+        for (size_t i = 0; i < includedScopes.size(); ++i)
+        {
+            if (i == 0)
+            {
+                out.append(L" (");
+            }
+
+            out.append(L" SCOPE='");
+            AppendScopeUrl(out, includedScopes[i], true);
+            out.append((i < (includedScopes.size() - 1)) ? L"' OR" : L"')");
+        }
+
+        for (size_t i = 0; i < excludedScopes.size(); ++i)
+        {
+            if (i == 0 && !includedScopes.empty())
+            {
+                out.append(L" AND");
+            }
+            out.append(L" SCOPE <> '");
+            AppendScopeUrl(out, excludedScopes[i], true);
+            out.push_back(L'\'');
+            if (i < (excludedScopes.size() - 1))
+            {
+                out.append(L" AND");
+            }
+        }
+    }
+
+    // Appends the parsed words separated by single spaces, escaped for a SQL string literal
+    template <typename String>
+    void AppendEscapedSearchWords(String& out, const ParsedSearchText& parsed)
+    {
+        bool first = true;
+        parsed.ForEachWord([&](std::wstring_view word) {
+            if (!first)
+            {
+                out.push_back(L' ');
+            }
+            AppendEscapedSqlText(out, word);
+            first = false;
+        });
+    }
+
+    template <typename String>
+    void AppendContainsOpen(String& out, std::wstring_view column)
+    {
+        out.append(L"CONTAINS(");
+        out.append(column.data(), column.size());
+        out.append(L", '");
+    }
+
+    // Appends the full-text WHERE fragment for searchText (nothing for empty text, nor for text
+    // without a query in it, which callers must not run; see ParsedSearchText::HasQuery).
+    // Half-typed syntax (open quotes, dangling operators) is repaired by ParseSearchText first,
+    // so the fragment is always well-formed.
+    template <typename String>
+    void AppendSearchWhereClause(String& out, std::wstring_view searchText)
+    {
+        static constexpr std::wstring_view contentColumn = L"*";
+        auto parsed = ParseSearchText(LimitSearchText(searchText));
+        switch (parsed.shape)
+        {
+        case SearchTextShape::Empty:
+        case SearchTextShape::NoQuery: // callers check HasQuery() and run no query at all
+            return;
+
+        case SearchTextShape::Phrase:
+            // User wants exact phrase search
+            out.append(L" AND ");
+            AppendContainsOpen(out, contentColumn);
+            out.push_back(L'"');
+            AppendEscapedSearchWords(out, parsed);
+            out.append(L"\"')");
+            return;
+
+        case SearchTextShape::PhrasePrefix:
+            // Still typing the phrase: exact phrase first, then phrases starting with it
+            out.append(L" AND (");
+            AppendContainsOpen(out, contentColumn);
+            out.push_back(L'"');
+            AppendEscapedSearchWords(out, parsed);
+            out.append(L"\"') RANK BY COERCION(ABSOLUTE, 999) OR ");
+            AppendContainsOpen(out, contentColumn);
+            out.push_back(L'"');
+            AppendEscapedSearchWords(out, parsed);
+            out.append(L"*\"') RANK BY COERCION(ABSOLUTE, 998))");
+            return;
+
+        case SearchTextShape::Words:
+            break;
+        }
+
+        if (parsed.wordCount > 1)
+        {
+            // CONTAINS(*, '"exact phrase"') RANK BY COERCION(ABSOLUTE, 999)
+            // OR CONTAINS(*, 'multi word*') RANK BY COERCION(ABSOLUTE, 998)
+            // OR (CONTAINS(*, 'word1*') AND CONTAINS(*, 'word2*'))
+            out.append(L" AND (");
+            AppendContainsOpen(out, contentColumn);
+            out.push_back(L'"');
+            AppendEscapedSearchWords(out, parsed);
+            out.append(L"\"') RANK BY COERCION(ABSOLUTE, 999) OR ");
+            AppendContainsOpen(out, contentColumn);
+            AppendEscapedSearchWords(out, parsed);
+            out.append(L"*') RANK BY COERCION(ABSOLUTE, 998) OR (");
+
+            bool first = true;
+            parsed.ForEachWord([&](std::wstring_view word) {
+                if (!first)
+                {
+                    out.append(L" AND ");
+                }
+                AppendContainsOpen(out, contentColumn);
+                AppendEscapedSqlText(out, word);
+                out.append(L"*')");
+                first = false;
+            });
+
+            out.append(L"))");
+        }
+        else
+        {
+            // Exact match on filename with highest rank (999), prefix match on all content
+            out.append(L" AND (CONTAINS(System.ItemNameDisplay, '");
+            AppendEscapedSearchWords(out, parsed);
+            out.append(L"', 1033) RANK BY COERCION(ABSOLUTE, 999) OR ");
+            AppendContainsOpen(out, contentColumn);
+            AppendEscapedSearchWords(out, parsed);
+            out.append(L"*'))");
+        }
+    }
+
+    // Appends " AND CONTAINS(System.FileName, '"word*"')" for each word: the short prefixes the
+    // query cost model matches against file names only (see QueryPlan::filenameOnly)
+    template <typename String, typename Words>
+    void AppendFileNamePrefixConditions(String& out, const Words& words)
+    {
+        for (const auto& word : words)
+        {
+            out.append(L" AND ");
+            AppendContainsOpen(out, L"System.FileName");
+            out.push_back(L'"');
+            AppendEscapedContainsText(out, word);
+            out.append(L"*\"')");
+        }
+    }
+
+    // SELECT [TOP n] System.ItemUrl[, props] FROM SystemIndex WHERE REUSEWHERE(id)<where> ORDER BY System.Search.Rank DESC
+    template <typename String, typename Properties, typename Words = std::vector<std::wstring_view>>
+    void AppendReuseWhereSearchSql(String& out, const Properties& additionalProperties, uint64_t whereId, std::wstring_view searchText,
+        uint64_t topN = 0, const Words& fileNameWords = {})
+    {
+        out.append(L"SELECT ");
+        if (topN > 0)
+        {
+            out.append(L"TOP ");
+            AppendUnsigned(out, topN);
+            out.push_back(L' ');
+        }
+        out.append(L"System.ItemUrl");
+        for (const auto& prop : additionalProperties)
+        {
+            out.append(L", ");
+            AppendPropertyName(out, prop);
+        }
+        out.append(L" FROM SystemIndex WHERE REUSEWHERE(");
+        AppendUnsigned(out, whereId);
+        out.push_back(L')');
+        AppendSearchWhereClause(out, searchText);
+        AppendFileNamePrefixConditions(out, fileNameWords);
+        out.append(L" ORDER BY System.Search.Rank DESC");
+    }
+
+    // SELECT System.ItemUrl[, props] FROM SystemIndex WHERE [REUSEWHERE(id) AND ](System.ItemUrl = 'url' OR ...)
+    // Paths are written as URLs (see AppendScopeUrl). The indexer has no IN predicate for
+    // System.ItemUrl, so a set of paths is an OR of equality predicates.
+    template <typename String, typename Properties, typename Iterator>
+    void AppendItemUrlLookupSql(String& out, const Properties& additionalProperties, Iterator firstPath, Iterator lastPath,
+        const uint64_t* reuseWhereId = nullptr)
+    {
+        out.append(L"SELECT System.ItemUrl");
+        for (const auto& prop : additionalProperties)
+        {
+            out.append(L", ");
+            AppendPropertyName(out, prop);
+        }
+        out.append(L" FROM SystemIndex WHERE ");
+        if (reuseWhereId)
+        {
+            out.append(L"REUSEWHERE(");
+            AppendUnsigned(out, *reuseWhereId);
+            out.append(L") AND ");
+        }
+
+        out.push_back(L'(');
+        for (Iterator path = firstPath; path != lastPath; ++path)
+        {
+            if (path != firstPath)
+            {
+                out.append(L" OR ");
+            }
+            out.append(L"System.ItemUrl = '");
+            AppendScopeUrl(out, *path, true);
+            out.push_back(L'\'');
+        }
+        out.push_back(L')');
+    }
+} // namespace details
+
+} // namespace wsearch
@@ -0,0 +1,154 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#if __has_include(<version>)
+#include <version>
+#endif
+
+namespace wsearch
+{
+
+namespace details
+{
+    /* ContentionTrackingMutex - std::mutex that measures how long callers wait for it
+     *
+     * The uncontended path is a single try_lock. Only when that fails is the wait timed,
+     * so instrumentation costs nothing unless threads are actually fighting over the lock.
+     * Satisfies Lockable, so it works with std::lock_guard, std::unique_lock and
+     * std::condition_variable_any.
+     */
+    class ContentionTrackingMutex
+    {
+    public:
+        ContentionTrackingMutex() = default;
+
+        // Non-copyable
+        ContentionTrackingMutex(const ContentionTrackingMutex&) = delete;
+        ContentionTrackingMutex& operator=(const ContentionTrackingMutex&) = delete;
+
+        void lock()
+        {
+            if (m_mutex.try_lock())
+            {
+                return;
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            m_mutex.lock();
+            auto waited = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+            m_waitNanoseconds.fetch_add(static_cast<uint64_t>(waited.count()), std::memory_order_relaxed);
+            m_contendedAcquisitions.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        bool try_lock()
+        {
+            return m_mutex.try_lock();
+        }
+
+        void unlock()
+        {
+            m_mutex.unlock();
+        }
+
+        // Total time callers spent blocked in lock()
+        std::chrono::nanoseconds GetWaitTime() const
+        {
+            return std::chrono::nanoseconds(m_waitNanoseconds.load(std::memory_order_relaxed));
+        }
+
+        // Number of lock() calls that had to wait
+        uint64_t GetContendedAcquisitions() const
+        {
+            return m_contendedAcquisitions.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::atomic<uint64_t> m_waitNanoseconds{ 0 };
+        std::atomic<uint64_t> m_contendedAcquisitions{ 0 };
+    };
+
+    /* AtomicSharedPtr - a shared_ptr that threads load and replace without a lock of their own
+     *
+     * Holds the snapshots that sessions, publishers and evaluators swap whole (scopes, results,
+     * rule sets, optional features). std::atomic<std::shared_ptr> where the library has it; a
+     * mutex around the pointer copy otherwise. Replaces the std::atomic_load / atomic_store
+     * overloads for shared_ptr, which C++20 deprecates.
+     */
+    template <typename T>
+    class AtomicSharedPtr
+    {
+    public:
+        AtomicSharedPtr() = default;
+
+        explicit AtomicSharedPtr(std::shared_ptr<T> value)
+            : m_value(std::move(value))
+        {
+        }
+
+        // Non-copyable
+        AtomicSharedPtr(const AtomicSharedPtr&) = delete;
+        AtomicSharedPtr& operator=(const AtomicSharedPtr&) = delete;
+
+#if defined(__cpp_lib_atomic_shared_ptr)
+        std::shared_ptr<T> Load() const
+        {
+            return m_value.load();
+        }
+
+        void Store(std::shared_ptr<T> value)
+        {
+            m_value.store(std::move(value));
+        }
+
+        // Replaces the value with 'desired' if it is still 'expected'; otherwise loads it into 'expected'
+        bool CompareExchange(std::shared_ptr<T>& expected, std::shared_ptr<T> desired)
+        {
+            return m_value.compare_exchange_strong(expected, std::move(desired));
+        }
+
+    private:
+        std::atomic<std::shared_ptr<T>> m_value;
+#else
+        std::shared_ptr<T> Load() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_value;
+        }
+
+        void Store(std::shared_ptr<T> value)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_value.swap(value);
+            }
+            // The old value is released outside the lock
+        }
+
+        bool CompareExchange(std::shared_ptr<T>& expected, std::shared_ptr<T> desired)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_value == expected && !m_value.owner_before(expected) && !expected.owner_before(m_value))
+            {
+                m_value.swap(desired);
+                return true;
+            }
+            expected = m_value;
+            return false;
+        }
+
+    private:
+        mutable std::mutex m_mutex;
+        std::shared_ptr<T> m_value;
+#endif
+    };
+} // namespace details
+
+} // namespace wsearch
@@ -0,0 +1,489 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include "SearchQueryParser.h"
+#include "SearchResultOrdering.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <cwctype>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace wsearch
+{
+
+struct TermStatisticsOptions
+{
+    // Counters per sketch row, a power of two; estimates stay accurate up to roughly this many
+    // distinct texts per half-life (48 bytes per unit of width at the default depth)
+    size_t width = 16384;
+    size_t depth = 4;    // sketch rows; each key has one counter per row
+    std::chrono::seconds halfLife{ std::chrono::hours(24 * 7) }; // an observation's weight halves this often
+    double minObservations = 0.5; // decayed weight below which a key counts as unseen
+};
+
+// Which key an estimate came from
+enum class TermStatisticsSource : uint8_t
+{
+    None,         // nothing recorded for this text or its prefix length in these scopes
+    Term,         // this exact (normalized) text in these scopes
+    PrefixLength, // any text whose last word has this length, in these scopes
+};
+
+struct TermStatisticsEstimate
+{
+    TermStatisticsSource source = TermStatisticsSource::None;
+    double observations = 0.0; // decayed query count behind the estimate (an upper bound)
+    double resultCount = 0.0;  // geometric mean of the MSIDXSPROP_RESULTS_FOUND counts
+    double latencyMs = 0.0;    // mean execution latency
+
+    bool IsKnown() const
+    {
+        return source != TermStatisticsSource::None;
+    }
+};
+
+namespace details
+{
+    inline uint64_t MixStatisticsHash(uint64_t z)
+    {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    inline uint64_t HashStatisticsChar(uint64_t hash, wchar_t ch)
+    {
+        // ASCII folds inline; towlower only for the rest
+        ch = (ch < 0x80) ? ((ch >= L'A' && ch <= L'Z') ? static_cast<wchar_t>(ch | 0x20) : ch) : static_cast<wchar_t>(std::towlower(ch));
+        return (hash ^ static_cast<std::make_unsigned_t<wchar_t>>(ch)) * 0x100000001B3ull;
+    }
+
+    // Hash of the words, case-folded and in order, so spacing and case do not matter; a phrase
+    // hashes differently from the same words unquoted. The length of the last word (the one
+    // being typed) is returned in prefixLength.
+    inline uint64_t HashStatisticsText(std::wstring_view text, size_t& prefixLength)
+    {
+        // Hashed as the parser finds the words; whether it is a phrase is only known at the end
+        uint64_t hash = 0xCBF29CE484222325ull;
+        prefixLength = 0;
+        auto parsed = ParseSearchText(text, [&](std::wstring_view word) {
+            for (wchar_t ch : word)
+            {
+                hash = HashStatisticsChar(hash, ch);
+            }
+            hash = (hash ^ 0x10000) * 0x100000001B3ull;
+            prefixLength = word.size();
+        });
+        return parsed.IsPhrase() ? MixStatisticsHash(hash ^ 0x5048524153450000ull) : hash;
+    }
+
+    // Order-insensitive: scopes are case-folded, '\' is '/', trailing slashes are ignored, and
+    // duplicates count once
+    inline uint64_t HashScopeSet(const std::vector<std::wstring>& scopes)
+    {
+        uint64_t inlineHashes[8];
+        std::vector<uint64_t> heapHashes;
+        uint64_t* hashes = inlineHashes;
+        if (scopes.size() > std::size(inlineHashes))
+        {
+            heapHashes.resize(scopes.size());
+            hashes = heapHashes.data();
+        }
+
+        for (size_t i = 0; i < scopes.size(); ++i)
+        {
+            std::wstring_view scope = scopes[i];
+            while (!scope.empty() && (scope.back() == L'/' || scope.back() == L'\\'))
+            {
+                scope.remove_suffix(1);
+            }
+            uint64_t hash = 0xCBF29CE484222325ull;
+            for (wchar_t ch : scope)
+            {
+                hash = HashStatisticsChar(hash, ch == L'\\' ? L'/' : ch);
+            }
+            hashes[i] = MixStatisticsHash(hash);
+        }
+        std::sort(hashes, hashes + scopes.size());
+        uint64_t* last = std::unique(hashes, hashes + scopes.size());
+
+        uint64_t combined = 0x5343;
+        for (uint64_t* hash = hashes; hash != last; ++hash)
+        {
+            combined = MixStatisticsHash(combined ^ *hash);
+        }
+        return combined;
+    }
+
+    inline uint64_t TermStatisticsKey(uint64_t textHash, uint64_t scopeHash)
+    {
+        return MixStatisticsHash(textHash ^ MixStatisticsHash(scopeHash ^ 0x5445524Dull));
+    }
+
+    inline uint64_t PrefixLengthStatisticsKey(size_t prefixLength, uint64_t scopeHash)
+    {
+        return MixStatisticsHash(scopeHash ^ 0x5052454600000000ull ^ static_cast<uint64_t>(prefixLength));
+    }
+} // namespace details
+
+/* SearchTermStatistics - observed result counts and latencies per search text and scope set
+ *
+ * Every executed query adds its MSIDXSPROP_RESULTS_FOUND count and latency under two keys:
+ * the normalized text in its scope set, and the length of the last (typed) word in that
+ * scope set. Estimate returns the text's own statistics when it has been seen, else those of
+ * its prefix length, so planners get a number for new text after a few keystrokes.
+ *
+ * Both keys live in one count-min sketch of depth x width counters (weight, sum of
+ * log(1 + results), sum of latency), so memory is fixed however many distinct queries are
+ * recorded. Collisions only add weight; an estimate reads the row whose counter has the
+ * least weight. Observations decay with the configured half-life without touching the other
+ * counters: each new one is weighted 2^(age of the epoch / half-life), an estimate scales by
+ * the inverse, and only once the weight passes 2^16 are the counters rescaled, in one sweep.
+ * A record or estimate parses and hashes the text once; the depth counters of a key all come
+ * from that one hash.
+ *
+ * Thread-safe. SaveToFile writes only the non-zero counters, so a sparse sketch stays small.
+ *
+ * Example:
+ *   auto statistics = std::make_shared<wsearch::SearchTermStatistics>();
+ *   session.SetTermStatistics(statistics);
+ *   ... queries run ...
+ *   auto estimate = statistics->Estimate(L"annual rep", { L"file:C:/Users" });
+ *   if (estimate.IsKnown() && estimate.resultCount > 10000) { ... }
+ *   statistics->SaveToFile(L"terms.wsstats");
+ */
+class SearchTermStatistics
+{
+public:
+    explicit SearchTermStatistics(TermStatisticsOptions options = {})
+        : m_options(options)
+    {
+        if (m_options.width == 0 || (m_options.width & (m_options.width - 1)) != 0 || m_options.depth == 0 ||
+            m_options.width * m_options.depth > MaxCells || m_options.halfLife.count() <= 0)
+        {
+            throw std::invalid_argument("Term statistics need a power-of-two width, a depth and a half-life");
+        }
+        m_cells.resize(m_options.width * m_options.depth);
+    }
+
+    // Non-copyable
+    SearchTermStatistics(const SearchTermStatistics&) = delete;
+    SearchTermStatistics& operator=(const SearchTermStatistics&) = delete;
+
+    // nowTicks is a FILETIME in 100 ns ticks; 0 means now
+    void Record(std::wstring_view searchText, const std::vector<std::wstring>& scopes, size_t resultCount,
+        std::chrono::microseconds latency, uint64_t nowTicks = 0)
+    {
+        size_t prefixLength = 0;
+        uint64_t textHash = details::HashStatisticsText(searchText, prefixLength);
+        uint64_t scopeHash = details::HashScopeSet(scopes);
+        uint64_t now = nowTicks ? nowTicks : details::CurrentFileTimeTicks();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_epochTicks == 0)
+        {
+            m_epochTicks = now;
+        }
+        if (Exponent(now) > RescaleExponent)
+        {
+            Rescale(now);
+        }
+        float weight = static_cast<float>(std::exp2(Exponent(now)));
+        Cell add{ weight, weight * static_cast<float>(std::log1p(static_cast<double>(resultCount))),
+            weight * static_cast<float>(static_cast<double>(latency.count()) / 1000.0) };
+        Add(details::TermStatisticsKey(textHash, scopeHash), add);
+        Add(details::PrefixLengthStatisticsKey(prefixLength, scopeHash), add);
+        ++m_recordCount;
+    }
+
+    TermStatisticsEstimate Estimate(std::wstring_view searchText, const std::vector<std::wstring>& scopes, uint64_t nowTicks = 0) const
+    {
+        size_t prefixLength = 0;
+        uint64_t textHash = details::HashStatisticsText(searchText, prefixLength);
+        uint64_t scopeHash = details::HashScopeSet(scopes);
+        uint64_t now = nowTicks ? nowTicks : details::CurrentFileTimeTicks();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_epochTicks == 0)
+        {
+            return {};
+        }
+        double scale = std::exp2(-Exponent(now));
+        TermStatisticsEstimate estimate = Read(details::TermStatisticsKey(textHash, scopeHash), scale);
+        if (estimate.observations >= m_options.minObservations)
+        {
+            estimate.source = TermStatisticsSource::Term;
+            return estimate;
+        }
+        estimate = Read(details::PrefixLengthStatisticsKey(prefixLength, scopeHash), scale);
+        if (estimate.observations >= m_options.minObservations)
+        {
+            estimate.source = TermStatisticsSource::PrefixLength;
+            return estimate;
+        }
+        return {};
+    }
+
+    const TermStatisticsOptions& GetOptions() const
+    {
+        return m_options;
+    }
+
+    // Queries recorded since construction or load (not decayed)
+    uint64_t GetRecordCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_recordCount;
+    }
+
+    size_t GetMemoryBytes() const
+    {
+        return sizeof(*this) + m_cells.size() * sizeof(Cell);
+    }
+
+    /* Binary layout (integers are LEB128 varints unless noted)
+     *   "WSTS" magic (4 bytes), version (1 byte)
+     *   width, depth, half-life in seconds, epoch FILETIME ticks, record count
+     *   runs of: zero counters to skip, then one non-zero counter as three little-endian float32
+     *   (weight, sum of log(1 + results), sum of latency ms); the last run may end the sketch
+     * The sketch keeps whatever decay applied when it was saved; time since then decays it
+     * further as soon as it is used again.
+     */
+    std::vector<uint8_t> Serialize() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::vector<uint8_t> bytes = { 'W', 'S', 'T', 'S', FileVersion };
+        WriteVarint(bytes, m_options.width);
+        WriteVarint(bytes, m_options.depth);
+        WriteVarint(bytes, static_cast<uint64_t>(m_options.halfLife.count()));
+        WriteVarint(bytes, m_epochTicks);
+        WriteVarint(bytes, m_recordCount);
+
+        uint64_t zeros = 0;
+        for (const Cell& cell : m_cells)
+        {
+            if (cell.weight == 0.0f)
+            {
+                ++zeros;
+                continue;
+            }
+            WriteVarint(bytes, zeros);
+            zeros = 0;
+            for (float value : { cell.weight, cell.logResults, cell.latencyMs })
+            {
+                uint32_t bits;
+                std::memcpy(&bits, &value, sizeof(bits));
+                for (int shift = 0; shift < 32; shift += 8)
+                {
+                    bytes.push_back(static_cast<uint8_t>(bits >> shift));
+                }
+            }
+        }
+        return bytes;
+    }
+
+    // minObservations is not stored; it comes from 'options', the rest from the file
+    static std::unique_ptr<SearchTermStatistics> Deserialize(const std::vector<uint8_t>& bytes, TermStatisticsOptions options = {})
+    {
+        if (bytes.size() < 5 || bytes[0] != 'W' || bytes[1] != 'S' || bytes[2] != 'T' || bytes[3] != 'S')
+        {
+            throw std::invalid_argument("Not a term statistics file");
+        }
+        if (bytes[4] != FileVersion)
+        {
+            throw std::invalid_argument("Unsupported term statistics version");
+        }
+
+        size_t offset = 5;
+        uint64_t width = ReadVarint(bytes, offset);
+        uint64_t depth = ReadVarint(bytes, offset);
+        uint64_t halfLife = ReadVarint(bytes, offset);
+        if (width > MaxCells || depth > MaxCells || halfLife > INT32_MAX)
+        {
+            throw std::invalid_argument("Corrupt term statistics shape");
+        }
+        options.width = static_cast<size_t>(width);
+        options.depth = static_cast<size_t>(depth);
+        options.halfLife = std::chrono::seconds(static_cast<int64_t>(halfLife));
+        auto statistics = std::make_unique<SearchTermStatistics>(options); // validates the shape
+        statistics->m_epochTicks = ReadVarint(bytes, offset);
+        statistics->m_recordCount = ReadVarint(bytes, offset);
+
+        size_t cell = 0;
+        while (offset < bytes.size())
+        {
+            uint64_t zeros = ReadVarint(bytes, offset);
+            if (zeros >= statistics->m_cells.size() - cell || bytes.size() - offset < 12)
+            {
+                throw std::invalid_argument("Corrupt term statistics counters");
+            }
+            cell += static_cast<size_t>(zeros);
+            float values[3];
+            for (float& value : values)
+            {
+                uint32_t bits = 0;
+                for (int shift = 0; shift < 32; shift += 8)
+                {
+                    bits |= static_cast<uint32_t>(bytes[offset++]) << shift;
+                }
+                std::memcpy(&value, &bits, sizeof(value));
+            }
+            if (!(values[0] > 0.0f) || !std::isfinite(values[0]) || !std::isfinite(values[1]) || !std::isfinite(values[2]))
+            {
+                throw std::invalid_argument("Corrupt term statistics counter");
+            }
+            statistics->m_cells[cell++] = { values[0], values[1], values[2] };
+        }
+        return statistics;
+    }
+
+    void SaveToFile(const std::wstring& path) const
+    {
+        auto bytes = Serialize();
+        std::ofstream file(std::filesystem::path(path), std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Failed to open term statistics for writing");
+        }
+        file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    static std::unique_ptr<SearchTermStatistics> LoadFromFile(const std::wstring& path, TermStatisticsOptions options = {})
+    {
+        std::ifstream file(std::filesystem::path(path), std::ios::binary);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Failed to open term statistics for reading");
+        }
+        std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        return Deserialize(bytes, options);
+    }
+
+private:
+    struct Cell
+    {
+        float weight;
+        float logResults;
+        float latencyMs;
+    };
+
+    static constexpr uint8_t FileVersion = 1;
+    static constexpr size_t MaxCells = size_t(1) << 24;
+    static constexpr double RescaleExponent = 16.0;
+
+    // Half-lives from the epoch to 'now', clamped so a clock set back cannot underflow
+    double Exponent(uint64_t now) const
+    {
+        double ticks = static_cast<double>(static_cast<int64_t>(now - m_epochTicks));
+        double halfLifeTicks = static_cast<double>(m_options.halfLife.count()) * 1e7;
+        return (std::max)(ticks / halfLifeTicks, -RescaleExponent);
+    }
+
+    void Rescale(uint64_t now)
+    {
+        float scale = static_cast<float>(std::exp2(-Exponent(now)));
+        for (Cell& cell : m_cells)
+        {
+            cell.weight *= scale;
+            cell.logResults *= scale;
+            cell.latencyMs *= scale;
+            if (cell.weight < 1e-30f)
+            {
+                cell = {};
+            }
+        }
+        m_epochTicks = now;
+    }
+
+    // Row r uses counter (h1 + r * h2) mod width
+    template <typename Visitor>
+    void ForEachCell(uint64_t key, Visitor&& visitor) const
+    {
+        size_t mask = m_options.width - 1;
+        uint64_t h1 = key & 0xFFFFFFFFull;
+        uint64_t h2 = (key >> 32) | 1;
+        for (size_t row = 0; row < m_options.depth; ++row)
+        {
+            visitor(row * m_options.width + static_cast<size_t>((h1 + row * h2) & mask));
+        }
+    }
+
+    void Add(uint64_t key, const Cell& add)
+    {
+        ForEachCell(key, [&](size_t index) {
+            Cell& cell = m_cells[index];
+            cell.weight += add.weight;
+            cell.logResults += add.logResults;
+            cell.latencyMs += add.latencyMs;
+        });
+    }
+
+    TermStatisticsEstimate Read(uint64_t key, double scale) const
+    {
+        const Cell* best = nullptr;
+        ForEachCell(key, [&](size_t index) {
+            if (!best || m_cells[index].weight < best->weight)
+            {
+                best = &m_cells[index];
+            }
+        });
+
+        TermStatisticsEstimate estimate;
+        if (best->weight > 0.0f)
+        {
+            estimate.observations = static_cast<double>(best->weight) * scale;
+            estimate.resultCount = std::expm1(static_cast<double>(best->logResults) / best->weight);
+            estimate.latencyMs = static_cast<double>(best->latencyMs) / best->weight;
+        }
+        return estimate;
+    }
+
+    static void WriteVarint(std::vector<uint8_t>& bytes, uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            bytes.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        bytes.push_back(static_cast<uint8_t>(value));
+    }
+
+    static uint64_t ReadVarint(const std::vector<uint8_t>& bytes, size_t& offset)
+    {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            if (offset >= bytes.size())
+            {
+                throw std::invalid_argument("Truncated term statistics");
+            }
+            uint8_t byte = bytes[offset++];
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return value;
+            }
+        }
+        throw std::invalid_argument("Corrupt term statistics varint");
+    }
+
+    TermStatisticsOptions m_options;
+    mutable std::mutex m_mutex;
+    std::vector<Cell> m_cells;
+    uint64_t m_epochTicks = 0; // FILETIME at which a new observation weighs 1; 0 until the first
+    uint64_t m_recordCount = 0;
+};
+
+} // namespace wsearch
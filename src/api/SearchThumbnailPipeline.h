@@ -0,0 +1,490 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cwctype>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace wsearch
+{
+
+// One thumbnail to load. Many rows share a key (e.g. every .docx); 'path' is one of the rows
+// that asked for it and is what the loader reads the icon from. When that row's file fails,
+// the key is loaded again from another row's path (see ThumbnailPipelineOptions).
+struct ThumbnailRequest
+{
+    std::wstring key;
+    std::wstring path;
+    bool isFolder = false;
+};
+
+/* IThumbnailLoader - produces the image for a thumbnail key
+ *
+ * Called on the pipeline's worker threads, never on the caller's thread. Return std::nullopt
+ * (or throw) when there is no icon; the pipeline tries the key again with other rows' paths,
+ * then caches the failure for a while.
+ * Override LoadBatch when the backing store can do better than one item at a time.
+ */
+template <typename Image>
+class IThumbnailLoader
+{
+public:
+    virtual ~IThumbnailLoader() = default;
+
+    virtual std::optional<Image> Load(const ThumbnailRequest& request) = 0;
+
+    // Per-thread setup and teardown on each worker, e.g. joining a COM apartment
+    virtual void OnWorkerThreadStarted() {}
+    virtual void OnWorkerThreadStopping() {}
+
+    // 'images' arrives sized to match 'requests', with every entry empty
+    virtual void LoadBatch(const std::vector<ThumbnailRequest>& requests, std::vector<std::optional<Image>>& images)
+    {
+        for (size_t i = 0; i < requests.size(); ++i)
+        {
+            try
+            {
+                images[i] = Load(requests[i]);
+            }
+            catch (...)
+            {
+                images[i].reset();
+            }
+        }
+    }
+};
+
+enum class ThumbnailStatus
+{
+    Ready,   // image is in the cache and returned with the lookup
+    Failed,  // a previous load failed; the row keeps its placeholder
+    Pending, // a load is queued or running; the callback fires when it finishes
+};
+
+template <typename Image>
+struct ThumbnailLookup
+{
+    ThumbnailStatus status = ThumbnailStatus::Pending;
+    std::optional<Image> image;
+};
+
+struct ThumbnailPipelineOptions
+{
+    size_t workerCount = 2;     // loads running at once
+    size_t batchSize = 8;       // keys a worker takes from the queue per wake-up
+    size_t maxLoadAttempts = 3; // paths tried for a key before its failure is cached
+    size_t maxEntries = 2048;   // cached keys; the least recently used settled ones go first
+
+    // Cached failures load again after this, even from a path that failed before
+    std::chrono::milliseconds failureRetryAfter = std::chrono::seconds(30);
+};
+
+struct ThumbnailPipelineStatistics
+{
+    uint64_t requests = 0;
+    uint64_t cacheHits = 0;   // answered from a completed load
+    uint64_t failureHits = 0; // answered from a cached failure
+    uint64_t coalesced = 0;   // joined a load that was already queued or running
+    uint64_t loads = 0;       // keys handed to the loader
+    uint64_t failedLoads = 0;
+    uint64_t retries = 0;     // loads of a failed key from another row's path, or after failureRetryAfter
+    uint64_t evictions = 0;   // cached keys dropped to stay within maxEntries
+    uint64_t batches = 0;
+};
+
+namespace details
+{
+    // Files whose icon is embedded in the file itself get a per-file key; everything else
+    // shares one icon per extension (and all folders share one).
+    inline std::wstring ThumbnailKeyForPath(const std::wstring& path, bool isFolder)
+    {
+        if (isFolder)
+        {
+            return L"<folder>";
+        }
+
+        std::wstring key = path;
+        std::transform(key.begin(), key.end(), key.begin(), ::towlower);
+
+        auto separator = key.find_last_of(L"\\/");
+        auto dot = key.rfind(L'.');
+        if (dot == std::wstring::npos || (separator != std::wstring::npos && dot < separator))
+        {
+            return L".";
+        }
+
+        std::wstring extension = key.substr(dot);
+        for (const wchar_t* perFile : { L".exe", L".lnk", L".ico", L".url", L".appref-ms" })
+        {
+            if (extension == perFile)
+            {
+                return key;
+            }
+        }
+        return extension;
+    }
+} // namespace details
+
+/* ThumbnailPipeline - asynchronous, deduplicated icon loading for result rows
+ *
+ * Request() never blocks on the loader. A cached image (or cached failure) is returned
+ * immediately; otherwise the key is queued and the row gets Pending plus a callback later.
+ * Rows asking for a key that is already queued or loading join that load instead of starting
+ * another. A failed load is retried from another requesting row's path (one unreadable .docx
+ * must not blank every .docx) up to maxLoadAttempts; after that the failure is remembered so it
+ * is not retried on every keystroke, until failureRetryAfter has passed. At most maxEntries keys
+ * are cached, which matters for the per-file keys of executables and shortcuts.
+ * A fixed pool of workers drains the queue in batches. Callbacks run on a worker thread,
+ * outside the pipeline's lock, so marshal back to the UI thread before touching controls.
+ *
+ * Example:
+ *   wsearch::ThumbnailPipeline<Icon> pipeline(std::make_shared<MyIconLoader>());
+ *   auto lookup = pipeline.Request(path, isFolder, [row](const std::optional<Icon>& icon) {
+ *       if (icon) PostToUi(row, *icon);
+ *   });
+ *   if (lookup.status == wsearch::ThumbnailStatus::Ready) row->SetIcon(*lookup.image);
+ */
+template <typename Image>
+class ThumbnailPipeline
+{
+public:
+    using Callback = std::function<void(const std::optional<Image>&)>;
+
+    explicit ThumbnailPipeline(std::shared_ptr<IThumbnailLoader<Image>> loader, ThumbnailPipelineOptions options = {})
+        : m_loader(std::move(loader))
+        , m_options(options)
+    {
+        m_options.workerCount = std::max<size_t>(m_options.workerCount, 1);
+        m_options.batchSize = std::max<size_t>(m_options.batchSize, 1);
+        m_options.maxLoadAttempts = std::max<size_t>(m_options.maxLoadAttempts, 1);
+        m_options.maxEntries = std::max<size_t>(m_options.maxEntries, 1);
+
+        m_workers.reserve(m_options.workerCount);
+        for (size_t i = 0; i < m_options.workerCount; ++i)
+        {
+            m_workers.emplace_back(&ThumbnailPipeline::WorkerThreadProc, this);
+        }
+    }
+
+    // Pending callbacks are dropped; loads already inside the loader finish first
+    ~ThumbnailPipeline()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_shouldStop = true;
+        }
+        m_cv.notify_all();
+
+        for (auto& worker : m_workers)
+        {
+            if (worker.joinable())
+            {
+                worker.join();
+            }
+        }
+    }
+
+    // Non-copyable
+    ThumbnailPipeline(const ThumbnailPipeline&) = delete;
+    ThumbnailPipeline& operator=(const ThumbnailPipeline&) = delete;
+
+    // 'onLoaded' is only kept (and only called) when the lookup comes back Pending
+    ThumbnailLookup<Image> Request(const std::wstring& path, bool isFolder, Callback onLoaded = nullptr)
+    {
+        auto key = details::ThumbnailKeyForPath(path, isFolder);
+
+        ThumbnailLookup<Image> lookup;
+        bool queued = false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_statistics.requests;
+
+            auto [it, inserted] = m_entries.try_emplace(key);
+            auto& entry = it->second;
+            entry.lastUsed = ++m_useCount;
+
+            if (entry.status == ThumbnailStatus::Failed && CanRetry(entry, path))
+            {
+                ++m_statistics.retries;
+                entry.status = ThumbnailStatus::Pending;
+                inserted = true;
+            }
+            lookup.status = entry.status;
+
+            switch (entry.status)
+            {
+            case ThumbnailStatus::Ready:
+                ++m_statistics.cacheHits;
+                lookup.image = entry.image;
+                return lookup;
+
+            case ThumbnailStatus::Failed:
+                ++m_statistics.failureHits;
+                return lookup;
+
+            case ThumbnailStatus::Pending:
+                if (onLoaded)
+                {
+                    entry.waiters.push_back(std::move(onLoaded));
+                }
+                if (inserted)
+                {
+                    entry.loadingPath = path;
+                    entry.retryPath.reset();
+                    m_queue.push_back({ std::move(key), path, isFolder });
+                    queued = true;
+                    TrimEntries();
+                }
+                else
+                {
+                    // Another row's file to load the key from if this load fails
+                    if (!entry.retryPath && path != entry.loadingPath)
+                    {
+                        entry.retryPath = path;
+                    }
+                    ++m_statistics.coalesced;
+                }
+                break;
+            }
+        }
+
+        if (queued)
+        {
+            m_cv.notify_one();
+        }
+        return lookup;
+    }
+
+    // Forget cached failures now (e.g. after a network share comes back) so they load again
+    void ClearFailures()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto it = m_entries.begin(); it != m_entries.end();)
+        {
+            it = (it->second.status == ThumbnailStatus::Failed) ? m_entries.erase(it) : std::next(it);
+        }
+    }
+
+    // Block until nothing is queued or loading; returns false on timeout
+    template <typename Rep, typename Period>
+    bool WaitForIdle(std::chrono::duration<Rep, Period> timeout)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return m_idleCv.wait_for(lock, timeout, [this]() { return m_queue.empty() && m_inFlight == 0; });
+    }
+
+    // Keys queued or loading
+    size_t GetPendingCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_queue.size() + m_inFlight;
+    }
+
+    // Keys cached, loaded or not
+    size_t GetEntryCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_entries.size();
+    }
+
+    ThumbnailPipelineStatistics GetStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_statistics;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry
+    {
+        ThumbnailStatus status = ThumbnailStatus::Pending;
+        std::optional<Image> image;
+        std::vector<Callback> waiters;
+        std::wstring loadingPath;               // path of the load queued or running
+        std::optional<std::wstring> retryPath;  // another row's path, tried if that load fails
+        std::wstring failedPath;                // path of the last failed load
+        size_t attempts = 0;                    // failed loads since the key last succeeded or expired
+        Clock::time_point failedAt;
+        uint64_t lastUsed = 0;
+    };
+
+    // Whether a request from 'path' should load a failed key again. Called with m_mutex held.
+    bool CanRetry(Entry& entry, const std::wstring& path) const
+    {
+        if (Clock::now() - entry.failedAt >= m_options.failureRetryAfter)
+        {
+            entry.attempts = 0;
+            return true;
+        }
+        return entry.attempts < m_options.maxLoadAttempts && path != entry.failedPath;
+    }
+
+    // Drops the least recently used settled keys once the cache is over maxEntries, down to
+    // 7/8 of it so the sort is not repeated on every miss. Pending keys have waiters and a
+    // queued load, so they stay. Called with m_mutex held.
+    void TrimEntries()
+    {
+        if (m_entries.size() <= m_options.maxEntries)
+        {
+            return;
+        }
+
+        using EntryIterator = typename std::unordered_map<std::wstring, Entry>::iterator;
+        std::vector<EntryIterator> settled;
+        for (auto it = m_entries.begin(); it != m_entries.end(); ++it)
+        {
+            if (it->second.status != ThumbnailStatus::Pending)
+            {
+                settled.push_back(it);
+            }
+        }
+
+        size_t target = m_options.maxEntries - m_options.maxEntries / 8;
+        size_t excess = std::min(m_entries.size() - target, settled.size());
+        auto olderThan = [](EntryIterator left, EntryIterator right) { return left->second.lastUsed < right->second.lastUsed; };
+        std::nth_element(settled.begin(), settled.begin() + excess, settled.end(), olderThan);
+        for (size_t i = 0; i < excess; ++i)
+        {
+            m_entries.erase(settled[i]);
+        }
+        m_statistics.evictions += excess;
+    }
+
+    void WorkerThreadProc()
+    {
+        std::vector<ThumbnailRequest> batch;
+        std::vector<std::optional<Image>> images;
+        std::vector<std::vector<Callback>> waiters;
+
+        m_loader->OnWorkerThreadStarted();
+        for (;;)
+        {
+            batch.clear();
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [this]() { return m_shouldStop || !m_queue.empty(); });
+                if (m_shouldStop)
+                {
+                    break;
+                }
+
+                // Split a short queue across the pool rather than letting one worker take it all
+                size_t share = (m_queue.size() + m_options.workerCount - 1) / m_options.workerCount;
+                size_t take = std::min(m_options.batchSize, share);
+                while (batch.size() < take)
+                {
+                    batch.push_back(std::move(m_queue.front()));
+                    m_queue.pop_front();
+                }
+                m_inFlight += batch.size();
+                m_statistics.loads += batch.size();
+                ++m_statistics.batches;
+            }
+
+            images.assign(batch.size(), std::nullopt);
+            try
+            {
+                m_loader->LoadBatch(batch, images);
+            }
+            catch (...)
+            {
+                images.assign(batch.size(), std::nullopt);
+            }
+
+            waiters.resize(batch.size());
+            bool requeued = false;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                for (size_t i = 0; i < batch.size(); ++i)
+                {
+                    auto& entry = m_entries[batch[i].key];
+                    if (images[i])
+                    {
+                        entry.status = ThumbnailStatus::Ready;
+                        entry.image = images[i];
+                        entry.attempts = 0;
+                    }
+                    else
+                    {
+                        ++m_statistics.failedLoads;
+                        ++entry.attempts;
+                        entry.failedPath = batch[i].path;
+                        entry.failedAt = Clock::now();
+
+                        // The waiters keep waiting while another row's file is tried
+                        if (entry.retryPath && entry.attempts < m_options.maxLoadAttempts)
+                        {
+                            ++m_statistics.retries;
+                            entry.loadingPath = std::move(*entry.retryPath);
+                            entry.retryPath.reset();
+                            m_queue.push_back({ batch[i].key, entry.loadingPath, batch[i].isFolder });
+                            requeued = true;
+                            continue;
+                        }
+                        entry.status = ThumbnailStatus::Failed;
+                        entry.retryPath.reset();
+                    }
+                    waiters[i] = std::move(entry.waiters);
+                    entry.waiters.clear();
+                }
+            }
+            if (requeued)
+            {
+                m_cv.notify_one();
+            }
+
+            for (size_t i = 0; i < batch.size(); ++i)
+            {
+                for (auto& callback : waiters[i])
+                {
+                    try
+                    {
+                        callback(images[i]);
+                    }
+                    catch (...)
+                    {
+                        // A row that can't take its icon keeps the placeholder
+                    }
+                }
+                waiters[i].clear();
+            }
+
+            // Only idle once callbacks have run, so WaitForIdle() callers see every row updated
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_inFlight -= batch.size();
+            }
+            m_idleCv.notify_all();
+        }
+        m_loader->OnWorkerThreadStopping();
+    }
+
+    std::shared_ptr<IThumbnailLoader<Image>> m_loader;
+    ThumbnailPipelineOptions m_options;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::condition_variable m_idleCv;
+    std::unordered_map<std::wstring, Entry> m_entries;
+    std::deque<ThumbnailRequest> m_queue;
+    uint64_t m_useCount = 0;
+    size_t m_inFlight = 0;
+    bool m_shouldStop = false;
+    ThumbnailPipelineStatistics m_statistics;
+
+    std::vector<std::thread> m_workers;
+};
+
+} // namespace wsearch
@@ -3,6 +3,7 @@
 
 #include <winrt/Windows.Data.Text.h>
 #include <winrt/Windows.Foundation.Collections.h>
+#include "SearchQueryParser.h"
 #include <string>
 #include <vector>
 #include <cctype>
@@ -25,6 +26,7 @@ class SearchTokenizer
 public:
     SearchTokenizer(std::wstring_view text)
         : m_text(text)
+        , m_shape(ParseSearchText(m_text).shape)
     {
         TokenizeText();
     }
@@ -65,18 +67,24 @@ public:
         return m_tokens.empty();
     }
 
-    // Check if text is quoted (user wants exact phrase)
+    // Check if text is quoted (user wants exact phrase), including a phrase whose closing
+    // quote is not typed yet
     bool IsQuoted() const
     {
-        return m_text.length() >= 2 && 
-               m_text.front() == L'"' && 
-               m_text.back() == L'"';
+        return m_shape == SearchTextShape::Phrase || m_shape == SearchTextShape::PhrasePrefix;
+    }
+
+    // Check if the phrase is still open ("annual rep), so it should also match as a prefix
+    bool IsPhrasePrefix() const
+    {
+        return m_shape == SearchTextShape::PhrasePrefix;
     }
 
 private:
     void TokenizeText()
     {
-        if (m_text.empty())
+        // Nothing searchable, e.g. a lone operator or quote while typing
+        if (m_shape == SearchTextShape::Empty || m_shape == SearchTextShape::NoQuery)
         {
             return;
         }
@@ -85,7 +93,9 @@ private:
         if (IsQuoted())
         {
             // Remove quotes and store as single token
-            m_tokens.push_back(std::wstring(m_text.substr(1, m_text.length() - 2)));
+            std::wstring phrase;
+            ParseSearchText(m_text).AppendWords(phrase);
+            m_tokens.push_back(std::move(phrase));
             return;
         }
 
@@ -99,7 +109,7 @@ private:
             {
                 std::wstring token(segment.Text());
                 // Filter out empty tokens and pure whitespace/punctuation
-                if (!token.empty() && iswalnum(token[0]))
+                if (!token.empty() && details::IsSearchTextWordCharacter(token[0]))
                 {
                     m_tokens.push_back(token);
                 }
@@ -118,32 +128,16 @@ private:
         }
     }
 
+    // Whitespace split with dangling operators and stray quotes dropped (see ParseSearchText)
     void SplitOnWhitespace()
     {
-        std::wstring token;
-        for (wchar_t ch : m_text)
-        {
-            if (iswspace(ch))
-            {
-                if (!token.empty())
-                {
-                    m_tokens.push_back(token);
-                    token.clear();
-                }
-            }
-            else
-            {
-                token += ch;
-            }
-        }
-        
-        if (!token.empty())
-        {
-            m_tokens.push_back(token);
-        }
+        ParseSearchText(m_text).ForEachWord([this](std::wstring_view word) {
+            m_tokens.emplace_back(word);
+        });
     }
 
     std::wstring m_text;
+    SearchTextShape m_shape;
     std::vector<std::wstring> m_tokens;
 };
 
@@ -0,0 +1,397 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include "SearchPropertyRegistry.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory_resource>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+namespace wsearch
+{
+
+enum class SearchValueType : uint8_t
+{
+    Empty,      // property missing, null, or of a type the decoder does not keep
+    Int32,
+    UInt32,
+    Int64,
+    UInt64,
+    Double,
+    Bool,
+    FileTime,   // FILETIME as one integer: 100 ns ticks since 1601-01-01 UTC
+    String,
+    Vector,     // multi-valued property, e.g. System.Kind
+};
+
+class SearchValue;
+
+// The elements of a Vector value
+class SearchValueRange
+{
+public:
+    SearchValueRange() = default;
+    SearchValueRange(const SearchValue* items, size_t count)
+        : m_items(items)
+        , m_count(count)
+    {
+    }
+
+    const SearchValue* begin() const { return m_items; }
+    inline const SearchValue* end() const;
+    size_t size() const { return m_count; }
+    bool empty() const { return m_count == 0; }
+    inline const SearchValue& operator[](size_t index) const;
+
+private:
+    const SearchValue* m_items = nullptr;
+    size_t m_count = 0;
+};
+
+/* SearchValue - 16-byte tagged property value
+ *
+ * Holds a number, a FILETIME, a bool, a view of a string or a view of an array of values. The
+ * string and array storage belongs to whoever decoded the value (normally a SearchValuePage
+ * arena), so copying a value is a 16-byte copy and reading one never allocates.
+ * Typed getters return the fallback when the value has another type; the integer getters
+ * convert between integer types when the value fits.
+ *
+ * Example:
+ *   SearchValue size = row.Get(propid::Size);
+ *   uint64_t bytes = size.GetUInt64();
+ *   for (const auto& kind : row.Get(propid::Kind).GetVector()) { Count(kind.GetString()); }
+ */
+class SearchValue
+{
+public:
+    constexpr SearchValue() = default;
+
+    static SearchValue FromInt32(int32_t value) { return SearchValue(SearchValueType::Int32, static_cast<int64_t>(value)); }
+    static SearchValue FromUInt32(uint32_t value) { return SearchValue(SearchValueType::UInt32, static_cast<int64_t>(value)); }
+    static SearchValue FromInt64(int64_t value) { return SearchValue(SearchValueType::Int64, value); }
+    static SearchValue FromUInt64(uint64_t value) { return SearchValue(SearchValueType::UInt64, static_cast<int64_t>(value)); }
+    static SearchValue FromFileTime(uint64_t ticks) { return SearchValue(SearchValueType::FileTime, static_cast<int64_t>(ticks)); }
+    static SearchValue FromBool(bool value) { return SearchValue(SearchValueType::Bool, value ? 1 : 0); }
+
+    static SearchValue FromDouble(double value)
+    {
+        SearchValue result;
+        result.m_type = SearchValueType::Double;
+        result.m_payload.real = value;
+        return result;
+    }
+
+    // Views 'text' without copying; it must outlive the value (see CopyString)
+    static SearchValue FromStringView(std::wstring_view text)
+    {
+        SearchValue result;
+        result.m_type = SearchValueType::String;
+        result.m_payload.text = text.data();
+        result.m_size = CheckedSize(text.size());
+        return result;
+    }
+
+    // Views 'count' values without copying; they must outlive the value (see CopyVector)
+    static SearchValue FromVectorView(const SearchValue* items, size_t count)
+    {
+        SearchValue result;
+        result.m_type = SearchValueType::Vector;
+        result.m_payload.items = items;
+        result.m_size = CheckedSize(count);
+        return result;
+    }
+
+    // Copies the characters into 'resource' and views the copy
+    static SearchValue CopyString(std::wstring_view text, std::pmr::memory_resource* resource)
+    {
+        if (text.empty())
+        {
+            return FromStringView(std::wstring_view());
+        }
+        auto chars = static_cast<wchar_t*>(resource->allocate(text.size() * sizeof(wchar_t), alignof(wchar_t)));
+        std::memcpy(chars, text.data(), text.size() * sizeof(wchar_t));
+        return FromStringView(std::wstring_view(chars, text.size()));
+    }
+
+    // Copies the values (not what they view) into 'resource' and views the copy
+    static SearchValue CopyVector(const SearchValue* items, size_t count, std::pmr::memory_resource* resource)
+    {
+        if (count == 0)
+        {
+            return FromVectorView(nullptr, 0);
+        }
+        auto copy = static_cast<SearchValue*>(resource->allocate(count * sizeof(SearchValue), alignof(SearchValue)));
+        std::memcpy(static_cast<void*>(copy), items, count * sizeof(SearchValue));
+        return FromVectorView(copy, count);
+    }
+
+    SearchValueType Type() const { return m_type; }
+    bool IsEmpty() const { return m_type == SearchValueType::Empty; }
+
+    int32_t GetInt32(int32_t fallback = 0) const
+    {
+        int64_t value = 0;
+        return (GetSigned(value) && value >= (std::numeric_limits<int32_t>::min)() && value <= (std::numeric_limits<int32_t>::max)())
+            ? static_cast<int32_t>(value) : fallback;
+    }
+
+    uint32_t GetUInt32(uint32_t fallback = 0) const
+    {
+        uint64_t value = 0;
+        return (GetUnsigned(value) && value <= (std::numeric_limits<uint32_t>::max)()) ? static_cast<uint32_t>(value) : fallback;
+    }
+
+    int64_t GetInt64(int64_t fallback = 0) const
+    {
+        int64_t value = 0;
+        return GetSigned(value) ? value : fallback;
+    }
+
+    uint64_t GetUInt64(uint64_t fallback = 0) const
+    {
+        uint64_t value = 0;
+        return GetUnsigned(value) ? value : fallback;
+    }
+
+    // Doubles, and integers converted to double
+    double GetDouble(double fallback = 0.0) const
+    {
+        switch (m_type)
+        {
+        case SearchValueType::Double: return m_payload.real;
+        case SearchValueType::Int32:
+        case SearchValueType::Int64: return static_cast<double>(m_payload.integer);
+        case SearchValueType::UInt32:
+        case SearchValueType::UInt64: return static_cast<double>(static_cast<uint64_t>(m_payload.integer));
+        default: return fallback;
+        }
+    }
+
+    bool GetBool(bool fallback = false) const
+    {
+        return (m_type == SearchValueType::Bool) ? (m_payload.integer != 0) : fallback;
+    }
+
+    // 100 ns ticks since 1601-01-01 UTC
+    std::optional<uint64_t> GetFileTime() const
+    {
+        if (m_type != SearchValueType::FileTime)
+        {
+            return std::nullopt;
+        }
+        return static_cast<uint64_t>(m_payload.integer);
+    }
+
+    // Empty unless the value is a string
+    std::wstring_view GetString() const
+    {
+        return (m_type == SearchValueType::String) ? std::wstring_view(m_payload.text, m_size) : std::wstring_view();
+    }
+
+    // Empty unless the value is a vector
+    SearchValueRange GetVector() const
+    {
+        return (m_type == SearchValueType::Vector) ? SearchValueRange(m_payload.items, m_size) : SearchValueRange();
+    }
+
+private:
+    SearchValue(SearchValueType type, int64_t integer)
+        : m_type(type)
+    {
+        m_payload.integer = integer;
+    }
+
+    static uint32_t CheckedSize(size_t size)
+    {
+        if (size > (std::numeric_limits<uint32_t>::max)())
+        {
+            throw std::length_error("SearchValue string or vector is too long");
+        }
+        return static_cast<uint32_t>(size);
+    }
+
+    bool GetSigned(int64_t& value) const
+    {
+        switch (m_type)
+        {
+        case SearchValueType::Int32:
+        case SearchValueType::UInt32:
+        case SearchValueType::Int64:
+            value = m_payload.integer;
+            return true;
+        case SearchValueType::UInt64:
+            value = m_payload.integer;
+            return value >= 0;
+        default:
+            return false;
+        }
+    }
+
+    bool GetUnsigned(uint64_t& value) const
+    {
+        switch (m_type)
+        {
+        case SearchValueType::UInt32:
+        case SearchValueType::UInt64:
+            value = static_cast<uint64_t>(m_payload.integer);
+            return true;
+        case SearchValueType::Int32:
+        case SearchValueType::Int64:
+            value = static_cast<uint64_t>(m_payload.integer);
+            return m_payload.integer >= 0;
+        default:
+            return false;
+        }
+    }
+
+    union Payload
+    {
+        int64_t integer;            // every integer type, FileTime and Bool
+        double real;
+        const wchar_t* text;
+        const SearchValue* items;
+    };
+
+    Payload m_payload{ 0 };
+    uint32_t m_size = 0;            // characters of a String, elements of a Vector
+    SearchValueType m_type = SearchValueType::Empty;
+};
+
+static_assert(sizeof(SearchValue) == 16, "SearchValue should stay two words");
+
+inline const SearchValue* SearchValueRange::end() const
+{
+    return m_items + m_count;
+}
+
+inline const SearchValue& SearchValueRange::operator[](size_t index) const
+{
+    return m_items[index];
+}
+
+class SearchValuePage;
+
+// One decoded row of a SearchValuePage; valid until the next AddRow on the page
+class SearchValueRow
+{
+public:
+    SearchValueRow(const SearchValuePage& page, const SearchValue* values)
+        : m_page(&page)
+        , m_values(values)
+    {
+    }
+
+    const SearchValue& operator[](size_t column) const
+    {
+        return m_values[column];
+    }
+
+    // The value of a property, or an empty value if the page has no such column
+    inline const SearchValue& Get(PropertyId id) const;
+
+    inline size_t ColumnCount() const;
+
+private:
+    const SearchValuePage* m_page;
+    const SearchValue* m_values;
+};
+
+/* SearchValuePage - decoded rows for a fixed list of property columns
+ *
+ * Rows are stored back to back as SearchValues, and the strings and vectors they view live in
+ * the page's arena, so a page of rows is a handful of allocations and is released in one shot.
+ * Decoders call AddRow and fill the returned values, copying strings with
+ * SearchValue::CopyString(text, page.Resource()).
+ *
+ * Example:
+ *   wsearch::SearchValuePage page({ wsearch::propid::ItemUrl, wsearch::propid::Size });
+ *   auto values = page.AddRow();
+ *   values[0] = wsearch::SearchValue::CopyString(url, page.Resource());
+ *   values[1] = wsearch::SearchValue::FromUInt64(size);
+ *   uint64_t bytes = page.GetRow(0).Get(wsearch::propid::Size).GetUInt64();
+ */
+class SearchValuePage
+{
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    explicit SearchValuePage(std::vector<PropertyId> columns, std::pmr::memory_resource* upstream = std::pmr::new_delete_resource())
+        : m_columns(std::move(columns))
+        , m_arena(upstream)
+    {
+    }
+
+    // Non-copyable, non-movable: rows view the arena
+    SearchValuePage(const SearchValuePage&) = delete;
+    SearchValuePage& operator=(const SearchValuePage&) = delete;
+
+    const std::vector<PropertyId>& GetColumns() const
+    {
+        return m_columns;
+    }
+
+    // Index of the property's column, or npos
+    size_t GetColumnIndex(PropertyId id) const
+    {
+        for (size_t i = 0; i < m_columns.size(); ++i)
+        {
+            if (m_columns[i] == id)
+            {
+                return i;
+            }
+        }
+        return npos;
+    }
+
+    void ReserveRows(size_t rows)
+    {
+        m_values.reserve(rows * m_columns.size());
+    }
+
+    // Appends a row of empty values; the pointer is valid until the next AddRow
+    SearchValue* AddRow()
+    {
+        m_values.resize(m_values.size() + m_columns.size());
+        return m_values.data() + (m_values.size() - m_columns.size());
+    }
+
+    size_t GetRowCount() const
+    {
+        return m_columns.empty() ? 0 : m_values.size() / m_columns.size();
+    }
+
+    SearchValueRow GetRow(size_t row) const
+    {
+        return SearchValueRow(*this, m_values.data() + row * m_columns.size());
+    }
+
+    // Storage for the strings and vectors of the page's values
+    std::pmr::memory_resource* Resource()
+    {
+        return &m_arena;
+    }
+
+private:
+    std::vector<PropertyId> m_columns;
+    std::pmr::monotonic_buffer_resource m_arena;
+    std::vector<SearchValue> m_values; // GetRowCount() * m_columns.size(), row-major
+};
+
+inline const SearchValue& SearchValueRow::Get(PropertyId id) const
+{
+    static const SearchValue empty;
+    size_t column = m_page->GetColumnIndex(id);
+    return (column == SearchValuePage::npos) ? empty : m_values[column];
+}
+
+inline size_t SearchValueRow::ColumnCount() const
+{
+    return m_page->GetColumns().size();
+}
+
+} // namespace wsearch
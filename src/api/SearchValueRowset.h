@@ -0,0 +1,282 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include "SearchPlatCore.h"
+#include "SearchProjection.h"
+#include "SearchPropertySchemaSource.h"
+#include "SearchValue.h"
+#include <propvarutil.h>
+#include <vector>
+
+namespace wsearch
+{
+
+namespace details
+{
+    inline uint64_t FileTimeToTicks(const FILETIME& time)
+    {
+        return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    }
+
+    inline FILETIME TicksToFileTime(uint64_t ticks)
+    {
+        FILETIME time;
+        time.dwLowDateTime = static_cast<DWORD>(ticks);
+        time.dwHighDateTime = static_cast<DWORD>(ticks >> 32);
+        return time;
+    }
+
+    // Converts a PROPVARIANT once, at decode time; strings and vectors are copied into 'resource'
+    inline SearchValue ToSearchValue(const PROPVARIANT& value, std::pmr::memory_resource* resource)
+    {
+        switch (value.vt)
+        {
+        case VT_I4: return SearchValue::FromInt32(value.lVal);
+        case VT_UI4: return SearchValue::FromUInt32(value.ulVal);
+        case VT_I8: return SearchValue::FromInt64(value.hVal.QuadPart);
+        case VT_UI8: return SearchValue::FromUInt64(value.uhVal.QuadPart);
+        case VT_R8: return SearchValue::FromDouble(value.dblVal);
+        case VT_BOOL: return SearchValue::FromBool(value.boolVal != VARIANT_FALSE);
+        case VT_FILETIME: return SearchValue::FromFileTime(FileTimeToTicks(value.filetime));
+        case VT_LPWSTR: return SearchValue::CopyString(value.pwszVal ? value.pwszVal : L"", resource);
+        case VT_BSTR: return SearchValue::CopyString(std::wstring_view(value.bstrVal, SysStringLen(value.bstrVal)), resource);
+        case VT_VECTOR | VT_LPWSTR:
+        {
+            std::vector<SearchValue> items;
+            items.reserve(value.calpwstr.cElems);
+            for (ULONG i = 0; i < value.calpwstr.cElems; ++i)
+            {
+                items.push_back(SearchValue::CopyString(value.calpwstr.pElems[i] ? value.calpwstr.pElems[i] : L"", resource));
+            }
+            return SearchValue::CopyVector(items.data(), items.size(), resource);
+        }
+        default: return SearchValue();
+        }
+    }
+
+    // VARIANT columns (multi-valued properties) arrive as SAFEARRAYs
+    inline SearchValue ToSearchValue(const VARIANT& value, std::pmr::memory_resource* resource)
+    {
+        if (value.vt == (VT_ARRAY | VT_BSTR) && value.parray)
+        {
+            LONG lower = 0;
+            LONG upper = -1;
+            SafeArrayGetLBound(value.parray, 1, &lower);
+            SafeArrayGetUBound(value.parray, 1, &upper);
+
+            BSTR* strings = nullptr;
+            std::vector<SearchValue> items;
+            if (upper >= lower && SUCCEEDED(SafeArrayAccessData(value.parray, reinterpret_cast<void**>(&strings))))
+            {
+                items.reserve(static_cast<size_t>(upper - lower + 1));
+                for (LONG i = 0; i <= upper - lower; ++i)
+                {
+                    items.push_back(SearchValue::CopyString(std::wstring_view(strings[i], SysStringLen(strings[i])), resource));
+                }
+                SafeArrayUnaccessData(value.parray);
+            }
+            return SearchValue::CopyVector(items.data(), items.size(), resource);
+        }
+
+        PROPVARIANT converted;
+        PropVariantInit(&converted);
+        if (FAILED(VariantToPropVariant(&value, &converted)))
+        {
+            return SearchValue();
+        }
+        auto result = ToSearchValue(converted, resource);
+        PropVariantClear(&converted);
+        return result;
+    }
+
+    // Appends one row to 'page' with the page's columns read from a property store
+    inline void ReadPropertyStoreRow(IPropertyStore* store, SearchValuePage& page)
+    {
+        auto& registry = GetSharedPropertyRegistry();
+        const auto& columns = page.GetColumns();
+        SearchValue* values = page.AddRow();
+        for (size_t i = 0; i < columns.size(); ++i)
+        {
+            PropertyInfo info = registry.GetInfo(columns[i]);
+            if (!info.hasKey)
+            {
+                continue;
+            }
+
+            PROPVARIANT value;
+            PropVariantInit(&value);
+            if (SUCCEEDED(store->GetValue(ToPropertyKey(info.key), &value)))
+            {
+                values[i] = ToSearchValue(value, page.Resource());
+            }
+            PropVariantClear(&value);
+        }
+    }
+
+    // One bound column; large enough for a VARIANT
+    struct SearchValueColumnSlot
+    {
+        DBSTATUS status;
+        DBLENGTH length;
+        alignas(8) unsigned char value[sizeof(VARIANT)];
+    };
+} // namespace details
+
+/* RowsetValueReader - decodes rowset rows straight into a SearchValuePage
+ *
+ * Binds each page column with an accessor typed from the property registry (strings by
+ * reference, numbers and FILETIMEs in place, multi-valued properties as VARIANT) and reads
+ * every row with one IAccessor::GetData, so decoded rows never go through IPropertyStore or
+ * PROPVARIANT. The rowset's columns must be the page's columns in order, e.g. a query whose
+ * SELECT list comes from details::AppendPropertySelectList.
+ *
+ * Example:
+ *   wsearch::SearchValuePage page({ wsearch::propid::ItemUrl, wsearch::propid::Size, wsearch::propid::Kind });
+ *   std::wstring sql(L"SELECT ");
+ *   wsearch::details::AppendPropertySelectList(sql, page.GetColumns(), wsearch::details::GetSharedPropertyRegistry());
+ *   sql += L" FROM SystemIndex WHERE SCOPE='file:'";
+ *   auto rowset = wsearch::details::ExecuteQuery(sql);
+ *   wsearch::RowsetValueReader reader(rowset.get(), page.GetColumns());
+ *   reader.ReadRows(page, 100);
+ */
+class RowsetValueReader
+{
+public:
+    RowsetValueReader(_In_ IRowset* rowset, const std::vector<PropertyId>& columns)
+        : m_rowset(rowset)
+        , m_slots(columns.size())
+    {
+        auto& registry = details::GetSharedPropertyRegistry();
+        std::vector<DBBINDING> bindings(columns.size());
+        for (size_t i = 0; i < columns.size(); ++i)
+        {
+            size_t slotOffset = i * sizeof(details::SearchValueColumnSlot);
+            bindings[i].iOrdinal = static_cast<DBORDINAL>(i + 1); // ordinal 0 is the bookmark
+            bindings[i].obStatus = slotOffset + offsetof(details::SearchValueColumnSlot, status);
+            bindings[i].obLength = slotOffset + offsetof(details::SearchValueColumnSlot, length);
+            bindings[i].obValue = slotOffset + offsetof(details::SearchValueColumnSlot, value);
+            bindings[i].dwPart = DBPART_VALUE | DBPART_LENGTH | DBPART_STATUS;
+            bindings[i].dwMemOwner = DBMEMOWNER_CLIENTOWNED;
+            bindings[i].eParamIO = DBPARAMIO_NOTPARAM;
+            bindings[i].cbMaxLen = sizeof(details::SearchValueColumnSlot::value);
+            bindings[i].wType = ToDbType(registry.GetInfo(columns[i]).type);
+            m_types.push_back(bindings[i].wType);
+        }
+
+        winrt::com_ptr<IAccessor> accessor;
+        THROW_IF_FAILED(rowset->QueryInterface(IID_PPV_ARGS(accessor.put())));
+
+        HACCESSOR handle = nullptr;
+        std::vector<DBBINDSTATUS> bindStatus(columns.size());
+        THROW_IF_FAILED(accessor->CreateAccessor(DBACCESSOR_ROWDATA, bindings.size(), bindings.data(),
+            sizeof(details::SearchValueColumnSlot) * bindings.size(), &handle, bindStatus.data()));
+        m_accessor = std::make_unique<details::UniqueAccessor>(std::move(accessor), handle);
+    }
+
+    // Appends up to maxRows rows (0 = until the end) to 'page'; returns the number read
+    size_t ReadRows(SearchValuePage& page, size_t maxRows = 0)
+    {
+        size_t rowsRead = 0;
+        DBCOUNTITEM rowCountReturned = 0;
+        do
+        {
+            HROW rowBuffer[256];
+            HROW* rowReturned = rowBuffer;
+            DBROWCOUNT request = ARRAYSIZE(rowBuffer);
+            if (maxRows != 0)
+            {
+                request = static_cast<DBROWCOUNT>((std::min)(static_cast<size_t>(request), maxRows - rowsRead));
+            }
+
+            HRESULT hr = m_rowset->GetNextRows(DB_NULL_HCHAPTER, 0, request, &rowCountReturned, &rowReturned);
+            if (hr == DB_S_ENDOFROWSET && rowCountReturned == 0)
+            {
+                break;
+            }
+            THROW_IF_FAILED(hr);
+
+            // Release the HROWs even if decoding throws
+            auto releaseRows = wil::scope_exit([&]() {
+                m_rowset->ReleaseRows(rowCountReturned, rowReturned, nullptr, nullptr, nullptr);
+            });
+
+            page.ReserveRows(page.GetRowCount() + static_cast<size_t>(rowCountReturned));
+            for (DBCOUNTITEM i = 0; i < rowCountReturned; ++i)
+            {
+                THROW_IF_FAILED(m_rowset->GetData(rowBuffer[i], m_accessor->Get(), m_slots.data()));
+                SearchValue* values = page.AddRow();
+                for (size_t column = 0; column < m_slots.size(); ++column)
+                {
+                    values[column] = DecodeSlot(m_slots[column], m_types[column], page.Resource());
+                }
+            }
+
+            rowsRead += static_cast<size_t>(rowCountReturned);
+        } while (rowCountReturned > 0 && (maxRows == 0 || rowsRead < maxRows));
+
+        return rowsRead;
+    }
+
+private:
+    static DBTYPE ToDbType(PropertyValueType type)
+    {
+        switch (type)
+        {
+        case PropertyValueType::String: return DBTYPE_WSTR | DBTYPE_BYREF;
+        case PropertyValueType::Int32: return DBTYPE_I4;
+        case PropertyValueType::UInt32: return DBTYPE_UI4;
+        case PropertyValueType::Int64: return DBTYPE_I8;
+        case PropertyValueType::UInt64: return DBTYPE_UI8;
+        case PropertyValueType::Double: return DBTYPE_R8;
+        case PropertyValueType::Bool: return DBTYPE_BOOL;
+        case PropertyValueType::FileTime: return DBTYPE_FILETIME;
+        default: return DBTYPE_VARIANT;
+        }
+    }
+
+    // Takes ownership of provider-allocated strings and VARIANT contents
+    static SearchValue DecodeSlot(details::SearchValueColumnSlot& slot, DBTYPE type, std::pmr::memory_resource* resource)
+    {
+        // DBSTATUS_S_ISNULL and conversion failures leave the value empty
+        if (slot.status != DBSTATUS_S_OK)
+        {
+            return SearchValue();
+        }
+
+        if (type == DBTYPE_VARIANT)
+        {
+            auto variant = reinterpret_cast<VARIANT*>(slot.value);
+            SearchValue result = details::ToSearchValue(*variant, resource);
+            VariantClear(variant);
+            return result;
+        }
+
+        const void* value = slot.value;
+        switch (type)
+        {
+        case DBTYPE_WSTR | DBTYPE_BYREF:
+        {
+            auto text = *static_cast<wchar_t* const*>(value);
+            SearchValue result = SearchValue::CopyString(
+                text ? std::wstring_view(text, static_cast<size_t>(slot.length / sizeof(wchar_t))) : std::wstring_view(), resource);
+            CoTaskMemFree(text);
+            return result;
+        }
+        case DBTYPE_I4: return SearchValue::FromInt32(*static_cast<const int32_t*>(value));
+        case DBTYPE_UI4: return SearchValue::FromUInt32(*static_cast<const uint32_t*>(value));
+        case DBTYPE_I8: return SearchValue::FromInt64(*static_cast<const int64_t*>(value));
+        case DBTYPE_UI8: return SearchValue::FromUInt64(*static_cast<const uint64_t*>(value));
+        case DBTYPE_R8: return SearchValue::FromDouble(*static_cast<const double*>(value));
+        case DBTYPE_BOOL: return SearchValue::FromBool(*static_cast<const VARIANT_BOOL*>(value) != VARIANT_FALSE);
+        case DBTYPE_FILETIME: return SearchValue::FromFileTime(details::FileTimeToTicks(*static_cast<const FILETIME*>(value)));
+        default: return SearchValue();
+        }
+    }
+
+    IRowset* m_rowset;
+    std::unique_ptr<details::UniqueAccessor> m_accessor;
+    std::vector<DBTYPE> m_types;
+    std::vector<details::SearchValueColumnSlot> m_slots;
+};
+
+} // namespace wsearch
@@ -26,55 +26,75 @@ struct TelemetryProvider
     template <typename... args_t>
     void TraceLoggingInfo(_Printf_format_string_ const wchar_t* format, args_t&&... args)
     {
-        auto str = wil::str_printf_failfast<wil::unique_cotaskmem_string>(format, wistd::forward<args_t>(args)...);
-        TraceLoggingWrite(
-            g_hSearchPlatformCoreProvider,
-            "SearchProviderInfo",
-            TraceLoggingLevel(WINEVENT_LEVEL_INFO),
-            TraceLoggingWideString(str.get(), "Message"));
-        OnTraceLoggingInfo(str.get());
+        FormatMessageAndInvoke([this](const wchar_t* message) {
+            TraceLoggingWrite(
+                g_hSearchPlatformCoreProvider,
+                "SearchProviderInfo",
+                TraceLoggingLevel(WINEVENT_LEVEL_INFO),
+                TraceLoggingWideString(message, "Message"));
+            OnTraceLoggingInfo(message);
+        }, format, wistd::forward<args_t>(args)...);
     }
 
     template <typename... args_t>
     void TraceLoggingError(_Printf_format_string_ const wchar_t* format, args_t&&... args)
     {
-        auto str = wil::str_printf_failfast<wil::unique_cotaskmem_string>(format, wistd::forward<args_t>(args)...);
-        TraceLoggingWrite(
-            g_hSearchPlatformCoreProvider,
-            "SearchProviderError",
-            TraceLoggingLevel(WINEVENT_LEVEL_ERROR),
-            TraceLoggingWideString(str.get(), "Message"));
-        OnErrorReported(str.get());
+        FormatMessageAndInvoke([this](const wchar_t* message) {
+            TraceLoggingWrite(
+                g_hSearchPlatformCoreProvider,
+                "SearchProviderError",
+                TraceLoggingLevel(WINEVENT_LEVEL_ERROR),
+                TraceLoggingWideString(message, "Message"));
+            OnErrorReported(message);
+        }, format, wistd::forward<args_t>(args)...);
     }
 
     template <typename... args_t>
     static void LogInfo(_Printf_format_string_ const wchar_t* format, args_t&&... args)
     {
-        auto str = wil::str_printf_failfast<wil::unique_cotaskmem_string>(format, wistd::forward<args_t>(args)...);
-        TraceLoggingWrite(
-            g_hSearchPlatformCoreProvider,
-            "SearchProviderInfo",
-            TraceLoggingLevel(WINEVENT_LEVEL_INFO),
-            TraceLoggingWideString(str.get(), "Message"));
-        wprintf(L"[INFO] %ls\r\n", str.get());
-        OutputDebugStringW(L"[INFO] ");
-        OutputDebugStringW(str.get());
-        OutputDebugStringW(L"\n");
+        FormatMessageAndInvoke([](const wchar_t* message) {
+            TraceLoggingWrite(
+                g_hSearchPlatformCoreProvider,
+                "SearchProviderInfo",
+                TraceLoggingLevel(WINEVENT_LEVEL_INFO),
+                TraceLoggingWideString(message, "Message"));
+            wprintf(L"[INFO] %ls\r\n", message);
+            OutputDebugStringW(L"[INFO] ");
+            OutputDebugStringW(message);
+            OutputDebugStringW(L"\n");
+        }, format, wistd::forward<args_t>(args)...);
     }
 
     template <typename... args_t>
     static void LogError(_Printf_format_string_ const wchar_t* format, args_t&&... args)
     {
+        FormatMessageAndInvoke([](const wchar_t* message) {
+            TraceLoggingWrite(
+                g_hSearchPlatformCoreProvider,
+                "SearchProviderError",
+                TraceLoggingLevel(WINEVENT_LEVEL_ERROR),
+                TraceLoggingWideString(message, "Message"));
+            wprintf(L"[ERROR] %ls\r\n", message);
+            OutputDebugStringW(L"[ERROR] ");
+            OutputDebugStringW(message);
+            OutputDebugStringW(L"\n");
+        }, format, wistd::forward<args_t>(args)...);
+    }
+
+private:
+    // Formats into a stack buffer; only messages longer than the buffer pay for a heap allocation
+    template <typename Func, typename... args_t>
+    static void FormatMessageAndInvoke(Func&& func, _Printf_format_string_ const wchar_t* format, args_t&&... args)
+    {
+        wchar_t buffer[1024];
+        if (_snwprintf_s(buffer, _TRUNCATE, format, args...) >= 0)
+        {
+            func(buffer);
+            return;
+        }
+
         auto str = wil::str_printf_failfast<wil::unique_cotaskmem_string>(format, wistd::forward<args_t>(args)...);
-        TraceLoggingWrite(
-            g_hSearchPlatformCoreProvider,
-            "SearchProviderError",
-            TraceLoggingLevel(WINEVENT_LEVEL_ERROR),
-            TraceLoggingWideString(str.get(), "Message"));
-        wprintf(L"[ERROR] %ls\r\n", str.get());
-        OutputDebugStringW(L"[ERROR] ");
-        OutputDebugStringW(str.get());
-        OutputDebugStringW(L"\n");
+        func(str.get());
     }
 
 protected:
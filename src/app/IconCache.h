@@ -2,78 +2,81 @@
 // Adapted from SearchResultImageUriManager pattern (github.com/brflynn/searchapp)
 #pragma once
 
-#include <unordered_map>
+#include <functional>
+#include <memory>
+#include <optional>
 #include <string>
-#include <wil/resource.h>
+#include <SearchThumbnailPipeline.h>
 #include <winrt/Windows.Storage.h>
 #include <winrt/Windows.Storage.FileProperties.h>
 
-struct IconCache
+// Loads shell thumbnails through the Storage APIs; runs on the pipeline's worker threads
+class StorageThumbnailLoader
+    : public wsearch::IThumbnailLoader<winrt::Windows::Storage::FileProperties::StorageItemThumbnail>
 {
-    winrt::Windows::Storage::FileProperties::StorageItemThumbnail
-    GetOrLoadThumbnail(const std::wstring& filePath, bool isFolder)
+public:
+    using Thumbnail = winrt::Windows::Storage::FileProperties::StorageItemThumbnail;
+
+    void OnWorkerThreadStarted() override
     {
-        // Check cache first
+        winrt::init_apartment(winrt::apartment_type::multi_threaded);
+    }
+
+    void OnWorkerThreadStopping() override
+    {
+        winrt::uninit_apartment();
+    }
+
+    std::optional<Thumbnail> Load(const wsearch::ThumbnailRequest& request) override
+    {
+        Thumbnail thumb{ nullptr };
+        if (request.isFolder)
         {
-            auto lock = m_cs.lock();
-            if (isFolder)
-            {
-                if (m_folderThumbnail != nullptr)
-                    return m_folderThumbnail;
-            }
-            else
-            {
-                auto dot = filePath.rfind(L'.');
-                if (dot != std::wstring::npos)
-                {
-                    auto ext = filePath.substr(dot);
-                    auto it = m_extCache.find(ext);
-                    if (it != m_extCache.end())
-                        return it->second;
-                }
-            }
+            auto folder = winrt::Windows::Storage::StorageFolder::GetFolderFromPathAsync(
+                winrt::hstring(request.path)).get();
+            thumb = folder.GetThumbnailAsync(
+                winrt::Windows::Storage::FileProperties::ThumbnailMode::ListView, 24).get();
         }
-
-        // Cache miss - load the thumbnail (called on background thread)
-        try
+        else
         {
-            if (isFolder)
-            {
-                auto folder = winrt::Windows::Storage::StorageFolder::GetFolderFromPathAsync(
-                    winrt::hstring(filePath)).get();
-                auto thumb = folder.GetThumbnailAsync(
-                    winrt::Windows::Storage::FileProperties::ThumbnailMode::ListView, 24).get();
+            auto file = winrt::Windows::Storage::StorageFile::GetFileFromPathAsync(
+                winrt::hstring(request.path)).get();
+            thumb = file.GetThumbnailAsync(
+                winrt::Windows::Storage::FileProperties::ThumbnailMode::ListView, 24).get();
+        }
 
-                auto lock = m_cs.lock();
-                m_folderThumbnail = thumb;
-                return thumb;
-            }
-            else
+        if (thumb == nullptr)
+            return std::nullopt;
+        return thumb;
+    }
+};
+
+struct IconCache
+{
+    using Thumbnail = StorageThumbnailLoader::Thumbnail;
+
+    IconCache()
+        : m_pipeline(std::make_shared<StorageThumbnailLoader>())
+    {
+    }
+
+    // Never blocks. Returns the cached thumbnail, or nullptr while it loads (or if it can't be
+    // loaded); in the loading case onLoaded fires later on a worker thread with the thumbnail.
+    Thumbnail RequestThumbnail(const std::wstring& filePath, bool isFolder,
+        std::function<void(Thumbnail)> onLoaded)
+    {
+        auto lookup = m_pipeline.Request(filePath, isFolder,
+            [onLoaded = std::move(onLoaded)](const std::optional<Thumbnail>& thumb)
             {
-                auto file = winrt::Windows::Storage::StorageFile::GetFileFromPathAsync(
-                    winrt::hstring(filePath)).get();
-                auto thumb = file.GetThumbnailAsync(
-                    winrt::Windows::Storage::FileProperties::ThumbnailMode::ListView, 24).get();
+                if (thumb && onLoaded)
+                    onLoaded(*thumb);
+            });
 
-                auto dot = filePath.rfind(L'.');
-                if (dot != std::wstring::npos)
-                {
-                    auto ext = filePath.substr(dot);
-                    auto lock = m_cs.lock();
-                    m_extCache.emplace(ext, thumb);
-                }
-                return thumb;
-            }
-        }
-        catch (...)
-        {
-            return nullptr;
-        }
+        if (lookup.status == wsearch::ThumbnailStatus::Ready)
+            return *lookup.image;
+        return nullptr;
     }
 
 private:
-    std::unordered_map<std::wstring,
-        winrt::Windows::Storage::FileProperties::StorageItemThumbnail> m_extCache;
-    winrt::Windows::Storage::FileProperties::StorageItemThumbnail m_folderThumbnail{ nullptr };
-    wil::critical_section m_cs;
+    wsearch::ThumbnailPipeline<Thumbnail> m_pipeline;
 };
@@ -7,6 +7,7 @@
 
 #include "IconCache.h"
 #include <SearchSessions.h>
+#include <SearchFilePath.h>
 #include <shellapi.h>
 #include <propkey.h>
 
@@ -47,28 +48,12 @@ namespace
         return kind.find(L"folder") != std::wstring::npos;
     }
 
-    std::wstring UrlToFilePath(const std::wstring& url)
+    void SetImageThumbnail(controls::Image const& image,
+        winrt::Windows::Storage::FileProperties::StorageItemThumbnail const& thumbnail)
     {
-        std::wstring path = url;
-        if (path.find(L"file:///") == 0)
-            path = path.substr(8);
-        else if (path.find(L"file://") == 0)
-            path = path.substr(7);
-        std::replace(path.begin(), path.end(), L'/', L'\\');
-        // Decode %XX
-        std::wstring decoded;
-        for (size_t i = 0; i < path.length(); ++i)
-        {
-            if (path[i] == L'%' && i + 2 < path.length())
-            {
-                wchar_t ch = static_cast<wchar_t>(std::wcstol(path.substr(i + 1, 2).c_str(), nullptr, 16));
-                decoded += ch;
-                i += 2;
-            }
-            else
-                decoded += path[i];
-        }
-        return decoded;
+        imaging::BitmapImage bmp;
+        bmp.SetSource(thumbnail.CloneStream());
+        image.Source(bmp);
     }
 
     media::SolidColorBrush MakeBrush(uint8_t a, uint8_t r, uint8_t g, uint8_t b)
@@ -134,6 +119,9 @@ namespace winrt::SearchApp::implementation
         {
             m_searchSession = std::make_unique<wsearch::SearchAsYouTypeSession>(
                 std::vector<std::wstring>{ L"file:" });
+
+            // Keep one- and two-letter prefixes from scanning every property in the index
+            m_searchSession->SetQueryCostPolicy(wsearch::QueryCostPolicy{});
         }
         catch (...)
         {
@@ -217,7 +205,7 @@ namespace winrt::SearchApp::implementation
     controls::Grid MainWindow::CreateResultItemVisual(
         const std::wstring& name,
         const std::wstring& path,
-        winrt::Windows::Storage::FileProperties::StorageItemThumbnail thumbnail)
+        bool isFolder)
     {
         auto grid = controls::Grid();
         grid.ColumnSpacing(12);
@@ -244,12 +232,19 @@ namespace winrt::SearchApp::implementation
         image.Width(24);
         image.Height(24);
         image.VerticalAlignment(xaml::VerticalAlignment::Center);
+
+        // Cached icons are set right away; on a miss the slot stays empty until the icon
+        // cache's workers load it, so one new extension never holds up the result list
+        auto thumbnail = g_iconCache.RequestThumbnail(path, isFolder,
+            [dispatcher = DispatcherQueue(), image](IconCache::Thumbnail loaded)
+            {
+                dispatcher.TryEnqueue([image, loaded]()
+                {
+                    SetImageThumbnail(image, loaded);
+                });
+            });
         if (thumbnail)
-        {
-            imaging::BitmapImage bmp;
-            bmp.SetSource(thumbnail.CloneStream());
-            image.Source(bmp);
-        }
+            SetImageThumbnail(image, thumbnail);
         controls::Grid::SetColumn(image, 0);
         controls::Grid::SetRowSpan(image, 2);
         grid.Children().Append(image);
@@ -370,7 +365,6 @@ namespace winrt::SearchApp::implementation
             std::wstring name;
             std::wstring path;
             bool isFolder;
-            winrt::Windows::Storage::FileProperties::StorageItemThumbnail thumb;
         };
 
         try
@@ -399,15 +393,12 @@ namespace winrt::SearchApp::implementation
 
                     auto name = GetStringProp(propStore.get(), PKEY_ItemNameDisplay);
                     auto url = GetStringProp(propStore.get(), PKEY_ItemUrl);
-                    auto path = UrlToFilePath(url);
+                    auto path = wsearch::FileUrlToPath(url);
                     bool isFolder = IsKindFolder(propStore.get());
 
                     if (name.empty() || path.empty()) return;
 
-                    // Get icon from per-extension cache (background thread)
-                    auto thumbnail = g_iconCache.GetOrLoadThumbnail(path, isFolder);
-
-                    results.push_back({ name, path, isFolder, thumbnail });
+                    results.push_back({ name, path, isFolder });
                 });
 
             // Switch to UI thread to build visual tree
@@ -421,7 +412,7 @@ namespace winrt::SearchApp::implementation
 
             for (auto& r : results)
             {
-                auto visual = CreateResultItemVisual(r.name, r.path, r.thumb);
+                auto visual = CreateResultItemVisual(r.name, r.path, r.isFolder);
                 items.Append(visual);
             }
 
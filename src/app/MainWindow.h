@@ -21,7 +21,7 @@ namespace winrt::SearchApp::implementation
         winrt::Microsoft::UI::Xaml::Controls::Grid CreateResultItemVisual(
             const std::wstring& name,
             const std::wstring& path,
-            winrt::Windows::Storage::FileProperties::StorageItemThumbnail thumbnail);
+            bool isFolder);
 
         // Event handlers
         void OnSearchTextChanged(winrt::Windows::Foundation::IInspectable const&,
@@ -84,6 +84,9 @@ namespace winrt::SearchApp::implementation
             m_searchSession = std::make_unique<wsearch::SearchAsYouTypeSession>(
                 std::vector<std::wstring>{ L"file:" }
             );
+
+            // Keep one- and two-letter prefixes from scanning every property in the index
+            m_searchSession->SetQueryCostPolicy(wsearch::QueryCostPolicy{});
         }
         catch (...)
         {
@@ -166,6 +169,7 @@ namespace winrt::SearchApp::implementation
     {
         auto lifetime = get_strong();
         winrt::apartment_context ui_thread;
+        auto dispatcher = DispatcherQueue();
 
         co_await winrt::resume_background();
 
@@ -205,16 +209,27 @@ namespace winrt::SearchApp::implementation
 
                     if (name.empty() || path.empty()) return;
 
-                    // Get thumbnail from the per-extension icon cache
-                    auto thumbnail = g_iconCache.GetOrLoadThumbnail(path, isFolder);
-
-                    auto item = winrt::make<implementation::SearchResultItem>(
+                    auto item = winrt::make_self<implementation::SearchResultItem>(
                         winrt::hstring(name),
                         winrt::hstring(path),
                         isFolder,
-                        thumbnail
+                        nullptr
                     );
-                    items.Append(item);
+
+                    // Cached icons are used right away; misses show the placeholder and
+                    // fill in when the icon cache's workers finish loading them
+                    auto thumbnail = g_iconCache.RequestThumbnail(path, isFolder,
+                        [dispatcher, item](IconCache::Thumbnail loaded)
+                        {
+                            dispatcher.TryEnqueue([item, loaded]()
+                            {
+                                item->SetThumbnail(loaded);
+                            });
+                        });
+                    if (thumbnail)
+                        item->SetThumbnail(thumbnail);
+
+                    items.Append(*item);
                     resultCount++;
                 });
 
@@ -31,4 +31,22 @@ namespace winrt::SearchApp::implementation
         }
         return bitmapImage;
     }
+
+    void SearchResultItem::SetThumbnail(
+        Windows::Storage::FileProperties::StorageItemThumbnail thumbnail)
+    {
+        m_thumbnail = std::move(thumbnail);
+        m_propertyChanged(*this, Microsoft::UI::Xaml::Data::PropertyChangedEventArgs{ L"ItemImage" });
+    }
+
+    winrt::event_token SearchResultItem::PropertyChanged(
+        Microsoft::UI::Xaml::Data::PropertyChangedEventHandler const& handler)
+    {
+        return m_propertyChanged.add(handler);
+    }
+
+    void SearchResultItem::PropertyChanged(winrt::event_token const& token) noexcept
+    {
+        m_propertyChanged.remove(token);
+    }
 }
@@ -3,6 +3,7 @@
 
 #include <winrt/Windows.Storage.FileProperties.h>
 #include <winrt/Microsoft.UI.Xaml.Media.Imaging.h>
+#include <winrt/Microsoft.UI.Xaml.Data.h>
 
 namespace winrt::SearchApp::implementation
 {
@@ -27,11 +28,18 @@ namespace winrt::SearchApp::implementation
         bool IsFolder();
         Microsoft::UI::Xaml::Media::Imaging::BitmapImage ItemImage();
 
+        // Swap the placeholder for the real icon; call on the UI thread
+        void SetThumbnail(Windows::Storage::FileProperties::StorageItemThumbnail thumbnail);
+
+        winrt::event_token PropertyChanged(Microsoft::UI::Xaml::Data::PropertyChangedEventHandler const& handler);
+        void PropertyChanged(winrt::event_token const& token) noexcept;
+
     private:
         hstring m_displayName;
         hstring m_filePath;
         bool m_isFolder{ false };
         Windows::Storage::FileProperties::StorageItemThumbnail m_thumbnail{ nullptr };
+        winrt::event<Microsoft::UI::Xaml::Data::PropertyChangedEventHandler> m_propertyChanged;
     };
 }
 
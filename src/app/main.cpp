@@ -1,10 +1,13 @@
 // SearchApp - Win32 full-screen overlay search using SearchPlatAPI
 #include "pch.h"
 #include "SearchSessions.h"
+#include "SearchRowsetPageSource.h"
+#include "SearchFilePath.h"
 
 // ─── Constants ───────────────────────────────────────────────────────────────
 static constexpr UINT WM_SEARCH_RESULTS = WM_APP + 1;
 static constexpr UINT WM_TRAYICON       = WM_APP + 2;
+static constexpr UINT WM_RESULTS_CHANGED = WM_APP + 3; // wParam = query generation
 static constexpr int IDC_SEARCHBOX = 101;
 static constexpr int IDC_LISTVIEW  = 102;
 static constexpr int IDC_STATUS    = 103;
@@ -12,7 +15,9 @@ static constexpr int IDM_EXIT      = 200;
 static constexpr int HOTKEY_ID     = 1;
 static constexpr int SEARCH_BOX_HEIGHT = 48;
 static constexpr int CONTENT_WIDTH = 900;
-static constexpr int MAX_RESULTS   = 200;
+static constexpr int RESULT_PAGE_SIZE = 64;  // rows decoded per read while scrolling
+static constexpr int RESULT_PREFETCH_PAGES = 2;
+static constexpr int RESULT_RESIDENT_PAGES = 8;
 static constexpr BYTE OVERLAY_ALPHA = 128; // 50% opacity
 
 // Dark theme colors
@@ -49,7 +54,11 @@ static WNDPROC g_origEditProc = nullptr;
 static NOTIFYICONDATAW g_nid{};
 static bool g_overlayVisible = false;
 
-static std::vector<ResultItem> g_results;
+using ResultCursor = wsearch::ResultCursor<ResultItem>;
+static std::unique_ptr<ResultCursor> g_results; // open result set, decoded a page at a time
+static int g_selectedRow = -1;                  // selected row in g_results
+static std::wstring g_selectedPath;             // its path, kept in case its page is evicted
+static bool g_openWhenDecoded = false;          // Enter was pressed before the path was known
 static std::unique_ptr<wsearch::SearchAsYouTypeSession> g_searchSession;
 static std::atomic<uint64_t> g_queryGeneration{ 0 };
 
@@ -102,32 +111,6 @@ static int GetIconIndex(const std::wstring& filePath, bool isFolder)
     return idx;
 }
 
-// ─── URL → file path converter ──────────────────────────────────────────────
-static std::wstring UrlToFilePath(const std::wstring& url)
-{
-    std::wstring s = url;
-    if (s.find(L"file:///") == 0)      s = s.substr(8);
-    else if (s.find(L"file://") == 0)  s = s.substr(7);
-    std::replace(s.begin(), s.end(), L'/', L'\\');
-    // Decode %XX
-    std::wstring out;
-    out.reserve(s.size());
-    for (size_t i = 0; i < s.size(); ++i)
-    {
-        if (s[i] == L'%' && i + 2 < s.size())
-        {
-            wchar_t hex[3] = { s[i + 1], s[i + 2], 0 };
-            out += static_cast<wchar_t>(wcstol(hex, nullptr, 16));
-            i += 2;
-        }
-        else
-        {
-            out += s[i];
-        }
-    }
-    return out;
-}
-
 static std::wstring GetParentDir(const std::wstring& path)
 {
     auto pos = path.rfind(L'\\');
@@ -158,22 +141,31 @@ static bool IsKindFolder(IPropertyStore* ps)
 }
 
 // ─── Search execution ────────────────────────────────────────────────────────
-static void PostSearchResults(uint64_t generation, std::vector<ResultItem> items)
+static void PostSearchResults(uint64_t generation, std::unique_ptr<ResultCursor> cursor)
 {
     // Allocate on heap, the WM handler will delete
-    auto* data = new std::pair<uint64_t, std::vector<ResultItem>>(generation, std::move(items));
+    auto* data = new std::pair<uint64_t, std::unique_ptr<ResultCursor>>(generation, std::move(cursor));
     PostMessageW(g_hwndMain, WM_SEARCH_RESULTS, 0, reinterpret_cast<LPARAM>(data));
 }
 
+static bool DecodeResultItem(IPropertyStore* ps, ResultItem& item)
+{
+    item.displayName = GetStringProp(ps, PKEY_ItemNameDisplay);
+    item.filePath = wsearch::FileUrlToPath(GetStringProp(ps, PKEY_ItemUrl));
+    item.parentDir = GetParentDir(item.filePath);
+    item.isFolder = IsKindFolder(ps);
+    return !item.displayName.empty();
+}
+
 static void ExecuteSearch(const std::wstring& text, uint64_t generation)
 {
     if (!g_searchSession) return;
 
-    std::vector<ResultItem> items;
+    std::unique_ptr<ResultCursor> cursor;
 
     if (text.empty())
     {
-        PostSearchResults(generation, std::move(items));
+        PostSearchResults(generation, std::move(cursor));
         return;
     }
 
@@ -187,54 +179,99 @@ static void ExecuteSearch(const std::wstring& text, uint64_t generation)
         }
         if (!rowset)
         {
-            PostSearchResults(generation, std::move(items));
+            PostSearchResults(generation, std::move(cursor));
             return;
         }
 
-        winrt::com_ptr<IGetRow> getRow;
-        THROW_IF_FAILED(rowset->QueryInterface(IID_PPV_ARGS(getRow.put())));
+        // Keep the rowset open and decode rows as the list view scrolls to them. Only the first
+        // page is read here; the cursor's worker reads the rest on demand.
+        wsearch::ResultCursorOptions options;
+        options.pageSize = RESULT_PAGE_SIZE;
+        options.prefetchPages = RESULT_PREFETCH_PAGES;
+        options.maxResidentPages = RESULT_RESIDENT_PAGES;
 
-        DBCOUNTITEM rowCount = 0;
-        HROW rowBuffer[MAX_RESULTS];
-        HROW* pRows = rowBuffer;
-        THROW_IF_FAILED(rowset->GetNextRows(DB_NULL_HCHAPTER, 0, MAX_RESULTS, &rowCount, &pRows));
+        cursor = std::make_unique<ResultCursor>(
+            std::make_unique<wsearch::RowsetPageSource<ResultItem>>(std::move(rowset), DecodeResultItem),
+            options,
+            [generation]() { PostMessageW(g_hwndMain, WM_RESULTS_CHANGED, static_cast<WPARAM>(generation), 0); });
 
-        for (DBCOUNTITEM i = 0; i < rowCount && generation == g_queryGeneration.load(); ++i)
-        {
-            winrt::com_ptr<IUnknown> unk;
-            if (FAILED(getRow->GetRowFromHROW(nullptr, rowBuffer[i], __uuidof(IPropertyStore), unk.put())))
-                continue;
-
-            auto ps = unk.as<IPropertyStore>();
-            ResultItem item;
-            item.displayName = GetStringProp(ps.get(), PKEY_ItemNameDisplay);
-            std::wstring urlPath = GetStringProp(ps.get(), PKEY_ItemUrl);
-            item.filePath = UrlToFilePath(urlPath);
-            item.parentDir = GetParentDir(item.filePath);
-            item.isFolder = IsKindFolder(ps.get());
-
-            if (!item.displayName.empty())
-                items.push_back(std::move(item));
-        }
-
-        rowset->ReleaseRows(rowCount, pRows, nullptr, nullptr, nullptr);
+        if (generation == g_queryGeneration.load())
+            cursor->ReadFirstPage();
     }
     catch (...) { /* swallow search errors */ }
 
-    PostSearchResults(generation, std::move(items));
+    PostSearchResults(generation, std::move(cursor));
+}
+
+// Destroying a cursor joins its worker, which may be inside IRowset::GetNextRows; do that on
+// a thread of its own so replacing the results never stalls the UI
+static void ReleaseResultsAsync(std::unique_ptr<ResultCursor> cursor)
+{
+    if (!cursor) return;
+    std::thread([cursor = std::move(cursor)]() mutable
+    {
+        winrt::init_apartment(winrt::apartment_type::multi_threaded);
+        cursor.reset();
+    }).detach();
+}
+
+static void SetResults(std::unique_ptr<ResultCursor> cursor)
+{
+    std::swap(g_results, cursor);
+    ReleaseResultsAsync(std::move(cursor));
+    g_selectedRow = -1;
+    g_selectedPath.clear();
+    g_openWhenDecoded = false;
+}
+
+// Copies the selected row's path while it is decoded. If it isn't, VisitRow queues its page
+// and WM_RESULTS_CHANGED calls this again once pages arrive.
+static void RememberSelectedRow(int row)
+{
+    if (row != g_selectedRow)
+    {
+        g_selectedRow = row;
+        g_selectedPath.clear();
+        g_openWhenDecoded = false;
+    }
+    if (row < 0 || !g_results || !g_selectedPath.empty()) return;
+
+    g_results->VisitRow(row, [&](const ResultItem& item) { g_selectedPath = item.filePath; });
+}
+
+// Item count grows as the cursor discovers rows; "+" until the end of the rowset is reached
+static void UpdateResultCount()
+{
+    size_t count = g_results ? g_results->GetKnownRowCount() : 0;
+    bool complete = !g_results || g_results->IsComplete();
+    ListView_SetItemCountEx(g_hwndList, static_cast<int>(count), LVSICF_NOINVALIDATEALL | LVSICF_NOSCROLL);
+
+    wchar_t status[128];
+    double ms = g_searchSession ? g_searchSession->GetLastQueryDurationMs() : 0.0;
+    swprintf_s(status, L"%zu%ls results (%.1f ms)", count, complete ? L"" : L"+", ms);
+    SetWindowTextW(g_hwndStatus, status);
 }
 
 // ─── Open a result ───────────────────────────────────────────────────────────
 static void OpenSelectedResult()
 {
     int sel = ListView_GetNextItem(g_hwndList, -1, LVNI_SELECTED);
-    if (sel < 0 || sel >= static_cast<int>(g_results.size())) return;
+    if (sel < 0 || !g_results) return;
 
-    const auto& item = g_results[sel];
-    ShellExecuteW(nullptr, L"open", item.filePath.c_str(), nullptr, nullptr, SW_SHOWNORMAL);
+    RememberSelectedRow(sel);
+    if (g_selectedPath.empty())
+    {
+        // The row's page was evicted or not read yet; it is opened when the page arrives
+        g_openWhenDecoded = true;
+        return;
+    }
+    g_openWhenDecoded = false;
+    std::wstring filePath = g_selectedPath;
+
+    ShellExecuteW(nullptr, L"open", filePath.c_str(), nullptr, nullptr, SW_SHOWNORMAL);
 
     if (g_searchSession)
-        g_searchSession->TrackResultClick(item.filePath);
+        g_searchSession->TrackResultClick(filePath);
 }
 
 // ─── Show / hide overlay ─────────────────────────────────────────────────────
@@ -245,7 +282,7 @@ static void ShowOverlay()
 
     // Clear previous search state
     SetWindowTextW(g_hwndSearch, L"");
-    g_results.clear();
+    SetResults(nullptr);
     ListView_SetItemCountEx(g_hwndList, 0, 0);
     SetWindowTextW(g_hwndStatus, L"Type to search");
 
@@ -394,7 +431,7 @@ static LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp)
 
             if (searchText.empty())
             {
-                g_results.clear();
+                SetResults(nullptr);
                 ListView_SetItemCountEx(g_hwndList, 0, 0);
                 SetWindowTextW(g_hwndStatus, L"Type to search");
             }
@@ -408,27 +445,41 @@ static LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp)
 
     case WM_SEARCH_RESULTS:
     {
-        auto* data = reinterpret_cast<std::pair<uint64_t, std::vector<ResultItem>>*>(lp);
+        auto* data = reinterpret_cast<std::pair<uint64_t, std::unique_ptr<ResultCursor>>*>(lp);
         if (data->first == g_queryGeneration.load())
         {
-            g_results = std::move(data->second);
-            ListView_SetItemCountEx(g_hwndList, static_cast<int>(g_results.size()), LVSICF_NOINVALIDATEALL);
+            SetResults(std::move(data->second));
+            ListView_SetItemCountEx(g_hwndList, 0, 0);
+            UpdateResultCount();
             InvalidateRect(g_hwndList, nullptr, TRUE);
 
-            wchar_t status[128];
-            double ms = g_searchSession ? g_searchSession->GetLastQueryDurationMs() : 0.0;
-            swprintf_s(status, L"%zu results (%.1f ms)", g_results.size(), ms);
-            SetWindowTextW(g_hwndStatus, status);
-
-            if (!g_results.empty())
+            if (ListView_GetItemCount(g_hwndList) > 0)
             {
                 ListView_SetItemState(g_hwndList, 0, LVIS_SELECTED | LVIS_FOCUSED, LVIS_SELECTED | LVIS_FOCUSED);
             }
         }
+        ReleaseResultsAsync(std::move(data->second)); // superseded
         delete data;
         return 0;
     }
 
+    case WM_RESULTS_CHANGED:
+        // A page arrived from the cursor's worker; ignore pages from superseded queries
+        if (static_cast<uint64_t>(wp) == g_queryGeneration.load() && g_results)
+        {
+            UpdateResultCount();
+            InvalidateRect(g_hwndList, nullptr, FALSE);
+
+            if (g_selectedRow >= 0 && g_selectedPath.empty() &&
+                static_cast<size_t>(g_selectedRow) < g_results->GetKnownRowCount())
+            {
+                RememberSelectedRow(g_selectedRow);
+                if (g_openWhenDecoded && !g_selectedPath.empty())
+                    OpenSelectedResult();
+            }
+        }
+        return 0;
+
     case WM_NOTIFY:
     {
         auto* nmhdr = reinterpret_cast<NMHDR*>(lp);
@@ -440,13 +491,41 @@ static LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp)
             {
                 auto* di = reinterpret_cast<NMLVDISPINFOW*>(lp);
                 int idx = di->item.iItem;
-                if (idx < 0 || idx >= static_cast<int>(g_results.size())) break;
+                if (idx < 0 || !g_results) break;
 
-                const auto& item = g_results[idx];
-                if (di->item.mask & LVIF_TEXT)
-                    di->item.pszText = const_cast<LPWSTR>(item.displayName.c_str());
-                if (di->item.mask & LVIF_IMAGE)
-                    di->item.iImage = GetIconIndex(item.filePath, item.isFolder);
+                // Rows that aren't decoded yet draw blank and are repainted when their page arrives
+                std::wstring filePath;
+                bool isFolder = false;
+                bool decoded = g_results->VisitRow(idx, [&](const ResultItem& item)
+                {
+                    if ((di->item.mask & LVIF_TEXT) && di->item.pszText && di->item.cchTextMax > 0)
+                        wcsncpy_s(di->item.pszText, di->item.cchTextMax, item.displayName.c_str(), _TRUNCATE);
+                    filePath = item.filePath;
+                    isFolder = item.isFolder;
+                });
+
+                if (!decoded && (di->item.mask & LVIF_TEXT) && di->item.pszText && di->item.cchTextMax > 0)
+                    di->item.pszText[0] = L'\0';
+                if (decoded && (di->item.mask & LVIF_IMAGE))
+                    di->item.iImage = GetIconIndex(filePath, isFolder);
+                break;
+            }
+
+            case LVN_ITEMCHANGED:
+            {
+                // Selected rows are usually on screen and decoded; keep the path before the page goes
+                auto* change = reinterpret_cast<NMLISTVIEW*>(lp);
+                if ((change->uChanged & LVIF_STATE) && (change->uNewState & LVIS_SELECTED) && change->iItem >= 0)
+                    RememberSelectedRow(change->iItem);
+                break;
+            }
+
+            case LVN_ODCACHEHINT:
+            {
+                // Visible range changed: decode it and read ahead of it
+                auto* hint = reinterpret_cast<NMLVCACHEHINT*>(lp);
+                if (g_results && hint->iFrom >= 0 && hint->iTo >= hint->iFrom)
+                    g_results->SetViewport(hint->iFrom, hint->iTo);
                 break;
             }
 
@@ -470,10 +549,11 @@ static LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp)
                 case CDDS_ITEMPOSTPAINT:
                 {
                     int idx = static_cast<int>(cd->nmcd.dwItemSpec);
-                    if (idx < 0 || idx >= static_cast<int>(g_results.size())) break;
+                    if (idx < 0 || !g_results) break;
 
-                    const auto& item = g_results[idx];
-                    if (item.parentDir.empty()) break;
+                    std::wstring parentDir;
+                    g_results->VisitRow(idx, [&](const ResultItem& item) { parentDir = item.parentDir; });
+                    if (parentDir.empty()) break;
 
                     RECT rcItem;
                     ListView_GetItemRect(g_hwndList, idx, &rcItem, LVIR_LABEL);
@@ -482,7 +562,7 @@ static LRESULT CALLBACK MainWndProc(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp)
                     HFONT oldFont = reinterpret_cast<HFONT>(SelectObject(cd->nmcd.hdc, g_hFontSmall));
                     SetTextColor(cd->nmcd.hdc, CLR_TEXTDIM);
                     SetBkMode(cd->nmcd.hdc, TRANSPARENT);
-                    DrawTextW(cd->nmcd.hdc, item.parentDir.c_str(), -1, &rcItem,
+                    DrawTextW(cd->nmcd.hdc, parentDir.c_str(), -1, &rcItem,
                         DT_LEFT | DT_SINGLELINE | DT_END_ELLIPSIS | DT_NOPREFIX);
                     SelectObject(cd->nmcd.hdc, oldFont);
                     break;
@@ -688,6 +768,11 @@ int WINAPI wWinMain(HINSTANCE hInst, HINSTANCE, LPWSTR, int)
             std::vector<std::wstring>{},
             std::vector<std::wstring>{ L"System.ItemNameDisplay", L"System.Kind" },
             std::chrono::milliseconds(50));
+
+        // Results are paged in as the list scrolls, so no TOP N; the other rewrites still apply
+        wsearch::QueryCostPolicy costPolicy;
+        costPolicy.autoTopN = 0;
+        g_searchSession->SetQueryCostPolicy(costPolicy);
     }
     catch (winrt::hresult_error const& ex)
     {
@@ -715,9 +800,11 @@ int WINAPI wWinMain(HINSTANCE hInst, HINSTANCE, LPWSTR, int)
         DispatchMessageW(&msg);
     }
 
-    // Cleanup
+    // Cleanup; the UI is gone, so joining the cursor's worker here stalls nothing
     Shell_NotifyIconW(NIM_DELETE, &g_nid);
+    g_results.reset();
     g_searchSession.reset();
+    wsearch::details::ShutdownSharedIndexCountService();
     if (g_hImageList) ImageList_Destroy(g_hImageList);
     DeleteObject(g_hBgBrush);
     DeleteObject(g_hEditBrush);
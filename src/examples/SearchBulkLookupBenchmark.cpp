@@ -0,0 +1,160 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Bulk property lookup benchmark
+//
+// Looks up the properties of a list of known paths through BulkPropertyLookup against a fake
+// source that charges what an indexer statement costs: a fixed round trip (data source,
+// session, command, execute), a cost per predicate, and a cost that grows with the square of
+// the OR chain, with at most --indexer-threads statements served at once. Compares one query per
+// path (the only way before) with chunked lookups across a range of chunk sizes, which is how
+// the BulkLookupOptions defaults were picked. Portable; on Linux build and run with:
+//
+//   g++ -std=c++17 -O2 -pthread -I../api SearchBulkLookupBenchmark.cpp -o bulkbench && ./bulkbench
+//   ./bulkbench --paths 5000 --round-trip-us 1500 --missing 20
+
+#include <SearchBulkLookup.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    struct CostModel
+    {
+        std::chrono::microseconds roundTrip{ 2000 };
+        double perPredicateUs = 20.0;
+        double orChainUs = 0.15; // times predicates squared
+        size_t indexerThreads = 4;
+    };
+
+    class FakeIndexerSource : public wsearch::IBulkLookupSource<int64_t>
+    {
+    public:
+        FakeIndexerSource(const std::vector<std::wstring>& indexed, CostModel cost)
+            : m_cost(cost)
+        {
+            for (size_t i = 0; i < indexed.size(); ++i)
+            {
+                m_items[wsearch::details::ItemUrlLookupKey(indexed[i])] = static_cast<int64_t>(i);
+            }
+        }
+
+        void ExecuteLookup(const std::wstring& sql, const EmitRow& emit) override
+        {
+            static const std::wstring predicate = L"System.ItemUrl = '";
+            std::vector<std::wstring> urls;
+            for (size_t pos = sql.find(predicate); pos != std::wstring::npos; pos = sql.find(predicate, pos))
+            {
+                pos += predicate.size();
+                size_t end = sql.find(L'\'', pos);
+                urls.push_back(sql.substr(pos, end - pos));
+            }
+
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.wait(lock, [this] { return m_running < m_cost.indexerThreads; });
+                ++m_running;
+            }
+
+            double n = static_cast<double>(urls.size());
+            std::this_thread::sleep_for(m_cost.roundTrip +
+                std::chrono::microseconds(static_cast<int64_t>(n * m_cost.perPredicateUs + n * n * m_cost.orChainUs)));
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                --m_running;
+            }
+            m_cv.notify_one();
+
+            for (const auto& url : urls)
+            {
+                auto item = m_items.find(wsearch::details::ItemUrlLookupKey(url));
+                if (item != m_items.end())
+                {
+                    emit(url, int64_t(item->second));
+                }
+            }
+        }
+
+    private:
+        CostModel m_cost;
+        std::unordered_map<std::wstring, int64_t> m_items;
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        size_t m_running = 0;
+    };
+
+    void Run(const char* label, const std::vector<std::wstring>& paths, const std::shared_ptr<FakeIndexerSource>& source,
+        const wsearch::BulkLookupOptions& options, double baselineMs)
+    {
+        wsearch::BulkPropertyLookup<int64_t> lookup(source, { L"System.Size", L"System.Kind", L"System.DateModified" }, options);
+        auto start = Clock::now();
+        auto result = lookup.Lookup(paths);
+        double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        std::printf("%-22s %8zu %8zu %10.1f %12.0f %8zu", label, options.maxPathsPerQuery, result.queries, ms,
+            paths.size() * 1000.0 / ms, result.missing);
+        if (baselineMs > 0)
+        {
+            std::printf(" %8.1fx", baselineMs / ms);
+        }
+        std::printf("\n");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    size_t pathCount = 1000;
+    size_t missingPercent = 10; // 1 in (100 / missingPercent)
+    CostModel cost;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string arg = argv[i];
+        if (arg == "--paths") pathCount = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (arg == "--missing") missingPercent = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (arg == "--round-trip-us") cost.roundTrip = std::chrono::microseconds(std::strtoll(argv[i + 1], nullptr, 10));
+        else if (arg == "--indexer-threads") cost.indexerThreads = std::strtoull(argv[i + 1], nullptr, 10);
+    }
+
+    // Every tenth requested path (by default) is not in the index
+    std::vector<std::wstring> paths;
+    std::vector<std::wstring> indexed;
+    for (size_t i = 0; i < pathCount; ++i)
+    {
+        std::wstring path = L"C:\\Users\\me\\Documents\\Projects\\report-" + std::to_wstring(i) + L".docx";
+        if (missingPercent == 0 || i % (100 / missingPercent) != 0)
+        {
+            indexed.push_back(path);
+        }
+        paths.push_back(std::move(path));
+    }
+    auto source = std::make_shared<FakeIndexerSource>(indexed, cost);
+
+    std::printf("%zu paths; statement cost %lld us + %.0f us/predicate + %.2f us/predicate^2, %zu served at once\n\n",
+        pathCount, static_cast<long long>(cost.roundTrip.count()), cost.perPredicateUs, cost.orChainUs, cost.indexerThreads);
+    std::printf("%-22s %8s %8s %10s %12s %8s %9s\n", "lookup", "chunk", "queries", "ms", "paths/s", "missing", "speedup");
+
+    wsearch::BulkLookupOptions perPath;
+    perPath.maxPathsPerQuery = 1;
+    perPath.maxConcurrentQueries = 1;
+    auto start = Clock::now();
+    wsearch::BulkPropertyLookup<int64_t>(source, { L"System.Size" }, perPath).Lookup(paths);
+    double baselineMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    std::printf("%-22s %8d %8zu %10.1f %12.0f\n", "per-path (before)", 1, pathCount, baselineMs, pathCount * 1000.0 / baselineMs);
+
+    for (size_t chunk : { 1, 8, 16, 32, 64, 128, 256, 512 })
+    {
+        wsearch::BulkLookupOptions options;
+        options.maxPathsPerQuery = chunk;
+        Run(chunk == wsearch::BulkLookupOptions{}.maxPathsPerQuery ? "bulk (default)" : "bulk", paths, source, options, baselineMs);
+    }
+    return 0;
+}
@@ -0,0 +1,140 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Crawl scope check benchmark
+//
+// Measures in-memory crawl scope checks with CrawlScopeRuleSet: the default client rules plus
+// a number of user rules, checked against generated paths of the kind a file browser badges
+// (documents, AppData caches, start menu links, other drives). Reports checks per second for
+// single checks, for CrawlScopeRuleEvaluator (which checks the rule version each call) and for
+// AreIncluded batches, next to how long building the snapshot takes.
+// Portable; on Linux build and run with:
+//
+//   g++ -std=c++17 -O2 -pthread -I../api SearchCrawlScopeBenchmark.cpp -o scopebench && ./scopebench
+//   ./scopebench --paths 2000000 --user-rules 500
+
+#include <SearchCrawlScopeRules.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    class StaticRuleSource : public wsearch::ICrawlScopeRuleSource
+    {
+    public:
+        explicit StaticRuleSource(std::vector<wsearch::CrawlScopeRule> rules)
+            : m_rules(std::move(rules))
+        {
+        }
+
+        std::vector<wsearch::CrawlScopeRule> ReadRules() override
+        {
+            return m_rules;
+        }
+
+        uint64_t GetRulesVersion() override
+        {
+            return 1;
+        }
+
+    private:
+        std::vector<wsearch::CrawlScopeRule> m_rules;
+    };
+
+    std::vector<wsearch::CrawlScopeRule> BuildRules(size_t userRules)
+    {
+        std::vector<wsearch::CrawlScopeRule> rules = {
+            { L"file:///C:\\Users\\*", true, true },
+            { L"file:///C:\\Users\\*\\AppData\\*", false, true },
+            { L"file:///C:\\Users\\*\\AppData\\Roaming\\Microsoft\\Windows\\Start Menu\\*", true, true },
+            { L"file:///C:\\ProgramData\\Microsoft\\Windows\\Start Menu\\*", true, true },
+            { L"file:///C:\\Users\\*\\*.tmp", false, true },
+        };
+        for (size_t i = 0; i < userRules; ++i)
+        {
+            rules.push_back({ L"file:///C:\\Users\\user" + std::to_wstring(i % 8) + L"\\Projects\\repo" + std::to_wstring(i) + L"\\",
+                i % 3 != 0, false });
+        }
+        return rules;
+    }
+
+    std::vector<std::wstring> BuildPaths(size_t count)
+    {
+        static const wchar_t* folders[] = {
+            L"C:\\Users\\user%zu\\Documents\\Reports\\2024\\report-%zu.docx",
+            L"C:\\Users\\user%zu\\AppData\\Local\\Packages\\cache\\blob-%zu.bin",
+            L"C:\\Users\\user%zu\\AppData\\Roaming\\Microsoft\\Windows\\Start Menu\\Programs\\app-%zu.lnk",
+            L"C:\\Users\\user%zu\\Projects\\repo%zu\\src\\main.cpp",
+            L"D:\\Media\\Photos\\%zu\\IMG_%zu.jpg",
+            L"C:\\Users\\user%zu\\Desktop\\draft-%zu.tmp",
+        };
+        std::vector<std::wstring> paths;
+        paths.reserve(count);
+        wchar_t buffer[260];
+        for (size_t i = 0; i < count; ++i)
+        {
+            std::swprintf(buffer, 260, folders[i % 6], i % 8, i % 997);
+            paths.emplace_back(buffer);
+        }
+        return paths;
+    }
+
+    template <typename Check>
+    double ChecksPerSecond(const std::vector<std::wstring>& paths, size_t& included, Check check)
+    {
+        included = 0;
+        auto start = Clock::now();
+        for (const auto& path : paths)
+        {
+            included += check(path) ? 1 : 0;
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        return paths.size() / seconds;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    size_t pathCount = 1000000;
+    size_t userRules = 100;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string arg = argv[i];
+        if (arg == "--paths") pathCount = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (arg == "--user-rules") userRules = std::strtoull(argv[i + 1], nullptr, 10);
+    }
+
+    auto rules = BuildRules(userRules);
+    auto paths = BuildPaths(pathCount);
+
+    auto buildStart = Clock::now();
+    wsearch::CrawlScopeRuleSet ruleSet(rules);
+    double buildMs = std::chrono::duration<double, std::milli>(Clock::now() - buildStart).count();
+
+    wsearch::CrawlScopeRuleEvaluator evaluator(std::make_shared<StaticRuleSource>(rules));
+
+    std::printf("%zu rules (snapshot built in %.2f ms), %zu paths\n\n", rules.size(), buildMs, paths.size());
+    std::printf("%-28s %16s %10s\n", "check", "checks/s", "included");
+
+    size_t included = 0;
+    double perSecond = ChecksPerSecond(paths, included, [&](const std::wstring& path) { return ruleSet.IsIncluded(path); });
+    std::printf("%-28s %16.0f %10zu\n", "CrawlScopeRuleSet", perSecond, included);
+
+    perSecond = ChecksPerSecond(paths, included, [&](const std::wstring& path) { return evaluator.IsIncluded(path); });
+    std::printf("%-28s %16.0f %10zu\n", "evaluator, per call", perSecond, included);
+
+    auto batchStart = Clock::now();
+    auto batch = evaluator.AreIncluded(paths);
+    double batchSeconds = std::chrono::duration<double>(Clock::now() - batchStart).count();
+    included = 0;
+    for (bool value : batch)
+    {
+        included += value ? 1 : 0;
+    }
+    std::printf("%-28s %16.0f %10zu\n", "evaluator, AreIncluded", paths.size() / batchSeconds, included);
+    return 0;
+}
@@ -0,0 +1,101 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Deadline query simulator
+//
+// Runs the same stream of queries with injected Execute, fetch and decode latency against each
+// deadline, through DeadlineQuery on a virtual clock, and prints one line per deadline: how
+// often the first results were partial and in which stage the deadline caught the query, what
+// share of the rows arrived on time, and how long background refinement took after the
+// deadline. Deterministic for a given seed; nothing sleeps. Portable; on Linux build and run
+// with:
+//
+//   g++ -std=c++17 -O2 -pthread -I../api -I../test SearchDeadlineSimulatorTool.cpp -o deadlinesim && ./deadlinesim
+//
+// Options:
+//   --queries N            queries per deadline (default 20000)
+//   --seed N               latency seed (default 0xDEAD11)
+//   --execute-us N         fixed Execute latency (default 8000)
+//   --jitter-us N          mean exponential Execute latency on top of it (default 6000)
+//   --spike-probability X  share of queries whose Execute stalls (default 0.05)
+//   --spike-us N           length of a stall (default 80000)
+//   --fetch-us N           latency of each GetNextRows call (default 400)
+//   --decode-us N          latency of decoding one row (default 120)
+//   --min-rows N           fewest rows a query finds (default 20)
+//   --max-rows N           most rows a query finds (default 200)
+//   --background 0|1       refine partial results in the background (default 1)
+
+#include "SearchDeadlineSimulator.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    SearchTestUtilities::DeadlineSimulationOptions options;
+    options.queries = 20000;
+    auto& latency = options.latency;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string name = argv[i];
+        std::string value = argv[i + 1];
+        if (name == "--queries")
+        {
+            options.queries = std::stoul(value);
+        }
+        else if (name == "--seed")
+        {
+            options.seed = std::stoull(value, nullptr, 0);
+        }
+        else if (name == "--execute-us")
+        {
+            latency.executeLatency = std::chrono::microseconds(std::stoll(value));
+        }
+        else if (name == "--jitter-us")
+        {
+            latency.executeJitter = std::chrono::microseconds(std::stoll(value));
+        }
+        else if (name == "--spike-probability")
+        {
+            latency.spikeProbability = std::stod(value);
+        }
+        else if (name == "--spike-us")
+        {
+            latency.spikeLatency = std::chrono::microseconds(std::stoll(value));
+        }
+        else if (name == "--fetch-us")
+        {
+            latency.fetchLatency = std::chrono::microseconds(std::stoll(value));
+        }
+        else if (name == "--decode-us")
+        {
+            latency.decodeLatency = std::chrono::microseconds(std::stoll(value));
+        }
+        else if (name == "--min-rows")
+        {
+            latency.minRows = std::stoul(value);
+        }
+        else if (name == "--max-rows")
+        {
+            latency.maxRows = std::stoul(value);
+        }
+        else if (name == "--background")
+        {
+            options.continueInBackground = std::stoi(value) != 0;
+        }
+        else
+        {
+            std::cerr << "Unknown option: " << name << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<std::chrono::microseconds> deadlines;
+    for (int deadline : { 5, 10, 15, 20, 30, 50, 75, 100, 150 })
+    {
+        deadlines.push_back(std::chrono::milliseconds(deadline));
+    }
+
+    auto results = SearchTestUtilities::DeadlineSimulator::SweepDeadlines(options, deadlines);
+    std::wcout << SearchTestUtilities::DeadlineSimulator::FormatReport(results);
+    return 0;
+}
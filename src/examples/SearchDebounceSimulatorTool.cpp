@@ -0,0 +1,74 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Debounce policy simulator
+//
+// Replays one synthetic typist against the sessions' Debouncer in virtual time for each
+// debounce delay and prints one line per delay: queries sent per search, how many of them were
+// stale by the time they finished, how long after the last keystroke results settled and how
+// long the user waited for them. Deterministic for a given seed; nothing sleeps. Portable; on
+// Linux build and run with:
+//
+//   g++ -std=c++17 -O2 -pthread -I../api -I../test SearchDebounceSimulatorTool.cpp -o debouncesim && ./debouncesim
+//
+// Options:
+//   --phrases N          searches typed per delay (default 100000)
+//   --seed N             typist seed (default 0xDEB0)
+//   --key-ms X           mean gap between keystrokes (default 120)
+//   --think-ms X         mean pause before reading the results (default 600)
+//   --latency-us N       fixed query latency (default 20000)
+//   --jitter-us N        mean exponential query latency on top of it (default 10000)
+
+#include "SearchDebounceSimulator.h"
+#include <iostream>
+#include <string>
+#include <vector>
+
+int main(int argc, char* argv[])
+{
+    SearchTestUtilities::DebounceSimulationOptions options;
+    options.phrases = 100000;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string name = argv[i];
+        std::string value = argv[i + 1];
+        if (name == "--phrases")
+        {
+            options.phrases = std::stoul(value);
+        }
+        else if (name == "--seed")
+        {
+            options.seed = std::stoull(value, nullptr, 0);
+        }
+        else if (name == "--key-ms")
+        {
+            options.typing.meanKeyIntervalMs = std::stod(value);
+        }
+        else if (name == "--think-ms")
+        {
+            options.typing.meanThinkTimeMs = std::stod(value);
+        }
+        else if (name == "--latency-us")
+        {
+            options.queryLatency = std::chrono::microseconds(std::stoll(value));
+        }
+        else if (name == "--jitter-us")
+        {
+            options.queryLatencyJitter = std::chrono::microseconds(std::stoll(value));
+        }
+        else
+        {
+            std::cerr << "Unknown option: " << name << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<std::chrono::milliseconds> delays;
+    for (int delay : { 0, 10, 25, 50, 75, 100, 150, 200, 300 })
+    {
+        delays.push_back(std::chrono::milliseconds(delay));
+    }
+
+    auto results = SearchTestUtilities::DebounceSimulator::SweepDelays(options, delays);
+    std::wcout << SearchTestUtilities::DebounceSimulator::FormatReport(results);
+    return 0;
+}
@@ -0,0 +1,246 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Expected vs. exceptions benchmark
+//
+// Runs the shape of the query path (data source, session, command, execute, REUSEWHERE lookup,
+// row fetch) against fake COM steps that fail at a configurable rate, two ways: the throwing API
+// (THROW_IF_FAILED per step, the catch/log/rethrow that ExecuteQuery used to have, and the
+// debounce thread's catch) and the Try* functions returning SearchExpected. Reports queries per
+// second for each on one thread and on several, since unwinding takes process-wide locks on
+// some runtimes. Portable; on Linux build and run with:
+//
+//   g++ -std=c++17 -O2 -pthread -I../api SearchExpectedBenchmark.cpp -o expectedbench && ./expectedbench
+//   ./expectedbench --failure-rate 25 --threads 8 --queries 200000
+
+#include <SearchExpected.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+// Keep each layer a real call, as the COM boundary and the API layers are
+#if defined(_MSC_VER)
+#define BENCH_NOINLINE __declspec(noinline)
+#else
+#define BENCH_NOINLINE __attribute__((noinline))
+#endif
+
+namespace
+{
+    constexpr int32_t c_failed = static_cast<int32_t>(0x80040E14); // DB_E_ERRORSINCOMMAND
+    constexpr int c_steps = 6;
+
+    std::atomic<uint64_t> g_loggedErrors{ 0 };
+
+    // Stands in for TelemetryProvider::LogError; counted so it can't be optimized away
+    void LogError(const wchar_t*, int32_t)
+    {
+        g_loggedErrors.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // A COM call: some work, then S_OK or the injected failure. 'failAt' is the step that fails
+    // for this query, or c_steps when it succeeds.
+    BENCH_NOINLINE int32_t FakeComCall(int step, int failAt, uint64_t& work)
+    {
+        for (int i = 0; i < 16; ++i)
+        {
+            work = work * 6364136223846793005ull + 1442695040888963407ull;
+        }
+        return step == failAt ? c_failed : 0;
+    }
+
+    // --- The throwing API ---------------------------------------------------------------------
+
+    struct HResultException : std::exception
+    {
+        explicit HResultException(int32_t hr)
+            : code(hr)
+        {
+        }
+        int32_t code;
+    };
+
+    void ThrowIfFailed(int32_t hr)
+    {
+        if (hr < 0)
+        {
+            throw HResultException(hr);
+        }
+    }
+
+    BENCH_NOINLINE uint64_t ExecuteQueryThrowing(int failAt)
+    {
+        uint64_t work = 1;
+        try
+        {
+            for (int step = 0; step < c_steps - 2; ++step)
+            {
+                int32_t hr = FakeComCall(step, failAt, work);
+                if (hr < 0)
+                {
+                    LogError(L"step failed", hr);
+                    ThrowIfFailed(hr);
+                }
+            }
+        }
+        catch (...)
+        {
+            LogError(L"Exception during query execution", 0);
+            throw;
+        }
+        return work;
+    }
+
+    BENCH_NOINLINE uint64_t SearchThrowing(int failAt)
+    {
+        uint64_t work = ExecuteQueryThrowing(failAt);
+        ThrowIfFailed(FakeComCall(c_steps - 2, failAt, work)); // REUSEWHERE lookup
+        ThrowIfFailed(FakeComCall(c_steps - 1, failAt, work)); // GetNextRows
+        return work;
+    }
+
+    // What the debounce thread does with one query
+    bool RunThrowing(int failAt, uint64_t& sink)
+    {
+        try
+        {
+            sink += SearchThrowing(failAt);
+            return true;
+        }
+        catch (...)
+        {
+            return false;
+        }
+    }
+
+    // --- The Try* API -------------------------------------------------------------------------
+
+    BENCH_NOINLINE wsearch::SearchExpected<uint64_t> TryExecuteQuery(int failAt)
+    {
+        static const wchar_t* operations[] = { L"CoCreateInstance(CollatorDataSource)", L"IDBInitialize::Initialize",
+            L"IDBCreateSession::CreateSession", L"ICommandText::Execute" };
+        uint64_t work = 1;
+        for (int step = 0; step < c_steps - 2; ++step)
+        {
+            int32_t hr = FakeComCall(step, failAt, work);
+            if (hr < 0)
+            {
+                LogError(L"step failed", hr);
+                return wsearch::SearchError{ hr, operations[step] };
+            }
+        }
+        return work;
+    }
+
+    BENCH_NOINLINE wsearch::SearchExpected<uint64_t> TrySearch(int failAt)
+    {
+        auto rowset = TryExecuteQuery(failAt);
+        if (!rowset)
+        {
+            return rowset.Error();
+        }
+        uint64_t work = *rowset;
+        if (auto whereId = wsearch::details::CheckHResult(FakeComCall(c_steps - 2, failAt, work), L"IRowsetInfo::GetProperties"); !whereId)
+        {
+            return whereId.Error();
+        }
+        if (auto rows = wsearch::details::CheckHResult(FakeComCall(c_steps - 1, failAt, work), L"IRowset::GetNextRows"); !rows)
+        {
+            return rows.Error();
+        }
+        return work;
+    }
+
+    bool RunExpected(int failAt, uint64_t& sink)
+    {
+        auto result = TrySearch(failAt);
+        if (!result)
+        {
+            LogError(result.Error().operation, result.Error().code);
+            return false;
+        }
+        sink += *result;
+        return true;
+    }
+
+    // Which step fails for each query: c_steps (none) for all but 'failurePercent' of them
+    std::vector<int> BuildFailurePlan(size_t queries, unsigned failurePercent)
+    {
+        std::vector<int> plan(queries, c_steps);
+        uint32_t seed = 0xfa11;
+        for (auto& failAt : plan)
+        {
+            seed = seed * 1103515245u + 12345u;
+            if ((seed >> 16) % 100 < failurePercent)
+            {
+                seed = seed * 1103515245u + 12345u;
+                failAt = static_cast<int>((seed >> 16) % c_steps);
+            }
+        }
+        return plan;
+    }
+
+    template <typename Run>
+    double QueriesPerSecond(const std::vector<int>& plan, unsigned threads, Run run, size_t& failures)
+    {
+        std::atomic<size_t> failed{ 0 };
+        std::atomic<uint64_t> sink{ 0 };
+        auto start = Clock::now();
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([&, t]() {
+                uint64_t localSink = 0;
+                size_t localFailed = 0;
+                for (size_t i = t; i < plan.size(); i += threads)
+                {
+                    localFailed += run(plan[i], localSink) ? 0 : 1;
+                }
+                failed += localFailed;
+                sink += localSink;
+            });
+        }
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        failures = failed.load();
+        return sink.load() == 0 ? 0.0 : plan.size() / seconds;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    size_t queries = 500000;
+    unsigned failurePercent = 10;
+    unsigned threads = (std::max)(2u, std::thread::hardware_concurrency());
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string arg = argv[i];
+        if (arg == "--queries") queries = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (arg == "--failure-rate") failurePercent = std::strtoul(argv[i + 1], nullptr, 10);
+        else if (arg == "--threads") threads = std::strtoul(argv[i + 1], nullptr, 10);
+    }
+
+    auto plan = BuildFailurePlan(queries, failurePercent);
+    std::printf("%zu queries, %u%% failing at a random step\n\n", queries, failurePercent);
+    std::printf("%-12s %8s %16s %16s %9s\n", "path", "threads", "queries/s", "failed", "speedup");
+
+    for (unsigned threadCount : { 1u, threads })
+    {
+        size_t throwingFailures = 0, expectedFailures = 0;
+        double throwing = QueriesPerSecond(plan, threadCount, RunThrowing, throwingFailures);
+        double expected = QueriesPerSecond(plan, threadCount, RunExpected, expectedFailures);
+        std::printf("%-12s %8u %16.0f %16zu\n", "exceptions", threadCount, throwing, throwingFailures);
+        std::printf("%-12s %8u %16.0f %16zu %8.1fx\n", "expected", threadCount, expected, expectedFailures, expected / throwing);
+    }
+    return 0;
+}
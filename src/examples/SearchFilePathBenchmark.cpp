@@ -0,0 +1,169 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// File URL decoding benchmark
+//
+// Compares the decoder the app and SearchResult used to carry (prefix substr copies, a
+// std::replace pass, and a temporary string per %XX escape) with DecodeFileUrl writing into a
+// reused buffer and with FileUrlToPath returning a fresh std::wstring. The URLs mimic
+// System.ItemUrl values: mostly escape-free, some with %20, some with escaped UTF-8 names.
+// --escaped sets the percentage of URLs with escapes.
+// Portable; on Linux build and run with:
+//
+//   g++ -std=c++17 -O2 -I../api SearchFilePathBenchmark.cpp -o pathbench && ./pathbench
+//   ./pathbench --urls 200000 --escaped 50 --passes 10
+
+#include <SearchFilePath.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cwchar>
+#include <random>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    // The decoder as it was in SearchResult::GetFilePathForTracking
+    std::wstring LegacyUrlToFilePath(const std::wstring& value)
+    {
+        std::wstring url = value;
+        if (url.find(L"file:///") == 0)
+        {
+            url = url.substr(8);
+        }
+        else if (url.find(L"file://") == 0)
+        {
+            url = url.substr(7);
+        }
+        std::replace(url.begin(), url.end(), L'/', L'\\');
+
+        std::wstring decoded;
+        for (size_t i = 0; i < url.length(); ++i)
+        {
+            if (url[i] == L'%' && i + 2 < url.length())
+            {
+                std::wstring hex = url.substr(i + 1, 2);
+                decoded += static_cast<wchar_t>(std::wcstol(hex.c_str(), nullptr, 16));
+                i += 2;
+            }
+            else
+            {
+                decoded += url[i];
+            }
+        }
+        return decoded;
+    }
+
+    std::vector<std::wstring> MakeUrls(size_t count, unsigned escapedPercent)
+    {
+        static const wchar_t* const folders[] = { L"Documents/Reports/2024", L"Pictures/Camera Roll", L"source/repos/wsearch/src/api", L"Downloads", L"OneDrive/Shared/Projects/Planning" };
+        static const wchar_t* const escapedNames[] = { L"Quarterly%20report", L"caf%C3%A9%20menu", L"%E4%B8%AD%E6%96%87%20notes", L"photo%20%F0%9F%98%80" };
+
+        std::mt19937 random(42);
+        std::vector<std::wstring> urls;
+        urls.reserve(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            std::wstring url = L"file:///C:/Users/me/";
+            url += folders[random() % (sizeof(folders) / sizeof(folders[0]))];
+            url += L'/';
+            if (random() % 100 < escapedPercent)
+            {
+                url += escapedNames[random() % (sizeof(escapedNames) / sizeof(escapedNames[0]))];
+            }
+            else
+            {
+                url += L"QuarterlyReport";
+            }
+            url += std::to_wstring(i);
+            url += L".docx";
+            urls.push_back(std::move(url));
+        }
+        return urls;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    size_t urlCount = 100000;
+    unsigned escapedPercent = 20;
+    size_t passes = 5;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string arg = argv[i];
+        if (arg == "--urls") urlCount = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (arg == "--escaped") escapedPercent = static_cast<unsigned>(std::strtoul(argv[i + 1], nullptr, 10));
+        else if (arg == "--passes") passes = std::strtoull(argv[i + 1], nullptr, 10);
+    }
+
+    auto urls = MakeUrls(urlCount, escapedPercent);
+    size_t totalChars = 0;
+    size_t longest = 0;
+    for (const auto& url : urls)
+    {
+        totalChars += url.size();
+        longest = (std::max)(longest, url.size());
+    }
+
+    size_t legacyChecksum = 0;
+    auto start = Clock::now();
+    for (size_t pass = 0; pass < passes; ++pass)
+    {
+        for (const auto& url : urls)
+        {
+            legacyChecksum += LegacyUrlToFilePath(url).size();
+        }
+    }
+    double legacyMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    size_t stringChecksum = 0;
+    start = Clock::now();
+    for (size_t pass = 0; pass < passes; ++pass)
+    {
+        for (const auto& url : urls)
+        {
+            stringChecksum += wsearch::FileUrlToPath(url).size();
+        }
+    }
+    double stringMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    std::vector<wchar_t> buffer(longest);
+    size_t bufferChecksum = 0;
+    start = Clock::now();
+    for (size_t pass = 0; pass < passes; ++pass)
+    {
+        for (const auto& url : urls)
+        {
+            size_t length = wsearch::DecodeFileUrl(url, buffer.data());
+            bufferChecksum += length + buffer[length / 2];
+        }
+    }
+    double bufferMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    // The legacy decoder splits UTF-8 names into one character per byte, so only the
+    // escape-free lengths agree
+    if (escapedPercent == 0 && legacyChecksum != stringChecksum)
+    {
+        std::printf("decoders disagree\n");
+        return 1;
+    }
+
+    double mb = static_cast<double>(totalChars * passes * sizeof(wchar_t)) / (1024.0 * 1024.0);
+    double conversions = static_cast<double>(urlCount * passes);
+    std::printf("%zu URLs (%u%% escaped), average %zu characters, %zu passes%s\n\n", urlCount, escapedPercent, totalChars / (std::max<size_t>)(urlCount, 1), passes,
+#if defined(WSEARCH_FILE_URL_SSE2)
+        ", SSE2"
+#else
+        ", scalar"
+#endif
+    );
+    std::printf("%-30s %10s %12s %10s\n", "decoder", "total ms", "ns/URL", "MB/s");
+    std::printf("%-30s %10.2f %12.1f %10.0f\n", "legacy (substr/replace/wcstol)", legacyMs, legacyMs * 1e6 / conversions, mb * 1000 / legacyMs);
+    std::printf("%-30s %10.2f %12.1f %10.0f\n", "FileUrlToPath (std::wstring)", stringMs, stringMs * 1e6 / conversions, mb * 1000 / stringMs);
+    std::printf("%-30s %10.2f %12.1f %10.0f\n", "DecodeFileUrl (caller buffer)", bufferMs, bufferMs * 1e6 / conversions, mb * 1000 / bufferMs);
+    std::printf("\nchecksums %zu %zu %zu\n", legacyChecksum, stringChecksum, bufferChecksum);
+    return 0;
+}
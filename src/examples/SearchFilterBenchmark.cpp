@@ -0,0 +1,396 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Filter pushdown benchmark
+//
+// A fake indexer holds --items files (kind, extension, size, modified time, one topic word).
+// Sessions type a topic (or nothing) and then add and remove filters the way users refine a
+// result list: mostly selective ones (ext:png, kind:video, size:>100MB), some that keep most
+// rows (-ext:tmp, size:>0, modified:<2030-01-01). Each step shows the best --top rows and is run
+// three ways:
+//
+//   client:   fetch every match unfiltered and filter client-side (no TOP possible)
+//   push:     every predicate in the WHERE clause, TOP N
+//   planner:  FilterPlanner decides; unfiltered fetches are cached per search text and answer
+//             later steps when they hold enough rows
+//
+// Every strategy also reuses the rows of an identical earlier query. The fake indexer scans its
+// items in memory, so the "indexer" times show the shape, not the cost, of the indexer's work;
+// rows transferred are decoded into a SearchValuePage like a real rowset fetch. All three must
+// return the same rows. Portable; on Linux build and run with:
+//
+//   g++ -std=c++17 -O2 -I../api SearchFilterBenchmark.cpp -o filterbench && ./filterbench
+//   ./filterbench --items 200000 --sessions 200 --top 50
+
+#include <SearchFilters.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    // Wednesday 2024-03-13 15:00 UTC
+    constexpr uint64_t c_now = 133548660000000000ull;
+    constexpr size_t c_topics = 40;
+
+    struct FakeItem
+    {
+        std::wstring url;
+        std::wstring kind;
+        std::wstring extension;
+        int64_t size;
+        int64_t modified;
+        uint32_t topic;
+        int32_t rank;
+    };
+
+    struct FetchResult
+    {
+        std::vector<uint32_t> items; // by rank
+        bool complete = true;        // every match returned
+    };
+
+    class FakeIndexer
+    {
+    public:
+        explicit FakeIndexer(size_t items)
+        {
+            struct Type
+            {
+                const wchar_t* kind;
+                const wchar_t* extension;
+                unsigned weight;
+                int64_t typicalSize;
+            };
+            static const Type types[] = {
+                { L"document", L".docx", 14, 40000 }, { L"document", L".pdf", 10, 400000 }, { L"document", L".txt", 8, 4000 },
+                { L"picture", L".png", 8, 300000 }, { L"picture", L".jpg", 12, 2500000 }, { L"music", L".mp3", 6, 5000000 },
+                { L"video", L".mp4", 3, 300000000 }, { L"program", L".exe", 3, 2000000 }, { L"folder", L"", 12, 0 },
+                { L"document", L".tmp", 4, 2000 }, { L"link", L".lnk", 2, 1500 }, { L"document", L".xlsx", 6, 60000 },
+            };
+            unsigned totalWeight = 0;
+            for (const auto& type : types)
+            {
+                totalWeight += type.weight;
+            }
+
+            std::mt19937 random(7);
+            std::lognormal_distribution<double> sizeSpread(0.0, 1.5);
+            std::exponential_distribution<double> ageDays(1.0 / 500.0);
+            m_items.reserve(items);
+            for (size_t i = 0; i < items; ++i)
+            {
+                unsigned pick = random() % totalWeight;
+                const Type* type = types;
+                while (pick >= type->weight)
+                {
+                    pick -= type->weight;
+                    ++type;
+                }
+                FakeItem item;
+                item.url = L"file:C:/Users/me/Files/item" + std::to_wstring(i) + type->extension;
+                item.kind = type->kind;
+                item.extension = type->extension;
+                item.size = static_cast<int64_t>(static_cast<double>(type->typicalSize) * sizeSpread(random));
+                item.modified = static_cast<int64_t>(c_now) - static_cast<int64_t>(ageDays(random) * 864000000000.0);
+                item.topic = static_cast<uint32_t>(random() % c_topics);
+                item.rank = static_cast<int32_t>(random() % 1000);
+                m_items.push_back(std::move(item));
+            }
+        }
+
+        const FakeItem& Get(uint32_t item) const
+        {
+            return m_items[item];
+        }
+
+        // WHERE topic AND pushed ORDER BY rank, TOP fetchLimit (0 = all)
+        FetchResult Execute(int topic, const std::vector<wsearch::FilterPredicate>& pushed, size_t fetchLimit) const
+        {
+            FetchResult result;
+            for (uint32_t i = 0; i < m_items.size(); ++i)
+            {
+                const FakeItem& item = m_items[i];
+                if ((topic < 0 || item.topic == static_cast<uint32_t>(topic)) && Matches(item, pushed))
+                {
+                    result.items.push_back(i);
+                }
+            }
+            auto byRank = [this](uint32_t a, uint32_t b) {
+                return (m_items[a].rank != m_items[b].rank) ? m_items[a].rank > m_items[b].rank : a < b;
+            };
+            if (fetchLimit > 0 && result.items.size() > fetchLimit)
+            {
+                std::partial_sort(result.items.begin(), result.items.begin() + fetchLimit, result.items.end(), byRank);
+                result.items.resize(fetchLimit);
+                result.complete = false;
+            }
+            else
+            {
+                std::sort(result.items.begin(), result.items.end(), byRank);
+            }
+            return result;
+        }
+
+        // What a rowset fetch costs client-side: decoding each returned row
+        void Decode(const std::vector<uint32_t>& items, wsearch::SearchValuePage& page) const
+        {
+            page.ReserveRows(items.size());
+            for (uint32_t index : items)
+            {
+                const FakeItem& item = m_items[index];
+                wsearch::SearchValue* values = page.AddRow();
+                values[0] = wsearch::SearchValue::CopyString(item.url, page.Resource());
+                values[1] = wsearch::SearchValue::FromInt32(item.rank);
+                wsearch::SearchValue kind = wsearch::SearchValue::CopyString(item.kind, page.Resource());
+                values[2] = wsearch::SearchValue::CopyVector(&kind, 1, page.Resource());
+                values[3] = item.extension.empty() ? wsearch::SearchValue() : wsearch::SearchValue::CopyString(item.extension, page.Resource());
+                values[4] = wsearch::SearchValue::FromUInt64(static_cast<uint64_t>(item.size));
+                values[5] = wsearch::SearchValue::FromFileTime(static_cast<uint64_t>(item.modified));
+            }
+        }
+
+    private:
+        static bool Matches(const FakeItem& item, const std::vector<wsearch::FilterPredicate>& predicates)
+        {
+            for (const auto& predicate : predicates)
+            {
+                bool matched = false;
+                switch (predicate.field)
+                {
+                case wsearch::FilterField::Kind: matched = wsearch::details::FilterMatchesText(predicate, item.kind); break;
+                case wsearch::FilterField::Extension: matched = wsearch::details::FilterMatchesText(predicate, item.extension); break;
+                case wsearch::FilterField::Size: matched = wsearch::details::FilterMatchesNumber(predicate, item.size); break;
+                default: matched = wsearch::details::FilterMatchesNumber(predicate, item.modified); break;
+                }
+                if (!matched)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        std::vector<FakeItem> m_items;
+    };
+
+    std::vector<wsearch::PropertyId> PageColumns()
+    {
+        return { wsearch::propid::ItemUrl, wsearch::propid::SearchRank, wsearch::propid::Kind, wsearch::propid::FileExtension,
+            wsearch::propid::Size, wsearch::propid::DateModified };
+    }
+
+    std::vector<wsearch::PropertyId> FilterColumns()
+    {
+        return { wsearch::propid::Kind, wsearch::propid::FileExtension, wsearch::propid::Size, wsearch::propid::DateModified };
+    }
+
+    struct Stats
+    {
+        size_t queries = 0;
+        size_t rowsTransferred = 0;
+        size_t cacheAnswers = 0;
+        double indexerMs = 0;
+        double clientMs = 0;
+    };
+
+    std::wstring QueryKey(int topic, const std::vector<wsearch::FilterPredicate>& pushed, size_t fetchLimit)
+    {
+        std::wstring key = std::to_wstring(topic) + L"|" + std::to_wstring(fetchLimit);
+        for (const auto& predicate : pushed)
+        {
+            key += L"|" + predicate.text;
+        }
+        return key;
+    }
+
+    // Runs one query (or reuses an identical one), decodes it and applies client-side predicates
+    class Strategy
+    {
+    public:
+        explicit Strategy(const FakeIndexer& indexer)
+            : m_indexer(indexer)
+        {
+        }
+
+        struct Fetched
+        {
+            std::vector<uint32_t> items;
+            std::unique_ptr<wsearch::ResultBatch> batch;
+            bool complete = true;
+        };
+
+        const Fetched& Fetch(int topic, const std::vector<wsearch::FilterPredicate>& pushed, size_t fetchLimit, Stats& stats)
+        {
+            std::wstring key = QueryKey(topic, pushed, fetchLimit);
+            auto found = m_fetched.find(key);
+            if (found != m_fetched.end())
+            {
+                return found->second;
+            }
+
+            auto start = Clock::now();
+            FetchResult result = m_indexer.Execute(topic, pushed, fetchLimit);
+            auto executed = Clock::now();
+            wsearch::SearchValuePage page(PageColumns());
+            m_indexer.Decode(result.items, page);
+            Fetched fetched;
+            fetched.batch = std::make_unique<wsearch::ResultBatch>(wsearch::ResultBatch::FromPage(page, FilterColumns()));
+            fetched.items = std::move(result.items);
+            fetched.complete = result.complete;
+            stats.indexerMs += std::chrono::duration<double, std::milli>(executed - start).count();
+            stats.clientMs += std::chrono::duration<double, std::milli>(Clock::now() - executed).count();
+            ++stats.queries;
+            stats.rowsTransferred += fetched.items.size();
+            return m_fetched.emplace(key, std::move(fetched)).first->second;
+        }
+
+        std::vector<uint32_t> Filter(const Fetched& fetched, const std::vector<wsearch::FilterPredicate>& clientSide, size_t top, Stats& stats)
+        {
+            auto start = Clock::now();
+            std::vector<uint32_t> items;
+            for (uint32_t row : wsearch::EvaluateFilters(*fetched.batch, clientSide))
+            {
+                if (items.size() == top)
+                {
+                    break;
+                }
+                items.push_back(fetched.items[row]);
+            }
+            stats.clientMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            return items;
+        }
+
+        void Reset()
+        {
+            m_fetched.clear();
+        }
+
+    private:
+        const FakeIndexer& m_indexer;
+        std::map<std::wstring, Fetched> m_fetched;
+    };
+}
+
+int main(int argc, char** argv)
+{
+    size_t items = 200000;
+    size_t sessions = 200;
+    size_t top = 50;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string arg = argv[i];
+        if (arg == "--items") items = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (arg == "--sessions") sessions = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (arg == "--top") top = std::strtoull(argv[i + 1], nullptr, 10);
+    }
+
+    FakeIndexer indexer(items);
+    wsearch::FilterParseOptions options;
+    options.nowTicks = c_now;
+    const wchar_t* filterPool[] = {
+        L"ext:png", L"kind:video", L"size:>100MB", L"kind:music", L"ext:pdf,docx", L"modified:lastweek", L"size:<4KB",
+        L"kind:document", L"kind:picture", L"modified:thisyear",
+        L"-ext:tmp", L"size:>0", L"modified:<2030-01-01", L"-kind:folder",
+    };
+
+    Stats client;
+    Stats push;
+    Stats planned;
+    Strategy clientStrategy(indexer);
+    Strategy pushStrategy(indexer);
+    Strategy plannedStrategy(indexer);
+    wsearch::FilterPlanner planner({}, c_now);
+    size_t steps = 0;
+    size_t mismatches = 0;
+    std::mt19937 random(3);
+    for (size_t session = 0; session < sessions; ++session)
+    {
+        // Each session starts from a fresh result list
+        clientStrategy.Reset();
+        pushStrategy.Reset();
+        plannedStrategy.Reset();
+
+        const Strategy::Fetched* unfiltered = nullptr;
+        int topic = (random() % 4 == 0) ? -1 : static_cast<int>(random() % c_topics);
+        std::vector<std::wstring> active;
+        for (size_t step = 0; step < 6; ++step)
+        {
+            // Add a filter, or sometimes take the last one off again
+            if (!active.empty() && random() % 3 == 0)
+            {
+                active.pop_back();
+            }
+            else
+            {
+                active.push_back(filterPool[random() % std::size(filterPool)]);
+            }
+            std::wstring text;
+            for (const auto& filter : active)
+            {
+                text += filter + L" ";
+            }
+            auto predicates = wsearch::ParseSearchFilters(text, options).predicates;
+            ++steps;
+
+            const auto& all = clientStrategy.Fetch(topic, {}, 0, client);
+            auto clientRows = clientStrategy.Filter(all, predicates, top, client);
+
+            const auto& pushedFetch = pushStrategy.Fetch(topic, predicates, top, push);
+            auto pushRows = pushStrategy.Filter(pushedFetch, {}, top, push);
+
+            // The planner may answer from this session's unfiltered fetch
+            wsearch::CachedResultState cache;
+            if (unfiltered)
+            {
+                cache.rowCount = unfiltered->items.size();
+                cache.complete = unfiltered->complete;
+            }
+            auto plan = planner.Plan(predicates, top, cache);
+            const Strategy::Fetched* fetched = unfiltered;
+            if (!plan.fromCache)
+            {
+                fetched = &plannedStrategy.Fetch(topic, plan.pushed, plan.fetchLimit, planned);
+                if (plan.pushed.empty() && (!unfiltered || fetched->items.size() > unfiltered->items.size()))
+                {
+                    unfiltered = fetched;
+                    planner.GetSelectivity().Observe(*fetched->batch);
+                }
+            }
+            else
+            {
+                ++planned.cacheAnswers;
+            }
+            auto plannedRows = plannedStrategy.Filter(*fetched, plan.clientSide, top, planned);
+            if (!fetched->complete && plannedRows.size() < top)
+            {
+                // Fewer rows passed than estimated: fetch again with everything pushed
+                const auto& exact = plannedStrategy.Fetch(topic, predicates, top, planned);
+                plannedRows = plannedStrategy.Filter(exact, {}, top, planned);
+            }
+
+            mismatches += (clientRows != pushRows || plannedRows != pushRows) ? 1 : 0;
+        }
+    }
+
+    std::printf("%zu items, %zu sessions, %zu filter steps, top %zu\n\n", items, sessions, steps, top);
+    std::printf("%-10s %10s %10s %12s %14s %18s %10s\n", "strategy", "queries", "cached", "rows/step", "indexer ms",
+        "decode+filter ms", "ms/step");
+    auto print = [steps](const char* name, const Stats& stats) {
+        std::printf("%-10s %10zu %10zu %12.1f %14.1f %18.1f %10.3f\n", name, stats.queries, stats.cacheAnswers,
+            static_cast<double>(stats.rowsTransferred) / static_cast<double>(steps), stats.indexerMs, stats.clientMs,
+            (stats.indexerMs + stats.clientMs) / static_cast<double>(steps));
+    };
+    print("client", client);
+    print("push", push);
+    print("planner", planned);
+    std::printf("\nsame rows: %s\n", mismatches == 0 ? "yes" : "NO");
+    return mismatches == 0 ? 0 : 1;
+}
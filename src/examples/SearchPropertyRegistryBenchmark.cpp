@@ -0,0 +1,170 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Property registry benchmark
+//
+// Measures name -> id lookups through PropertyRegistry: well-known names through the
+// compile-time perfect hash (canonical and lower-case spellings), and interned names through
+// the registry's map. For comparison it runs the same lookups through an unordered_map keyed
+// by folded name and through a linear case-insensitive scan of the well-known table. It also
+// compares de-duplicating a SELECT list by substring search, as SearchQueryBuilder used to, with
+// de-duplicating by id.
+// Portable; on Linux build and run with:
+//
+//   g++ -std=c++17 -O2 -pthread -I../api SearchPropertyRegistryBenchmark.cpp -o propbench && ./propbench
+//   ./propbench --lookups 20000000
+
+#include <SearchPropertyRegistry.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    std::wstring Fold(std::wstring_view name)
+    {
+        std::wstring folded(name);
+        for (auto& ch : folded)
+        {
+            ch = wsearch::details::FoldPropertyNameChar(ch);
+        }
+        return folded;
+    }
+
+    template <typename Lookup>
+    double NanosecondsPerLookup(const std::vector<std::wstring>& names, size_t lookups, size_t& checksum, Lookup lookup)
+    {
+        checksum = 0;
+        auto start = Clock::now();
+        size_t next = 0;
+        for (size_t i = 0; i < lookups; ++i)
+        {
+            checksum += lookup(names[next]);
+            next = (next + 1 == names.size()) ? 0 : next + 1;
+        }
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / lookups;
+    }
+
+    void Report(const char* name, double nanoseconds, size_t checksum)
+    {
+        std::printf("%-36s %10.1f %14zu\n", name, nanoseconds, checksum);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    size_t lookups = 10000000;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string arg = argv[i];
+        if (arg == "--lookups") lookups = std::strtoull(argv[i + 1], nullptr, 10);
+    }
+
+    wsearch::PropertyRegistry registry;
+    std::unordered_map<std::wstring, wsearch::PropertyId> byFoldedName;
+    std::vector<std::wstring> canonical;
+    std::vector<std::wstring> lowerCase;
+    for (const auto& property : wsearch::details::c_wellKnownProperties)
+    {
+        canonical.emplace_back(property.name);
+        lowerCase.push_back(Fold(property.name));
+        byFoldedName.emplace(Fold(property.name), property.id);
+    }
+
+    std::vector<std::wstring> custom;
+    for (int i = 0; i < 64; ++i)
+    {
+        custom.push_back(L"Contoso.Property" + std::to_wstring(i));
+        byFoldedName.emplace(Fold(custom.back()), registry.Intern(custom.back()));
+    }
+
+    std::printf("%zu well-known names, %zu interned names, %zu lookups each\n\n", canonical.size(), custom.size(), lookups);
+    std::printf("%-36s %10s %14s\n", "lookup", "ns/lookup", "checksum");
+
+    size_t checksum = 0;
+    double ns = NanosecondsPerLookup(canonical, lookups, checksum, [&](const std::wstring& name) { return registry.Find(name); });
+    Report("registry, well-known", ns, checksum);
+    ns = NanosecondsPerLookup(lowerCase, lookups, checksum, [&](const std::wstring& name) { return registry.Find(name); });
+    Report("registry, well-known lower-case", ns, checksum);
+    ns = NanosecondsPerLookup(custom, lookups, checksum, [&](const std::wstring& name) { return registry.Find(name); });
+    Report("registry, interned", ns, checksum);
+
+    ns = NanosecondsPerLookup(canonical, lookups, checksum, [&](const std::wstring& name) { return byFoldedName.find(Fold(name))->second; });
+    Report("unordered_map, well-known", ns, checksum);
+    ns = NanosecondsPerLookup(canonical, lookups, checksum, [&](const std::wstring& name) {
+        for (const auto& property : wsearch::details::c_wellKnownProperties)
+        {
+            if (wsearch::details::PropertyNamesEqual(property.name, name))
+            {
+                return property.id;
+            }
+        }
+        return wsearch::InvalidPropertyId;
+    });
+    Report("linear scan, well-known", ns, checksum);
+
+    // A SELECT list of the eleven default columns plus ten additional properties, five of them repeats
+    std::vector<std::wstring> additional = { L"System.Title", L"System.Author", L"System.Size", L"System.Kind", L"System.Keywords",
+        L"System.Comment", L"System.Title", L"System.ItemPathDisplay", L"System.DateModified", L"System.MIMEType" };
+    std::vector<wsearch::PropertyId> additionalIds;
+    for (const auto& name : additional)
+    {
+        additionalIds.push_back(registry.Intern(name));
+    }
+    const wchar_t* defaults = L"System.ItemUrl, System.Search.Rank, System.Document.LineCount, System.DateAccessed, "
+                              L"System.ItemNameDisplay, System.Kind, System.FileExtension, System.Size, System.DateCreated, "
+                              L"System.DateModified, System.Search.GatherTime";
+
+    size_t rounds = lookups / 100;
+    size_t columns = 0;
+    auto start = Clock::now();
+    for (size_t round = 0; round < rounds; ++round)
+    {
+        std::wstring select(defaults);
+        for (const auto& name : additional)
+        {
+            if (select.find(name) == std::wstring::npos)
+            {
+                select += L", ";
+                select += name;
+            }
+        }
+        columns += select.size();
+    }
+    double substringNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / rounds;
+
+    static constexpr wsearch::PropertyId defaultIds[] = { wsearch::propid::ItemUrl, wsearch::propid::SearchRank,
+        wsearch::propid::DocumentLineCount, wsearch::propid::DateAccessed, wsearch::propid::ItemNameDisplay, wsearch::propid::Kind,
+        wsearch::propid::FileExtension, wsearch::propid::Size, wsearch::propid::DateCreated, wsearch::propid::DateModified,
+        wsearch::propid::SearchGatherTime };
+    size_t idColumns = 0;
+    start = Clock::now();
+    for (size_t round = 0; round < rounds; ++round)
+    {
+        std::wstring select(defaults);
+        wsearch::PropertyIdSet selected;
+        for (auto id : defaultIds)
+        {
+            selected.Insert(id);
+        }
+        for (auto id : additionalIds)
+        {
+            if (selected.Insert(id))
+            {
+                select += L", ";
+                select += registry.GetName(id);
+            }
+        }
+        idColumns += select.size();
+    }
+    double idNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / rounds;
+
+    std::printf("\n%-36s %10s %14s\n", "SELECT list de-duplication", "ns/list", "checksum");
+    Report("substring search", substringNs, columns);
+    Report("PropertyIdSet", idNs, idColumns);
+    return 0;
+}
@@ -0,0 +1,328 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Per-query allocation benchmark
+//
+// Counts heap allocations for one query's pipeline three ways: the original
+// string-concatenation builders, the append-based builders into std::wstring, and the same
+// builders on a QueryArena. Each query builds the priming SQL, plans the text with the cost
+// model, formats the plan for the log, builds the search SQL and copies a page of result rows'
+// strings, each charged to its QueryAllocationStage. Portable; on Linux build and run with:
+//
+//   g++ -std=c++17 -O2 -I../api SearchQueryAllocationBenchmark.cpp -o allocbench && ./allocbench
+
+#include <SearchQueryArena.h>
+#include <SearchQueryCost.h>
+#include <SearchSqlText.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+static size_t g_heapAllocations = 0;
+
+void* operator new(size_t size)
+{
+    ++g_heapAllocations;
+    if (void* p = std::malloc(size ? size : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+// std::pmr::new_delete_resource uses the aligned forms
+void* operator new(size_t size, std::align_val_t alignment)
+{
+    ++g_heapAllocations;
+    size_t align = static_cast<size_t>(alignment);
+    if (void* p = std::aligned_alloc(align, ((size ? size : 1) + align - 1) / align * align))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace legacy
+{
+    // The builders as they were before the append-based rewrite, minus logging
+    std::wstring BuildPrimingSqlFromScopes(
+        const std::vector<std::wstring>& includedScopes,
+        const std::vector<std::wstring>& excludedScopes,
+        const std::vector<std::wstring>& additionalProperties)
+    {
+        std::wstring queryStr(L"SELECT System.ItemUrl");
+        for (const auto& prop : additionalProperties)
+        {
+            queryStr.append(L", ").append(prop);
+        }
+        queryStr += L" FROM SystemIndex WHERE";
+        for (size_t i = 0; i < includedScopes.size(); ++i)
+        {
+            std::wstring scope(includedScopes[i]);
+            std::replace(scope.begin(), scope.end(), L'\\', L'/');
+            if (i == 0)
+            {
+                queryStr += L" (";
+            }
+            queryStr += L" SCOPE='";
+            if (scope.find(L"file:") != 0)
+            {
+                queryStr += L"file:" + scope;
+            }
+            else
+            {
+                queryStr += scope;
+            }
+            queryStr += (i < (includedScopes.size() - 1)) ? L"' OR" : L"')";
+        }
+        for (size_t i = 0; i < excludedScopes.size(); ++i)
+        {
+            std::wstring scope(excludedScopes[i]);
+            std::replace(scope.begin(), scope.end(), L'\\', L'/');
+            queryStr += L" SCOPE <> 'file:";
+            queryStr += excludedScopes[i] + L'\'';
+            if (i < (excludedScopes.size() - 1))
+            {
+                queryStr += L" AND";
+            }
+        }
+        return queryStr;
+    }
+
+    std::wstring BuildSearchWhereClause(std::wstring_view searchText)
+    {
+        if (searchText.empty())
+        {
+            return L"";
+        }
+        std::wstring escapedText{ searchText };
+        size_t pos = 0;
+        while ((pos = escapedText.find(L"'", pos)) != std::wstring::npos)
+        {
+            escapedText.replace(pos, 1, L"''");
+            pos += 2;
+        }
+        bool userQuoted = (escapedText.length() >= 2 && escapedText.front() == L'"' && escapedText.back() == L'"');
+        bool hasSpaces = escapedText.find(L' ') != std::wstring::npos;
+        std::wstring whereClause;
+        if (userQuoted)
+        {
+            whereClause = L" AND CONTAINS(*, '" + escapedText + L"')";
+        }
+        else if (hasSpaces)
+        {
+            std::vector<std::wstring> wordList;
+            std::wstring words = escapedText;
+            size_t start = 0;
+            size_t end = words.find(L' ');
+            while (end != std::wstring::npos)
+            {
+                wordList.push_back(words.substr(start, end - start));
+                start = end + 1;
+                end = words.find(L' ', start);
+            }
+            wordList.push_back(words.substr(start));
+            whereClause = L" AND (CONTAINS(*, '\"" + escapedText + L"\"') RANK BY COERCION(ABSOLUTE, 999) OR CONTAINS(*, '" + escapedText + L"*') RANK BY COERCION(ABSOLUTE, 998) OR (";
+            for (size_t i = 0; i < wordList.size(); ++i)
+            {
+                if (i > 0)
+                {
+                    whereClause += L" AND ";
+                }
+                whereClause += L"CONTAINS(*, '" + wordList[i] + L"*')";
+            }
+            whereClause += L"))";
+        }
+        else
+        {
+            whereClause = L" AND (CONTAINS(System.ItemNameDisplay, '" + escapedText +
+                L"', 1033) RANK BY COERCION(ABSOLUTE, 999) OR CONTAINS(*, '" + escapedText + L"*'))";
+        }
+        return whereClause;
+    }
+
+    std::wstring BuildSearchSql(const std::vector<std::wstring>& additionalProperties, unsigned long whereId, std::wstring_view searchText)
+    {
+        std::wstring whereClause = BuildSearchWhereClause(searchText);
+        std::wstring finalSql = L"SELECT System.ItemUrl";
+        for (const auto& prop : additionalProperties)
+        {
+            finalSql += L", " + prop;
+        }
+        finalSql += L" FROM SystemIndex WHERE REUSEWHERE(" + std::to_wstring(whereId) + L")";
+        finalSql += whereClause;
+        finalSql += L" ORDER BY System.Search.Rank DESC";
+        return finalSql;
+    }
+}
+
+// A page of result rows with a string per property, as a launcher shows them
+struct ResultRowSource
+{
+    std::vector<std::vector<std::wstring>> rows;
+
+    explicit ResultRowSource(size_t rowCount)
+    {
+        for (size_t i = 0; i < rowCount; ++i)
+        {
+            std::wstring name = L"Quarterly budget review " + std::to_wstring(i) + L".docx";
+            rows.push_back({ L"file:C:/Users/user/Documents/Reports/" + name, name, L"2024-03-1" + std::to_wstring(i % 10),
+                std::to_wstring(1000 + i * 37), L"Document" });
+        }
+    }
+};
+
+int main()
+{
+    const std::vector<std::wstring> included = { L"C:\\Users\\user\\Documents", L"C:\\Users\\user\\Desktop", L"D:\\Projects\\Shared Files" };
+    const std::vector<std::wstring> excluded = { L"C:\\Users\\user\\Documents\\Archive" };
+    const std::vector<std::wstring> properties = { L"System.ItemNameDisplay", L"System.DateModified", L"System.Size", L"System.Kind" };
+    const std::vector<std::wstring> searches = { L"r", L"report", L"my quarterly budget review", L"\"exact phrase\"", L"o'brien's notes 2024" };
+    const size_t iterations = 20000;
+    const ResultRowSource results(20);
+    const wsearch::QueryCostModel model;
+
+    using Stage = wsearch::QueryAllocationStage;
+    constexpr size_t stageCount = wsearch::QueryAllocationStageCount;
+    auto stageIndex = [](Stage stage) { return static_cast<size_t>(stage); };
+
+    std::printf("%-28s %12s %12s %10s\n", "variant", "allocs/query", "ns/query", "sql_chars");
+
+    auto run = [&](const char* name, auto&& buildQuery) {
+        size_t chars = 0;
+        size_t before = g_heapAllocations;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i)
+        {
+            chars += buildQuery(searches[i % searches.size()], static_cast<unsigned long>(i));
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        size_t allocations = g_heapAllocations - before;
+        std::printf("%-28s %12.2f %12.0f %10zu\n", name,
+                    static_cast<double>(allocations) / iterations, ns / iterations, chars / iterations);
+    };
+
+    // Heap allocations of the std::wstring variants, by stage
+    std::array<size_t, stageCount> legacyHeap{};
+    std::array<size_t, stageCount> appendHeap{};
+    auto measure = [&](std::array<size_t, stageCount>& heap, Stage stage, auto&& step) {
+        size_t before = g_heapAllocations;
+        auto value = step();
+        heap[stageIndex(stage)] += g_heapAllocations - before;
+        return value;
+    };
+
+    run("legacy std::wstring", [&](std::wstring_view text, unsigned long id) {
+        auto priming = measure(legacyHeap, Stage::Scopes, [&] { return legacy::BuildPrimingSqlFromScopes(included, excluded, properties); });
+        auto plan = measure(legacyHeap, Stage::Tokenize, [&] { return model.Plan(text, included, 0); });
+        auto description = measure(legacyHeap, Stage::Logging, [&] { return plan.Describe(); });
+        auto sql = measure(legacyHeap, Stage::Sql, [&] { return legacy::BuildSearchSql(properties, id, plan.JoinTokens()); });
+        auto rows = measure(legacyHeap, Stage::Results, [&] { return results.rows; });
+        return priming.size() + sql.size();
+    });
+
+    run("append std::wstring", [&](std::wstring_view text, unsigned long id) {
+        auto priming = measure(appendHeap, Stage::Scopes, [&] {
+            std::wstring out;
+            wsearch::details::AppendPrimingSql(out, included, excluded, properties);
+            return out;
+        });
+        auto plan = measure(appendHeap, Stage::Tokenize, [&] { return model.Plan(text, included, 0); });
+        auto description = measure(appendHeap, Stage::Logging, [&] { return plan.Describe(); });
+        auto sql = measure(appendHeap, Stage::Sql, [&] {
+            std::wstring out;
+            wsearch::details::AppendReuseWhereSearchSql(out, properties, id, plan.JoinTokens(true), plan.topN, plan.FilenameOnlyTokens());
+            return out;
+        });
+        auto rows = measure(appendHeap, Stage::Results, [&] { return results.rows; });
+        return priming.size() + sql.size();
+    });
+
+    // Upstream of every arena: counts the heap blocks the arenas still take, by stage
+    wsearch::AllocationCountingResource upstream;
+    std::array<wsearch::AllocationCountingResource::Counters, stageCount> served{};
+    run("append QueryArena", [&](std::wstring_view text, unsigned long id) {
+        wsearch::QueryArena arena(&upstream);
+        std::pmr::wstring priming(arena.Resource());
+        {
+            wsearch::AllocationStageScope stage(arena, Stage::Scopes);
+            wsearch::details::AppendPrimingSql(priming, included, excluded, properties);
+        }
+        auto plan = [&]() {
+            wsearch::AllocationStageScope stage(arena, Stage::Tokenize);
+            return model.Plan(text, included, 0, arena.Resource());
+        }();
+        std::pmr::wstring description(arena.Resource());
+        {
+            wsearch::AllocationStageScope stage(arena, Stage::Logging);
+            plan.AppendDescription(description);
+        }
+        std::pmr::wstring sql(arena.Resource());
+        {
+            wsearch::AllocationStageScope stage(arena, Stage::Sql);
+            std::pmr::wstring contentText(arena.Resource());
+            plan.AppendTokens(contentText, true);
+            wsearch::details::AppendReuseWhereSearchSql(sql, properties, id, contentText, plan.topN, plan.FilenameOnlyTokens());
+        }
+        std::pmr::vector<std::pmr::vector<std::pmr::wstring>> rows(arena.Resource());
+        {
+            wsearch::AllocationStageScope stage(arena, Stage::Results);
+            rows.reserve(results.rows.size());
+            for (const auto& row : results.rows)
+            {
+                auto& values = rows.emplace_back();
+                values.reserve(row.size());
+                for (const auto& value : row)
+                {
+                    values.emplace_back(value);
+                }
+            }
+        }
+
+        for (size_t stage = 0; stage < stageCount; ++stage)
+        {
+            const auto& counters = arena.GetCounters(static_cast<Stage>(stage));
+            served[stage].allocations += counters.allocations;
+            served[stage].bytes += counters.bytes;
+        }
+        return priming.size() + sql.size();
+    });
+
+    std::printf("\nPer query, by stage: heap allocations of the std::wstring variants, then what the\n"
+                "QueryArena served (allocations, bytes) and the heap blocks it took for them:\n");
+    std::printf("  %-10s %8s %8s %10s %10s %10s\n", "stage", "legacy", "append", "arena", "bytes", "heap");
+    for (size_t stage = 0; stage < stageCount; ++stage)
+    {
+        auto perQuery = [&](size_t count) { return static_cast<double>(count) / iterations; };
+        std::printf("  %-10ls %8.2f %8.2f %10.2f %10.0f %10.2f\n",
+                    wsearch::QueryAllocationStageName(static_cast<Stage>(stage)),
+                    perQuery(legacyHeap[stage]), perQuery(appendHeap[stage]), perQuery(served[stage].allocations),
+                    perQuery(served[stage].bytes), perQuery(upstream.GetCounters(static_cast<Stage>(stage)).allocations));
+    }
+
+    return 0;
+}
@@ -0,0 +1,161 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Query cost report
+//
+// Runs every query of a typing workload through QueryCostModel and reports how often each
+// rewrite fires and how much estimated index work it saves. The workload is either a keystroke
+// trace recorded with SearchSessionRecorder (--trace file.wstrace; each text change is one query,
+// as a search-as-you-type session would send it) or, by default, a synthetic set of phrases typed
+// one character at a time. Portable; on Linux build and run with:
+//
+//   g++ -std=c++17 -O2 -pthread -I../api SearchQueryCostReport.cpp -o costreport && ./costreport
+//   ./costreport --trace typing.wstrace --scope "C:\Users\me" --verbose
+
+#include <SearchQueryCost.h>
+#include <SearchSessionRecorder.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // What people type into a launcher: short app names, file names, multi-word phrases
+    std::vector<std::wstring> BuildSyntheticQueries()
+    {
+        static const wchar_t* phrases[] = {
+            L"notepad", L"calc", L"budget", L"the annual report for the board", L"q3 forecast",
+            L"a", L"readme", L"screenshot", L"meeting notes of the team", L"to do list", L"cv",
+            L"invoice march", L"how to set up the vpn on a new laptop", L"tax", L"photos from the trip",
+            L"\"project plan\"", L"resume", L"it", L"draft of the proposal for the client review", L"pdf",
+        };
+
+        std::vector<std::wstring> queries;
+        for (const wchar_t* phrase : phrases)
+        {
+            std::wstring text;
+            for (const wchar_t* ch = phrase; *ch != L'\0'; ++ch)
+            {
+                text.push_back(*ch);
+                if (*ch != L' ' && *ch != L'"')
+                {
+                    queries.push_back(text);
+                }
+            }
+        }
+        return queries;
+    }
+
+    // The search text after every text-changing event of a recorded trace
+    std::vector<std::wstring> QueriesFromTrace(const std::vector<wsearch::SessionTraceEvent>& trace)
+    {
+        std::vector<std::wstring> queries;
+        std::wstring text;
+        for (const auto& event : trace)
+        {
+            switch (event.operation)
+            {
+            case wsearch::SessionOperation::SetSearchText:
+                text = event.text;
+                break;
+            case wsearch::SessionOperation::AppendCharacters:
+                text += event.text;
+                break;
+            case wsearch::SessionOperation::Clear:
+                text.clear();
+                continue;
+            default:
+                continue;
+            }
+            if (!text.empty())
+            {
+                queries.push_back(text);
+            }
+        }
+        return queries;
+    }
+
+    std::wstring Widen(const char* text)
+    {
+        std::wstring wide;
+        for (; *text != '\0'; ++text)
+        {
+            wide.push_back(static_cast<wchar_t>(static_cast<unsigned char>(*text)));
+        }
+        return wide;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::wstring tracePath;
+    std::vector<std::wstring> scopes;
+    bool verbose = false;
+    wsearch::QueryCostPolicy policy;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--verbose") verbose = true;
+        else if (arg == "--trace" && hasValue) tracePath = Widen(argv[++i]);
+        else if (arg == "--scope" && hasValue) scopes.push_back(Widen(argv[++i]));
+        else if (arg == "--min-length" && hasValue) policy.filenameOnlyBelowLength = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--top" && hasValue) policy.autoTopN = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--max-and" && hasValue) policy.maxAndTerms = std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--keep-stop-words") policy.dropStopWords = false;
+    }
+    if (scopes.empty())
+    {
+        scopes.push_back(L"file:");
+    }
+
+    std::vector<std::wstring> queries;
+    try
+    {
+        queries = tracePath.empty() ? BuildSyntheticQueries()
+                                    : QueriesFromTrace(wsearch::SearchSessionRecorder::LoadFromFile(tracePath));
+    }
+    catch (const std::exception& ex)
+    {
+        std::fprintf(stderr, "%s\n", ex.what());
+        return 1;
+    }
+
+    wsearch::QueryCostModel model(policy);
+    size_t rewritten = 0, filenameOnly = 0, autoTop = 0, stopWords = 0, andCapped = 0;
+    size_t expensiveBefore = 0, expensiveAfter = 0;
+    double costBefore = 0.0, costAfter = 0.0;
+
+    for (const auto& query : queries)
+    {
+        auto plan = model.Plan(query, scopes, 0);
+        rewritten += plan.IsRewritten() ? 1 : 0;
+        filenameOnly += plan.HasFilenameOnlyTokens() ? 1 : 0;
+        autoTop += plan.autoTopN ? 1 : 0;
+        stopWords += plan.droppedStopWords.empty() ? 0 : 1;
+        andCapped += plan.droppedForAndCap.empty() ? 0 : 1;
+        expensiveBefore += plan.before.cost >= policy.autoTopNCost ? 1 : 0;
+        expensiveAfter += plan.after.cost >= policy.autoTopNCost ? 1 : 0;
+        costBefore += plan.before.cost;
+        costAfter += plan.after.cost;
+
+        if (verbose)
+        {
+            std::wprintf(L"%-44ls %ls\n", query.c_str(), plan.Describe().c_str());
+        }
+    }
+
+    auto share = [&](size_t count) { return queries.empty() ? 0.0 : 100.0 * count / queries.size(); };
+    std::printf("%zu queries (%s), policy: filename-only below %zu chars, TOP %zu at cost %.0f, AND chain %zu%s\n\n",
+        queries.size(), tracePath.empty() ? "synthetic" : "trace", policy.filenameOnlyBelowLength, policy.autoTopN,
+        policy.autoTopNCost, policy.maxAndTerms, policy.dropStopWords ? ", stop-words dropped" : "");
+    std::printf("%-28s %8zu %7.1f%%\n", "rewritten", rewritten, share(rewritten));
+    std::printf("%-28s %8zu %7.1f%%\n", "  filename-only", filenameOnly, share(filenameOnly));
+    std::printf("%-28s %8zu %7.1f%%\n", "  TOP added", autoTop, share(autoTop));
+    std::printf("%-28s %8zu %7.1f%%\n", "  stop-words dropped", stopWords, share(stopWords));
+    std::printf("%-28s %8zu %7.1f%%\n", "  AND chain capped", andCapped, share(andCapped));
+    std::printf("%-28s %8zu -> %zu\n", "over TOP threshold", expensiveBefore, expensiveAfter);
+    std::printf("%-28s %8.0f -> %.0f (%.1f%% less)\n", "estimated cost", costBefore, costAfter,
+        costBefore > 0 ? 100.0 * (costBefore - costAfter) / costBefore : 0.0);
+    return 0;
+}
@@ -0,0 +1,210 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Columnar re-sort and facet benchmark
+//
+// Builds a SearchValuePage of --rows results (URL, size, modified time, kind vector, extension)
+// and times what the UI does when the user re-sorts or opens the facet pane, two ways:
+//
+//   rows:     std::stable_sort of row indexes with comparators reading the page's SearchValues,
+//             and facet counts in a std::map keyed by string
+//   columns:  ResultBatch::FromPage once for the four columns, then SortRows (radix), CountFacet and CountGroups
+//
+// Either way no indexer query is made; before this, each of these was one. Both ways must give
+// the same orders and counts. Portable; on Linux build and run with:
+//
+//   g++ -std=c++17 -O2 -I../api SearchResultColumnsBenchmark.cpp -o columnsbench && ./columnsbench
+//   ./columnsbench --rows 10000 --runs 50
+
+#include <SearchResultColumns.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    const wchar_t* const c_kinds[] = { L"document", L"picture", L"music", L"video", L"folder", L"program", L"link" };
+    const wchar_t* const c_extensions[] = { L".docx", L".png", L".jpg", L".mp3", L".txt", L".pdf", L".exe", L".xlsx",
+        L".cpp", L".h", L".zip", L".mp4", L".lnk", L".json", L".md", L".pptx", L".gif", L".wav", L".log", L".dll" };
+
+    void FillPage(wsearch::SearchValuePage& page, size_t rows)
+    {
+        std::mt19937 random(17);
+        page.ReserveRows(rows);
+        for (size_t i = 0; i < rows; ++i)
+        {
+            wsearch::SearchValue* values = page.AddRow();
+            std::wstring url = L"file:C:/Users/me/Documents/item" + std::to_wstring(i);
+            values[0] = wsearch::SearchValue::CopyString(url, page.Resource());
+            values[1] = wsearch::SearchValue::FromUInt64(static_cast<uint64_t>(random() % 50000000));
+            values[2] = wsearch::SearchValue::FromFileTime(132000000000000000ull + (random() % 1000000) * 300000000ull);
+            wsearch::SearchValue kind = wsearch::SearchValue::FromStringView(c_kinds[random() % 7]);
+            values[3] = wsearch::SearchValue::CopyVector(&kind, 1, page.Resource());
+            values[4] = wsearch::SearchValue::FromStringView(c_extensions[random() % 20]);
+        }
+    }
+
+    std::vector<uint32_t> RowSort(const wsearch::SearchValuePage& page, size_t column, bool descending)
+    {
+        std::vector<uint32_t> order(page.GetRowCount());
+        std::iota(order.begin(), order.end(), 0u);
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            uint64_t x = page.GetRow(a)[column].GetUInt64(page.GetRow(a)[column].GetFileTime().value_or(0));
+            uint64_t y = page.GetRow(b)[column].GetUInt64(page.GetRow(b)[column].GetFileTime().value_or(0));
+            return descending ? x > y : x < y;
+        });
+        return order;
+    }
+
+    std::vector<uint32_t> RowSortByKindThenModified(const wsearch::SearchValuePage& page)
+    {
+        std::vector<uint32_t> order(page.GetRowCount());
+        std::iota(order.begin(), order.end(), 0u);
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            std::wstring_view x = page.GetRow(a)[3].GetVector()[0].GetString();
+            std::wstring_view y = page.GetRow(b)[3].GetVector()[0].GetString();
+            if (x != y) return x < y;
+            return *page.GetRow(a)[2].GetFileTime() > *page.GetRow(b)[2].GetFileTime();
+        });
+        return order;
+    }
+
+    std::map<std::wstring_view, uint32_t> RowFacet(const wsearch::SearchValuePage& page, size_t column)
+    {
+        std::map<std::wstring_view, uint32_t> counts;
+        for (size_t row = 0; row < page.GetRowCount(); ++row)
+        {
+            const wsearch::SearchValue& value = page.GetRow(row)[column];
+            ++counts[value.GetVector().empty() ? value.GetString() : value.GetVector()[0].GetString()];
+        }
+        return counts;
+    }
+
+    bool SameCounts(const std::map<std::wstring_view, uint32_t>& expected, const std::vector<wsearch::FacetCount>& facets)
+    {
+        if (expected.size() != facets.size())
+        {
+            return false;
+        }
+        for (const auto& facet : facets)
+        {
+            auto found = expected.find(facet.value);
+            if (found == expected.end() || found->second != facet.count)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    double MicrosecondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    size_t rows = 10000;
+    size_t runs = 50;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string arg = argv[i];
+        if (arg == "--rows") rows = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (arg == "--runs") runs = std::strtoull(argv[i + 1], nullptr, 10);
+    }
+
+    using wsearch::ColumnSortOrder;
+    namespace propid = wsearch::propid;
+    wsearch::SearchValuePage page({ propid::ItemUrl, propid::Size, propid::DateModified, propid::Kind, propid::FileExtension });
+    FillPage(page, rows);
+
+    enum Step { Build, BySize, ByModified, ByKindThenModified, Facets, Groups, StepCount };
+    const char* names[StepCount] = { "build batch", "sort by size desc", "sort by modified", "sort by kind, modified desc",
+        "facets: kind + extension", "group by kind x extension" };
+    double rowUs[StepCount] = {};
+    double columnUs[StepCount] = {};
+    bool same = true;
+    size_t checksum = 0;
+    for (size_t run = 0; run < runs; ++run)
+    {
+        auto start = Clock::now();
+        auto sizeRows = RowSort(page, 1, true);
+        rowUs[BySize] += MicrosecondsSince(start);
+        start = Clock::now();
+        auto modifiedRows = RowSort(page, 2, false);
+        rowUs[ByModified] += MicrosecondsSince(start);
+        start = Clock::now();
+        auto kindRows = RowSortByKindThenModified(page);
+        rowUs[ByKindThenModified] += MicrosecondsSince(start);
+        start = Clock::now();
+        auto kindCounts = RowFacet(page, 3);
+        auto extensionCounts = RowFacet(page, 4);
+        rowUs[Facets] += MicrosecondsSince(start);
+        start = Clock::now();
+        std::map<std::pair<std::wstring_view, std::wstring_view>, uint32_t> groupCounts;
+        for (size_t row = 0; row < page.GetRowCount(); ++row)
+        {
+            ++groupCounts[{ page.GetRow(row)[3].GetVector()[0].GetString(), page.GetRow(row)[4].GetString() }];
+        }
+        rowUs[Groups] += MicrosecondsSince(start);
+
+        start = Clock::now();
+        auto batch = wsearch::ResultBatch::FromPage(page, { propid::Size, propid::DateModified, propid::Kind, propid::FileExtension });
+        columnUs[Build] += MicrosecondsSince(start);
+        start = Clock::now();
+        auto sizeColumns = batch.SortRows({ { propid::Size, ColumnSortOrder::Descending } });
+        columnUs[BySize] += MicrosecondsSince(start);
+        start = Clock::now();
+        auto modifiedColumns = batch.SortRows({ { propid::DateModified } });
+        columnUs[ByModified] += MicrosecondsSince(start);
+        start = Clock::now();
+        auto kindColumns = batch.SortRows({ { propid::Kind }, { propid::DateModified, ColumnSortOrder::Descending } });
+        columnUs[ByKindThenModified] += MicrosecondsSince(start);
+        start = Clock::now();
+        auto kindFacets = batch.CountFacet(propid::Kind);
+        auto extensionFacets = batch.CountFacet(propid::FileExtension);
+        columnUs[Facets] += MicrosecondsSince(start);
+        start = Clock::now();
+        auto groups = batch.CountGroups(propid::Kind, propid::FileExtension);
+        columnUs[Groups] += MicrosecondsSince(start);
+
+        same = same && sizeRows == sizeColumns && modifiedRows == modifiedColumns && kindRows == kindColumns &&
+            SameCounts(kindCounts, kindFacets) && SameCounts(extensionCounts, extensionFacets) && groups.size() == groupCounts.size();
+        checksum += groups.size();
+    }
+
+    std::printf("%zu rows, %zu runs\n\n", rows, runs);
+    std::printf("%-30s %14s %14s\n", "operation (us)", "rows", "columns");
+    double rowTotal = 0;
+    double columnTotal = 0;
+    for (int step = 0; step < StepCount; ++step)
+    {
+        if (step == Build)
+        {
+            std::printf("%-30s %14s %14.1f\n", names[step], "-", columnUs[step] / runs);
+        }
+        else
+        {
+            std::printf("%-30s %14.1f %14.1f\n", names[step], rowUs[step] / runs, columnUs[step] / runs);
+        }
+        rowTotal += rowUs[step] / runs;
+        columnTotal += columnUs[step] / runs;
+    }
+    std::printf("%-30s %14.1f %14.1f\n", "total", rowTotal, columnTotal);
+    std::printf("\nsame results: %s; %s histogram; checksum %zu\n", same ? "yes" : "NO",
+#if defined(WSEARCH_RESULT_COLUMNS_SSE2)
+        "SSE2",
+#else
+        "scalar",
+#endif
+        checksum);
+    return same ? 0 : 1;
+}
@@ -0,0 +1,177 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Client-side ordering benchmark
+//
+// A fake provider holds --matches items with the rank distribution SearchQueryBuilder's
+// COERCION clauses produce (a few exact file name hits at 990, some prefix hits at 900-980,
+// the rest content hits at 0-899). Two ways to show the best --top rows are compared end to end:
+//
+//   indexer:  ORDER BY Rank, LineCount, DateAccessed, GatherTime -- the provider sorts every
+//             match on four keys, then TOP N rows are decoded into a SearchValuePage
+//   client:   ORDER BY Rank with TOP N + --headroom -- the provider only selects by rank, the
+//             extra rows are decoded too, and OrderTopResults breaks the ties
+//
+// The provider runs the sorts the indexer would, in memory, so the numbers show the shape of
+// the saving rather than indexer timings. Both modes return the same rows whenever
+// OrderTopResults reports an exact order. With a million matches the ~500 items tied at
+// rank 990 outnumber TOP N + headroom, and the benchmark reports that instead.
+// Portable; on Linux build and run with:
+//
+//   g++ -std=c++17 -O2 -I../api SearchResultOrderingBenchmark.cpp -o orderbench && ./orderbench
+//   ./orderbench --matches 1000000 --top 50 --headroom 64 --runs 5
+
+#include <SearchResultOrdering.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    struct FakeItem
+    {
+        int32_t rank;
+        int32_t launches;
+        uint64_t accessed;
+        uint64_t gathered;
+        std::wstring url;
+    };
+
+    class FakeProvider
+    {
+    public:
+        explicit FakeProvider(size_t matches)
+        {
+            std::mt19937 random(11);
+            m_items.reserve(matches);
+            for (size_t i = 0; i < matches; ++i)
+            {
+                unsigned bucket = random() % 10000;
+                int32_t rank = (bucket < 5) ? 990 : (bucket < 200) ? static_cast<int32_t>(900 + random() % 81) : static_cast<int32_t>(random() % 900);
+                int32_t launches = (random() % 10 == 0) ? static_cast<int32_t>(random() % 20) : 0;
+                uint64_t accessed = launches ? 133000000000000000ull + (random() % 1000000) * 1000000ull : 0;
+                m_items.push_back({ rank, launches, accessed, 132000000000000000ull + random(), L"file:C:/Users/me/Documents/item" + std::to_wstring(i) + L".txt" });
+            }
+        }
+
+        // ORDER BY all four keys, TOP 'count'
+        std::vector<uint32_t> SortByAllKeys(size_t count) const
+        {
+            std::vector<uint32_t> order(m_items.size());
+            std::iota(order.begin(), order.end(), 0u);
+            std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+                const FakeItem& x = m_items[a];
+                const FakeItem& y = m_items[b];
+                if (x.rank != y.rank) return x.rank > y.rank;
+                if (x.launches != y.launches) return x.launches > y.launches;
+                if (x.accessed != y.accessed) return x.accessed > y.accessed;
+                if (x.gathered != y.gathered) return x.gathered > y.gathered;
+                return a < b;
+            });
+            order.resize((std::min)(count, order.size()));
+            return order;
+        }
+
+        // ORDER BY rank, TOP 'count': a selection on one key, then the winners by rank
+        std::vector<uint32_t> SelectByRank(size_t count) const
+        {
+            std::vector<uint32_t> order(m_items.size());
+            std::iota(order.begin(), order.end(), 0u);
+            auto byRank = [this](uint32_t a, uint32_t b) {
+                return (m_items[a].rank != m_items[b].rank) ? m_items[a].rank > m_items[b].rank : a < b;
+            };
+            count = (std::min)(count, order.size());
+            std::nth_element(order.begin(), order.begin() + (count - 1), order.end(), byRank);
+            order.resize(count);
+            std::sort(order.begin(), order.end(), byRank);
+            return order;
+        }
+
+        // What a rowset fetch costs client-side: decoding each returned row
+        void Decode(const std::vector<uint32_t>& rows, wsearch::SearchValuePage& page) const
+        {
+            page.ReserveRows(rows.size());
+            for (uint32_t index : rows)
+            {
+                const FakeItem& item = m_items[index];
+                wsearch::SearchValue* values = page.AddRow();
+                values[0] = wsearch::SearchValue::CopyString(item.url, page.Resource());
+                values[1] = wsearch::SearchValue::FromInt32(item.rank);
+                values[2] = wsearch::SearchValue::FromInt32(item.launches);
+                values[3] = item.accessed ? wsearch::SearchValue::FromFileTime(item.accessed) : wsearch::SearchValue();
+                values[4] = wsearch::SearchValue::FromFileTime(item.gathered);
+            }
+        }
+
+    private:
+        std::vector<FakeItem> m_items;
+    };
+
+    std::vector<wsearch::PropertyId> Columns()
+    {
+        return { wsearch::propid::ItemUrl, wsearch::propid::SearchRank, wsearch::propid::DocumentLineCount,
+            wsearch::propid::DateAccessed, wsearch::propid::SearchGatherTime };
+    }
+}
+
+int main(int argc, char** argv)
+{
+    size_t matches = 200000;
+    size_t top = 50;
+    size_t headroom = wsearch::c_defaultOrderingHeadroom;
+    size_t runs = 5;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string arg = argv[i];
+        if (arg == "--matches") matches = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (arg == "--top") top = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (arg == "--headroom") headroom = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (arg == "--runs") runs = std::strtoull(argv[i + 1], nullptr, 10);
+    }
+
+    FakeProvider provider(matches);
+    double indexerMs = 0;
+    double clientMs = 0;
+    double clientOrderMs = 0;
+    bool same = true;
+    bool exact = true;
+    for (size_t run = 0; run < runs; ++run)
+    {
+        auto start = Clock::now();
+        wsearch::SearchValuePage indexerPage(Columns());
+        provider.Decode(provider.SortByAllKeys(top), indexerPage);
+        indexerMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        start = Clock::now();
+        wsearch::SearchValuePage clientPage(Columns());
+        provider.Decode(provider.SelectByRank(top + headroom), clientPage);
+        auto ordering = Clock::now();
+        auto keys = wsearch::BuildResultOrderKeys(clientPage);
+        auto ordered = wsearch::OrderTopResults(keys, top, top + headroom);
+        auto done = Clock::now();
+        clientMs += std::chrono::duration<double, std::milli>(done - start).count();
+        clientOrderMs += std::chrono::duration<double, std::milli>(done - ordering).count();
+
+        exact = exact && ordered.exact;
+        same = same && ordered.rows.size() == indexerPage.GetRowCount();
+        for (size_t i = 0; same && i < ordered.rows.size(); ++i)
+        {
+            same = clientPage.GetRow(ordered.rows[i]).Get(wsearch::propid::ItemUrl).GetString() ==
+                indexerPage.GetRow(i).Get(wsearch::propid::ItemUrl).GetString();
+        }
+    }
+
+    std::printf("%zu matches, top %zu, headroom %zu, %zu runs\n\n", matches, top, headroom, runs);
+    std::printf("%-40s %12s\n", "mode", "ms per query");
+    std::printf("%-40s %12.3f\n", "indexer: four-key ORDER BY", indexerMs / runs);
+    std::printf("%-40s %12.3f\n", "client: rank-only TOP N+headroom", clientMs / runs);
+    std::printf("%-40s %12.3f\n", "  of which client-side ordering", clientOrderMs / runs);
+    std::printf("\nsame rows: %s, order exact: %s\n", same ? "yes" : "NO", exact ? "yes" : "no (raise --headroom)");
+    return (same || !exact) ? 0 : 1;
+}
@@ -0,0 +1,297 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Result publication contention benchmark
+//
+// Models one search-as-you-type session: a typing thread edits the search text every
+// --edit-us, a query thread publishes results every --publish-us, and N reader threads poll the
+// results (a UI thread per frame, accessibility, telemetry...) every --poll-us (0 = spin). Two
+// designs are compared:
+//
+//   locked:     one session mutex guards the text and the results, as GetCachedResults did
+//   published:  the mutex guards only the text; results go through a ResultPublisher and
+//               readers poll with Refresh
+//
+// For each reader count it reports reads per second, how long each edit took (that is what a
+// keystroke waits for) and the time spent waiting on the session mutex. Portable; on Linux build
+// and run with:
+//
+//   g++ -std=c++17 -O2 -pthread -I../api SearchResultPublisherBenchmark.cpp -o publishbench && ./publishbench
+//   ./publishbench --seconds 2 --poll-us 0 --max-readers 8
+
+#include <SearchResultPublisher.h>
+#include <SearchSynchronization.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    struct Options
+    {
+        double seconds = 1.0;
+        int64_t editMicroseconds = 100;
+        int64_t publishMicroseconds = 500;
+        int64_t pollMicroseconds = 0;
+        size_t maxReaders = 8;
+    };
+
+    struct Rows
+    {
+        std::vector<uint32_t> ids;
+    };
+
+    // The old shape: text and results behind one mutex
+    class LockedSession
+    {
+    public:
+        void Edit(wchar_t ch)
+        {
+            std::lock_guard<wsearch::details::ContentionTrackingMutex> lock(m_mutex);
+            m_text.push_back(ch);
+            if (m_text.size() > 16)
+            {
+                m_text.clear();
+            }
+            ++m_request;
+        }
+
+        void Publish(std::shared_ptr<const Rows> rows)
+        {
+            std::wstring text;
+            uint64_t request;
+            {
+                std::lock_guard<wsearch::details::ContentionTrackingMutex> lock(m_mutex);
+                text = m_text;
+                request = m_request;
+            }
+            std::lock_guard<wsearch::details::ContentionTrackingMutex> lock(m_mutex);
+            m_rows = std::move(rows);
+            m_answered = request;
+        }
+
+        size_t Read()
+        {
+            std::lock_guard<wsearch::details::ContentionTrackingMutex> lock(m_mutex);
+            return m_rows ? m_rows->ids.size() + (m_answered < m_request ? 1 : 0) : 0;
+        }
+
+        std::chrono::nanoseconds GetLockWaitTime() const
+        {
+            return m_mutex.GetWaitTime();
+        }
+
+    private:
+        mutable wsearch::details::ContentionTrackingMutex m_mutex;
+        std::wstring m_text;
+        uint64_t m_request = 0;
+        uint64_t m_answered = 0;
+        std::shared_ptr<const Rows> m_rows;
+    };
+
+    // The new shape: the mutex guards only the text
+    class PublishedSession
+    {
+    public:
+        void Edit(wchar_t ch)
+        {
+            std::lock_guard<wsearch::details::ContentionTrackingMutex> lock(m_mutex);
+            m_text.push_back(ch);
+            if (m_text.size() > 16)
+            {
+                m_text.clear();
+            }
+            ++m_request;
+        }
+
+        void Publish(std::shared_ptr<const Rows> rows)
+        {
+            std::wstring text;
+            uint64_t request;
+            {
+                std::lock_guard<wsearch::details::ContentionTrackingMutex> lock(m_mutex);
+                text = m_text;
+                request = m_request;
+            }
+            m_results.Publish({ request, std::move(text), std::move(rows) });
+        }
+
+        // Readers keep their last snapshot and only reload it when the generation moved
+        size_t Read(std::shared_ptr<const wsearch::ResultSnapshot<std::shared_ptr<const Rows>>>& shown)
+        {
+            m_results.Refresh(shown);
+            return shown->result ? shown->result->ids.size() + (shown->request < m_request.load() ? 1 : 0) : 0;
+        }
+
+        std::chrono::nanoseconds GetLockWaitTime() const
+        {
+            return m_mutex.GetWaitTime();
+        }
+
+    private:
+        mutable wsearch::details::ContentionTrackingMutex m_mutex;
+        std::wstring m_text;
+        std::atomic<uint64_t> m_request{ 0 };
+        wsearch::ResultPublisher<std::shared_ptr<const Rows>> m_results;
+    };
+
+    struct Result
+    {
+        double readsPerSecond = 0;
+        double editP50Us = 0;
+        double editP99Us = 0;
+        double editMaxUs = 0;
+        double lockWaitMs = 0;
+        uint64_t checksum = 0;
+    };
+
+    void SleepOrSpin(int64_t microseconds)
+    {
+        if (microseconds > 0)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(microseconds));
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    template <typename Session, typename ReadOnce>
+    Result Run(const Options& options, size_t readers, ReadOnce readOnce)
+    {
+        Session session;
+        std::atomic<bool> done{ false };
+        std::atomic<uint64_t> reads{ 0 };
+        std::atomic<uint64_t> checksum{ 0 };
+
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < readers; ++i)
+        {
+            threads.emplace_back([&] {
+                uint64_t local = 0;
+                uint64_t sum = 0;
+                auto state = readOnce.MakeState();
+                while (!done.load(std::memory_order_relaxed))
+                {
+                    sum += readOnce(session, state);
+                    ++local;
+                    if (options.pollMicroseconds > 0)
+                    {
+                        std::this_thread::sleep_for(std::chrono::microseconds(options.pollMicroseconds));
+                    }
+                }
+                reads += local;
+                checksum += sum;
+            });
+        }
+
+        threads.emplace_back([&] {
+            uint32_t next = 0;
+            while (!done.load(std::memory_order_relaxed))
+            {
+                auto page = std::make_shared<Rows>();
+                page->ids.assign(20 + next % 30, next);
+                ++next;
+                session.Publish(std::move(page));
+                SleepOrSpin(options.publishMicroseconds);
+            }
+        });
+
+        std::vector<double> edits;
+        auto start = Clock::now();
+        auto end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.seconds));
+        for (uint32_t i = 0; Clock::now() < end; ++i)
+        {
+            auto before = Clock::now();
+            session.Edit(static_cast<wchar_t>(L'a' + i % 26));
+            edits.push_back(std::chrono::duration<double, std::micro>(Clock::now() - before).count());
+            SleepOrSpin(options.editMicroseconds);
+        }
+        double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        done = true;
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        std::sort(edits.begin(), edits.end());
+        Result result;
+        result.readsPerSecond = static_cast<double>(reads.load()) / elapsed;
+        result.editP50Us = edits[edits.size() / 2];
+        result.editP99Us = edits[edits.size() * 99 / 100];
+        result.editMaxUs = edits.back();
+        result.lockWaitMs = std::chrono::duration<double, std::milli>(session.GetLockWaitTime()).count();
+        result.checksum = checksum.load();
+        return result;
+    }
+
+    struct LockedRead
+    {
+        int MakeState() const
+        {
+            return 0;
+        }
+
+        size_t operator()(LockedSession& session, int&) const
+        {
+            return session.Read();
+        }
+    };
+
+    struct PublishedRead
+    {
+        std::shared_ptr<const wsearch::ResultSnapshot<std::shared_ptr<const Rows>>> MakeState() const
+        {
+            return nullptr;
+        }
+
+        size_t operator()(PublishedSession& session, std::shared_ptr<const wsearch::ResultSnapshot<std::shared_ptr<const Rows>>>& shown) const
+        {
+            return session.Read(shown);
+        }
+    };
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string arg = argv[i];
+        if (arg == "--seconds") options.seconds = std::strtod(argv[i + 1], nullptr);
+        else if (arg == "--edit-us") options.editMicroseconds = std::strtoll(argv[i + 1], nullptr, 10);
+        else if (arg == "--publish-us") options.publishMicroseconds = std::strtoll(argv[i + 1], nullptr, 10);
+        else if (arg == "--poll-us") options.pollMicroseconds = std::strtoll(argv[i + 1], nullptr, 10);
+        else if (arg == "--max-readers") options.maxReaders = std::strtoull(argv[i + 1], nullptr, 10);
+    }
+
+    std::printf("edit every %lld us, publish every %lld us, poll %s; %u hardware threads\n\n",
+        static_cast<long long>(options.editMicroseconds), static_cast<long long>(options.publishMicroseconds),
+        options.pollMicroseconds > 0 ? (std::to_string(options.pollMicroseconds) + " us").c_str() : "spinning",
+        std::thread::hardware_concurrency());
+    std::printf("%-8s %-10s %14s %10s %10s %10s %12s\n", "readers", "design", "reads/s", "edit_p50", "edit_p99", "edit_max",
+        "lock_wait_ms");
+    uint64_t checksum = 0;
+    for (size_t readers = 1; readers <= options.maxReaders; readers *= 2)
+    {
+        auto locked = Run<LockedSession>(options, readers, LockedRead{});
+        auto published = Run<PublishedSession>(options, readers, PublishedRead{});
+        for (const auto& [name, result] : { std::make_pair("locked", locked), std::make_pair("published", published) })
+        {
+            std::printf("%-8zu %-10s %14.0f %8.1fus %8.1fus %8.1fus %12.2f\n", readers, name, result.readsPerSecond, result.editP50Us,
+                result.editP99Us, result.editMaxUs, result.lockWaitMs);
+            checksum += result.checksum;
+        }
+    }
+    std::printf("\nchecksum %llu\n", static_cast<unsigned long long>(checksum));
+    return 0;
+}
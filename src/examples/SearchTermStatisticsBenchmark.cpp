@@ -0,0 +1,194 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Term statistics benchmark
+//
+// Replays --queries searches drawn from --distinct texts with Zipf-distributed popularity (a few
+// texts typed often, a long tail typed once). Each text has a fixed result count between 1 and
+// ~1M and a latency that grows with it. Every query is recorded in a SearchTermStatistics and in
+// an exact unordered_map of per-text means. Then planner-style lookups, weighted like the
+// queries, compare the sketch's estimates with the exact means:
+//
+//   within 2x:  share of lookups whose estimated result count is within a factor of two of the
+//               exact mean (or, for never-recorded texts, of their actual count)
+//   fallback:   lookups of never-recorded texts answered from their prefix length
+//
+// It also reports memory, ns per Record and Estimate, and the size of the saved file. Portable;
+// on Linux build and run with:
+//
+//   g++ -std=c++17 -O2 -I../api SearchTermStatisticsBenchmark.cpp -o termstats && ./termstats
+//   ./termstats --queries 1000000 --distinct 200000 --width 16384
+
+#include <SearchTermStatistics.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    // Wednesday 2024-03-13 15:00 UTC
+    constexpr uint64_t c_now = 133548660000000000ull;
+
+    struct Text
+    {
+        std::wstring text;
+        double resultCount;
+        std::chrono::microseconds latency;
+    };
+
+    std::vector<Text> MakeTexts(size_t distinct)
+    {
+        static const wchar_t* words[] = { L"report", L"budget", L"photo", L"invoice", L"notes", L"draft", L"annual",
+            L"meeting", L"plan", L"summary", L"resume", L"project", L"design", L"q3", L"final", L"scan" };
+        std::mt19937 random(11);
+        std::vector<Text> texts;
+        texts.reserve(distinct);
+        for (size_t i = 0; i < distinct; ++i)
+        {
+            Text text;
+            text.text = words[random() % 16];
+            if (random() % 2)
+            {
+                text.text += L" ";
+                text.text += words[random() % 16];
+            }
+            // A unique word, typed partway
+            std::wstring tail = L"w" + std::to_wstring(100000 + i * 2654435761u % 900000);
+            tail.resize(3 + random() % 5);
+            text.text += L" " + tail;
+
+            // Shorter last words match more; spread by a factor of ~30 either way
+            double base = std::pow(10.0, 6.0 - 0.6 * static_cast<double>(tail.size() > 6 ? 6 : tail.size()));
+            text.resultCount = std::floor(base * std::exp(std::normal_distribution<double>(0.0, 1.0)(random)));
+            text.latency = std::chrono::microseconds(2000 + static_cast<int64_t>(std::sqrt(text.resultCount) * 20.0));
+            texts.push_back(std::move(text));
+        }
+        return texts;
+    }
+
+    struct ExactMean
+    {
+        double count = 0;
+        double logResults = 0;
+    };
+}
+
+int main(int argc, char** argv)
+{
+    size_t queries = 1000000;
+    size_t distinct = 200000;
+    size_t width = 16384;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string arg = argv[i];
+        if (arg == "--queries") queries = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (arg == "--distinct") distinct = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (arg == "--width") width = std::strtoull(argv[i + 1], nullptr, 10);
+    }
+
+    auto texts = MakeTexts(distinct);
+    std::vector<double> zipf(distinct);
+    for (size_t i = 0; i < distinct; ++i)
+    {
+        zipf[i] = 1.0 / std::pow(static_cast<double>(i + 1), 1.1);
+    }
+    std::discrete_distribution<size_t> popularity(zipf.begin(), zipf.end());
+    std::mt19937 random(5);
+    std::vector<size_t> workload(queries);
+    for (auto& text : workload)
+    {
+        text = popularity(random);
+    }
+
+    wsearch::TermStatisticsOptions options;
+    options.width = width;
+    wsearch::SearchTermStatistics statistics(options);
+    std::vector<std::wstring> scopes = { L"file:C:/Users" };
+
+    // Spread over a day; the default half-life is a week
+    auto start = Clock::now();
+    for (size_t i = 0; i < queries; ++i)
+    {
+        const Text& text = texts[workload[i]];
+        statistics.Record(text.text, scopes, static_cast<size_t>(text.resultCount), text.latency, c_now + i * 864000000000ull / queries);
+    }
+    double recordNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / static_cast<double>(queries);
+
+    std::unordered_map<std::wstring, ExactMean> exact;
+    start = Clock::now();
+    for (size_t i = 0; i < queries; ++i)
+    {
+        const Text& text = texts[workload[i]];
+        auto& mean = exact[text.text];
+        mean.count += 1;
+        mean.logResults += std::log1p(text.resultCount);
+    }
+    double exactNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / static_cast<double>(queries);
+    size_t exactBytes = exact.size() * (sizeof(std::wstring) + sizeof(ExactMean) + 2 * sizeof(void*)) + exact.bucket_count() * sizeof(void*);
+    for (const auto& entry : exact)
+    {
+        exactBytes += entry.first.capacity() > 7 ? (entry.first.capacity() + 1) * sizeof(wchar_t) : 0;
+    }
+
+    // Lookups weighted like the queries: popular texts are planned more often, and every 10th
+    // lookup is text typed for the first time
+    std::vector<size_t> lookups(200000);
+    for (size_t i = 0; i < lookups.size(); ++i)
+    {
+        lookups[i] = (i % 10 == 9) ? random() % distinct : popularity(random);
+    }
+    std::vector<wsearch::TermStatisticsEstimate> estimates(lookups.size());
+    start = Clock::now();
+    for (size_t i = 0; i < lookups.size(); ++i)
+    {
+        estimates[i] = statistics.Estimate(texts[lookups[i]].text, scopes, c_now + 864000000000ull);
+    }
+    double estimateNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / static_cast<double>(lookups.size());
+
+    // Recorded texts are compared with the exact mean, new ones with their own count
+    auto within2x = [](const wsearch::TermStatisticsEstimate& estimate, double expected) {
+        return estimate.IsKnown() && estimate.resultCount + 1 <= 2.0 * (expected + 1) && 2.0 * (estimate.resultCount + 1) >= expected + 1;
+    };
+    size_t seen = 0;
+    size_t seenWithin2x = 0;
+    size_t unseen = 0;
+    size_t unseenKnown = 0;
+    size_t unseenWithin2x = 0;
+    double checksum = 0;
+    for (size_t i = 0; i < lookups.size(); ++i)
+    {
+        const Text& text = texts[lookups[i]];
+        checksum += estimates[i].resultCount;
+        auto found = exact.find(text.text);
+        if (found != exact.end())
+        {
+            ++seen;
+            seenWithin2x += within2x(estimates[i], std::expm1(found->second.logResults / found->second.count)) ? 1 : 0;
+        }
+        else
+        {
+            ++unseen;
+            unseenKnown += estimates[i].IsKnown() ? 1 : 0;
+            unseenWithin2x += within2x(estimates[i], text.resultCount) ? 1 : 0;
+        }
+    }
+
+    auto bytes = statistics.Serialize();
+    std::printf("%zu queries over %zu distinct texts (%zu recorded), sketch %zu x %zu\n\n", queries, distinct, exact.size(),
+        options.depth, options.width);
+    std::printf("%-28s %12s %12s\n", "", "sketch", "exact map");
+    std::printf("%-28s %12.1f %12.1f\n", "memory (MB)", statistics.GetMemoryBytes() / 1048576.0, exactBytes / 1048576.0);
+    std::printf("%-28s %12.0f %12.0f\n", "ns per record", recordNs, exactNs);
+    std::printf("%-28s %12.0f %12s\n", "ns per estimate", estimateNs, "-");
+    std::printf("%-28s %11.1f%% %11.1f%%\n", "seen texts within 2x", 100.0 * seenWithin2x / (seen ? seen : 1), 100.0);
+    std::printf("%-28s %11.1f%% %11.1f%%\n", "new texts with an estimate", 100.0 * unseenKnown / (unseen ? unseen : 1), 0.0);
+    std::printf("%-28s %11.1f%% %11.1f%%\n", "new texts within 2x", 100.0 * unseenWithin2x / (unseen ? unseen : 1), 0.0);
+    std::printf("\nsaved file: %.1f KB; checksum %.0f\n", bytes.size() / 1024.0, checksum);
+    return 0;
+}
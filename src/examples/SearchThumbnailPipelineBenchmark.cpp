@@ -0,0 +1,216 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// Thumbnail pipeline benchmark
+//
+// Replays a typing session (one result page per keystroke) against a fake loader with a fixed
+// per-icon latency, two ways: the old blocking cache (load inline while enumerating, no
+// in-flight dedupe, failures retried) and ThumbnailPipeline. Reports how long each page takes
+// to reach the list, how long until every icon is in, and how many loads hit the loader.
+// Portable; on Linux build and run with:
+//
+//   g++ -std=c++17 -O2 -pthread -I../api SearchThumbnailPipelineBenchmark.cpp -o thumbbench && ./thumbbench
+
+#include <SearchThumbnailPipeline.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    struct Row
+    {
+        std::wstring path;
+        bool isFolder = false;
+    };
+
+    // Every icon costs 'latency'; extensions in 'failing' never produce one
+    class FakeLoader : public wsearch::IThumbnailLoader<int>
+    {
+    public:
+        explicit FakeLoader(std::chrono::microseconds latency)
+            : m_latency(latency)
+        {
+        }
+
+        std::optional<int> Load(const wsearch::ThumbnailRequest& request) override
+        {
+            ++m_loads;
+            std::this_thread::sleep_for(m_latency);
+            if (request.key == L".tmp" || request.key == L".partial")
+            {
+                return std::nullopt;
+            }
+            return static_cast<int>(request.key.size());
+        }
+
+        uint64_t GetLoads() const
+        {
+            return m_loads.load();
+        }
+
+    private:
+        std::chrono::microseconds m_latency;
+        std::atomic<uint64_t> m_loads{ 0 };
+    };
+
+    // The pre-pipeline IconCache: blocking load on miss, successes cached per key
+    class BlockingCache
+    {
+    public:
+        explicit BlockingCache(FakeLoader& loader)
+            : m_loader(loader)
+        {
+        }
+
+        std::optional<int> GetOrLoad(const Row& row)
+        {
+            auto key = wsearch::details::ThumbnailKeyForPath(row.path, row.isFolder);
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                auto it = m_cache.find(key);
+                if (it != m_cache.end())
+                {
+                    return it->second;
+                }
+            }
+
+            auto image = m_loader.Load({ key, row.path, row.isFolder });
+            if (image)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_cache.emplace(key, *image);
+            }
+            return image;
+        }
+
+    private:
+        FakeLoader& m_loader;
+        std::mutex m_mutex;
+        std::unordered_map<std::wstring, int> m_cache;
+    };
+
+    std::vector<std::vector<Row>> BuildSession(size_t pages, size_t rowsPerPage)
+    {
+        static const wchar_t* extensions[] = { L".docx", L".xlsx", L".pdf", L".txt", L".png", L".jpg", L".cpp", L".h",
+            L".md", L".pptx", L".zip", L".tmp", L".json", L".xml", L".partial", L".csv", L".mp4", L".svg" };
+        constexpr size_t extensionCount = sizeof(extensions) / sizeof(extensions[0]);
+
+        std::vector<std::vector<Row>> session(pages);
+        uint32_t seed = 12345;
+        for (size_t page = 0; page < pages; ++page)
+        {
+            // Each keystroke widens the set of extensions that show up
+            size_t reachable = std::min(extensionCount, 3 + page * 2);
+            for (size_t i = 0; i < rowsPerPage; ++i)
+            {
+                seed = seed * 1103515245u + 12345u;
+                Row row;
+                row.isFolder = (seed >> 16) % 10 == 0;
+                row.path = L"C:\\Users\\me\\Documents\\item" + std::to_wstring(page) + L"_" + std::to_wstring(i);
+                if (!row.isFolder)
+                {
+                    row.path += extensions[(seed >> 8) % reachable];
+                }
+                session[page].push_back(std::move(row));
+            }
+        }
+        return session;
+    }
+
+    struct Outcome
+    {
+        double resultsMs = 0;  // sum over pages: query start -> rows handed to the list
+        double allIconsMs = 0; // sum over pages: query start -> last icon for the page delivered
+        uint64_t loads = 0;
+    };
+
+    Outcome RunBlocking(const std::vector<std::vector<Row>>& session, std::chrono::microseconds latency)
+    {
+        FakeLoader loader(latency);
+        BlockingCache cache(loader);
+
+        Outcome outcome;
+        for (const auto& page : session)
+        {
+            auto start = Clock::now();
+            size_t withIcon = 0;
+            for (const auto& row : page)
+            {
+                withIcon += cache.GetOrLoad(row).has_value() ? 1 : 0;
+            }
+            double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            outcome.resultsMs += ms;
+            outcome.allIconsMs += ms;
+        }
+        outcome.loads = loader.GetLoads();
+        return outcome;
+    }
+
+    Outcome RunPipeline(const std::vector<std::vector<Row>>& session, std::chrono::microseconds latency,
+        wsearch::ThumbnailPipelineOptions options)
+    {
+        auto loader = std::make_shared<FakeLoader>(latency);
+        wsearch::ThumbnailPipeline<int> pipeline(loader, options);
+
+        Outcome outcome;
+        for (const auto& page : session)
+        {
+            auto start = Clock::now();
+            std::atomic<size_t> delivered{ 0 };
+            for (const auto& row : page)
+            {
+                pipeline.Request(row.path, row.isFolder, [&](const std::optional<int>&) { ++delivered; });
+            }
+            outcome.resultsMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+            pipeline.WaitForIdle(std::chrono::seconds(30));
+            outcome.allIconsMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        }
+        outcome.loads = loader->GetLoads();
+        return outcome;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    size_t pages = 12;
+    size_t rowsPerPage = 50;
+    long latencyUs = 20000;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string arg = argv[i];
+        if (arg == "--pages") pages = std::strtoul(argv[i + 1], nullptr, 10);
+        else if (arg == "--rows") rowsPerPage = std::strtoul(argv[i + 1], nullptr, 10);
+        else if (arg == "--latency-us") latencyUs = std::strtol(argv[i + 1], nullptr, 10);
+    }
+
+    auto session = BuildSession(pages, rowsPerPage);
+    std::chrono::microseconds latency(latencyUs);
+
+    std::printf("%zu pages x %zu rows, %ld us per icon load\n\n", pages, rowsPerPage, latencyUs);
+    std::printf("%-22s %14s %14s %8s\n", "", "results ms", "all icons ms", "loads");
+
+    auto blocking = RunBlocking(session, latency);
+    std::printf("%-22s %14.2f %14.2f %8llu\n", "blocking cache", blocking.resultsMs, blocking.allIconsMs,
+        static_cast<unsigned long long>(blocking.loads));
+
+    for (size_t workers : { 1, 2, 4 })
+    {
+        wsearch::ThumbnailPipelineOptions options;
+        options.workerCount = workers;
+        auto pipelined = RunPipeline(session, latency, options);
+
+        char label[32];
+        std::snprintf(label, sizeof(label), "pipeline, %zu worker%s", workers, workers == 1 ? "" : "s");
+        std::printf("%-22s %14.2f %14.2f %8llu\n", label, pipelined.resultsMs, pipelined.allIconsMs,
+            static_cast<unsigned long long>(pipelined.loads));
+    }
+    return 0;
+}
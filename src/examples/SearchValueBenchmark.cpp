@@ -0,0 +1,223 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+// SearchValue benchmark
+//
+// Compares reading result properties the way SearchResult does (a virtual GetValue into a
+// PROPVARIANT-like value whose string is a fresh heap copy, a copy into std::wstring, then a
+// clear) with decoding each row once into a SearchValuePage and reading SearchValues after
+// that. The property store is simulated in memory, so the numbers show the cost of the value
+// handling itself; on Windows every old-style read is also a COM call.
+// Rows are decoded in pages of --page-size, and each row is read --reads times, as a
+// virtualized list does while it repaints and scrolls.
+// Portable; on Linux build and run with:
+//
+//   g++ -std=c++17 -O2 -I../api SearchValueBenchmark.cpp -o valuebench && ./valuebench
+//   ./valuebench --rows 200000 --reads 8 --page-size 256
+
+#include <SearchValue.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+    // The parts of PROPVARIANT the read path uses
+    struct FakePropVariant
+    {
+        enum class Vt { Empty, UI8, FileTime, LPWStr } vt = Vt::Empty;
+        uint64_t number = 0;
+        wchar_t* text = nullptr;
+    };
+
+    void FakePropVariantClear(FakePropVariant& value)
+    {
+        std::free(value.text);
+        value = FakePropVariant();
+    }
+
+    class IFakePropertyStore
+    {
+    public:
+        virtual ~IFakePropertyStore() = default;
+        virtual bool GetValue(wsearch::PropertyId key, FakePropVariant& value) const = 0;
+    };
+
+    struct FakeItem
+    {
+        std::wstring url;
+        std::wstring name;
+        uint64_t size;
+        uint64_t modified;
+    };
+
+    // Hands out copies, as IPropertyStore::GetValue does
+    class FakePropertyStore : public IFakePropertyStore
+    {
+    public:
+        explicit FakePropertyStore(const FakeItem& item)
+            : m_item(item)
+        {
+        }
+
+        bool GetValue(wsearch::PropertyId key, FakePropVariant& value) const override
+        {
+            switch (key)
+            {
+            case wsearch::propid::ItemUrl: return CopyText(m_item.url, value);
+            case wsearch::propid::ItemNameDisplay: return CopyText(m_item.name, value);
+            case wsearch::propid::Size: value.vt = FakePropVariant::Vt::UI8; value.number = m_item.size; return true;
+            case wsearch::propid::DateModified: value.vt = FakePropVariant::Vt::FileTime; value.number = m_item.modified; return true;
+            default: return false;
+            }
+        }
+
+    private:
+        static bool CopyText(const std::wstring& text, FakePropVariant& value)
+        {
+            value.vt = FakePropVariant::Vt::LPWStr;
+            value.text = static_cast<wchar_t*>(std::malloc((text.size() + 1) * sizeof(wchar_t)));
+            std::memcpy(value.text, text.c_str(), (text.size() + 1) * sizeof(wchar_t));
+            return true;
+        }
+
+        const FakeItem& m_item;
+    };
+
+    // SearchResult::GetStringProperty
+    std::wstring GetStringProperty(const IFakePropertyStore& store, wsearch::PropertyId key)
+    {
+        FakePropVariant value;
+        std::wstring result;
+        if (store.GetValue(key, value) && value.vt == FakePropVariant::Vt::LPWStr && value.text)
+        {
+            result = value.text;
+        }
+        FakePropVariantClear(value);
+        return result;
+    }
+
+    // SearchResult::GetSize / GetFileTimeProperty
+    uint64_t GetNumberProperty(const IFakePropertyStore& store, wsearch::PropertyId key)
+    {
+        FakePropVariant value;
+        uint64_t result = store.GetValue(key, value) ? value.number : 0;
+        FakePropVariantClear(value);
+        return result;
+    }
+
+    wsearch::SearchValue ToSearchValue(const FakePropVariant& value, std::pmr::memory_resource* resource)
+    {
+        switch (value.vt)
+        {
+        case FakePropVariant::Vt::UI8: return wsearch::SearchValue::FromUInt64(value.number);
+        case FakePropVariant::Vt::FileTime: return wsearch::SearchValue::FromFileTime(value.number);
+        case FakePropVariant::Vt::LPWStr: return wsearch::SearchValue::CopyString(value.text, resource);
+        default: return wsearch::SearchValue();
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    size_t rowCount = 100000;
+    size_t reads = 4;
+    size_t pageSize = 64;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string arg = argv[i];
+        if (arg == "--rows") rowCount = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (arg == "--reads") reads = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (arg == "--page-size") pageSize = std::strtoull(argv[i + 1], nullptr, 10);
+    }
+
+    std::vector<FakeItem> items;
+    items.reserve(rowCount);
+    for (size_t i = 0; i < rowCount; ++i)
+    {
+        std::wstring name = L"Quarterly report " + std::to_wstring(i) + L".docx";
+        items.push_back({ L"file:C:/Users/me/Documents/Reports/2024/" + name, name, 4096 + i * 17, 133000000000000000ull + i });
+    }
+    std::vector<std::unique_ptr<IFakePropertyStore>> stores;
+    for (const auto& item : items)
+    {
+        stores.push_back(std::make_unique<FakePropertyStore>(item));
+    }
+
+    // Old path: every read goes through the store
+    size_t checksum = 0;
+    auto start = Clock::now();
+    for (size_t pass = 0; pass < reads; ++pass)
+    {
+        for (const auto& store : stores)
+        {
+            checksum += GetStringProperty(*store, wsearch::propid::ItemUrl).size();
+            checksum += GetStringProperty(*store, wsearch::propid::ItemNameDisplay).size();
+            checksum += GetNumberProperty(*store, wsearch::propid::Size);
+            checksum += GetNumberProperty(*store, wsearch::propid::DateModified) & 0xFF;
+        }
+    }
+    double oldMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    // New path: decode a page of rows once, read it, drop it (as ResultCursor pages do); the
+    // pool lets each page reuse the blocks of the ones before it
+    std::pmr::unsynchronized_pool_resource pool;
+    size_t valueChecksum = 0;
+    double decodeMs = 0;
+    double readMs = 0;
+    for (size_t first = 0; first < stores.size(); first += pageSize)
+    {
+        size_t last = (std::min)(stores.size(), first + pageSize);
+
+        start = Clock::now();
+        wsearch::SearchValuePage page({ wsearch::propid::ItemUrl, wsearch::propid::ItemNameDisplay, wsearch::propid::Size, wsearch::propid::DateModified }, &pool);
+        page.ReserveRows(last - first);
+        const auto& columns = page.GetColumns();
+        for (size_t row = first; row < last; ++row)
+        {
+            wsearch::SearchValue* values = page.AddRow();
+            for (size_t column = 0; column < columns.size(); ++column)
+            {
+                FakePropVariant value;
+                if (stores[row]->GetValue(columns[column], value))
+                {
+                    values[column] = ToSearchValue(value, page.Resource());
+                }
+                FakePropVariantClear(value);
+            }
+        }
+        auto decoded = Clock::now();
+
+        for (size_t pass = 0; pass < reads; ++pass)
+        {
+            for (size_t row = 0; row < page.GetRowCount(); ++row)
+            {
+                auto values = page.GetRow(row);
+                valueChecksum += values.Get(wsearch::propid::ItemUrl).GetString().size();
+                valueChecksum += values.Get(wsearch::propid::ItemNameDisplay).GetString().size();
+                valueChecksum += values.Get(wsearch::propid::Size).GetUInt64();
+                valueChecksum += values.Get(wsearch::propid::DateModified).GetFileTime().value_or(0) & 0xFF;
+            }
+        }
+        auto read = Clock::now();
+
+        decodeMs += std::chrono::duration<double, std::milli>(decoded - start).count();
+        readMs += std::chrono::duration<double, std::milli>(read - decoded).count();
+    }
+
+    double propertyReads = static_cast<double>(rowCount * reads * 4);
+    std::printf("%zu rows in pages of %zu, 4 properties, each row read %zu times\n\n", rowCount, pageSize, reads);
+    std::printf("%-34s %10s %14s\n", "path", "total ms", "ns/property");
+    std::printf("%-34s %10.2f %14.1f\n", "store + PROPVARIANT per read", oldMs, oldMs * 1e6 / propertyReads);
+    std::printf("%-34s %10.2f %14.1f\n", "SearchValuePage decode (once)", decodeMs, decodeMs * 1e6 / (rowCount * 4));
+    std::printf("%-34s %10.2f %14.1f\n", "SearchValue reads", readMs, readMs * 1e6 / propertyReads);
+    std::printf("%-34s %10.2f\n", "SearchValue decode + reads", decodeMs + readMs);
+    std::printf("\nchecksums %s (%zu)\n", checksum == valueChecksum ? "match" : "DIFFER", checksum);
+    return checksum == valueChecksum ? 0 : 1;
+}
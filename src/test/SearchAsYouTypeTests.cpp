@@ -231,6 +231,39 @@ namespace SearchAsYouTypeTests
             Assert::IsTrue(elapsedMs >= 180.0); // Allow some tolerance
         }
 
+        TEST_METHOD(TestDebouncingInVirtualTime)
+        {
+            Logger::WriteMessage(L"Testing debouncing on a virtual clock (no sleeps)");
+            
+            std::vector<std::wstring> scopes = { GetKnownFolderScope(FOLDERID_Documents) };
+            auto clock = std::make_shared<VirtualSearchClock>();
+            SearchAsYouTypeSession search(scopes, {}, {}, std::chrono::milliseconds(100), clock);
+            auto start = clock->Now();
+            
+            // Typing "report" 20ms per keystroke never lets the 100ms delay run out
+            const wchar_t* text = L"report";
+            for (size_t i = 0; i < wcslen(text); ++i)
+            {
+                search.AppendCharacters(std::wstring_view(&text[i], 1));
+                clock->AdvanceBy(std::chrono::milliseconds(20));
+            }
+            clock->AdvanceTo(start + std::chrono::milliseconds(199));
+            Assert::AreEqual(static_cast<size_t>(0), search.GetExecutedQueryCount());
+            Assert::IsTrue(search.IsQueryPending());
+            
+            // The one query starts exactly 100ms after the last keystroke; virtual time does not
+            // move while it runs
+            clock->AdvanceTo(start + std::chrono::milliseconds(200));
+            auto results = search.GetCachedResults();
+            Assert::IsNotNull(results.get());
+            Assert::AreEqual(static_cast<size_t>(1), search.GetExecutedQueryCount());
+            
+            auto snapshot = search.GetResultsSnapshot();
+            Assert::IsTrue(snapshot->searchText == L"report");
+            Assert::AreEqual((start + std::chrono::milliseconds(200)).time_since_epoch().count(), static_cast<long long>(snapshot->startTicks));
+            Assert::AreEqual(0.0, search.GetLastQueryDurationMs());
+        }
+
         TEST_METHOD(TestMultipleScopesSearch)
         {
             Logger::WriteMessage(L"Testing search across multiple scopes");
@@ -267,6 +300,22 @@ namespace SearchAsYouTypeTests
             Assert::IsNotNull(results.get());
         }
 
+        TEST_METHOD(TestAdditionalPropertyColumns)
+        {
+            Logger::WriteMessage(L"Testing additional property columns");
+
+            // Additional property i is column 1 + i, so nothing may be dropped from the list
+            std::vector<std::wstring> scopes = { GetKnownFolderScope(FOLDERID_Documents) };
+            SearchAsYouTypeSession search(scopes, {}, { L"system.size", L"System.ItemNameDisplay" });
+            const auto& ids = search.GetAdditionalPropertyIds();
+            Assert::AreEqual(static_cast<size_t>(2), ids.size());
+            Assert::IsTrue(ids[0] == propid::Size);
+            Assert::IsTrue(ids[1] == propid::ItemNameDisplay);
+
+            Assert::ExpectException<std::invalid_argument>([&] { SearchAsYouTypeSession(scopes, {}, { L"System.Size", L"System.SIZE" }); });
+            Assert::ExpectException<std::invalid_argument>([&] { SearchAsYouTypeSession(scopes, {}, { L"System.ItemUrl" }); });
+        }
+
         TEST_METHOD(TestEmptySearchText)
         {
             Logger::WriteMessage(L"Testing search with empty text");
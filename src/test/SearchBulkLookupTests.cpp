@@ -0,0 +1,288 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#include "pch.h"
+#include <windows.h>
+
+#include <SearchBulkLookup.h>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace wsearch;
+
+namespace SearchBulkLookupTests
+{
+    // Index of item URL -> size. Answers each statement by reading back its
+    // System.ItemUrl literals, and records the statements and how many ran at once.
+    class FakeLookupSource : public IBulkLookupSource<int64_t>
+    {
+    public:
+        explicit FakeLookupSource(std::map<std::wstring, int64_t> items, std::chrono::milliseconds latency = {})
+            : m_items(std::move(items))
+            , m_latency(latency)
+        {
+        }
+
+        void ExecuteLookup(const std::wstring& sql, const EmitRow& emit) override
+        {
+            size_t running = ++m_running;
+            size_t peak = m_peakRunning.load();
+            while (running > peak && !m_peakRunning.compare_exchange_weak(peak, running))
+            {
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_statements.push_back(sql);
+            }
+            std::this_thread::sleep_for(m_latency);
+            --m_running;
+
+            if (sql.find(L"broken") != std::wstring::npos)
+            {
+                throw std::runtime_error("statement failed");
+            }
+
+            for (const auto& url : ReadItemUrls(sql))
+            {
+                // The index compares URLs case-insensitively; it returns its own spelling
+                for (const auto& [itemUrl, size] : m_items)
+                {
+                    if (details::ItemUrlLookupKey(itemUrl) == details::ItemUrlLookupKey(url))
+                    {
+                        emit(itemUrl, int64_t(size));
+                    }
+                }
+            }
+        }
+
+        void OnWorkerThreadStarted() override
+        {
+            ++m_workerThreads;
+        }
+
+        static std::vector<std::wstring> ReadItemUrls(const std::wstring& sql)
+        {
+            static const std::wstring predicate = L"System.ItemUrl = '";
+            std::vector<std::wstring> urls;
+            for (size_t pos = sql.find(predicate); pos != std::wstring::npos; pos = sql.find(predicate, pos))
+            {
+                std::wstring url;
+                for (pos += predicate.size(); pos < sql.size(); ++pos)
+                {
+                    if (sql[pos] == L'\'' && (pos + 1 >= sql.size() || sql[pos + 1] != L'\''))
+                    {
+                        break;
+                    }
+                    url.push_back(sql[pos]);
+                    pos += sql[pos] == L'\'' ? 1 : 0;
+                }
+                urls.push_back(url);
+            }
+            return urls;
+        }
+
+        std::vector<std::wstring> GetStatements()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_statements;
+        }
+
+        size_t GetPeakRunning() const
+        {
+            return m_peakRunning;
+        }
+
+        size_t GetWorkerThreads() const
+        {
+            return m_workerThreads;
+        }
+
+    private:
+        std::map<std::wstring, int64_t> m_items;
+        std::chrono::milliseconds m_latency;
+        std::mutex m_mutex;
+        std::vector<std::wstring> m_statements;
+        std::atomic<size_t> m_running{ 0 };
+        std::atomic<size_t> m_peakRunning{ 0 };
+        std::atomic<size_t> m_workerThreads{ 0 };
+    };
+
+    static std::map<std::wstring, int64_t> BuildIndex(size_t count)
+    {
+        std::map<std::wstring, int64_t> items;
+        for (size_t i = 0; i < count; ++i)
+        {
+            items[L"file:C:/Users/me/Documents/file" + std::to_wstring(i) + L".txt"] = static_cast<int64_t>(i * 10);
+        }
+        return items;
+    }
+
+    TEST_CLASS(SearchBulkLookupTests)
+    {
+    public:
+        TEST_METHOD(TestResultsComeBackInInputOrder)
+        {
+            Logger::WriteMessage(L"Testing input order and missing paths...\n");
+
+            auto source = std::make_shared<FakeLookupSource>(BuildIndex(10));
+            BulkPropertyLookup<int64_t> lookup(source, { L"System.Size" });
+
+            // Windows paths, URLs, other casing, a duplicate and two paths the index doesn't have
+            std::vector<std::wstring> paths = {
+                L"C:\\Users\\me\\Documents\\file7.txt",
+                L"C:\\Users\\me\\Documents\\missing.txt",
+                L"file:C:/Users/me/Documents/file2.txt",
+                L"c:\\users\\ME\\documents\\FILE7.TXT",
+                L"C:\\Users\\me\\Documents\\file99.txt",
+            };
+            auto result = lookup.Lookup(paths);
+
+            Assert::AreEqual(paths.size(), result.entries.size());
+            Assert::AreEqual(static_cast<size_t>(1), result.queries);
+            Assert::AreEqual(static_cast<size_t>(3), result.found);
+            Assert::AreEqual(static_cast<size_t>(2), result.missing);
+
+            Assert::AreEqual(paths[0], result.entries[0].path);
+            Assert::IsTrue(result.entries[0].found);
+            Assert::AreEqual(int64_t(70), result.entries[0].row);
+            Assert::IsFalse(result.entries[1].found);
+            Assert::IsTrue(result.entries[2].found);
+            Assert::AreEqual(int64_t(20), result.entries[2].row);
+            Assert::IsTrue(result.entries[3].found);
+            Assert::AreEqual(int64_t(70), result.entries[3].row);
+            Assert::IsFalse(result.entries[4].found);
+
+            // The duplicate is looked up once
+            Assert::AreEqual(static_cast<size_t>(4), FakeLookupSource::ReadItemUrls(source->GetStatements()[0]).size());
+        }
+
+        TEST_METHOD(TestStatementShape)
+        {
+            Logger::WriteMessage(L"Testing lookup SQL...\n");
+
+            std::vector<std::wstring> properties = { L"System.Size", L"System.Kind" };
+            std::vector<std::wstring> paths = { L"C:\\a.txt", L"D:\\O'Brien\\b.txt" };
+
+            std::wstring sql;
+            details::AppendItemUrlLookupSql(sql, properties, paths.begin(), paths.end());
+            Assert::AreEqual(std::wstring(L"SELECT System.ItemUrl, System.Size, System.Kind FROM SystemIndex WHERE "
+                L"(System.ItemUrl = 'file:C:/a.txt' OR System.ItemUrl = 'file:D:/O''Brien/b.txt')"), sql);
+
+            // Against a primed scope
+            uint64_t whereId = 12;
+            sql.clear();
+            details::AppendItemUrlLookupSql(sql, properties, paths.begin(), paths.begin() + 1, &whereId);
+            Assert::AreEqual(std::wstring(L"SELECT System.ItemUrl, System.Size, System.Kind FROM SystemIndex WHERE "
+                L"REUSEWHERE(12) AND (System.ItemUrl = 'file:C:/a.txt')"), sql);
+
+            auto source = std::make_shared<FakeLookupSource>(BuildIndex(1));
+            BulkLookupOptions options;
+            options.reuseWhereId = 7;
+            BulkPropertyLookup<int64_t> lookup(source, properties, options);
+            lookup.Lookup({ L"C:\\Users\\me\\Documents\\file0.txt" });
+            Assert::IsTrue(source->GetStatements()[0].find(L"WHERE REUSEWHERE(7) AND (") != std::wstring::npos);
+        }
+
+        TEST_METHOD(TestChunksRespectLimits)
+        {
+            Logger::WriteMessage(L"Testing chunking...\n");
+
+            auto index = BuildIndex(1000);
+            std::vector<std::wstring> paths;
+            for (const auto& item : index)
+            {
+                paths.push_back(item.first);
+            }
+
+            BulkLookupOptions options;
+            options.maxPathsPerQuery = 64;
+            options.maxSqlLength = 2000;
+            options.maxConcurrentQueries = 1;
+            auto source = std::make_shared<FakeLookupSource>(index);
+            BulkPropertyLookup<int64_t> lookup(source, { L"System.Size" }, options);
+            auto result = lookup.Lookup(paths);
+
+            Assert::AreEqual(static_cast<size_t>(1000), result.found);
+            size_t looked = 0;
+            for (const auto& sql : source->GetStatements())
+            {
+                auto urls = FakeLookupSource::ReadItemUrls(sql);
+                Assert::IsTrue(urls.size() <= 64);
+                Assert::IsTrue(sql.size() <= 2000);
+                looked += urls.size();
+            }
+            Assert::AreEqual(static_cast<size_t>(1000), looked);
+            Assert::AreEqual(source->GetStatements().size(), result.queries);
+
+            // The path limit applies when paths are short
+            options.maxSqlLength = 1 << 20;
+            auto unbounded = std::make_shared<FakeLookupSource>(index);
+            BulkPropertyLookup<int64_t> byCount(unbounded, { L"System.Size" }, options);
+            Assert::AreEqual(static_cast<size_t>(16), byCount.Lookup(paths).queries);
+
+            // No paths, no statements
+            Assert::AreEqual(static_cast<size_t>(0), byCount.Lookup({}).queries);
+        }
+
+        TEST_METHOD(TestChunksRunConcurrently)
+        {
+            Logger::WriteMessage(L"Testing concurrent chunks...\n");
+
+            auto index = BuildIndex(200);
+            std::vector<std::wstring> paths;
+            for (const auto& item : index)
+            {
+                paths.push_back(item.first);
+            }
+
+            BulkLookupOptions options;
+            options.maxPathsPerQuery = 10;
+            options.maxConcurrentQueries = 4;
+            auto source = std::make_shared<FakeLookupSource>(index, std::chrono::milliseconds(5));
+            BulkPropertyLookup<int64_t> lookup(source, { L"System.Size" }, options);
+            auto result = lookup.Lookup(paths);
+
+            Assert::AreEqual(static_cast<size_t>(20), result.queries);
+            Assert::AreEqual(static_cast<size_t>(200), result.found);
+            Assert::AreEqual(static_cast<size_t>(4), source->GetWorkerThreads());
+            Assert::IsTrue(source->GetPeakRunning() > 1);
+            Assert::IsTrue(source->GetPeakRunning() <= 4);
+            for (size_t i = 0; i < paths.size(); ++i)
+            {
+                Assert::AreEqual(paths[i], result.entries[i].path);
+                Assert::AreEqual(index[paths[i]], result.entries[i].row);
+            }
+        }
+
+        TEST_METHOD(TestFailedStatementIsRethrown)
+        {
+            Logger::WriteMessage(L"Testing statement failure...\n");
+
+            std::vector<std::wstring> paths;
+            for (size_t i = 0; i < 50; ++i)
+            {
+                paths.push_back(i == 33 ? L"C:\\broken.txt" : L"C:\\file" + std::to_wstring(i) + L".txt");
+            }
+
+            BulkLookupOptions options;
+            options.maxPathsPerQuery = 5;
+            BulkPropertyLookup<int64_t> lookup(std::make_shared<FakeLookupSource>(BuildIndex(0)), {}, options);
+
+            bool threw = false;
+            try
+            {
+                lookup.Lookup(paths);
+            }
+            catch (const std::runtime_error&)
+            {
+                threw = true;
+            }
+            Assert::IsTrue(threw);
+        }
+    };
+}
@@ -0,0 +1,195 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#include "pch.h"
+#include <windows.h>
+
+#include <SearchClock.h>
+#include <SearchDebouncer.h>
+#include "SearchDebounceSimulator.h"
+#include "SearchLoadGenerator.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace wsearch;
+using namespace SearchTestUtilities;
+
+namespace SearchClockTests
+{
+    using Clock = ISearchClock::Clock;
+    using std::chrono::milliseconds;
+
+    TEST_CLASS(SearchClockTests)
+    {
+    public:
+        TEST_METHOD(TestVirtualClock)
+        {
+            Logger::WriteMessage(L"Testing virtual time, sleeps and timed waits...\n");
+
+            auto start = Clock::time_point(std::chrono::hours(1));
+            VirtualSearchClock clock(start);
+            Assert::IsTrue(clock.Now() == start);
+            clock.AdvanceBy(milliseconds(5));
+            clock.AdvanceTo(start); // never back
+            Assert::IsTrue(clock.Now() == start + milliseconds(5));
+
+            // A sleeper wakes when the clock reaches its deadline, not before
+            std::atomic<bool> woke{ false };
+            std::thread sleeper([&] {
+                clock.SleepFor(milliseconds(100));
+                woke = true;
+            });
+            clock.WaitForDeadline(start + milliseconds(105));
+            Assert::IsTrue(clock.GetNextDeadline() == start + milliseconds(105));
+            Assert::AreEqual(static_cast<size_t>(0), clock.AdvanceBy(milliseconds(99)));
+            Assert::IsFalse(woke.load());
+            Assert::IsTrue(clock.AdvanceToNextDeadline());
+            sleeper.join();
+            Assert::IsTrue(woke.load());
+            Assert::IsTrue(clock.Now() == start + milliseconds(105));
+            Assert::IsFalse(clock.AdvanceToNextDeadline());
+
+            // A timed wait returns on its condition or on its deadline, whichever comes first
+            std::mutex mutex;
+            std::condition_variable_any cv;
+            bool ready = false;
+            bool satisfied = true;
+            std::thread waiter([&] {
+                std::unique_lock<std::mutex> lock(mutex);
+                satisfied = clock.WaitUntil(cv, lock, clock.Now() + milliseconds(10), [&] { return ready; });
+            });
+            clock.WaitForWaiters(1);
+            clock.AdvanceBy(milliseconds(10));
+            waiter.join();
+            Assert::IsFalse(satisfied);
+
+            std::thread notified([&] {
+                std::unique_lock<std::mutex> lock(mutex);
+                satisfied = clock.WaitUntil(cv, lock, Clock::time_point::max(), [&] { return ready; });
+            });
+            clock.WaitForWaiters(1);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ready = true;
+            }
+            cv.notify_all();
+            notified.join();
+            Assert::IsTrue(satisfied);
+            Assert::AreEqual(static_cast<size_t>(0), clock.GetWaiterCount());
+        }
+
+        TEST_METHOD(TestDebouncer)
+        {
+            Logger::WriteMessage(L"Testing the debounce policy...\n");
+
+            auto start = Clock::time_point(std::chrono::hours(1));
+            Debouncer debounce(milliseconds(50));
+            Assert::IsFalse(debounce.IsPending());
+            Assert::AreEqual(static_cast<uint64_t>(0), debounce.TryDispatch(start));
+
+            // Every change restarts the delay
+            Assert::AreEqual(static_cast<uint64_t>(1), debounce.OnChanged(start));
+            Assert::AreEqual(static_cast<uint64_t>(2), debounce.OnChanged(start + milliseconds(30)));
+            Assert::IsTrue(debounce.GetDeadline() == start + milliseconds(80));
+            Assert::AreEqual(static_cast<uint64_t>(0), debounce.TryDispatch(start + milliseconds(79)));
+            Assert::AreEqual(static_cast<uint64_t>(2), debounce.TryDispatch(start + milliseconds(80)));
+            Assert::IsFalse(debounce.IsPending());
+            Assert::AreEqual(static_cast<uint64_t>(0), debounce.TryDispatch(start + milliseconds(500)));
+
+            // Changing the delay moves a pending deadline; scope changes are due at once
+            debounce.OnChanged(start + milliseconds(100));
+            debounce.SetDelay(milliseconds(200));
+            Assert::IsTrue(debounce.GetDeadline() == start + milliseconds(300));
+            Assert::AreEqual(static_cast<uint64_t>(4), debounce.OnChangedDueNow(start + milliseconds(110)));
+            Assert::AreEqual(static_cast<uint64_t>(4), debounce.TryDispatch(start + milliseconds(110)));
+
+            // Dispatch cancels the pending query (ExecuteQueryNow, Clear)
+            debounce.OnChanged(start + milliseconds(120));
+            Assert::AreEqual(static_cast<uint64_t>(5), debounce.Dispatch());
+            Assert::IsFalse(debounce.IsPending());
+            Assert::AreEqual(static_cast<uint64_t>(5), debounce.GetRevision());
+        }
+
+        TEST_METHOD(TestSessionInVirtualTime)
+        {
+            Logger::WriteMessage(L"Testing a session's debouncing step by step in virtual time...\n");
+
+            auto clock = std::make_shared<VirtualSearchClock>();
+            SimulatedProviderOptions providerOptions;
+            providerOptions.baseLatency = std::chrono::microseconds(30000);
+            providerOptions.clock = clock;
+            auto provider = std::make_shared<SimulatedSearchProvider>(nullptr, providerOptions);
+            SimulatedSearchAsYouTypeSession session(provider, milliseconds(50), clock);
+            auto start = clock->Now();
+
+            // Keystrokes 20ms apart never let the 50ms delay run out
+            for (wchar_t ch : std::wstring(L"report"))
+            {
+                session.AppendCharacters(std::wstring_view(&ch, 1));
+                clock->AdvanceBy(milliseconds(20));
+            }
+            clock->AdvanceTo(start + milliseconds(149));
+            Assert::AreEqual(static_cast<size_t>(0), session.GetExecutedQueryCount());
+            Assert::IsTrue(session.IsQueryPending());
+
+            // 50ms after the last keystroke the query starts and takes the provider's 30ms
+            clock->AdvanceTo(start + milliseconds(150));
+            clock->WaitForDeadline(start + milliseconds(180));
+            Assert::IsTrue(session.IsQueryPending());
+            clock->AdvanceTo(start + milliseconds(180));
+            session.GetCachedResults();
+
+            auto snapshot = session.GetResultsSnapshot();
+            Assert::AreEqual(static_cast<size_t>(1), session.GetExecutedQueryCount());
+            Assert::IsTrue(snapshot->searchText == L"report");
+            Assert::AreEqual((start + milliseconds(150)).time_since_epoch().count(), static_cast<Clock::rep>(snapshot->startTicks));
+            Assert::AreEqual(30.0, snapshot->durationMs, 1e-9);
+            Assert::IsFalse(session.IsQueryPending());
+
+            // Text with nothing to search for runs no query; the results are cleared
+            session.SetSearchText(L"-");
+            clock->AdvanceBy(milliseconds(50));
+            session.GetCachedResults();
+            snapshot = session.GetResultsSnapshot();
+            Assert::AreEqual(static_cast<size_t>(1), session.GetExecutedQueryCount());
+            Assert::IsTrue(snapshot->searchText == L"-");
+            Assert::AreEqual(static_cast<size_t>(0), snapshot->result);
+            Assert::IsFalse(snapshot->failed);
+        }
+
+        TEST_METHOD(TestSimulator)
+        {
+            Logger::WriteMessage(L"Testing the virtual-time debounce simulator...\n");
+
+            DebounceSimulationOptions options;
+            options.phrases = 2000;
+            options.queryLatencyJitter = std::chrono::microseconds(0);
+
+            // Same seed, same run
+            auto first = DebounceSimulator::Run(options);
+            auto second = DebounceSimulator::Run(options);
+            Assert::AreEqual(first.keystrokes, second.keystrokes);
+            Assert::AreEqual(first.queries, second.queries);
+            Assert::AreEqual(first.staleQueries, second.staleQueries);
+            Assert::IsTrue(first.settleLatency.samplesMs == second.settleLatency.samplesMs);
+            Assert::IsTrue(first.simulatedSeconds > 60.0);
+
+            // Longer delays send fewer queries, and results never settle sooner than delay + latency
+            auto results = DebounceSimulator::SweepDelays(options, { milliseconds(0), milliseconds(50), milliseconds(300) });
+            for (size_t i = 0; i < results.size(); ++i)
+            {
+                const auto& run = results[i];
+                Assert::AreEqual(first.keystrokes, run.keystrokes);
+                Assert::IsTrue(run.queries >= run.phrases);
+                Assert::IsTrue(i == 0 || run.queries <= results[i - 1].queries);
+                double fastest = static_cast<double>(run.debounceDelay.count()) + 20.0;
+                Assert::IsTrue(run.settleLatency.PercentileMs(0.0) >= fastest - 1e-6);
+            }
+            Assert::IsTrue(results.back().queries < results.front().queries / 4);
+
+            Logger::WriteMessage(DebounceSimulator::FormatReport(results).c_str());
+        }
+    };
+}
@@ -0,0 +1,646 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cwctype>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace SearchTestUtilities
+{
+    /* CorpusRandom - Small deterministic random source for corpus generation
+     *
+     * The standard <random> distributions are implementation defined, so the same seed
+     * produces different corpora on different toolsets. This uses splitmix64 and does its
+     * own distribution math so a (seed, index) pair always yields the same item.
+     */
+    class CorpusRandom
+    {
+    public:
+        explicit CorpusRandom(uint64_t seed)
+            : m_state(seed)
+        {
+        }
+
+        uint64_t Next()
+        {
+            uint64_t z = (m_state += 0x9E3779B97F4A7C15ull);
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+
+        // Uniform double in [0, 1) with 53 bits of precision
+        double NextDouble()
+        {
+            return static_cast<double>(Next() >> 11) * (1.0 / 9007199254740992.0);
+        }
+
+        // Uniform integer in [low, high]
+        uint64_t NextInRange(uint64_t low, uint64_t high)
+        {
+            if (high <= low)
+            {
+                return low;
+            }
+            return low + (Next() % (high - low + 1));
+        }
+
+        // Standard normal sample (Box-Muller)
+        double NextGaussian()
+        {
+            double u1 = NextDouble();
+            double u2 = NextDouble();
+            if (u1 < 1e-300)
+            {
+                u1 = 1e-300;
+            }
+            return std::sqrt(-2.0 * std::log(u1)) * std::cos(6.283185307179586 * u2);
+        }
+
+        // Exponential sample with the given mean
+        double NextExponential(double mean)
+        {
+            return -mean * std::log(1.0 - NextDouble());
+        }
+
+        // Derive an independent stream for item 'index' of a corpus seeded with 'seed'
+        static CorpusRandom ForIndex(uint64_t seed, uint64_t index)
+        {
+            CorpusRandom mixer(seed ^ (index * 0xD6E8FEB86659FD93ull));
+            return CorpusRandom(mixer.Next());
+        }
+
+    private:
+        uint64_t m_state;
+    };
+
+    /* ZipfDistribution - Samples ranks [0, n) with probability proportional to 1 / (rank + 1)^s
+     *
+     * The CDF is precomputed once so each sample is a binary search.
+     */
+    class ZipfDistribution
+    {
+    public:
+        ZipfDistribution(size_t n, double exponent)
+        {
+            m_cdf.resize((std::max)(n, static_cast<size_t>(1)));
+            double sum = 0.0;
+            for (size_t i = 0; i < m_cdf.size(); ++i)
+            {
+                sum += 1.0 / std::pow(static_cast<double>(i + 1), exponent);
+                m_cdf[i] = sum;
+            }
+            for (auto& value : m_cdf)
+            {
+                value /= sum;
+            }
+        }
+
+        size_t Sample(CorpusRandom& random) const
+        {
+            double u = random.NextDouble();
+            auto it = std::upper_bound(m_cdf.begin(), m_cdf.end(), u);
+            if (it == m_cdf.end())
+            {
+                return m_cdf.size() - 1;
+            }
+            return static_cast<size_t>(it - m_cdf.begin());
+        }
+
+        size_t Size() const
+        {
+            return m_cdf.size();
+        }
+
+    private:
+        std::vector<double> m_cdf;
+    };
+
+    // Parameters for a synthetic corpus. Two generators with equal options produce identical corpora.
+    struct CorpusOptions
+    {
+        uint64_t seed = 0x5EA2C4C0;
+        size_t itemCount = 10000;
+
+        // Directory tree shape
+        std::wstring rootPath = L"C:\\SearchCorpus";
+        size_t folderCount = 500;
+        size_t maxFolderFanOut = 12;
+        size_t maxDepth = 8;
+
+        // Name tokens
+        size_t vocabularySize = 20000;
+        double tokenZipfExponent = 1.07;
+        size_t minTokensPerName = 1;
+        size_t maxTokensPerName = 4;
+
+        // Extensions and folder popularity
+        double extensionZipfExponent = 1.3;
+        double folderZipfExponent = 0.9;
+        double folderItemFraction = 0.05;
+
+        // Dates are FILETIME ticks (100ns since 1601-01-01 UTC)
+        uint64_t newestDate = 133500000000000000ull; // ~2024-01-20
+        uint32_t historyDays = 5 * 365;
+
+        // Click history
+        double clickedFraction = 0.08;
+        double clickZipfExponent = 1.5;
+        uint32_t maxClicks = 200;
+    };
+
+    // One synthetic item. Mirrors the columns the query builder selects.
+    struct CorpusItem
+    {
+        uint64_t index = 0;
+        std::wstring path;          // C:\root\folder\name.ext
+        std::wstring url;           // file:///C:/root/folder/name.ext
+        std::wstring name;          // System.ItemNameDisplay
+        std::wstring extension;     // System.FileExtension (".docx")
+        std::wstring kind;          // System.Kind ("document")
+        std::vector<std::wstring> tokens;
+        uint64_t size = 0;
+        uint64_t dateCreated = 0;
+        uint64_t dateModified = 0;
+        uint64_t dateAccessed = 0;
+        uint32_t clickCount = 0;            // System.Document.LineCount
+        std::vector<uint64_t> clickHistory; // FILETIME of each click, oldest first
+        bool isFolder = false;
+    };
+
+    /* CorpusRowSource - In-memory row source fed directly by the generator
+     *
+     * Holds generated items and answers simple name-token prefix queries, which is
+     * enough to stand in for the indexer in scale benchmarks that don't need COM.
+     */
+    class CorpusRowSource
+    {
+    public:
+        void Reserve(size_t count)
+        {
+            m_items.reserve(count);
+        }
+
+        void Append(CorpusItem item)
+        {
+            m_items.push_back(std::move(item));
+        }
+
+        const std::vector<CorpusItem>& GetItems() const
+        {
+            return m_items;
+        }
+
+        size_t GetItemCount() const
+        {
+            return m_items.size();
+        }
+
+        // Items with a name token starting with 'prefix' (case-insensitive), in corpus order.
+        // maxRows == 0 returns every match.
+        std::vector<const CorpusItem*> FindByTokenPrefix(std::wstring_view prefix, size_t maxRows = 0) const
+        {
+            std::vector<const CorpusItem*> matches;
+            for (const auto& item : m_items)
+            {
+                for (const auto& token : item.tokens)
+                {
+                    if (StartsWithNoCase(token, prefix))
+                    {
+                        matches.push_back(&item);
+                        break;
+                    }
+                }
+
+                if (maxRows != 0 && matches.size() >= maxRows)
+                {
+                    break;
+                }
+            }
+            return matches;
+        }
+
+    private:
+        static bool StartsWithNoCase(std::wstring_view text, std::wstring_view prefix)
+        {
+            if (prefix.size() > text.size())
+            {
+                return false;
+            }
+            for (size_t i = 0; i < prefix.size(); ++i)
+            {
+                if (towlower(text[i]) != towlower(prefix[i]))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        std::vector<CorpusItem> m_items;
+    };
+
+    /* CorpusGenerator - Deterministic, seedable synthetic corpus for scale testing
+     *
+     * Produces a realistic folder tree, Zipf-distributed name tokens, extensions and kinds,
+     * log-normal sizes, ordered created/modified/accessed dates and click histories.
+     * Items are derived from (seed, index) so any item can be regenerated on its own and
+     * multi-million item corpora can be streamed without holding them in memory.
+     *
+     * Example:
+     *   CorpusOptions options;
+     *   options.itemCount = 500000;
+     *   CorpusGenerator generator(options);
+     *
+     *   CorpusRowSource rows;
+     *   generator.StreamTo(rows);                        // in-memory
+     *   generator.WriteToDirectory(GetTestFolderPath()); // or a real tree
+     */
+    class CorpusGenerator
+    {
+    public:
+        explicit CorpusGenerator(CorpusOptions options)
+            : m_options(std::move(options))
+            , m_tokenDistribution(m_options.vocabularySize, m_options.tokenZipfExponent)
+            , m_extensionDistribution(GetExtensionTable().size(), m_options.extensionZipfExponent)
+            , m_folderDistribution(1, m_options.folderZipfExponent)
+            , m_clickDistribution(m_options.maxClicks, m_options.clickZipfExponent)
+        {
+            BuildVocabulary();
+            BuildFolderTree();
+            m_folderDistribution = ZipfDistribution(m_folders.size(), m_options.folderZipfExponent);
+        }
+
+        const CorpusOptions& GetOptions() const
+        {
+            return m_options;
+        }
+
+        const std::vector<std::wstring>& GetVocabulary() const
+        {
+            return m_vocabulary;
+        }
+
+        // Folder paths relative to the corpus root, parents before children
+        const std::vector<std::wstring>& GetFolders() const
+        {
+            return m_folders;
+        }
+
+        // Generate item 'index' (0 <= index < itemCount). Pure function of (options, index).
+        CorpusItem GenerateItem(uint64_t index) const
+        {
+            CorpusRandom random = CorpusRandom::ForIndex(m_options.seed, index);
+
+            CorpusItem item;
+            item.index = index;
+            item.isFolder = random.NextDouble() < m_options.folderItemFraction;
+
+            // Name tokens
+            size_t tokenCount = static_cast<size_t>(
+                random.NextInRange(m_options.minTokensPerName, (std::max)(m_options.minTokensPerName, m_options.maxTokensPerName)));
+            for (size_t i = 0; i < tokenCount; ++i)
+            {
+                item.tokens.push_back(m_vocabulary[m_tokenDistribution.Sample(random)]);
+            }
+
+            std::wstring stem;
+            wchar_t separator = SeparatorFor(random);
+            for (size_t i = 0; i < item.tokens.size(); ++i)
+            {
+                if (i > 0)
+                {
+                    stem += separator;
+                }
+                stem += item.tokens[i];
+            }
+
+            // Single-token names collide constantly, suffix them (and a share of the rest) with the index
+            if (item.tokens.size() == 1 || (random.Next() & 3) == 0)
+            {
+                stem += L'_';
+                stem += std::to_wstring(index);
+            }
+
+            if (item.isFolder)
+            {
+                item.kind = L"folder";
+                item.name = stem;
+                item.size = 0;
+            }
+            else
+            {
+                const auto& extension = GetExtensionTable()[m_extensionDistribution.Sample(random)];
+                item.extension = extension.extension;
+                item.kind = extension.kind;
+                item.name = stem + item.extension;
+
+                double logSize = extension.logMeanSize + extension.logSizeStdDev * random.NextGaussian();
+                item.size = static_cast<uint64_t>((std::max)(0.0, std::exp(logSize)));
+            }
+
+            // Folder placement: a few folders hold most of the items
+            const std::wstring& folder = m_folders[m_folderDistribution.Sample(random)];
+            item.path = m_options.rootPath;
+            if (!folder.empty())
+            {
+                item.path += L'\\';
+                item.path += folder;
+            }
+            item.path += L'\\';
+            item.path += item.name;
+            item.url = PathToUrl(item.path);
+
+            // Dates: created <= modified <= accessed <= newestDate
+            const uint64_t ticksPerDay = 864000000000ull;
+            uint64_t range = static_cast<uint64_t>(m_options.historyDays) * ticksPerDay;
+            uint64_t oldest = m_options.newestDate > range ? m_options.newestDate - range : 0;
+            item.dateCreated = random.NextInRange(oldest, m_options.newestDate);
+            uint64_t modifiedGap = static_cast<uint64_t>(random.NextExponential(30.0 * static_cast<double>(ticksPerDay)));
+            item.dateModified = (std::min)(item.dateCreated + modifiedGap, m_options.newestDate);
+            uint64_t accessedGap = static_cast<uint64_t>(random.NextExponential(7.0 * static_cast<double>(ticksPerDay)));
+            item.dateAccessed = (std::min)(item.dateModified + accessedGap, m_options.newestDate);
+
+            // Click history: most items are never opened, a few are opened a lot
+            if (random.NextDouble() < m_options.clickedFraction)
+            {
+                item.clickCount = static_cast<uint32_t>(m_clickDistribution.Sample(random) + 1);
+                item.clickHistory.reserve(item.clickCount);
+                for (uint32_t i = 0; i < item.clickCount; ++i)
+                {
+                    item.clickHistory.push_back(random.NextInRange(item.dateModified, m_options.newestDate));
+                }
+                std::sort(item.clickHistory.begin(), item.clickHistory.end());
+                item.dateAccessed = (std::max)(item.dateAccessed, item.clickHistory.back());
+            }
+
+            return item;
+        }
+
+        // Invoke callback(CorpusItem&&) for every item in index order
+        template <typename Func>
+        void ForEachItem(Func callback) const
+        {
+            for (uint64_t i = 0; i < m_options.itemCount; ++i)
+            {
+                callback(GenerateItem(i));
+            }
+        }
+
+        // Stream the whole corpus into an in-memory row source
+        void StreamTo(CorpusRowSource& rowSource) const
+        {
+            rowSource.Reserve(rowSource.GetItemCount() + m_options.itemCount);
+            ForEachItem([&](CorpusItem&& item) { rowSource.Append(std::move(item)); });
+        }
+
+        /* Write the corpus to a real filesystem tree under 'rootPath'
+         *
+         * Folders are created, files get their name tokens as content (so content queries match)
+         * and their last write time is set to the generated modified date. Sizes are not
+         * materialized unless 'materializeSizes' is set, which pads each file to its generated size.
+         * Returns the number of files and folders written.
+         */
+        size_t WriteToDirectory(const std::wstring& rootPath, bool materializeSizes = false) const
+        {
+            std::filesystem::create_directories(rootPath);
+            for (const auto& folder : m_folders)
+            {
+                if (!folder.empty())
+                {
+                    std::filesystem::create_directories(std::filesystem::path(rootPath) / ToRelativePath(folder));
+                }
+            }
+
+            size_t written = 0;
+            ForEachItem([&](CorpusItem&& item) {
+                std::filesystem::path target = std::filesystem::path(rootPath) /
+                    ToRelativePath(std::wstring_view(item.path).substr(m_options.rootPath.length() + 1));
+
+                if (item.isFolder)
+                {
+                    std::filesystem::create_directories(target);
+                    ++written;
+                    return;
+                }
+
+                if (std::filesystem::exists(target))
+                {
+                    return; // name collision within a folder, first writer wins
+                }
+
+                {
+                    std::wofstream file(target);
+                    if (!file.is_open())
+                    {
+                        return;
+                    }
+
+                    for (const auto& token : item.tokens)
+                    {
+                        file << token << L' ';
+                    }
+                    file << L'\n';
+
+                    if (materializeSizes)
+                    {
+                        uint64_t remaining = item.size;
+                        std::wstring filler(4096, L'x');
+                        while (remaining > 0)
+                        {
+                            size_t chunk = static_cast<size_t>((std::min)(remaining, static_cast<uint64_t>(filler.size())));
+                            file.write(filler.data(), static_cast<std::streamsize>(chunk));
+                            remaining -= chunk;
+                        }
+                    }
+                }
+
+                std::error_code ec;
+                std::filesystem::last_write_time(target, FileTimeFromTicks(item.dateModified), ec);
+                ++written;
+            });
+
+            return written;
+        }
+
+        // Convert a C:\a\b path to the file:///C:/a/b form the indexer returns in System.ItemUrl
+        static std::wstring PathToUrl(std::wstring_view path)
+        {
+            std::wstring url(L"file:///");
+            url.reserve(url.size() + path.size());
+            for (wchar_t ch : path)
+            {
+                url += (ch == L'\\') ? L'/' : ch;
+            }
+            return url;
+        }
+
+    private:
+        struct ExtensionInfo
+        {
+            const wchar_t* extension;
+            const wchar_t* kind;
+            double logMeanSize;
+            double logSizeStdDev;
+        };
+
+        // Ordered by real-world popularity, the Zipf rank picks from the front most often
+        static const std::vector<ExtensionInfo>& GetExtensionTable()
+        {
+            static const std::vector<ExtensionInfo> table = {
+                { L".jpg",  L"picture",  13.5, 1.0 },
+                { L".docx", L"document", 10.5, 1.2 },
+                { L".pdf",  L"document", 12.0, 1.5 },
+                { L".txt",  L"document",  8.0, 2.0 },
+                { L".png",  L"picture",  11.5, 1.5 },
+                { L".xlsx", L"document", 10.0, 1.3 },
+                { L".mp3",  L"music",    15.0, 0.6 },
+                { L".pptx", L"document", 13.5, 1.2 },
+                { L".mp4",  L"video",    18.0, 1.5 },
+                { L".lnk",  L"link",      7.0, 0.3 },
+                { L".log",  L"document",  9.0, 2.5 },
+                { L".eml",  L"email",    10.5, 1.0 },
+                { L".exe",  L"program",  14.0, 2.0 },
+                { L".vcf",  L"contact",   6.5, 0.5 },
+                { L".heic", L"picture",  14.0, 0.8 },
+                { L".wav",  L"music",    16.0, 1.0 },
+            };
+            return table;
+        }
+
+        static wchar_t SeparatorFor(CorpusRandom& random)
+        {
+            static const wchar_t separators[] = { L' ', L'_', L'-', L' ' };
+            return separators[random.Next() % 4];
+        }
+
+        void BuildVocabulary()
+        {
+            // The most frequent ranks are real words users type, the long tail is pronounceable noise
+            static const wchar_t* commonWords[] = {
+                L"report", L"project", L"notes", L"meeting", L"budget", L"final", L"draft", L"invoice",
+                L"photo", L"summary", L"plan", L"review", L"presentation", L"annual", L"quarterly",
+                L"forecast", L"design", L"spec", L"resume", L"contract", L"schedule", L"team", L"sales",
+                L"marketing", L"customer", L"feedback", L"roadmap", L"proposal", L"agenda", L"minutes",
+                L"backup", L"scan", L"receipt", L"statement", L"tax", L"travel", L"vacation", L"family",
+                L"screenshot", L"document", L"copy", L"new", L"old", L"v2", L"2023", L"2024", L"january",
+                L"february", L"march", L"april", L"employee", L"handbook", L"policy", L"technical",
+                L"specification", L"architecture", L"release", L"product", L"music", L"video", L"readme"
+            };
+            static const wchar_t* onsets[] = { L"b", L"c", L"d", L"f", L"g", L"h", L"k", L"l", L"m", L"n",
+                                               L"p", L"r", L"s", L"t", L"v", L"w", L"st", L"tr", L"pl", L"br" };
+            static const wchar_t* vowels[] = { L"a", L"e", L"i", L"o", L"u", L"ai", L"ea", L"ou" };
+            static const wchar_t* codas[] = { L"", L"n", L"r", L"s", L"t", L"x", L"nd", L"ll" };
+
+            m_vocabulary.reserve(m_options.vocabularySize);
+            for (const wchar_t* word : commonWords)
+            {
+                if (m_vocabulary.size() >= m_options.vocabularySize)
+                {
+                    break;
+                }
+                m_vocabulary.emplace_back(word);
+            }
+
+            CorpusRandom random(m_options.seed ^ 0x766F636162756C61ull);
+            while (m_vocabulary.size() < (std::max)(m_options.vocabularySize, static_cast<size_t>(1)))
+            {
+                std::wstring word;
+                size_t syllables = static_cast<size_t>(random.NextInRange(1, 3));
+                for (size_t s = 0; s < syllables; ++s)
+                {
+                    word += onsets[random.Next() % std::size(onsets)];
+                    word += vowels[random.Next() % std::size(vowels)];
+                    word += codas[random.Next() % std::size(codas)];
+                }
+                m_vocabulary.push_back(std::move(word));
+            }
+        }
+
+        void BuildFolderTree()
+        {
+            // Breadth-first growth: each new folder picks an existing parent, favoring shallow,
+            // early folders, so the tree has a few wide hubs and long thin tails
+            CorpusRandom random(m_options.seed ^ 0x666F6C6465727321ull);
+            std::vector<size_t> depth;
+            std::vector<size_t> childCount;
+
+            m_folders.push_back(L""); // the root itself
+            depth.push_back(0);
+            childCount.push_back(0);
+
+            ZipfDistribution nameDistribution((std::min)(m_vocabulary.size(), static_cast<size_t>(2000)), 1.0);
+            size_t attempts = 0;
+            while (m_folders.size() < (std::max)(m_options.folderCount, static_cast<size_t>(1)) &&
+                   attempts < m_options.folderCount * 16)
+            {
+                ++attempts;
+                size_t parent = static_cast<size_t>(random.NextInRange(0, m_folders.size() - 1) *
+                                                    random.NextDouble());
+                if (depth[parent] + 1 > m_options.maxDepth || childCount[parent] >= m_options.maxFolderFanOut)
+                {
+                    continue;
+                }
+
+                std::wstring name = m_vocabulary[nameDistribution.Sample(random)];
+                name += L'_';
+                name += std::to_wstring(m_folders.size());
+
+                std::wstring path = m_folders[parent].empty() ? name : m_folders[parent] + L'\\' + name;
+                m_folders.push_back(std::move(path));
+                depth.push_back(depth[parent] + 1);
+                childCount.push_back(0);
+                ++childCount[parent];
+            }
+        }
+
+        // Corpus paths always use '\\', build the relative path segment by segment
+        static std::filesystem::path ToRelativePath(std::wstring_view relative)
+        {
+            std::filesystem::path result;
+            size_t start = 0;
+            while (start <= relative.size())
+            {
+                size_t end = relative.find(L'\\', start);
+                if (end == std::wstring_view::npos)
+                {
+                    end = relative.size();
+                }
+                if (end > start)
+                {
+                    result /= std::wstring(relative.substr(start, end - start));
+                }
+                start = end + 1;
+            }
+            return result;
+        }
+
+        static std::filesystem::file_time_type FileTimeFromTicks(uint64_t fileTimeTicks)
+        {
+            // Offset from "now" so this works regardless of the file_clock epoch
+            const uint64_t unixEpochTicks = 116444736000000000ull;
+            auto nowTicks = static_cast<int64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::system_clock::now().time_since_epoch()).count() / 100) +
+                static_cast<int64_t>(unixEpochTicks);
+            auto delta = std::chrono::nanoseconds((nowTicks - static_cast<int64_t>(fileTimeTicks)) * 100);
+            return std::filesystem::file_time_type::clock::now() -
+                   std::chrono::duration_cast<std::filesystem::file_time_type::duration>(delta);
+        }
+
+        CorpusOptions m_options;
+        ZipfDistribution m_tokenDistribution;
+        ZipfDistribution m_extensionDistribution;
+        ZipfDistribution m_folderDistribution;
+        ZipfDistribution m_clickDistribution;
+        std::vector<std::wstring> m_vocabulary;
+        std::vector<std::wstring> m_folders;
+    };
+}
@@ -0,0 +1,180 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#include "pch.h"
+#include <windows.h>
+#include "SearchCorpusGenerator.h"
+#include <map>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace SearchTestUtilities;
+
+namespace SearchCorpusGeneratorTests
+{
+    TEST_CLASS(SearchCorpusGeneratorTests)
+    {
+    public:
+        TEST_METHOD(TestSameSeedProducesSameCorpus)
+        {
+            Logger::WriteMessage(L"Testing corpus determinism...\n");
+
+            CorpusOptions options;
+            options.itemCount = 2000;
+
+            CorpusGenerator first(options);
+            CorpusGenerator second(options);
+
+            for (uint64_t i = 0; i < options.itemCount; ++i)
+            {
+                auto a = first.GenerateItem(i);
+                auto b = second.GenerateItem(i);
+                Assert::AreEqual(a.path, b.path);
+                Assert::AreEqual(a.size, b.size);
+                Assert::AreEqual(a.dateModified, b.dateModified);
+                Assert::AreEqual(a.clickCount, b.clickCount);
+            }
+        }
+
+        TEST_METHOD(TestDifferentSeedProducesDifferentCorpus)
+        {
+            Logger::WriteMessage(L"Testing that seeds change the corpus...\n");
+
+            CorpusOptions options;
+            options.itemCount = 100;
+            CorpusGenerator first(options);
+
+            options.seed += 1;
+            CorpusGenerator second(options);
+
+            size_t differences = 0;
+            for (uint64_t i = 0; i < options.itemCount; ++i)
+            {
+                if (first.GenerateItem(i).path != second.GenerateItem(i).path)
+                {
+                    ++differences;
+                }
+            }
+            Assert::IsTrue(differences > 90);
+        }
+
+        TEST_METHOD(TestItemRegeneratesIndependentlyOfOrder)
+        {
+            Logger::WriteMessage(L"Testing random access item generation...\n");
+
+            CorpusOptions options;
+            options.itemCount = 1000;
+            CorpusGenerator generator(options);
+
+            CorpusRowSource rows;
+            generator.StreamTo(rows);
+
+            Assert::AreEqual(options.itemCount, rows.GetItemCount());
+            Assert::AreEqual(rows.GetItems()[777].path, generator.GenerateItem(777).path);
+        }
+
+        TEST_METHOD(TestTokensAreZipfDistributed)
+        {
+            Logger::WriteMessage(L"Testing name token skew...\n");
+
+            CorpusOptions options;
+            options.itemCount = 20000;
+            CorpusGenerator generator(options);
+
+            std::map<std::wstring, size_t> counts;
+            generator.ForEachItem([&](CorpusItem&& item) {
+                for (const auto& token : item.tokens)
+                {
+                    ++counts[token];
+                }
+            });
+
+            // Rank 0 should dwarf a mid-vocabulary rank
+            const auto& vocabulary = generator.GetVocabulary();
+            size_t head = counts[vocabulary[0]];
+            size_t middle = counts[vocabulary[vocabulary.size() / 2]];
+            Assert::IsTrue(head > 10 * (middle + 1));
+        }
+
+        TEST_METHOD(TestItemInvariants)
+        {
+            Logger::WriteMessage(L"Testing item field invariants...\n");
+
+            CorpusOptions options;
+            options.itemCount = 5000;
+            CorpusGenerator generator(options);
+
+            size_t clicked = 0;
+            generator.ForEachItem([&](CorpusItem&& item) {
+                Assert::IsTrue(item.dateCreated <= item.dateModified);
+                Assert::IsTrue(item.dateModified <= item.dateAccessed);
+                Assert::IsTrue(item.dateAccessed <= options.newestDate);
+                Assert::IsTrue(item.path.find(options.rootPath) == 0);
+                Assert::IsTrue(item.url.find(L"file:///") == 0);
+                Assert::IsFalse(item.kind.empty());
+                Assert::AreEqual(static_cast<size_t>(item.clickCount), item.clickHistory.size());
+                Assert::IsTrue(std::is_sorted(item.clickHistory.begin(), item.clickHistory.end()));
+                if (item.isFolder)
+                {
+                    Assert::IsTrue(item.extension.empty());
+                }
+                if (item.clickCount > 0)
+                {
+                    ++clicked;
+                }
+            });
+
+            // Roughly clickedFraction of items have history
+            Assert::IsTrue(clicked > options.itemCount / 50);
+            Assert::IsTrue(clicked < options.itemCount / 4);
+        }
+
+        TEST_METHOD(TestRowSourcePrefixQuery)
+        {
+            Logger::WriteMessage(L"Testing in-memory row source prefix queries...\n");
+
+            CorpusOptions options;
+            options.itemCount = 5000;
+            CorpusGenerator generator(options);
+
+            CorpusRowSource rows;
+            generator.StreamTo(rows);
+
+            auto all = rows.FindByTokenPrefix(L"rep");
+            auto limited = rows.FindByTokenPrefix(L"REP", 10);
+
+            Assert::IsTrue(all.size() > 10);
+            Assert::AreEqual(static_cast<size_t>(10), limited.size());
+            Assert::AreEqual(all[0]->path, limited[0]->path);
+        }
+
+        TEST_METHOD(TestWriteToDirectory)
+        {
+            Logger::WriteMessage(L"Testing corpus materialization to disk...\n");
+
+            wchar_t tempPath[MAX_PATH];
+            GetTempPathW(MAX_PATH, tempPath);
+            std::wstring root = std::wstring(tempPath) + L"SearchCorpusTests_" + std::to_wstring(GetTickCount64());
+
+            CorpusOptions options;
+            options.itemCount = 200;
+            options.folderCount = 20;
+            options.rootPath = root;
+            CorpusGenerator generator(options);
+
+            size_t written = generator.WriteToDirectory(root);
+
+            size_t onDisk = 0;
+            for (const auto& entry : std::filesystem::recursive_directory_iterator(root))
+            {
+                if (entry.is_regular_file())
+                {
+                    ++onDisk;
+                }
+            }
+
+            std::filesystem::remove_all(root);
+
+            Assert::IsTrue(written > 150);
+            Assert::IsTrue(onDisk > 0);
+            Assert::IsTrue(onDisk <= written);
+        }
+    };
+}
@@ -0,0 +1,163 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#include "pch.h"
+#include <windows.h>
+
+#include <SearchCrawlScopeRules.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace wsearch;
+
+namespace SearchCrawlScopeRulesTests
+{
+    // Rules the test can change; every change bumps the version
+    class FakeRuleSource : public ICrawlScopeRuleSource
+    {
+    public:
+        explicit FakeRuleSource(std::vector<CrawlScopeRule> rules)
+            : m_rules(std::move(rules))
+        {
+        }
+
+        std::vector<CrawlScopeRule> ReadRules() override
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_reads;
+            return m_rules;
+        }
+
+        uint64_t GetRulesVersion() override
+        {
+            return m_version;
+        }
+
+        void AddRule(CrawlScopeRule rule)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_rules.push_back(std::move(rule));
+            ++m_version;
+        }
+
+        size_t GetReads()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_reads;
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::vector<CrawlScopeRule> m_rules;
+        std::atomic<uint64_t> m_version{ 1 };
+        size_t m_reads = 0;
+    };
+
+    // The shape of the default SystemIndex rules on a client machine
+    static std::vector<CrawlScopeRule> DefaultRules()
+    {
+        return {
+            { L"file:///C:\\Users\\*", true, true },
+            { L"file:///C:\\Users\\*\\AppData\\*", false, true },
+            { L"file:///C:\\Users\\*\\AppData\\Roaming\\Microsoft\\Windows\\Start Menu\\*", true, true },
+            { L"file:///C:\\ProgramData\\Microsoft\\Windows\\Start Menu\\*", true, true },
+            { L"file:///C:\\Users\\*\\*.tmp", false, true },
+        };
+    }
+
+    TEST_CLASS(SearchCrawlScopeRulesTests)
+    {
+    public:
+        TEST_METHOD(TestDeepestRuleDecides)
+        {
+            Logger::WriteMessage(L"Testing rule precedence...\n");
+
+            CrawlScopeRuleSet rules(DefaultRules());
+            Assert::IsTrue(rules.IsIncluded(L"C:\\Users\\me\\Documents\\report.docx"));
+            Assert::IsTrue(rules.IsIncluded(L"C:\\Users\\me"));
+            Assert::IsFalse(rules.IsIncluded(L"C:\\Users\\me\\AppData\\Local\\cache.db"));
+            Assert::IsTrue(rules.IsIncluded(L"C:\\Users\\me\\AppData\\Roaming\\Microsoft\\Windows\\Start Menu\\Programs\\App.lnk"));
+            Assert::IsTrue(rules.IsIncluded(L"C:\\ProgramData\\Microsoft\\Windows\\Start Menu\\Programs\\Tool.lnk"));
+            Assert::IsFalse(rules.IsIncluded(L"C:\\ProgramData\\Package Cache\\setup.exe"));
+            Assert::IsFalse(rules.IsIncluded(L"D:\\Data\\a.txt"));
+            Assert::IsFalse(rules.IsIncluded(L""));
+
+            // Segment globs
+            Assert::IsFalse(rules.IsIncluded(L"C:\\Users\\me\\draft.tmp"));
+            Assert::IsTrue(rules.IsIncluded(L"C:\\Users\\me\\draft.tmpl"));
+
+            auto rule = rules.FindDecidingRule(L"C:\\Users\\me\\AppData\\x");
+            Assert::IsNotNull(rule);
+            Assert::AreEqual(std::wstring(L"file:///C:\\Users\\*\\AppData\\*"), rule->pattern);
+        }
+
+        TEST_METHOD(TestPathForms)
+        {
+            Logger::WriteMessage(L"Testing path and URL forms...\n");
+
+            CrawlScopeRuleSet rules(DefaultRules());
+            for (const wchar_t* path : { L"c:\\users\\ME\\appdata\\x.db", L"file:///C:/Users/me/AppData/x.db",
+                     L"FILE:C:\\Users\\me\\AppData\\x.db", L"C:\\Users\\\\me\\AppData\\x.db\\" })
+            {
+                Assert::IsFalse(rules.IsIncluded(path), path);
+            }
+            Assert::IsTrue(rules.IsIncluded(L"file:C:/Users/me/Desktop/notes.txt"));
+
+            // Long paths are folded off the stack
+            std::wstring longPath = L"C:\\USERS\\me\\AppData\\";
+            while (longPath.size() < 2000)
+            {
+                longPath += L"Deep\\";
+            }
+            Assert::IsFalse(rules.IsIncluded(longPath + L"x.db"));
+            Assert::IsTrue(rules.IsIncluded(L"C:\\Users\\me\\Documents\\" + longPath.substr(20) + L"x.db"));
+        }
+
+        TEST_METHOD(TestUserRulesBeatDefaultRules)
+        {
+            Logger::WriteMessage(L"Testing user and default rules...\n");
+
+            auto defaults = DefaultRules();
+            CrawlScopeRuleSet before(defaults);
+            Assert::IsTrue(before.IsIncluded(L"C:\\Users\\me\\Downloads\\big.iso"));
+
+            defaults.push_back({ L"file:///C:\\Users\\me\\Downloads\\", false, false });
+            defaults.push_back({ L"file:///C:\\Users\\", false, false }); // same scope as the default C:\Users\* rule
+            CrawlScopeRuleSet after(defaults);
+            Assert::IsFalse(after.IsIncluded(L"C:\\Users\\me\\Downloads\\big.iso"));
+            Assert::IsFalse(after.IsIncluded(L"C:\\Users\\me\\Documents\\a.txt"));
+
+            // An exact segment beats a wildcard at the same depth
+            CrawlScopeRuleSet exact({ { L"C:\\Users\\*\\Music\\", false }, { L"C:\\Users\\me\\Music\\", true }, { L"C:\\Users\\", true } });
+            Assert::IsTrue(exact.IsIncluded(L"C:\\Users\\me\\Music\\song.mp3"));
+            Assert::IsFalse(exact.IsIncluded(L"C:\\Users\\you\\Music\\song.mp3"));
+        }
+
+        TEST_METHOD(TestSnapshotFollowsRuleChanges)
+        {
+            Logger::WriteMessage(L"Testing rule refresh...\n");
+
+            auto source = std::make_shared<FakeRuleSource>(DefaultRules());
+            CrawlScopeRuleEvaluator evaluator(source);
+
+            std::vector<std::wstring> paths = { L"C:\\Users\\me\\a.txt", L"C:\\Users\\me\\AppData\\b", L"D:\\Photos\\c.jpg" };
+            auto included = evaluator.AreIncluded(paths);
+            Assert::IsTrue(included[0]);
+            Assert::IsFalse(included[1]);
+            Assert::IsFalse(included[2]);
+
+            // Unchanged rules are not read again
+            for (int i = 0; i < 1000; ++i)
+            {
+                evaluator.IsIncluded(paths[i % paths.size()]);
+            }
+            Assert::AreEqual(static_cast<size_t>(1), source->GetReads());
+
+            source->AddRule({ L"file:///D:\\Photos\\", true, false });
+            Assert::IsTrue(evaluator.IsIncluded(L"D:\\Photos\\c.jpg"));
+            Assert::AreEqual(static_cast<size_t>(2), source->GetReads());
+            Assert::AreEqual(static_cast<size_t>(2), evaluator.GetRefreshCount());
+        }
+    };
+}
@@ -0,0 +1,296 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include "SearchCorpusGenerator.h"
+#include <SearchClock.h>
+#include <SearchDeadline.h>
+#include <SearchSessionRecorder.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace SearchTestUtilities
+{
+    /* DeadlineLatencyModel - how long each stage of a simulated query takes
+     *
+     * Execute takes executeLatency plus an exponential part, and with spikeProbability a stall
+     * of spikeLatency on top (a cold index, a busy indexer): the injected latency deadlines are
+     * there for. Rows are fetched in batches that start at 8 and double up to 256, as
+     * TryDecodeRowsInto fetches them, and each row then takes decodeLatency to decode.
+     */
+    struct DeadlineLatencyModel
+    {
+        std::chrono::microseconds executeLatency{ 8000 };
+        std::chrono::microseconds executeJitter{ 6000 }; // mean of the exponential part
+        double spikeProbability = 0.05;
+        std::chrono::microseconds spikeLatency{ 80000 };
+        std::chrono::microseconds fetchLatency{ 400 };   // per GetNextRows call
+        std::chrono::microseconds decodeLatency{ 120 };  // per row
+        size_t minRows = 20;
+        size_t maxRows = 200;
+    };
+
+    struct DeadlineSimulationOptions
+    {
+        uint64_t seed = 0xDEAD11;
+        size_t queries = 2000;
+        std::chrono::microseconds deadline{ 30000 };
+        bool continueInBackground = true;
+        DeadlineLatencyModel latency;
+    };
+
+    struct DeadlineSimulationResult
+    {
+        std::chrono::microseconds deadline{ 0 };
+        size_t queries = 0;
+        size_t partialQueries = 0;            // not finished by the deadline
+        size_t partialAt[3] = {};             // ... by the stage they were in (Execute, Fetch, Decode)
+        size_t rowsAtDeadline = 0;
+        size_t rowsComplete = 0;
+        std::vector<double> deliveredPercent; // rows at the deadline as a percentage of the full result, partial queries only
+
+        // From the deadline to the full result, partial queries refined in the background; and
+        // until the first Wait returned, all queries; in virtual milliseconds
+        wsearch::SessionReplayOperationStats refineLatency;
+        wsearch::SessionReplayOperationStats firstResults;
+
+        double wallClockMs = 0.0;
+
+        double GetPartialPercent() const
+        {
+            return queries == 0 ? 0.0 : 100.0 * static_cast<double>(partialQueries) / static_cast<double>(queries);
+        }
+
+        double GetStagePercent(wsearch::QueryStage stage) const
+        {
+            return queries == 0 ? 0.0 : 100.0 * static_cast<double>(partialAt[static_cast<size_t>(stage)]) / static_cast<double>(queries);
+        }
+
+        // Of every row the queries found, the percentage the first Wait returned
+        double GetRowsOnTimePercent() const
+        {
+            return rowsComplete == 0 ? 100.0 : 100.0 * static_cast<double>(rowsAtDeadline) / static_cast<double>(rowsComplete);
+        }
+
+        // p in [0, 1]; 100 when no query was partial
+        double DeliveredPercentile(double p) const
+        {
+            if (deliveredPercent.empty())
+            {
+                return 100.0;
+            }
+            std::vector<double> sorted(deliveredPercent);
+            size_t rank = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+            std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+            return sorted[rank];
+        }
+
+        double GetQueriesPerSecond() const
+        {
+            return wallClockMs <= 0.0 ? 0.0 : static_cast<double>(queries) * 1000.0 / wallClockMs;
+        }
+    };
+
+    /* DeadlineSimulator - how often, and by how much, deadline queries come back partial
+     *
+     * Runs real DeadlineQuery objects, one after another, whose producer follows a
+     * DeadlineLatencyModel on a VirtualSearchClock: each row is decoded at a planned virtual
+     * time. The driver advances the clock straight to the deadline, takes the first Wait, then
+     * advances to the end of the plan and takes the full result, so a query costs a few thread
+     * handoffs whatever its latency and a seed always gives the same report. Query i draws its
+     * latencies from its own random stream, so every deadline in a sweep sees the same queries.
+     *
+     * Example:
+     *   auto results = DeadlineSimulator::SweepDeadlines(options, { 10ms, 30ms, 100ms });
+     *   std::wcout << DeadlineSimulator::FormatReport(results);
+     */
+    class DeadlineSimulator
+    {
+    public:
+        using Clock = wsearch::ISearchClock::Clock;
+
+        // The virtual times, from the start of the query, its stages end at
+        struct QueryPlan
+        {
+            Clock::duration executed{};
+            std::vector<Clock::duration> fetched; // per batch
+            std::vector<size_t> batchRows;
+            std::vector<Clock::duration> decoded; // per row
+        };
+
+        static QueryPlan PlanQuery(const DeadlineLatencyModel& model, CorpusRandom& random)
+        {
+            QueryPlan plan;
+            auto elapsed = Clock::duration(model.executeLatency) + FromMs(random.NextExponential(ToMs(model.executeJitter)));
+            if (random.NextDouble() < model.spikeProbability)
+            {
+                elapsed += model.spikeLatency;
+            }
+            plan.executed = elapsed;
+
+            size_t rows = static_cast<size_t>(random.NextInRange(model.minRows, (std::max)(model.minRows, model.maxRows)));
+            size_t batch = 8;
+            for (size_t row = 0; row < rows; row += plan.batchRows.back())
+            {
+                elapsed += model.fetchLatency;
+                plan.fetched.push_back(elapsed);
+                plan.batchRows.push_back((std::min)(batch, rows - row));
+                for (size_t i = 0; i < plan.batchRows.back(); ++i)
+                {
+                    elapsed += model.decodeLatency;
+                    plan.decoded.push_back(elapsed);
+                }
+                batch = (std::min)(batch * 2, static_cast<size_t>(256));
+            }
+            return plan;
+        }
+
+        // A DeadlineQuery producer that follows 'plan' on 'clock'; rows are their indices
+        static wsearch::DeadlineQuery<size_t>::Producer MakeProducer(QueryPlan plan, std::shared_ptr<wsearch::ISearchClock> clock)
+        {
+            return [plan = std::move(plan), clock = std::move(clock)](wsearch::DeadlineQuery<size_t>::Progress& progress) -> wsearch::SearchExpected<void> {
+                auto start = clock->Now();
+                clock->SleepUntil(start + plan.executed);
+
+                size_t row = 0;
+                for (size_t batch = 0; batch < plan.fetched.size() && !progress.IsCancelled(); ++batch)
+                {
+                    progress.SetStage(wsearch::QueryStage::Fetch);
+                    clock->SleepUntil(start + plan.fetched[batch]);
+                    progress.AddFetched(plan.batchRows[batch]);
+
+                    progress.SetStage(wsearch::QueryStage::Decode);
+                    size_t end = row + plan.batchRows[batch];
+                    for (; row < end && !progress.IsCancelled(); ++row)
+                    {
+                        // A row whose decoding started before a cancellation still lands
+                        clock->SleepUntil(start + plan.decoded[row]);
+                        progress.Append(row);
+                    }
+                }
+                return {};
+            };
+        }
+
+        static DeadlineSimulationResult Run(const DeadlineSimulationOptions& options)
+        {
+            auto wallStart = std::chrono::steady_clock::now();
+            auto clock = std::make_shared<wsearch::VirtualSearchClock>();
+
+            DeadlineSimulationResult result;
+            result.deadline = options.deadline;
+            result.queries = options.queries;
+
+            wsearch::DeadlineQueryOptions queryOptions;
+            queryOptions.continueInBackground = options.continueInBackground;
+            queryOptions.clock = clock;
+
+            for (size_t i = 0; i < options.queries; ++i)
+            {
+                auto random = CorpusRandom::ForIndex(options.seed, i);
+                auto plan = PlanQuery(options.latency, random);
+                auto end = plan.decoded.empty() ? plan.executed : plan.decoded.back();
+                size_t rows = plan.decoded.size();
+
+                auto start = clock->Now();
+                wsearch::DeadlineQuery<size_t> query(MakeProducer(std::move(plan), clock), queryOptions);
+                Settle(*clock, query);
+                clock->AdvanceTo(start + options.deadline);
+                Settle(*clock, query);
+
+                auto first = query.Wait(wsearch::SearchDeadline::At(start + options.deadline, clock));
+                Record(result.firstResults, first->elapsed);
+                result.rowsAtDeadline += first->rows.size();
+                result.rowsComplete += rows;
+                if (first->partial)
+                {
+                    ++result.partialQueries;
+                    ++result.partialAt[static_cast<size_t>(first->stage)];
+                    result.deliveredPercent.push_back(rows == 0 ? 0.0 : 100.0 * static_cast<double>(first->rows.size()) / static_cast<double>(rows));
+                }
+
+                // Let the query finish (or notice it was cancelled) in virtual time
+                clock->AdvanceTo(start + (std::max)(end, Clock::duration(options.deadline)));
+                auto full = query.WaitForCompletion();
+                if (first->partial && !full->partial)
+                {
+                    Record(result.refineLatency, full->elapsed - options.deadline);
+                }
+            }
+
+            result.wallClockMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+            return result;
+        }
+
+        // Runs the same queries (same seed) with each deadline, in order
+        static std::vector<DeadlineSimulationResult> SweepDeadlines(
+            DeadlineSimulationOptions options,
+            const std::vector<std::chrono::microseconds>& deadlines)
+        {
+            std::vector<DeadlineSimulationResult> results;
+            results.reserve(deadlines.size());
+            for (auto deadline : deadlines)
+            {
+                options.deadline = deadline;
+                results.push_back(Run(options));
+            }
+            return results;
+        }
+
+        // One line per deadline, fixed width columns; rows_* are percentages of the full
+        // results, refine_* virtual milliseconds after the deadline
+        static std::wstring FormatReport(const std::vector<DeadlineSimulationResult>& results)
+        {
+            std::wstring report = L"deadline_ms  partial_%  in_execute_%  in_fetch_%  in_decode_%  rows_on_time_%  rows_p50_%  rows_p10_%  refine_p50  refine_p95  queries/s\n";
+            for (const auto& run : results)
+            {
+                wchar_t line[256];
+                swprintf(line, sizeof(line) / sizeof(line[0]),
+                         L"%11.1f  %9.1f  %12.1f  %10.1f  %11.1f  %14.1f  %10.1f  %10.1f  %10.1f  %10.1f  %9.0f\n",
+                         ToMs(run.deadline), run.GetPartialPercent(),
+                         run.GetStagePercent(wsearch::QueryStage::Execute), run.GetStagePercent(wsearch::QueryStage::Fetch),
+                         run.GetStagePercent(wsearch::QueryStage::Decode), run.GetRowsOnTimePercent(),
+                         run.DeliveredPercentile(0.50), run.DeliveredPercentile(0.10),
+                         run.refineLatency.PercentileMs(0.50), run.refineLatency.PercentileMs(0.95), run.GetQueriesPerSecond());
+                report += line;
+            }
+            return report;
+        }
+
+    private:
+        // Waits (in real time) until the query's thread is parked on the clock or has finished,
+        // so the next advance finds it where the plan says it is
+        static void Settle(const wsearch::VirtualSearchClock& clock, const wsearch::DeadlineQuery<size_t>& query)
+        {
+            while (!query.IsFinished() && clock.GetWaiterCount() == 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        static double ToMs(Clock::duration duration)
+        {
+            return std::chrono::duration<double, std::milli>(duration).count();
+        }
+
+        static Clock::duration FromMs(double milliseconds)
+        {
+            return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>((std::max)(milliseconds, 0.0)));
+        }
+
+        static void Record(wsearch::SessionReplayOperationStats& stats, Clock::duration elapsed)
+        {
+            double ms = ToMs(elapsed);
+            ++stats.count;
+            stats.totalMs += ms;
+            stats.maxMs = (std::max)(stats.maxMs, ms);
+            stats.samplesMs.push_back(ms);
+        }
+    };
+}
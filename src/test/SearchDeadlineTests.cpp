@@ -0,0 +1,238 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#include "pch.h"
+#include <windows.h>
+
+#include <SearchClock.h>
+#include <SearchDeadline.h>
+#include "SearchDeadlineSimulator.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace wsearch;
+using namespace SearchTestUtilities;
+
+namespace SearchDeadlineTests
+{
+    using Clock = ISearchClock::Clock;
+    using std::chrono::milliseconds;
+
+    // Execute ends at 10ms; then one batch of four rows, decoded at 12, 14, 16 and 18ms
+    DeadlineQuery<size_t>::Producer MakeFourRowProducer(std::shared_ptr<VirtualSearchClock> clock)
+    {
+        return [clock](DeadlineQuery<size_t>::Progress& progress) -> SearchExpected<void> {
+            auto start = clock->Now();
+            clock->SleepUntil(start + milliseconds(10));
+            progress.SetStage(QueryStage::Fetch);
+            progress.AddFetched(4);
+            progress.SetStage(QueryStage::Decode);
+            for (size_t row = 0; row < 4 && !progress.IsCancelled(); ++row)
+            {
+                clock->SleepUntil(start + milliseconds(12 + 2 * row));
+                progress.Append(row);
+            }
+            return {};
+        };
+    }
+
+    TEST_CLASS(SearchDeadlineTests)
+    {
+    public:
+        TEST_METHOD(TestDeadline)
+        {
+            Logger::WriteMessage(L"Testing deadlines on a virtual clock...\n");
+
+            SearchDeadline unbounded;
+            Assert::IsFalse(unbounded.IsBounded());
+            Assert::IsFalse(unbounded.IsExpired());
+            Assert::IsTrue(unbounded.GetRemaining() == Clock::duration::max());
+
+            auto clock = std::make_shared<VirtualSearchClock>();
+            auto deadline = SearchDeadline::After(milliseconds(30), clock);
+            Assert::IsTrue(deadline.IsBounded());
+            Assert::IsTrue(deadline.GetTime() == clock->Now() + milliseconds(30));
+            clock->AdvanceBy(milliseconds(20));
+            Assert::IsFalse(deadline.IsExpired());
+            Assert::IsTrue(deadline.GetRemaining() == milliseconds(10));
+            clock->AdvanceBy(milliseconds(10));
+            Assert::IsTrue(deadline.IsExpired());
+            Assert::IsTrue(deadline.GetRemaining() == Clock::duration::zero());
+        }
+
+        TEST_METHOD(TestPartialResultsAtDeadline)
+        {
+            Logger::WriteMessage(L"Testing partial results and background refinement...\n");
+
+            auto clock = std::make_shared<VirtualSearchClock>();
+            auto start = clock->Now();
+            DeadlineQuery<size_t> query(MakeFourRowProducer(clock), { true, clock });
+
+            // The caller waits with a 15ms budget while the query runs on its own thread
+            SearchExpected<PartialResults<size_t>> first = SearchError{};
+            std::thread caller([&] { first = query.Wait(SearchDeadline::At(start + milliseconds(15), clock)); });
+            clock->WaitForDeadline(start + milliseconds(15));
+            clock->WaitForDeadline(start + milliseconds(10));
+
+            // Rows decoded at 12 and 14ms are in; the one at 16ms is not
+            clock->AdvanceTo(start + milliseconds(14));
+            clock->WaitForDeadline(start + milliseconds(16));
+            clock->AdvanceTo(start + milliseconds(15));
+            caller.join();
+            Assert::IsTrue(first.HasValue());
+            Assert::IsTrue(first->partial);
+            Assert::IsTrue(first->stage == QueryStage::Decode);
+            Assert::IsTrue(first->rows == std::vector<size_t>{ 0, 1 });
+            Assert::AreEqual(static_cast<size_t>(4), first->rowsFetched);
+            Assert::IsTrue(first->elapsed == milliseconds(15));
+            Assert::IsFalse(query.IsFinished());
+
+            // The query keeps going; a later wait gets all of it
+            clock->AdvanceTo(start + milliseconds(18));
+            auto full = query.WaitForCompletion();
+            Assert::IsFalse(full->partial);
+            Assert::IsTrue(full->stage == QueryStage::Complete);
+            Assert::IsTrue(full->rows == std::vector<size_t>{ 0, 1, 2, 3 });
+            Assert::IsTrue(full->elapsed == milliseconds(18));
+
+            // A deadline the query beats returns complete results at once
+            auto again = query.Wait(SearchDeadline::After(milliseconds(1), clock));
+            Assert::IsFalse(again->partial);
+            Assert::AreEqual(static_cast<size_t>(4), again->rows.size());
+        }
+
+        TEST_METHOD(TestCancelAtDeadline)
+        {
+            Logger::WriteMessage(L"Testing queries abandoned at their deadline...\n");
+
+            auto clock = std::make_shared<VirtualSearchClock>();
+            auto start = clock->Now();
+            DeadlineQuery<size_t> query(MakeFourRowProducer(clock), { false, clock });
+
+            // Expired while still executing: nothing yet
+            clock->WaitForDeadline(start + milliseconds(10));
+            clock->AdvanceTo(start + milliseconds(5));
+            auto first = query.Wait(SearchDeadline::At(start + milliseconds(5), clock));
+            Assert::IsTrue(first->partial);
+            Assert::IsTrue(first->stage == QueryStage::Execute);
+            Assert::IsTrue(first->rows.empty());
+            Assert::IsTrue(query.IsCancelled());
+
+            // Once Execute returns the producer sees the cancellation before decoding anything
+            clock->AdvanceTo(start + milliseconds(30));
+            auto last = query.WaitForCompletion();
+            Assert::IsTrue(query.IsFinished());
+            Assert::IsTrue(last->partial);
+            Assert::IsTrue(last->stage == QueryStage::Decode);
+            Assert::IsTrue(last->rows.empty());
+            Assert::IsTrue(last->elapsed == milliseconds(30));
+        }
+
+        TEST_METHOD(TestFailures)
+        {
+            Logger::WriteMessage(L"Testing failed and throwing producers...\n");
+
+            DeadlineQuery<size_t> failing([](DeadlineQuery<size_t>::Progress& progress) -> SearchExpected<void> {
+                progress.Append(7);
+                return SearchError{ -2147467259, L"ICommandText::Execute" };
+            });
+            auto failed = failing.WaitForCompletion();
+            Assert::IsFalse(failed.HasValue());
+            Assert::AreEqual(-2147467259, failed.Error().code);
+            Assert::AreEqual(L"ICommandText::Execute", failed.Error().operation);
+
+            DeadlineQuery<size_t> throwing([](DeadlineQuery<size_t>::Progress&) -> SearchExpected<void> {
+                throw std::runtime_error("decoder failed");
+            });
+            bool threw = false;
+            try
+            {
+                throwing.Wait(SearchDeadline::After(std::chrono::seconds(10)));
+            }
+            catch (const std::runtime_error&)
+            {
+                threw = true;
+            }
+            Assert::IsTrue(threw);
+        }
+
+        TEST_METHOD(TestDestroyWithoutWaiting)
+        {
+            Logger::WriteMessage(L"Testing that dropping a running query does not wait for it...\n");
+
+            auto release = std::make_shared<std::atomic<bool>>(false);
+            auto exited = std::make_shared<std::atomic<bool>>(false);
+            auto sawCancel = std::make_shared<std::atomic<bool>>(false);
+            {
+                DeadlineQuery<size_t> query([release, exited, sawCancel](DeadlineQuery<size_t>::Progress& progress) -> SearchExpected<void> {
+                    // Stands in for an Execute that cannot be interrupted
+                    while (!release->load())
+                    {
+                        std::this_thread::sleep_for(milliseconds(1));
+                    }
+                    sawCancel->store(progress.IsCancelled());
+                    exited->store(true);
+                    return {};
+                });
+                auto results = query.Wait(SearchDeadline::After(milliseconds(5)));
+                Assert::IsTrue(results->partial);
+            }
+
+            // The query was dropped while its producer was blocked; it finishes on its own
+            release->store(true);
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+            while (!exited->load() && std::chrono::steady_clock::now() < deadline)
+            {
+                std::this_thread::sleep_for(milliseconds(1));
+            }
+            Assert::IsTrue(exited->load());
+            Assert::IsTrue(sawCancel->load());
+        }
+
+        TEST_METHOD(TestSimulator)
+        {
+            Logger::WriteMessage(L"Testing the deadline simulator...\n");
+
+            DeadlineSimulationOptions options;
+            options.queries = 400;
+
+            // Same seed, same run
+            auto first = DeadlineSimulator::Run(options);
+            auto second = DeadlineSimulator::Run(options);
+            Assert::AreEqual(first.partialQueries, second.partialQueries);
+            Assert::AreEqual(first.rowsAtDeadline, second.rowsAtDeadline);
+            Assert::IsTrue(first.deliveredPercent == second.deliveredPercent);
+            Assert::IsTrue(first.refineLatency.samplesMs == second.refineLatency.samplesMs);
+
+            // Longer budgets are partial less often and deliver more of the rows on time
+            auto results = DeadlineSimulator::SweepDeadlines(options, { milliseconds(5), milliseconds(30), milliseconds(1000) });
+            for (size_t i = 0; i < results.size(); ++i)
+            {
+                const auto& run = results[i];
+                Assert::AreEqual(first.rowsComplete, run.rowsComplete);
+                Assert::AreEqual(run.partialQueries, run.partialAt[0] + run.partialAt[1] + run.partialAt[2]);
+                Assert::AreEqual(run.partialQueries, run.refineLatency.count);
+                Assert::IsTrue(run.firstResults.maxMs <= static_cast<double>(run.deadline.count()) / 1000.0 + 1e-9);
+                Assert::IsTrue(i == 0 || run.partialQueries <= results[i - 1].partialQueries);
+                Assert::IsTrue(i == 0 || run.rowsAtDeadline >= results[i - 1].rowsAtDeadline);
+            }
+            Assert::AreEqual(results[0].queries, results[0].partialQueries); // Execute alone takes 8ms
+            Assert::AreEqual(static_cast<size_t>(0), results[0].rowsAtDeadline);
+            Assert::IsTrue(results[1].partialQueries > 0 && results[1].partialQueries < results[1].queries);
+            Assert::AreEqual(static_cast<size_t>(0), results[2].partialQueries);
+            Assert::AreEqual(results[2].rowsComplete, results[2].rowsAtDeadline);
+
+            // Abandoned at the deadline, nothing is refined
+            options.continueInBackground = false;
+            auto abandoned = DeadlineSimulator::Run(options);
+            Assert::AreEqual(first.partialQueries, abandoned.partialQueries);
+            Assert::AreEqual(static_cast<size_t>(0), abandoned.refineLatency.count);
+
+            Logger::WriteMessage(DeadlineSimulator::FormatReport(results).c_str());
+        }
+    };
+}
@@ -0,0 +1,258 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include "SearchLoadGenerator.h"
+#include <SearchClock.h>
+#include <SearchDebouncer.h>
+#include <SearchSessionRecorder.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace SearchTestUtilities
+{
+    struct DebounceSimulationOptions
+    {
+        uint64_t seed = 0xDEB0;
+        size_t phrases = 10000;           // searches typed one after another by one user
+        TypingModelOptions typing;        // key intervals, backspaces, think time and words; timeScale is ignored
+        std::vector<std::wstring> vocabulary; // defaults to the load generator's
+        std::chrono::milliseconds debounceDelay{ 50 };
+        std::chrono::microseconds queryLatency{ 20000 };       // fixed part of every query
+        std::chrono::microseconds queryLatencyJitter{ 10000 }; // mean of an exponential part
+    };
+
+    struct DebounceSimulationResult
+    {
+        std::chrono::milliseconds debounceDelay{ 0 };
+        size_t phrases = 0;
+        size_t keystrokes = 0;
+        size_t queries = 0;      // queries the debounce thread started
+        size_t staleQueries = 0; // finished after the text had changed again: wasted indexer work
+
+        // From the last keystroke of a phrase to results for it, and how long GetCachedResults
+        // blocked when the user looked (after the think time); in virtual milliseconds
+        wsearch::SessionReplayOperationStats settleLatency;
+        wsearch::SessionReplayOperationStats resultWait;
+
+        double simulatedSeconds = 0.0;
+        double wallClockMs = 0.0;
+
+        double GetQueriesPerPhrase() const
+        {
+            return phrases == 0 ? 0.0 : static_cast<double>(queries) / static_cast<double>(phrases);
+        }
+
+        // Keystrokes and query completions simulated per second of real time
+        double GetEventsPerSecond() const
+        {
+            return wallClockMs <= 0.0 ? 0.0 : static_cast<double>(keystrokes + queries) * 1000.0 / wallClockMs;
+        }
+    };
+
+    /* DebounceSimulator - search-as-you-type debouncing in virtual time, on one thread
+     *
+     * Replays a synthetic typist (the load generator's typing model) against the Debouncer the
+     * sessions use, with a VirtualSearchClock for time and a latency model for the indexer.
+     * Like the session's debounce thread, one query runs at a time and the next due one starts
+     * when it finishes. Nothing sleeps, so an hour of typing takes milliseconds and a seed always
+     * gives the same result: debounce policies can be compared quickly and repeatably.
+     *
+     * Example:
+     *   auto results = DebounceSimulator::SweepDelays(options, { 0ms, 25ms, 50ms, 100ms });
+     *   std::wcout << DebounceSimulator::FormatReport(results);
+     */
+    class DebounceSimulator
+    {
+    public:
+        using Clock = wsearch::ISearchClock::Clock;
+
+        static DebounceSimulationResult Run(const DebounceSimulationOptions& options)
+        {
+            auto wallStart = std::chrono::steady_clock::now();
+
+            Simulation simulation(options);
+            const auto& typing = options.typing;
+            const auto& vocabulary = options.vocabulary.empty() ? LoadGenerator::DefaultVocabulary() : options.vocabulary;
+            ZipfDistribution wordDistribution(vocabulary.size(), 1.0);
+            size_t wordRange = (typing.maxWords > typing.minWords) ? (typing.maxWords - typing.minWords) : 0;
+            auto& result = simulation.result;
+            auto& random = simulation.random;
+            auto& clock = simulation.clock;
+
+            for (size_t phrase = 0; phrase < options.phrases; ++phrase)
+            {
+                size_t length = 0;
+                size_t words = (std::max)(typing.minWords + static_cast<size_t>(random.NextInRange(0, wordRange)), static_cast<size_t>(1));
+                for (size_t w = 0; w < words; ++w)
+                {
+                    length += vocabulary[wordDistribution.Sample(random)].size() + (w > 0 ? 1 : 0);
+                }
+
+                for (size_t i = 0; i < length; ++i)
+                {
+                    if (i > 0 && random.NextDouble() < typing.backspaceProbability)
+                    {
+                        simulation.Keystroke(LoadGenerator::KeyIntervalMs(random, typing));
+                    }
+                    simulation.Keystroke(LoadGenerator::KeyIntervalMs(random, typing));
+                }
+
+                // The user reads the results after the think time; the debounce thread keeps going
+                auto lastKeystroke = clock.Now();
+                uint64_t revision = simulation.debounce.GetRevision();
+                auto look = lastKeystroke + FromMs(random.NextExponential(typing.meanThinkTimeMs));
+                simulation.RunUntil(look);
+                if (simulation.published < revision)
+                {
+                    simulation.RunUntil(Clock::time_point::max());
+                }
+                Record(result.settleLatency, simulation.publishedAt - lastKeystroke);
+                Record(result.resultWait, (std::max)(simulation.publishedAt, look) - look);
+                clock.AdvanceTo(look);
+
+                // Clear cancels the pending query and publishes empty results
+                simulation.debounce.OnChanged(clock.Now());
+                simulation.Publish(simulation.debounce.Dispatch());
+            }
+
+            result.debounceDelay = options.debounceDelay;
+            result.phrases = options.phrases;
+            result.simulatedSeconds = std::chrono::duration<double>(clock.Now() - Clock::time_point{}).count();
+            result.wallClockMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+            return result;
+        }
+
+        // Runs the same typist (same seed) with each debounce delay, in order
+        static std::vector<DebounceSimulationResult> SweepDelays(
+            DebounceSimulationOptions options,
+            const std::vector<std::chrono::milliseconds>& delays)
+        {
+            std::vector<DebounceSimulationResult> results;
+            results.reserve(delays.size());
+            for (auto delay : delays)
+            {
+                options.debounceDelay = delay;
+                results.push_back(Run(options));
+            }
+            return results;
+        }
+
+        // One line per delay, fixed width columns; latencies in virtual milliseconds
+        static std::wstring FormatReport(const std::vector<DebounceSimulationResult>& results)
+        {
+            std::wstring report = L"delay_ms  queries/phrase  stale_%  settle_p50  settle_p95  wait_p50  wait_p95  wait_p99  sim_hours  events/s\n";
+            for (const auto& run : results)
+            {
+                double stalePercent = run.queries == 0 ? 0.0 : 100.0 * static_cast<double>(run.staleQueries) / static_cast<double>(run.queries);
+                wchar_t line[256];
+                swprintf(line, sizeof(line) / sizeof(line[0]),
+                         L"%8lld  %14.2f  %7.1f  %10.1f  %10.1f  %8.1f  %8.1f  %8.1f  %9.2f  %8.2e\n",
+                         static_cast<long long>(run.debounceDelay.count()), run.GetQueriesPerPhrase(), stalePercent,
+                         run.settleLatency.PercentileMs(0.50), run.settleLatency.PercentileMs(0.95),
+                         run.resultWait.PercentileMs(0.50), run.resultWait.PercentileMs(0.95), run.resultWait.PercentileMs(0.99),
+                         run.simulatedSeconds / 3600.0, run.GetEventsPerSecond());
+                report += line;
+            }
+            return report;
+        }
+
+    private:
+        struct Simulation
+        {
+            explicit Simulation(const DebounceSimulationOptions& simulationOptions)
+                : options(simulationOptions)
+                , random(CorpusRandom::ForIndex(simulationOptions.seed, 0))
+                , latencyRandom(CorpusRandom::ForIndex(simulationOptions.seed, 1))
+                , debounce(simulationOptions.debounceDelay)
+            {
+            }
+
+            void Keystroke(double afterMs)
+            {
+                auto at = clock.Now() + FromMs(afterMs);
+                RunUntil(at);
+                clock.AdvanceTo(at);
+                debounce.OnChanged(at);
+                ++result.keystrokes;
+            }
+
+            // Plays the debounce thread up to 'until': finishes the running query and starts
+            // the next one once it is due
+            void RunUntil(Clock::time_point until)
+            {
+                while (true)
+                {
+                    if (running != 0)
+                    {
+                        if (runningUntil > until)
+                        {
+                            return;
+                        }
+                        clock.AdvanceTo(runningUntil);
+                        if (running < debounce.GetRevision())
+                        {
+                            ++result.staleQueries;
+                        }
+                        Publish(running);
+                        running = 0;
+                        continue;
+                    }
+                    if (!debounce.IsPending())
+                    {
+                        return;
+                    }
+                    auto due = (std::max)(debounce.GetDeadline(), clock.Now());
+                    if (due > until)
+                    {
+                        return;
+                    }
+                    clock.AdvanceTo(due);
+                    running = debounce.TryDispatch(due);
+                    runningUntil = due + options.queryLatency +
+                        FromMs(latencyRandom.NextExponential(static_cast<double>(options.queryLatencyJitter.count()) / 1000.0));
+                    ++result.queries;
+                }
+            }
+
+            // As ResultPublisher: results older than the published ones are dropped
+            void Publish(uint64_t request)
+            {
+                if (request > published)
+                {
+                    published = request;
+                    publishedAt = clock.Now();
+                }
+            }
+
+            const DebounceSimulationOptions& options;
+            CorpusRandom random;        // the typist; its own stream, so every delay sees the same typing
+            CorpusRandom latencyRandom;
+            wsearch::VirtualSearchClock clock;
+            wsearch::Debouncer debounce;
+            uint64_t running = 0; // revision of the query in flight, 0 if none
+            Clock::time_point runningUntil{};
+            uint64_t published = 0;
+            Clock::time_point publishedAt{};
+            DebounceSimulationResult result;
+        };
+
+        static Clock::duration FromMs(double milliseconds)
+        {
+            return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>((std::max)(milliseconds, 0.0)));
+        }
+
+        static void Record(wsearch::SessionReplayOperationStats& stats, Clock::duration elapsed)
+        {
+            double ms = std::chrono::duration<double, std::milli>(elapsed).count();
+            ++stats.count;
+            stats.totalMs += ms;
+            stats.maxMs = (std::max)(stats.maxMs, ms);
+            stats.samplesMs.push_back(ms);
+        }
+    };
+}
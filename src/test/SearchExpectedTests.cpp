@@ -0,0 +1,100 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#include "pch.h"
+#include <windows.h>
+
+#include <SearchExpected.h>
+#include <memory>
+#include <string>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace wsearch;
+
+namespace SearchExpectedTests
+{
+    constexpr int32_t c_failed = static_cast<int32_t>(0x80004005); // E_FAIL
+
+    static SearchExpected<std::wstring> ReadName(bool fail)
+    {
+        if (fail)
+        {
+            return SearchError{ c_failed, L"IPropertyStore::GetValue" };
+        }
+        return std::wstring(L"report.docx");
+    }
+
+    // Each step forwards the first failure unchanged, as the Try* query path does
+    static SearchExpected<size_t> ReadNameLength(bool failName, int32_t checkResult)
+    {
+        auto check = details::CheckHResult(checkResult, L"IRowset::GetNextRows");
+        if (!check)
+        {
+            return check.Error();
+        }
+
+        auto name = ReadName(failName);
+        if (!name)
+        {
+            return name.Error();
+        }
+        return name->size();
+    }
+
+    TEST_CLASS(SearchExpectedTests)
+    {
+    public:
+        TEST_METHOD(TestValueAndError)
+        {
+            Logger::WriteMessage(L"Testing value and error states...\n");
+
+            auto value = ReadName(false);
+            Assert::IsTrue(value.HasValue());
+            Assert::IsTrue(static_cast<bool>(value));
+            Assert::AreEqual(std::wstring(L"report.docx"), *value);
+            Assert::AreEqual(static_cast<size_t>(11), value->size());
+
+            auto error = ReadName(true);
+            Assert::IsFalse(error.HasValue());
+            Assert::AreEqual(c_failed, error.Error().code);
+            Assert::AreEqual(std::wstring(L"IPropertyStore::GetValue"), std::wstring(error.Error().operation));
+            Assert::AreEqual(std::wstring(L"none"), error.ValueOr(L"none"));
+            Assert::AreEqual(std::wstring(L"report.docx"), value.ValueOr(L"none"));
+        }
+
+        TEST_METHOD(TestErrorsPropagateWithTheirOperation)
+        {
+            Logger::WriteMessage(L"Testing error propagation...\n");
+
+            auto length = ReadNameLength(false, 0);
+            Assert::IsTrue(length.HasValue());
+            Assert::AreEqual(static_cast<size_t>(11), *length);
+
+            // Success codes other than S_OK (DB_S_ENDOFROWSET) are not failures
+            Assert::IsTrue(ReadNameLength(false, 0x00040EC6).HasValue());
+
+            auto failedCheck = ReadNameLength(true, c_failed);
+            Assert::IsFalse(failedCheck.HasValue());
+            Assert::AreEqual(std::wstring(L"IRowset::GetNextRows"), std::wstring(failedCheck.Error().operation));
+
+            auto failedName = ReadNameLength(true, 0);
+            Assert::AreEqual(std::wstring(L"IPropertyStore::GetValue"), std::wstring(failedName.Error().operation));
+        }
+
+        TEST_METHOD(TestVoidAndMoveOnlyValues)
+        {
+            Logger::WriteMessage(L"Testing void and move-only values...\n");
+
+            SearchExpected<void> done;
+            Assert::IsTrue(done.HasValue());
+            SearchExpected<void> failed = SearchError{ c_failed, L"IRowset::ReleaseRows" };
+            Assert::IsFalse(failed.HasValue());
+            Assert::AreEqual(c_failed, failed.Error().code);
+
+            SearchExpected<std::unique_ptr<int>> owned = std::make_unique<int>(42);
+            std::unique_ptr<int> taken = *std::move(owned);
+            Assert::AreEqual(42, *taken);
+
+            // Errors are two words; passing them around never allocates
+            Assert::IsTrue(sizeof(SearchError) <= 2 * sizeof(void*));
+        }
+    };
+}
@@ -0,0 +1,173 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#include "pch.h"
+#include <windows.h>
+
+#include <SearchFilePath.h>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace wsearch;
+
+namespace SearchFilePathTests
+{
+    // Appends a code point as UTF-16 or UTF-32, whichever wchar_t is
+    void AppendCodePoint(std::wstring& out, uint32_t codePoint)
+    {
+        if (sizeof(wchar_t) == 2 && codePoint >= 0x10000)
+        {
+            codePoint -= 0x10000;
+            out.push_back(static_cast<wchar_t>(0xD800 + (codePoint >> 10)));
+            out.push_back(static_cast<wchar_t>(0xDC00 + (codePoint & 0x3FF)));
+            return;
+        }
+        out.push_back(static_cast<wchar_t>(codePoint));
+    }
+
+    void AppendEscapedByte(std::wstring& out, uint32_t byte)
+    {
+        static const wchar_t digits[] = L"0123456789ABCDEF";
+        out.push_back(L'%');
+        out.push_back(digits[(byte >> 4) & 0xF]);
+        out.push_back(digits[byte & 0xF]);
+    }
+
+    // Percent-encodes a code point as UTF-8 bytes
+    void AppendEscapedCodePoint(std::wstring& out, uint32_t codePoint)
+    {
+        if (codePoint < 0x80)
+        {
+            AppendEscapedByte(out, codePoint);
+        }
+        else if (codePoint < 0x800)
+        {
+            AppendEscapedByte(out, 0xC0 | (codePoint >> 6));
+            AppendEscapedByte(out, 0x80 | (codePoint & 0x3F));
+        }
+        else if (codePoint < 0x10000)
+        {
+            AppendEscapedByte(out, 0xE0 | (codePoint >> 12));
+            AppendEscapedByte(out, 0x80 | ((codePoint >> 6) & 0x3F));
+            AppendEscapedByte(out, 0x80 | (codePoint & 0x3F));
+        }
+        else
+        {
+            AppendEscapedByte(out, 0xF0 | (codePoint >> 18));
+            AppendEscapedByte(out, 0x80 | ((codePoint >> 12) & 0x3F));
+            AppendEscapedByte(out, 0x80 | ((codePoint >> 6) & 0x3F));
+            AppendEscapedByte(out, 0x80 | (codePoint & 0x3F));
+        }
+    }
+
+    TEST_CLASS(SearchFilePathTests)
+    {
+    public:
+        TEST_METHOD(TestPrefixesAndSlashes)
+        {
+            Logger::WriteMessage(L"Testing file URL prefixes...\n");
+
+            Assert::AreEqual(std::wstring(L"C:\\Users\\Me\\a.txt"), FileUrlToPath(L"file:C:/Users/Me/a.txt"));
+            Assert::AreEqual(std::wstring(L"C:\\Users\\Me\\a.txt"), FileUrlToPath(L"file:///C:/Users/Me/a.txt"));
+            Assert::AreEqual(std::wstring(L"C:\\Users\\Me\\a.txt"), FileUrlToPath(L"file://C:/Users/Me/a.txt"));
+            Assert::AreEqual(std::wstring(L"C:\\Users\\Me\\a.txt"), FileUrlToPath(L"FILE:C:/Users/Me/a.txt"));
+            Assert::AreEqual(std::wstring(L"\\\\server\\share\\a.txt"), FileUrlToPath(L"file://server/share/a.txt"));
+            Assert::AreEqual(std::wstring(L"C:\\Users\\Me"), FileUrlToPath(L"C:/Users/Me"));
+            Assert::AreEqual(std::wstring(), FileUrlToPath(L"file:"));
+            Assert::AreEqual(std::wstring(L"fil"), FileUrlToPath(L"fil"));
+        }
+
+        TEST_METHOD(TestEscapes)
+        {
+            Logger::WriteMessage(L"Testing percent escapes...\n");
+
+            Assert::AreEqual(std::wstring(L"C:\\My Documents\\50%.txt"), FileUrlToPath(L"file:C:/My%20Documents/50%25.txt"));
+
+            // UTF-8 sequences become one character, not one per byte
+            std::wstring expected = L"C:\\caf";
+            AppendCodePoint(expected, 0xE9);
+            AppendCodePoint(expected, 0x1F600);
+            Assert::AreEqual(expected, FileUrlToPath(L"file:C:/caf%C3%A9%F0%9F%98%80"));
+
+            // Bytes that are not UTF-8 decode one to one, as the old decoders did
+            expected = L"C:\\caf";
+            AppendCodePoint(expected, 0xE9);
+            expected += L".txt";
+            Assert::AreEqual(expected, FileUrlToPath(L"file:C:/caf%E9.txt"));
+
+            // Surrogates and overlong forms are not UTF-8 either
+            Assert::AreEqual(std::wstring(L"\u00ED\u00A0\u0080"), FileUrlToPath(L"%ED%A0%80"));
+            Assert::AreEqual(std::wstring(L"\u00C0\u00AF"), FileUrlToPath(L"%C0%AF"));
+
+            // Malformed escapes are kept, including one split at the end of the URL
+            Assert::AreEqual(std::wstring(L"a%zz%4"), FileUrlToPath(L"a%zz%4"));
+            Assert::AreEqual(std::wstring(L"%"), FileUrlToPath(L"%"));
+            Assert::AreEqual(std::wstring(L"\u00C3"), FileUrlToPath(L"%C3"));
+        }
+
+        TEST_METHOD(TestBlockBoundaries)
+        {
+            Logger::WriteMessage(L"Testing escapes and slashes at every position...\n");
+
+            for (size_t length = 0; length < 40; ++length)
+            {
+                for (size_t position = 0; position <= length; ++position)
+                {
+                    std::wstring url(length, L'a');
+                    std::wstring expected(length, L'a');
+                    if (position < length)
+                    {
+                        url[position] = L'/';
+                        expected[position] = L'\\';
+                    }
+                    url.insert(position, L"%41");
+                    expected.insert(position, L"A");
+                    Assert::AreEqual(expected, FileUrlToPath(url));
+
+                    std::wstring appended = L"prefix";
+                    AppendFilePathFromUrl(appended, url);
+                    Assert::AreEqual(L"prefix" + expected, appended);
+                }
+            }
+        }
+
+        TEST_METHOD(TestRoundTripFuzz)
+        {
+            Logger::WriteMessage(L"Testing encode/decode round trips of random paths...\n");
+
+            std::mt19937 random(20240611);
+            const uint32_t samples[] = { L'a', L'Z', L'0', L' ', L'.', L'%', L'#', L'\\', L'\\', 0xE9, 0x416, 0x4E2D, 0xFFFD, 0x1F600, 0x10FFFF };
+            std::vector<wchar_t> buffer;
+
+            for (int iteration = 0; iteration < 5000; ++iteration)
+            {
+                std::wstring path = L"C:";
+                std::wstring url = L"file:C:";
+                size_t length = random() % 64;
+                for (size_t i = 0; i < length; ++i)
+                {
+                    uint32_t codePoint = samples[random() % (sizeof(samples) / sizeof(samples[0]))];
+                    AppendCodePoint(path, codePoint);
+                    if (codePoint == L'\\')
+                    {
+                        url.push_back(L'/');
+                    }
+                    else if (codePoint >= 0x80 || codePoint == L'%' || (random() % 4) == 0)
+                    {
+                        AppendEscapedCodePoint(url, codePoint);
+                    }
+                    else
+                    {
+                        url.push_back(static_cast<wchar_t>(codePoint));
+                    }
+                }
+
+                buffer.assign(url.size(), L'\0');
+                size_t written = DecodeFileUrl(url, buffer.data());
+                Assert::IsTrue(written <= url.size());
+                Assert::AreEqual(path, std::wstring(buffer.data(), written));
+            }
+        }
+    };
+}
@@ -0,0 +1,211 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#include "pch.h"
+#include <windows.h>
+
+#include <SearchFilters.h>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace wsearch;
+
+namespace SearchFiltersTests
+{
+    // Wednesday 2024-03-13 15:00 UTC
+    constexpr uint64_t c_now = 133548660000000000ull;
+    constexpr int64_t c_day = 864000000000ll;
+
+    std::wstring ConditionOf(const FilterPredicate& predicate)
+    {
+        std::wstring sql;
+        details::AppendFilterCondition(sql, predicate);
+        return sql;
+    }
+
+    TEST_CLASS(SearchFiltersTests)
+    {
+    public:
+        TEST_METHOD(TestParse)
+        {
+            Logger::WriteMessage(L"Testing filter parsing...\n");
+
+            FilterParseOptions options;
+            options.nowTicks = c_now;
+            auto parsed = ParseSearchFilters(L"kind:image ext:PNG,.jpg size:>10MB modified:lastweek annual report", options);
+            Assert::AreEqual(std::wstring(L"annual report"), parsed.searchText);
+            Assert::AreEqual(static_cast<size_t>(4), parsed.predicates.size());
+            Assert::IsTrue(parsed.invalid.empty());
+
+            Assert::IsTrue(parsed.predicates[0].field == FilterField::Kind);
+            Assert::IsTrue(std::vector<std::wstring>{ L"picture" } == parsed.predicates[0].values);
+            Assert::IsTrue(std::vector<std::wstring>{ L".png", L".jpg" } == parsed.predicates[1].values);
+            Assert::AreEqual(static_cast<int64_t>(10ll << 20) + 1, parsed.predicates[2].low);
+            Assert::AreEqual(std::wstring(L"size:>10MB"), parsed.predicates[2].text);
+
+            // Weeks start on Monday: last week is 2024-03-04 up to 2024-03-11
+            Assert::AreEqual(std::wstring(L"(System.DateModified >= '2024/03/04 00:00:00' AND System.DateModified < '2024/03/11 00:00:00')"),
+                ConditionOf(parsed.predicates[3]));
+
+            // Phrases, unknown names, URLs and negation
+            parsed = ParseSearchFilters(L"\"kind:image report\" http://x -ext:tmp C:", options);
+            Assert::AreEqual(std::wstring(L"\"kind:image report\" http://x C:"), parsed.searchText);
+            Assert::AreEqual(static_cast<size_t>(1), parsed.predicates.size());
+            Assert::IsTrue(parsed.predicates[0].negated);
+            Assert::AreEqual(std::wstring(L"NOT (System.FileExtension = '.tmp')"), ConditionOf(parsed.predicates[0]));
+
+            // Half-typed and unknown values are dropped and reported
+            parsed = ParseSearchFilters(L"size:> kind: kind:spaceship size:large date:2023-02-29 ext:a'b", options);
+            Assert::IsTrue(std::vector<std::wstring>{ L"size:>", L"kind:", L"kind:spaceship", L"date:2023-02-29", L"ext:a'b" } == parsed.invalid);
+            Assert::AreEqual(static_cast<size_t>(1), parsed.predicates.size());
+            Assert::AreEqual(std::wstring(L"(System.Size >= 134217728 AND System.Size < 1073741824)"), ConditionOf(parsed.predicates[0]));
+            Assert::IsTrue(parsed.searchText.empty());
+
+            // Aliases and plurals
+            parsed = ParseSearchFilters(L"KIND:Photos,docs,music", options);
+            Assert::IsTrue(std::vector<std::wstring>{ L"picture", L"document", L"music" } == parsed.predicates[0].values);
+            Assert::AreEqual(std::wstring(L"(System.Kind = 'picture' OR System.Kind = 'document' OR System.Kind = 'music')"),
+                ConditionOf(parsed.predicates[0]));
+        }
+
+        TEST_METHOD(TestRanges)
+        {
+            Logger::WriteMessage(L"Testing size and date ranges...\n");
+
+            FilterParseOptions options;
+            options.nowTicks = c_now;
+            auto condition = [&](const wchar_t* text) { return ConditionOf(ParseSearchFilters(text, options).predicates.at(0)); };
+
+            Assert::AreEqual(std::wstring(L"(System.Size < 1024)"), condition(L"size:<1k"));
+            Assert::AreEqual(std::wstring(L"(System.Size < 1025)"), condition(L"size:<=1KB"));
+            Assert::AreEqual(std::wstring(L"(System.Size >= 1536)"), condition(L"size:>=1.5kb"));
+            Assert::AreEqual(std::wstring(L"(System.Size >= 1048576 AND System.Size < 4194305)"), condition(L"size:1MB..4MB"));
+            Assert::AreEqual(std::wstring(L"(System.Size >= 0 AND System.Size < 1)"), condition(L"size:empty"));
+            Assert::AreEqual(std::wstring(L"(System.Size >= 500 AND System.Size < 501)"), condition(L"size:500"));
+
+            Assert::AreEqual(std::wstring(L"(System.DateCreated >= '2024/02/01 00:00:00' AND System.DateCreated < '2024/03/01 00:00:00')"),
+                condition(L"created:lastmonth"));
+            Assert::AreEqual(std::wstring(L"(System.DateModified >= '2024/01/01 00:00:00' AND System.DateModified < '2024/02/01 00:00:00')"),
+                condition(L"modified:2024-01-01..2024-01-31"));
+            Assert::AreEqual(std::wstring(L"(System.DateModified >= '2024/02/01 00:00:00')"), condition(L"date:>2024/01/31"));
+            Assert::AreEqual(std::wstring(L"(System.DateModified < '2024/01/31 00:00:00')"), condition(L"date:<2024-01-31"));
+            Assert::AreEqual(std::wstring(L"(System.DateModified >= '2023/01/01 00:00:00' AND System.DateModified < '2024/01/01 00:00:00')"),
+                condition(L"date:lastyear"));
+
+            // In UTC-8 it is still Wednesday; local midnight is 08:00 UTC
+            options.utcOffsetMinutes = -8 * 60;
+            Assert::AreEqual(std::wstring(L"(System.DateModified >= '2024/03/12 08:00:00' AND System.DateModified < '2024/03/13 08:00:00')"),
+                condition(L"modified:yesterday"));
+            // In UTC+10 it is already Thursday
+            options.utcOffsetMinutes = 10 * 60;
+            Assert::AreEqual(std::wstring(L"(System.DateModified >= '2024/03/13 14:00:00' AND System.DateModified < '2024/03/14 14:00:00')"),
+                condition(L"modified:today"));
+
+            // Missing values never match, negated or not
+            auto predicate = ParseSearchFilters(L"-size:>10", options).predicates.at(0);
+            Assert::IsTrue(details::FilterMatchesNumber(predicate, 5));
+            Assert::IsFalse(details::FilterMatchesNumber(predicate, 11));
+            Assert::IsFalse(details::FilterMatchesNumber(predicate, c_missingNumber));
+        }
+
+        TEST_METHOD(TestEvaluateMatchesReference)
+        {
+            Logger::WriteMessage(L"Testing client-side evaluation against per-row checks...\n");
+
+            const wchar_t* kinds[] = { L"", L"picture", L"document", L"Music" };
+            const wchar_t* extensions[] = { L"", L".png", L".JPG", L".docx", L".tmp" };
+            FilterParseOptions options;
+            options.nowTicks = c_now;
+            auto predicates = ParseSearchFilters(L"kind:image,music -ext:tmp size:1k..1MB modified:thismonth", options).predicates;
+
+            std::mt19937 random(21);
+            for (int iteration = 0; iteration < 50; ++iteration)
+            {
+                size_t rows = random() % 300;
+                ResultBatch batch(rows);
+                std::vector<int64_t> sizes(rows);
+                std::vector<int64_t> modified(rows);
+                std::vector<std::wstring> kindValues(rows);
+                std::vector<std::wstring> extensionValues(rows);
+                CategoryColumn& kindColumn = batch.AddCategoryColumn(propid::Kind);
+                CategoryColumn& extensionColumn = batch.AddCategoryColumn(propid::FileExtension);
+                for (size_t row = 0; row < rows; ++row)
+                {
+                    sizes[row] = (random() % 10 == 0) ? c_missingNumber : static_cast<int64_t>(random() % (2 << 20));
+                    modified[row] = static_cast<int64_t>(c_now) - static_cast<int64_t>(random() % 40) * c_day;
+                    kindValues[row] = kinds[random() % 4];
+                    extensionValues[row] = extensions[random() % 5];
+                    kindColumn.Append(kindValues[row]);
+                    extensionColumn.Append(extensionValues[row]);
+                }
+                batch.AddNumberColumn(propid::Size, sizes);
+                batch.AddNumberColumn(propid::DateModified, modified);
+
+                std::vector<uint32_t> expected;
+                for (uint32_t row = 0; row < rows; ++row)
+                {
+                    if (details::FilterMatchesText(predicates[0], kindValues[row]) && details::FilterMatchesText(predicates[1], extensionValues[row]) &&
+                        details::FilterMatchesNumber(predicates[2], sizes[row]) && details::FilterMatchesNumber(predicates[3], modified[row]))
+                    {
+                        expected.push_back(row);
+                    }
+                }
+                Assert::IsTrue(expected == EvaluateFilters(batch, predicates));
+            }
+
+            ResultBatch empty(0);
+            Assert::AreEqual(static_cast<size_t>(0), EvaluateFilters(empty, {}).size());
+            Assert::ExpectException<std::invalid_argument>([&] { EvaluateFilters(empty, predicates); });
+        }
+
+        TEST_METHOD(TestPlanner)
+        {
+            Logger::WriteMessage(L"Testing pushdown decisions...\n");
+
+            FilterParseOptions options;
+            options.nowTicks = c_now;
+            auto predicates = ParseSearchFilters(L"ext:png size:>0 kind:document", options).predicates;
+            FilterPlanner planner({}, c_now);
+
+            // Rare extension pushed; size:>0 keeps nearly everything and stays client-side, as
+            // does kind:document (0.35) while TOP N grows by less than 4x
+            auto plan = planner.Plan(predicates, 50);
+            Assert::IsFalse(plan.fromCache);
+            Assert::AreEqual(static_cast<size_t>(1), plan.pushed.size());
+            Assert::AreEqual(std::wstring(L"ext:png"), plan.pushed[0].text);
+            Assert::AreEqual(static_cast<size_t>(2), plan.clientSide.size());
+            Assert::IsTrue(plan.fetchLimit > 50 && plan.fetchLimit <= 200);
+
+            // A tighter over-fetch limit pushes kind:document too
+            FilterPlannerPolicy policy;
+            policy.maxOverfetch = 1.5;
+            plan = FilterPlanner(policy, c_now).Plan(predicates, 50);
+            Assert::AreEqual(static_cast<size_t>(2), plan.pushed.size());
+            Assert::AreEqual(std::wstring(L"size:>0"), plan.clientSide.at(0).text);
+
+            // A complete cache answers everything; a truncated one only when enough rows should pass
+            CachedResultState cache;
+            cache.rowCount = 100;
+            cache.complete = true;
+            plan = planner.Plan(predicates, 50, cache);
+            Assert::IsTrue(plan.fromCache);
+            Assert::AreEqual(static_cast<size_t>(3), plan.clientSide.size());
+            cache.complete = false;
+            Assert::IsFalse(planner.Plan(predicates, 50, cache).fromCache);
+            Assert::IsTrue(planner.Plan({ predicates[1] }, 50, cache).fromCache);
+
+            // Observed rows replace the priors: here every row is a png
+            ResultBatch batch(c_filterMinSamples);
+            CategoryColumn& extensions = batch.AddCategoryColumn(propid::FileExtension);
+            for (size_t row = 0; row < batch.GetRowCount(); ++row)
+            {
+                extensions.Append(L".png");
+            }
+            planner.GetSelectivity().Observe(batch);
+            Assert::IsTrue(planner.GetSelectivity().Estimate(predicates[0]) > 0.99);
+            plan = planner.Plan({ predicates[0] }, 50);
+            Assert::IsTrue(plan.pushed.empty());
+            Assert::AreEqual(static_cast<size_t>(51), plan.fetchLimit);
+        }
+    };
+}
@@ -0,0 +1,193 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#include "pch.h"
+#include <windows.h>
+
+#include <SearchClock.h>
+#include <SearchIndexCount.h>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace wsearch;
+
+namespace SearchIndexCountTests
+{
+    // Counts 100 items per character of the scope, after a delay; can be told to fail or throw
+    class FakeCountSource : public IIndexCountSource
+    {
+    public:
+        explicit FakeCountSource(std::chrono::milliseconds latency)
+            : m_latency(latency)
+        {
+        }
+
+        SearchExpected<size_t> CountItems(std::wstring_view scope) override
+        {
+            ++m_calls;
+            std::this_thread::sleep_for(m_latency);
+            if (m_throw)
+            {
+                throw std::runtime_error("indexer unavailable");
+            }
+            if (m_fail)
+            {
+                return SearchError{ c_notReady, L"ICommandText::Execute" };
+            }
+            return scope.size() * 100 + m_added;
+        }
+
+        static constexpr int32_t c_notReady = static_cast<int32_t>(0x80070015);
+
+        std::atomic<size_t> m_calls{ 0 };
+        std::atomic<size_t> m_added{ 0 };
+        std::atomic<bool> m_fail{ false };
+        std::atomic<bool> m_throw{ false };
+
+    private:
+        std::chrono::milliseconds m_latency;
+    };
+
+    TEST_CLASS(SearchIndexCountTests)
+    {
+    public:
+        TEST_METHOD(TestCountBecomesKnown)
+        {
+            Logger::WriteMessage(L"Testing first count...\n");
+
+            auto source = std::make_shared<FakeCountSource>(std::chrono::milliseconds(20));
+            IndexCountService service(source, { std::chrono::milliseconds(0) });
+
+            auto count = service.GetCount(L"file:");
+            Assert::IsFalse(count.known);
+
+            count = service.RefreshNow(L"file:");
+            Assert::IsTrue(count.known);
+            Assert::AreEqual(static_cast<size_t>(500), count.count);
+            Assert::IsTrue(count.age < std::chrono::seconds(5));
+
+            // A young enough count is served from the cache
+            count = service.GetCountNoOlderThan(L"file:", std::chrono::minutes(1));
+            Assert::AreEqual(static_cast<size_t>(500), count.count);
+            Assert::AreEqual(static_cast<size_t>(1), service.GetSourceQueryCount());
+        }
+
+        TEST_METHOD(TestConcurrentRefreshesShareOneQuery)
+        {
+            Logger::WriteMessage(L"Testing shared refreshes...\n");
+
+            auto source = std::make_shared<FakeCountSource>(std::chrono::milliseconds(200));
+            IndexCountService service(source, { std::chrono::milliseconds(0) });
+
+            std::vector<std::thread> callers;
+            std::atomic<size_t> total{ 0 };
+            for (int i = 0; i < 8; ++i)
+            {
+                callers.emplace_back([&]() { total += service.RefreshNow(L"file:").count; });
+            }
+            for (auto& caller : callers)
+            {
+                caller.join();
+            }
+
+            Assert::AreEqual(static_cast<size_t>(8 * 500), total.load());
+            Assert::AreEqual(static_cast<size_t>(1), source->m_calls.load());
+        }
+
+        TEST_METHOD(TestPeriodicRefreshAndScopes)
+        {
+            Logger::WriteMessage(L"Testing periodic refresh per scope...\n");
+
+            auto source = std::make_shared<FakeCountSource>(std::chrono::milliseconds(1));
+            IndexCountService service(source, { std::chrono::milliseconds(20) });
+
+            Assert::AreEqual(static_cast<size_t>(500), service.RefreshNow(L"file:").count);
+            Assert::AreEqual(static_cast<size_t>(1700), service.RefreshNow(L"file:///C:/Users/").count);
+
+            source->m_added = 1;
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (service.GetCount(L"file:").count != 501 && std::chrono::steady_clock::now() < deadline)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+            Assert::AreEqual(static_cast<size_t>(501), service.GetCount(L"file:").count);
+            Assert::IsTrue(service.GetSourceQueryCount() > 2);
+        }
+
+        TEST_METHOD(TestPeriodicRefreshInVirtualTime)
+        {
+            Logger::WriteMessage(L"Testing the refresh schedule on a virtual clock...\n");
+
+            auto clock = std::make_shared<VirtualSearchClock>();
+            auto source = std::make_shared<FakeCountSource>(std::chrono::milliseconds(0));
+            IndexCountService service(source, { std::chrono::minutes(5), clock });
+            auto start = clock->Now();
+
+            Assert::AreEqual(static_cast<size_t>(500), service.RefreshNow(L"file:").count);
+            source->m_added = 1;
+
+            // The worker waits out the interval on the clock; nothing is counted before it ends
+            clock->WaitForDeadline(start + std::chrono::minutes(5));
+            clock->AdvanceBy(std::chrono::minutes(4));
+            Assert::AreEqual(static_cast<size_t>(500), service.GetCount(L"file:").count);
+            Assert::IsTrue(service.GetCount(L"file:").age == std::chrono::minutes(4));
+
+            clock->AdvanceBy(std::chrono::minutes(1));
+            clock->WaitForDeadline(start + std::chrono::minutes(10));
+            auto count = service.GetCount(L"file:");
+            Assert::AreEqual(static_cast<size_t>(501), count.count);
+            Assert::IsTrue(count.age == std::chrono::steady_clock::duration::zero());
+            Assert::AreEqual(static_cast<size_t>(2), service.GetSourceQueryCount());
+        }
+
+        TEST_METHOD(TestFailedRefreshKeepsLastCount)
+        {
+            Logger::WriteMessage(L"Testing failed refresh...\n");
+
+            auto source = std::make_shared<FakeCountSource>(std::chrono::milliseconds(1));
+            IndexCountService service(source, { std::chrono::milliseconds(0) });
+
+            Assert::AreEqual(static_cast<size_t>(500), service.RefreshNow(L"file:").count);
+
+            source->m_fail = true;
+            auto count = service.RefreshNow(L"file:");
+            Assert::IsTrue(count.known);
+            Assert::IsTrue(count.lastRefreshFailed);
+            Assert::AreEqual(FakeCountSource::c_notReady, count.lastError.code);
+            Assert::AreEqual(static_cast<size_t>(500), count.count);
+
+            source->m_throw = true;
+            count = service.RefreshNow(L"file:");
+            Assert::IsTrue(count.lastRefreshFailed);
+            Assert::AreEqual(static_cast<int32_t>(0x80004005), count.lastError.code);
+
+            source->m_fail = false;
+            source->m_throw = false;
+            count = service.GetCountNoOlderThan(L"file:", std::chrono::minutes(1));
+            Assert::IsFalse(count.lastRefreshFailed);
+            Assert::AreEqual(static_cast<size_t>(4), service.GetSourceQueryCount());
+        }
+
+        TEST_METHOD(TestShutdownStopsCounting)
+        {
+            Logger::WriteMessage(L"Testing shutdown...\n");
+
+            auto source = std::make_shared<FakeCountSource>(std::chrono::milliseconds(1));
+            IndexCountService service(source, { std::chrono::milliseconds(0) });
+            Assert::AreEqual(static_cast<size_t>(500), service.RefreshNow(L"file:").count);
+
+            service.Shutdown();
+            service.Shutdown();
+
+            // Cached counts stay readable; refreshes return at once without counting
+            auto count = service.RefreshNow(L"file:");
+            Assert::IsTrue(count.known);
+            Assert::AreEqual(static_cast<size_t>(500), count.count);
+            Assert::IsFalse(service.RefreshNow(L"file:///C:/Users/").known);
+            Assert::AreEqual(static_cast<size_t>(1), source->m_calls.load());
+        }
+    };
+}
@@ -0,0 +1,728 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#pragma once
+
+#include "SearchCorpusGenerator.h"
+#include <SearchClock.h>
+#include <SearchDebouncedQueryRunner.h>
+#include <SearchResultPublisher.h>
+#include <SearchSessionRecorder.h>
+#include <SearchSynchronization.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#include <tlhelp32.h>
+#else
+#include <fstream>
+#include <sstream>
+#endif
+
+namespace SearchTestUtilities
+{
+    /* ProcessMetrics - Thread count and resident memory of the current process
+     *
+     * Uses Toolhelp and GetProcessMemoryInfo on Windows and /proc/self/status elsewhere.
+     * Returns 0 when the platform does not expose the value.
+     */
+    struct ProcessMetrics
+    {
+        static size_t GetThreadCount()
+        {
+#ifdef _WIN32
+            HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+            if (snapshot == INVALID_HANDLE_VALUE)
+            {
+                return 0;
+            }
+
+            DWORD processId = GetCurrentProcessId();
+            size_t count = 0;
+            THREADENTRY32 entry = { sizeof(entry) };
+            for (BOOL more = Thread32First(snapshot, &entry); more; more = Thread32Next(snapshot, &entry))
+            {
+                if (entry.th32OwnerProcessID == processId)
+                {
+                    ++count;
+                }
+            }
+            CloseHandle(snapshot);
+            return count;
+#else
+            return ReadStatusField("Threads:");
+#endif
+        }
+
+        static size_t GetResidentBytes()
+        {
+#ifdef _WIN32
+            PROCESS_MEMORY_COUNTERS counters = { sizeof(counters) };
+            if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+            {
+                return 0;
+            }
+            return counters.WorkingSetSize;
+#else
+            return ReadStatusField("VmRSS:") * 1024;
+#endif
+        }
+
+    private:
+#ifndef _WIN32
+        static size_t ReadStatusField(const char* field)
+        {
+            std::ifstream status("/proc/self/status");
+            std::string line;
+            while (std::getline(status, line))
+            {
+                if (line.rfind(field, 0) == 0)
+                {
+                    std::istringstream value(line.substr(strlen(field)));
+                    size_t result = 0;
+                    value >> result;
+                    return result;
+                }
+            }
+            return 0;
+        }
+#endif
+    };
+
+    /* SimulatedSearchProvider - Stand-in for the indexer backed by a synthetic corpus
+     *
+     * Answers a query by prefix-matching the last typed word against the corpus row source,
+     * then sleeps for a latency of baseLatency + perRowLatency * rows so that query cost grows
+     * with result size the way a real rowset fetch does. The sleep is on 'clock', so with a
+     * VirtualSearchClock the latency passes when the test advances it. Thread-safe.
+     */
+    struct SimulatedProviderOptions
+    {
+        std::chrono::microseconds baseLatency{ 2000 };
+        std::chrono::microseconds perRowLatency{ 5 };
+        size_t maxRows = 200;
+        std::shared_ptr<wsearch::ISearchClock> clock; // null sleeps in real time
+    };
+
+    class SimulatedSearchProvider
+    {
+    public:
+        SimulatedSearchProvider(std::shared_ptr<const CorpusRowSource> rows, SimulatedProviderOptions options = {})
+            : m_rows(std::move(rows))
+            , m_options(options)
+        {
+        }
+
+        // Returns the number of rows the query produced
+        size_t Query(std::wstring_view searchText) const
+        {
+            m_queryCount.fetch_add(1, std::memory_order_relaxed);
+
+            size_t lastSpace = searchText.find_last_of(L' ');
+            std::wstring_view token = (lastSpace == std::wstring_view::npos) ? searchText : searchText.substr(lastSpace + 1);
+
+            size_t rows = 0;
+            if (m_rows && !token.empty())
+            {
+                rows = m_rows->FindByTokenPrefix(token, m_options.maxRows).size();
+            }
+
+            auto latency = m_options.baseLatency + m_options.perRowLatency * static_cast<int64_t>(rows);
+            if (m_options.clock)
+            {
+                m_options.clock->SleepFor(latency);
+            }
+            else
+            {
+                std::this_thread::sleep_for(latency);
+            }
+            return rows;
+        }
+
+        size_t GetQueryCount() const
+        {
+            return m_queryCount.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::shared_ptr<const CorpusRowSource> m_rows;
+        SimulatedProviderOptions m_options;
+        mutable std::atomic<size_t> m_queryCount{ 0 };
+    };
+
+    /* SimulatedSearchAsYouTypeSession - wsearch::SearchAsYouTypeSession over a simulated indexer
+     *
+     * Runs the session's own DebouncedQueryRunner (search text, Debouncer, debounce thread and
+     * ResultPublisher) with the indexer query replaced by a SimulatedSearchProvider, so the load
+     * generator measures the real scheduling and contention behavior on machines without
+     * Windows Search, and tests step the real debouncing with a VirtualSearchClock.
+     */
+    class SimulatedSearchAsYouTypeSession
+    {
+    public:
+        SimulatedSearchAsYouTypeSession(
+            std::shared_ptr<const SimulatedSearchProvider> provider,
+            std::chrono::milliseconds debounceDelay = std::chrono::milliseconds(50),
+            std::shared_ptr<wsearch::ISearchClock> clock = nullptr)
+            : m_provider(std::move(provider))
+            , m_typing([this](const std::wstring& searchText) -> wsearch::SearchExpected<size_t> { return m_provider->Query(searchText); },
+                       debounceDelay, std::move(clock))
+        {
+        }
+
+        SimulatedSearchAsYouTypeSession(const SimulatedSearchAsYouTypeSession&) = delete;
+        SimulatedSearchAsYouTypeSession& operator=(const SimulatedSearchAsYouTypeSession&) = delete;
+
+        void AppendCharacters(std::wstring_view characters) { m_typing.AppendCharacters(characters); }
+        void SetSearchText(std::wstring_view searchText) { m_typing.SetSearchText(searchText); }
+        void Clear() { m_typing.Clear(); }
+        size_t GetCachedResults() { return m_typing.WaitForResults()->result; }
+        bool IsQueryPending() const { return m_typing.IsQueryPending(); }
+        size_t ExecuteQueryNow() { return *m_typing.ExecuteNow(); }
+
+        std::shared_ptr<const wsearch::ResultSnapshot<size_t>> GetResultsSnapshot() const
+        {
+            return m_typing.GetSnapshot();
+        }
+
+        wsearch::ResultSubscription SubscribeResults(wsearch::ResultPublisher<size_t>::Callback callback)
+        {
+            return m_typing.Subscribe(std::move(callback));
+        }
+
+        void TrackResultClick(const std::wstring&)
+        {
+        }
+
+        size_t GetExecutedQueryCount() const
+        {
+            return m_typing.GetExecutedQueryCount();
+        }
+
+        std::chrono::nanoseconds GetLockWaitTime() const
+        {
+            return m_typing.GetLockWaitTime();
+        }
+
+    private:
+        std::shared_ptr<const SimulatedSearchProvider> m_provider;
+        wsearch::DebouncedQueryRunner<size_t> m_typing;
+    };
+
+    // Portable model of wsearch::SearchSession: every Search call goes straight to the provider
+    class SimulatedSearchSession
+    {
+    public:
+        explicit SimulatedSearchSession(std::shared_ptr<const SimulatedSearchProvider> provider)
+            : m_provider(std::move(provider))
+        {
+        }
+
+        size_t Search(std::wstring_view searchText)
+        {
+            m_executedQueryCount.fetch_add(1, std::memory_order_relaxed);
+            return m_provider->Query(searchText);
+        }
+
+        void TrackResultClick(const std::wstring&)
+        {
+        }
+
+        size_t GetExecutedQueryCount() const
+        {
+            return m_executedQueryCount.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::shared_ptr<const SimulatedSearchProvider> m_provider;
+        std::atomic<size_t> m_executedQueryCount{ 0 };
+    };
+
+    namespace details
+    {
+        template <typename T, typename = void>
+        struct HasLockWaitTime : std::false_type {};
+
+        template <typename T>
+        struct HasLockWaitTime<T, std::void_t<decltype(std::declval<const T&>().GetLockWaitTime())>> : std::true_type {};
+    }
+
+    /* ILoadSession - What the load generator needs from a session under test
+     *
+     * Typing calls model keystrokes; WaitForResults is the point where the user looks at the
+     * result list and is the latency the generator reports. Use TypingLoadSession or
+     * SynchronousLoadSession to adapt real or simulated sessions.
+     */
+    enum class LoadSessionKind
+    {
+        Typing,         // SearchAsYouTypeSession-style: debounced background queries
+        Synchronous     // SearchSession-style: one blocking query when results are wanted
+    };
+
+    class ILoadSession
+    {
+    public:
+        virtual ~ILoadSession() = default;
+        virtual void AppendCharacters(std::wstring_view characters) = 0;
+        virtual void SetSearchText(std::wstring_view searchText) = 0;
+        virtual void Clear() = 0;
+        virtual void WaitForResults() = 0;
+        virtual void ExecuteQueryNow() = 0;
+        virtual void TrackResultClick(const std::wstring& filePath) = 0;
+        virtual size_t GetExecutedQueryCount() const = 0;
+        virtual std::chrono::nanoseconds GetLockWaitTime() const = 0;
+    };
+
+    // Adapts SearchAsYouTypeSession or SimulatedSearchAsYouTypeSession
+    template <typename Session>
+    class TypingLoadSession : public ILoadSession
+    {
+    public:
+        explicit TypingLoadSession(std::unique_ptr<Session> session)
+            : m_session(std::move(session))
+        {
+        }
+
+        void AppendCharacters(std::wstring_view characters) override { m_session->AppendCharacters(characters); }
+        void SetSearchText(std::wstring_view searchText) override { m_session->SetSearchText(searchText); }
+        void Clear() override { m_session->Clear(); }
+        void WaitForResults() override { m_session->GetCachedResults(); }
+        void ExecuteQueryNow() override { m_session->ExecuteQueryNow(); }
+        void TrackResultClick(const std::wstring& filePath) override { m_session->TrackResultClick(filePath); }
+
+        size_t GetExecutedQueryCount() const override
+        {
+            if constexpr (wsearch::details::HasExecutedQueryCount<Session>::value)
+            {
+                return static_cast<size_t>(m_session->GetExecutedQueryCount());
+            }
+            return 0;
+        }
+
+        std::chrono::nanoseconds GetLockWaitTime() const override
+        {
+            if constexpr (details::HasLockWaitTime<Session>::value)
+            {
+                return m_session->GetLockWaitTime();
+            }
+            return std::chrono::nanoseconds(0);
+        }
+
+    private:
+        std::unique_ptr<Session> m_session;
+    };
+
+    // Adapts SearchSession or SimulatedSearchSession. Keystrokes only edit local text.
+    template <typename Session>
+    class SynchronousLoadSession : public ILoadSession
+    {
+    public:
+        explicit SynchronousLoadSession(std::unique_ptr<Session> session)
+            : m_session(std::move(session))
+        {
+        }
+
+        void AppendCharacters(std::wstring_view characters) override { m_searchText += characters; }
+        void SetSearchText(std::wstring_view searchText) override { m_searchText = searchText; }
+        void Clear() override { m_searchText.clear(); }
+        void WaitForResults() override { Search(); }
+        void ExecuteQueryNow() override { Search(); }
+        void TrackResultClick(const std::wstring& filePath) override { m_session->TrackResultClick(filePath); }
+
+        size_t GetExecutedQueryCount() const override
+        {
+            return m_queryCount;
+        }
+
+        std::chrono::nanoseconds GetLockWaitTime() const override
+        {
+            return std::chrono::nanoseconds(0);
+        }
+
+    private:
+        void Search()
+        {
+            ++m_queryCount;
+            m_session->Search(m_searchText);
+        }
+
+        std::unique_ptr<Session> m_session;
+        std::wstring m_searchText;
+        size_t m_queryCount = 0;
+    };
+
+    // Synthetic user behavior. Delays are scaled by timeScale (0.1 runs ten times faster).
+    struct TypingModelOptions
+    {
+        double meanKeyIntervalMs = 120.0;
+        double keyIntervalSigma = 0.4;      // log-normal spread of inter-key gaps
+        double backspaceProbability = 0.03; // per keystroke, followed by retyping the character
+        double meanThinkTimeMs = 600.0;     // pause between finishing typing and reading results
+        double executeNowProbability = 0.1; // Enter instead of waiting for the debounce
+        double clickProbability = 0.3;
+        size_t minWords = 1;
+        size_t maxWords = 3;
+        double timeScale = 1.0;
+    };
+
+    struct LoadGeneratorOptions
+    {
+        uint64_t seed = 0x10AD;
+        size_t sessionCount = 10;
+        double typingSessionFraction = 0.75; // remainder are synchronous sessions
+        size_t queriesPerSession = 10;
+        TypingModelOptions typing;
+        std::vector<std::wstring> vocabulary; // words users type; defaults to a small built-in list
+        std::chrono::milliseconds sampleInterval{ 25 };
+    };
+
+    struct LoadSessionStatistics
+    {
+        LoadSessionKind kind = LoadSessionKind::Typing;
+        size_t keystrokes = 0;
+        size_t queriesExecuted = 0;
+        wsearch::SessionReplayOperationStats keystrokeLatency;
+        wsearch::SessionReplayOperationStats resultLatency;
+        std::chrono::nanoseconds lockWaitTime{ 0 };
+    };
+
+    struct LoadRunResult
+    {
+        size_t sessionCount = 0;
+        double wallClockMs = 0.0;
+        size_t totalKeystrokes = 0;
+        size_t totalResultRequests = 0;
+        size_t totalQueriesExecuted = 0;
+        double queriesPerSecond = 0.0;
+        double resultRequestsPerSecond = 0.0;
+
+        // Result latency across all sessions, and the worst single-session p95
+        double resultP50Ms = 0.0;
+        double resultP95Ms = 0.0;
+        double resultP99Ms = 0.0;
+        double worstSessionP95Ms = 0.0;
+        double keystrokeP99Ms = 0.0;
+
+        double lockWaitMs = 0.0;
+        size_t peakThreadCount = 0;
+        size_t baselineResidentBytes = 0;
+        size_t peakResidentBytes = 0;
+
+        std::vector<LoadSessionStatistics> sessions;
+    };
+
+    using LoadSessionFactory = std::function<std::unique_ptr<ILoadSession>(LoadSessionKind kind, size_t sessionIndex)>;
+
+    /* LoadGenerator - Drives many concurrent sessions with synthetic typists
+     *
+     * Each session gets its own driver thread and an independent typing model seeded from
+     * (seed, sessionIndex), so runs are reproducible. The generator samples process thread
+     * count and resident memory while the run is in progress.
+     *
+     * Example:
+     *   auto provider = std::make_shared<SimulatedSearchProvider>(rows);
+     *   auto results = LoadGenerator::RunScalingCurve(options, LoadGenerator::SimulatedSessionFactory(provider),
+     *                                                 { 1, 10, 100, 1000 });
+     *   std::wcout << LoadGenerator::FormatReport(results);
+     */
+    class LoadGenerator
+    {
+    public:
+        static LoadRunResult Run(const LoadGeneratorOptions& options, const LoadSessionFactory& factory)
+        {
+            LoadRunResult result;
+            result.sessionCount = options.sessionCount;
+            result.baselineResidentBytes = ProcessMetrics::GetResidentBytes();
+
+            const std::vector<std::wstring>& vocabulary = options.vocabulary.empty() ? DefaultVocabulary() : options.vocabulary;
+            ZipfDistribution wordDistribution(vocabulary.size(), 1.0);
+
+            std::vector<std::unique_ptr<ILoadSession>> sessions;
+            sessions.reserve(options.sessionCount);
+            result.sessions.resize(options.sessionCount);
+            for (size_t i = 0; i < options.sessionCount; ++i)
+            {
+                // Spread synchronous sessions evenly instead of bunching them at the end
+                double fraction = options.typingSessionFraction;
+                bool typingSession = static_cast<size_t>(static_cast<double>(i + 1) * fraction) !=
+                                     static_cast<size_t>(static_cast<double>(i) * fraction);
+                LoadSessionKind kind = typingSession ? LoadSessionKind::Typing : LoadSessionKind::Synchronous;
+                result.sessions[i].kind = kind;
+                sessions.push_back(factory(kind, i));
+            }
+
+            std::atomic<bool> running{ true };
+            size_t peakThreads = 0;
+            size_t peakResident = 0;
+            std::thread sampler([&]() {
+                while (running.load())
+                {
+                    peakThreads = (std::max)(peakThreads, ProcessMetrics::GetThreadCount());
+                    peakResident = (std::max)(peakResident, ProcessMetrics::GetResidentBytes());
+                    std::this_thread::sleep_for(options.sampleInterval);
+                }
+            });
+
+            std::mutex startMutex;
+            std::condition_variable startCv;
+            bool started = false;
+
+            std::vector<std::thread> drivers;
+            drivers.reserve(options.sessionCount);
+            for (size_t i = 0; i < options.sessionCount; ++i)
+            {
+                drivers.emplace_back([&, i]() {
+                    {
+                        std::unique_lock<std::mutex> lock(startMutex);
+                        startCv.wait(lock, [&] { return started; });
+                    }
+                    DriveSession(*sessions[i], CorpusRandom::ForIndex(options.seed, i), vocabulary, wordDistribution,
+                                 options, result.sessions[i]);
+                });
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            {
+                std::lock_guard<std::mutex> lock(startMutex);
+                started = true;
+            }
+            startCv.notify_all();
+
+            for (auto& driver : drivers)
+            {
+                driver.join();
+            }
+            result.wallClockMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            running = false;
+            sampler.join();
+            result.peakThreadCount = peakThreads;
+            result.peakResidentBytes = (std::max)(peakResident, ProcessMetrics::GetResidentBytes());
+
+            wsearch::SessionReplayOperationStats allResults;
+            wsearch::SessionReplayOperationStats allKeystrokes;
+            std::chrono::nanoseconds lockWait(0);
+            for (size_t i = 0; i < options.sessionCount; ++i)
+            {
+                auto& stats = result.sessions[i];
+                stats.queriesExecuted = sessions[i]->GetExecutedQueryCount();
+                stats.lockWaitTime = sessions[i]->GetLockWaitTime();
+                lockWait += stats.lockWaitTime;
+
+                result.totalKeystrokes += stats.keystrokes;
+                result.totalResultRequests += stats.resultLatency.count;
+                result.totalQueriesExecuted += stats.queriesExecuted;
+                result.worstSessionP95Ms = (std::max)(result.worstSessionP95Ms, stats.resultLatency.PercentileMs(0.95));
+
+                allResults.samplesMs.insert(allResults.samplesMs.end(), stats.resultLatency.samplesMs.begin(), stats.resultLatency.samplesMs.end());
+                allKeystrokes.samplesMs.insert(allKeystrokes.samplesMs.end(), stats.keystrokeLatency.samplesMs.begin(), stats.keystrokeLatency.samplesMs.end());
+            }
+
+            // Destroy sessions (and their worker threads) before reporting memory is final
+            sessions.clear();
+
+            double seconds = result.wallClockMs / 1000.0;
+            if (seconds > 0.0)
+            {
+                result.queriesPerSecond = static_cast<double>(result.totalQueriesExecuted) / seconds;
+                result.resultRequestsPerSecond = static_cast<double>(result.totalResultRequests) / seconds;
+            }
+            result.resultP50Ms = allResults.PercentileMs(0.50);
+            result.resultP95Ms = allResults.PercentileMs(0.95);
+            result.resultP99Ms = allResults.PercentileMs(0.99);
+            result.keystrokeP99Ms = allKeystrokes.PercentileMs(0.99);
+            result.lockWaitMs = std::chrono::duration<double, std::milli>(lockWait).count();
+            return result;
+        }
+
+        // Runs the same workload at each session count, in order
+        static std::vector<LoadRunResult> RunScalingCurve(
+            LoadGeneratorOptions options,
+            const LoadSessionFactory& factory,
+            const std::vector<size_t>& sessionCounts)
+        {
+            std::vector<LoadRunResult> results;
+            results.reserve(sessionCounts.size());
+            for (size_t count : sessionCounts)
+            {
+                options.sessionCount = count;
+                results.push_back(Run(options, factory));
+            }
+            return results;
+        }
+
+        // 1, 2, 5, 10, 20, 50, ... up to and including maxSessions
+        static std::vector<size_t> DefaultScalingSteps(size_t maxSessions = 1000)
+        {
+            std::vector<size_t> steps;
+            static const size_t multipliers[] = { 1, 2, 5 };
+            for (size_t decade = 1; decade <= maxSessions; decade *= 10)
+            {
+                for (size_t multiplier : multipliers)
+                {
+                    if (decade * multiplier <= maxSessions)
+                    {
+                        steps.push_back(decade * multiplier);
+                    }
+                }
+            }
+            if (steps.empty() || steps.back() != maxSessions)
+            {
+                steps.push_back(maxSessions);
+            }
+            return steps;
+        }
+
+        // Factory producing simulated sessions that all share one provider
+        static LoadSessionFactory SimulatedSessionFactory(
+            std::shared_ptr<const SimulatedSearchProvider> provider,
+            std::chrono::milliseconds debounceDelay = std::chrono::milliseconds(50))
+        {
+            return [provider, debounceDelay](LoadSessionKind kind, size_t) -> std::unique_ptr<ILoadSession> {
+                if (kind == LoadSessionKind::Typing)
+                {
+                    return std::make_unique<TypingLoadSession<SimulatedSearchAsYouTypeSession>>(
+                        std::make_unique<SimulatedSearchAsYouTypeSession>(provider, debounceDelay));
+                }
+                return std::make_unique<SynchronousLoadSession<SimulatedSearchSession>>(
+                    std::make_unique<SimulatedSearchSession>(provider));
+            };
+        }
+
+        // One line per run, fixed width columns
+        static std::wstring FormatReport(const std::vector<LoadRunResult>& results)
+        {
+            std::wstring report = L"sessions  wall_ms   queries/s  p50_ms   p95_ms   p99_ms   worst_p95  key_p99  lock_ms   threads  peak_MB\n";
+            for (const auto& run : results)
+            {
+                wchar_t line[256];
+                swprintf(line, sizeof(line) / sizeof(line[0]),
+                         L"%8zu  %8.0f  %9.1f  %7.2f  %7.2f  %7.2f  %9.2f  %7.3f  %8.2f  %7zu  %7.1f\n",
+                         run.sessionCount, run.wallClockMs, run.queriesPerSecond,
+                         run.resultP50Ms, run.resultP95Ms, run.resultP99Ms, run.worstSessionP95Ms, run.keystrokeP99Ms,
+                         run.lockWaitMs, run.peakThreadCount,
+                         static_cast<double>(run.peakResidentBytes) / (1024.0 * 1024.0));
+                report += line;
+            }
+            return report;
+        }
+
+        // Gap before the next keystroke, in unscaled milliseconds
+        static double KeyIntervalMs(CorpusRandom& random, const TypingModelOptions& typing)
+        {
+            // Log-normal with the requested mean
+            double mu = std::log((std::max)(typing.meanKeyIntervalMs, 0.001)) - 0.5 * typing.keyIntervalSigma * typing.keyIntervalSigma;
+            return std::exp(mu + typing.keyIntervalSigma * random.NextGaussian());
+        }
+
+        // Words synthetic users type unless LoadGeneratorOptions::vocabulary is set
+        static const std::vector<std::wstring>& DefaultVocabulary()
+        {
+            static const std::vector<std::wstring> words = {
+                L"report", L"budget", L"invoice", L"meeting", L"notes", L"project", L"draft", L"final",
+                L"photo", L"resume", L"presentation", L"summary", L"contract", L"design", L"review", L"plan",
+                L"schedule", L"proposal", L"agenda", L"receipt", L"statement", L"letter", L"backup", L"archive"
+            };
+            return words;
+        }
+
+    private:
+        static void DriveSession(
+            ILoadSession& session,
+            CorpusRandom random,
+            const std::vector<std::wstring>& vocabulary,
+            const ZipfDistribution& wordDistribution,
+            const LoadGeneratorOptions& options,
+            LoadSessionStatistics& stats)
+        {
+            const auto& typing = options.typing;
+            size_t wordRange = (typing.maxWords > typing.minWords) ? (typing.maxWords - typing.minWords) : 0;
+
+            for (size_t query = 0; query < options.queriesPerSession; ++query)
+            {
+                std::wstring phrase;
+                size_t words = typing.minWords + static_cast<size_t>(random.NextInRange(0, wordRange));
+                for (size_t w = 0; w < (std::max)(words, static_cast<size_t>(1)); ++w)
+                {
+                    if (!phrase.empty())
+                    {
+                        phrase += L' ';
+                    }
+                    phrase += vocabulary[wordDistribution.Sample(random)];
+                }
+
+                std::wstring typed;
+                for (wchar_t ch : phrase)
+                {
+                    Pause(KeyIntervalMs(random, typing), typing);
+
+                    if (!typed.empty() && random.NextDouble() < typing.backspaceProbability)
+                    {
+                        typed.pop_back();
+                        TimeCall(stats.keystrokeLatency, [&] { session.SetSearchText(typed); });
+                        ++stats.keystrokes;
+                        Pause(KeyIntervalMs(random, typing), typing);
+                    }
+
+                    typed += ch;
+                    TimeCall(stats.keystrokeLatency, [&] { session.AppendCharacters(std::wstring_view(&ch, 1)); });
+                    ++stats.keystrokes;
+                }
+
+                Pause(random.NextExponential(typing.meanThinkTimeMs), typing);
+
+                if (random.NextDouble() < typing.executeNowProbability)
+                {
+                    TimeCall(stats.resultLatency, [&] { session.ExecuteQueryNow(); });
+                }
+                else
+                {
+                    TimeCall(stats.resultLatency, [&] { session.WaitForResults(); });
+                }
+
+                if (random.NextDouble() < typing.clickProbability)
+                {
+                    session.TrackResultClick(L"C:\\SearchCorpus\\" + phrase + L".txt");
+                }
+
+                session.Clear();
+            }
+        }
+
+        static void Pause(double milliseconds, const TypingModelOptions& typing)
+        {
+            double scaled = milliseconds * typing.timeScale;
+            if (scaled > 0.0)
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(static_cast<int64_t>(scaled * 1000.0)));
+            }
+        }
+
+        template <typename Func>
+        static void TimeCall(wsearch::SessionReplayOperationStats& stats, Func&& func)
+        {
+            auto start = std::chrono::steady_clock::now();
+            func();
+            double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            ++stats.count;
+            stats.totalMs += elapsedMs;
+            stats.maxMs = (std::max)(stats.maxMs, elapsedMs);
+            stats.samplesMs.push_back(elapsedMs);
+        }
+    };
+}
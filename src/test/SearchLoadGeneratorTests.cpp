@@ -0,0 +1,165 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#include "pch.h"
+#include <windows.h>
+
+#include <SearchSessions.h>
+#include "SearchLoadGenerator.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace SearchTestUtilities;
+
+namespace SearchLoadGeneratorTests
+{
+    TEST_CLASS(SearchLoadGeneratorTests)
+    {
+    private:
+        static std::shared_ptr<SimulatedSearchProvider> CreateProvider(size_t itemCount)
+        {
+            CorpusOptions corpusOptions;
+            corpusOptions.itemCount = itemCount;
+            CorpusGenerator generator(corpusOptions);
+
+            auto rows = std::make_shared<CorpusRowSource>();
+            generator.StreamTo(*rows);
+            return std::make_shared<SimulatedSearchProvider>(rows);
+        }
+
+        static LoadGeneratorOptions FastOptions()
+        {
+            LoadGeneratorOptions options;
+            options.queriesPerSession = 3;
+            options.typing.timeScale = 0.02;
+            return options;
+        }
+
+    public:
+        TEST_METHOD(TestContentionTrackingMutexMeasuresWaits)
+        {
+            Logger::WriteMessage(L"Testing lock wait measurement...\n");
+
+            wsearch::details::ContentionTrackingMutex mutex;
+            {
+                std::lock_guard<wsearch::details::ContentionTrackingMutex> lock(mutex);
+            }
+            Assert::AreEqual(static_cast<uint64_t>(0), mutex.GetContendedAcquisitions());
+
+            std::thread holder;
+            {
+                std::lock_guard<wsearch::details::ContentionTrackingMutex> lock(mutex);
+                holder = std::thread([&]() {
+                    std::lock_guard<wsearch::details::ContentionTrackingMutex> inner(mutex);
+                });
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+            holder.join();
+
+            Assert::AreEqual(static_cast<uint64_t>(1), mutex.GetContendedAcquisitions());
+            Assert::IsTrue(mutex.GetWaitTime() >= std::chrono::milliseconds(40));
+        }
+
+        TEST_METHOD(TestDefaultScalingSteps)
+        {
+            Logger::WriteMessage(L"Testing scaling curve steps...\n");
+
+            auto steps = LoadGenerator::DefaultScalingSteps(1000);
+            std::vector<size_t> expected = { 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000 };
+            Assert::IsTrue(expected == steps);
+
+            auto odd = LoadGenerator::DefaultScalingSteps(30);
+            Assert::AreEqual(static_cast<size_t>(30), odd.back());
+        }
+
+        TEST_METHOD(TestSimulatedRunReportsMetrics)
+        {
+            Logger::WriteMessage(L"Testing a small simulated load run...\n");
+
+            auto provider = CreateProvider(2000);
+            auto options = FastOptions();
+            options.sessionCount = 8;
+            options.typingSessionFraction = 0.5;
+
+            auto result = LoadGenerator::Run(options, LoadGenerator::SimulatedSessionFactory(provider, std::chrono::milliseconds(5)));
+
+            size_t typingSessions = 0;
+            for (const auto& session : result.sessions)
+            {
+                Assert::AreEqual(options.queriesPerSession, session.resultLatency.count);
+                Assert::IsTrue(session.keystrokes > 0);
+                if (session.kind == LoadSessionKind::Typing)
+                {
+                    ++typingSessions;
+                }
+            }
+
+            Assert::AreEqual(static_cast<size_t>(4), typingSessions);
+            Assert::AreEqual(options.sessionCount * options.queriesPerSession, result.totalResultRequests);
+            Assert::AreEqual(provider->GetQueryCount(), result.totalQueriesExecuted);
+            Assert::IsTrue(result.queriesPerSecond > 0.0);
+            Assert::IsTrue(result.resultP50Ms <= result.resultP99Ms);
+            Assert::IsTrue(result.peakThreadCount >= options.sessionCount);
+            Assert::IsTrue(result.peakResidentBytes > 0);
+        }
+
+        TEST_METHOD(TestSameSeedTypesSameKeystrokes)
+        {
+            Logger::WriteMessage(L"Testing typing model determinism...\n");
+
+            auto provider = CreateProvider(500);
+            auto options = FastOptions();
+            options.sessionCount = 4;
+            auto factory = LoadGenerator::SimulatedSessionFactory(provider, std::chrono::milliseconds(5));
+
+            auto first = LoadGenerator::Run(options, factory);
+            auto second = LoadGenerator::Run(options, factory);
+
+            for (size_t i = 0; i < options.sessionCount; ++i)
+            {
+                Assert::AreEqual(first.sessions[i].keystrokes, second.sessions[i].keystrokes);
+            }
+        }
+
+        TEST_METHOD(PerfTest_SimulatedScalingCurve)
+        {
+            Logger::WriteMessage(L"PERFORMANCE TEST: Simulated sessions, 1 to 1000\n");
+
+            auto provider = CreateProvider(20000);
+            auto options = FastOptions();
+            options.queriesPerSession = 2;
+            options.typing.timeScale = 0.05;
+
+            auto results = LoadGenerator::RunScalingCurve(options, LoadGenerator::SimulatedSessionFactory(provider),
+                                                          LoadGenerator::DefaultScalingSteps(1000));
+            Logger::WriteMessage(LoadGenerator::FormatReport(results).c_str());
+
+            Assert::AreEqual(static_cast<size_t>(1000), results.back().sessionCount);
+            Assert::IsTrue(results.back().queriesPerSecond > results.front().queriesPerSecond);
+        }
+
+        TEST_METHOD(PerfTest_IndexerSessions)
+        {
+            Logger::WriteMessage(L"PERFORMANCE TEST: Real sessions against the system index\n");
+
+            std::vector<std::wstring> scopes = { wsearch::details::GetKnownFolderScope(FOLDERID_Documents) };
+            LoadSessionFactory factory = [&scopes](LoadSessionKind kind, size_t) -> std::unique_ptr<ILoadSession> {
+                if (kind == LoadSessionKind::Typing)
+                {
+                    return std::make_unique<TypingLoadSession<wsearch::SearchAsYouTypeSession>>(
+                        std::make_unique<wsearch::SearchAsYouTypeSession>(scopes));
+                }
+                return std::make_unique<SynchronousLoadSession<wsearch::SearchSession>>(
+                    std::make_unique<wsearch::SearchSession>(scopes));
+            };
+
+            auto options = FastOptions();
+            options.typing.clickProbability = 0.0;
+
+            auto results = LoadGenerator::RunScalingCurve(options, factory, LoadGenerator::DefaultScalingSteps(20));
+            Logger::WriteMessage(LoadGenerator::FormatReport(results).c_str());
+
+            for (const auto& run : results)
+            {
+                Assert::AreEqual(run.sessionCount * options.queriesPerSession, run.totalResultRequests);
+            }
+        }
+    };
+}
@@ -0,0 +1,162 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#include "pch.h"
+#include <windows.h>
+
+#include <SearchPrimedScopeCache.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace wsearch;
+
+namespace SearchPrimedScopeCacheTests
+{
+    // The fake rowset is the priming SQL it was opened for, so tests can see when it is released
+    using FakeRowset = std::shared_ptr<std::wstring>;
+    using Cache = PrimedScopeCache<FakeRowset>;
+    using Clock = std::chrono::steady_clock;
+
+    class FakePrimer : public IScopePrimer<FakeRowset>
+    {
+    public:
+        SearchExpected<void> Prime(PrimedScope<FakeRowset>& scope) override
+        {
+            ++primeCount;
+            if (scope.sql.find(L"offline") != std::wstring::npos)
+            {
+                return SearchError{ static_cast<int32_t>(0x80070015), L"ICommand::Execute" };
+            }
+            scope.rowset = std::make_shared<std::wstring>(scope.sql);
+            scope.whereId = ++lastWhereId;
+            return {};
+        }
+
+        size_t primeCount = 0;
+        uint64_t lastWhereId = 0;
+    };
+
+    const std::vector<std::wstring> c_documents = { L"C:\\Users\\me\\Documents\\", L"D:\\Work" };
+    const std::vector<std::wstring> c_pictures = { L"C:\\Users\\me\\Pictures" };
+    const std::vector<std::wstring> c_music = { L"C:\\Users\\me\\Music" };
+    const std::vector<std::wstring> c_all = { L"file:" };
+    const std::vector<std::wstring> c_properties = { L"System.ItemNameDisplay" };
+
+    TEST_CLASS(SearchPrimedScopeCacheTests)
+    {
+    public:
+        TEST_METHOD(TestHits)
+        {
+            Logger::WriteMessage(L"Testing hits on normalized scope sets...\n");
+
+            auto primer = std::make_shared<FakePrimer>();
+            Cache cache(primer);
+            auto start = Clock::now();
+
+            auto documents = cache.TryAcquire(c_documents, {}, c_properties, start);
+            Assert::IsTrue(documents.HasValue());
+            Assert::IsTrue((*documents)->rowset != nullptr);
+            Assert::AreEqual(static_cast<uint64_t>(1), (*documents)->whereId);
+            Assert::IsTrue((*documents)->sql == *(*documents)->rowset);
+            Assert::IsTrue((*documents)->includedScopes == c_documents);
+
+            // Case, separators, trailing slashes and order do not matter
+            auto respelled = cache.TryAcquire({ L"file:d:/work/", L"file:c:/users/ME/documents" }, {}, c_properties, start);
+            Assert::IsTrue(*respelled == *documents);
+
+            // Other exclusions or properties are other scope sets
+            auto excluding = cache.TryAcquire(c_documents, { L"D:\\Work\\Archive" }, c_properties, start);
+            auto noProperties = cache.TryAcquire(c_documents, {}, {}, start);
+            Assert::IsTrue(*excluding != *documents);
+            Assert::IsTrue(*noProperties != *documents);
+            Assert::AreEqual(static_cast<size_t>(3), primer->primeCount);
+
+            auto statistics = cache.GetStatistics();
+            Assert::AreEqual(static_cast<uint64_t>(4), statistics.lookups);
+            Assert::AreEqual(static_cast<uint64_t>(1), statistics.hits);
+            Assert::AreEqual(static_cast<uint64_t>(3), statistics.primes);
+            Assert::AreEqual(0.25, statistics.GetHitRate(), 1e-9);
+            Assert::AreEqual(static_cast<size_t>(3), statistics.entries);
+            Assert::IsTrue(statistics.memoryBytes >= 3 * (*documents)->sql.size() * sizeof(wchar_t));
+
+            // Describe builds the same key and SQL without priming
+            auto described = Cache::Describe(c_documents, {}, c_properties);
+            Assert::IsTrue(described->key == (*documents)->key);
+            Assert::IsTrue(described->sql == (*documents)->sql);
+            Assert::IsTrue(described->rowset == nullptr);
+            Assert::AreEqual(static_cast<size_t>(3), primer->primeCount);
+        }
+
+        TEST_METHOD(TestEvictionAndExpiry)
+        {
+            Logger::WriteMessage(L"Testing least recently used eviction and idle expiry...\n");
+
+            auto primer = std::make_shared<FakePrimer>();
+            PrimedScopeCacheOptions options;
+            options.capacity = 2;
+            options.idleExpiry = std::chrono::minutes(10);
+            Cache cache(primer, options);
+            auto start = Clock::now();
+
+            std::weak_ptr<std::wstring> documentsRowset = (*cache.TryAcquire(c_documents, {}, {}, start))->rowset;
+            std::weak_ptr<std::wstring> picturesRowset = (*cache.TryAcquire(c_pictures, {}, {}, start + std::chrono::seconds(1)))->rowset;
+            cache.TryAcquire(c_documents, {}, {}, start + std::chrono::seconds(2));
+
+            // Pictures is least recently used, so music replaces it and its rowset is closed
+            cache.TryAcquire(c_music, {}, {}, start + std::chrono::seconds(3));
+            Assert::IsTrue(picturesRowset.expired());
+            Assert::IsFalse(documentsRowset.expired());
+            cache.TryAcquire(c_documents, {}, {}, start + std::chrono::seconds(4));
+            Assert::AreEqual(static_cast<size_t>(3), primer->primeCount);
+            Assert::AreEqual(static_cast<uint64_t>(1), cache.GetStatistics().evictions);
+
+            // An entry still held (the scope a session searches) does not expire while it is held
+            auto held = *cache.TryAcquire(c_music, {}, {}, start + std::chrono::seconds(5));
+            Assert::AreEqual(static_cast<size_t>(1), cache.ExpireIdle(start + std::chrono::minutes(11)));
+            Assert::IsTrue(documentsRowset.expired());
+            auto heldAgain = *cache.TryAcquire(c_music, {}, {}, start + std::chrono::minutes(15));
+            Assert::IsTrue(heldAgain == held);
+
+            // Once let go, its idle time starts at the last sweep that saw it held
+            held.reset();
+            heldAgain.reset();
+            Assert::AreEqual(static_cast<size_t>(0), cache.ExpireIdle(start + std::chrono::minutes(24)));
+            Assert::AreEqual(static_cast<size_t>(1), cache.ExpireIdle(start + std::chrono::minutes(25)));
+
+            auto statistics = cache.GetStatistics();
+            Assert::AreEqual(static_cast<uint64_t>(2), statistics.expirations);
+            Assert::AreEqual(static_cast<size_t>(0), statistics.entries);
+            Assert::AreEqual(static_cast<size_t>(0), statistics.memoryBytes);
+
+            // Zero idle expiry keeps entries until they are evicted
+            options.idleExpiry = Clock::duration::zero();
+            Cache keeping(primer, options);
+            keeping.TryAcquire(c_all, {}, {}, start);
+            Assert::AreEqual(static_cast<size_t>(0), keeping.ExpireIdle(start + std::chrono::hours(24 * 365)));
+        }
+
+        TEST_METHOD(TestPrimeFailure)
+        {
+            Logger::WriteMessage(L"Testing priming failures...\n");
+
+            auto primer = std::make_shared<FakePrimer>();
+            Cache cache(primer);
+
+            // Failures are returned and not cached, so the next attempt primes again
+            std::vector<std::wstring> offline = { L"\\\\offline\\share" };
+            auto failed = cache.TryAcquire(offline, {}, {});
+            Assert::IsFalse(failed.HasValue());
+            Assert::AreEqual(static_cast<int32_t>(0x80070015), failed.Error().code);
+            Assert::IsFalse(cache.TryAcquire(offline, {}, {}).HasValue());
+            Assert::AreEqual(static_cast<size_t>(2), primer->primeCount);
+
+            auto statistics = cache.GetStatistics();
+            Assert::AreEqual(static_cast<uint64_t>(2), statistics.primeFailures);
+            Assert::AreEqual(static_cast<size_t>(0), statistics.entries);
+
+            // A scope that cannot be used in SQL is the caller's mistake
+            Assert::ExpectException<std::invalid_argument>([&] { cache.TryAcquire({ L"C:\\a\nb" }, {}, {}); });
+            Assert::AreEqual(static_cast<uint64_t>(2), cache.GetStatistics().primes);
+        }
+    };
+}
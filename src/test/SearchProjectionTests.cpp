@@ -0,0 +1,126 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#include "pch.h"
+#include <windows.h>
+
+#include <SearchProjection.h>
+#include <SearchQueryBuilder.h>
+#include <SearchResult.h>
+#include <chrono>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace wsearch;
+
+namespace SearchProjectionTests
+{
+    using FileProjection = Projection<props::ItemUrl, props::ItemNameDisplay, props::Size, props::DateModified>;
+
+    // The SELECT list is produced by the compiler; a typo in a property tag breaks the build
+    static_assert(FileProjection::ColumnCount == 4);
+    static_assert(FileProjection::SelectList == L"System.ItemUrl, System.ItemNameDisplay, System.Size, System.DateModified");
+    static_assert(Projection<props::Title>::SelectList == L"System.Title");
+
+    TEST_CLASS(SearchProjectionTests)
+    {
+    private:
+        static std::wstring BuildDocumentsQuery(size_t topN)
+        {
+            return SearchQueryBuilder()
+                .WithProjection<FileProjection>()
+                .WithScopes({ details::GetKnownFolderScope(FOLDERID_Documents) })
+                .WithTopN(topN)
+                .Build();
+        }
+
+    public:
+        TEST_METHOD(TestRowHasNamedFields)
+        {
+            Logger::WriteMessage(L"Testing projection row layout...\n");
+
+            FileProjection::Row row;
+            row.itemUrl = L"file:///C:/Users/Documents/report.docx";
+            row.size = 1024;
+
+            Assert::AreEqual(static_cast<uint64_t>(1024), Get<props::Size>(row));
+            Assert::AreEqual(row.itemUrl, Get<props::ItemUrl>(row));
+            Assert::AreEqual(0ul, row.dateModified.dwLowDateTime);
+            Assert::IsTrue(row.itemNameDisplay.empty());
+        }
+
+        TEST_METHOD(TestBuilderSelectsProjectionColumns)
+        {
+            Logger::WriteMessage(L"Testing builder uses the projection column list...\n");
+
+            auto sql = SearchQueryBuilder().WithProjection<FileProjection>().WithTopN(10).WithSearchText(L"report").Build();
+
+            std::wstring expectedSelect = L"SELECT TOP 10 " + std::wstring(FileProjection::SelectList) + L" FROM SystemIndex";
+            Assert::AreEqual(static_cast<size_t>(0), sql.find(expectedSelect));
+        }
+
+        TEST_METHOD(TestFetchRowsMatchesSearchResult)
+        {
+            Logger::WriteMessage(L"Testing projected rows against SearchResult accessors...\n");
+
+            auto sql = BuildDocumentsQuery(25);
+            auto projected = FileProjection::FetchRows(details::ExecuteQuery(sql).get());
+
+            std::vector<std::wstring> urls;
+            std::vector<int64_t> sizes;
+            auto rowset = details::ExecuteQuery(sql);
+            details::EnumerateRowsWithCallback(rowset.get(), [&](IPropertyStore* store) {
+                SearchResult result(store);
+                urls.push_back(result.GetPath());
+                sizes.push_back(result.GetSize());
+            });
+
+            Assert::AreEqual(urls.size(), projected.size());
+            for (size_t i = 0; i < projected.size(); ++i)
+            {
+                Assert::AreEqual(urls[i], projected[i].itemUrl);
+                Assert::AreEqual(static_cast<uint64_t>(sizes[i]), projected[i].size);
+            }
+        }
+
+        TEST_METHOD(TestFetchRowsHonorsMaxRows)
+        {
+            Logger::WriteMessage(L"Testing row limit...\n");
+
+            auto rows = FileProjection::FetchRows(details::ExecuteQuery(BuildDocumentsQuery(0)).get(), 3);
+            Assert::IsTrue(rows.size() <= 3);
+        }
+
+        TEST_METHOD(PerfTest_ProjectionVersusSearchResult)
+        {
+            Logger::WriteMessage(L"PERFORMANCE TEST: Projection vs SearchResult decoding\n");
+
+            auto sql = BuildDocumentsQuery(2000);
+
+            auto start = std::chrono::steady_clock::now();
+            size_t projectedRows = 0;
+            uint64_t projectedBytes = 0;
+            FileProjection::EnumerateRows(details::ExecuteQuery(sql).get(), [&](FileProjection::Row&& row) {
+                ++projectedRows;
+                projectedBytes += row.size + row.itemUrl.size() + row.itemNameDisplay.size() + row.dateModified.dwLowDateTime;
+            });
+            double projectionMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            start = std::chrono::steady_clock::now();
+            size_t storeRows = 0;
+            uint64_t storeBytes = 0;
+            auto rowset = details::ExecuteQuery(sql);
+            details::EnumerateRowsWithCallback(rowset.get(), [&](IPropertyStore* store) {
+                SearchResult result(store);
+                ++storeRows;
+                auto modified = result.GetDateModified();
+                storeBytes += result.GetSize() + result.GetPath().size() + result.GetFileName().size() + (modified ? modified->dwLowDateTime : 0);
+            });
+            double storeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            wchar_t msg[256];
+            swprintf_s(msg, L"  %zu rows: Projection %.2f ms, SearchResult %.2f ms\n", projectedRows, projectionMs, storeMs);
+            Logger::WriteMessage(msg);
+
+            Assert::AreEqual(storeRows, projectedRows);
+            Assert::AreEqual(storeBytes, projectedBytes);
+        }
+    };
+}
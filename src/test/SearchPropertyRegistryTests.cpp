@@ -0,0 +1,136 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#include "pch.h"
+#include <windows.h>
+
+#include <SearchPropertyRegistry.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace wsearch;
+
+namespace SearchPropertyRegistryTests
+{
+    static_assert(PropertyRegistry::FindWellKnown(L"System.ItemUrl") == propid::ItemUrl, "Well-known lookup is constexpr");
+    static_assert(PropertyRegistry::FindWellKnown(L"SYSTEM.SIZE") == propid::Size, "Well-known lookup folds case");
+    static_assert(PropertyRegistry::FindWellKnown(L"System.Rating") == InvalidPropertyId, "Unknown names miss");
+
+    // Knows one property the well-known table does not
+    class FakeSchemaSource : public IPropertySchemaSource
+    {
+    public:
+        bool Describe(std::wstring_view name, std::wstring& canonicalName, PropertyKeyValue& key, PropertyValueType& type) override
+        {
+            ++m_calls;
+            if (name != L"system.rating" && name != L"System.Rating")
+            {
+                return false;
+            }
+            canonicalName = L"System.Rating";
+            key = { 0x64440492, 0x4C8B, 0x11D1, { 0x8B, 0x70, 0x08, 0x00, 0x36, 0xB1, 0x1A, 0x03 }, 9 };
+            type = PropertyValueType::UInt32;
+            return true;
+        }
+
+        std::atomic<size_t> m_calls{ 0 };
+    };
+
+    TEST_CLASS(SearchPropertyRegistryTests)
+    {
+    public:
+        TEST_METHOD(TestWellKnownProperties)
+        {
+            Logger::WriteMessage(L"Testing well-known properties...\n");
+
+            PropertyRegistry registry;
+            for (PropertyId id = 0; id < propid::WellKnownCount; ++id)
+            {
+                auto info = registry.GetInfo(id);
+                Assert::AreEqual(static_cast<int>(id), static_cast<int>(info.id));
+                Assert::AreEqual(static_cast<int>(id), static_cast<int>(registry.Find(info.name)));
+                Assert::IsTrue(info.hasKey);
+                Assert::IsTrue(info.type != PropertyValueType::Unknown);
+            }
+
+            Assert::AreEqual(std::wstring(L"System.Document.LineCount"), std::wstring(registry.GetName(propid::DocumentLineCount)));
+            Assert::AreEqual(static_cast<int>(propid::Size), static_cast<int>(registry.Intern(L"system.size")));
+            Assert::AreEqual(static_cast<uint32_t>(12), registry.GetInfo(propid::Size).key.pid);
+
+            // Prefixes and near misses of well-known names are not well-known
+            Assert::AreEqual(static_cast<int>(InvalidPropertyId), static_cast<int>(registry.Find(L"System.Item")));
+            Assert::AreEqual(static_cast<int>(InvalidPropertyId), static_cast<int>(registry.Find(L"System.Sizes")));
+            Assert::AreEqual(static_cast<size_t>(0), registry.GetInternedCount());
+        }
+
+        TEST_METHOD(TestUnknownNamesAreInternedOnce)
+        {
+            Logger::WriteMessage(L"Testing interning...\n");
+
+            auto schema = std::make_shared<FakeSchemaSource>();
+            PropertyRegistry registry(schema);
+
+            PropertyId rating = registry.Intern(L"system.rating");
+            Assert::IsTrue(rating >= propid::WellKnownCount);
+            Assert::AreEqual(static_cast<int>(rating), static_cast<int>(registry.Intern(L"System.RATING")));
+            Assert::AreEqual(static_cast<int>(rating), static_cast<int>(registry.Find(L"System.Rating")));
+            Assert::AreEqual(static_cast<size_t>(1), schema->m_calls.load());
+
+            auto info = registry.GetInfo(rating);
+            Assert::AreEqual(std::wstring(L"System.Rating"), std::wstring(info.name));
+            Assert::IsTrue(info.hasKey);
+            Assert::IsTrue(info.type == PropertyValueType::UInt32);
+
+            // Names the schema does not know keep their spelling and have no key
+            PropertyId custom = registry.Intern(L"Contoso.Project");
+            Assert::AreNotEqual(static_cast<int>(rating), static_cast<int>(custom));
+            Assert::AreEqual(std::wstring(L"Contoso.Project"), std::wstring(registry.GetName(custom)));
+            Assert::IsFalse(registry.GetInfo(custom).hasKey);
+            Assert::AreEqual(static_cast<size_t>(2), registry.GetInternedCount());
+        }
+
+        TEST_METHOD(TestConcurrentInterning)
+        {
+            Logger::WriteMessage(L"Testing concurrent interning...\n");
+
+            PropertyRegistry registry;
+            std::vector<std::vector<PropertyId>> ids(8);
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < ids.size(); ++t)
+            {
+                threads.emplace_back([&registry, &ids, t]() {
+                    for (int i = 0; i < 200; ++i)
+                    {
+                        ids[t].push_back(registry.Intern(L"Custom.Property" + std::to_wstring(i)));
+                    }
+                });
+            }
+            for (auto& thread : threads)
+            {
+                thread.join();
+            }
+
+            Assert::AreEqual(static_cast<size_t>(200), registry.GetInternedCount());
+            for (size_t t = 1; t < ids.size(); ++t)
+            {
+                Assert::IsTrue(ids[t] == ids[0]);
+            }
+            Assert::AreEqual(std::wstring(L"Custom.Property7"), std::wstring(registry.GetName(ids[0][7])));
+        }
+
+        TEST_METHOD(TestPropertyIdSet)
+        {
+            Logger::WriteMessage(L"Testing property id sets...\n");
+
+            PropertyIdSet set;
+            Assert::IsTrue(set.Insert(propid::Size));
+            Assert::IsFalse(set.Insert(propid::Size));
+            Assert::IsTrue(set.Insert(200));
+            Assert::IsTrue(set.Contains(200));
+            Assert::IsFalse(set.Contains(201));
+            Assert::IsFalse(set.Contains(5000));
+            Assert::IsTrue(set.Contains(propid::Size));
+        }
+    };
+}
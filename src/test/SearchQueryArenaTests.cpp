@@ -0,0 +1,163 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#include "pch.h"
+#include <windows.h>
+
+#include <SearchPlatCore.h>
+#include <SearchQueryArena.h>
+#include <SearchQueryCost.h>
+#include <SearchSqlText.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace wsearch;
+
+namespace SearchQueryArenaTests
+{
+    TEST_CLASS(SearchQueryArenaTests)
+    {
+    public:
+        TEST_METHOD(TestCountingResourceChargesCurrentStage)
+        {
+            Logger::WriteMessage(L"Testing per-stage allocation accounting...\n");
+
+            AllocationCountingResource counter;
+            {
+                AllocationStageScope stage(&counter, QueryAllocationStage::Sql);
+                std::pmr::wstring sql(L"SELECT System.ItemUrl FROM SystemIndex WHERE SCOPE='file:C:/Users'", &counter);
+                {
+                    AllocationStageScope nested(&counter, QueryAllocationStage::Scopes);
+                    std::pmr::vector<std::pmr::wstring> scopes(&counter);
+                    scopes.emplace_back(L"file:C:/Users/someone/Documents/Projects/Quarterly");
+                }
+            }
+
+            Assert::AreEqual(static_cast<size_t>(1), counter.GetCounters(QueryAllocationStage::Sql).allocations);
+            Assert::IsTrue(counter.GetCounters(QueryAllocationStage::Scopes).allocations >= 2);
+            Assert::IsTrue(counter.GetStage() == QueryAllocationStage::Other);
+
+            auto total = counter.GetTotal();
+            Assert::AreEqual(total.allocations, total.deallocations);
+
+            counter.Reset();
+            Assert::AreEqual(static_cast<size_t>(0), counter.GetTotal().allocations);
+        }
+
+        TEST_METHOD(TestArenaServesTypicalQueryWithoutHeap)
+        {
+            Logger::WriteMessage(L"Testing that a query's SQL fits in the arena's inline buffer...\n");
+
+            std::vector<std::wstring> properties = { L"System.ItemNameDisplay", L"System.DateModified", L"System.Size" };
+
+            AllocationCountingResource counter;
+            {
+                QueryArena arena(&counter);
+                std::pmr::wstring sql(arena.Resource());
+                details::AppendReuseWhereSearchSql(sql, properties, 42, L"quarterly budget review");
+                Assert::IsTrue(sql.size() > 200);
+            }
+
+            Assert::AreEqual(static_cast<size_t>(0), counter.GetTotal().allocations);
+        }
+
+        TEST_METHOD(TestArenaChargesEachStage)
+        {
+            Logger::WriteMessage(L"Testing per-stage accounting on a query arena...\n");
+
+            std::vector<std::wstring> properties = { L"System.ItemNameDisplay", L"System.Size" };
+            QueryCostModel model;
+
+            AllocationCountingResource counter;
+            {
+                QueryArena arena(&counter);
+                auto plan = [&]() {
+                    AllocationStageScope stage(arena, QueryAllocationStage::Tokenize);
+                    return model.Plan(L"the quarterly budget review", { L"file:" }, 0, arena.Resource());
+                }();
+                {
+                    AllocationStageScope stage(arena, QueryAllocationStage::Logging);
+                    std::pmr::wstring description(arena.Resource());
+                    plan.AppendDescription(description);
+                    Assert::IsTrue(description.find(L"dropped stop-words: the") != std::pmr::wstring::npos);
+                }
+                {
+                    AllocationStageScope stage(arena, QueryAllocationStage::Sql);
+                    std::pmr::wstring sql(arena.Resource());
+                    std::pmr::wstring contentText(arena.Resource());
+                    plan.AppendTokens(contentText, true);
+                    details::AppendReuseWhereSearchSql(sql, properties, 42, contentText, plan.topN, plan.FilenameOnlyTokens());
+                }
+                {
+                    AllocationStageScope stage(arena, QueryAllocationStage::Results);
+                    std::pmr::vector<std::pmr::wstring> row(arena.Resource());
+                    row.emplace_back(L"file:C:/Users/someone/Documents/Quarterly budget review.docx");
+                    row.emplace_back(L"Quarterly budget review.docx");
+                }
+
+                for (auto stage : { QueryAllocationStage::Tokenize, QueryAllocationStage::Logging, QueryAllocationStage::Sql,
+                         QueryAllocationStage::Results })
+                {
+                    Assert::IsTrue(arena.GetCounters(stage).allocations > 0);
+                    Assert::IsTrue(arena.GetCounters(stage).bytes > 0);
+                }
+                Assert::AreEqual(static_cast<size_t>(0), arena.GetCounters(QueryAllocationStage::Other).allocations);
+            }
+
+            // All of it fit in the inline buffer
+            Assert::AreEqual(static_cast<size_t>(0), counter.GetTotal().allocations);
+        }
+
+        TEST_METHOD(TestArenaOverflowsToUpstream)
+        {
+            Logger::WriteMessage(L"Testing arena growth past the inline buffer...\n");
+
+            AllocationCountingResource counter;
+            {
+                QueryArena arena(&counter);
+                AllocationStageScope stage(arena, QueryAllocationStage::Results);
+                std::pmr::wstring big(QueryArena::InlineBytes, L'x', arena.Resource());
+                Assert::IsTrue(counter.GetCounters(QueryAllocationStage::Results).allocations > 0);
+            }
+
+            // Everything goes back in one shot when the arena is destroyed
+            auto total = counter.GetTotal();
+            Assert::AreEqual(total.allocations, total.deallocations);
+        }
+
+        TEST_METHOD(TestPmrBuildersMatchStdBuilders)
+        {
+            Logger::WriteMessage(L"Testing pmr overloads produce identical SQL...\n");
+
+            QueryArena arena;
+            for (const wchar_t* text : { L"", L"report", L"two words", L"\"exact phrase\"", L"o'brien's  file" })
+            {
+                auto expected = details::BuildSearchWhereClause(text);
+                auto actual = details::BuildSearchWhereClause(text, arena.Resource());
+                Assert::AreEqual(expected, std::wstring(actual.begin(), actual.end()));
+            }
+
+            std::vector<std::wstring> included = { L"C:\\Users\\Documents", L"file:D:\\Data" };
+            std::vector<std::wstring> excluded = { L"C:\\Users\\Documents\\Archive" };
+            std::vector<std::wstring> properties = { L"System.Size" };
+            auto expected = details::BuildPrimingSqlFromScopes(included, excluded, properties);
+            auto actual = details::BuildPrimingSqlFromScopes(included, excluded, properties, arena.Resource());
+            Assert::AreEqual(expected, std::wstring(actual.begin(), actual.end()));
+        }
+
+        TEST_METHOD(TestSqlTextEscapingAndNumbers)
+        {
+            Logger::WriteMessage(L"Testing SQL text helpers...\n");
+
+            std::wstring escaped;
+            details::AppendEscapedSqlText(escaped, L"it's a 'test''");
+            Assert::AreEqual(std::wstring(L"it''s a ''test''''"), escaped);
+
+            std::wstring where;
+            details::AppendSearchWhereClause(where, L"a'b c");
+            Assert::IsTrue(where.find(L"CONTAINS(*, 'a''b*') AND CONTAINS(*, 'c*')") != std::wstring::npos);
+
+            std::wstring number;
+            details::AppendUnsigned(number, 0);
+            details::AppendUnsigned(number, 4294967295ull);
+            Assert::AreEqual(std::wstring(L"04294967295"), number);
+        }
+    };
+}
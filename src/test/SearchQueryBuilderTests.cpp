@@ -102,6 +102,21 @@ namespace SearchQueryBuilderTests
             
             Logger::WriteMessage(L"Three word tokenization passed\n");
         }
+
+        TEST_METHOD(TestIncompleteInput)
+        {
+            Logger::WriteMessage(L"Testing half-typed input...\n");
+            
+            SearchTokenizer openQuote(L"\"annual rep");
+            Assert::IsTrue(openQuote.IsQuoted());
+            Assert::IsTrue(openQuote.IsPhrasePrefix());
+            Assert::AreEqual(L"annual rep", openQuote.GetTokens()[0].c_str());
+            
+            SearchTokenizer danglingOperator(L"-");
+            Assert::IsTrue(danglingOperator.IsEmpty());
+            
+            Logger::WriteMessage(L"Half-typed input tokenization passed\n");
+        }
     };
 
     TEST_CLASS(SearchQueryBuilderTests)
@@ -258,6 +273,27 @@ namespace SearchQueryBuilderTests
             Logger::WriteMessage(L"\n");
         }
 
+        TEST_METHOD(TestAdditionalPropertiesSelectedOnce)
+        {
+            Logger::WriteMessage(L"Testing additional property de-duplication...\n");
+            
+            SearchQueryBuilder builder;
+            auto query = builder
+                .WithSearchText(L"test")
+                .WithProperties({L"System.Item", L"system.size", L"System.Title", L"System.Title"})
+                .Build();
+            
+            // Duplicates are matched by property, not by substring: System.Item is not part of System.ItemUrl
+            auto select = query.substr(0, query.find(L" FROM "));
+            Assert::IsTrue(select.find(L", System.Item,") != std::wstring::npos);
+            Assert::IsTrue(select.find(L"System.Size") == select.rfind(L"System.Size"));
+            Assert::IsTrue(select.find(L"system.size") == std::wstring::npos);
+            Assert::IsTrue(select.find(L"System.Title") == select.rfind(L"System.Title"));
+            
+            Logger::WriteMessage(select.c_str());
+            Logger::WriteMessage(L"\n");
+        }
+
         TEST_METHOD(TestOrderByClause)
         {
             Logger::WriteMessage(L"Testing ORDER BY clause...\n");
@@ -420,5 +456,139 @@ namespace SearchQueryBuilderTests
             
             Logger::WriteMessage(L"Core properties verified\n");
         }
+
+        TEST_METHOD(TestIncompleteInputQuery)
+        {
+            Logger::WriteMessage(L"Testing queries for half-typed input...\n");
+            
+            SearchQueryBuilder builder;
+            auto query = builder
+                .WithSearchText(L"\"annual rep")
+                .Build();
+            
+            // An open quote matches the phrase and phrases starting with it
+            Assert::IsTrue(query.find(L"CONTAINS(#MRProps, '\"annual rep\"'") != std::wstring::npos);
+            Assert::IsTrue(query.find(L"CONTAINS(#MRProps, '\"annual rep*\"'") != std::wstring::npos);
+            
+            // Nothing searchable: no condition and no dangling WHERE
+            SearchQueryBuilder operatorOnly;
+            auto operatorQuery = operatorOnly.WithSearchText(L"-").Build();
+            Assert::IsTrue(operatorQuery.find(L"WHERE") == std::wstring::npos);
+            
+            Logger::WriteMessage(query.c_str());
+            Logger::WriteMessage(L"\n");
+        }
+
+        TEST_METHOD(TestCostPolicyRewritesShortPrefix)
+        {
+            Logger::WriteMessage(L"Testing cost-based rewrite of a short prefix...\n");
+
+            SearchQueryBuilder builder;
+            auto query = builder
+                .WithCostPolicy(QueryCostPolicy{})
+                .WithSearchText(L"ab")
+                .Build();
+
+            // Content matches are limited to the file name and the result count is capped
+            Assert::IsTrue(builder.GetLastQueryPlan().has_value());
+            Assert::IsTrue(builder.GetLastQueryPlan()->IsFilenameOnly(0));
+            Assert::IsTrue(query.find(L"SELECT TOP 200 ") == 0);
+            Assert::IsTrue(query.find(L"CONTAINS(*") == std::wstring::npos);
+            Assert::IsTrue(query.find(L"CONTAINS(System.FileName, '\"ab\"'") != std::wstring::npos);
+
+            // Only the short token is restricted in mixed text
+            SearchQueryBuilder mixed;
+            auto mixedQuery = mixed.WithCostPolicy(QueryCostPolicy{}).WithSearchText(L"my quarterly report").Build();
+            Assert::IsTrue(mixedQuery.find(L"CONTAINS(System.FileName, '\"my*\"'") != std::wstring::npos);
+            Assert::IsTrue(mixedQuery.find(L"CONTAINS(*, '\"quarterly*\"'") != std::wstring::npos);
+            Assert::IsTrue(mixedQuery.find(L"CONTAINS(*, '\"report*\"'") != std::wstring::npos);
+
+            // Without a policy the query is built as before
+            SearchQueryBuilder plain;
+            auto plainQuery = plain.WithSearchText(L"ab").Build();
+            Assert::IsFalse(plain.GetLastQueryPlan().has_value());
+            Assert::IsTrue(plainQuery.find(L"CONTAINS(*") != std::wstring::npos);
+
+            Logger::WriteMessage(builder.GetLastQueryPlan()->Describe().c_str());
+            Logger::WriteMessage(L"\n");
+        }
+
+        TEST_METHOD(TestScopesAndTermsAreEscaped)
+        {
+            Logger::WriteMessage(L"Testing escaping of scopes, terms and property names...\n");
+
+            SearchQueryBuilder builder;
+            auto query = builder
+                .WithScopes({L"C:\\Users\\O'Brien"})
+                .WithExcludedScopes({L"C:\\Users\\O'Brien\\Archive"})
+                .WithSearchText(L"o'brien \"notes")
+                .Build();
+
+            Assert::IsTrue(query.find(L"SCOPE='file:C:/Users/O''Brien'") != std::wstring::npos);
+            Assert::IsTrue(query.find(L"SCOPE<>'file:C:/Users/O''Brien/Archive'") != std::wstring::npos);
+            Assert::IsTrue(query.find(L"o''brien") != std::wstring::npos);
+
+            // Property names are written unquoted, so anything but a name is rejected
+            SearchQueryBuilder injected;
+            injected.WithProperties({L"System.Size FROM SystemIndex;--"});
+            Assert::ExpectException<std::invalid_argument>([&] { injected.Build(); });
+
+            Logger::WriteMessage(query.c_str());
+            Logger::WriteMessage(L"\n");
+        }
+
+        TEST_METHOD(TestClientSideOrdering)
+        {
+            Logger::WriteMessage(L"Testing rank-only ordering with TOP N headroom...\n");
+
+            SearchQueryBuilder builder;
+            auto query = builder
+                .WithSearchText(L"report")
+                .WithTopN(50)
+                .WithClientSideOrdering(64)
+                .Build();
+
+            Assert::IsTrue(query.find(L"SELECT TOP 114 ") == 0);
+            Assert::IsTrue(query.find(L" ORDER BY System.Search.Rank DESC") != std::wstring::npos);
+            Assert::IsTrue(query.find(L"System.Document.LineCount DESC") == std::wstring::npos);
+            Assert::AreEqual(static_cast<size_t>(114), builder.GetFetchLimit());
+
+            // The tie-break columns are still selected for the client-side sort
+            Assert::IsTrue(query.find(L"System.Document.LineCount,") != std::wstring::npos);
+            Assert::IsTrue(query.find(L"System.Search.GatherTime") != std::wstring::npos);
+
+            SearchQueryBuilder indexerOrdered;
+            auto indexerQuery = indexerOrdered.WithSearchText(L"report").WithTopN(50).Build();
+            Assert::IsTrue(indexerQuery.find(L"SELECT TOP 50 ") == 0);
+            Assert::IsTrue(indexerQuery.find(L"System.Document.LineCount DESC") != std::wstring::npos);
+        }
+
+        TEST_METHOD(TestFilters)
+        {
+            Logger::WriteMessage(L"Testing pushed filter predicates...\n");
+
+            auto parsed = ParseSearchFilters(L"kind:image -ext:tmp size:>1MB report");
+            SearchQueryBuilder builder;
+            auto query = builder
+                .WithScopes({ L"file:C:/Users" })
+                .WithSearchText(parsed.searchText)
+                .WithFilters(parsed.predicates)
+                .Build();
+
+            // Scope, then filters, then the search condition
+            size_t scope = query.find(L" WHERE (SCOPE='file:C:/Users')");
+            size_t kind = query.find(L" AND (System.Kind = 'picture')");
+            size_t extension = query.find(L" AND NOT (System.FileExtension = '.tmp')");
+            size_t size = query.find(L" AND (System.Size >= 1048577)");
+            size_t text = query.find(L" AND WITH (System.ItemNameDisplay) AS #MRProps");
+            Assert::IsTrue(scope != std::wstring::npos && scope < kind && kind < extension && extension < size && size < text);
+            Assert::IsTrue(text != std::wstring::npos);
+
+            // Filters alone still make a WHERE clause
+            SearchQueryBuilder filtersOnly;
+            auto filterQuery = filtersOnly.WithFilters(parsed.predicates).Build();
+            Assert::IsTrue(filterQuery.find(L" FROM SystemIndex WHERE (System.Kind = 'picture') AND NOT") != std::wstring::npos);
+            Assert::IsTrue(filterQuery.find(L"CONTAINS") == std::wstring::npos);
+        }
     };
 }
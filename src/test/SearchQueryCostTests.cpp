@@ -0,0 +1,161 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#include "pch.h"
+#include <windows.h>
+
+#include <SearchQueryCost.h>
+#include <SearchSqlText.h>
+#include <string>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace wsearch;
+
+namespace SearchQueryCostTests
+{
+    TEST_CLASS(SearchQueryCostTests)
+    {
+    public:
+        TEST_METHOD(TestShortPrefixIsFilenameOnlyWithTop)
+        {
+            Logger::WriteMessage(L"Testing one-letter prefix rewrite...\n");
+
+            QueryCostModel model;
+            auto plan = model.Plan(L"a", { L"file:" }, 0);
+
+            Assert::IsTrue(plan.IsFilenameOnly(0));
+            Assert::IsTrue(plan.autoTopN);
+            Assert::AreEqual(static_cast<size_t>(200), plan.topN);
+            Assert::AreEqual(std::wstring(L"a"), plan.JoinTokens());
+            Assert::IsTrue(plan.after.cost < plan.before.cost);
+            Assert::AreEqual(std::wstring(L"cost 128.0 -> 32.0; filename-only: a; TOP 200"), plan.Describe());
+        }
+
+        TEST_METHOD(TestOnlyShortTokensAreFilenameOnly)
+        {
+            Logger::WriteMessage(L"Testing a mix of short and long tokens...\n");
+
+            QueryCostModel model;
+            auto plan = model.Plan(L"my quarterly report", { L"file:" }, 0);
+
+            // "my" only matches file names; the long words still match content
+            Assert::AreEqual(static_cast<size_t>(3), plan.tokens.size());
+            Assert::IsTrue(plan.IsFilenameOnly(0));
+            Assert::IsFalse(plan.IsFilenameOnly(1));
+            Assert::IsFalse(plan.IsFilenameOnly(2));
+            Assert::AreEqual(std::wstring(L"quarterly report"), plan.JoinTokens(true));
+            Assert::AreEqual(std::wstring(L"my quarterly report"), plan.JoinTokens());
+            Assert::IsTrue(plan.Describe().find(L"; filename-only: my") != std::wstring::npos);
+
+            // Restricting one token costs less than restricting none, more than restricting all
+            auto content = model.Estimate(plan.tokens, false, { L"file:" });
+            auto names = model.Estimate(plan.tokens, true, { L"file:" });
+            Assert::IsTrue(plan.after.cost < content.cost);
+            Assert::IsTrue(plan.after.cost > names.cost);
+
+            std::vector<std::wstring> properties;
+            std::wstring sql;
+            details::AppendReuseWhereSearchSql(sql, properties, 7, plan.JoinTokens(true), plan.topN, plan.FilenameOnlyTokens());
+            Assert::IsTrue(sql.find(L"CONTAINS(*, 'quarterly*') AND CONTAINS(*, 'report*')") != std::wstring::npos);
+            Assert::IsTrue(sql.find(L" AND CONTAINS(System.FileName, '\"my*\"') ORDER BY") != std::wstring::npos);
+            Assert::IsTrue(sql.find(L"CONTAINS(*, 'my") == std::wstring::npos);
+
+            // Stop-words fold ASCII only, whatever the C locale
+            Assert::IsTrue(details::IsQueryStopWord(L"THE"));
+            Assert::IsFalse(details::IsQueryStopWord(L"\x0130N"));
+        }
+
+        TEST_METHOD(TestSelectiveQueryIsUnchanged)
+        {
+            Logger::WriteMessage(L"Testing that cheap queries pass through...\n");
+
+            QueryCostModel model;
+            auto plan = model.Plan(L"quarterly", { L"C:\\Users\\me\\Documents" }, 0);
+
+            Assert::IsFalse(plan.IsRewritten());
+            Assert::AreEqual(static_cast<size_t>(0), plan.topN);
+            Assert::AreEqual(std::wstring(L"quarterly"), plan.JoinTokens());
+            Assert::IsTrue(plan.Describe().find(L"unchanged") != std::wstring::npos);
+        }
+
+        TEST_METHOD(TestStopWordsDroppedButNotTheTypedToken)
+        {
+            Logger::WriteMessage(L"Testing stop-word removal...\n");
+
+            QueryCostModel model;
+            auto plan = model.Plan(L"the report of", { L"file:" }, 0);
+
+            // "of" is still being typed (it may become "office"), so it stays
+            Assert::AreEqual(std::wstring(L"report of"), plan.JoinTokens());
+            Assert::AreEqual(static_cast<size_t>(1), plan.droppedStopWords.size());
+            Assert::AreEqual(std::wstring(L"the"), std::wstring(plan.droppedStopWords[0]));
+
+            // A lone stop-word is the whole query; it is limited, not dropped
+            auto single = model.Plan(L"the", { L"file:" }, 0);
+            Assert::AreEqual(std::wstring(L"the"), single.JoinTokens());
+            Assert::IsTrue(single.droppedStopWords.empty());
+        }
+
+        TEST_METHOD(TestAndChainCapKeepsLongestAndLast)
+        {
+            Logger::WriteMessage(L"Testing AND chain cap...\n");
+
+            QueryCostPolicy policy;
+            policy.maxAndTerms = 3;
+            QueryCostModel model(policy);
+            auto plan = model.Plan(L"budget q3 forecast final draft rev", {}, 0);
+
+            Assert::AreEqual(std::wstring(L"budget forecast rev"), plan.JoinTokens());
+            Assert::AreEqual(static_cast<size_t>(3), plan.droppedForAndCap.size());
+            Assert::IsTrue(plan.Describe().find(L"AND chain capped, dropped: q3, final, draft") != std::wstring::npos);
+        }
+
+        TEST_METHOD(TestQuotedPhraseIsNeverRewritten)
+        {
+            Logger::WriteMessage(L"Testing quoted phrases...\n");
+
+            QueryCostModel model;
+            auto plan = model.Plan(L"\"to be or not to be\"", { L"file:" }, 0);
+
+            Assert::IsFalse(plan.HasFilenameOnlyTokens());
+            Assert::IsTrue(plan.droppedStopWords.empty());
+            Assert::AreEqual(std::wstring(L"\"to be or not to be\""), plan.JoinTokens());
+        }
+
+        TEST_METHOD(TestRequestedTopAndNarrowScopesWin)
+        {
+            Logger::WriteMessage(L"Testing explicit TOP and scope breadth...\n");
+
+            QueryCostModel model;
+            Assert::AreEqual(static_cast<size_t>(30), model.Plan(L"ab", { L"file:" }, 30).topN);
+
+            auto wide = model.Estimate({ L"rep" }, false, { L"file:" });
+            auto drive = model.Estimate({ L"rep" }, false, { L"C:\\" });
+            auto folder = model.Estimate({ L"rep" }, false, { L"C:\\Users\\me\\Documents" });
+            Assert::IsTrue(wide.cost > drive.cost);
+            Assert::IsTrue(drive.cost > folder.cost);
+
+            // Overlapping scopes never count for more than the whole index
+            Assert::AreEqual(1.0, model.Estimate({ L"rep" }, false, { L"C:\\", L"D:\\", L"E:\\" }).scopeBreadth);
+        }
+
+        TEST_METHOD(TestSqlUsesFileNameConditionAndTop)
+        {
+            Logger::WriteMessage(L"Testing rewritten SQL...\n");
+
+            QueryCostModel model;
+            auto plan = model.Plan(L"ab", { L"file:" }, 0);
+
+            std::vector<std::wstring> properties;
+            std::wstring sql;
+            details::AppendReuseWhereSearchSql(sql, properties, 7, plan.JoinTokens(true), plan.topN, plan.FilenameOnlyTokens());
+
+            Assert::AreEqual(std::wstring(L"SELECT TOP 200 System.ItemUrl FROM SystemIndex WHERE REUSEWHERE(7)"
+                L" AND CONTAINS(System.FileName, '\"ab*\"') ORDER BY System.Search.Rank DESC"), sql);
+
+            // Defaults still produce the historical SQL
+            std::wstring classic;
+            details::AppendReuseWhereSearchSql(classic, properties, 7, L"ab");
+            Assert::IsTrue(classic.find(L"SELECT System.ItemUrl") == 0);
+            Assert::IsTrue(classic.find(L"CONTAINS(*, 'ab*')") != std::wstring::npos);
+        }
+    };
+}
@@ -0,0 +1,317 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#include "pch.h"
+#include <windows.h>
+
+#include <SearchQueryParser.h>
+#include <SearchSqlText.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace wsearch;
+
+namespace SearchQueryParserTests
+{
+    static std::wstring Words(std::wstring_view text)
+    {
+        std::wstring words;
+        ParseSearchText(text).AppendWords(words);
+        return words;
+    }
+
+    // A full-text condition the indexer accepts: one "phrase" (optionally "phrase*"), or plain
+    // words with an optional '*' on the last one. No stray quotes, grouping, operator characters,
+    // boolean keywords or empty terms.
+    static bool IsWellFormedCondition(std::wstring_view condition)
+    {
+        auto isWord = [](std::wstring_view word, bool allowKeyword) {
+            bool hasAlphanumeric = false;
+            for (wchar_t ch : word)
+            {
+                if (ch == L'"' || ch == L'(' || ch == L')' || ch == L'&' || ch == L'|' || ch == L'!' || ch == L'~' || ch == L'*')
+                {
+                    return false;
+                }
+                hasAlphanumeric = hasAlphanumeric || details::IsSearchTextWordCharacter(ch);
+            }
+            return hasAlphanumeric && (allowKeyword || !details::IsSearchTextKeyword(word));
+        };
+        auto isWordList = [&](std::wstring_view text, bool allowKeywords) {
+            if (text.empty() || text.front() == L' ' || text.back() == L' ')
+            {
+                return false;
+            }
+            size_t start = 0;
+            while (start <= text.size())
+            {
+                size_t end = (std::min)(text.find(L' ', start), text.size());
+                if (!isWord(text.substr(start, end - start), allowKeywords))
+                {
+                    return false;
+                }
+                start = end + 1;
+            }
+            return true;
+        };
+
+        if (!condition.empty() && condition.front() == L'"')
+        {
+            if (condition.size() < 3 || condition.back() != L'"')
+            {
+                return false;
+            }
+            auto phrase = condition.substr(1, condition.size() - 2);
+            if (phrase.back() == L'*')
+            {
+                phrase.remove_suffix(1);
+            }
+            return isWordList(phrase, true);
+        }
+
+        if (!condition.empty() && condition.back() == L'*')
+        {
+            condition.remove_suffix(1);
+        }
+        return isWordList(condition, false);
+    }
+
+    // Balanced parentheses outside string literals, terminated literals, and a well-formed
+    // full-text condition in every CONTAINS
+    static bool IsWellFormedSql(const std::wstring& sql)
+    {
+        int depth = 0;
+        size_t i = 0;
+        while (i < sql.size())
+        {
+            wchar_t ch = sql[i];
+            if (ch == L'(')
+            {
+                ++depth;
+            }
+            else if (ch == L')' && --depth < 0)
+            {
+                return false;
+            }
+            else if (ch == L'\'')
+            {
+                // The first literal after "CONTAINS(column, " is its full-text condition
+                size_t contains = sql.rfind(L"CONTAINS(", i);
+                bool inContains = contains != std::wstring::npos && sql.find_first_of(L"')", contains + 9) == i;
+
+                std::wstring literal;
+                size_t j = i + 1;
+                for (;; ++j)
+                {
+                    if (j >= sql.size())
+                    {
+                        return false;
+                    }
+                    if (sql[j] == L'\'')
+                    {
+                        if (j + 1 < sql.size() && sql[j + 1] == L'\'')
+                        {
+                            literal.push_back(L'\'');
+                            ++j;
+                            continue;
+                        }
+                        break;
+                    }
+                    literal.push_back(sql[j]);
+                }
+
+                if (inContains && !IsWellFormedCondition(literal))
+                {
+                    return false;
+                }
+                i = j;
+            }
+            ++i;
+        }
+        return depth == 0;
+    }
+
+    TEST_CLASS(SearchQueryParserTests)
+    {
+    public:
+        TEST_METHOD(TestWellFormedTextIsUnchanged)
+        {
+            Logger::WriteMessage(L"Testing well-formed search text...\n");
+
+            auto words = ParseSearchText(L"annual report");
+            Assert::IsTrue(words.shape == SearchTextShape::Words);
+            Assert::AreEqual(static_cast<size_t>(2), words.wordCount);
+            Assert::IsFalse(words.repaired);
+
+            auto phrase = ParseSearchText(L"\"annual report\"");
+            Assert::IsTrue(phrase.shape == SearchTextShape::Phrase);
+            Assert::IsFalse(phrase.repaired);
+            Assert::AreEqual(std::wstring(L"annual report"), Words(L"\"annual report\""));
+
+            // Word-internal punctuation belongs to the word
+            Assert::AreEqual(std::wstring(L"o'brien x-ray c++"), Words(L"o'brien x-ray c++"));
+            Assert::IsFalse(ParseSearchText(L"o'brien x-ray c++").repaired);
+        }
+
+        TEST_METHOD(TestOpenQuoteIsPhrasePrefix)
+        {
+            Logger::WriteMessage(L"Testing unbalanced quotes...\n");
+
+            auto parsed = ParseSearchText(L"\"annual rep");
+            Assert::IsTrue(parsed.shape == SearchTextShape::PhrasePrefix);
+            Assert::AreEqual(std::wstring(L"annual rep"), Words(L"\"annual rep"));
+
+            std::wstring where;
+            details::AppendSearchWhereClause(where, L"\"annual rep");
+            Assert::AreEqual(std::wstring(L" AND (CONTAINS(*, '\"annual rep\"') RANK BY COERCION(ABSOLUTE, 999) OR CONTAINS(*, '\"annual rep*\"') RANK BY COERCION(ABSOLUTE, 998))"), where);
+
+            // Quotes anywhere else don't make a phrase; their words are still searched
+            Assert::IsTrue(ParseSearchText(L"annual \"rep").shape == SearchTextShape::Words);
+            Assert::IsTrue(ParseSearchText(L"a \"b c\" d").repaired);
+            Assert::AreEqual(std::wstring(L"a b c d"), Words(L"a \"b c\" d"));
+        }
+
+        TEST_METHOD(TestDanglingOperatorsAreDropped)
+        {
+            Logger::WriteMessage(L"Testing dangling operators...\n");
+
+            Assert::AreEqual(std::wstring(L"annual"), Words(L"annual -"));
+            Assert::AreEqual(std::wstring(L"rep"), Words(L"rep'"));
+            Assert::AreEqual(std::wstring(L"budget"), Words(L"-budget"));
+            Assert::AreEqual(std::wstring(L"salt pepper"), Words(L"salt and pepper"));
+            Assert::AreEqual(std::wstring(L"report 1"), Words(L"report(1"));
+            Assert::IsTrue(ParseSearchText(L"annual -").repaired);
+
+            // Keywords are literal inside a phrase
+            Assert::AreEqual(std::wstring(L"salt and pepper"), Words(L"\"salt and pepper\""));
+        }
+
+        TEST_METHOD(TestNothingSearchableIsNoQuery)
+        {
+            Logger::WriteMessage(L"Testing input with nothing to search for...\n");
+
+            // Blank text lists the whole scope, as before any typing
+            for (const wchar_t* text : { L"", L"   ", L"\t\u3000" })
+            {
+                Assert::IsTrue(ParseSearchText(text).IsEmpty());
+                Assert::IsTrue(ParseSearchText(text).HasQuery());
+            }
+
+            // Typed text without a word in it is no query at all, not an unfiltered one
+            for (const wchar_t* text : { L"-", L"\"", L"\"\"", L"'", L"*", L"( )", L"or", L"AND", L"$$", L"\" - \"", L"- or +" })
+            {
+                auto parsed = ParseSearchText(text);
+                Assert::IsTrue(parsed.shape == SearchTextShape::NoQuery, text);
+                Assert::IsFalse(parsed.HasQuery());
+                Assert::IsTrue(parsed.repaired);
+                Assert::AreEqual(static_cast<size_t>(0), parsed.wordCount);
+
+                std::wstring where;
+                details::AppendSearchWhereClause(where, text);
+                Assert::IsTrue(where.empty());
+            }
+        }
+
+        TEST_METHOD(TestNonAsciiWords)
+        {
+            Logger::WriteMessage(L"Testing non-ASCII words in any locale...\n");
+
+            // Accented and CJK characters are word characters whatever the C locale says
+            auto cafe = ParseSearchText(L"caf\u00e9 cr\u00e8me");
+            Assert::IsTrue(cafe.HasQuery());
+            Assert::AreEqual(static_cast<size_t>(2), cafe.wordCount);
+            Assert::IsFalse(cafe.repaired);
+            Assert::AreEqual(std::wstring(L"caf\u00e9 cr\u00e8me"), Words(L"caf\u00e9 cr\u00e8me"));
+
+            Assert::AreEqual(std::wstring(L"\u6771\u4eac"), Words(L"\u6771\u4eac"));
+            Assert::AreEqual(std::wstring(L"\u00e9"), Words(L"-\u00e9"));
+            Assert::AreEqual(static_cast<size_t>(1), ParseSearchText(L"\"\u65e5\u672c\u8a9e").wordCount);
+
+            // Unicode white space separates words
+            Assert::AreEqual(std::wstring(L"\u6771\u4eac \u99c5"), Words(L"\u6771\u4eac\u3000\u99c5"));
+            Assert::AreEqual(std::wstring(L"caf\u00e9 noir"), Words(L"caf\u00e9\u00a0noir"));
+
+            std::wstring where;
+            details::AppendSearchWhereClause(where, L"\u6771\u4eac");
+            Assert::AreEqual(std::wstring(L" AND (CONTAINS(System.ItemNameDisplay, '\u6771\u4eac', 1033) RANK BY COERCION(ABSOLUTE, 999) OR CONTAINS(*, '\u6771\u4eac*'))"), where);
+        }
+
+        TEST_METHOD(TestEveryPrefixOfValidQueriesIsWellFormed)
+        {
+            Logger::WriteMessage(L"Testing every prefix of valid queries...\n");
+
+            for (const wchar_t* query : { L"\"annual report\" ", L"o'brien's notes", L"x-ray - scan", L"\"to be or not\"" })
+            {
+                std::wstring text = query;
+                for (size_t length = 0; length <= text.size(); ++length)
+                {
+                    std::wstring where;
+                    details::AppendSearchWhereClause(where, std::wstring_view(text).substr(0, length));
+                    Assert::IsTrue(IsWellFormedSql(where), where.c_str());
+                }
+            }
+        }
+
+        TEST_METHOD(TestFuzzGeneratedQueriesAreWellFormed)
+        {
+            Logger::WriteMessage(L"Fuzzing search text...\n");
+
+            static const wchar_t* pieces[] = {
+                L"a", L"re", L"port", L"budget", L"o'brien", L"x-ray", L"c++", L"42", L" ", L" ", L"  ", L"\t",
+                L"\"", L"\"", L"'", L"''", L"-", L"+", L"*", L"(", L")", L"&", L"|", L"!", L"~", L",", L".",
+                L"and", L"OR", L"Not", L"near", L"AND ", L" or ",
+            };
+            constexpr size_t pieceCount = sizeof(pieces) / sizeof(pieces[0]);
+
+            std::vector<std::wstring> properties = { L"System.ItemNameDisplay" };
+            uint32_t seed = 0x5eed;
+            size_t checked = 0;
+            size_t repaired = 0;
+            for (size_t round = 0; round < 3000; ++round)
+            {
+                std::wstring text;
+                seed = seed * 1103515245u + 12345u;
+                size_t count = 1 + (seed >> 16) % 10;
+                for (size_t i = 0; i < count; ++i)
+                {
+                    seed = seed * 1103515245u + 12345u;
+                    text += pieces[(seed >> 16) % pieceCount];
+                }
+
+                // Search-as-you-type sends every prefix
+                for (size_t length = 1; length <= text.size(); ++length)
+                {
+                    auto prefix = std::wstring_view(text).substr(0, length);
+                    // Words visited during the parse are the ones ForEachWord visits later
+                    std::wstring visited;
+                    auto parsed = ParseSearchText(prefix, [&](std::wstring_view word) {
+                        visited += visited.empty() ? L"" : L" ";
+                        visited += word;
+                    });
+                    std::wstring words;
+                    parsed.AppendWords(words);
+                    Assert::AreEqual(words, visited);
+                    repaired += parsed.repaired ? 1 : 0;
+
+                    const std::vector<std::wstring_view> fileNameWordSets[] = { {}, { L"a'b" } };
+                    for (const auto& fileNameWords : fileNameWordSets)
+                    {
+                        std::wstring sql;
+                        details::AppendReuseWhereSearchSql(sql, properties, 7, prefix, 0, fileNameWords);
+                        if (!IsWellFormedSql(sql))
+                        {
+                            Logger::WriteMessage((L"Malformed SQL for [" + std::wstring(prefix) + L"]: " + sql + L"\n").c_str());
+                            Assert::Fail(L"Generated SQL is not well-formed");
+                        }
+                        ++checked;
+                    }
+                }
+            }
+
+            Assert::IsTrue(repaired > 0);
+            wchar_t message[128];
+            swprintf_s(message, L"Checked %zu statements, %zu inputs needed repair\n", checked, repaired);
+            Logger::WriteMessage(message);
+        }
+    };
+}
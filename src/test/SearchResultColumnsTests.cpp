@@ -0,0 +1,240 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#include "pch.h"
+#include <windows.h>
+
+#include <SearchResultColumns.h>
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace wsearch;
+
+namespace SearchResultColumnsTests
+{
+    const wchar_t* const c_kinds[] = { L"document", L"picture", L"music", L"video", L"folder", L"program" };
+    const wchar_t* const c_extensions[] = { L".docx", L".png", L".jpg", L".mp3", L".txt", L".pdf", L".exe", L".xlsx",
+        L".cpp", L".h", L".zip", L".mp4" };
+
+    struct Item
+    {
+        int64_t size;
+        int64_t modified;
+        std::wstring kind;
+        std::wstring extension;
+    };
+
+    ResultBatch MakeBatch(const std::vector<Item>& items)
+    {
+        ResultBatch batch(items.size());
+        std::vector<int64_t> sizes;
+        std::vector<int64_t> modified;
+        for (const auto& item : items)
+        {
+            sizes.push_back(item.size);
+            modified.push_back(item.modified);
+        }
+        batch.AddNumberColumn(propid::Size, std::move(sizes));
+        batch.AddNumberColumn(propid::DateModified, std::move(modified));
+        CategoryColumn& kinds = batch.AddCategoryColumn(propid::Kind);
+        CategoryColumn& extensions = batch.AddCategoryColumn(propid::FileExtension);
+        for (const auto& item : items)
+        {
+            kinds.Append(item.kind);
+            extensions.Append(item.extension);
+        }
+        return batch;
+    }
+
+    std::vector<Item> RandomItems(std::mt19937& random, size_t count, size_t kindCount, size_t extensionCount)
+    {
+        std::vector<Item> items(count);
+        for (auto& item : items)
+        {
+            // Few distinct values so ties between keys are common; some sizes negative or missing
+            item.size = static_cast<int64_t>(random() % 7) * 1000 - 2000;
+            if (random() % 10 == 0)
+            {
+                item.size = c_missingNumber;
+            }
+            item.modified = 132000000000000000ll + static_cast<int64_t>(random() % 5) * 864000000000ll;
+            item.kind = (random() % 8 == 0) ? L"" : c_kinds[random() % kindCount];
+            item.extension = c_extensions[random() % extensionCount];
+        }
+        return items;
+    }
+
+    TEST_CLASS(SearchResultColumnsTests)
+    {
+    public:
+        TEST_METHOD(TestSortMatchesStableSort)
+        {
+            Logger::WriteMessage(L"Testing multi-key radix sorts against std::stable_sort...\n");
+
+            std::mt19937 random(3);
+            for (int iteration = 0; iteration < 200; ++iteration)
+            {
+                auto items = RandomItems(random, random() % 400, 6, 12);
+                ResultBatch batch = MakeBatch(items);
+
+                bool kindDescending = random() % 2 == 0;
+                bool sizeDescending = random() % 2 == 0;
+                bool modifiedDescending = random() % 2 == 0;
+                auto order = batch.SortRows({
+                    { propid::Kind, kindDescending ? ColumnSortOrder::Descending : ColumnSortOrder::Ascending },
+                    { propid::Size, sizeDescending ? ColumnSortOrder::Descending : ColumnSortOrder::Ascending },
+                    { propid::DateModified, modifiedDescending ? ColumnSortOrder::Descending : ColumnSortOrder::Ascending },
+                });
+
+                std::vector<uint32_t> expected(items.size());
+                for (uint32_t i = 0; i < expected.size(); ++i)
+                {
+                    expected[i] = i;
+                }
+                std::stable_sort(expected.begin(), expected.end(), [&](uint32_t a, uint32_t b) {
+                    const Item& x = items[a];
+                    const Item& y = items[b];
+                    if (x.kind != y.kind) return kindDescending ? x.kind > y.kind : x.kind < y.kind;
+                    if (x.size != y.size) return sizeDescending ? x.size > y.size : x.size < y.size;
+                    return modifiedDescending ? x.modified > y.modified : x.modified < y.modified;
+                });
+                Assert::IsTrue(expected == order);
+            }
+
+            // No keys keeps the batch order; an unknown column throws
+            ResultBatch batch = MakeBatch(RandomItems(random, 5, 6, 12));
+            Assert::IsTrue(std::vector<uint32_t>{ 0, 1, 2, 3, 4 } == batch.SortRows({}));
+            Assert::ExpectException<std::invalid_argument>([&] { batch.SortRows({ { propid::ItemUrl } }); });
+        }
+
+        TEST_METHOD(TestWideKeySorts)
+        {
+            Logger::WriteMessage(L"Testing sorts by keys too wide to pack with the row...\n");
+
+            // 40-bit times with 20-bit sizes fit one word without the row, wider sizes need a
+            // sort per key; thousands of rows take several radix levels
+            std::mt19937_64 random(5);
+            for (unsigned sizeBits : { 20u, 40u, 63u })
+            {
+                std::vector<Item> items(5000);
+                for (auto& item : items)
+                {
+                    item.size = static_cast<int64_t>(random() >> (64 - sizeBits)) - (int64_t(1) << (sizeBits - 1));
+                    item.modified = static_cast<int64_t>(random() >> 24);
+                    item.kind = c_kinds[random() % 6];
+                    item.extension = c_extensions[random() % 12];
+                }
+                items[7].size = items[4000].size;
+                items[7].modified = items[4000].modified;
+                items[7].kind = items[4000].kind;
+                ResultBatch batch = MakeBatch(items);
+
+                auto order = batch.SortRows({ { propid::Kind }, { propid::Size, ColumnSortOrder::Descending }, { propid::DateModified } });
+                std::vector<uint32_t> expected(items.size());
+                for (uint32_t i = 0; i < expected.size(); ++i)
+                {
+                    expected[i] = i;
+                }
+                std::stable_sort(expected.begin(), expected.end(), [&](uint32_t a, uint32_t b) {
+                    const Item& x = items[a];
+                    const Item& y = items[b];
+                    if (x.kind != y.kind) return x.kind < y.kind;
+                    if (x.size != y.size) return x.size > y.size;
+                    return x.modified < y.modified;
+                });
+                Assert::IsTrue(expected == order);
+            }
+        }
+
+        TEST_METHOD(TestFacetCounts)
+        {
+            Logger::WriteMessage(L"Testing facet and group counts against a map...\n");
+
+            std::mt19937 random(9);
+            // Kind cardinalities on both sides of the vectorized histogram's limit
+            for (size_t kindCount : { 1, 3, 6 })
+            {
+                for (size_t extensionCount : { 2, 12 })
+                {
+                    auto items = RandomItems(random, 1 + random() % 1000, kindCount, extensionCount);
+                    ResultBatch batch = MakeBatch(items);
+
+                    std::map<std::wstring, uint32_t> kinds;
+                    std::map<std::pair<std::wstring, std::wstring>, uint32_t> groups;
+                    for (const auto& item : items)
+                    {
+                        ++kinds[item.kind];
+                        ++groups[{ item.kind, item.extension }];
+                    }
+
+                    auto facets = batch.CountFacet(propid::Kind);
+                    Assert::AreEqual(kinds.size(), facets.size());
+                    for (size_t i = 0; i < facets.size(); ++i)
+                    {
+                        Assert::AreEqual(kinds[std::wstring(facets[i].value)], facets[i].count);
+                        Assert::IsTrue(i == 0 || facets[i - 1].count >= facets[i].count);
+                    }
+
+                    auto counted = batch.CountGroups(propid::Kind, propid::FileExtension);
+                    Assert::AreEqual(groups.size(), counted.size());
+                    for (const auto& group : counted)
+                    {
+                        Assert::AreEqual(groups[{ std::wstring(group.first), std::wstring(group.second) }], group.count);
+                    }
+                }
+            }
+
+            ResultBatch batch = MakeBatch({});
+            Assert::AreEqual(static_cast<size_t>(0), batch.CountFacet(propid::Kind).size());
+            Assert::ExpectException<std::invalid_argument>([&] { batch.CountFacet(propid::Size); });
+        }
+
+        TEST_METHOD(TestFromPage)
+        {
+            Logger::WriteMessage(L"Testing batches built from decoded pages...\n");
+
+            SearchValuePage page({ propid::ItemUrl, propid::Size, propid::DateModified, propid::Kind });
+            SearchValue picture[] = { SearchValue::FromStringView(L"picture"), SearchValue::FromStringView(L"document") };
+            SearchValue music[] = { SearchValue::FromStringView(L"music") };
+
+            SearchValue* values = page.AddRow();
+            values[0] = SearchValue::FromStringView(L"file:C:/a.png");
+            values[1] = SearchValue::FromUInt64(2048);
+            values[2] = SearchValue::FromFileTime(132000000000000000ull);
+            values[3] = SearchValue::CopyVector(picture, 2, page.Resource());
+            values = page.AddRow();
+            values[0] = SearchValue::FromStringView(L"file:C:/b.mp3");
+            values[3] = SearchValue::CopyVector(music, 1, page.Resource());
+            values = page.AddRow();
+            values[0] = SearchValue::FromStringView(L"file:C:/c.png");
+            values[1] = SearchValue::FromUInt64(4096);
+            values[2] = SearchValue::FromFileTime(131000000000000000ull);
+            values[3] = SearchValue::CopyVector(picture, 2, page.Resource());
+
+            ResultBatch batch = ResultBatch::FromPage(page);
+            Assert::AreEqual(static_cast<size_t>(3), batch.GetRowCount());
+            Assert::IsTrue(std::vector<int64_t>{ 2048, c_missingNumber, 4096 } == *batch.GetNumberColumn(propid::Size));
+            Assert::IsNotNull(batch.GetCategoryColumn(propid::ItemUrl));
+            Assert::IsNull(batch.GetNumberColumn(propid::Kind));
+
+            // Vectors are categorized by their first element
+            auto kinds = batch.CountFacet(propid::Kind);
+            Assert::AreEqual(static_cast<size_t>(2), kinds.size());
+            Assert::IsTrue(kinds[0].value == L"picture");
+            Assert::AreEqual(2u, kinds[0].count);
+
+            // Missing sizes sort below every real size
+            Assert::IsTrue(std::vector<uint32_t>{ 2, 0, 1 } == batch.SortRows({ { propid::Size, ColumnSortOrder::Descending } }));
+            Assert::IsTrue(std::vector<uint32_t>{ 1, 2, 0 } == batch.SortRows({ { propid::DateModified } }));
+
+            // Columns with no values take their kind from the schema
+            SearchValuePage folders({ propid::FileExtension, propid::Size });
+            folders.AddRow();
+            batch = ResultBatch::FromPage(folders);
+            Assert::AreEqual(0u, batch.GetCategoryColumn(propid::FileExtension)->GetCodes()[0]);
+            Assert::IsTrue(std::vector<int64_t>{ c_missingNumber } == *batch.GetNumberColumn(propid::Size));
+        }
+    };
+}
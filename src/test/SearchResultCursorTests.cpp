@@ -0,0 +1,185 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#include "pch.h"
+#include <windows.h>
+
+#include <SearchResultCursor.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace wsearch;
+
+namespace SearchResultCursorTests
+{
+    // Forward-only result set of 'rowCount' rows named "row<N>". Fails the test if the cursor
+    // asks for a range that doesn't start where an earlier read ended.
+    class FakePageSource : public IResultPageSource<std::wstring>
+    {
+    public:
+        explicit FakePageSource(size_t rowCount)
+            : m_rowCount(rowCount)
+        {
+        }
+
+        size_t ReadRows(size_t start, size_t count, std::vector<std::wstring>& rows) override
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (start != 0 && start > m_highWater)
+            {
+                m_outOfOrder = true;
+            }
+
+            size_t end = (std::min)(start + count, m_rowCount);
+            for (size_t i = start; i < end; ++i)
+            {
+                rows.push_back(L"row" + std::to_wstring(i));
+            }
+            m_highWater = (std::max)(m_highWater, end);
+            ++m_reads;
+            return end > start ? end - start : 0;
+        }
+
+        size_t GetReads()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_reads;
+        }
+
+        bool ReadOutOfOrder()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_outOfOrder;
+        }
+
+    private:
+        std::mutex m_mutex;
+        size_t m_rowCount;
+        size_t m_highWater = 0;
+        size_t m_reads = 0;
+        bool m_outOfOrder = false;
+    };
+
+    TEST_CLASS(SearchResultCursorTests)
+    {
+    private:
+        static ResultCursorOptions SmallPages()
+        {
+            ResultCursorOptions options;
+            options.pageSize = 10;
+            options.prefetchPages = 2;
+            options.maxResidentPages = 4;
+            return options;
+        }
+
+        // Scroll the way a list view does: hint the visible range, then ask for each row
+        static void ScrollTo(ResultCursor<std::wstring>& cursor, size_t first, size_t visible)
+        {
+            cursor.SetViewport(first, first + visible - 1);
+            cursor.WaitForIdle();
+            for (size_t i = first; i < first + visible; ++i)
+            {
+                std::wstring text;
+                Assert::IsTrue(cursor.VisitRow(i, [&](const std::wstring& row) { text = row; }));
+                Assert::AreEqual(L"row" + std::to_wstring(i), text);
+            }
+        }
+
+    public:
+        TEST_METHOD(TestFirstPageIsTheOnlySynchronousRead)
+        {
+            Logger::WriteMessage(L"Testing first page cost...\n");
+
+            auto source = std::make_unique<FakePageSource>(10000);
+            auto* fake = source.get();
+            std::atomic<size_t> changes{ 0 };
+            ResultCursor<std::wstring> cursor(std::move(source), SmallPages(), [&]() { ++changes; });
+
+            Assert::AreEqual(static_cast<size_t>(10), cursor.ReadFirstPage());
+            Assert::IsTrue(cursor.GetKnownRowCount() >= 10);
+            Assert::IsFalse(cursor.IsComplete());
+
+            bool visited = cursor.VisitRow(3, [](const std::wstring& row) { Assert::AreEqual(std::wstring(L"row3"), row); });
+            Assert::IsTrue(visited);
+
+            // Only the prefetch runs afterwards, in the background
+            cursor.WaitForIdle();
+            Assert::AreEqual(static_cast<size_t>(3), fake->GetReads());
+            Assert::AreEqual(static_cast<size_t>(30), cursor.GetKnownRowCount());
+            Assert::IsTrue(changes.load() >= 2);
+        }
+
+        TEST_METHOD(TestMissSchedulesPageWithoutBlocking)
+        {
+            Logger::WriteMessage(L"Testing that a miss returns immediately...\n");
+
+            ResultCursor<std::wstring> cursor(std::make_unique<FakePageSource>(100), SmallPages());
+            Assert::IsFalse(cursor.VisitRow(0, [](const std::wstring&) { Assert::Fail(L"not decoded yet"); }));
+
+            cursor.WaitForIdle();
+            Assert::IsTrue(cursor.VisitRow(0, [](const std::wstring&) {}));
+            Assert::AreEqual(static_cast<size_t>(1), cursor.GetStatistics().misses);
+        }
+
+        TEST_METHOD(TestDeepScrollKeepsMemoryBounded)
+        {
+            Logger::WriteMessage(L"Testing resident page bound while scrolling...\n");
+
+            auto source = std::make_unique<FakePageSource>(5000);
+            auto* fake = source.get();
+            auto options = SmallPages();
+            ResultCursor<std::wstring> cursor(std::move(source), options);
+            cursor.ReadFirstPage();
+
+            for (size_t first = 0; first + 20 <= 5000; first += 15)
+            {
+                ScrollTo(cursor, first, 20);
+                Assert::IsTrue(cursor.GetStatistics().residentPages <= options.maxResidentPages);
+            }
+
+            cursor.WaitForIdle();
+            Assert::IsTrue(cursor.IsComplete());
+            Assert::AreEqual(static_cast<size_t>(5000), cursor.GetKnownRowCount());
+            Assert::IsFalse(fake->ReadOutOfOrder());
+            Assert::IsTrue(cursor.GetStatistics().pageEvictions > 0);
+        }
+
+        TEST_METHOD(TestScrollingBackRereadsEvictedPages)
+        {
+            Logger::WriteMessage(L"Testing evicted pages come back...\n");
+
+            auto source = std::make_unique<FakePageSource>(1000);
+            auto* fake = source.get();
+            ResultCursor<std::wstring> cursor(std::move(source), SmallPages());
+            cursor.ReadFirstPage();
+
+            for (size_t first = 0; first < 300; first += 10)
+            {
+                ScrollTo(cursor, first, 10);
+            }
+            size_t readsBeforeReturn = fake->GetReads();
+
+            ScrollTo(cursor, 0, 10);
+            Assert::IsTrue(fake->GetReads() > readsBeforeReturn);
+            Assert::IsFalse(fake->ReadOutOfOrder());
+        }
+
+        TEST_METHOD(TestShortAndEmptyResults)
+        {
+            Logger::WriteMessage(L"Testing result sets smaller than a page...\n");
+
+            ResultCursor<std::wstring> empty(std::make_unique<FakePageSource>(0), SmallPages());
+            Assert::AreEqual(static_cast<size_t>(0), empty.ReadFirstPage());
+            Assert::IsTrue(empty.IsComplete());
+            Assert::IsFalse(empty.VisitRow(0, [](const std::wstring&) {}));
+
+            ResultCursor<std::wstring> shortSet(std::make_unique<FakePageSource>(7), SmallPages());
+            Assert::AreEqual(static_cast<size_t>(7), shortSet.ReadFirstPage());
+            Assert::IsTrue(shortSet.IsComplete());
+            Assert::AreEqual(static_cast<size_t>(7), shortSet.GetKnownRowCount());
+            Assert::IsFalse(shortSet.VisitRow(7, [](const std::wstring&) {}));
+            shortSet.WaitForIdle();
+            Assert::AreEqual(static_cast<size_t>(1), shortSet.GetStatistics().pageReads);
+        }
+    };
+}
@@ -0,0 +1,135 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#include "pch.h"
+#include <windows.h>
+
+#include <SearchResultOrdering.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace wsearch;
+
+namespace SearchResultOrderingTests
+{
+    struct Item
+    {
+        int32_t rank;
+        uint32_t launches;
+        uint64_t accessed;
+        uint64_t gathered;
+    };
+
+    void AddItems(SearchValuePage& page, const std::vector<Item>& items)
+    {
+        for (const auto& item : items)
+        {
+            SearchValue* values = page.AddRow();
+            values[0] = SearchValue::FromInt32(item.rank);
+            values[1] = SearchValue::FromInt32(static_cast<int32_t>(item.launches));
+            values[2] = item.accessed ? SearchValue::FromFileTime(item.accessed) : SearchValue();
+            values[3] = SearchValue::FromFileTime(item.gathered);
+        }
+    }
+
+    std::vector<PropertyId> OrderColumns()
+    {
+        return { propid::SearchRank, propid::DocumentLineCount, propid::DateAccessed, propid::SearchGatherTime };
+    }
+
+    TEST_CLASS(SearchResultOrderingTests)
+    {
+    public:
+        TEST_METHOD(TestMatchesFullSort)
+        {
+            Logger::WriteMessage(L"Testing partial ordering against a full four-key sort...\n");
+
+            std::mt19937 random(5);
+            for (int iteration = 0; iteration < 200; ++iteration)
+            {
+                std::vector<Item> items(random() % 300);
+                for (auto& item : items)
+                {
+                    // Few distinct values so every tie-break gets exercised
+                    item = { static_cast<int32_t>(random() % 4) * 100, static_cast<uint32_t>(random() % 3), (random() % 3) * 1000ull, (random() % 3) * 10ull };
+                }
+
+                SearchValuePage page(OrderColumns());
+                AddItems(page, items);
+
+                std::vector<uint32_t> expected(items.size());
+                for (uint32_t i = 0; i < expected.size(); ++i)
+                {
+                    expected[i] = i;
+                }
+                std::stable_sort(expected.begin(), expected.end(), [&](uint32_t a, uint32_t b) {
+                    const Item& x = items[a];
+                    const Item& y = items[b];
+                    if (x.rank != y.rank) return x.rank > y.rank;
+                    if (x.launches != y.launches) return x.launches > y.launches;
+                    if (x.accessed != y.accessed) return x.accessed > y.accessed;
+                    return x.gathered > y.gathered;
+                });
+
+                size_t count = random() % 60;
+                auto keys = BuildResultOrderKeys(page);
+                auto ordered = OrderTopResults(keys, count, 0);
+                expected.resize((std::min)(count, items.size()));
+                Assert::IsTrue(expected == ordered.rows);
+                Assert::IsTrue(ordered.exact);
+            }
+        }
+
+        TEST_METHOD(TestExactnessAtTheCut)
+        {
+            Logger::WriteMessage(L"Testing whether a rank tie at the cut is detected...\n");
+
+            // Fetched with TOP 4, by rank: the best two have ranks above the last fetched rank
+            SearchValuePage page(OrderColumns());
+            AddItems(page, { { 990, 0, 0, 1 }, { 950, 3, 0, 1 }, { 900, 1, 0, 1 }, { 900, 0, 0, 1 } });
+
+            auto keys = BuildResultOrderKeys(page);
+            auto topTwo = OrderTopResults(keys, 2, 4);
+            Assert::IsTrue(topTwo.exact);
+            Assert::AreEqual(static_cast<uint32_t>(0), topTwo.rows[0]);
+
+            // The third row ties with the last fetched rank; an unfetched 900 could beat it
+            keys = BuildResultOrderKeys(page);
+            Assert::IsFalse(OrderTopResults(keys, 3, 4).exact);
+
+            // Fewer rows than the TOP means everything matching was fetched
+            keys = BuildResultOrderKeys(page);
+            Assert::IsTrue(OrderTopResults(keys, 3, 5).exact);
+
+            keys.clear();
+            Assert::AreEqual(static_cast<size_t>(0), OrderTopResults(keys, 3, 4).rows.size());
+        }
+
+        TEST_METHOD(TestFrecency)
+        {
+            Logger::WriteMessage(L"Testing frecency tie-breaks...\n");
+
+            constexpr uint64_t day = 864000000000ull;
+            constexpr uint64_t now = 133000000000000000ull;
+            SearchValuePage page(OrderColumns());
+            AddItems(page, {
+                { 500, 10, now - 120 * day, 1 }, // many launches, months ago
+                { 500, 2, now - 1 * day, 1 },    // a few launches, yesterday
+                { 500, 0, 0, 1 },                // never opened
+                { 600, 0, 0, 1 },                // better rank always wins
+            });
+
+            ResultOrderOptions options;
+            options.useFrecency = true;
+            options.nowTicks = now;
+            auto keys = BuildResultOrderKeys(page, options);
+            auto ordered = OrderTopResults(keys, 4, 0);
+            Assert::IsTrue(std::vector<uint32_t>{ 3, 1, 0, 2 } == ordered.rows);
+
+            // By raw launch count the old favourite wins
+            keys = BuildResultOrderKeys(page);
+            ordered = OrderTopResults(keys, 4, 0);
+            Assert::IsTrue(std::vector<uint32_t>{ 3, 0, 1, 2 } == ordered.rows);
+        }
+    };
+}
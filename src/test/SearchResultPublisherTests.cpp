@@ -0,0 +1,176 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#include "pch.h"
+#include <windows.h>
+
+#include <SearchResultPublisher.h>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace wsearch;
+
+namespace SearchResultPublisherTests
+{
+    using Snapshot = ResultSnapshot<size_t>;
+
+    TEST_CLASS(SearchResultPublisherTests)
+    {
+    public:
+        TEST_METHOD(TestPublish)
+        {
+            Logger::WriteMessage(L"Testing generations, refresh and stale results...\n");
+
+            ResultPublisher<size_t> results;
+            std::shared_ptr<const Snapshot> shown;
+            Assert::AreEqual(static_cast<uint64_t>(0), results.GetGeneration());
+            Assert::IsTrue(results.Refresh(shown));
+            Assert::AreEqual(static_cast<uint64_t>(0), shown->generation);
+            Assert::IsFalse(results.Refresh(shown));
+
+            auto published = results.Publish({ 1, L"rep", 120 });
+            Assert::AreEqual(static_cast<uint64_t>(1), published->generation);
+            Assert::AreEqual(static_cast<uint64_t>(1), results.GetGeneration());
+            Assert::IsTrue(results.Refresh(shown));
+            Assert::IsTrue(shown == published);
+            Assert::IsTrue(shown->searchText == L"rep");
+
+            // Snapshots already handed out do not change
+            results.Publish({ 3, L"report", 40 });
+            Assert::AreEqual(static_cast<size_t>(120), shown->result);
+
+            // Results for an older request are dropped; the same request may be published again
+            Assert::IsNull(results.Publish({ 2, L"repo", 60 }).get());
+            Assert::AreEqual(static_cast<uint64_t>(2), results.GetGeneration());
+            Snapshot failed(3, L"report");
+            failed.failed = true;
+            failed.error = SearchError{ -1, L"ICommand::Execute" };
+            results.Publish(failed);
+            Assert::IsTrue(results.GetSnapshot()->failed);
+            Assert::AreEqual(static_cast<uint64_t>(3), results.GetSnapshot()->generation);
+        }
+
+        TEST_METHOD(TestSubscriptions)
+        {
+            Logger::WriteMessage(L"Testing subscriptions...\n");
+
+            ResultPublisher<size_t> results;
+            std::vector<uint64_t> first;
+            std::vector<uint64_t> second;
+            auto subscription = results.Subscribe([&](const std::shared_ptr<const Snapshot>& snapshot) { first.push_back(snapshot->generation); });
+            ResultSubscription selfCancelling;
+            selfCancelling = results.Subscribe([&](const std::shared_ptr<const Snapshot>& snapshot) {
+                second.push_back(snapshot->generation);
+                selfCancelling.Reset();
+            });
+            auto throwing = results.Subscribe([](const std::shared_ptr<const Snapshot>&) { throw std::runtime_error("subscriber failed"); });
+
+            results.Publish({ 1, L"" });
+            results.Publish({ 2, L"" });
+            Assert::IsTrue(std::vector<uint64_t>{ 1, 2 } == first);
+            Assert::IsTrue(std::vector<uint64_t>{ 1 } == second);
+            Assert::IsFalse(static_cast<bool>(selfCancelling));
+
+            // Stale results reach nobody, and reset subscriptions nothing more
+            results.Publish({ 1, L"" });
+            subscription.Reset();
+            results.Publish({ 3, L"" });
+            Assert::IsTrue(std::vector<uint64_t>{ 1, 2 } == first);
+
+            // A subscription may outlive its publisher
+            ResultSubscription outliving;
+            {
+                ResultPublisher<size_t> shortLived;
+                outliving = shortLived.Subscribe([](const std::shared_ptr<const Snapshot>&) {});
+            }
+            outliving.Reset();
+        }
+
+        TEST_METHOD(TestWaitForRequest)
+        {
+            Logger::WriteMessage(L"Testing waits for pending results...\n");
+
+            ResultPublisher<size_t> results;
+            Assert::AreEqual(static_cast<uint64_t>(0), results.WaitForRequest(0)->generation);
+
+            std::thread publisher([&] {
+                for (uint64_t request = 1; request <= 5; ++request)
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                    results.Publish({ request, L"", request * 10 });
+                }
+            });
+            auto snapshot = results.WaitForRequest(3);
+            Assert::IsTrue(snapshot->request >= 3);
+            Assert::AreEqual(static_cast<size_t>(50), results.WaitForRequest(5)->result);
+            publisher.join();
+        }
+
+        TEST_METHOD(TestConcurrentReaders)
+        {
+            Logger::WriteMessage(L"Testing readers and subscribers against concurrent publishers...\n");
+
+            ResultPublisher<size_t> results;
+            constexpr uint64_t c_publications = 20000;
+            std::atomic<bool> done{ false };
+            std::atomic<bool> inOrder{ true };
+            uint64_t lastDelivered = 0;
+            size_t deliveries = 0;
+            auto subscription = results.Subscribe([&](const std::shared_ptr<const Snapshot>& snapshot) {
+                // Deliveries are serialized per subscriber, so no lock is needed here
+                inOrder = inOrder && snapshot->generation > lastDelivered && snapshot->result == snapshot->request;
+                lastDelivered = snapshot->generation;
+                ++deliveries;
+            });
+
+            std::vector<std::thread> readers;
+            for (int i = 0; i < 3; ++i)
+            {
+                readers.emplace_back([&] {
+                    std::shared_ptr<const Snapshot> shown;
+                    uint64_t previous = 0;
+                    while (!done)
+                    {
+                        if (results.Refresh(shown))
+                        {
+                            inOrder = inOrder && shown->generation >= previous && shown->result == shown->request;
+                            previous = shown->generation;
+                        }
+                    }
+                });
+            }
+
+            // Two publishers, as with the debounce thread and ExecuteQueryNow
+            std::atomic<uint64_t> nextRequest{ 1 };
+            std::vector<std::thread> publishers;
+            for (int i = 0; i < 2; ++i)
+            {
+                publishers.emplace_back([&] {
+                    for (uint64_t request = nextRequest++; request <= c_publications; request = nextRequest++)
+                    {
+                        results.Publish({ request, L"", request });
+                    }
+                });
+            }
+            for (auto& thread : publishers)
+            {
+                thread.join();
+            }
+            done = true;
+            for (auto& thread : readers)
+            {
+                thread.join();
+            }
+
+            Assert::IsTrue(inOrder.load());
+            auto last = results.GetSnapshot();
+            Assert::AreEqual(static_cast<size_t>(c_publications), last->result);
+            Assert::AreEqual(last->generation, results.GetGeneration());
+            Assert::AreEqual(last->generation, lastDelivered);
+            Assert::IsTrue(deliveries <= last->generation && last->generation <= c_publications);
+        }
+    };
+}
@@ -0,0 +1,193 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#include "pch.h"
+#include <windows.h>
+#include <SearchSessionRecorder.h>
+#include <filesystem>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace wsearch;
+
+namespace SearchSessionRecorderTests
+{
+    // Minimal stand-in for SearchAsYouTypeSession that counts what the replayer sends it
+    struct FakeTypingSession
+    {
+        std::wstring text;
+        size_t queries = 0;
+        size_t clicks = 0;
+
+        void AppendCharacters(std::wstring_view characters) { text += characters; }
+        void SetSearchText(std::wstring_view searchText) { text = searchText; }
+        void Clear() { text.clear(); }
+        void ExecuteQueryNow() { ++queries; }
+        void GetCachedResults() { ++queries; }
+        void TrackResultClick(const std::wstring&) { ++clicks; }
+        size_t GetExecutedQueryCount() const { return queries; }
+    };
+
+    TEST_CLASS(SearchSessionRecorderTests)
+    {
+    public:
+        TEST_METHOD(TestRecordAndRoundTrip)
+        {
+            Logger::WriteMessage(L"Testing trace serialization round trip...\n");
+
+            SearchSessionRecorder recorder;
+            recorder.Record(SessionOperation::SetSearchText, L"ann");
+            recorder.Record(SessionOperation::AppendCharacters, L"ual report");
+            recorder.Record(SessionOperation::GetCachedResults);
+            recorder.Record(SessionOperation::TrackResultClick, L"C:\\Users\\Documents\\annual.docx");
+            recorder.Record(SessionOperation::Clear);
+
+            auto bytes = recorder.Serialize();
+            auto events = SearchSessionRecorder::Deserialize(bytes);
+            auto original = recorder.GetEvents();
+
+            Assert::AreEqual(original.size(), events.size());
+            for (size_t i = 0; i < events.size(); ++i)
+            {
+                Assert::IsTrue(original[i].operation == events[i].operation);
+                Assert::AreEqual(original[i].text, events[i].text);
+                Assert::IsTrue(original[i].timestamp == events[i].timestamp);
+            }
+
+            // ASCII text costs one byte per character
+            Assert::IsTrue(bytes.size() < 80);
+        }
+
+        TEST_METHOD(TestFileRoundTrip)
+        {
+            Logger::WriteMessage(L"Testing trace save and load...\n");
+
+            wchar_t tempPath[MAX_PATH];
+            GetTempPathW(MAX_PATH, tempPath);
+            std::wstring tracePath = std::wstring(tempPath) + L"SearchSessionRecorderTests_" +
+                                     std::to_wstring(GetTickCount64()) + L".wstrace";
+
+            SearchSessionRecorder recorder;
+            recorder.Record(SessionOperation::SetSearchText, L"r\u00e9sum\u00e9");
+            recorder.Record(SessionOperation::ExecuteQueryNow);
+            recorder.SaveToFile(tracePath);
+
+            auto events = SearchSessionRecorder::LoadFromFile(tracePath);
+            std::filesystem::remove(tracePath);
+
+            Assert::AreEqual(static_cast<size_t>(2), events.size());
+            Assert::AreEqual(std::wstring(L"r\u00e9sum\u00e9"), events[0].text);
+        }
+
+        TEST_METHOD(TestCorruptTraceRejected)
+        {
+            Logger::WriteMessage(L"Testing corrupt trace detection...\n");
+
+            SearchSessionRecorder recorder;
+            recorder.Record(SessionOperation::SetSearchText, L"budget");
+            auto bytes = recorder.Serialize();
+            bytes.resize(bytes.size() - 3);
+
+            Assert::ExpectException<std::invalid_argument>([&]() { SearchSessionRecorder::Deserialize(bytes); });
+            Assert::ExpectException<std::invalid_argument>([]() { SearchSessionRecorder::Deserialize({ 'N', 'O', 'P', 'E', 1, 0 }); });
+        }
+
+        TEST_METHOD(TestHashedTextPreservesLengthAndPrefixes)
+        {
+            Logger::WriteMessage(L"Testing privacy hashing structure...\n");
+
+            SessionRecorderOptions options;
+            options.hashText = true;
+            SearchSessionRecorder recorder(options);
+
+            recorder.Record(SessionOperation::SetSearchText, L"rep");
+            recorder.Record(SessionOperation::AppendCharacters, L"ort 2024");
+            recorder.Record(SessionOperation::SetSearchText, L"report 2024");
+            recorder.Record(SessionOperation::SetSearchText, L"rex");
+            recorder.Record(SessionOperation::SetSearchText, L"\"rex");
+
+            auto events = recorder.GetEvents();
+            std::wstring typed = events[0].text + events[1].text;
+            const auto& retyped = events[2].text;
+
+            // Never stores the plain text
+            Assert::AreNotEqual(std::wstring(L"rep"), events[0].text);
+            Assert::AreEqual(static_cast<size_t>(3), events[0].text.size());
+
+            // Append after Set hashes the same as setting the whole string
+            Assert::AreEqual(retyped, typed);
+
+            // Whitespace and digits keep their class, punctuation passes through
+            Assert::AreEqual(L' ', retyped[6]);
+            Assert::IsTrue(iswdigit(retyped[7]) != 0);
+            Assert::AreEqual(L'"', events[4].text[0]);
+
+            // "rex" shares its first two hashed characters with "report" and diverges after
+            Assert::AreEqual(retyped.substr(0, 2), events[3].text.substr(0, 2));
+            Assert::AreNotEqual(retyped.substr(0, 3), events[3].text);
+        }
+
+        TEST_METHOD(TestHashKeys)
+        {
+            Logger::WriteMessage(L"Testing privacy hash keys...\n");
+
+            const std::wstring text = L"quarterly report draft";
+            auto hash = [&](SessionRecorderOptions options) {
+                options.hashText = true;
+                SearchSessionRecorder recorder(options);
+                recorder.Record(SessionOperation::SetSearchText, text);
+                return std::make_pair(recorder.GetEvents()[0].text, recorder.Serialize());
+            };
+
+            // Each recorder draws its own key, so the same text hashes differently
+            auto first = hash({});
+            auto second = hash({});
+            Assert::AreNotEqual(first.first, second.first);
+
+            // A shared key lines traces up; it is not written to them
+            SessionRecorderOptions keyed;
+            keyed.hashKey = 0x0123456789ABCDEFull;
+            auto third = hash(keyed);
+            auto fourth = hash(keyed);
+            Assert::AreEqual(third.first, fourth.first);
+            Assert::AreEqual(first.second.size(), third.second.size());
+        }
+
+        TEST_METHOD(TestReplayDrivesSession)
+        {
+            Logger::WriteMessage(L"Testing replay against a fake session...\n");
+
+            std::vector<SessionTraceEvent> events = {
+                { std::chrono::microseconds(0), SessionOperation::SetSearchText, L"b" },
+                { std::chrono::microseconds(1000), SessionOperation::AppendCharacters, L"ud" },
+                { std::chrono::microseconds(2000), SessionOperation::GetCachedResults, L"" },
+                { std::chrono::microseconds(3000), SessionOperation::AppendCharacters, L"get" },
+                { std::chrono::microseconds(4000), SessionOperation::ExecuteQueryNow, L"" },
+                { std::chrono::microseconds(5000), SessionOperation::TrackResultClick, L"C:\\budget.xlsx" },
+            };
+
+            FakeTypingSession session;
+            auto stats = SearchSessionReplayer::Replay(session, events, { 0.0 });
+
+            Assert::AreEqual(std::wstring(L"budget"), session.text);
+            Assert::AreEqual(static_cast<size_t>(6), stats.eventsReplayed);
+            Assert::AreEqual(static_cast<size_t>(2), stats.queriesExecuted);
+            Assert::AreEqual(static_cast<size_t>(1), session.clicks);
+            Assert::AreEqual(static_cast<size_t>(2), stats.For(SessionOperation::AppendCharacters).count);
+        }
+
+        TEST_METHOD(TestAcceleratedReplayHonorsTiming)
+        {
+            Logger::WriteMessage(L"Testing accelerated replay timing...\n");
+
+            std::vector<SessionTraceEvent> events = {
+                { std::chrono::microseconds(0), SessionOperation::SetSearchText, L"a" },
+                { std::chrono::microseconds(400000), SessionOperation::AppendCharacters, L"b" },
+            };
+
+            FakeTypingSession session;
+            auto stats = SearchSessionReplayer::Replay(session, events, { 4.0 });
+
+            // 400ms recorded at 4x should take ~100ms
+            Assert::IsTrue(stats.wallClockMs >= 90.0);
+            Assert::IsTrue(stats.wallClockMs < 400.0);
+        }
+    };
+}
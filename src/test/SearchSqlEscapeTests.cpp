@@ -0,0 +1,170 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#include "pch.h"
+#include <windows.h>
+
+#include <SearchSqlText.h>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace wsearch;
+
+namespace SearchSqlEscapeTests
+{
+    // Character-by-character escaping the SIMD scan has to agree with
+    std::wstring ReferenceEscape(const std::wstring& text, bool doubleQuotes)
+    {
+        std::wstring escaped;
+        for (wchar_t ch : text)
+        {
+            if (static_cast<unsigned>(ch) < 0x20 || ch == 0x7F)
+            {
+                escaped += L' ';
+            }
+            else if (ch == L'\'' || (doubleQuotes && ch == L'"'))
+            {
+                escaped += ch;
+                escaped += ch;
+            }
+            else
+            {
+                escaped += ch;
+            }
+        }
+        return escaped;
+    }
+
+    template <typename Function>
+    bool Throws(Function&& function)
+    {
+        try
+        {
+            function();
+        }
+        catch (const std::invalid_argument&)
+        {
+            return true;
+        }
+        return false;
+    }
+
+    TEST_CLASS(SearchSqlEscapeTests)
+    {
+    public:
+        TEST_METHOD(TestEscapingMatchesReference)
+        {
+            Logger::WriteMessage(L"Testing escaping at every position against a reference...\n");
+
+            // Besides the special characters, ones that only share their low byte with one
+            const wchar_t specials[] = { L'\'', L'"', L'\t', L'\x01', L'\x7F', L'\x1F', L'\x20', L'\x80', L'\xFF1F', L'\xE020',
+                L'\x0127', L'\x0122', L'\x017F', L'\x0100' };
+            for (size_t length = 0; length < 140; ++length)
+            {
+                for (size_t position = 0; position <= length; ++position)
+                {
+                    for (wchar_t special : specials)
+                    {
+                        std::wstring text(length, L'a');
+                        text.insert(position, 1, special);
+
+                        std::wstring literal;
+                        details::AppendEscapedSqlText(literal, text);
+                        Assert::AreEqual(ReferenceEscape(text, false), literal);
+
+                        std::wstring phrase;
+                        details::AppendEscapedContainsText(phrase, text);
+                        Assert::AreEqual(ReferenceEscape(text, true), phrase);
+                    }
+                }
+            }
+
+            std::mt19937 random(7);
+            const wchar_t alphabet[] = L"ab '\"\x01\x7F\xE9";
+            for (int iteration = 0; iteration < 2000; ++iteration)
+            {
+                std::wstring text;
+                size_t length = random() % 100;
+                for (size_t i = 0; i < length; ++i)
+                {
+                    text += alphabet[random() % (sizeof(alphabet) / sizeof(alphabet[0]) - 1)];
+                }
+                std::wstring phrase;
+                details::AppendEscapedContainsText(phrase, text);
+                Assert::AreEqual(ReferenceEscape(text, true), phrase);
+            }
+        }
+
+        TEST_METHOD(TestPrimingEscapesScopes)
+        {
+            Logger::WriteMessage(L"Testing priming SQL with quotes in scopes...\n");
+
+            std::vector<std::wstring> included = { L"C:\\Users\\O'Brien\\Documents", L"D:\\Shared" };
+            std::vector<std::wstring> excluded = { L"C:\\Users\\O'Brien\\Documents\\Archive" };
+            std::vector<std::wstring> properties = { L"System.Size" };
+
+            std::wstring sql;
+            details::AppendPrimingSql(sql, included, excluded, properties);
+            Assert::AreEqual(
+                std::wstring(L"SELECT System.ItemUrl, System.Size FROM SystemIndex WHERE ( SCOPE='file:C:/Users/O''Brien/Documents' OR SCOPE='file:D:/Shared')"
+                    L" AND SCOPE <> 'file:C:/Users/O''Brien/Documents/Archive'"),
+                sql);
+
+            std::wstring excludedOnly;
+            details::AppendPrimingSql(excludedOnly, std::vector<std::wstring>(), excluded, std::vector<std::wstring>());
+            Assert::AreEqual(std::wstring(L"SELECT System.ItemUrl FROM SystemIndex WHERE SCOPE <> 'file:C:/Users/O''Brien/Documents/Archive'"), excludedOnly);
+        }
+
+        TEST_METHOD(TestSearchTextIsSanitized)
+        {
+            Logger::WriteMessage(L"Testing search text limits...\n");
+
+            std::wstring where;
+            details::AppendSearchWhereClause(where, L"O'Brien\x01notes");
+            Assert::IsTrue(where.find(L"O''Brien notes") != std::wstring::npos);
+            Assert::IsTrue(where.find(L'\x01') == std::wstring::npos);
+
+            std::wstring longText(details::c_maxSearchTextLength + 100, L'x');
+            Assert::AreEqual(details::c_maxSearchTextLength, details::LimitSearchText(longText).size());
+            std::wstring longWhere;
+            details::AppendSearchWhereClause(longWhere, longText);
+            Assert::IsTrue(longWhere.find(std::wstring(details::c_maxSearchTextLength + 1, L'x')) == std::wstring::npos);
+
+            if (sizeof(wchar_t) == 2)
+            {
+                // A surrogate pair straddling the limit is dropped whole
+                std::wstring pair(details::c_maxSearchTextLength - 1, L'x');
+                pair += static_cast<wchar_t>(0xD83D);
+                pair += static_cast<wchar_t>(0xDE00);
+                Assert::AreEqual(details::c_maxSearchTextLength - 1, details::LimitSearchText(pair).size());
+            }
+        }
+
+        TEST_METHOD(TestScopeAndPropertyNameChecks)
+        {
+            Logger::WriteMessage(L"Testing scope and property name checks...\n");
+
+            std::wstring sql;
+            Assert::IsFalse(Throws([&] { details::AppendScopeUrl(sql, L"C:\\Users\\O'Brien", true); }));
+            Assert::IsTrue(Throws([&] { details::AppendScopeUrl(sql, L"C:\\Users\\\x01", true); }));
+            Assert::IsTrue(Throws([&] { details::CheckScope(std::wstring(details::c_maxScopeLength + 1, L'a')); }));
+
+            // Lookup keys are not SQL and are not checked
+            std::wstring key;
+            details::AppendScopeUrl(key, L"C:\\a'b");
+            Assert::AreEqual(std::wstring(L"file:C:/a'b"), key);
+
+            Assert::IsFalse(Throws([] { details::CheckPropertyName(L"System.Search.Rank"); }));
+            Assert::IsFalse(Throws([] { details::CheckPropertyName(L"System.Music.Artist_2"); }));
+            Assert::IsTrue(Throws([] { details::CheckPropertyName(L""); }));
+            Assert::IsTrue(Throws([] { details::CheckPropertyName(L"System.Size FROM x;--"); }));
+            Assert::IsTrue(Throws([] { details::CheckPropertyName(L"System.Title'"); }));
+            Assert::IsTrue(Throws([] { details::CheckPropertyName(std::wstring(details::c_maxPropertyNameLength + 1, L'a')); }));
+            Assert::IsTrue(Throws([] {
+                std::wstring out;
+                details::AppendPrimingSql(out, std::vector<std::wstring>{ L"C:\\" }, std::vector<std::wstring>(), std::vector<std::wstring>{ L"System.Size, System.Title" });
+            }));
+        }
+    };
+}
@@ -0,0 +1,148 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#include "pch.h"
+#include <windows.h>
+
+#include <SearchTermStatistics.h>
+#include <cmath>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace wsearch;
+
+namespace SearchTermStatisticsTests
+{
+    // Wednesday 2024-03-13 15:00 UTC
+    constexpr uint64_t c_now = 133548660000000000ull;
+    constexpr uint64_t c_hour = 36000000000ull;
+
+    TEST_CLASS(SearchTermStatisticsTests)
+    {
+    public:
+        TEST_METHOD(TestEstimates)
+        {
+            Logger::WriteMessage(L"Testing term and prefix-length estimates...\n");
+
+            SearchTermStatistics statistics;
+            std::vector<std::wstring> users = { L"file:C:/Users/", L"file:D:/Work" };
+            Assert::IsFalse(statistics.Estimate(L"report", users, c_now).IsKnown());
+
+            statistics.Record(L"Annual  Report", users, 10, std::chrono::milliseconds(20), c_now);
+            statistics.Record(L"annual report", users, 1000, std::chrono::milliseconds(40), c_now);
+
+            // Case, spacing and scope order and spelling do not matter
+            auto estimate = statistics.Estimate(L"ANNUAL report", { L"file:d:\\work\\", L"file:C:/Users" }, c_now);
+            Assert::IsTrue(estimate.source == TermStatisticsSource::Term);
+            Assert::AreEqual(2.0, estimate.observations, 1e-6);
+            Assert::AreEqual(std::sqrt(11.0 * 1001.0) - 1.0, estimate.resultCount, 0.01);
+            Assert::AreEqual(30.0, estimate.latencyMs, 1e-3);
+
+            // New text falls back to texts whose last word has the same length
+            estimate = statistics.Estimate(L"budget 2024 totals", users, c_now);
+            Assert::IsTrue(estimate.source == TermStatisticsSource::PrefixLength);
+            Assert::AreEqual(2.0, estimate.observations, 1e-6);
+            Assert::IsFalse(statistics.Estimate(L"bud", users, c_now).IsKnown());
+
+            // Other scopes and phrases are other keys
+            Assert::IsFalse(statistics.Estimate(L"annual report", { L"file:C:/Users" }, c_now).IsKnown());
+            statistics.Record(L"\"annual report\"", users, 3, std::chrono::milliseconds(5), c_now);
+            Assert::AreEqual(3.0, statistics.Estimate(L"\"Annual Report\"", users, c_now).resultCount, 1e-3);
+            Assert::AreEqual(2.0, statistics.Estimate(L"annual report", users, c_now).observations, 1e-6);
+            Assert::AreEqual(static_cast<uint64_t>(3), statistics.GetRecordCount());
+        }
+
+        TEST_METHOD(TestDecay)
+        {
+            Logger::WriteMessage(L"Testing decay of old observations...\n");
+
+            TermStatisticsOptions options;
+            options.halfLife = std::chrono::hours(1);
+            SearchTermStatistics statistics(options);
+            std::vector<std::wstring> scopes = { L"file:" };
+
+            statistics.Record(L"photos", scopes, 100, std::chrono::milliseconds(10), c_now);
+            statistics.Record(L"photos", scopes, 10000, std::chrono::milliseconds(40), c_now + c_hour);
+
+            // One hour later the first observation weighs half as much as the second
+            auto estimate = statistics.Estimate(L"photos", scopes, c_now + c_hour);
+            Assert::AreEqual(1.5, estimate.observations, 1e-4);
+            Assert::AreEqual(30.0, estimate.latencyMs, 1e-3);
+            Assert::AreEqual(std::exp((std::log(101.0) + 2.0 * std::log(10001.0)) / 3.0) - 1.0, estimate.resultCount, 1.0);
+            Assert::AreEqual(0.75, statistics.Estimate(L"photos", scopes, c_now + 2 * c_hour).observations, 1e-4);
+
+            // Forgotten after enough half-lives; recording again past the rescale point still works
+            Assert::IsFalse(statistics.Estimate(L"photos", scopes, c_now + 4 * c_hour).IsKnown());
+            statistics.Record(L"photos", scopes, 7, std::chrono::milliseconds(2), c_now + 40 * c_hour);
+            estimate = statistics.Estimate(L"photos", scopes, c_now + 40 * c_hour);
+            Assert::AreEqual(1.0, estimate.observations, 1e-4);
+            Assert::AreEqual(7.0, estimate.resultCount, 1e-3);
+
+            // A clock set back does not break anything
+            statistics.Record(L"photos", scopes, 7, std::chrono::milliseconds(2), c_now);
+            Assert::IsTrue(statistics.Estimate(L"photos", scopes, c_now + 40 * c_hour).observations < 1.01);
+
+            options.width = 1000;
+            Assert::ExpectException<std::invalid_argument>([&] { SearchTermStatistics invalid(options); });
+        }
+
+        TEST_METHOD(TestManyDistinctQueries)
+        {
+            Logger::WriteMessage(L"Testing bounded memory with many distinct queries...\n");
+
+            SearchTermStatistics statistics;
+            size_t memory = statistics.GetMemoryBytes();
+            std::vector<std::wstring> scopes = { L"file:C:/Users" };
+            for (uint32_t i = 0; i < 20000; ++i)
+            {
+                std::wstring text = L"query" + std::to_wstring(i * 2654435761u);
+                statistics.Record(text, scopes, i % 5000, std::chrono::microseconds(i % 700), c_now);
+                if (i % 10 == 0)
+                {
+                    statistics.Record(L"frequent", scopes, 42, std::chrono::milliseconds(3), c_now);
+                }
+            }
+            Assert::AreEqual(memory, statistics.GetMemoryBytes());
+
+            // Collisions only ever add weight; a frequent key dominates its least-collided counter
+            auto estimate = statistics.Estimate(L"frequent", scopes, c_now);
+            Assert::IsTrue(estimate.observations >= 2000.0);
+            Assert::AreEqual(42.0, estimate.resultCount, 4.2);
+            Assert::AreEqual(3.0, estimate.latencyMs, 0.3);
+        }
+
+        TEST_METHOD(TestSerialize)
+        {
+            Logger::WriteMessage(L"Testing the statistics file...\n");
+
+            SearchTermStatistics statistics;
+            std::vector<std::wstring> scopes = { L"file:C:/Users" };
+            statistics.Record(L"budget", scopes, 120, std::chrono::milliseconds(8), c_now);
+            statistics.Record(L"bu", scopes, 90000, std::chrono::milliseconds(300), c_now + c_hour);
+
+            // Only non-zero counters are written: 2 records x 2 keys x 4 rows, at most 15 bytes each
+            auto bytes = statistics.Serialize();
+            Assert::IsTrue(bytes.size() <= 16 * 15 + 32);
+
+            auto loaded = SearchTermStatistics::Deserialize(bytes);
+            Assert::AreEqual(static_cast<uint64_t>(2), loaded->GetRecordCount());
+            for (const wchar_t* text : { L"budget", L"bu", L"ab", L"unknown" })
+            {
+                auto expected = statistics.Estimate(text, scopes, c_now + 3 * c_hour);
+                auto actual = loaded->Estimate(text, scopes, c_now + 3 * c_hour);
+                Assert::IsTrue(expected.source == actual.source);
+                Assert::AreEqual(expected.observations, actual.observations, 1e-9);
+                Assert::AreEqual(expected.resultCount, actual.resultCount, 1e-9);
+            }
+
+            auto truncated = bytes;
+            truncated.pop_back();
+            Assert::ExpectException<std::invalid_argument>([&] { SearchTermStatistics::Deserialize(truncated); });
+            auto badMagic = bytes;
+            badMagic[0] = 'X';
+            Assert::ExpectException<std::invalid_argument>([&] { SearchTermStatistics::Deserialize(badMagic); });
+            auto overrun = bytes;
+            overrun.insert(overrun.end(), { 0xFF, 0xFF, 0x7F });
+            Assert::ExpectException<std::invalid_argument>([&] { SearchTermStatistics::Deserialize(overrun); });
+        }
+    };
+}
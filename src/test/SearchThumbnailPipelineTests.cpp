@@ -0,0 +1,292 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#include "pch.h"
+#include <windows.h>
+
+#include <SearchThumbnailPipeline.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace wsearch;
+
+namespace SearchThumbnailPipelineTests
+{
+    // Stands in for the Storage thumbnail APIs: the "image" is the key's length, keys ending
+    // in ".bad" and paths under "C:\\locked\\" fail, and Release() must be called before any
+    // load is allowed to finish.
+    class FakeThumbnailLoader : public IThumbnailLoader<size_t>
+    {
+    public:
+        explicit FakeThumbnailLoader(bool startReleased = true)
+            : m_released(startReleased)
+        {
+        }
+
+        std::optional<size_t> Load(const ThumbnailRequest& request) override
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                ++m_loadsPerKey[request.key];
+                size_t running = ++m_running;
+                m_maxRunning = std::max(m_maxRunning, running);
+                m_cv.wait(lock, [this]() { return m_released; });
+                --m_running;
+            }
+
+            if ((request.key.size() >= 4 && request.key.compare(request.key.size() - 4, 4, L".bad") == 0) ||
+                request.path.rfind(L"C:\\locked\\", 0) == 0)
+            {
+                throw std::runtime_error("no thumbnail");
+            }
+            return request.key.size();
+        }
+
+        void Release()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_released = true;
+            }
+            m_cv.notify_all();
+        }
+
+        size_t GetLoadCount(const std::wstring& key)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_loadsPerKey.find(key);
+            return it == m_loadsPerKey.end() ? 0 : it->second;
+        }
+
+        size_t GetMaxRunning()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_maxRunning;
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        bool m_released;
+        std::map<std::wstring, size_t> m_loadsPerKey;
+        size_t m_running = 0;
+        size_t m_maxRunning = 0;
+    };
+
+    TEST_CLASS(SearchThumbnailPipelineTests)
+    {
+    public:
+        TEST_METHOD(TestKeysShareIconsPerExtension)
+        {
+            Logger::WriteMessage(L"Testing thumbnail keys...\n");
+
+            Assert::AreEqual(std::wstring(L".docx"), details::ThumbnailKeyForPath(L"C:\\Users\\Report.DOCX", false));
+            Assert::AreEqual(std::wstring(L".docx"), details::ThumbnailKeyForPath(L"D:\\notes.docx", false));
+            Assert::AreEqual(std::wstring(L"<folder>"), details::ThumbnailKeyForPath(L"C:\\Users", true));
+            Assert::AreEqual(std::wstring(L"."), details::ThumbnailKeyForPath(L"C:\\my.folder\\README", false));
+
+            // Executables and shortcuts carry their own icons
+            Assert::AreEqual(std::wstring(L"c:\\tools\\setup.exe"), details::ThumbnailKeyForPath(L"C:\\Tools\\Setup.exe", false));
+        }
+
+        TEST_METHOD(TestRequestReturnsPlaceholderWithoutBlocking)
+        {
+            Logger::WriteMessage(L"Testing that a cache miss does not wait for the loader...\n");
+
+            auto loader = std::make_shared<FakeThumbnailLoader>(false);
+            ThumbnailPipeline<size_t> pipeline(loader);
+
+            std::atomic<size_t> delivered{ 0 };
+            auto lookup = pipeline.Request(L"C:\\a.docx", false, [&](const std::optional<size_t>& image) {
+                delivered = image.value_or(0);
+            });
+
+            // The loader is still held, so anything other than Pending means we blocked on it
+            Assert::IsTrue(lookup.status == ThumbnailStatus::Pending);
+            Assert::IsFalse(lookup.image.has_value());
+
+            loader->Release();
+            Assert::IsTrue(pipeline.WaitForIdle(std::chrono::seconds(5)));
+            Assert::AreEqual(static_cast<size_t>(5), delivered.load());
+
+            auto cached = pipeline.Request(L"C:\\b.DOCX", false);
+            Assert::IsTrue(cached.status == ThumbnailStatus::Ready);
+            Assert::AreEqual(static_cast<size_t>(5), *cached.image);
+        }
+
+        TEST_METHOD(TestConcurrentMissesShareOneLoad)
+        {
+            Logger::WriteMessage(L"Testing in-flight deduplication...\n");
+
+            auto loader = std::make_shared<FakeThumbnailLoader>(false);
+            ThumbnailPipeline<size_t> pipeline(loader);
+
+            std::atomic<size_t> callbacks{ 0 };
+            std::vector<std::thread> threads;
+            for (int t = 0; t < 4; ++t)
+            {
+                threads.emplace_back([&]() {
+                    for (int i = 0; i < 25; ++i)
+                    {
+                        pipeline.Request(L"C:\\docs\\file" + std::to_wstring(i) + L".pdf", false,
+                            [&](const std::optional<size_t>&) { ++callbacks; });
+                    }
+                });
+            }
+            for (auto& thread : threads)
+            {
+                thread.join();
+            }
+
+            loader->Release();
+            Assert::IsTrue(pipeline.WaitForIdle(std::chrono::seconds(5)));
+
+            Assert::AreEqual(static_cast<size_t>(1), loader->GetLoadCount(L".pdf"));
+            Assert::AreEqual(static_cast<size_t>(100), callbacks.load());
+            Assert::AreEqual(static_cast<uint64_t>(99), pipeline.GetStatistics().coalesced);
+        }
+
+        TEST_METHOD(TestFailuresAreCached)
+        {
+            Logger::WriteMessage(L"Testing negative caching...\n");
+
+            auto loader = std::make_shared<FakeThumbnailLoader>();
+            ThumbnailPipeline<size_t> pipeline(loader);
+
+            bool notifiedEmpty = false;
+            pipeline.Request(L"C:\\x.bad", false, [&](const std::optional<size_t>& image) {
+                notifiedEmpty = !image.has_value();
+            });
+            Assert::IsTrue(pipeline.WaitForIdle(std::chrono::seconds(5)));
+            Assert::IsTrue(notifiedEmpty);
+
+            // Other files of the type are tried until maxLoadAttempts loads have failed
+            for (const wchar_t* path : { L"C:\\y.bad", L"C:\\z.bad" })
+            {
+                Assert::IsTrue(pipeline.Request(path, false).status == ThumbnailStatus::Pending);
+                Assert::IsTrue(pipeline.WaitForIdle(std::chrono::seconds(5)));
+            }
+            for (int i = 0; i < 10; ++i)
+            {
+                Assert::IsTrue(pipeline.Request(L"C:\\w" + std::to_wstring(i) + L".bad", false).status == ThumbnailStatus::Failed);
+            }
+            Assert::AreEqual(static_cast<size_t>(3), loader->GetLoadCount(L".bad"));
+            Assert::AreEqual(static_cast<uint64_t>(10), pipeline.GetStatistics().failureHits);
+
+            pipeline.ClearFailures();
+            Assert::IsTrue(pipeline.Request(L"C:\\y.bad", false).status == ThumbnailStatus::Pending);
+            Assert::IsTrue(pipeline.WaitForIdle(std::chrono::seconds(5)));
+            Assert::AreEqual(static_cast<size_t>(4), loader->GetLoadCount(L".bad"));
+
+            // Failures expire
+            ThumbnailPipelineOptions options;
+            options.failureRetryAfter = std::chrono::milliseconds(0);
+            ThumbnailPipeline<size_t> expiring(loader, options);
+            expiring.Request(L"C:\\x.bad", false);
+            Assert::IsTrue(expiring.WaitForIdle(std::chrono::seconds(5)));
+            Assert::IsTrue(expiring.Request(L"C:\\x.bad", false).status == ThumbnailStatus::Pending);
+            Assert::IsTrue(expiring.WaitForIdle(std::chrono::seconds(5)));
+            Assert::AreEqual(static_cast<size_t>(6), loader->GetLoadCount(L".bad"));
+        }
+
+        TEST_METHOD(TestFailedPathIsRetriedFromAnotherRow)
+        {
+            Logger::WriteMessage(L"Testing that one unreadable file does not blank its extension...\n");
+
+            // Both rows ask while the first load is held; it fails, and the second row's file is tried
+            auto loader = std::make_shared<FakeThumbnailLoader>(false);
+            ThumbnailPipeline<size_t> pipeline(loader);
+
+            std::atomic<size_t> first{ 0 };
+            std::atomic<size_t> second{ 0 };
+            pipeline.Request(L"C:\\locked\\a.docx", false, [&](const std::optional<size_t>& image) { first = image.value_or(0); });
+            pipeline.Request(L"C:\\ok\\b.docx", false, [&](const std::optional<size_t>& image) { second = image.value_or(0); });
+            loader->Release();
+            Assert::IsTrue(pipeline.WaitForIdle(std::chrono::seconds(5)));
+            Assert::AreEqual(static_cast<size_t>(5), first.load());
+            Assert::AreEqual(static_cast<size_t>(5), second.load());
+            Assert::AreEqual(static_cast<size_t>(2), loader->GetLoadCount(L".docx"));
+
+            // Once the failure is cached, a row with another file still loads the key
+            pipeline.Request(L"C:\\locked\\c.pdf", false);
+            Assert::IsTrue(pipeline.WaitForIdle(std::chrono::seconds(5)));
+            Assert::IsTrue(pipeline.Request(L"C:\\locked\\c.pdf", false).status == ThumbnailStatus::Failed);
+
+            std::atomic<size_t> later{ 0 };
+            auto lookup = pipeline.Request(L"C:\\ok\\d.pdf", false, [&](const std::optional<size_t>& image) { later = image.value_or(0); });
+            Assert::IsTrue(lookup.status == ThumbnailStatus::Pending);
+            Assert::IsTrue(pipeline.WaitForIdle(std::chrono::seconds(5)));
+            Assert::AreEqual(static_cast<size_t>(4), later.load());
+            Assert::IsTrue(pipeline.Request(L"C:\\locked\\e.pdf", false).status == ThumbnailStatus::Ready);
+            Assert::AreEqual(static_cast<uint64_t>(2), pipeline.GetStatistics().retries);
+        }
+
+        TEST_METHOD(TestPerFileKeysAreCapped)
+        {
+            Logger::WriteMessage(L"Testing the cache bound...\n");
+
+            auto loader = std::make_shared<FakeThumbnailLoader>();
+            ThumbnailPipelineOptions options;
+            options.maxEntries = 16;
+            ThumbnailPipeline<size_t> pipeline(loader, options);
+
+            for (int i = 0; i < 100; ++i)
+            {
+                pipeline.Request(L"C:\\tools\\tool" + std::to_wstring(i) + L".exe", false);
+                Assert::IsTrue(pipeline.WaitForIdle(std::chrono::seconds(5)));
+                pipeline.Request(L"C:\\a.docx", false); // kept in use, so never the oldest
+            }
+
+            Assert::IsTrue(pipeline.GetEntryCount() <= 16);
+            Assert::IsTrue(pipeline.GetStatistics().evictions > 0);
+            Assert::IsTrue(pipeline.Request(L"C:\\b.docx", false).status == ThumbnailStatus::Ready);
+        }
+
+        TEST_METHOD(TestWorkerPoolIsBounded)
+        {
+            Logger::WriteMessage(L"Testing worker pool bound and batching...\n");
+
+            auto loader = std::make_shared<FakeThumbnailLoader>(false);
+            ThumbnailPipelineOptions options;
+            options.workerCount = 3;
+            options.batchSize = 4;
+            ThumbnailPipeline<size_t> pipeline(loader, options);
+
+            for (int i = 0; i < 40; ++i)
+            {
+                pipeline.Request(L"C:\\file." + std::to_wstring(i), false);
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            Assert::IsTrue(loader->GetMaxRunning() <= 3);
+
+            loader->Release();
+            Assert::IsTrue(pipeline.WaitForIdle(std::chrono::seconds(5)));
+
+            auto stats = pipeline.GetStatistics();
+            Assert::AreEqual(static_cast<uint64_t>(40), stats.loads);
+            Assert::IsTrue(stats.batches >= 10);
+            Assert::IsTrue(stats.batches < 40);
+            Assert::AreEqual(static_cast<size_t>(0), pipeline.GetPendingCount());
+        }
+
+        TEST_METHOD(TestDestructionWithPendingLoads)
+        {
+            Logger::WriteMessage(L"Testing shutdown with queued work...\n");
+
+            auto loader = std::make_shared<FakeThumbnailLoader>(false);
+            {
+                ThumbnailPipeline<size_t> pipeline(loader);
+                for (int i = 0; i < 20; ++i)
+                {
+                    pipeline.Request(L"C:\\file." + std::to_wstring(i), false, [](const std::optional<size_t>&) {});
+                }
+                loader->Release();
+            }
+            // Reaching here without hanging is the test
+        }
+    };
+}
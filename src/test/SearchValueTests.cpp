@@ -0,0 +1,94 @@
+// Copyright (C) Microsoft Corporation. All rights reserved.
+#include "pch.h"
+#include <windows.h>
+
+#include <SearchValue.h>
+#include <string>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace wsearch;
+
+namespace SearchValueTests
+{
+    TEST_CLASS(SearchValueTests)
+    {
+    public:
+        TEST_METHOD(TestTypedAccessors)
+        {
+            Logger::WriteMessage(L"Testing typed accessors...\n");
+
+            Assert::AreEqual(static_cast<size_t>(16), sizeof(SearchValue));
+
+            auto size = SearchValue::FromUInt64(5000000000ull);
+            Assert::IsTrue(size.Type() == SearchValueType::UInt64);
+            Assert::AreEqual(5000000000ull, static_cast<unsigned long long>(size.GetUInt64()));
+            Assert::AreEqual(static_cast<int64_t>(5000000000ll), size.GetInt64());
+            Assert::AreEqual(static_cast<uint32_t>(7), size.GetUInt32(7)); // does not fit
+
+            auto rank = SearchValue::FromInt32(-3);
+            Assert::AreEqual(-3, rank.GetInt32());
+            Assert::AreEqual(static_cast<uint64_t>(9), rank.GetUInt64(9)); // negative
+            Assert::AreEqual(-3.0, rank.GetDouble());
+
+            auto modified = SearchValue::FromFileTime(133000000000000000ull);
+            Assert::IsTrue(modified.GetFileTime().has_value());
+            Assert::AreEqual(133000000000000000ull, static_cast<unsigned long long>(*modified.GetFileTime()));
+            Assert::AreEqual(0, modified.GetInt32()); // a FILETIME is not an integer
+
+            Assert::IsTrue(SearchValue::FromBool(true).GetBool());
+            Assert::IsTrue(SearchValue().IsEmpty());
+            Assert::IsTrue(SearchValue().GetString().empty());
+            Assert::IsFalse(SearchValue().GetFileTime().has_value());
+            Assert::AreEqual(2.5, SearchValue::FromDouble(2.5).GetDouble());
+        }
+
+        TEST_METHOD(TestStringsAndVectorsLiveInThePage)
+        {
+            Logger::WriteMessage(L"Testing page storage...\n");
+
+            SearchValuePage page({ propid::ItemUrl, propid::Size, propid::Kind });
+            for (int i = 0; i < 1000; ++i)
+            {
+                std::wstring url = L"file:C:/Users/me/Documents/report-" + std::to_wstring(i) + L".docx";
+                SearchValue kinds[] = { SearchValue::CopyString(L"document", page.Resource()), SearchValue::CopyString(L"text", page.Resource()) };
+
+                SearchValue* values = page.AddRow();
+                values[0] = SearchValue::CopyString(url, page.Resource());
+                values[1] = SearchValue::FromUInt64(1024ull * i);
+                values[2] = SearchValue::CopyVector(kinds, (i % 2 == 0) ? 2 : 1, page.Resource());
+            }
+
+            Assert::AreEqual(static_cast<size_t>(1000), page.GetRowCount());
+            auto row = page.GetRow(421);
+            Assert::AreEqual(static_cast<size_t>(3), row.ColumnCount());
+            Assert::AreEqual(std::wstring(L"file:C:/Users/me/Documents/report-421.docx"), std::wstring(row.Get(propid::ItemUrl).GetString()));
+            Assert::AreEqual(static_cast<uint64_t>(1024 * 421), row.Get(propid::Size).GetUInt64());
+
+            auto kinds = page.GetRow(420).Get(propid::Kind).GetVector();
+            Assert::AreEqual(static_cast<size_t>(2), kinds.size());
+            Assert::AreEqual(std::wstring(L"text"), std::wstring(kinds[1].GetString()));
+            Assert::AreEqual(static_cast<size_t>(1), row.Get(propid::Kind).GetVector().size());
+
+            // Columns the page does not have read as empty
+            Assert::IsTrue(row.Get(propid::Title).IsEmpty());
+            Assert::AreEqual(SearchValuePage::npos, page.GetColumnIndex(propid::Title));
+        }
+
+        TEST_METHOD(TestEmptyValues)
+        {
+            Logger::WriteMessage(L"Testing empty strings and vectors...\n");
+
+            SearchValuePage page({ propid::Title, propid::Author });
+            SearchValue* values = page.AddRow();
+            Assert::IsTrue(values[0].IsEmpty());
+
+            values[0] = SearchValue::CopyString(L"", page.Resource());
+            values[1] = SearchValue::CopyVector(nullptr, 0, page.Resource());
+            Assert::IsTrue(values[0].Type() == SearchValueType::String);
+            Assert::IsTrue(values[0].GetString().empty());
+            Assert::IsTrue(values[1].Type() == SearchValueType::Vector);
+            Assert::IsTrue(values[1].GetVector().empty());
+        }
+    };
+}